@@ -1781,8 +1781,9 @@ AVDictionary *filter_codec_opts(AVDictionary *opts, enum AVCodecID codec_id,
 AVDictionary **setup_find_stream_info_opts(AVFormatContext *s,
                                            AVDictionary *codec_opts)
 {
-    int i;
+    int i, j, per_stream = 0;
     AVDictionary **opts;
+    AVDictionaryEntry *t = NULL;
 
     if (!s->nb_streams)
         return NULL;
@@ -1792,9 +1793,28 @@ AVDictionary **setup_find_stream_info_opts(AVFormatContext *s,
                "Could not alloc memory for stream options.\n");
         return NULL;
     }
-    for (i = 0; i < s->nb_streams; i++)
-        opts[i] = filter_codec_opts(codec_opts, s->streams[i]->codec->codec_id,
-                                    s, s->streams[i], NULL);
+
+    /* without stream specifiers the result only depends on the codec, so
+     * streams sharing a codec can reuse the first stream's dictionary
+     * instead of looking every option up again */
+    while (t = av_dict_get(codec_opts, "", t, AV_DICT_IGNORE_SUFFIX))
+        if (strchr(t->key, ':')) {
+            per_stream = 1;
+            break;
+        }
+
+    for (i = 0; i < s->nb_streams; i++) {
+        enum AVCodecID codec_id = s->streams[i]->codec->codec_id;
+
+        for (j = 0; !per_stream && j < i; j++)
+            if (s->streams[j]->codec->codec_id == codec_id)
+                break;
+        if (!per_stream && j < i)
+            av_dict_copy(&opts[i], opts[j], 0);
+        else
+            opts[i] = filter_codec_opts(codec_opts, codec_id,
+                                        s, s->streams[i], NULL);
+    }
     return opts;
 }
 
@@ -1848,6 +1868,7 @@ static int alloc_buffer(FrameBuffer **pool, AVCodecContext *s, FrameBuffer **pbu
         av_log(s, AV_LOG_ERROR, "alloc_buffer: av_image_alloc() failed\n");
         return ret;
     }
+    buf->size = ret;
     /* XXX this shouldn't be needed, but some tests break without this line
      * those decoders are buggy and need to be fixed.
      * the following tests fail:
@@ -1875,6 +1896,13 @@ static int alloc_buffer(FrameBuffer **pool, AVCodecContext *s, FrameBuffer **pbu
     return 0;
 }
 
+static void unref_buffer(FrameBuffer *buf);
+
+static void release_buffer_ref(void *opaque, uint8_t *data)
+{
+    unref_buffer(opaque);
+}
+
 int codec_get_buffer(AVCodecContext *s, AVFrame *frame)
 {
     FrameBuffer **pool = s->opaque;
@@ -1899,6 +1927,14 @@ int codec_get_buffer(AVCodecContext *s, AVFrame *frame)
             return ret;
     }
     av_assert0(!buf->refcount);
+
+    frame->buf[0] = av_buffer_create(buf->base[0], buf->size,
+                                     release_buffer_ref, buf, 0);
+    if (!frame->buf[0]) {
+        buf->next = *pool;
+        *pool     = buf;
+        return AVERROR(ENOMEM);
+    }
     buf->refcount++;
 
     frame->opaque        = buf;
@@ -1910,6 +1946,8 @@ int codec_get_buffer(AVCodecContext *s, AVFrame *frame)
         frame->data[i]     = buf->data[i];
         frame->linesize[i] = buf->linesize[i];
     }
+    for (i = 1; i < FF_ARRAY_ELEMS(frame->buf); i++)
+        frame->buf[i] = NULL;
 
     return 0;
 }
@@ -1932,7 +1970,6 @@ static void unref_buffer(FrameBuffer *buf)
 
 void codec_release_buffer(AVCodecContext *s, AVFrame *frame)
 {
-    FrameBuffer *buf = frame->opaque;
     int i;
 
     if(frame->type!=FF_BUFFER_TYPE_USER) {
@@ -1943,14 +1980,7 @@ void codec_release_buffer(AVCodecContext *s, AVFrame *frame)
     for (i = 0; i < FF_ARRAY_ELEMS(frame->data); i++)
         frame->data[i] = NULL;
 
-    unref_buffer(buf);
-}
-
-void filter_release_buffer(AVFilterBuffer *fb)
-{
-    FrameBuffer *buf = fb->priv;
-    av_free(fb);
-    unref_buffer(buf);
+    av_buffer_unref(&frame->buf[0]);
 }
 
 void free_buffer_pool(FrameBuffer **pool)
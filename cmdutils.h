@@ -523,6 +523,7 @@ typedef struct FrameBuffer {
     uint8_t *base[4];
     uint8_t *data[4];
     int  linesize[4];
+    int size;                   ///< size of the allocation starting at base[0]
 
     int h, w;
     enum AVPixelFormat pix_fmt;
@@ -539,7 +540,9 @@ typedef struct FrameBuffer {
  * @param s codec context. s->opaque must be a pointer to the head of the
  *          buffer pool.
  * @param frame frame->opaque will be set to point to the FrameBuffer
- *              containing the frame data.
+ *              containing the frame data, frame->buf[0] to a reference to
+ *              it. The FrameBuffer returns to the pool once all references
+ *              derived from frame->buf[0] are freed.
  */
 int codec_get_buffer(AVCodecContext *s, AVFrame *frame);
 
@@ -549,13 +552,6 @@ int codec_get_buffer(AVCodecContext *s, AVFrame *frame);
  */
 void codec_release_buffer(AVCodecContext *s, AVFrame *frame);
 
-/**
- * A callback to be used for AVFilterBuffer.free.
- * @param fb buffer to free. fb->priv must be a pointer to the FrameBuffer
- *           containing the buffer data.
- */
-void filter_release_buffer(AVFilterBuffer *fb);
-
 /**
  * Free all the buffers in the pool. This must be called after all the
  * buffers have been released.
@@ -111,6 +111,10 @@ static FILE *vstats_file;
 
 static void do_video_stats(OutputStream *ost, int frame_size);
 static int64_t getutime(void);
+#if HAVE_PTHREADS
+static void free_encoder_threads(void);
+static void free_mux_threads(int flush);
+#endif
 
 static int run_as_daemon  = 0;
 static int64_t video_size = 0;
@@ -120,7 +124,7 @@ static int64_t extra_size = 0;
 static int nb_frames_dup = 0;
 static int nb_frames_drop = 0;
 
-static int current_time;
+static int64_t current_time;
 AVIOContext *progress_avio = NULL;
 
 static uint8_t *subtitle_out;
@@ -128,6 +132,12 @@ static uint8_t *subtitle_out;
 #if HAVE_PTHREADS
 /* signal to input threads that they should exit; set by the main thread */
 static int transcoding_finished;
+
+/* input threads bump input_seq and signal input_cond whenever they queue a
+ * packet or finish, so that the main thread can sleep until then */
+static pthread_mutex_t input_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  input_cond = PTHREAD_COND_INITIALIZER;
+static unsigned input_seq, input_seq_seen;
 #endif
 
 #define DEFAULT_PASS_LOGFILENAME_PREFIX "ffmpeg2pass"
@@ -397,6 +407,11 @@ static void exit_program(void)
 {
     int i, j;
 
+#if HAVE_PTHREADS
+    free_encoder_threads();
+    free_mux_threads(0);
+#endif
+
     for (i = 0; i < nb_filtergraphs; i++) {
         avfilter_graph_free(&filtergraphs[i]->graph);
         for (j = 0; j < filtergraphs[i]->nb_inputs; j++) {
@@ -487,32 +502,36 @@ static void abort_codec_experimental(AVCodec *c, int encoder)
     exit(1);
 }
 
-static void update_benchmark(const char *fmt, ...)
+/**
+ * Mark the start (fmt == NULL) or the end of a benchmarked stage.
+ * The time spent in the stage is printed with -benchmark_all and
+ * added to *stage_time with -benchmark or -progress.
+ */
+static void update_benchmark(int64_t *stage_time, const char *fmt, ...)
 {
-    if (do_benchmark_all) {
+    if (do_benchmark_all || ((do_benchmark || progress_avio) && stage_time)) {
         int64_t t = getutime();
         va_list va;
         char buf[1024];
 
         if (fmt) {
-            va_start(va, fmt);
-            vsnprintf(buf, sizeof(buf), fmt, va);
-            va_end(va);
-            printf("bench: %8"PRIu64" %s \n", t - current_time, buf);
+            if (stage_time)
+                *stage_time += t - current_time;
+            if (do_benchmark_all) {
+                va_start(va, fmt);
+                vsnprintf(buf, sizeof(buf), fmt, va);
+                va_end(va);
+                printf("bench: %8"PRIu64" %s \n", t - current_time, buf);
+            }
         }
         current_time = t;
     }
 }
 
-static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
+/* fix up the timestamps of pkt against the ones already muxed and write it */
+static int mux_packet(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
 {
-    AVBitStreamFilterContext *bsfc = ost->bitstream_filters;
-    AVCodecContext          *avctx = ost->st->codec;
-    int ret;
-
-    if ((avctx->codec_type == AVMEDIA_TYPE_VIDEO && video_sync_method == VSYNC_DROP) ||
-        (avctx->codec_type == AVMEDIA_TYPE_AUDIO && audio_sync_method < 0))
-        pkt->pts = pkt->dts = AV_NOPTS_VALUE;
+    AVCodecContext *avctx = ost->st->codec;
 
     if ((avctx->codec_type == AVMEDIA_TYPE_AUDIO || avctx->codec_type == AVMEDIA_TYPE_VIDEO) && pkt->dts != AV_NOPTS_VALUE) {
         int64_t max = ost->st->cur_dts + !(s->oformat->flags & AVFMT_TS_NONSTRICT);
@@ -525,6 +544,243 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
         }
     }
 
+    if (debug_ts) {
+        av_log(NULL, AV_LOG_INFO, "muxer <- type:%s "
+                "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s size:%d\n",
+                av_get_media_type_string(ost->st->codec->codec_type),
+                av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &ost->st->time_base),
+                av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &ost->st->time_base),
+                pkt->size
+              );
+    }
+
+    return av_interleaved_write_frame(s, pkt);
+}
+
+#if HAVE_PTHREADS
+/* called with mux_lock held, or before the muxer thread is started */
+static void update_mux_state(OutputFile *of)
+{
+    int i;
+
+    for (i = 0; i < of->ctx->nb_streams; i++)
+        output_streams[of->ost_index + i]->mux_pts = of->ctx->streams[i]->pts.val;
+    if (of->ctx->pb)
+        of->mux_size = avio_tell(of->ctx->pb);
+}
+
+static void *mux_thread(void *arg)
+{
+    OutputFile *of = arg;
+    AVPacket pkt;
+    int ret;
+
+    pthread_mutex_lock(&of->mux_lock);
+    for (;;) {
+        while (!av_fifo_size(of->mux_fifo) && !of->mux_exit)
+            pthread_cond_wait(&of->mux_cond, &of->mux_lock);
+        if (!av_fifo_size(of->mux_fifo))
+            break;
+
+        av_fifo_generic_read(of->mux_fifo, &pkt, sizeof(pkt), NULL);
+        pthread_cond_signal(&of->mux_cond);
+        pthread_mutex_unlock(&of->mux_lock);
+
+        ret = mux_packet(of->ctx, &pkt, output_streams[of->ost_index + pkt.stream_index]);
+
+        pthread_mutex_lock(&of->mux_lock);
+        if (ret < 0) {
+            av_free_packet(&pkt);
+            of->mux_error = ret;
+            pthread_cond_signal(&of->mux_cond);
+            break;
+        }
+        update_mux_state(of);
+    }
+    pthread_mutex_unlock(&of->mux_lock);
+
+    return NULL;
+}
+
+static void queue_mux_packet(OutputFile *of, OutputStream *ost, AVPacket *pkt)
+{
+    int ret;
+
+    if (av_dup_packet(pkt) < 0) {
+        av_log(NULL, AV_LOG_FATAL, "Out of memory queuing packet for the muxer\n");
+        exit(1);
+    }
+
+    pthread_mutex_lock(&of->mux_lock);
+
+    if (of->mux_queue_drop && !of->mux_error) {
+        int key = ost->st->codec->codec_type != AVMEDIA_TYPE_VIDEO ||
+                  pkt->flags & AV_PKT_FLAG_KEY;
+
+        /* once a packet of a stream was dropped, resume it at a keyframe */
+        if (!av_fifo_space(of->mux_fifo) || (ost->mux_dropping && !key)) {
+            if (!of->mux_dropped++)
+                av_log(NULL, AV_LOG_WARNING, "Output file #%d cannot keep up, "
+                       "dropping packets\n", ost->file_index);
+            ost->mux_dropping = 1;
+            pthread_mutex_unlock(&of->mux_lock);
+            av_free_packet(pkt);
+            return;
+        }
+        ost->mux_dropping = 0;
+    }
+
+    while (!av_fifo_space(of->mux_fifo) && !of->mux_error)
+        pthread_cond_wait(&of->mux_cond, &of->mux_lock);
+
+    if (of->mux_error) {
+        ret = of->mux_error;
+        pthread_mutex_unlock(&of->mux_lock);
+        av_free_packet(pkt);
+        print_error("av_interleaved_write_frame()", ret);
+        exit(1);
+    }
+
+    av_fifo_generic_write(of->mux_fifo, pkt, sizeof(*pkt), NULL);
+    pthread_cond_signal(&of->mux_cond);
+    pthread_mutex_unlock(&of->mux_lock);
+
+    /* the data now belongs to the queued copy, like with av_interleaved_write_frame() */
+    pkt->destruct = NULL;
+}
+
+/**
+ * Stop the muxer threads.
+ *
+ * @param flush write the queued packets first and fail on muxing errors,
+ *              otherwise the queued packets are discarded
+ */
+static void free_mux_threads(int flush)
+{
+    int i;
+
+    for (i = 0; i < nb_output_files; i++) {
+        OutputFile *of = output_files[i];
+        AVPacket pkt;
+
+        if (!of->mux_thread_started)
+            continue;
+
+        pthread_mutex_lock(&of->mux_lock);
+        while (!flush && av_fifo_size(of->mux_fifo)) {
+            av_fifo_generic_read(of->mux_fifo, &pkt, sizeof(pkt), NULL);
+            av_free_packet(&pkt);
+        }
+        of->mux_exit = 1;
+        pthread_cond_signal(&of->mux_cond);
+        pthread_mutex_unlock(&of->mux_lock);
+
+        pthread_join(of->mux_thread, NULL);
+        of->mux_thread_started = 0;
+
+        /* left over after a muxing error */
+        while (av_fifo_size(of->mux_fifo)) {
+            av_fifo_generic_read(of->mux_fifo, &pkt, sizeof(pkt), NULL);
+            av_free_packet(&pkt);
+        }
+        av_fifo_free(of->mux_fifo);
+        of->mux_fifo = NULL;
+        pthread_mutex_destroy(&of->mux_lock);
+        pthread_cond_destroy(&of->mux_cond);
+
+        if (of->mux_dropped)
+            av_log(NULL, AV_LOG_WARNING, "%d packets dropped for output file #%d\n",
+                   of->mux_dropped, i);
+        if (flush && of->mux_error < 0) {
+            print_error("av_interleaved_write_frame()", of->mux_error);
+            exit(1);
+        }
+    }
+}
+
+static int init_mux_threads(void)
+{
+    int i, j, ret;
+
+    for (i = 0; i < nb_output_files; i++) {
+        OutputFile *of = output_files[i];
+
+        if (of->mux_queue_size <= 0)
+            continue;
+
+        if (!(of->mux_fifo = av_fifo_alloc(of->mux_queue_size * sizeof(AVPacket))))
+            return AVERROR(ENOMEM);
+
+        for (j = 0; j < of->ctx->nb_streams; j++)
+            output_streams[of->ost_index + j]->mux_cur_dts = of->ctx->streams[j]->cur_dts;
+        update_mux_state(of);
+
+        pthread_mutex_init(&of->mux_lock, NULL);
+        pthread_cond_init (&of->mux_cond, NULL);
+
+        if ((ret = pthread_create(&of->mux_thread, NULL, mux_thread, of))) {
+            pthread_mutex_destroy(&of->mux_lock);
+            pthread_cond_destroy(&of->mux_cond);
+            av_fifo_free(of->mux_fifo);
+            of->mux_fifo = NULL;
+            return AVERROR(ret);
+        }
+        of->mux_thread_started = 1;
+    }
+    return 0;
+}
+#endif
+
+/* the muxer thread of a file may be updating its muxer state, so the values
+ * tracked next to it are used for files with a muxer thread */
+static int64_t get_output_cur_dts(OutputStream *ost)
+{
+#if HAVE_PTHREADS
+    if (output_files[ost->file_index]->mux_thread_started)
+        return ost->mux_cur_dts;
+#endif
+    return ost->st->cur_dts;
+}
+
+static int64_t get_output_pts(OutputStream *ost)
+{
+#if HAVE_PTHREADS
+    OutputFile *of = output_files[ost->file_index];
+    if (of->mux_thread_started) {
+        int64_t pts;
+        pthread_mutex_lock(&of->mux_lock);
+        pts = ost->mux_pts;
+        pthread_mutex_unlock(&of->mux_lock);
+        return pts;
+    }
+#endif
+    return ost->st->pts.val;
+}
+
+static int64_t get_output_size(OutputFile *of)
+{
+#if HAVE_PTHREADS
+    if (of->mux_thread_started) {
+        int64_t size;
+        pthread_mutex_lock(&of->mux_lock);
+        size = of->mux_size;
+        pthread_mutex_unlock(&of->mux_lock);
+        return size;
+    }
+#endif
+    return of->ctx->pb ? avio_tell(of->ctx->pb) : 0;
+}
+
+static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
+{
+    AVBitStreamFilterContext *bsfc = ost->bitstream_filters;
+    AVCodecContext          *avctx = ost->st->codec;
+    int ret;
+
+    if ((avctx->codec_type == AVMEDIA_TYPE_VIDEO && video_sync_method == VSYNC_DROP) ||
+        (avctx->codec_type == AVMEDIA_TYPE_AUDIO && audio_sync_method < 0))
+        pkt->pts = pkt->dts = AV_NOPTS_VALUE;
+
     /*
      * Audio encoders may split the packets --  #frames in != #packets out.
      * But there is no reordering, so we can limit the number of output packets
@@ -574,17 +830,16 @@ static void write_frame(AVFormatContext *s, AVPacket *pkt, OutputStream *ost)
 
     pkt->stream_index = ost->index;
 
-    if (debug_ts) {
-        av_log(NULL, AV_LOG_INFO, "muxer <- type:%s "
-                "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s size:%d\n",
-                av_get_media_type_string(ost->st->codec->codec_type),
-                av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &ost->st->time_base),
-                av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &ost->st->time_base),
-                pkt->size
-              );
+#if HAVE_PTHREADS
+    if (output_files[ost->file_index]->mux_thread_started) {
+        if (pkt->dts != AV_NOPTS_VALUE)
+            ost->mux_cur_dts = pkt->dts;
+        queue_mux_packet(output_files[ost->file_index], ost, pkt);
+        return;
     }
+#endif
 
-    ret = av_interleaved_write_frame(s, pkt);
+    ret = mux_packet(s, pkt, ost);
     if (ret < 0) {
         print_error("av_interleaved_write_frame()", ret);
         exit(1);
@@ -615,12 +870,258 @@ static int check_recording_time(OutputStream *ost)
     return 1;
 }
 
+static void audio_encoded(AVFormatContext *s, OutputStream *ost,
+                          AVPacket *pkt, int ret, int got_packet)
+{
+    AVCodecContext *enc = ost->st->codec;
+
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "Audio encoding failed (avcodec_encode_audio2)\n");
+        exit(1);
+    }
+
+    if (got_packet) {
+        if (pkt->pts != AV_NOPTS_VALUE)
+            pkt->pts      = av_rescale_q(pkt->pts,      enc->time_base, ost->st->time_base);
+        if (pkt->dts != AV_NOPTS_VALUE)
+            pkt->dts      = av_rescale_q(pkt->dts,      enc->time_base, ost->st->time_base);
+        if (pkt->duration > 0)
+            pkt->duration = av_rescale_q(pkt->duration, enc->time_base, ost->st->time_base);
+
+        if (debug_ts) {
+            av_log(NULL, AV_LOG_INFO, "encoder -> type:audio "
+                   "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
+                   av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &ost->st->time_base),
+                   av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &ost->st->time_base));
+        }
+
+        audio_size += pkt->size;
+        write_frame(s, pkt, ost);
+
+        av_free_packet(pkt);
+    }
+}
+
+static void video_encoded(AVFormatContext *s, OutputStream *ost, AVPacket *pkt,
+                          int ret, int got_packet, int64_t sync_opts)
+{
+    AVCodecContext *enc = ost->st->codec;
+
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_FATAL, "Video encoding failed\n");
+        exit(1);
+    }
+
+    if (got_packet) {
+        if (pkt->pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & CODEC_CAP_DELAY))
+            pkt->pts = sync_opts;
+
+        if (pkt->pts != AV_NOPTS_VALUE)
+            pkt->pts = av_rescale_q(pkt->pts, enc->time_base, ost->st->time_base);
+        if (pkt->dts != AV_NOPTS_VALUE)
+            pkt->dts = av_rescale_q(pkt->dts, enc->time_base, ost->st->time_base);
+
+        if (debug_ts) {
+            av_log(NULL, AV_LOG_INFO, "encoder -> type:video "
+                "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
+                av_ts2str(pkt->pts), av_ts2timestr(pkt->pts, &ost->st->time_base),
+                av_ts2str(pkt->dts), av_ts2timestr(pkt->dts, &ost->st->time_base));
+        }
+
+        video_size += pkt->size;
+        write_frame(s, pkt, ost);
+        av_free_packet(pkt);
+
+        /* if two pass, output log */
+        if (ost->logfile && enc->stats_out) {
+            fprintf(ost->logfile, "%s", enc->stats_out);
+        }
+    }
+}
+
+#if HAVE_PTHREADS
+enum {
+    ENC_JOB_IDLE,
+    ENC_JOB_SUBMITTED,
+    ENC_JOB_DONE,
+};
+
+/* streams with a submitted job, in submission order, so that the resulting
+ * packets are written in the same order as without threads */
+static OutputStream **enc_queue;
+static int enc_queue_len;
+
+static void *encoder_thread(void *arg)
+{
+    OutputStream *ost = arg;
+    AVCodecContext *enc = ost->st->codec;
+    int ret;
+
+    pthread_mutex_lock(&ost->enc_lock);
+    for (;;) {
+        while (ost->enc_state != ENC_JOB_SUBMITTED && !ost->enc_exit)
+            pthread_cond_wait(&ost->enc_cond, &ost->enc_lock);
+        if (ost->enc_state != ENC_JOB_SUBMITTED)
+            break;
+        pthread_mutex_unlock(&ost->enc_lock);
+
+        if (enc->codec_type == AVMEDIA_TYPE_VIDEO)
+            ret = avcodec_encode_video2(enc, &ost->enc_pkt, &ost->enc_frame,
+                                        &ost->enc_got_packet);
+        else
+            ret = avcodec_encode_audio2(enc, &ost->enc_pkt, &ost->enc_frame,
+                                        &ost->enc_got_packet);
+
+        pthread_mutex_lock(&ost->enc_lock);
+        ost->enc_ret   = ret;
+        ost->enc_state = ENC_JOB_DONE;
+        pthread_cond_broadcast(&ost->enc_cond);
+    }
+    pthread_mutex_unlock(&ost->enc_lock);
+
+    return NULL;
+}
+
+/* wait for the job of the first queued stream and write its output */
+static void finish_first_encode_job(void)
+{
+    OutputStream *ost = enc_queue[0];
+    OutputFile    *of = output_files[ost->file_index];
+
+    pthread_mutex_lock(&ost->enc_lock);
+    while (ost->enc_state == ENC_JOB_SUBMITTED)
+        pthread_cond_wait(&ost->enc_cond, &ost->enc_lock);
+    ost->enc_state = ENC_JOB_IDLE;
+    pthread_mutex_unlock(&ost->enc_lock);
+
+    memmove(enc_queue, enc_queue + 1, --enc_queue_len * sizeof(*enc_queue));
+
+    avfilter_unref_bufferp(&ost->enc_picref);
+    if (ost->st->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+        video_encoded(of->ctx, ost, &ost->enc_pkt, ost->enc_ret,
+                      ost->enc_got_packet, ost->enc_sync_opts);
+    else
+        audio_encoded(of->ctx, ost, &ost->enc_pkt, ost->enc_ret,
+                      ost->enc_got_packet);
+}
+
+/**
+ * Wait until the encoder of ost is idle, writing the output of all the jobs
+ * submitted before its own.
+ */
+static void finish_encode_job(OutputStream *ost)
+{
+    while (ost->enc_state != ENC_JOB_IDLE) {
+        av_assert0(enc_queue_len > 0);
+        finish_first_encode_job();
+    }
+}
+
+static void finish_encode_jobs(void)
+{
+    while (enc_queue_len > 0)
+        finish_first_encode_job();
+}
+
+static void submit_encode_job(OutputStream *ost, const AVFrame *frame)
+{
+    finish_encode_job(ost);
+
+    ost->enc_frame = *frame;
+    if (frame->extended_data == frame->data)
+        ost->enc_frame.extended_data = ost->enc_frame.data;
+    ost->enc_picref = avfilter_ref_buffer(ost->filtered_picref, ~0);
+    if (!ost->enc_picref) {
+        av_log(NULL, AV_LOG_FATAL, "Out of memory submitting frame to encoder\n");
+        exit(1);
+    }
+    ost->enc_sync_opts = ost->sync_opts;
+    av_init_packet(&ost->enc_pkt);
+    ost->enc_pkt.data = NULL;
+    ost->enc_pkt.size = 0;
+
+    enc_queue[enc_queue_len++] = ost;
+
+    pthread_mutex_lock(&ost->enc_lock);
+    ost->enc_state = ENC_JOB_SUBMITTED;
+    pthread_cond_broadcast(&ost->enc_cond);
+    pthread_mutex_unlock(&ost->enc_lock);
+}
+
+static void free_encoder_threads(void)
+{
+    int i;
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+
+        if (!ost->enc_thread_started)
+            continue;
+
+        pthread_mutex_lock(&ost->enc_lock);
+        ost->enc_exit = 1;
+        pthread_cond_broadcast(&ost->enc_cond);
+        pthread_mutex_unlock(&ost->enc_lock);
+
+        pthread_join(ost->enc_thread, NULL);
+        ost->enc_thread_started = 0;
+
+        pthread_mutex_destroy(&ost->enc_lock);
+        pthread_cond_destroy(&ost->enc_cond);
+
+        avfilter_unref_bufferp(&ost->enc_picref);
+        if (ost->enc_state == ENC_JOB_DONE)
+            av_free_packet(&ost->enc_pkt);
+        ost->enc_state = ENC_JOB_IDLE;
+    }
+    enc_queue_len = 0;
+    av_freep(&enc_queue);
+}
+
+static int init_encoder_threads(void)
+{
+    int i, ret;
+
+    if (!parallel_encoding)
+        return 0;
+
+    if (!(enc_queue = av_mallocz(nb_output_streams * sizeof(*enc_queue))))
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        AVCodecContext *enc = ost->st->codec;
+
+        /* raw pictures are not encoded, video statistics and benchmarking
+         * need the encoder output right away */
+        if (!ost->encoding_needed || !ost->filter ||
+            (enc->codec_type != AVMEDIA_TYPE_VIDEO && enc->codec_type != AVMEDIA_TYPE_AUDIO) ||
+            (enc->codec_type == AVMEDIA_TYPE_VIDEO && vstats_filename) ||
+            (output_files[ost->file_index]->ctx->oformat->flags & AVFMT_RAWPICTURE &&
+             enc->codec->id == AV_CODEC_ID_RAWVIDEO) ||
+            do_benchmark_all)
+            continue;
+
+        pthread_mutex_init(&ost->enc_lock, NULL);
+        pthread_cond_init (&ost->enc_cond, NULL);
+
+        if ((ret = pthread_create(&ost->enc_thread, NULL, encoder_thread, ost))) {
+            pthread_mutex_destroy(&ost->enc_lock);
+            pthread_cond_destroy(&ost->enc_cond);
+            return AVERROR(ret);
+        }
+        ost->enc_thread_started = 1;
+    }
+    return 0;
+}
+#endif
+
 static void do_audio_out(AVFormatContext *s, OutputStream *ost,
                          AVFrame *frame)
 {
     AVCodecContext *enc = ost->st->codec;
     AVPacket pkt;
-    int got_packet = 0;
+    int got_packet = 0, ret;
 
     av_init_packet(&pkt);
     pkt.data = NULL;
@@ -633,34 +1134,18 @@ static void do_audio_out(AVFormatContext *s, OutputStream *ost,
         frame->pts = ost->sync_opts;
     ost->sync_opts = frame->pts + frame->nb_samples;
 
-    av_assert0(pkt.size || !pkt.data);
-    update_benchmark(NULL);
-    if (avcodec_encode_audio2(enc, &pkt, frame, &got_packet) < 0) {
-        av_log(NULL, AV_LOG_FATAL, "Audio encoding failed (avcodec_encode_audio2)\n");
-        exit(1);
+#if HAVE_PTHREADS
+    if (ost->enc_thread_started) {
+        submit_encode_job(ost, frame);
+        return;
     }
-    update_benchmark("encode_audio %d.%d", ost->file_index, ost->index);
-
-    if (got_packet) {
-        if (pkt.pts != AV_NOPTS_VALUE)
-            pkt.pts      = av_rescale_q(pkt.pts,      enc->time_base, ost->st->time_base);
-        if (pkt.dts != AV_NOPTS_VALUE)
-            pkt.dts      = av_rescale_q(pkt.dts,      enc->time_base, ost->st->time_base);
-        if (pkt.duration > 0)
-            pkt.duration = av_rescale_q(pkt.duration, enc->time_base, ost->st->time_base);
-
-        if (debug_ts) {
-            av_log(NULL, AV_LOG_INFO, "encoder -> type:audio "
-                   "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
-                   av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &ost->st->time_base),
-                   av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &ost->st->time_base));
-        }
-
-        audio_size += pkt.size;
-        write_frame(s, &pkt, ost);
+#endif
 
-        av_free_packet(&pkt);
-    }
+    av_assert0(pkt.size || !pkt.data);
+    update_benchmark(&ost->enc_time, NULL);
+    ret = avcodec_encode_audio2(enc, &pkt, frame, &got_packet);
+    update_benchmark(&ost->enc_time, "encode_audio %d.%d", ost->file_index, ost->index);
+    audio_encoded(s, ost, &pkt, ret, got_packet);
 }
 
 static void pre_process_video_frame(InputStream *ist, AVPicture *picture, void **bufp)
@@ -843,6 +1328,11 @@ static void do_video_out(AVFormatContext *s,
 
   /* duplicates frame if needed */
   for (i = 0; i < nb_frames; i++) {
+#if HAVE_PTHREADS
+    /* the encoder context is modified below */
+    if (ost->enc_thread_started)
+        finish_encode_job(ost);
+#endif
     av_init_packet(&pkt);
     pkt.data = NULL;
     pkt.size = 0;
@@ -901,39 +1391,18 @@ static void do_video_out(AVFormatContext *s,
             big_picture.pict_type = AV_PICTURE_TYPE_I;
             ost->forced_kf_index++;
         }
-        update_benchmark(NULL);
-        ret = avcodec_encode_video2(enc, &pkt, &big_picture, &got_packet);
-        update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
-        if (ret < 0) {
-            av_log(NULL, AV_LOG_FATAL, "Video encoding failed\n");
-            exit(1);
-        }
-
-        if (got_packet) {
-            if (pkt.pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & CODEC_CAP_DELAY))
-                pkt.pts = ost->sync_opts;
-
-            if (pkt.pts != AV_NOPTS_VALUE)
-                pkt.pts = av_rescale_q(pkt.pts, enc->time_base, ost->st->time_base);
-            if (pkt.dts != AV_NOPTS_VALUE)
-                pkt.dts = av_rescale_q(pkt.dts, enc->time_base, ost->st->time_base);
-
-            if (debug_ts) {
-                av_log(NULL, AV_LOG_INFO, "encoder -> type:video "
-                    "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
-                    av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &ost->st->time_base),
-                    av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &ost->st->time_base));
-            }
-
-            frame_size = pkt.size;
-            video_size += pkt.size;
-            write_frame(s, &pkt, ost);
-            av_free_packet(&pkt);
-
-            /* if two pass, output log */
-            if (ost->logfile && enc->stats_out) {
-                fprintf(ost->logfile, "%s", enc->stats_out);
-            }
+#if HAVE_PTHREADS
+        if (ost->enc_thread_started)
+            submit_encode_job(ost, &big_picture);
+        else
+#endif
+        {
+            update_benchmark(&ost->enc_time, NULL);
+            ret = avcodec_encode_video2(enc, &pkt, &big_picture, &got_packet);
+            update_benchmark(&ost->enc_time, "encode_video %d.%d", ost->file_index, ost->index);
+            if (got_packet)
+                frame_size = pkt.size;
+            video_encoded(s, ost, &pkt, ret, got_packet, ost->sync_opts);
         }
     }
     ost->sync_opts++;
@@ -978,7 +1447,7 @@ static void do_video_stats(OutputStream *ost, int frame_size)
 
         fprintf(vstats_file,"f_size= %6d ", frame_size);
         /* compute pts value */
-        ti1 = ost->st->pts.val * av_q2d(enc->time_base);
+        ti1 = get_output_pts(ost) * av_q2d(enc->time_base);
         if (ti1 < 0.01)
             ti1 = 0.01;
 
@@ -1048,6 +1517,14 @@ static int reap_filters(void)
             //    *filtered_frame= *input_streams[ost->source_index]->decoded_frame; //for me_threshold
 
 
+#if HAVE_PTHREADS
+            /* the previous frame of this stream must be encoded before its
+             * encoder context is touched again */
+            if (ost->enc_thread_started)
+                finish_encode_job(ost);
+#endif
+            ost->filtered_picref = picref;
+
             switch (ost->filter->filter->inputs[0]->type) {
             case AVMEDIA_TYPE_VIDEO:
                 avfilter_copy_buf_props(filtered_frame, picref);
@@ -1067,13 +1544,78 @@ static int reap_filters(void)
                 av_assert0(0);
             }
 
+            ost->filtered_picref = NULL;
             avfilter_unref_buffer(picref);
         }
     }
 
+#if HAVE_PTHREADS
+    finish_encode_jobs();
+#endif
+
     return 0;
 }
 
+/**
+ * Append the per-stream and per-stage counters to a -progress report.
+ *
+ * @param period seconds elapsed since the previous report
+ */
+static void print_progress_metrics(AVBPrint *buf, double period)
+{
+    int i;
+
+    for (i = 0; i < nb_input_streams; i++) {
+        InputStream *ist = input_streams[i];
+        if (ist->discard)
+            continue;
+        av_bprintf(buf, "input_%d_%d_packets=%"PRIu64"\n",
+                   ist->file_index, ist->st->index, ist->nb_packets);
+        if (!ist->decoding_needed)
+            continue;
+        av_bprintf(buf, "input_%d_%d_frames=%"PRIu64"\n",
+                   ist->file_index, ist->st->index, ist->frames_decoded);
+        av_bprintf(buf, "input_%d_%d_fps=%.1f\n", ist->file_index, ist->st->index,
+                   period > 0 ? (ist->frames_decoded - ist->report_frames_decoded) / period : 0);
+        av_bprintf(buf, "input_%d_%d_dec_time=%.3f\n",
+                   ist->file_index, ist->st->index, ist->dec_time / 1000000.0);
+        ist->report_frames_decoded = ist->frames_decoded;
+    }
+#if HAVE_PTHREADS
+    for (i = 0; i < nb_input_files; i++) {
+        InputFile *f = input_files[i];
+        if (f->queue)
+            av_bprintf(buf, "input_%d_queue=%u\n", i, av_spsc_queue_size(f->queue));
+    }
+#endif
+    for (i = 0; i < nb_filtergraphs; i++)
+        av_bprintf(buf, "graph_%d_filter_time=%.3f\n",
+                   i, filtergraphs[i]->filter_time / 1000000.0);
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        av_bprintf(buf, "stream_%d_%d_frames=%d\n",
+                   ost->file_index, ost->index, ost->frame_number);
+        av_bprintf(buf, "stream_%d_%d_fps=%.1f\n", ost->file_index, ost->index,
+                   period > 0 ? (ost->frame_number - ost->report_frame_number) / period : 0);
+        if (ost->encoding_needed)
+            av_bprintf(buf, "stream_%d_%d_enc_time=%.3f\n",
+                       ost->file_index, ost->index, ost->enc_time / 1000000.0);
+        ost->report_frame_number = ost->frame_number;
+    }
+#if HAVE_PTHREADS
+    for (i = 0; i < nb_output_files; i++) {
+        OutputFile *of = output_files[i];
+        if (!of->mux_thread_started)
+            continue;
+        pthread_mutex_lock(&of->mux_lock);
+        av_bprintf(buf, "output_%d_mux_queue=%d\n",
+                   i, av_fifo_size(of->mux_fifo) / (int)sizeof(AVPacket));
+        av_bprintf(buf, "output_%d_mux_dropped=%d\n", i, of->mux_dropped);
+        pthread_mutex_unlock(&of->mux_lock);
+    }
+#endif
+}
+
 static void print_report(int is_last_report, int64_t timer_start, int64_t cur_time)
 {
     char buf[1024];
@@ -1088,6 +1630,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     static int64_t last_time = -1;
     static int qp_histogram[52];
     int hours, mins, secs, us;
+    double period;
 
     if (!print_stats && !is_last_report && !progress_avio)
         return;
@@ -1097,17 +1640,25 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
             last_time = cur_time;
             return;
         }
-        if ((cur_time - last_time) < 500000)
+        if ((cur_time - last_time) < stats_period)
             return;
-        last_time = cur_time;
     }
+    period = last_time == -1 ? 0 : (cur_time - last_time) / 1000000.0;
+    last_time = cur_time;
 
 
     oc = output_files[0]->ctx;
 
-    total_size = avio_size(oc->pb);
-    if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
-        total_size = avio_tell(oc->pb);
+#if HAVE_PTHREADS
+    if (output_files[0]->mux_thread_started)
+        total_size = get_output_size(output_files[0]);
+    else
+#endif
+    {
+        total_size = avio_size(oc->pb);
+        if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
+            total_size = avio_tell(oc->pb);
+    }
 
     buf[0] = '\0';
     vid = 0;
@@ -1176,8 +1727,8 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
             vid = 1;
         }
         /* compute min output value */
-        if ((is_last_report || !ost->finished) && ost->st->pts.val != AV_NOPTS_VALUE)
-            pts = FFMAX(pts, av_rescale_q(ost->st->pts.val,
+        if ((is_last_report || !ost->finished) && get_output_pts(ost) != AV_NOPTS_VALUE)
+            pts = FFMAX(pts, av_rescale_q(get_output_pts(ost),
                                           ost->st->time_base, AV_TIME_BASE_Q));
     }
 
@@ -1212,6 +1763,13 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
                 nb_frames_dup, nb_frames_drop);
     av_bprintf(&buf_script, "dup_frames=%d\n", nb_frames_dup);
     av_bprintf(&buf_script, "drop_frames=%d\n", nb_frames_drop);
+    if (cur_time > timer_start && pts != INT64_MIN)
+        av_bprintf(&buf_script, "speed=%.3f\n",
+                   (double)pts / (cur_time - timer_start));
+    else
+        av_bprintf(&buf_script, "speed=N/A\n");
+    if (progress_avio)
+        print_progress_metrics(&buf_script, period);
 
     if (print_stats || is_last_report) {
     av_log(NULL, AV_LOG_INFO, "%s    \r", buf);
@@ -1293,9 +1851,9 @@ static void flush_encoders(void)
                 pkt.data = NULL;
                 pkt.size = 0;
 
-                update_benchmark(NULL);
+                update_benchmark(&ost->enc_time, NULL);
                 ret = encode(enc, &pkt, NULL, &got_packet);
-                update_benchmark("flush %s %d.%d", desc, ost->file_index, ost->index);
+                update_benchmark(&ost->enc_time, "flush %s %d.%d", desc, ost->file_index, ost->index);
                 if (ret < 0) {
                     av_log(NULL, AV_LOG_FATAL, "%s encoding failed\n", desc);
                     exit(1);
@@ -1343,7 +1901,7 @@ static int check_output_constraints(InputStream *ist, OutputStream *ost)
     return 1;
 }
 
-static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *pkt)
+static void do_streamcopy(InputStream *ist, OutputStream *ost, AVPacket *pkt)
 {
     OutputFile *of = output_files[ost->file_index];
     int64_t ost_tb_start_time = av_rescale_q(of->start_time, AV_TIME_BASE_Q, ost->st->time_base);
@@ -1412,6 +1970,17 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
         opkt.size = pkt->size;
     }
 
+    /* hand the demuxer's buffer over to the muxer, so it is not duplicated
+     * when the packet is queued for interleaving */
+    if (ost->copy_passthrough && !opkt.destruct && pkt->destruct &&
+        opkt.data == pkt->data && opkt.size == pkt->size &&
+        !pkt->side_data_elems &&
+        !(ost->st->codec->codec_type == AVMEDIA_TYPE_VIDEO && (of->ctx->oformat->flags & AVFMT_RAWPICTURE))) {
+        opkt.destruct = pkt->destruct;
+        opkt.priv     = pkt->priv;
+        pkt->destruct = NULL;
+    }
+
     if (ost->st->codec->codec_type == AVMEDIA_TYPE_VIDEO && (of->ctx->oformat->flags & AVFMT_RAWPICTURE)) {
         /* store AVPicture in AVPacket, as expected by the output format */
         avpicture_fill(&pict, opkt.data, ost->st->codec->pix_fmt, ost->st->codec->width, ost->st->codec->height);
@@ -1427,10 +1996,12 @@ static void do_streamcopy(InputStream *ist, OutputStream *ost, const AVPacket *p
 static void rate_emu_sleep(InputStream *ist)
 {
     if (input_files[ist->file_index]->rate_emu) {
+        /* sleep until an absolute deadline relative to the start, so that
+         * the wakeup latency of each sleep does not add up over time */
         int64_t pts = av_rescale(ist->dts, 1000000, AV_TIME_BASE);
-        int64_t now = av_gettime() - ist->start;
+        int64_t now = av_gettime_relative() - ist->start;
         if (pts > now)
-            av_usleep(pts - now);
+            av_usleep_until(ist->start + pts);
     }
 }
 
@@ -1463,9 +2034,9 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output)
         return AVERROR(ENOMEM);
     decoded_frame = ist->decoded_frame;
 
-    update_benchmark(NULL);
+    update_benchmark(&ist->dec_time, NULL);
     ret = avcodec_decode_audio4(avctx, decoded_frame, got_output, pkt);
-    update_benchmark("decode_audio %d.%d", ist->file_index, ist->st->index);
+    update_benchmark(&ist->dec_time, "decode_audio %d.%d", ist->file_index, ist->st->index);
 
     if (ret >= 0 && avctx->sample_rate <= 0) {
         av_log(avctx, AV_LOG_ERROR, "Sample rate %d invalid\n", avctx->sample_rate);
@@ -1479,6 +2050,7 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output)
         }
         return ret;
     }
+    ist->frames_decoded++;
 
 #if 1
     /* increment next_dts to use for the case where the input stream does not
@@ -1563,9 +2135,13 @@ static int decode_audio(InputStream *ist, AVPacket *pkt, int *got_output)
         decoded_frame->pts = av_rescale_delta(decoded_frame_tb, decoded_frame->pts,
                                               (AVRational){1, ist->st->codec->sample_rate}, decoded_frame->nb_samples, &ist->filter_in_rescale_delta_last,
                                               (AVRational){1, ist->st->codec->sample_rate});
-    for (i = 0; i < ist->nb_filters; i++)
+    for (i = 0; i < ist->nb_filters; i++) {
+        FilterGraph *fg = ist->filters[i]->graph;
+        update_benchmark(&fg->filter_time, NULL);
         av_buffersrc_add_frame(ist->filters[i]->filter, decoded_frame,
                                AV_BUFFERSRC_FLAG_PUSH);
+        update_benchmark(&fg->filter_time, "filter_audio %d", fg->index);
+    }
 
     decoded_frame->pts = AV_NOPTS_VALUE;
 
@@ -1585,10 +2161,10 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output)
     decoded_frame = ist->decoded_frame;
     pkt->dts  = av_rescale_q(ist->dts, AV_TIME_BASE_Q, ist->st->time_base);
 
-    update_benchmark(NULL);
+    update_benchmark(&ist->dec_time, NULL);
     ret = avcodec_decode_video2(ist->st->codec,
                                 decoded_frame, got_output, pkt);
-    update_benchmark("decode_video %d.%d", ist->file_index, ist->st->index);
+    update_benchmark(&ist->dec_time, "decode_video %d.%d", ist->file_index, ist->st->index);
     if (!*got_output || ret < 0) {
         if (!pkt->size) {
             for (i = 0; i < ist->nb_filters; i++)
@@ -1596,6 +2172,7 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output)
         }
         return ret;
     }
+    ist->frames_decoded++;
 
     if(ist->top_field_first>=0)
         decoded_frame->top_field_first = ist->top_field_first;
@@ -1637,8 +2214,14 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output)
         ist->resample_pix_fmt = decoded_frame->format;
 
         for (i = 0; i < nb_filtergraphs; i++) {
-            if (ist_in_filtergraph(filtergraphs[i], ist) && ist->reinit_filters &&
-                configure_filtergraph(filtergraphs[i]) < 0) {
+            if (!ist_in_filtergraph(filtergraphs[i], ist) || !ist->reinit_filters)
+                continue;
+            if (ist_rescaled_in_filtergraph(filtergraphs[i], ist, decoded_frame->format)) {
+                av_log(NULL, AV_LOG_VERBOSE, "Rescaling the new frames without "
+                       "reinitializing filtergraph %d\n", i);
+                continue;
+            }
+            if (configure_filtergraph(filtergraphs[i]) < 0) {
                 av_log(NULL, AV_LOG_FATAL, "Error reinitializing filters!\n");
                 exit(1);
             }
@@ -1647,35 +2230,16 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output)
 
     frame_sample_aspect= av_opt_ptr(avcodec_get_frame_class(), decoded_frame, "sample_aspect_ratio");
     for (i = 0; i < ist->nb_filters; i++) {
-        int changed =      ist->st->codec->width   != ist->filters[i]->filter->outputs[0]->w
-                        || ist->st->codec->height  != ist->filters[i]->filter->outputs[0]->h
-                        || ist->st->codec->pix_fmt != ist->filters[i]->filter->outputs[0]->format;
-
+        FilterGraph *fg = ist->filters[i]->graph;
         if (!frame_sample_aspect->num)
             *frame_sample_aspect = ist->st->sample_aspect_ratio;
-        if (ist->dr1 && decoded_frame->type==FF_BUFFER_TYPE_USER && !changed) {
-            FrameBuffer      *buf = decoded_frame->opaque;
-            AVFilterBufferRef *fb = avfilter_get_video_buffer_ref_from_arrays(
-                                        decoded_frame->data, decoded_frame->linesize,
-                                        AV_PERM_READ | AV_PERM_PRESERVE,
-                                        ist->st->codec->width, ist->st->codec->height,
-                                        ist->st->codec->pix_fmt);
-
-            avfilter_copy_frame_props(fb, decoded_frame);
-            fb->buf->priv           = buf;
-            fb->buf->free           = filter_release_buffer;
-
-            av_assert0(buf->refcount>0);
-            buf->refcount++;
-            av_buffersrc_add_ref(ist->filters[i]->filter, fb,
-                                 AV_BUFFERSRC_FLAG_NO_CHECK_FORMAT |
-                                 AV_BUFFERSRC_FLAG_NO_COPY |
-                                 AV_BUFFERSRC_FLAG_PUSH);
-        } else
+        /* reference counted frames are passed on without copying */
+        update_benchmark(&fg->filter_time, NULL);
         if(av_buffersrc_add_frame(ist->filters[i]->filter, decoded_frame, AV_BUFFERSRC_FLAG_PUSH)<0) {
             av_log(NULL, AV_LOG_FATAL, "Failed to inject frame into filter network\n");
             exit(1);
         }
+        update_benchmark(&fg->filter_time, "filter_video %d", fg->index);
 
     }
 
@@ -1731,7 +2295,7 @@ static int transcode_subtitles(InputStream *ist, AVPacket *pkt, int *got_output)
 }
 
 /* pkt = NULL means EOF (needed to flush decoder buffers) */
-static int output_packet(InputStream *ist, const AVPacket *pkt)
+static int output_packet(InputStream *ist, AVPacket *pkt)
 {
     int ret = 0, i;
     int got_output;
@@ -1913,6 +2477,20 @@ static int init_input_stream(int ist_index, char *error, int error_len)
             return ret;
         }
         assert_avoptions(ist->opts);
+
+        /* when the decoder only wants keyframes and the stream is not copied,
+         * drop the other packets as early as possible, in the demuxer if it
+         * supports it */
+        if (ist->st->codec->skip_frame >= AVDISCARD_NONKEY) {
+            int i, copied = 0;
+            for (i = 0; i < nb_output_streams; i++)
+                copied |= output_streams[i]->source_index == ist_index &&
+                          output_streams[i]->stream_copy;
+            if (!copied) {
+                ist->skip_nonkey = 1;
+                ist->st->discard = AVDISCARD_NONKEY;
+            }
+        }
     }
 
     ist->next_pts = AV_NOPTS_VALUE;
@@ -1975,6 +2553,37 @@ static void report_new_stream(int input_index, AVPacket *pkt)
     file->nb_streams_warn = pkt->stream_index + 1;
 }
 
+/* print the buffering added by each stage, for -lowdelay */
+static void print_latency(void)
+{
+    int i;
+
+    av_log(NULL, AV_LOG_INFO, "Latency:\n");
+    for (i = 0; i < nb_input_streams; i++) {
+        InputStream *ist = input_streams[i];
+        AVCodecContext *dec = ist->st->codec;
+
+        if (!ist->decoding_needed)
+            continue;
+        av_log(NULL, AV_LOG_INFO, "  Stream #%d:%d decoder: %d reorder frames, %d threading frames\n",
+               ist->file_index, ist->st->index, dec->has_b_frames,
+               dec->active_thread_type & FF_THREAD_FRAME ? dec->thread_count - 1 : 0);
+    }
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        AVCodecContext *enc = ost->st->codec;
+
+        if (!ost->encoding_needed)
+            continue;
+        av_log(NULL, AV_LOG_INFO, "  Stream #%d:%d encoder: %d %s\n",
+               ost->file_index, ost->index, enc->delay,
+               enc->codec_type == AVMEDIA_TYPE_AUDIO ? "samples" : "frames");
+    }
+    for (i = 0; i < nb_output_files; i++)
+        av_log(NULL, AV_LOG_INFO, "  Output #%d muxer: %d ms max delay\n",
+               i, output_files[i]->ctx->max_delay / 1000);
+}
+
 static int transcode_init(void)
 {
     int ret = 0, i, j, k;
@@ -1990,7 +2599,7 @@ static int transcode_init(void)
         InputFile *ifile = input_files[i];
         if (ifile->rate_emu)
             for (j = 0; j < ifile->nb_streams; j++)
-                input_streams[j + ifile->ist_index]->start = av_gettime();
+                input_streams[j + ifile->ist_index]->start = av_gettime_relative();
     }
 
     /* output stream init */
@@ -2322,6 +2931,19 @@ static int transcode_init(void)
         if ((ret = init_input_stream(i, error, sizeof(error))) < 0)
             goto dump_format;
 
+    /* stream copied outputs that are the only user of their input stream
+     * can take over the demuxed packet data instead of duplicating it */
+    for (i = 0; i < nb_output_streams; i++) {
+        ost = output_streams[i];
+        if (!ost->stream_copy || ost->bitstream_filters || ost->attachment_filename ||
+            input_streams[ost->source_index]->decoding_needed)
+            continue;
+        ost->copy_passthrough = 1;
+        for (j = 0; j < nb_output_streams; j++)
+            if (j != i && output_streams[j]->source_index == ost->source_index)
+                ost->copy_passthrough = 0;
+    }
+
     /* discard unused programs */
     for (i = 0; i < nb_input_files; i++) {
         InputFile *ifile = input_files[i];
@@ -2429,6 +3051,9 @@ static int transcode_init(void)
         print_sdp();
     }
 
+    if (low_delay)
+        print_latency();
+
     return 0;
 }
 
@@ -2443,7 +3068,7 @@ static int need_output(void)
         AVFormatContext *os  = output_files[ost->file_index]->ctx;
 
         if (ost->finished ||
-            (os->pb && avio_tell(os->pb) >= of->limit_filesize))
+            (os->pb && get_output_size(of) >= of->limit_filesize))
             continue;
         if (ost->frame_number >= ost->max_frames) {
             int j;
@@ -2471,7 +3096,7 @@ static OutputStream *choose_output(void)
 
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream *ost = output_streams[i];
-        int64_t opts = av_rescale_q(ost->st->cur_dts, ost->st->time_base,
+        int64_t opts = av_rescale_q(get_output_cur_dts(ost), ost->st->time_base,
                                     AV_TIME_BASE_Q);
         if (!ost->unavailable && !ost->finished && opts < opts_min) {
             opts_min = opts;
@@ -2575,6 +3200,17 @@ static int check_keyboard_interaction(int64_t cur_time)
 }
 
 #if HAVE_PTHREADS
+/* number of packets queued by each input thread */
+#define INPUT_QUEUE_SIZE 8
+
+static void signal_input(void)
+{
+    pthread_mutex_lock(&input_lock);
+    input_seq++;
+    pthread_cond_signal(&input_cond);
+    pthread_mutex_unlock(&input_lock);
+}
+
 static void *input_thread(void *arg)
 {
     InputFile *f = arg;
@@ -2591,17 +3227,27 @@ static void *input_thread(void *arg)
         } else if (ret < 0)
             break;
 
-        pthread_mutex_lock(&f->fifo_lock);
-        while (!av_fifo_space(f->fifo))
-            pthread_cond_wait(&f->fifo_cond, &f->fifo_lock);
-
         av_dup_packet(&pkt);
-        av_fifo_generic_write(f->fifo, &pkt, sizeof(pkt), NULL);
-
-        pthread_mutex_unlock(&f->fifo_lock);
+        while ((ret = av_spsc_queue_write(f->queue, &pkt)) < 0) {
+            pthread_mutex_lock(&f->fifo_lock);
+            /* the queue space must be checked again after setting the
+             * flag, the main thread checks the flag after reading */
+            f->writer_waiting = 1;
+            if (!av_spsc_queue_space(f->queue) && !transcoding_finished)
+                pthread_cond_wait(&f->fifo_cond, &f->fifo_lock);
+            f->writer_waiting = 0;
+            pthread_mutex_unlock(&f->fifo_lock);
+            if (transcoding_finished)
+                break;
+        }
+        if (ret < 0)
+            av_free_packet(&pkt);
+        else
+            signal_input();
     }
 
     f->finished = 1;
+    signal_input();
     return NULL;
 }
 
@@ -2618,25 +3264,19 @@ static void free_input_threads(void)
         InputFile *f = input_files[i];
         AVPacket pkt;
 
-        if (!f->fifo || f->joined)
+        if (!f->queue || f->joined)
             continue;
 
         pthread_mutex_lock(&f->fifo_lock);
-        while (av_fifo_size(f->fifo)) {
-            av_fifo_generic_read(f->fifo, &pkt, sizeof(pkt), NULL);
-            av_free_packet(&pkt);
-        }
         pthread_cond_signal(&f->fifo_cond);
         pthread_mutex_unlock(&f->fifo_lock);
 
         pthread_join(f->thread, NULL);
         f->joined = 1;
 
-        while (av_fifo_size(f->fifo)) {
-            av_fifo_generic_read(f->fifo, &pkt, sizeof(pkt), NULL);
+        while (av_spsc_queue_read(f->queue, &pkt) >= 0)
             av_free_packet(&pkt);
-        }
-        av_fifo_free(f->fifo);
+        av_spsc_queue_free(&f->queue);
     }
 }
 
@@ -2650,7 +3290,7 @@ static int init_input_threads(void)
     for (i = 0; i < nb_input_files; i++) {
         InputFile *f = input_files[i];
 
-        if (!(f->fifo = av_fifo_alloc(8*sizeof(AVPacket))))
+        if (!(f->queue = av_spsc_queue_alloc(INPUT_QUEUE_SIZE, sizeof(AVPacket))))
             return AVERROR(ENOMEM);
 
         pthread_mutex_init(&f->fifo_lock, NULL);
@@ -2664,23 +3304,23 @@ static int init_input_threads(void)
 
 static int get_input_packet_mt(InputFile *f, AVPacket *pkt)
 {
-    int ret = 0;
+    /* read before the queue, so that no packet queued before the thread
+     * finished is missed */
+    int finished = f->finished;
 
-    pthread_mutex_lock(&f->fifo_lock);
+    if (av_spsc_queue_read(f->queue, pkt) < 0)
+        return finished ? AVERROR_EOF : AVERROR(EAGAIN);
 
-    if (av_fifo_size(f->fifo)) {
-        av_fifo_generic_read(f->fifo, pkt, sizeof(*pkt), NULL);
+    /* wake up a waiting thread only once half of the queue is free, so that
+     * it can queue several packets in a row */
+    if (f->writer_waiting &&
+        av_spsc_queue_space(f->queue) >= INPUT_QUEUE_SIZE / 2) {
+        pthread_mutex_lock(&f->fifo_lock);
         pthread_cond_signal(&f->fifo_cond);
-    } else {
-        if (f->finished)
-            ret = AVERROR_EOF;
-        else
-            ret = AVERROR(EAGAIN);
+        pthread_mutex_unlock(&f->fifo_lock);
     }
 
-    pthread_mutex_unlock(&f->fifo_lock);
-
-    return ret;
+    return 0;
 }
 #endif
 
@@ -2693,6 +3333,29 @@ static int get_input_packet(InputFile *f, AVPacket *pkt)
     return av_read_frame(f->ctx, pkt);
 }
 
+/**
+ * Wait a little before retrying when no input had data for any output.
+ * With input threads, return as soon as one of them queued a packet.
+ */
+static void wait_for_input(void)
+{
+#if HAVE_PTHREADS
+    if (nb_input_files > 1) {
+        int64_t t = av_gettime() + 10000;
+        struct timespec tv = { .tv_sec  =  t / 1000000,
+                               .tv_nsec = (t % 1000000) * 1000 };
+
+        pthread_mutex_lock(&input_lock);
+        if (input_seq == input_seq_seen)
+            pthread_cond_timedwait(&input_cond, &input_lock, &tv);
+        input_seq_seen = input_seq;
+        pthread_mutex_unlock(&input_lock);
+        return;
+    }
+#endif
+    av_usleep(10000);
+}
+
 static int got_eagain(void)
 {
     int i;
@@ -2775,6 +3438,9 @@ static int process_input(int file_index)
     ist = input_streams[ifile->ist_index + pkt.stream_index];
     if (ist->discard)
         goto discard_packet;
+    if (ist->skip_nonkey && !(pkt.flags & AV_PKT_FLAG_KEY))
+        goto discard_packet;
+    ist->nb_packets++;
 
     if (debug_ts) {
         av_log(NULL, AV_LOG_INFO, "demuxer -> ist_index:%d type:%s "
@@ -2912,7 +3578,9 @@ static int transcode_from_filter(FilterGraph *graph, InputStream **best_ist)
     InputStream *ist;
 
     *best_ist = NULL;
+    update_benchmark(&graph->filter_time, NULL);
     ret = avfilter_graph_request_oldest(graph->graph);
+    update_benchmark(&graph->filter_time, "filter_request %d", graph->index);
     if (ret >= 0)
         return reap_filters();
 
@@ -2960,7 +3628,7 @@ static int transcode_step(void)
     if (!ost) {
         if (got_eagain()) {
             reset_eagain();
-            av_usleep(10000);
+            wait_for_input();
             return 0;
         }
         av_log(NULL, AV_LOG_VERBOSE, "No more inputs to read from, finishing.\n");
@@ -3013,6 +3681,10 @@ static int transcode(void)
 #if HAVE_PTHREADS
     if ((ret = init_input_threads()) < 0)
         goto fail;
+    if ((ret = init_encoder_threads()) < 0)
+        goto fail;
+    if ((ret = init_mux_threads()) < 0)
+        goto fail;
 #endif
 
     while (!received_sigterm) {
@@ -3043,6 +3715,7 @@ static int transcode(void)
     }
 #if HAVE_PTHREADS
     free_input_threads();
+    free_encoder_threads();
 #endif
 
     /* at the end of stream, we must flush the decoder buffers */
@@ -3053,6 +3726,9 @@ static int transcode(void)
         }
     }
     flush_encoders();
+#if HAVE_PTHREADS
+    free_mux_threads(1);
+#endif
 
     term_exit();
 
@@ -3088,6 +3764,8 @@ static int transcode(void)
  fail:
 #if HAVE_PTHREADS
     free_input_threads();
+    free_encoder_threads();
+    free_mux_threads(0);
 #endif
 
     if (output_streams) {
@@ -3128,6 +3806,28 @@ static int64_t getutime(void)
 #endif
 }
 
+static void print_benchmark_stages(void)
+{
+    int i;
+
+    for (i = 0; i < nb_input_streams; i++) {
+        InputStream *ist = input_streams[i];
+        if (ist->decoding_needed)
+            printf("bench: decode %d.%d utime=%0.3fs\n", ist->file_index,
+                   ist->st->index, ist->dec_time / 1000000.0);
+    }
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        if (ost->encoding_needed)
+            printf("bench: encode %d.%d utime=%0.3fs frames=%d\n",
+                   ost->file_index, ost->index, ost->enc_time / 1000000.0,
+                   ost->frame_number);
+    }
+    for (i = 0; i < nb_filtergraphs; i++)
+        printf("bench: filter %d utime=%0.3fs\n", i,
+               filtergraphs[i]->filter_time / 1000000.0);
+}
+
 static int64_t getmaxrss(void)
 {
 #if HAVE_GETRUSAGE && HAVE_STRUCT_RUSAGE_RU_MAXRSS
@@ -3209,6 +3909,7 @@ int main(int argc, char **argv)
     ti = getutime() - ti;
     if (do_benchmark) {
         int maxrss = getmaxrss() / 1024;
+        print_benchmark_stages();
         printf("bench: utime=%0.3fs maxrss=%ikB\n", ti / 1000000.0, maxrss);
     }
 
@@ -42,6 +42,7 @@
 #include "libavutil/avutil.h"
 #include "libavutil/dict.h"
 #include "libavutil/fifo.h"
+#include "libavutil/spscqueue.h"
 #include "libavutil/pixfmt.h"
 #include "libavutil/rational.h"
 
@@ -117,6 +118,8 @@ typedef struct OptionsContext {
     float mux_preload;
     float mux_max_delay;
     int shortest;
+    int mux_queue_size;
+    const char *mux_queue_policy;
 
     int video_disable;
     int audio_disable;
@@ -195,6 +198,7 @@ typedef struct FilterGraph {
     const char    *graph_desc;
 
     AVFilterGraph *graph;
+    int64_t filter_time;     ///< time spent filtering, with -benchmark or -progress
 
     InputFilter   **inputs;
     int          nb_inputs;
@@ -207,6 +211,11 @@ typedef struct InputStream {
     AVStream *st;
     int discard;             /* true if stream data should be discarded */
     int decoding_needed;     /* true if the packets must be decoded in 'raw_fifo' */
+    int64_t dec_time;        ///< time spent decoding, with -benchmark or -progress
+    uint64_t nb_packets;     ///< number of packets read for this stream
+    uint64_t frames_decoded; ///< number of frames output by the decoder
+    uint64_t report_frames_decoded; ///< frames_decoded at the previous progress report
+    int skip_nonkey;         /* true if only the keyframes are decoded and nothing copies the stream */
     AVCodec *dec;
     AVFrame *decoded_frame;
 
@@ -278,11 +287,12 @@ typedef struct InputFile {
 
 #if HAVE_PTHREADS
     pthread_t thread;           /* thread reading from this file */
-    int finished;               /* the thread has exited */
+    volatile int finished;      /* the thread has exited */
     int joined;                 /* the thread has been joined */
-    pthread_mutex_t fifo_lock;  /* lock for access to fifo */
-    pthread_cond_t  fifo_cond;  /* the main thread will signal on this cond after reading from fifo */
-    AVFifoBuffer *fifo;         /* demuxed packets are stored here; freed by the main thread */
+    pthread_mutex_t fifo_lock;  /* lock for waiting on fifo_cond */
+    pthread_cond_t  fifo_cond;  /* the main thread will signal on this cond after reading from a full queue */
+    volatile int writer_waiting; /* the thread waits for space in the queue */
+    AVSPSCQueue *queue;         /* demuxed packets are stored here; freed by the main thread */
 #endif
 } InputFile;
 
@@ -292,7 +302,9 @@ typedef struct OutputStream {
     int source_index;        /* InputStream index */
     AVStream *st;            /* stream in the output file */
     int encoding_needed;     /* true if encoding needed for this stream */
+    int64_t enc_time;        ///< time spent encoding, with -benchmark or -progress
     int frame_number;
+    int report_frame_number; ///< frame_number at the previous progress report
     /* input pts and corresponding output pts
        for A/V sync */
     struct InputStream *sync_ist; /* input stream to sync against */
@@ -339,8 +351,30 @@ typedef struct OutputStream {
     const char *attachment_filename;
     int copy_initial_nonkeyframes;
     int copy_prior_start;
+    int copy_passthrough;                /* the demuxed packet data is passed to the muxer without copying */
 
     int keep_pix_fmt;
+
+    AVFilterBufferRef *filtered_picref; /* buffer the data of filtered_frame belongs to */
+
+#if HAVE_PTHREADS
+    pthread_t enc_thread;                /* thread encoding for this stream, with -parallel_encoding */
+    int enc_thread_started;
+    pthread_mutex_t enc_lock;            /* lock for access to the job below */
+    pthread_cond_t  enc_cond;            /* signaled whenever enc_state changes */
+    int enc_state;                       /* one of the ENC_JOB_* values */
+    int enc_exit;                        /* the thread should exit once idle */
+    AVFrame enc_frame;                   /* frame being encoded */
+    AVFilterBufferRef *enc_picref;       /* holds the data of enc_frame while it is encoded */
+    int64_t enc_sync_opts;               /* sync_opts when the job was submitted */
+    AVPacket enc_pkt;
+    int enc_got_packet;
+    int enc_ret;
+
+    int64_t mux_cur_dts;                 /* dts of the last packet queued for the muxer thread */
+    int64_t mux_pts;                     /* copy of st->pts.val made by the muxer thread */
+    int mux_dropping;                    /* packets are dropped until the next keyframe */
+#endif
 } OutputStream;
 
 typedef struct OutputFile {
@@ -352,6 +386,20 @@ typedef struct OutputFile {
     uint64_t limit_filesize; /* filesize limit expressed in bytes */
 
     int shortest;
+
+    int mux_queue_size;      /* packets buffered for the muxer thread, 0 to mux in the main thread */
+    int mux_queue_drop;      /* drop packets instead of waiting when the queue is full */
+#if HAVE_PTHREADS
+    pthread_t mux_thread;        /* thread writing the packets of this file */
+    int mux_thread_started;
+    pthread_mutex_t mux_lock;    /* lock for access to mux_fifo and the values below */
+    pthread_cond_t  mux_cond;    /* signaled when a packet is queued or dequeued */
+    AVFifoBuffer *mux_fifo;      /* packets waiting to be written */
+    int mux_exit;                /* the thread should exit once the fifo is empty */
+    int mux_error;               /* error returned by av_interleaved_write_frame() */
+    int64_t mux_size;            /* bytes written so far */
+    int mux_dropped;             /* number of dropped packets */
+#endif
 } OutputFile;
 
 extern InputStream **input_streams;
@@ -386,8 +434,12 @@ extern int copy_tb;
 extern int debug_ts;
 extern int exit_on_error;
 extern int print_stats;
+extern int64_t stats_period;
 extern int qp_hist;
 extern int stdin_interaction;
+extern int filter_nbthreads;
+extern int parallel_encoding;
+extern int low_delay;
 extern int frame_bits_per_raw_sample;
 extern AVIOContext *progress_avio;
 
@@ -413,6 +465,13 @@ void choose_sample_fmt(AVStream *st, AVCodec *codec);
 int configure_filtergraph(FilterGraph *fg);
 int configure_output_filter(FilterGraph *fg, OutputFilter *ofilter, AVFilterInOut *out);
 int ist_in_filtergraph(FilterGraph *fg, InputStream *ist);
+/**
+ * Check whether all inputs of fg fed by ist go straight into a scale
+ * filter, which adapts itself to frames of a new size or pixel format, so
+ * that the graph does not need to be rebuilt when the input changes.
+ */
+int ist_rescaled_in_filtergraph(FilterGraph *fg, InputStream *ist,
+                                enum AVPixelFormat pix_fmt);
 FilterGraph *init_simple_filtergraph(InputStream *ist, OutputStream *ost);
 
 int ffmpeg_parse_options(int argc, char **argv);
@@ -34,6 +34,8 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/samplefmt.h"
 
+#include "libswscale/swscale.h"
+
 enum AVPixelFormat choose_pixel_fmt(AVStream *st, AVCodec *codec, enum AVPixelFormat target)
 {
     if (codec && codec->pix_fmts) {
@@ -718,6 +720,7 @@ int configure_filtergraph(FilterGraph *fg)
     avfilter_graph_free(&fg->graph);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    av_opt_set_int(fg->graph, "threads", filter_nbthreads, 0);
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
@@ -788,3 +791,27 @@ int ist_in_filtergraph(FilterGraph *fg, InputStream *ist)
     return 0;
 }
 
+int ist_rescaled_in_filtergraph(FilterGraph *fg, InputStream *ist,
+                                enum AVPixelFormat pix_fmt)
+{
+    int i;
+
+    if (!fg->graph || !sws_isSupportedInput(pix_fmt))
+        return 0;
+
+    for (i = 0; i < fg->nb_inputs; i++) {
+        AVFilterContext *f;
+
+        if (fg->inputs[i]->ist != ist)
+            continue;
+
+        f = fg->inputs[i]->filter->outputs[0]->dst;
+        /* setpts does not look at the frame size or format */
+        if (ist->framerate.num && !strcmp(f->filter->name, "setpts"))
+            f = f->outputs[0]->dst;
+        if (strcmp(f->filter->name, "scale"))
+            return 0;
+    }
+    return 1;
+}
+
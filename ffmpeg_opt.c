@@ -82,8 +82,12 @@ int copy_tb           = -1;
 int debug_ts          = 0;
 int exit_on_error     = 0;
 int print_stats       = 1;
+int64_t stats_period  = 500000;
 int qp_hist           = 0;
 int stdin_interaction = 1;
+int filter_nbthreads  = 0;
+int parallel_encoding = 0;
+int low_delay         = 0;
 int frame_bits_per_raw_sample = 0;
 
 
@@ -144,7 +148,7 @@ static void init_options(OptionsContext *o, int is_input)
                 " consider fixing your command line.\n");
     } else
     o->recording_time = INT64_MAX;
-    o->mux_max_delay  = 0.7;
+    o->mux_max_delay  = low_delay ? 0 : 0.7;
     o->limit_filesize = UINT64_MAX;
     o->chapters_input_file = INT_MAX;
 }
@@ -584,6 +588,8 @@ static void add_input_streams(OptionsContext *o, AVFormatContext *ic)
         }
 
         ist->dec = choose_decoder(o, ic, st);
+        if (low_delay)
+            dec->flags |= CODEC_FLAG_LOW_DELAY;
         ist->opts = filter_codec_opts(o->g->codec_opts, ist->st->codec->codec_id, ic, st, ist->dec);
 
         ist->reinit_filters = -1;
@@ -771,6 +777,10 @@ static int open_input_file(OptionsContext *o, const char *filename)
     ic->subtitle_codec_id= subtitle_codec_name ?
         find_codec_or_die(subtitle_codec_name, AVMEDIA_TYPE_SUBTITLE, 0)->id : AV_CODEC_ID_NONE;
     ic->flags |= AVFMT_FLAG_NONBLOCK;
+    if (low_delay) {
+        ic->flags |= AVFMT_FLAG_NOBUFFER;
+        ic->max_analyze_duration = AV_TIME_BASE / 2;
+    }
     ic->interrupt_callback = int_cb;
 
     /* open the input file with generic avformat function */
@@ -1674,6 +1684,19 @@ loop_end:
     output_files[nb_output_files - 1]->start_time     = o->start_time;
     output_files[nb_output_files - 1]->limit_filesize = o->limit_filesize;
     output_files[nb_output_files - 1]->shortest       = o->shortest;
+    if (o->mux_queue_size < 0 || o->mux_queue_size > INT_MAX / sizeof(AVPacket)) {
+        av_log(NULL, AV_LOG_FATAL, "Invalid muxer queue size: %d.\n", o->mux_queue_size);
+        exit(1);
+    }
+    output_files[nb_output_files - 1]->mux_queue_size = o->mux_queue_size;
+    if (o->mux_queue_policy) {
+        if (!strcmp(o->mux_queue_policy, "drop"))
+            output_files[nb_output_files - 1]->mux_queue_drop = 1;
+        else if (strcmp(o->mux_queue_policy, "block")) {
+            av_log(NULL, AV_LOG_FATAL, "Invalid muxer queue policy: %s.\n", o->mux_queue_policy);
+            exit(1);
+        }
+    }
     av_dict_copy(&output_files[nb_output_files - 1]->opts, o->g->format_opts, 0);
 
     /* check filename in case of an image number is expected */
@@ -2466,8 +2489,18 @@ const OptionDef options[] = {
         "reinit filtergraph on input parameter changes", "" },
     { "filter_complex", HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_filter_complex },
         "create a complex filtergraph", "graph_description" },
+    { "filter_threads", HAS_ARG | OPT_INT | OPT_EXPERT,              { &filter_nbthreads },
+        "number of threads used by each filtergraph (0 for auto)", "number" },
+#if HAVE_PTHREADS
+    { "lowdelay",       OPT_BOOL | OPT_EXPERT,                       { &low_delay },
+        "minimize buffering in demuxers, decoders and muxers" },
+    { "parallel_encoding", OPT_BOOL | OPT_EXPERT,                    { &parallel_encoding },
+        "encode each output stream in its own thread" },
+#endif
     { "stats",          OPT_BOOL,                                    { &print_stats },
         "print progress report during encoding", },
+    { "stats_period",   HAS_ARG | OPT_TIME | OPT_EXPERT,             { &stats_period },
+        "set the period at which progress reports are printed", "time" },
     { "attach",         HAS_ARG | OPT_PERFILE | OPT_EXPERT,          { .func_arg = opt_attach },
         "add an attachment to the output file", "filename" },
     { "dump_attachment", HAS_ARG | OPT_STRING | OPT_SPEC |OPT_EXPERT,{ .off = OFFSET(dump_attachment) },
@@ -2604,6 +2637,12 @@ const OptionDef options[] = {
         "set the maximum demux-decode delay", "seconds" },
     { "muxpreload", OPT_FLOAT | HAS_ARG | OPT_EXPERT | OPT_OFFSET, { .off = OFFSET(mux_preload) },
         "set the initial demux-decode delay", "seconds" },
+#if HAVE_PTHREADS
+    { "mux_queue_size",   OPT_INT | HAS_ARG | OPT_EXPERT | OPT_OFFSET, { .off = OFFSET(mux_queue_size) },
+        "write the packets from a separate thread, buffering up to this many packets", "packets" },
+    { "mux_queue_policy", OPT_STRING | HAS_ARG | OPT_EXPERT | OPT_OFFSET, { .off = OFFSET(mux_queue_policy) },
+        "what to do when the muxer queue is full (block or drop)", "policy" },
+#endif
 
     { "bsf", HAS_ARG | OPT_STRING | OPT_SPEC | OPT_EXPERT, { .off = OFFSET(bitstream_filters) },
         "A comma-separated list of bitstream filters", "bitstream_filters" },
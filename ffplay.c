@@ -124,6 +124,7 @@ typedef struct VideoPicture {
 
 #if CONFIG_AVFILTER
     AVFilterBufferRef *picref;
+    int uploaded;           // picref has been copied into bmp
 #endif
 } VideoPicture;
 
@@ -251,7 +252,6 @@ typedef struct VideoState {
 #if CONFIG_AVFILTER
     AVFilterContext *in_video_filter;   // the first filter in the video chain
     AVFilterContext *out_video_filter;  // the last filter in the video chain
-    int use_dr1;
     FrameBuffer *buffer_pool;
 #endif
 
@@ -769,6 +769,61 @@ static void calculate_display_rect(SDL_Rect *rect, int scr_xleft, int scr_ytop,
     rect->h = FFMAX(height, 1);
 }
 
+static void duplicate_right_border_pixels(SDL_Overlay *bmp) {
+    int i, width, height;
+    Uint8 *p, *maxp;
+    for (i = 0; i < 3; i++) {
+        width  = bmp->w;
+        height = bmp->h;
+        if (i > 0) {
+            width  >>= 1;
+            height >>= 1;
+        }
+        if (bmp->pitches[i] > width) {
+            maxp = bmp->pixels[i] + bmp->pitches[i] * height - 1;
+            for (p = bmp->pixels[i] + width - 1; p < maxp; p += bmp->pitches[i])
+                *(p+1) = *p;
+        }
+    }
+}
+
+#if CONFIG_AVFILTER
+/* Copy the filtered picture into the overlay. This is only done once a
+ * picture is about to be displayed, so that pictures dropped for being
+ * late cost nothing but their decoding. */
+static void upload_picture(VideoPicture *vp)
+{
+    AVFilterBufferRef *picref = vp->picref;
+    AVPicture src, pict = { { 0 } };
+    int i;
+
+    if (vp->uploaded || !picref)
+        return;
+
+    for (i = 0; i < 4; i++) {
+        src.data[i]     = picref->data[i];
+        src.linesize[i] = picref->linesize[i];
+    }
+
+    SDL_LockYUVOverlay (vp->bmp);
+
+    pict.data[0] = vp->bmp->pixels[0];
+    pict.data[1] = vp->bmp->pixels[2];
+    pict.data[2] = vp->bmp->pixels[1];
+
+    pict.linesize[0] = vp->bmp->pitches[0];
+    pict.linesize[1] = vp->bmp->pitches[2];
+    pict.linesize[2] = vp->bmp->pitches[1];
+
+    av_picture_copy(&pict, &src, picref->format, vp->width, vp->height);
+    /* workaround SDL PITCH_WORKAROUND */
+    duplicate_right_border_pixels(vp->bmp);
+
+    SDL_UnlockYUVOverlay(vp->bmp);
+    vp->uploaded = 1;
+}
+#endif
+
 static void video_image_display(VideoState *is)
 {
     VideoPicture *vp;
@@ -779,6 +834,9 @@ static void video_image_display(VideoState *is)
 
     vp = &is->pictq[is->pictq_rindex];
     if (vp->bmp) {
+#if CONFIG_AVFILTER
+        upload_picture(vp);
+#endif
         if (is->subtitle_st) {
             if (is->subpq_size > 0) {
                 sp = &is->subpq[is->subpq_rindex];
@@ -1478,24 +1536,6 @@ static void alloc_picture(VideoState *is)
     SDL_UnlockMutex(is->pictq_mutex);
 }
 
-static void duplicate_right_border_pixels(SDL_Overlay *bmp) {
-    int i, width, height;
-    Uint8 *p, *maxp;
-    for (i = 0; i < 3; i++) {
-        width  = bmp->w;
-        height = bmp->h;
-        if (i > 0) {
-            width  >>= 1;
-            height >>= 1;
-        }
-        if (bmp->pitches[i] > width) {
-            maxp = bmp->pixels[i] + bmp->pitches[i] * height - 1;
-            for (p = bmp->pixels[i] + width - 1; p < maxp; p += bmp->pitches[i])
-                *(p+1) = *p;
-        }
-    }
-}
-
 static int queue_picture(VideoState *is, AVFrame *src_frame, double pts1, int64_t pos, int serial)
 {
     VideoPicture *vp;
@@ -1578,11 +1618,14 @@ static int queue_picture(VideoState *is, AVFrame *src_frame, double pts1, int64_
 
     /* if the frame is not skipped, then display it */
     if (vp->bmp) {
-        AVPicture pict = { { 0 } };
 #if CONFIG_AVFILTER
+        /* the copy into the overlay is done by the main thread when the
+         * picture gets displayed */
         avfilter_unref_bufferp(&vp->picref);
-        vp->picref = src_frame->opaque;
-#endif
+        vp->picref   = src_frame->opaque;
+        vp->uploaded = 0;
+#else
+        AVPicture pict = { { 0 } };
 
         /* get a pointer on the bitmap */
         SDL_LockYUVOverlay (vp->bmp);
@@ -1595,11 +1638,6 @@ static int queue_picture(VideoState *is, AVFrame *src_frame, double pts1, int64_
         pict.linesize[1] = vp->bmp->pitches[2];
         pict.linesize[2] = vp->bmp->pitches[1];
 
-#if CONFIG_AVFILTER
-        // FIXME use direct rendering
-        av_picture_copy(&pict, (AVPicture *)src_frame,
-                        src_frame->format, vp->width, vp->height);
-#else
         av_opt_get_int(sws_opts, "sws_flags", 0, &sws_flags);
         is->img_convert_ctx = sws_getCachedContext(is->img_convert_ctx,
             vp->width, vp->height, src_frame->format, vp->width, vp->height,
@@ -1610,11 +1648,11 @@ static int queue_picture(VideoState *is, AVFrame *src_frame, double pts1, int64_
         }
         sws_scale(is->img_convert_ctx, src_frame->data, src_frame->linesize,
                   0, vp->height, pict.data, pict.linesize);
-#endif
         /* workaround SDL PITCH_WORKAROUND */
         duplicate_right_border_pixels(vp->bmp);
         /* update the bitmap content */
         SDL_UnlockYUVOverlay(vp->bmp);
+#endif
 
         vp->pts = pts;
         vp->pos = pos;
@@ -1815,7 +1853,6 @@ static int video_thread(void *arg)
     enum AVPixelFormat last_format = -2;
 
     if (codec->codec->capabilities & CODEC_CAP_DR1) {
-        is->use_dr1 = 1;
         codec->get_buffer     = codec_get_buffer;
         codec->release_buffer = codec_release_buffer;
         codec->opaque         = &is->buffer_pool;
@@ -1865,23 +1902,7 @@ static int video_thread(void *arg)
 
         frame->pts = pts_int;
         frame->sample_aspect_ratio = av_guess_sample_aspect_ratio(is->ic, is->video_st, frame);
-        if (is->use_dr1 && frame->opaque) {
-            FrameBuffer      *buf = frame->opaque;
-            AVFilterBufferRef *fb = avfilter_get_video_buffer_ref_from_arrays(
-                                        frame->data, frame->linesize,
-                                        AV_PERM_READ | AV_PERM_PRESERVE,
-                                        frame->width, frame->height,
-                                        frame->format);
-
-            avfilter_copy_frame_props(fb, frame);
-            fb->buf->priv           = buf;
-            fb->buf->free           = filter_release_buffer;
-
-            buf->refcount++;
-            av_buffersrc_add_ref(filt_in, fb, AV_BUFFERSRC_FLAG_NO_COPY);
-
-        } else
-            av_buffersrc_write_frame(filt_in, frame);
+        av_buffersrc_write_frame(filt_in, frame);
 
         av_free_packet(&pkt);
 
@@ -59,6 +59,7 @@ static int do_show_packets = 0;
 static int do_show_streams = 0;
 static int do_show_stream_disposition = 0;
 static int do_show_data    = 0;
+static int do_show_packet_pict_type = 0;
 static int do_show_program_version  = 0;
 static int do_show_library_versions = 0;
 
@@ -1419,7 +1420,8 @@ static inline void show_tags(WriterContext *wctx, AVDictionary *tags, int sectio
     writer_print_section_footer(wctx);
 }
 
-static void show_packet(WriterContext *w, AVFormatContext *fmt_ctx, AVPacket *pkt, int packet_idx)
+static void show_packet(WriterContext *w, AVFormatContext *fmt_ctx, AVPacket *pkt, int packet_idx,
+                        AVCodecParserContext *parser)
 {
     char val_str[128];
     AVStream *st = fmt_ctx->streams[pkt->stream_index];
@@ -1446,12 +1448,19 @@ static void show_packet(WriterContext *w, AVFormatContext *fmt_ctx, AVPacket *pk
     if (pkt->pos != -1) print_fmt    ("pos", "%"PRId64, pkt->pos);
     else                print_str_opt("pos", "N/A");
     print_fmt("flags", "%c",      pkt->flags & AV_PKT_FLAG_KEY ? 'K' : '_');
+    if (parser) {
+        uint8_t *out;
+        int out_size;
+
+        av_parser_parse2(parser, st->codec, &out, &out_size,
+                         pkt->data, pkt->size, pkt->pts, pkt->dts, pkt->pos);
+        print_fmt("pict_type", "%c", av_get_picture_type_char(parser->pict_type));
+    }
     if (do_show_data)
         writer_print_data(w, "data", pkt->data, pkt->size);
     writer_print_section_footer(w);
 
     av_bprint_finalize(&pbuf, NULL);
-    fflush(stdout);
 }
 
 static void show_frame(WriterContext *w, AVFrame *frame, AVStream *stream,
@@ -1523,7 +1532,6 @@ static void show_frame(WriterContext *w, AVFrame *frame, AVStream *stream,
     writer_print_section_footer(w);
 
     av_bprint_finalize(&pbuf, NULL);
-    fflush(stdout);
 }
 
 static av_always_inline int process_frame(WriterContext *w,
@@ -1563,15 +1571,30 @@ static void read_packets(WriterContext *w, AVFormatContext *fmt_ctx)
 {
     AVPacket pkt, pkt1;
     AVFrame frame;
+    AVCodecParserContext **parsers = NULL;
     int i = 0;
 
+    if (do_show_packets && do_show_packet_pict_type) {
+        parsers = av_calloc(fmt_ctx->nb_streams, sizeof(*parsers));
+        for (i = 0; parsers && i < fmt_ctx->nb_streams; i++) {
+            AVStream *st = fmt_ctx->streams[i];
+            if (!selected_streams[i] || st->codec->codec_type != AVMEDIA_TYPE_VIDEO)
+                continue;
+            parsers[i] = av_parser_init(st->codec->codec_id);
+            if (parsers[i])
+                parsers[i]->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+        }
+        i = 0;
+    }
+
     av_init_packet(&pkt);
 
     while (!av_read_frame(fmt_ctx, &pkt)) {
         if (selected_streams[pkt.stream_index]) {
             if (do_read_packets) {
                 if (do_show_packets)
-                    show_packet(w, fmt_ctx, &pkt, i++);
+                    show_packet(w, fmt_ctx, &pkt, i++,
+                                parsers ? parsers[pkt.stream_index] : NULL);
                 nb_streams_packets[pkt.stream_index]++;
             }
             if (do_read_frames) {
@@ -1590,6 +1613,13 @@ static void read_packets(WriterContext *w, AVFormatContext *fmt_ctx)
         if (do_read_frames)
             while (process_frame(w, fmt_ctx, &frame, &pkt) > 0);
     }
+
+    if (parsers) {
+        for (i = 0; i < fmt_ctx->nb_streams; i++)
+            if (parsers[i])
+                av_parser_close(parsers[i]);
+        av_free(parsers);
+    }
 }
 
 static void show_stream(WriterContext *w, AVFormatContext *fmt_ctx, int stream_idx)
@@ -2176,6 +2206,8 @@ static const OptionDef real_options[] = {
     { "select_streams", OPT_STRING | HAS_ARG, {(void*)&stream_specifier}, "select the specified streams", "stream_specifier" },
     { "sections", OPT_EXIT, {.func_arg = opt_sections}, "print sections structure and section information, and exit" },
     { "show_data",    OPT_BOOL, {(void*)&do_show_data}, "show packets data" },
+    { "show_packet_pict_type", OPT_BOOL, {(void*)&do_show_packet_pict_type},
+      "show the picture type of video packets, as found by the codec parser" },
     { "show_error",   0, {(void*)&opt_show_error},  "show probing error" },
     { "show_format",  0, {(void*)&opt_show_format}, "show format/container info" },
     { "show_frames",  0, {(void*)&opt_show_frames}, "show frames info" },
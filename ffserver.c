@@ -59,6 +59,9 @@
 #if HAVE_POLL_H
 #include <poll.h>
 #endif
+#if HAVE_EPOLL_CREATE
+#include <sys/epoll.h>
+#endif
 #include <errno.h>
 #include <time.h>
 #include <sys/wait.h>
@@ -131,6 +134,8 @@ typedef struct HTTPContext {
     int fd; /* socket file descriptor */
     struct sockaddr_in from_addr; /* origin */
     struct pollfd *poll_entry; /* used when polling */
+    struct pollfd poll_fd; /* poll_entry storage for the epoll backend */
+    int poll_events; /* events registered with epoll, 0 if none */
     int64_t timeout;
     uint8_t *buffer_ptr, *buffer_end;
     int http_error;
@@ -188,6 +193,10 @@ typedef struct HTTPContext {
     /* RTP/TCP specific */
     struct HTTPContext *rtsp_c;
     uint8_t *packet_buffer, *packet_buffer_ptr, *packet_buffer_end;
+
+    /* shared output specific */
+    struct SharedMux *shared;
+    int64_t shared_pos; /* position of buffer_end in the shared output, -1 before joining */
 } HTTPContext;
 
 /* each generated stream is described here */
@@ -258,8 +267,27 @@ typedef struct FFStream {
     int64_t feed_write_index;   /* current write position in feed (it wraps around) */
     int64_t feed_size;          /* current size of feed */
     struct FFStream *next_feed;
+
+    /* shared output */
+    int shared_mux_size;        /* size of the shared output buffer, 0 to mux for each client */
+    struct SharedMux *shared;
 } FFStream;
 
+/* Output of a live stream muxed once and sent to all its HTTP clients,
+   so that the muxing cost does not grow with the number of viewers. */
+typedef struct SharedMux {
+    AVFormatContext *fmt_in;    /* reader of the feed */
+    AVFormatContext fmt_ctx;    /* muxer */
+    int got_key_frame;
+    uint8_t *header;            /* output of avformat_write_header() */
+    int header_size;
+    uint8_t *buffer;            /* ring buffer of the muxed packets */
+    int buffer_size;
+    int64_t write_pos;          /* number of bytes muxed so far */
+    int64_t key_pos;            /* position of the last key frame, -1 if none */
+    int nb_clients;
+} SharedMux;
+
 typedef struct FeedData {
     long long data_count;
     float avg_frame_size;   /* frame size averaged over last frames with exponential mean */
@@ -282,6 +310,10 @@ static int http_parse_request(HTTPContext *c);
 static int http_send_data(HTTPContext *c);
 static void compute_status(HTTPContext *c);
 static int open_input_stream(HTTPContext *c, const char *info);
+static SharedMux *shared_mux_open(FFStream *stream);
+static void shared_mux_close(FFStream *stream);
+static int use_shared_mux(FFStream *stream, const char *info);
+static void close_output_format(AVFormatContext *ctx);
 static int http_start_receive_data(HTTPContext *c);
 static int http_receive_data(HTTPContext *c);
 
@@ -328,6 +360,12 @@ static AVLFG random_state;
 
 static FILE *logfile = NULL;
 
+#if HAVE_EPOLL_CREATE
+/* epoll instance, -1 if the server polls with poll() */
+static int epoll_fd = -1;
+static struct epoll_event *epoll_events;
+#endif
+
 static int64_t ffm_read_write_index(int fd)
 {
     uint8_t buf[8];
@@ -629,11 +667,81 @@ static void start_multicast(void)
     }
 }
 
+/* Wait for events on the connection socket in the next iteration. With
+   poll() the entry is appended to the table, which is rebuilt every time;
+   with epoll the registration is only touched when the events change. */
+static void watch_connection(HTTPContext *c, struct pollfd **poll_entry,
+                             int events)
+{
+#if HAVE_EPOLL_CREATE
+    if (epoll_fd >= 0) {
+        if (c->poll_events != events) {
+            /* EPOLLIN/EPOLLOUT have the values of POLLIN/POLLOUT */
+            struct epoll_event ev = { .events = events,
+                                      .data.ptr = &c->poll_fd };
+            int op = !c->poll_events ? EPOLL_CTL_ADD :
+                     events          ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+            if (epoll_ctl(epoll_fd, op, c->fd, &ev) < 0) {
+                http_log("epoll_ctl failed on fd %d: %s\n", c->fd, strerror(errno));
+                events = 0;
+            }
+            c->poll_events = events;
+        }
+        c->poll_fd.fd      = c->fd;
+        c->poll_fd.events  = events;
+        c->poll_fd.revents = 0;
+        c->poll_entry = events ? &c->poll_fd : NULL;
+        return;
+    }
+#endif
+    if (!events) {
+        c->poll_entry = NULL;
+        return;
+    }
+    c->poll_entry = *poll_entry;
+    (*poll_entry)->fd = c->fd;
+    (*poll_entry)->events = events;
+    (*poll_entry)++;
+}
+
+/* Wait for the events requested by watch_connection() and on the
+   listening sockets at the start of poll_table. */
+static int wait_events(struct pollfd *poll_table, struct pollfd *poll_end,
+                       int nb_listen, int delay)
+{
+    int ret;
+#if HAVE_EPOLL_CREATE
+    if (epoll_fd >= 0) {
+        int i;
+
+        for (i = 0; i < nb_listen; i++)
+            poll_table[i].revents = 0;
+        do {
+            ret = epoll_wait(epoll_fd, epoll_events, nb_max_http_connections + 2, delay);
+            if (ret < 0 && errno != EINTR)
+                return -1;
+        } while (ret < 0);
+        for (i = 0; i < ret; i++) {
+            struct pollfd *p = epoll_events[i].data.ptr;
+            p->revents = epoll_events[i].events;
+        }
+        return 0;
+    }
+#endif
+    do {
+        ret = poll(poll_table, poll_end - poll_table, delay);
+        if (ret < 0 && ff_neterrno() != AVERROR(EAGAIN) &&
+            ff_neterrno() != AVERROR(EINTR))
+            return -1;
+    } while (ret < 0);
+    return 0;
+}
+
 /* main loop of the http server */
 static int http_server(void)
 {
     int server_fd = 0, rtsp_server_fd = 0;
-    int ret, delay, delay1;
+    int delay, delay1, nb_listen;
     struct pollfd *poll_table, *poll_entry;
     HTTPContext *c, *c_next;
 
@@ -659,6 +767,36 @@ static int http_server(void)
         return -1;
     }
 
+    nb_listen = 0;
+    if (server_fd)
+        poll_table[nb_listen++].fd = server_fd;
+    if (rtsp_server_fd)
+        poll_table[nb_listen++].fd = rtsp_server_fd;
+
+#if HAVE_EPOLL_CREATE
+    /* The listening sockets are registered once, connections are
+       registered by watch_connection(). The events are level triggered
+       since the connection state machine does one read or write per
+       wakeup. */
+    epoll_events = av_malloc((nb_max_http_connections + 2) * sizeof(*epoll_events));
+    if (epoll_events)
+        epoll_fd = epoll_create(nb_max_http_connections + 2);
+    if (epoll_fd >= 0) {
+        int i;
+        for (i = 0; i < nb_listen; i++) {
+            struct epoll_event ev = { .events = EPOLLIN,
+                                      .data.ptr = &poll_table[i] };
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, poll_table[i].fd, &ev) < 0) {
+                close(epoll_fd);
+                epoll_fd = -1;
+                break;
+            }
+        }
+    }
+    if (epoll_fd < 0)
+        http_log("epoll unavailable, using poll().\n");
+#endif
+
     http_log("FFserver started.\n");
 
     start_children(first_feed);
@@ -682,26 +820,18 @@ static int http_server(void)
         c = first_http_ctx;
         delay = 1000;
         while (c != NULL) {
-            int fd;
-            fd = c->fd;
             switch(c->state) {
             case HTTPSTATE_SEND_HEADER:
             case RTSPSTATE_SEND_REPLY:
             case RTSPSTATE_SEND_PACKET:
-                c->poll_entry = poll_entry;
-                poll_entry->fd = fd;
-                poll_entry->events = POLLOUT;
-                poll_entry++;
+                watch_connection(c, &poll_entry, POLLOUT);
                 break;
             case HTTPSTATE_SEND_DATA_HEADER:
             case HTTPSTATE_SEND_DATA:
             case HTTPSTATE_SEND_DATA_TRAILER:
                 if (!c->is_packetized) {
                     /* for TCP, we output as much as we can (may need to put a limit) */
-                    c->poll_entry = poll_entry;
-                    poll_entry->fd = fd;
-                    poll_entry->events = POLLOUT;
-                    poll_entry++;
+                    watch_connection(c, &poll_entry, POLLOUT);
                 } else {
                     /* when ffserver is doing the timing, we work by
                        looking at which packet need to be sent every
@@ -709,6 +839,7 @@ static int http_server(void)
                     delay1 = 10; /* one tick wait XXX: 10 ms assumed */
                     if (delay1 < delay)
                         delay = delay1;
+                    watch_connection(c, &poll_entry, 0);
                 }
                 break;
             case HTTPSTATE_WAIT_REQUEST:
@@ -716,13 +847,10 @@ static int http_server(void)
             case HTTPSTATE_WAIT_FEED:
             case RTSPSTATE_WAIT_REQUEST:
                 /* need to catch errors */
-                c->poll_entry = poll_entry;
-                poll_entry->fd = fd;
-                poll_entry->events = POLLIN;/* Maybe this will work */
-                poll_entry++;
+                watch_connection(c, &poll_entry, POLLIN);/* Maybe this will work */
                 break;
             default:
-                c->poll_entry = NULL;
+                watch_connection(c, &poll_entry, 0);
                 break;
             }
             c = c->next;
@@ -730,12 +858,8 @@ static int http_server(void)
 
         /* wait for an event on one connection. We poll at least every
            second to handle timeouts */
-        do {
-            ret = poll(poll_table, poll_entry - poll_table, delay);
-            if (ret < 0 && ff_neterrno() != AVERROR(EAGAIN) &&
-                ff_neterrno() != AVERROR(EINTR))
-                return -1;
-        } while (ret < 0);
+        if (wait_events(poll_table, poll_entry, nb_listen, delay) < 0)
+            return -1;
 
         cur_time = av_gettime() / 1000;
 
@@ -919,10 +1043,10 @@ static void close_connection(HTTPContext *c)
         }
     }
 
-    for(i=0; i<ctx->nb_streams; i++)
-        av_free(ctx->streams[i]);
-    av_freep(&ctx->streams);
-    av_freep(&ctx->priv_data);
+    close_output_format(ctx);
+
+    if (c->shared)
+        shared_mux_close(c->stream);
 
     if (c->stream && !c->post && c->stream->stream_type == STREAM_TYPE_LIVE)
         current_bandwidth -= c->stream->bandwidth;
@@ -1853,7 +1977,14 @@ static int http_parse_request(HTTPContext *c)
         goto send_status;
 
     /* open input stream */
-    if (open_input_stream(c, info) < 0) {
+    if (use_shared_mux(c->stream, info)) {
+        c->shared     = shared_mux_open(c->stream);
+        c->shared_pos = -1;
+        if (!c->shared) {
+            snprintf(msg, sizeof(msg), "Input stream corresponding to '%s' not found", url);
+            goto send_error;
+        }
+    } else if (open_input_stream(c, info) < 0) {
         snprintf(msg, sizeof(msg), "Input stream corresponding to '%s' not found", url);
         goto send_error;
     }
@@ -2254,71 +2385,294 @@ static int64_t get_packet_send_clock(HTTPContext *c)
 }
 
 
-static int http_prepare_data(HTTPContext *c)
+/* Set up the muxer of stream in ctx and write the header. Return the size
+   of the header, which is stored in *header, or a negative value. */
+static int open_output_format(AVFormatContext *ctx, FFStream *stream,
+                              uint8_t **header)
 {
-    int i, len, ret;
-    AVFormatContext *ctx;
+    int i;
 
-    av_freep(&c->pb_buffer);
-    switch(c->state) {
-    case HTTPSTATE_SEND_DATA_HEADER:
-        memset(&c->fmt_ctx, 0, sizeof(c->fmt_ctx));
-        av_dict_set(&c->fmt_ctx.metadata, "author"   , c->stream->author   , 0);
-        av_dict_set(&c->fmt_ctx.metadata, "comment"  , c->stream->comment  , 0);
-        av_dict_set(&c->fmt_ctx.metadata, "copyright", c->stream->copyright, 0);
-        av_dict_set(&c->fmt_ctx.metadata, "title"    , c->stream->title    , 0);
-
-        c->fmt_ctx.streams = av_mallocz(sizeof(AVStream *) * c->stream->nb_streams);
-
-        for(i=0;i<c->stream->nb_streams;i++) {
-            AVStream *src;
-            c->fmt_ctx.streams[i] = av_mallocz(sizeof(AVStream));
-            /* if file or feed, then just take streams from FFStream struct */
-            if (!c->stream->feed ||
-                c->stream->feed == c->stream)
-                src = c->stream->streams[i];
-            else
-                src = c->stream->feed->streams[c->stream->feed_streams[i]];
-
-            *(c->fmt_ctx.streams[i]) = *src;
-            c->fmt_ctx.streams[i]->priv_data = 0;
-            c->fmt_ctx.streams[i]->codec->frame_number = 0; /* XXX: should be done in
-                                           AVStream, not in codec */
+    memset(ctx, 0, sizeof(*ctx));
+    av_dict_set(&ctx->metadata, "author"   , stream->author   , 0);
+    av_dict_set(&ctx->metadata, "comment"  , stream->comment  , 0);
+    av_dict_set(&ctx->metadata, "copyright", stream->copyright, 0);
+    av_dict_set(&ctx->metadata, "title"    , stream->title    , 0);
+
+    ctx->streams = av_mallocz(sizeof(AVStream *) * stream->nb_streams);
+
+    for(i=0;i<stream->nb_streams;i++) {
+        AVStream *src;
+        ctx->streams[i] = av_mallocz(sizeof(AVStream));
+        /* if file or feed, then just take streams from FFStream struct */
+        if (!stream->feed ||
+            stream->feed == stream)
+            src = stream->streams[i];
+        else
+            src = stream->feed->streams[stream->feed_streams[i]];
+
+        *(ctx->streams[i]) = *src;
+        ctx->streams[i]->priv_data = 0;
+        ctx->streams[i]->codec->frame_number = 0; /* XXX: should be done in
+                                       AVStream, not in codec */
+    }
+    /* set output format parameters */
+    ctx->oformat = stream->fmt;
+    ctx->nb_streams = stream->nb_streams;
+
+    /* prepare header and save header data in a stream */
+    if (avio_open_dyn_buf(&ctx->pb) < 0) {
+        /* XXX: potential leak */
+        return -1;
+    }
+    ctx->pb->seekable = 0;
+
+    /*
+     * HACK to avoid mpeg ps muxer to spit many underflow errors
+     * Default value from FFmpeg
+     * Try to set it use configuration option
+     */
+    ctx->max_delay = (int)(0.7*AV_TIME_BASE);
+
+    if (avformat_write_header(ctx, NULL) < 0) {
+        http_log("Error writing output header\n");
+        return -1;
+    }
+    av_dict_free(&ctx->metadata);
+
+    return avio_close_dyn_buf(ctx->pb, header);
+}
+
+/* true if the stream can be served from a shared output to a client
+   requesting it with the given info */
+static int use_shared_mux(FFStream *stream, const char *info)
+{
+    char buf[128];
+
+    return stream->shared_mux_size && stream->feed && stream->feed != stream &&
+           !stream->max_time &&
+           !av_find_info_tag(buf, sizeof(buf), "date", info) &&
+           !av_find_info_tag(buf, sizeof(buf), "buffer", info);
+}
+
+static void close_output_format(AVFormatContext *ctx)
+{
+    int i;
+
+    for(i=0; i<ctx->nb_streams; i++)
+        av_free(ctx->streams[i]);
+    av_freep(&ctx->streams);
+    av_freep(&ctx->priv_data);
+}
+
+static void shared_mux_free(SharedMux *sm)
+{
+    if (sm->fmt_in)
+        avformat_close_input(&sm->fmt_in);
+    close_output_format(&sm->fmt_ctx);
+    av_free(sm->header);
+    av_free(sm->buffer);
+    av_free(sm);
+}
+
+/* get a reference to the shared output of a stream, starting it if needed */
+static SharedMux *shared_mux_open(FFStream *stream)
+{
+    SharedMux *sm = stream->shared;
+    AVFormatContext *s = NULL;
+
+    if (sm) {
+        sm->nb_clients++;
+        return sm;
+    }
+
+    sm = av_mallocz(sizeof(*sm));
+    if (!sm)
+        return NULL;
+    sm->key_pos     = -1;
+    sm->buffer_size = stream->shared_mux_size;
+    sm->buffer      = av_malloc(sm->buffer_size);
+    if (!sm->buffer)
+        goto fail;
+
+    if (avformat_open_input(&s, stream->feed->feed_filename, stream->ifmt, &stream->in_opts) < 0) {
+        http_log("could not open %s\n", stream->feed->feed_filename);
+        goto fail;
+    }
+    ffio_set_buf_size(s->pb, FFM_PACKET_SIZE);
+    s->flags |= AVFMT_FLAG_GENPTS;
+    sm->fmt_in = s;
+    if (s->iformat->read_seek)
+        av_seek_frame(s, -1, av_gettime() - stream->prebuffer * (int64_t)1000, 0);
+
+    sm->header_size = open_output_format(&sm->fmt_ctx, stream, &sm->header);
+    if (sm->header_size < 0)
+        goto fail;
+
+    sm->nb_clients = 1;
+    stream->shared = sm;
+    return sm;
+fail:
+    shared_mux_free(sm);
+    return NULL;
+}
+
+/* release a reference to the shared output of a stream */
+static void shared_mux_close(FFStream *stream)
+{
+    SharedMux *sm = stream->shared;
+
+    if (--sm->nb_clients)
+        return;
+    shared_mux_free(sm);
+    stream->shared = NULL;
+}
+
+static void shared_mux_write(SharedMux *sm, const uint8_t *data, int len)
+{
+    int offset = sm->write_pos % sm->buffer_size;
+    int len1   = FFMIN(len, sm->buffer_size - offset);
+
+    memcpy(sm->buffer + offset, data, len1);
+    memcpy(sm->buffer, data + len1, len - len1);
+    sm->write_pos += len;
+}
+
+/* mux the packets available in the feed into the shared output */
+static int shared_mux_read(FFStream *stream)
+{
+    SharedMux *sm = stream->shared;
+    AVFormatContext *ctx = &sm->fmt_ctx;
+    int64_t start_pos = sm->write_pos;
+    AVPacket pkt;
+    uint8_t *data;
+    int i, len, key;
+
+    ffm_set_write_index(sm->fmt_in, stream->feed->feed_write_index,
+                        stream->feed->feed_size);
+
+    /* keep half of the buffer for the clients which are behind */
+    while (sm->write_pos - start_pos < sm->buffer_size / 2 &&
+           av_read_frame(sm->fmt_in, &pkt) >= 0) {
+        AVStream *ist = sm->fmt_in->streams[pkt.stream_index], *ost;
+
+        for(i=0;i<stream->nb_streams;i++)
+            if (stream->feed_streams[i] == pkt.stream_index)
+                break;
+        key = pkt.flags & AV_PKT_FLAG_KEY &&
+              (ist->codec->codec_type == AVMEDIA_TYPE_VIDEO ||
+               stream->nb_streams == 1);
+        if (i < stream->nb_streams && key)
+            sm->got_key_frame = 1;
+        if (i == stream->nb_streams || (stream->send_on_key && !sm->got_key_frame)) {
+            av_free_packet(&pkt);
+            continue;
         }
-        /* set output format parameters */
-        c->fmt_ctx.oformat = c->stream->fmt;
-        c->fmt_ctx.nb_streams = c->stream->nb_streams;
 
-        c->got_key_frame = 0;
+        ost = ctx->streams[i];
+        pkt.stream_index = i;
+        if (pkt.dts != AV_NOPTS_VALUE)
+            pkt.dts = av_rescale_q(pkt.dts, ist->time_base, ost->time_base);
+        if (pkt.pts != AV_NOPTS_VALUE)
+            pkt.pts = av_rescale_q(pkt.pts, ist->time_base, ost->time_base);
+        pkt.duration = av_rescale_q(pkt.duration, ist->time_base, ost->time_base);
 
-        /* prepare header and save header data in a stream */
-        if (avio_open_dyn_buf(&c->fmt_ctx.pb) < 0) {
-            /* XXX: potential leak */
+        if (avio_open_dyn_buf(&ctx->pb) < 0) {
+            av_free_packet(&pkt);
             return -1;
         }
-        c->fmt_ctx.pb->seekable = 0;
+        ctx->pb->seekable = 0;
+        if (av_write_frame(ctx, &pkt) < 0)
+            http_log("Error writing frame to output\n");
+        len = avio_close_dyn_buf(ctx->pb, &data);
+        av_free_packet(&pkt);
+        ost->codec->frame_number++;
 
-        /*
-         * HACK to avoid mpeg ps muxer to spit many underflow errors
-         * Default value from FFmpeg
-         * Try to set it use configuration option
-         */
-        c->fmt_ctx.max_delay = (int)(0.7*AV_TIME_BASE);
+        if (len > sm->buffer_size / 2) {
+            http_log("Packet of %d bytes too large for the shared buffer of %s\n",
+                     len, stream->filename);
+            av_free(data);
+            return -1;
+        }
+        if (key)
+            sm->key_pos = sm->write_pos;
+        shared_mux_write(sm, data, len);
+        av_free(data);
+    }
+    return 0;
+}
+
+/* true if the data a client still has to send was overwritten in the
+   shared output */
+static int shared_mux_overrun(HTTPContext *c)
+{
+    SharedMux *sm = c->shared;
+
+    if (c->shared_pos < 0 ||
+        c->shared_pos - (c->buffer_end - c->buffer_ptr) >= sm->write_pos - sm->buffer_size)
+        return 0;
+    http_log("%s: client too slow for the shared output of %s, disconnecting\n",
+             inet_ntoa(c->from_addr.sin_addr), c->stream->filename);
+    return 1;
+}
+
+/* point the client to the next data of the shared output */
+static int shared_mux_prepare_data(HTTPContext *c)
+{
+    SharedMux *sm = c->shared;
+    int offset, len;
+
+    /* start at the last key frame still in the buffer */
+    if (c->shared_pos < 0)
+        c->shared_pos = sm->key_pos >= sm->write_pos - sm->buffer_size ?
+                        sm->key_pos : sm->write_pos;
 
-        if (avformat_write_header(&c->fmt_ctx, NULL) < 0) {
-            http_log("Error writing output header\n");
+    if (c->shared_pos == sm->write_pos) {
+        if (shared_mux_read(c->stream) < 0)
             return -1;
+        if (c->shared_pos == sm->write_pos) {
+            /* wait for more data from the feed */
+            c->state = HTTPSTATE_WAIT_FEED;
+            return 1; /* state changed */
         }
-        av_dict_free(&c->fmt_ctx.metadata);
+    }
+    if (shared_mux_overrun(c))
+        return -1;
 
-        len = avio_close_dyn_buf(c->fmt_ctx.pb, &c->pb_buffer);
-        c->buffer_ptr = c->pb_buffer;
-        c->buffer_end = c->pb_buffer + len;
+    offset = c->shared_pos % sm->buffer_size;
+    len    = FFMIN(sm->write_pos - c->shared_pos, sm->buffer_size - offset);
+    c->buffer_ptr  = sm->buffer + offset;
+    c->buffer_end  = c->buffer_ptr + len;
+    c->shared_pos += len;
+    return 0;
+}
+
+static int http_prepare_data(HTTPContext *c)
+{
+    int i, len, ret;
+    AVFormatContext *ctx;
+
+    av_freep(&c->pb_buffer);
+    switch(c->state) {
+    case HTTPSTATE_SEND_DATA_HEADER:
+        if (c->shared) {
+            c->buffer_ptr = c->shared->header;
+            c->buffer_end = c->shared->header + c->shared->header_size;
+        } else {
+            c->got_key_frame = 0;
+            len = open_output_format(&c->fmt_ctx, c->stream, &c->pb_buffer);
+            if (len < 0)
+                return -1;
+            c->buffer_ptr = c->pb_buffer;
+            c->buffer_end = c->pb_buffer + len;
+        }
 
         c->state = HTTPSTATE_SEND_DATA;
         c->last_packet_sent = 0;
         break;
     case HTTPSTATE_SEND_DATA:
+        if (c->shared)
+            return shared_mux_prepare_data(c);
+
         /* find a new packet */
         /* read a packet from the input stream */
         if (c->stream->feed)
@@ -2461,7 +2815,7 @@ static int http_prepare_data(HTTPContext *c)
     default:
     case HTTPSTATE_SEND_DATA_TRAILER:
         /* last packet test ? */
-        if (c->last_packet_sent || c->is_packetized)
+        if (c->last_packet_sent || c->is_packetized || c->shared)
             return -1;
         ctx = &c->fmt_ctx;
         /* prepare header */
@@ -2581,6 +2935,8 @@ static int http_send_data(HTTPContext *c)
                 }
             } else {
                 /* TCP data output */
+                if (c->shared && shared_mux_overrun(c))
+                    return -1;
                 len = send(c->fd, c->buffer_ptr, c->buffer_end - c->buffer_ptr, 0);
                 if (len < 0) {
                     if (ff_neterrno() != AVERROR(EAGAIN) &&
@@ -4362,6 +4718,13 @@ static int parse_ffconfig(const char *filename)
         } else if (!av_strcasecmp(cmd, "StartSendOnKey")) {
             if (stream)
                 stream->send_on_key = 1;
+        } else if (!av_strcasecmp(cmd, "SharedMuxBuffer")) {
+            get_arg(arg, sizeof(arg), &p);
+            val = atoi(arg);
+            if (val < 64 || val > 1024 * 1024) {
+                ERROR("Invalid SharedMuxBuffer: %s\n", arg);
+            } else if (stream)
+                stream->shared_mux_size = val * 1024;
         } else if (!av_strcasecmp(cmd, "AudioCodec")) {
             get_arg(arg, sizeof(arg), &p);
             audio_id = opt_audio_codec(arg);
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #define CONFIG_HARDCODED_TABLES 0
 #include "aac_tablegen.h"
+#include "kbdwin.c"
 #include "tableprint.h"
 
 int main(void)
@@ -33,5 +34,12 @@ int main(void)
 
     WRITE_ARRAY("const", float, ff_aac_pow2sf_tab);
 
+    printf("DECLARE_ALIGNED(32, const float, ff_aac_kbd_long_1024)[1024] = {\n");
+    write_float_array(ff_aac_kbd_long_1024, 1024);
+    printf("};\n");
+    printf("DECLARE_ALIGNED(32, const float, ff_aac_kbd_short_128)[128] = {\n");
+    write_float_array(ff_aac_kbd_short_128, 128);
+    printf("};\n");
+
     return 0;
 }
@@ -29,13 +29,18 @@
 #include "libavcodec/aac_tables.h"
 #else
 #include "libavutil/mathematics.h"
+#include "kbdwin.h"
 float ff_aac_pow2sf_tab[428];
+DECLARE_ALIGNED(32, float, ff_aac_kbd_long_1024)[1024];
+DECLARE_ALIGNED(32, float, ff_aac_kbd_short_128)[128];
 
 void ff_aac_tableinit(void)
 {
     int i;
     for (i = 0; i < 428; i++)
         ff_aac_pow2sf_tab[i] = pow(2, (i - POW_SF2_ZERO) / 4.);
+    ff_kbd_window_init(ff_aac_kbd_long_1024, 4.0, 1024);
+    ff_kbd_window_init(ff_aac_kbd_short_128, 6.0, 128);
 }
 #endif /* CONFIG_HARDCODED_TABLES */
 
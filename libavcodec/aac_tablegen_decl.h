@@ -23,14 +23,20 @@
 #ifndef AVCODEC_AAC_TABLEGEN_DECL_H
 #define AVCODEC_AAC_TABLEGEN_DECL_H
 
+#include "libavutil/mem.h"
+
 #define POW_SF2_ZERO    200    ///< ff_aac_pow2sf_tab index corresponding to pow(2, 0);
 
 #if CONFIG_HARDCODED_TABLES
 #define ff_aac_tableinit()
 extern const float ff_aac_pow2sf_tab[428];
+DECLARE_ALIGNED(32, extern const float, ff_aac_kbd_long_1024)[1024];
+DECLARE_ALIGNED(32, extern const float, ff_aac_kbd_short_128)[128];
 #else
 void ff_aac_tableinit(void);
 extern       float ff_aac_pow2sf_tab[428];
+DECLARE_ALIGNED(32, extern float,       ff_aac_kbd_long_1024)[1024];
+DECLARE_ALIGNED(32, extern float,       ff_aac_kbd_short_128)[128];
 #endif /* CONFIG_HARDCODED_TABLES */
 
 #endif /* AVCODEC_AAC_TABLEGEN_DECL_H */
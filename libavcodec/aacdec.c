@@ -88,7 +88,6 @@
 #include "fft.h"
 #include "fmtconvert.h"
 #include "lpc.h"
-#include "kbdwin.h"
 #include "sinewin.h"
 
 #include "aac.h"
@@ -945,8 +944,6 @@ static av_cold int aac_decode_init(AVCodecContext *avctx)
     ff_mdct_init(&ac->mdct_small,  8, 1, 1.0 / (32768.0 * 128.0));
     ff_mdct_init(&ac->mdct_ltp,   11, 0, -2.0 * 32768.0);
     // window initialization
-    ff_kbd_window_init(ff_aac_kbd_long_1024, 4.0, 1024);
-    ff_kbd_window_init(ff_aac_kbd_short_128, 6.0, 128);
     ff_init_ff_sine_windows(10);
     ff_init_ff_sine_windows( 7);
 
@@ -37,7 +37,6 @@
 #include "dsputil.h"
 #include "internal.h"
 #include "mpeg4audio.h"
-#include "kbdwin.h"
 #include "sinewin.h"
 
 #include "aac.h"
@@ -46,7 +45,6 @@
 
 #include "psymodel.h"
 
-#define AAC_MAX_CHANNELS 6
 
 #define ERROR_IF(cond, ...) \
     if (cond) { \
@@ -502,15 +500,128 @@ static void copy_input_samples(AACEncContext *s, const AVFrame *frame)
     }
 }
 
+/**
+ * Return the index of the first channel of channel element el.
+ */
+static int element_start_channel(AACEncContext *s, int el)
+{
+    int i, start_ch = 0;
+
+    for (i = 0; i < el; i++)
+        start_ch += s->chan_map[i+1] == TYPE_CPE ? 2 : 1;
+    return start_ch;
+}
+
+/**
+ * Choose the window sequence and apply the MDCT for the channels of one
+ * channel element. Channel elements are independent, so each one is run
+ * as a separate job.
+ */
+static int aac_encode_element_mdct(AVCodecContext *avctx, void *arg,
+                                   int el, int threadnr)
+{
+    AACEncContext *s = avctx->priv_data;
+    const AVFrame *frame = arg;
+    int start_ch = element_start_channel(s, el);
+    FFPsyWindowInfo *wi = s->windows + start_ch;
+    ChannelElement *cpe = &s->cpe[el];
+    int tag   = s->chan_map[el+1];
+    int chans = tag == TYPE_CPE ? 2 : 1;
+    int ch, w;
+
+    for (ch = 0; ch < chans; ch++) {
+        IndividualChannelStream *ics = &cpe->ch[ch].ics;
+        int cur_channel = start_ch + ch;
+        float *overlap  = &s->planar_samples[cur_channel][0];
+        float *samples2 = overlap + 1024;
+        float *la       = samples2 + (448+64);
+        if (!frame)
+            la = NULL;
+        if (tag == TYPE_LFE) {
+            wi[ch].window_type[0] = ONLY_LONG_SEQUENCE;
+            wi[ch].window_shape   = 0;
+            wi[ch].num_windows    = 1;
+            wi[ch].grouping[0]    = 1;
+
+            /* Only the lowest 12 coefficients are used in a LFE channel.
+             * The expression below results in only the bottom 8 coefficients
+             * being used for 11.025kHz to 16kHz sample rates.
+             */
+            ics->num_swb = s->samplerate_index >= 8 ? 1 : 3;
+        } else {
+            wi[ch] = s->psy.model->window(&s->psy, samples2, la, cur_channel,
+                                          ics->window_sequence[0]);
+        }
+        ics->window_sequence[1] = ics->window_sequence[0];
+        ics->window_sequence[0] = wi[ch].window_type[0];
+        ics->use_kb_window[1]   = ics->use_kb_window[0];
+        ics->use_kb_window[0]   = wi[ch].window_shape;
+        ics->num_windows        = wi[ch].num_windows;
+        ics->swb_sizes          = s->psy.bands    [ics->num_windows == 8];
+        ics->num_swb            = tag == TYPE_LFE ? ics->num_swb : s->psy.num_bands[ics->num_windows == 8];
+        for (w = 0; w < ics->num_windows; w++)
+            ics->group_len[w] = wi[ch].grouping[w];
+
+        apply_window_and_mdct(s, &cpe->ch[ch], overlap);
+    }
+    return 0;
+}
+
+/**
+ * Search the quantizers and the M/S mask for one channel element, once
+ * the psychoacoustic model has analyzed it. Each job uses its own
+ * quantization scratch buffers, from s->thread_ctx.
+ */
+static int aac_encode_element_search(AVCodecContext *avctx, void *arg,
+                                     int el, int threadnr)
+{
+    AACEncContext *s  = avctx->priv_data;
+    AACEncContext *ts = threadnr ? &s->thread_ctx[threadnr - 1] : s;
+    int start_ch = element_start_channel(s, el);
+    FFPsyWindowInfo *wi = s->windows + start_ch;
+    ChannelElement *cpe = &s->cpe[el];
+    int chans = s->chan_map[el+1] == TYPE_CPE ? 2 : 1;
+    int ch, w, g;
+
+    for (ch = 0; ch < chans; ch++) {
+        ts->cur_channel = start_ch + ch;
+        s->coder->search_for_quantizers(avctx, ts, &cpe->ch[ch], s->lambda);
+    }
+    cpe->common_window = 0;
+    if (chans > 1
+        && wi[0].window_type[0] == wi[1].window_type[0]
+        && wi[0].window_shape   == wi[1].window_shape) {
+
+        cpe->common_window = 1;
+        for (w = 0; w < wi[0].num_windows; w++) {
+            if (wi[0].grouping[w] != wi[1].grouping[w]) {
+                cpe->common_window = 0;
+                break;
+            }
+        }
+    }
+    ts->cur_channel = start_ch;
+    if (s->options.stereo_mode && cpe->common_window) {
+        if (s->options.stereo_mode > 0) {
+            IndividualChannelStream *ics = &cpe->ch[0].ics;
+            for (w = 0; w < ics->num_windows; w += ics->group_len[w])
+                for (g = 0;  g < ics->num_swb; g++)
+                    cpe->ms_mask[w*16+g] = 1;
+        } else if (s->coder->search_for_ms) {
+            s->coder->search_for_ms(ts, cpe, s->lambda);
+        }
+    }
+    adjust_frame_information(cpe, chans);
+    return 0;
+}
+
 static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                             const AVFrame *frame, int *got_packet_ptr)
 {
     AACEncContext *s = avctx->priv_data;
-    float **samples = s->planar_samples, *samples2, *la, *overlap;
     ChannelElement *cpe;
-    int i, ch, w, g, chans, tag, start_ch, ret;
+    int i, ch, chans, tag, start_ch, ret;
     int chan_el_counter[4];
-    FFPsyWindowInfo windows[AAC_MAX_CHANNELS];
 
     if (s->last_frame == 2)
         return 0;
@@ -528,49 +639,8 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
     if (!avctx->frame_number)
         return 0;
 
-    start_ch = 0;
-    for (i = 0; i < s->chan_map[0]; i++) {
-        FFPsyWindowInfo* wi = windows + start_ch;
-        tag      = s->chan_map[i+1];
-        chans    = tag == TYPE_CPE ? 2 : 1;
-        cpe      = &s->cpe[i];
-        for (ch = 0; ch < chans; ch++) {
-            IndividualChannelStream *ics = &cpe->ch[ch].ics;
-            int cur_channel = start_ch + ch;
-            overlap  = &samples[cur_channel][0];
-            samples2 = overlap + 1024;
-            la       = samples2 + (448+64);
-            if (!frame)
-                la = NULL;
-            if (tag == TYPE_LFE) {
-                wi[ch].window_type[0] = ONLY_LONG_SEQUENCE;
-                wi[ch].window_shape   = 0;
-                wi[ch].num_windows    = 1;
-                wi[ch].grouping[0]    = 1;
-
-                /* Only the lowest 12 coefficients are used in a LFE channel.
-                 * The expression below results in only the bottom 8 coefficients
-                 * being used for 11.025kHz to 16kHz sample rates.
-                 */
-                ics->num_swb = s->samplerate_index >= 8 ? 1 : 3;
-            } else {
-                wi[ch] = s->psy.model->window(&s->psy, samples2, la, cur_channel,
-                                              ics->window_sequence[0]);
-            }
-            ics->window_sequence[1] = ics->window_sequence[0];
-            ics->window_sequence[0] = wi[ch].window_type[0];
-            ics->use_kb_window[1]   = ics->use_kb_window[0];
-            ics->use_kb_window[0]   = wi[ch].window_shape;
-            ics->num_windows        = wi[ch].num_windows;
-            ics->swb_sizes          = s->psy.bands    [ics->num_windows == 8];
-            ics->num_swb            = tag == TYPE_LFE ? ics->num_swb : s->psy.num_bands[ics->num_windows == 8];
-            for (w = 0; w < ics->num_windows; w++)
-                ics->group_len[w] = wi[ch].grouping[w];
-
-            apply_window_and_mdct(s, &cpe->ch[ch], overlap);
-        }
-        start_ch += chans;
-    }
+    avctx->execute2(avctx, aac_encode_element_mdct, (void *)frame, NULL,
+                    s->chan_map[0]);
     if ((ret = ff_alloc_packet2(avctx, avpkt, 8192 * s->channels))) {
         av_log(avctx, AV_LOG_ERROR, "Error getting output packet\n");
         return ret;
@@ -583,47 +653,26 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
         if ((avctx->frame_number & 0xFF)==1 && !(avctx->flags & CODEC_FLAG_BITEXACT))
             put_bitstream_info(s, LIBAVCODEC_IDENT);
         start_ch = 0;
-        memset(chan_el_counter, 0, sizeof(chan_el_counter));
         for (i = 0; i < s->chan_map[0]; i++) {
-            FFPsyWindowInfo* wi = windows + start_ch;
             const float *coeffs[2];
+            chans = s->chan_map[i+1] == TYPE_CPE ? 2 : 1;
+            for (ch = 0; ch < chans; ch++)
+                coeffs[ch] = s->cpe[i].ch[ch].coeffs;
+            s->psy.model->analyze(&s->psy, start_ch, coeffs, s->windows + start_ch);
+            start_ch += chans;
+        }
+
+        avctx->execute2(avctx, aac_encode_element_search, NULL, NULL,
+                        s->chan_map[0]);
+
+        start_ch = 0;
+        memset(chan_el_counter, 0, sizeof(chan_el_counter));
+        for (i = 0; i < s->chan_map[0]; i++) {
             tag      = s->chan_map[i+1];
             chans    = tag == TYPE_CPE ? 2 : 1;
             cpe      = &s->cpe[i];
             put_bits(&s->pb, 3, tag);
             put_bits(&s->pb, 4, chan_el_counter[tag]++);
-            for (ch = 0; ch < chans; ch++)
-                coeffs[ch] = cpe->ch[ch].coeffs;
-            s->psy.model->analyze(&s->psy, start_ch, coeffs, wi);
-            for (ch = 0; ch < chans; ch++) {
-                s->cur_channel = start_ch * 2 + ch;
-                s->coder->search_for_quantizers(avctx, s, &cpe->ch[ch], s->lambda);
-            }
-            cpe->common_window = 0;
-            if (chans > 1
-                && wi[0].window_type[0] == wi[1].window_type[0]
-                && wi[0].window_shape   == wi[1].window_shape) {
-
-                cpe->common_window = 1;
-                for (w = 0; w < wi[0].num_windows; w++) {
-                    if (wi[0].grouping[w] != wi[1].grouping[w]) {
-                        cpe->common_window = 0;
-                        break;
-                    }
-                }
-            }
-            s->cur_channel = start_ch * 2;
-            if (s->options.stereo_mode && cpe->common_window) {
-                if (s->options.stereo_mode > 0) {
-                    IndividualChannelStream *ics = &cpe->ch[0].ics;
-                    for (w = 0; w < ics->num_windows; w += ics->group_len[w])
-                        for (g = 0;  g < ics->num_swb; g++)
-                            cpe->ms_mask[w*16+g] = 1;
-                } else if (s->coder->search_for_ms) {
-                    s->coder->search_for_ms(s, cpe, s->lambda);
-                }
-            }
-            adjust_frame_information(cpe, chans);
             if (chans == 2) {
                 put_bits(&s->pb, 1, cpe->common_window);
                 if (cpe->common_window) {
@@ -681,6 +730,7 @@ static av_cold int aac_encode_end(AVCodecContext *avctx)
         ff_psy_preprocess_end(s->psypp);
     av_freep(&s->buffer.samples);
     av_freep(&s->cpe);
+    av_freep(&s->thread_ctx);
     ff_af_queue_close(&s->afq);
 #if FF_API_OLD_ENCODE_AUDIO
     av_freep(&avctx->coded_frame);
@@ -696,8 +746,6 @@ static av_cold int dsp_init(AVCodecContext *avctx, AACEncContext *s)
     avpriv_float_dsp_init(&s->fdsp, avctx->flags & CODEC_FLAG_BITEXACT);
 
     // window init
-    ff_kbd_window_init(ff_aac_kbd_long_1024, 4.0, 1024);
-    ff_kbd_window_init(ff_aac_kbd_short_128, 6.0, 128);
     ff_init_ff_sine_windows(10);
     ff_init_ff_sine_windows(7);
 
@@ -777,6 +825,7 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
         goto fail;
     s->psypp = ff_psy_preprocess_init(avctx);
     s->coder = &ff_aac_coders[s->options.aac_coder];
+    ff_aac_coder_init(s);
 
     s->lambda = avctx->global_quality ? avctx->global_quality : 120;
 
@@ -788,6 +837,18 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
     avctx->delay = 1024;
     ff_af_queue_init(avctx, &s->afq);
 
+    /* The quantizer search of the channel elements runs in parallel, each
+     * thread needs its own copy of the context for the scratch buffers. */
+    if (avctx->active_thread_type & FF_THREAD_SLICE && avctx->thread_count > 1) {
+        s->thread_ctx = av_malloc((avctx->thread_count - 1) * sizeof(*s->thread_ctx));
+        if (!s->thread_ctx) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        for (i = 0; i < avctx->thread_count - 1; i++)
+            memcpy(&s->thread_ctx[i], s, sizeof(*s));
+    }
+
     return 0;
 fail:
     aac_encode_end(avctx);
@@ -800,7 +861,11 @@ static const AVOption aacenc_options[] = {
         {"auto",     "Selected by the Encoder", 0, AV_OPT_TYPE_CONST, {.i64 = -1 }, INT_MIN, INT_MAX, AACENC_FLAGS, "stereo_mode"},
         {"ms_off",   "Disable Mid/Side coding", 0, AV_OPT_TYPE_CONST, {.i64 =  0 }, INT_MIN, INT_MAX, AACENC_FLAGS, "stereo_mode"},
         {"ms_force", "Force Mid/Side for the whole frame if possible", 0, AV_OPT_TYPE_CONST, {.i64 =  1 }, INT_MIN, INT_MAX, AACENC_FLAGS, "stereo_mode"},
-    {"aac_coder", "", offsetof(AACEncContext, options.aac_coder), AV_OPT_TYPE_INT, {.i64 = 2}, 0, AAC_CODER_NB-1, AACENC_FLAGS},
+    {"aac_coder", "Coding algorithm", offsetof(AACEncContext, options.aac_coder), AV_OPT_TYPE_INT, {.i64 = 2}, 0, AAC_CODER_NB-1, AACENC_FLAGS, "aac_coder"},
+        {"faac",     "FAAC-inspired method",      0, AV_OPT_TYPE_CONST, {.i64 = 0 }, INT_MIN, INT_MAX, AACENC_FLAGS, "aac_coder"},
+        {"anmr",     "ANMR method",               0, AV_OPT_TYPE_CONST, {.i64 = 1 }, INT_MIN, INT_MAX, AACENC_FLAGS, "aac_coder"},
+        {"twoloop",  "Two loop searching method", 0, AV_OPT_TYPE_CONST, {.i64 = 2 }, INT_MIN, INT_MAX, AACENC_FLAGS, "aac_coder"},
+        {"fast",     "Constant quantizer",        0, AV_OPT_TYPE_CONST, {.i64 = 3 }, INT_MIN, INT_MAX, AACENC_FLAGS, "aac_coder"},
     {NULL}
 };
 
@@ -828,6 +893,7 @@ AVCodec ff_aac_encoder = {
     .close          = aac_encode_end,
     .supported_samplerates = mpeg4audio_sample_rates,
     .capabilities   = CODEC_CAP_SMALL_LAST_FRAME | CODEC_CAP_DELAY |
+                      CODEC_CAP_SLICE_THREADS |
                       CODEC_CAP_EXPERIMENTAL,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_FLTP,
                                                      AV_SAMPLE_FMT_NONE },
@@ -33,6 +33,8 @@
 
 #define AAC_CODER_NB 4
 
+#define AAC_MAX_CHANNELS 6
+
 typedef struct AACEncOptions {
     int stereo_mode;
     int aac_coder;
@@ -79,12 +81,31 @@ typedef struct AACEncContext {
     AudioFrameQueue afq;
     DECLARE_ALIGNED(16, int,   qcoefs)[96];      ///< quantized coefficients
     DECLARE_ALIGNED(32, float, scoefs)[1024];    ///< scaled coefficients
+    FFPsyWindowInfo windows[AAC_MAX_CHANNELS];   ///< window info for the current frame
+    struct AACEncContext *thread_ctx;            ///< copies of the context for the quantizer search in threads 1 and up
 
     struct {
         float *samples;
     } buffer;
+
+    /**
+     * Calculate |in[i]|^(3/4) for size coefficients.
+     * size is a multiple of 4.
+     */
+    void (*abs_pow34)(float *out, const float *in, const int size);
+
+    /**
+     * Quantize size scaled coefficients with the quantizer Q34 and clip them
+     * to maxval, taking the sign from in if is_signed is set.
+     * size is a multiple of 4.
+     */
+    void (*quant_bands)(int *out, const float *in, const float *scaled,
+                        int size, float Q34, int is_signed, int maxval);
 } AACEncContext;
 
 extern float ff_aac_pow34sf_tab[428];
 
+void ff_aac_coder_init(AACEncContext *s);
+void ff_aac_coder_init_x86(AACEncContext *s);
+
 #endif /* AVCODEC_AACENC_H */
@@ -41,12 +41,8 @@
  * encoder.
  */
 
-/* @name window coefficients
- * @{
- */
-DECLARE_ALIGNED(32, extern float,  ff_aac_kbd_long_1024)[1024];
-DECLARE_ALIGNED(32, extern float,  ff_aac_kbd_short_128)[128];
-// @}
+/* The KBD window coefficients ff_aac_kbd_long_1024 and
+ * ff_aac_kbd_short_128 are declared in aac_tablegen_decl.h. */
 
 /* @name number of scalefactor window bands for long and short transform windows respectively
  * @{
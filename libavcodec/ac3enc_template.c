@@ -37,7 +37,7 @@ static void apply_window(void *dsp, SampleType *output,
                          const SampleType *input, const SampleType *window,
                          unsigned int len);
 
-static int normalize_samples(AC3EncodeContext *s);
+static int normalize_samples(AC3EncodeContext *s, SampleType *samples);
 
 static void clip_coefficients(DSPContext *dsp, CoefType *coef, unsigned int len);
 
@@ -51,7 +51,7 @@ int AC3_NAME(allocate_sample_buffers)(AC3EncodeContext *s)
 {
     int ch;
 
-    FF_ALLOC_OR_GOTO(s->avctx, s->windowed_samples, AC3_WINDOW_SIZE *
+    FF_ALLOC_OR_GOTO(s->avctx, s->windowed_samples, s->channels * AC3_WINDOW_SIZE *
                      sizeof(*s->windowed_samples), alloc_fail);
     FF_ALLOC_OR_GOTO(s->avctx, s->planar_samples, s->channels * sizeof(*s->planar_samples),
                      alloc_fail);
@@ -90,34 +90,43 @@ static void copy_input_samples(AC3EncodeContext *s, SampleType **samples)
 
 
 /*
- * Apply the MDCT to input samples to generate frequency coefficients.
- * This applies the KBD window and normalizes the input to reduce precision
- * loss due to fixed-point calculations.
+ * Apply the MDCT to the input samples of one channel to generate frequency
+ * coefficients. This applies the KBD window and normalizes the input to
+ * reduce precision loss due to fixed-point calculations.
+ * Channels are independent, so they are run as separate jobs.
  */
-static void apply_mdct(AC3EncodeContext *s)
+static int apply_mdct_channel(AVCodecContext *avctx, void *arg, int ch, int threadnr)
 {
-    int blk, ch;
+    AC3EncodeContext *s = avctx->priv_data;
+    SampleType *windowed_samples = s->windowed_samples + ch * AC3_WINDOW_SIZE;
+    int blk;
 
-    for (ch = 0; ch < s->channels; ch++) {
-        for (blk = 0; blk < s->num_blocks; blk++) {
-            AC3Block *block = &s->blocks[blk];
-            const SampleType *input_samples = &s->planar_samples[ch][blk * AC3_BLOCK_SIZE];
+    for (blk = 0; blk < s->num_blocks; blk++) {
+        AC3Block *block = &s->blocks[blk];
+        const SampleType *input_samples = &s->planar_samples[ch][blk * AC3_BLOCK_SIZE];
 
 #if CONFIG_AC3ENC_FLOAT
-            apply_window(&s->fdsp, s->windowed_samples, input_samples,
-                         s->mdct_window, AC3_WINDOW_SIZE);
+        apply_window(&s->fdsp, windowed_samples, input_samples,
+                     s->mdct_window, AC3_WINDOW_SIZE);
 #else
-            apply_window(&s->dsp, s->windowed_samples, input_samples,
-                         s->mdct_window, AC3_WINDOW_SIZE);
+        apply_window(&s->dsp, windowed_samples, input_samples,
+                     s->mdct_window, AC3_WINDOW_SIZE);
 #endif
 
-            if (s->fixed_point)
-                block->coeff_shift[ch+1] = normalize_samples(s);
+        if (s->fixed_point)
+            block->coeff_shift[ch+1] = normalize_samples(s, windowed_samples);
 
-            s->mdct.mdct_calcw(&s->mdct, block->mdct_coef[ch+1],
-                               s->windowed_samples);
-        }
+        s->mdct.mdct_calcw(&s->mdct, block->mdct_coef[ch+1],
+                           windowed_samples);
     }
+    return 0;
+}
+
+
+static void apply_mdct(AC3EncodeContext *s)
+{
+    s->avctx->execute2(s->avctx, apply_mdct_channel, NULL, NULL, s->channels);
+    emms_c();
 }
 
 
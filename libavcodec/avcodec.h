@@ -29,6 +29,7 @@
 #include <errno.h>
 #include "libavutil/samplefmt.h"
 #include "libavutil/avutil.h"
+#include "libavutil/buffer.h"
 #include "libavutil/cpu.h"
 #include "libavutil/channel_layout.h"
 #include "libavutil/dict.h"
@@ -1487,6 +1488,24 @@ typedef struct AVFrame {
      */
     int pkt_size;
 
+    /**
+     * Reference counted buffers backing the data planes.
+     * If buf[0] is set, every data[] plane points into one of the non-NULL
+     * buf[] entries; the array is filled contiguously. A frame without buf[0]
+     * is not reference counted.
+     * For hardware accelerated pixel formats the data[] entries are surface
+     * handles rather than plane pointers, and buf[0] holds the surface.
+     * The references belong to whoever allocated the frame and remain valid
+     * until release_buffer() is called on it; to keep the data alive past
+     * that point, take new references with av_buffer_ref(). While such
+     * references exist the buffer is not reused for another frame.
+     * Code outside libavcodec should access this field using:
+     * av_frame_get_plane_buffer(frame, plane)
+     * - encoding: unused
+     * - decoding: set by get_buffer(), read by user.
+     */
+    AVBufferRef *buf[AV_NUM_DATA_POINTERS];
+
     /* ffdshow custom code (begin) */
     int h264_poc_decoded;
     int h264_poc_outputed;
@@ -1518,6 +1537,7 @@ int     av_frame_get_decode_error_flags   (const AVFrame *frame);
 void    av_frame_set_decode_error_flags   (AVFrame *frame, int     val);
 int     av_frame_get_pkt_size(const AVFrame *frame);
 void    av_frame_set_pkt_size(AVFrame *frame, int val);
+AVBufferRef *av_frame_get_plane_buffer(const AVFrame *frame, int plane);
 
 struct AVCodecInternal;
 
@@ -3187,6 +3207,16 @@ typedef struct AVCodecContext {
      * - encoding: unused
      */
     AVDictionary *metadata;
+
+    /**
+     * Run slice threading jobs on a thread pool shared by all codec
+     * contexts of the process which set this, instead of starting
+     * thread_count threads. thread_count then limits the number of
+     * threads running jobs of this context at the same time.
+     * - encoding: Set by user.
+     * - decoding: Set by user.
+     */
+    int shared_threads;
 } AVCodecContext;
 
 AVRational av_codec_get_pkt_timebase         (const AVCodecContext *avctx);
@@ -3300,6 +3330,16 @@ typedef struct AVCodec {
      * Will be called when seeking
      */
     void (*flush)(AVCodecContext *);
+    /**
+     * Internal codec capabilities.
+     * See FF_CODEC_CAP_* in internal.h
+     */
+    int caps_internal;
+    /**
+     * Next codec in the same codec id / name hash bucket, in
+     * registration order. Used by avcodec_find_*().
+     */
+    struct AVCodec *next_by_id, *next_by_name;
 } AVCodec;
 
 /**
@@ -3787,6 +3827,10 @@ int av_dup_packet(AVPacket *pkt);
 /**
  * Copy packet, including contents
  *
+ * If src owns its data, the data is not duplicated but shared by reference
+ * between src and dst, and freed with the last of them. Neither of them may
+ * then be modified in place.
+ *
  * @return 0 on success, negative AVERROR on fail
  */
 int av_copy_packet(AVPacket *dst, AVPacket *src);
@@ -22,6 +22,7 @@
 #include <string.h>
 
 #include "libavutil/avassert.h"
+#include "libavutil/buffer.h"
 #include "libavutil/mem.h"
 #include "avcodec.h"
 #include "bytestream.h"
@@ -45,6 +46,32 @@ void av_destruct_packet(AVPacket *pkt)
     ff_packet_free_side_data(pkt);
 }
 
+static void destruct_buffer_packet(AVPacket *pkt)
+{
+    AVBufferRef *buf = pkt->priv;
+
+    av_buffer_unref(&buf);
+    pkt->data = NULL;
+    pkt->size = 0;
+
+    ff_packet_free_side_data(pkt);
+}
+
+int avpriv_packet_from_buffer(AVPacket *pkt, AVBufferRef *buf, uint8_t *data, int size)
+{
+    AVBufferRef *ref = av_buffer_ref(buf);
+
+    if (!ref)
+        return AVERROR(ENOMEM);
+
+    av_init_packet(pkt);
+    pkt->data     = data;
+    pkt->size     = size;
+    pkt->priv     = ref;
+    pkt->destruct = destruct_buffer_packet;
+    return 0;
+}
+
 void av_init_packet(AVPacket *pkt)
 {
     pkt->pts                  = AV_NOPTS_VALUE;
@@ -95,10 +122,25 @@ int av_grow_packet(AVPacket *pkt, int grow_by)
     if ((unsigned)grow_by >
         INT_MAX - (pkt->size + FF_INPUT_BUFFER_PADDING_SIZE))
         return -1;
-    new_ptr = av_realloc(pkt->data,
-                         pkt->size + grow_by + FF_INPUT_BUFFER_PADDING_SIZE);
-    if (!new_ptr)
-        return AVERROR(ENOMEM);
+    if (pkt->destruct == av_destruct_packet) {
+        new_ptr = av_realloc(pkt->data,
+                             pkt->size + grow_by + FF_INPUT_BUFFER_PADDING_SIZE);
+        if (!new_ptr)
+            return AVERROR(ENOMEM);
+    } else {
+        /* the data is not owned by av_malloc(), e.g. it is memory mapped */
+        AVPacket tmp = *pkt;
+        new_ptr = av_malloc(pkt->size + grow_by + FF_INPUT_BUFFER_PADDING_SIZE);
+        if (!new_ptr)
+            return AVERROR(ENOMEM);
+        memcpy(new_ptr, pkt->data, pkt->size);
+        tmp.side_data       = NULL;
+        tmp.side_data_elems = 0;
+        if (tmp.destruct)
+            tmp.destruct(&tmp);
+        pkt->destruct = av_destruct_packet;
+        pkt->priv     = NULL;
+    }
     pkt->data  = new_ptr;
     pkt->size += grow_by;
     memset(pkt->data + pkt->size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
@@ -125,13 +167,45 @@ int av_grow_packet(AVPacket *pkt, int grow_by)
         dst = data;                                                     \
     } while (0)
 
-/* Makes duplicates of data, side_data, but does not copy any other fields */
+/**
+ * Make dst share the data of src: a packet owning av_malloc()ed data is
+ * turned into a reference counted one, which does not change its content,
+ * and dst takes a new reference.
+ */
+static int ref_packet_data(AVPacket *dst, AVPacket *src)
+{
+    if (src->destruct == av_destruct_packet) {
+        AVBufferRef *buf = av_buffer_create(src->data,
+                                            src->size + FF_INPUT_BUFFER_PADDING_SIZE,
+                                            av_buffer_default_free, NULL, 0);
+        if (!buf)
+            return AVERROR(ENOMEM);
+        src->priv     = buf;
+        src->destruct = destruct_buffer_packet;
+    }
+
+    dst->priv = av_buffer_ref(src->priv);
+    if (!dst->priv)
+        return AVERROR(ENOMEM);
+    dst->data     = src->data;
+    dst->destruct = destruct_buffer_packet;
+    return 0;
+}
+
+/* Makes duplicates of data, side_data, but does not copy any other fields.
+ * The data of owned packets is shared by reference instead of duplicated. */
 static int copy_packet_data(AVPacket *dst, AVPacket *src)
 {
     dst->data      = NULL;
     dst->side_data = NULL;
-    DUP_DATA(dst->data, src->data, dst->size, 1);
-    dst->destruct = av_destruct_packet;
+    dst->priv      = NULL;
+    dst->destruct  = av_destruct_packet;
+    if (src->data && (src->destruct == av_destruct_packet ||
+                      src->destruct == destruct_buffer_packet)) {
+        if (ref_packet_data(dst, src) < 0)
+            goto failed_alloc;
+    } else
+        DUP_DATA(dst->data, src->data, dst->size, 1);
 
     if (dst->side_data_elems) {
         int i;
@@ -150,7 +224,10 @@ static int copy_packet_data(AVPacket *dst, AVPacket *src)
     return 0;
 
 failed_alloc:
-    av_destruct_packet(dst);
+    if (!dst->side_data)
+        dst->side_data_elems = 0;
+    dst->destruct(dst);
+    dst->destruct = NULL;
     return AVERROR(ENOMEM);
 }
 
@@ -111,20 +111,22 @@ static int av_unused get_cabac(CABACContext *c, uint8_t * const state){
     return get_cabac_inline(c,state);
 }
 
+/**
+ * Bypass bins are close to equiprobable, so avoid a branch on the result
+ * that would be mispredicted about half of the time.
+ */
 static int av_unused get_cabac_bypass(CABACContext *c){
-    int range;
+    int range, mask;
     c->low += c->low;
 
     if(!(c->low & CABAC_MASK))
         refill(c);
 
     range= c->range<<(CABAC_BITS+1);
-    if(c->low < range){
-        return 0;
-    }else{
-        c->low -= range;
-        return 1;
-    }
+    c->low -= range;
+    mask= c->low >> 31;
+    c->low += range & mask;
+    return mask + 1;
 }
 
 
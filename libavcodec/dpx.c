@@ -24,6 +24,7 @@
 #include "bytestream.h"
 #include "avcodec.h"
 #include "internal.h"
+#include "thread.h"
 
 typedef struct DPXContext {
     AVFrame picture;
@@ -187,8 +188,8 @@ static int decode_frame(AVCodecContext *avctx,
     }
 
     if (s->picture.data[0])
-        avctx->release_buffer(avctx, &s->picture);
-    if (ff_get_buffer(avctx, p) < 0) {
+        ff_thread_release_buffer(avctx, &s->picture);
+    if (ff_thread_get_buffer(avctx, p) < 0) {
         av_log(avctx, AV_LOG_ERROR, "get_buffer() failed\n");
         return -1;
     }
@@ -294,5 +295,5 @@ AVCodec ff_dpx_decoder = {
     .close          = decode_end,
     .decode         = decode_frame,
     .long_name      = NULL_IF_CONFIG_SMALL("DPX image"),
-    .capabilities   = CODEC_CAP_DR1,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS,
 };
@@ -344,6 +344,13 @@ typedef struct DSPContext {
 
     me_cmp_func pix_abs[2][4];
 
+    /**
+     * SAD of a 16x16 block against the 4 small diamond neighbours of ref,
+     * in the order left, up, right, down. Only set if it matches sad[0].
+     * @param src block to match, 16 byte aligned like for sad[0]
+     */
+    void (*sad16_x4)(int scores[4], uint8_t *src, uint8_t *ref, int stride);
+
     /* huffyuv specific */
     void (*add_bytes)(uint8_t *dst/*align 16*/, uint8_t *src/*align 16*/, int w);
     void (*diff_bytes)(uint8_t *dst/*align 16*/, const uint8_t *src1/*align 16*/, const uint8_t *src2/*align 1*/,int w);
@@ -48,19 +48,37 @@ enum ExrCompr {
     EXR_B44A  = 7,
 };
 
+typedef struct EXRThreadData {
+    uint8_t *uncompressed_data;
+    int uncompressed_size;
+
+    uint8_t *tmp;
+    int tmp_size;
+} EXRThreadData;
+
 typedef struct EXRContext {
     AVFrame picture;
     int compr;
     int bits_per_color_id;
     int channel_offsets[4]; // 0 = red, 1 = green, 2 = blue and 3 = alpha
+    const AVPixFmtDescriptor *desc;
 
-    uint8_t *uncompressed_data;
-    int uncompressed_size;
+    unsigned int xmin, xdelta, ymin, ymax;
+    unsigned int current_channel_offset;
+    int scan_lines_per_block;
+    unsigned long scan_line_size;
+    int bxmin, axmax, out_line_size;
 
-    uint8_t *tmp;
-    int tmp_size;
+    const uint8_t *buf, *table;
+    unsigned int buf_size;
+    int nb_offsets;             ///< number of usable line offset table entries
+
+    EXRThreadData *thread_data;
+    int thread_data_count;
 } EXRContext;
 
+static uint16_t halflt2uint_table[1 << 16];
+
 /**
  * Converts from 32-bit float as uint32_t to uint16_t
  *
@@ -221,6 +239,132 @@ static int rle_uncompress(const uint8_t *src, int ssize, uint8_t *dst, int dsize
     return dend != d;
 }
 
+static int decode_block(AVCodecContext *avctx, void *tdata,
+                        int jobnr, int threadnr)
+{
+    EXRContext *s = avctx->priv_data;
+    EXRThreadData *td = (EXRThreadData *)tdata + threadnr;
+    const AVPixFmtDescriptor *desc = s->desc;
+    const uint8_t *red_channel_buffer, *green_channel_buffer, *blue_channel_buffer, *alpha_channel_buffer = 0;
+    int stride  = s->picture.linesize[0];
+    unsigned y  = s->ymin + jobnr * s->scan_lines_per_block;
+    int lines   = FFMIN(s->scan_lines_per_block, s->ymax - y + 1);
+    uint8_t *ptr = s->picture.data[0] + y * stride;
+    unsigned long uncompressed_size = s->scan_line_size * lines;
+    unsigned int xdelta = s->xdelta;
+    uint16_t *ptr_x;
+    uint64_t line_offset;
+    int32_t data_size;
+    int i, x;
+
+    /* Read the lineoffset from the line offset table and add 8 bytes
+       to skip the coordinates and data size fields */
+    if (jobnr < s->nb_offsets)
+        line_offset = AV_RL64(s->table + 8 * jobnr) + 8;
+
+    // Check if the buffer has the required bytes needed from the offset
+    if (jobnr >= s->nb_offsets || (line_offset > s->buf_size) ||
+        (s->compr == EXR_RAW && line_offset > s->buf_size - xdelta * s->current_channel_offset) ||
+        (s->compr != EXR_RAW && line_offset > s->buf_size - (data_size = AV_RL32(s->buf + line_offset - 4)))) {
+        // Line offset is probably wrong and not inside the buffer
+        av_log(avctx, AV_LOG_WARNING, "Line offset for line %d is out of reach setting it to black\n", y);
+        for (i = 0; i < lines; i++, ptr += stride)
+            memset(ptr, 0, s->out_line_size);
+        return AVERROR_INVALIDDATA;
+    }
+
+    if (s->compr != EXR_RAW && data_size < uncompressed_size) {
+        unsigned long block_size = s->scan_line_size * s->scan_lines_per_block;
+
+        av_fast_padded_malloc(&td->uncompressed_data, &td->uncompressed_size, block_size);
+        av_fast_padded_malloc(&td->tmp, &td->tmp_size, block_size);
+        if (!td->uncompressed_data || !td->tmp)
+            return AVERROR(ENOMEM);
+    }
+
+    if ((s->compr == EXR_ZIP1 || s->compr == EXR_ZIP16) && data_size < uncompressed_size) {
+        unsigned long dest_len = uncompressed_size;
+
+        if (uncompress(td->tmp, &dest_len, s->buf + line_offset, data_size) != Z_OK ||
+            dest_len != uncompressed_size) {
+            av_log(avctx, AV_LOG_ERROR, "error during zlib decompression\n");
+            return AVERROR(EINVAL);
+        }
+    } else if (s->compr == EXR_RLE && data_size < uncompressed_size) {
+        if (rle_uncompress(s->buf + line_offset, data_size, td->tmp, uncompressed_size)) {
+            av_log(avctx, AV_LOG_ERROR, "error during rle decompression\n");
+            return AVERROR(EINVAL);
+        }
+    }
+
+    if (s->compr != EXR_RAW && data_size < uncompressed_size) {
+        predictor(td->tmp, uncompressed_size);
+        reorder_pixels(td->tmp, td->uncompressed_data, uncompressed_size);
+
+        red_channel_buffer   = td->uncompressed_data + xdelta * s->channel_offsets[0];
+        green_channel_buffer = td->uncompressed_data + xdelta * s->channel_offsets[1];
+        blue_channel_buffer  = td->uncompressed_data + xdelta * s->channel_offsets[2];
+        if (s->channel_offsets[3] >= 0)
+            alpha_channel_buffer = td->uncompressed_data + xdelta * s->channel_offsets[3];
+    } else {
+        red_channel_buffer   = s->buf + line_offset + xdelta * s->channel_offsets[0];
+        green_channel_buffer = s->buf + line_offset + xdelta * s->channel_offsets[1];
+        blue_channel_buffer  = s->buf + line_offset + xdelta * s->channel_offsets[2];
+        if (s->channel_offsets[3] >= 0)
+            alpha_channel_buffer = s->buf + line_offset + xdelta * s->channel_offsets[3];
+    }
+
+    for (i = 0; i < lines; i++, ptr += stride) {
+        const uint8_t *r, *g, *b, *a;
+
+        r = red_channel_buffer;
+        g = green_channel_buffer;
+        b = blue_channel_buffer;
+        a = alpha_channel_buffer;
+
+        ptr_x = (uint16_t *)ptr;
+
+        // Zero out the start if xmin is not 0
+        memset(ptr_x, 0, s->bxmin);
+        ptr_x += s->xmin * desc->nb_components;
+        if (s->bits_per_color_id == 2) {
+            // 32-bit
+            for (x = 0; x < xdelta; x++) {
+                *ptr_x++ = exr_flt2uint(bytestream_get_le32(&r));
+                *ptr_x++ = exr_flt2uint(bytestream_get_le32(&g));
+                *ptr_x++ = exr_flt2uint(bytestream_get_le32(&b));
+                if (alpha_channel_buffer)
+                    *ptr_x++ = exr_flt2uint(bytestream_get_le32(&a));
+            }
+        } else if (alpha_channel_buffer) {
+            // 16-bit
+            for (x = 0; x < xdelta; x++) {
+                *ptr_x++ = halflt2uint_table[AV_RL16(r + 2 * x)];
+                *ptr_x++ = halflt2uint_table[AV_RL16(g + 2 * x)];
+                *ptr_x++ = halflt2uint_table[AV_RL16(b + 2 * x)];
+                *ptr_x++ = halflt2uint_table[AV_RL16(a + 2 * x)];
+            }
+        } else {
+            for (x = 0; x < xdelta; x++) {
+                *ptr_x++ = halflt2uint_table[AV_RL16(r + 2 * x)];
+                *ptr_x++ = halflt2uint_table[AV_RL16(g + 2 * x)];
+                *ptr_x++ = halflt2uint_table[AV_RL16(b + 2 * x)];
+            }
+        }
+
+        // Zero out the end if xmax+1 is not w
+        memset(ptr_x, 0, s->axmax);
+
+        red_channel_buffer   += s->scan_line_size;
+        green_channel_buffer += s->scan_line_size;
+        blue_channel_buffer  += s->scan_line_size;
+        if (alpha_channel_buffer)
+            alpha_channel_buffer += s->scan_line_size;
+    }
+
+    return 0;
+}
+
 static int decode_frame(AVCodecContext *avctx,
                         void *data,
                         int *got_frame,
@@ -236,7 +380,7 @@ static int decode_frame(AVCodecContext *avctx,
     AVFrame *const p = &s->picture;
     uint8_t *ptr;
 
-    int i, x, y, stride, magic_number, version_flag, ret;
+    int i, y, stride, magic_number, version_flag, ret;
     int w = 0;
     int h = 0;
     unsigned int xmin   = ~0;
@@ -246,10 +390,7 @@ static int decode_frame(AVCodecContext *avctx,
     unsigned int xdelta = ~0;
 
     int out_line_size;
-    int bxmin, axmax;
     int scan_lines_per_block;
-    unsigned long scan_line_size;
-    unsigned long uncompressed_size;
 
     unsigned int current_channel_offset = 0;
 
@@ -496,17 +637,25 @@ static int decode_frame(AVCodecContext *avctx,
     }
 
     desc = av_pix_fmt_desc_get(avctx->pix_fmt);
-    bxmin = xmin * 2 * desc->nb_components;
-    axmax = (avctx->width - (xmax + 1)) * 2 * desc->nb_components;
-    out_line_size = avctx->width * 2 * desc->nb_components;
-    scan_line_size = xdelta * current_channel_offset;
-    uncompressed_size = scan_line_size * scan_lines_per_block;
-
-    if (s->compr != EXR_RAW) {
-        av_fast_padded_malloc(&s->uncompressed_data, &s->uncompressed_size, uncompressed_size);
-        av_fast_padded_malloc(&s->tmp, &s->tmp_size, uncompressed_size);
-        if (!s->uncompressed_data || !s->tmp)
+    s->desc          = desc;
+    s->xmin          = xmin;
+    s->xdelta        = xdelta;
+    s->ymin          = ymin;
+    s->ymax          = ymax;
+    s->current_channel_offset = current_channel_offset;
+    s->scan_lines_per_block   = scan_lines_per_block;
+    s->bxmin         = xmin * 2 * desc->nb_components;
+    s->axmax         = (avctx->width - (xmax + 1)) * 2 * desc->nb_components;
+    s->out_line_size = out_line_size = avctx->width * 2 * desc->nb_components;
+    s->scan_line_size = xdelta * current_channel_offset;
+
+    if (!s->thread_data) {
+        int count = avctx->active_thread_type & FF_THREAD_SLICE ?
+                    FFMAX(avctx->thread_count, 1) : 1;
+        s->thread_data = av_mallocz(count * sizeof(*s->thread_data));
+        if (!s->thread_data)
             return AVERROR(ENOMEM);
+        s->thread_data_count = count;
     }
 
     if ((ret = ff_thread_get_buffer(avctx, p)) < 0) {
@@ -523,109 +672,15 @@ static int decode_frame(AVCodecContext *avctx,
         ptr += stride;
     }
 
-    // Process the actual scan line blocks
-    for (y = ymin; y <= ymax; y += scan_lines_per_block) {
-        uint16_t *ptr_x = (uint16_t *)ptr;
-        if (buf_end - buf > 8) {
-            /* Read the lineoffset from the line offset table and add 8 bytes
-               to skip the coordinates and data size fields */
-            const uint64_t line_offset = bytestream_get_le64(&buf) + 8;
-            int32_t data_size;
-
-            // Check if the buffer has the required bytes needed from the offset
-            if ((line_offset > buf_size) ||
-                (s->compr == EXR_RAW && line_offset > avpkt->size - xdelta * current_channel_offset) ||
-                (s->compr != EXR_RAW && line_offset > buf_size - (data_size = AV_RL32(avpkt->data + line_offset - 4)))) {
-                // Line offset is probably wrong and not inside the buffer
-                av_log(avctx, AV_LOG_WARNING, "Line offset for line %d is out of reach setting it to black\n", y);
-                for (i = 0; i < scan_lines_per_block && y + i <= ymax; i++, ptr += stride) {
-                    ptr_x = (uint16_t *)ptr;
-                    memset(ptr_x, 0, out_line_size);
-                }
-            } else {
-                const uint8_t *red_channel_buffer, *green_channel_buffer, *blue_channel_buffer, *alpha_channel_buffer = 0;
-
-                if (scan_lines_per_block > 1)
-                    uncompressed_size = scan_line_size * FFMIN(scan_lines_per_block, ymax - y + 1);
-                if ((s->compr == EXR_ZIP1 || s->compr == EXR_ZIP16) && data_size < uncompressed_size) {
-                    unsigned long dest_len = uncompressed_size;
-
-                    if (uncompress(s->tmp, &dest_len, avpkt->data + line_offset, data_size) != Z_OK ||
-                        dest_len != uncompressed_size) {
-                        av_log(avctx, AV_LOG_ERROR, "error during zlib decompression\n");
-                        return AVERROR(EINVAL);
-                    }
-                } else if (s->compr == EXR_RLE && data_size < uncompressed_size) {
-                    if (rle_uncompress(avpkt->data + line_offset, data_size, s->tmp, uncompressed_size)) {
-                        av_log(avctx, AV_LOG_ERROR, "error during rle decompression\n");
-                        return AVERROR(EINVAL);
-                    }
-                }
-
-                if (s->compr != EXR_RAW && data_size < uncompressed_size) {
-                    predictor(s->tmp, uncompressed_size);
-                    reorder_pixels(s->tmp, s->uncompressed_data, uncompressed_size);
-
-                    red_channel_buffer   = s->uncompressed_data + xdelta * s->channel_offsets[0];
-                    green_channel_buffer = s->uncompressed_data + xdelta * s->channel_offsets[1];
-                    blue_channel_buffer  = s->uncompressed_data + xdelta * s->channel_offsets[2];
-                    if (s->channel_offsets[3] >= 0)
-                        alpha_channel_buffer = s->uncompressed_data + xdelta * s->channel_offsets[3];
-                } else {
-                    red_channel_buffer   = avpkt->data + line_offset + xdelta * s->channel_offsets[0];
-                    green_channel_buffer = avpkt->data + line_offset + xdelta * s->channel_offsets[1];
-                    blue_channel_buffer  = avpkt->data + line_offset + xdelta * s->channel_offsets[2];
-                    if (s->channel_offsets[3] >= 0)
-                        alpha_channel_buffer = avpkt->data + line_offset + xdelta * s->channel_offsets[3];
-                }
-
-                for (i = 0; i < scan_lines_per_block && y + i <= ymax; i++, ptr += stride) {
-                    const uint8_t *r, *g, *b, *a;
-
-                    r = red_channel_buffer;
-                    g = green_channel_buffer;
-                    b = blue_channel_buffer;
-                    if (alpha_channel_buffer)
-                        a = alpha_channel_buffer;
-
-                    ptr_x = (uint16_t *)ptr;
-
-                    // Zero out the start if xmin is not 0
-                    memset(ptr_x, 0, bxmin);
-                    ptr_x += xmin * desc->nb_components;
-                    if (s->bits_per_color_id == 2) {
-                        // 32-bit
-                        for (x = 0; x < xdelta; x++) {
-                            *ptr_x++ = exr_flt2uint(bytestream_get_le32(&r));
-                            *ptr_x++ = exr_flt2uint(bytestream_get_le32(&g));
-                            *ptr_x++ = exr_flt2uint(bytestream_get_le32(&b));
-                            if (alpha_channel_buffer)
-                                *ptr_x++ = exr_flt2uint(bytestream_get_le32(&a));
-                        }
-                    } else {
-                        // 16-bit
-                        for (x = 0; x < xdelta; x++) {
-                            *ptr_x++ = exr_halflt2uint(bytestream_get_le16(&r));
-                            *ptr_x++ = exr_halflt2uint(bytestream_get_le16(&g));
-                            *ptr_x++ = exr_halflt2uint(bytestream_get_le16(&b));
-                            if (alpha_channel_buffer)
-                                *ptr_x++ = exr_halflt2uint(bytestream_get_le16(&a));
-                        }
-                    }
-
-                    // Zero out the end if xmax+1 is not w
-                    memset(ptr_x, 0, axmax);
-
-                    red_channel_buffer   += scan_line_size;
-                    green_channel_buffer += scan_line_size;
-                    blue_channel_buffer  += scan_line_size;
-                    if (alpha_channel_buffer)
-                        alpha_channel_buffer += scan_line_size;
-                }
-            }
-        }
-    }
+    // Process the actual scan line blocks, they are independent
+    s->buf        = avpkt->data;
+    s->buf_size   = buf_size;
+    s->table      = buf;
+    s->nb_offsets = buf_end - buf > 8 ? (buf_end - buf - 1) / 8 : 0;
+    avctx->execute2(avctx, decode_block, s->thread_data, NULL,
+                    (ymax - ymin) / scan_lines_per_block + 1);
 
+    ptr = p->data[0] + (ymax + 1) * stride;
     // Zero out the end if ymax+1 is not h
     for (y = ymax + 1; y < avctx->height; y++) {
         memset(ptr, 0, out_line_size);
@@ -647,18 +702,28 @@ static av_cold int decode_init(AVCodecContext *avctx)
 
     s->compr = -1;
 
+    if (!halflt2uint_table[0x3c00]) {
+        int i;
+        for (i = 0; i < FF_ARRAY_ELEMS(halflt2uint_table); i++)
+            halflt2uint_table[i] = exr_halflt2uint(i);
+    }
+
     return 0;
 }
 
 static av_cold int decode_end(AVCodecContext *avctx)
 {
     EXRContext *s = avctx->priv_data;
+    int i;
 
     if (s->picture.data[0])
         avctx->release_buffer(avctx, &s->picture);
 
-    av_freep(&s->uncompressed_data);
-    av_freep(&s->tmp);
+    for (i = 0; i < s->thread_data_count; i++) {
+        av_freep(&s->thread_data[i].uncompressed_data);
+        av_freep(&s->thread_data[i].tmp);
+    }
+    av_freep(&s->thread_data);
 
     return 0;
 }
@@ -671,6 +736,7 @@ AVCodec ff_exr_decoder = {
     .init               = decode_init,
     .close              = decode_end,
     .decode             = decode_frame,
-    .capabilities       = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS,
+    .capabilities       = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS |
+                          CODEC_CAP_SLICE_THREADS,
     .long_name          = NULL_IF_CONFIG_SMALL("OpenEXR image"),
 };
@@ -37,6 +37,7 @@
 #include "rangecoder.h"
 #include "golomb.h"
 #include "mathops.h"
+#include "thread.h"
 #include "ffv1.h"
 
 av_cold int ffv1_common_init(AVCodecContext *avctx)
@@ -189,9 +190,11 @@ av_cold int ffv1_close(AVCodecContext *avctx)
     int i, j;
 
     if (avctx->codec->decode && s->picture.data[0])
-        avctx->release_buffer(avctx, &s->picture);
-    if (avctx->codec->decode && s->last_picture.data[0])
-        avctx->release_buffer(avctx, &s->last_picture);
+        ff_thread_release_buffer(avctx, &s->picture);
+    /* with frame threading last_picture is borrowed from the previous thread */
+    if (avctx->codec->decode && s->last_picture.data[0] &&
+        !(avctx->active_thread_type & FF_THREAD_FRAME))
+        ff_thread_release_buffer(avctx, &s->last_picture);
 
     for (j = 0; j < s->slice_count; j++) {
         FFV1Context *fs = s->slice_context[j];
@@ -206,7 +209,9 @@ av_cold int ffv1_close(AVCodecContext *avctx)
 
     av_freep(&avctx->stats_out);
     for (j = 0; j < s->quant_table_count; j++) {
-        av_freep(&s->initial_states[j]);
+        /* the initial states are shared by all frame threads */
+        if (!avctx->internal->is_copy)
+            av_freep(&s->initial_states[j]);
         for (i = 0; i < s->slice_count; i++) {
             FFV1Context *sf = s->slice_context[i];
             av_freep(&sf->rc_stat2[j]);
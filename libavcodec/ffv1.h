@@ -116,6 +116,8 @@ typedef struct FFV1Context {
 
     DSPContext dsp;
 
+    struct FFV1Context *fsrc;            ///< context of the previous frame with frame threading
+
     struct FFV1Context *slice_context[MAX_SLICES];
     int slice_count;
     int num_v_slices;
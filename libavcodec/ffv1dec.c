@@ -39,6 +39,7 @@
 #include "rangecoder.h"
 #include "golomb.h"
 #include "mathops.h"
+#include "thread.h"
 #include "ffv1.h"
 
 static inline av_flatten int get_symbol_inline(RangeCoder *c, uint8_t *state,
@@ -727,6 +728,59 @@ static av_cold int decode_init(AVCodecContext *avctx)
     return 0;
 }
 
+/**
+ * Take over the slice parameters and the adapted context states a slice
+ * had at the end of the previous frame, for non-keyframes decoded in a
+ * different frame thread.
+ */
+static int copy_slice_state(FFV1Context *f, FFV1Context *fsdst,
+                            const FFV1Context *fssrc)
+{
+    int i, ret;
+
+    fsdst->ac            = fssrc->ac;
+    fsdst->packed_at_lsb = fssrc->packed_at_lsb;
+    fsdst->slice_damaged = fssrc->slice_damaged;
+    fsdst->slice_x       = fssrc->slice_x;
+    fsdst->slice_y       = fssrc->slice_y;
+    fsdst->slice_width   = fssrc->slice_width;
+    fsdst->slice_height  = fssrc->slice_height;
+
+    for (i = 0; i < f->plane_count; i++) {
+        PlaneContext       *pdst = &fsdst->plane[i];
+        const PlaneContext *psrc = &fssrc->plane[i];
+
+        if (pdst->context_count < psrc->context_count) {
+            av_freep(&pdst->state);
+            av_freep(&pdst->vlc_state);
+        }
+        memcpy(pdst->quant_table, psrc->quant_table, sizeof(pdst->quant_table));
+        memcpy(pdst->interlace_bit_state, psrc->interlace_bit_state,
+               sizeof(pdst->interlace_bit_state));
+        pdst->quant_table_index = psrc->quant_table_index;
+        pdst->context_count     = psrc->context_count;
+    }
+
+    if ((ret = ffv1_init_slice_state(f, fsdst)) < 0)
+        return ret;
+
+    for (i = 0; i < f->plane_count; i++) {
+        PlaneContext       *pdst = &fsdst->plane[i];
+        const PlaneContext *psrc = &fssrc->plane[i];
+
+        if (fsdst->ac) {
+            if (psrc->state)
+                memcpy(pdst->state, psrc->state,
+                       CONTEXT_SIZE * psrc->context_count);
+        } else if (psrc->vlc_state) {
+            memcpy(pdst->vlc_state, psrc->vlc_state,
+                   psrc->context_count * sizeof(*psrc->vlc_state));
+        }
+    }
+
+    return 0;
+}
+
 static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame, AVPacket *avpkt)
 {
     const uint8_t *buf  = avpkt->data;
@@ -742,7 +796,7 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame, AVPac
 
     /* release previously stored data */
     if (p->data[0])
-        avctx->release_buffer(avctx, p);
+        ff_thread_release_buffer(avctx, p);
 
     ff_init_range_decoder(c, buf, buf_size);
     ff_build_rac_states(c, 0.05 * (1LL << 32), 256 - 8);
@@ -764,11 +818,27 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame, AVPac
     }
 
     p->reference = 3; //for error concealment
-    if ((ret = ff_get_buffer(avctx, p)) < 0) {
+    if ((ret = ff_thread_get_buffer(avctx, p)) < 0) {
         av_log(avctx, AV_LOG_ERROR, "get_buffer() failed\n");
         return ret;
     }
 
+    /* Keyframes reset all context states, so the next frame can start right
+     * away. A non-keyframe continues with the states the previous frame
+     * ended with, so wait for it and take them over before letting the next
+     * frame thread start. */
+    if (!p->key_frame && f->fsrc) {
+        if (f->last_picture.data[0])
+            ff_thread_await_progress(&f->last_picture, INT_MAX, 0);
+        for (i = 0; i < f->slice_count; i++) {
+            ret = copy_slice_state(f, f->slice_context[i],
+                                   f->fsrc->slice_context[i]);
+            if (ret < 0)
+                return ret;
+        }
+    }
+    ff_thread_finish_setup(avctx);
+
     if (avctx->debug & FF_DEBUG_PICT_INFO)
         av_log(avctx, AV_LOG_DEBUG, "ver:%d keyframe:%d coder:%d ec:%d slices:%d bps:%d\n",
                f->version, p->key_frame, f->ac, f->ec, f->slice_count, f->avctx->bits_per_raw_sample);
@@ -822,6 +892,7 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame, AVPac
         if (fs->slice_damaged && f->last_picture.data[0]) {
             const uint8_t *src[4];
             uint8_t *dst[4];
+            ff_thread_await_progress(&f->last_picture, INT_MAX, 0);
             for (j = 0; j < 4; j++) {
                 int sh = (j==1 || j==2) ? f->chroma_h_shift : 0;
                 int sv = (j==1 || j==2) ? f->chroma_v_shift : 0;
@@ -845,11 +916,63 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame, AVPac
     *picture   = *p;
     *got_frame = 1;
 
-    FFSWAP(AVFrame, f->picture, f->last_picture);
+    ff_thread_report_progress(&f->picture, INT_MAX, 0);
+
+    /* with frame threading the next thread borrows this picture instead */
+    if (!(avctx->active_thread_type & FF_THREAD_FRAME))
+        FFSWAP(AVFrame, f->picture, f->last_picture);
 
     return buf_size;
 }
 
+static av_cold int init_thread_copy(AVCodecContext *avctx)
+{
+    FFV1Context *f = avctx->priv_data;
+
+    f->avctx        = avctx;
+    f->fsrc         = NULL;
+    avcodec_get_frame_defaults(&f->picture);
+    avcodec_get_frame_defaults(&f->last_picture);
+
+    return ffv1_init_slice_contexts(f);
+}
+
+static int update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    FFV1Context *fsrc = src->priv_data;
+    FFV1Context *fdst = dst->priv_data;
+
+    if (dst == src)
+        return 0;
+
+    fdst->version           = fsrc->version;
+    fdst->minor_version     = fsrc->minor_version;
+    fdst->chroma_planes     = fsrc->chroma_planes;
+    fdst->chroma_h_shift    = fsrc->chroma_h_shift;
+    fdst->chroma_v_shift    = fsrc->chroma_v_shift;
+    fdst->transparency      = fsrc->transparency;
+    fdst->plane_count       = fsrc->plane_count;
+    fdst->ac                = fsrc->ac;
+    fdst->colorspace        = fsrc->colorspace;
+    fdst->ec                = fsrc->ec;
+    fdst->key_frame_ok      = fsrc->key_frame_ok;
+    fdst->packed_at_lsb     = fsrc->packed_at_lsb;
+    fdst->slice_count       = fsrc->slice_count;
+    fdst->quant_table_count = fsrc->quant_table_count;
+    memcpy(fdst->state_transition, fsrc->state_transition,
+           sizeof(fdst->state_transition));
+    memcpy(fdst->quant_table,   fsrc->quant_table,   sizeof(fdst->quant_table));
+    memcpy(fdst->quant_tables,  fsrc->quant_tables,  sizeof(fdst->quant_tables));
+    memcpy(fdst->context_count, fsrc->context_count, sizeof(fdst->context_count));
+
+    /* the previous picture stays valid until this thread has finished, as
+     * its owner only releases it when decoding its next frame */
+    fdst->fsrc         = fsrc;
+    fdst->last_picture = fsrc->picture;
+
+    return 0;
+}
+
 AVCodec ff_ffv1_decoder = {
     .name           = "ffv1",
     .type           = AVMEDIA_TYPE_VIDEO,
@@ -858,7 +981,9 @@ AVCodec ff_ffv1_decoder = {
     .init           = decode_init,
     .close          = ffv1_close,
     .decode         = decode_frame,
+    .init_thread_copy      = ONLY_IF_THREADS_ENABLED(init_thread_copy),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(update_thread_context),
     .capabilities   = CODEC_CAP_DR1 /*| CODEC_CAP_DRAW_HORIZ_BAND*/ |
-                      CODEC_CAP_SLICE_THREADS,
+                      CODEC_CAP_FRAME_THREADS | CODEC_CAP_SLICE_THREADS,
     .long_name      = NULL_IF_CONFIG_SMALL("FFmpeg video codec #1"),
 };
@@ -109,7 +109,7 @@ typedef struct FlacEncodeContext {
     FlacFrame frame;
     CompressionOptions options;
     AVCodecContext *avctx;
-    LPCContext lpc_ctx;
+    LPCContext lpc_ctx[FLAC_MAX_CHANNELS]; ///< one per channel, for the threaded residual search
     struct AVMD5 *md5ctx;
     uint8_t *md5_buffer;
     unsigned int md5_buffer_size;
@@ -423,8 +423,12 @@ static av_cold int flac_encode_init(AVCodecContext *avctx)
         }
     }
 
-    ret = ff_lpc_init(&s->lpc_ctx, avctx->frame_size,
-                      s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+    for (i = 0; i < channels; i++) {
+        ret = ff_lpc_init(&s->lpc_ctx[i], avctx->frame_size,
+                          s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+        if (ret < 0)
+            return ret;
+    }
 
     ff_dsputil_init(&s->dsp, avctx);
     ff_flacdsp_init(&s->flac_dsp, avctx->sample_fmt,
@@ -508,12 +512,14 @@ static uint64_t rice_count_exact(int32_t *res, int n, int k)
     int i;
     uint64_t count = 0;
 
+    /* the unary terminator and the k low bits are the same for all samples,
+     * keep the loop body to the folding and the shift */
     for (i = 0; i < n; i++) {
         int32_t v = -2 * res[i] - 1;
         v ^= v >> 31;
-        count += (v >> k) + 1 + k;
+        count += v >> k;
     }
-    return count;
+    return count + (uint64_t)n * (k + 1);
 }
 
 
@@ -608,23 +614,24 @@ static uint64_t calc_optimal_rice_params(RiceContext *rc, int porder,
 }
 
 
-static void calc_sums(int pmin, int pmax, uint32_t *data, int n, int pred_order,
+static void calc_sums(int pmin, int pmax, const int32_t *data, int n, int pred_order,
                       uint64_t sums[][MAX_PARTITIONS])
 {
     int i, j;
     int parts;
-    uint32_t *res, *res_end;
+    int start, end;
 
-    /* sums for highest level */
-    parts   = (1 << pmax);
-    res     = &data[pred_order];
-    res_end = &data[n >> pmax];
+    /* sums for highest level, folding the residuals to unsigned on the fly */
+    parts = (1 << pmax);
+    start = pred_order;
+    end   = n >> pmax;
     for (i = 0; i < parts; i++) {
         uint64_t sum = 0;
-        while (res < res_end)
-            sum += *(res++);
+        for (j = start; j < end; j++)
+            sum += (uint32_t)((2 * data[j]) ^ (data[j] >> 31));
         sums[pmax][i] = sum;
-        res_end += n >> pmax;
+        start = end;
+        end  += n >> pmax;
     }
     /* sums for lower levels */
     for (i = pmax - 1; i >= pmin; i--) {
@@ -642,7 +649,6 @@ static uint64_t calc_rice_params(RiceContext *rc, int pmin, int pmax,
     uint64_t bits[MAX_PARTITION_ORDER+1];
     int opt_porder;
     RiceContext tmp_rc;
-    uint32_t *udata;
     uint64_t sums[MAX_PARTITION_ORDER+1][MAX_PARTITIONS];
 
     av_assert1(pmin >= 0 && pmin <= MAX_PARTITION_ORDER);
@@ -651,11 +657,7 @@ static uint64_t calc_rice_params(RiceContext *rc, int pmin, int pmax,
 
     tmp_rc.coding_mode = rc->coding_mode;
 
-    udata = av_malloc(n * sizeof(uint32_t));
-    for (i = 0; i < n; i++)
-        udata[i] = (2*data[i]) ^ (data[i]>>31);
-
-    calc_sums(pmin, pmax, udata, n, pred_order, sums);
+    calc_sums(pmin, pmax, data, n, pred_order, sums);
 
     opt_porder = pmin;
     bits[pmin] = UINT32_MAX;
@@ -667,7 +669,6 @@ static uint64_t calc_rice_params(RiceContext *rc, int pmin, int pmax,
         }
     }
 
-    av_freep(&udata);
     return bits[opt_porder];
 }
 
@@ -812,7 +813,7 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
 
     /* LPC */
     sub->type = FLAC_SUBFRAME_LPC;
-    opt_order = ff_lpc_calc_coefs(&s->lpc_ctx, smp, n, min_order, max_order,
+    opt_order = ff_lpc_calc_coefs(&s->lpc_ctx[ch], smp, n, min_order, max_order,
                                   s->options.lpc_coeff_precision, coefs, shift, s->options.lpc_type,
                                   s->options.lpc_passes, omethod,
                                   MAX_LPC_SHIFT, 0);
@@ -924,15 +925,25 @@ static int count_frame_header(FlacEncodeContext *s)
 }
 
 
+static int encode_residual_thread(AVCodecContext *avctx, void *arg,
+                                  int jobnr, int threadnr)
+{
+    return encode_residual_ch(avctx->priv_data, jobnr);
+}
+
+
 static int encode_frame(FlacEncodeContext *s)
 {
     int ch;
+    int bits[FLAC_MAX_CHANNELS];
     uint64_t count;
 
     count = count_frame_header(s);
 
+    /* the subframes are independent, search them in parallel */
+    s->avctx->execute2(s->avctx, encode_residual_thread, NULL, bits, s->channels);
     for (ch = 0; ch < s->channels; ch++)
-        count += encode_residual_ch(s, ch);
+        count += bits[ch];
 
     count += (8 - (count & 7)) & 7; // byte alignment
     count += 16;                    // CRC-16
@@ -1300,9 +1311,11 @@ static av_cold int flac_encode_close(AVCodecContext *avctx)
 {
     if (avctx->priv_data) {
         FlacEncodeContext *s = avctx->priv_data;
+        int i;
         av_freep(&s->md5ctx);
         av_freep(&s->md5_buffer);
-        ff_lpc_end(&s->lpc_ctx);
+        for (i = 0; i < FLAC_MAX_CHANNELS; i++)
+            ff_lpc_end(&s->lpc_ctx[i]);
     }
     av_freep(&avctx->extradata);
     avctx->extradata_size = 0;
@@ -1354,7 +1367,8 @@ AVCodec ff_flac_encoder = {
     .init           = flac_encode_init,
     .encode2        = flac_encode_frame,
     .close          = flac_encode_close,
-    .capabilities   = CODEC_CAP_SMALL_LAST_FRAME | CODEC_CAP_DELAY | CODEC_CAP_LOSSLESS,
+    .capabilities   = CODEC_CAP_SMALL_LAST_FRAME | CODEC_CAP_DELAY | CODEC_CAP_LOSSLESS |
+                      CODEC_CAP_SLICE_THREADS,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_S16,
                                                      AV_SAMPLE_FMT_S32,
                                                      AV_SAMPLE_FMT_NONE },
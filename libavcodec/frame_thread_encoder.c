@@ -116,6 +116,23 @@ end:
     return NULL;
 }
 
+/**
+ * Check that no state is carried from one frame to the next with the
+ * current settings, some intra only encoders adapt their entropy coder
+ * across frames in some modes.
+ */
+static int frames_independent(AVCodecContext *avctx){
+    switch(avctx->codec_id){
+    case AV_CODEC_ID_FFV1:
+        return avctx->gop_size <= 1 && !(avctx->flags & CODEC_FLAG_PASS1);
+    case AV_CODEC_ID_FFVHUFF:
+    case AV_CODEC_ID_HUFFYUV:
+        return !avctx->context_model && !(avctx->flags & CODEC_FLAG_PASS1);
+    default:
+        return 1;
+    }
+}
+
 int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
     int i=0;
     ThreadContext *c;
@@ -125,6 +142,12 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
        || !(avctx->codec->capabilities & CODEC_CAP_INTRA_ONLY))
         return 0;
 
+    if(!frames_independent(avctx)){
+        av_log(avctx, AV_LOG_VERBOSE,
+               "Frame threading disabled, the encoder keeps state across frames with these settings\n");
+        return 0;
+    }
+
     if(!avctx->thread_count) {
         avctx->thread_count = ff_get_logical_cpus(avctx);
         avctx->thread_count = FFMIN(avctx->thread_count, MAX_THREADS);
@@ -50,8 +50,26 @@
 #define UNCHECKED_BITSTREAM_READER !CONFIG_SAFE_BITSTREAM_READER
 #endif
 
+/*
+ * Cached bitstream reading:
+ * decoders that only use the function API below (get_bits(), get_vlc2(),
+ * ...) can "#define CACHED_BITSTREAM_READER 1" before including this
+ * header. The reader then keeps up to 64 bits in a cache that is refilled
+ * 32 bits at a time only when it runs dry, instead of doing an unaligned
+ * 32-bit load for every read. The OPEN_READER() macro API is not
+ * available in this mode. Since the layout of GetBitContext changes, a
+ * context must never be shared with code built without the define.
+ */
+#ifndef CACHED_BITSTREAM_READER
+#define CACHED_BITSTREAM_READER 0
+#endif
+
 typedef struct GetBitContext {
     const uint8_t *buffer, *buffer_end;
+#if CACHED_BITSTREAM_READER
+    uint64_t cache;
+    unsigned bits_left;
+#endif
     int index;
     int size_in_bits;
     int size_in_bits_plus8;
@@ -113,12 +131,14 @@ LAST_SKIP_BITS(name, gb, num)
 for examples see get_bits, show_bits, skip_bits, get_vlc
 */
 
-#ifdef LONG_BITSTREAM_READER
+#if CACHED_BITSTREAM_READER || defined LONG_BITSTREAM_READER
 #   define MIN_CACHE_BITS 32
 #else
 #   define MIN_CACHE_BITS 25
 #endif
 
+#if !CACHED_BITSTREAM_READER
+
 #if UNCHECKED_BITSTREAM_READER
 #define OPEN_READER(name, gb)                   \
     unsigned int name##_index = (gb)->index;    \
@@ -188,13 +208,112 @@ for examples see get_bits, show_bits, skip_bits, get_vlc
 
 #define GET_CACHE(name, gb) ((uint32_t)name##_cache)
 
+#endif /* !CACHED_BITSTREAM_READER */
+
+#if CACHED_BITSTREAM_READER
+/* In cached mode index is the byte-aligned position of the next refill,
+ * the bits_left bits before it are held in the cache. */
+
+static inline void refill_64(GetBitContext *s)
+{
+    s->cache = 0;
+#if !UNCHECKED_BITSTREAM_READER
+    if (s->index < s->size_in_bits_plus8)
+#endif
+#ifdef BITSTREAM_READER_LE
+        s->cache = AV_RL64(s->buffer + (s->index >> 3));
+#else
+        s->cache = AV_RB64(s->buffer + (s->index >> 3));
+#endif
+    s->index    += 64;
+    s->bits_left = 64;
+}
+
+static inline void refill_32(GetBitContext *s)
+{
+    uint64_t val = 0;
+#if !UNCHECKED_BITSTREAM_READER
+    if (s->index < s->size_in_bits_plus8)
+#endif
+#ifdef BITSTREAM_READER_LE
+        val = AV_RL32(s->buffer + (s->index >> 3));
+    s->cache |= val << s->bits_left;
+#else
+        val = AV_RB32(s->buffer + (s->index >> 3));
+    s->cache |= val << (32 - s->bits_left);
+#endif
+    s->index     += 32;
+    s->bits_left += 32;
+}
+
+/**
+ * Return the next n bits from the cache, 1 <= n <= bits_left.
+ */
+static inline unsigned show_val(const GetBitContext *s, int n)
+{
+#ifdef BITSTREAM_READER_LE
+    return s->cache & ((UINT64_C(1) << n) - 1);
+#else
+    return s->cache >> (64 - n);
+#endif
+}
+
+/**
+ * Drop n bits from the cache, 0 <= n < 64 and n <= bits_left.
+ */
+static inline void skip_remaining(GetBitContext *s, int n)
+{
+#ifdef BITSTREAM_READER_LE
+    s->cache >>= n;
+#else
+    s->cache <<= n;
+#endif
+    s->bits_left -= n;
+}
+
+/**
+ * Read 1-32 bits, refilling the cache only when it holds fewer than n.
+ */
+static inline unsigned get_val(GetBitContext *s, int n)
+{
+    unsigned ret;
+    av_assert2(n>0 && n<=32);
+    if (n > s->bits_left)
+        refill_32(s);
+    ret = show_val(s, n);
+    skip_remaining(s, n);
+    return ret;
+}
+#endif /* CACHED_BITSTREAM_READER */
+
 static inline int get_bits_count(const GetBitContext *s)
 {
+#if CACHED_BITSTREAM_READER
+#if UNCHECKED_BITSTREAM_READER
+    return s->index - s->bits_left;
+#else
+    return FFMIN(s->index - (int)s->bits_left, s->size_in_bits_plus8);
+#endif
+#else
     return s->index;
+#endif
 }
 
 static inline void skip_bits_long(GetBitContext *s, int n){
-#if UNCHECKED_BITSTREAM_READER
+#if CACHED_BITSTREAM_READER
+    int pos = get_bits_count(s);
+#if !UNCHECKED_BITSTREAM_READER
+    n = av_clip(n, -pos, s->size_in_bits_plus8 - pos);
+#endif
+    if (n >= 0 && n < s->bits_left) {
+        skip_remaining(s, n);
+    } else {
+        pos += n;
+        s->index = pos & ~7;
+        refill_64(s);
+        skip_remaining(s, pos & 7);
+    }
+#elif UNCHECKED_BITSTREAM_READER
     s->index += n;
 #else
     s->index += av_clip(n, -s->index, s->size_in_bits_plus8 - s->index);
@@ -208,6 +327,16 @@ static inline void skip_bits_long(GetBitContext *s, int n){
  */
 static inline int get_xbits(GetBitContext *s, int n)
 {
+#if CACHED_BITSTREAM_READER
+    int32_t cache;
+    int sign;
+    if (s->bits_left < 32)
+        refill_32(s);
+    cache = show_val(s, 32);
+    sign  = ~cache >> 31;
+    skip_remaining(s, n);
+    return (NEG_USR32(sign ^ cache, n) ^ sign) - sign;
+#else
     register int sign;
     register int32_t cache;
     OPEN_READER(re, s);
@@ -217,10 +346,14 @@ static inline int get_xbits(GetBitContext *s, int n)
     LAST_SKIP_BITS(re, s, n);
     CLOSE_READER(re, s);
     return (NEG_USR32(sign ^ cache, n) ^ sign) - sign;
+#endif
 }
 
 static inline int get_sbits(GetBitContext *s, int n)
 {
+#if CACHED_BITSTREAM_READER
+    return sign_extend(get_val(s, n), n);
+#else
     register int tmp;
     OPEN_READER(re, s);
     av_assert2(n>0 && n<=25);
@@ -229,6 +362,7 @@ static inline int get_sbits(GetBitContext *s, int n)
     LAST_SKIP_BITS(re, s, n);
     CLOSE_READER(re, s);
     return tmp;
+#endif
 }
 
 /**
@@ -236,6 +370,9 @@ static inline int get_sbits(GetBitContext *s, int n)
  */
 static inline unsigned int get_bits(GetBitContext *s, int n)
 {
+#if CACHED_BITSTREAM_READER
+    return get_val(s, n);
+#else
     register int tmp;
     OPEN_READER(re, s);
     av_assert2(n>0 && n<=25);
@@ -244,6 +381,7 @@ static inline unsigned int get_bits(GetBitContext *s, int n)
     LAST_SKIP_BITS(re, s, n);
     CLOSE_READER(re, s);
     return tmp;
+#endif
 }
 
 /**
@@ -251,24 +389,38 @@ static inline unsigned int get_bits(GetBitContext *s, int n)
  */
 static inline unsigned int show_bits(GetBitContext *s, int n)
 {
+#if CACHED_BITSTREAM_READER
+    av_assert2(n>0 && n<=32);
+    if (n > s->bits_left)
+        refill_32(s);
+    return show_val(s, n);
+#else
     register int tmp;
     OPEN_READER(re, s);
     av_assert2(n>0 && n<=25);
     UPDATE_CACHE(re, s);
     tmp = SHOW_UBITS(re, s, n);
     return tmp;
+#endif
 }
 
 static inline void skip_bits(GetBitContext *s, int n)
 {
+#if CACHED_BITSTREAM_READER
+    skip_bits_long(s, n);
+#else
     OPEN_READER(re, s);
     UPDATE_CACHE(re, s);
     LAST_SKIP_BITS(re, s, n);
     CLOSE_READER(re, s);
+#endif
 }
 
 static inline unsigned int get_bits1(GetBitContext *s)
 {
+#if CACHED_BITSTREAM_READER
+    return get_val(s, 1);
+#else
     unsigned int index = s->index;
     uint8_t result = s->buffer[index>>3];
 #ifdef BITSTREAM_READER_LE
@@ -285,6 +437,7 @@ static inline unsigned int get_bits1(GetBitContext *s)
     s->index = index;
 
     return result;
+#endif
 }
 
 static inline unsigned int show_bits1(GetBitContext *s)
@@ -385,6 +538,12 @@ static inline void init_get_bits(GetBitContext *s, const uint8_t *buffer,
     s->size_in_bits_plus8 = bit_size + 8;
     s->buffer_end   = buffer + buffer_size;
     s->index        = 0;
+#if CACHED_BITSTREAM_READER
+    if (buffer)
+        refill_64(s);
+    else
+        s->cache = s->bits_left = 0;
+#endif
 }
 
 static inline void align_get_bits(GetBitContext *s)
@@ -493,6 +652,32 @@ void ff_free_vlc(VLC *vlc);
 static av_always_inline int get_vlc2(GetBitContext *s, VLC_TYPE (*table)[2],
                                      int bits, int max_depth)
 {
+#if CACHED_BITSTREAM_READER
+    int n, nb_bits;
+    unsigned int index = show_bits(s, bits);
+    int code = table[index][0];
+
+    n = table[index][1];
+    if (max_depth > 1 && n < 0) {
+        skip_remaining(s, bits);
+        nb_bits = -n;
+
+        index = show_bits(s, nb_bits) + code;
+        code  = table[index][0];
+        n     = table[index][1];
+        if (max_depth > 2 && n < 0) {
+            skip_remaining(s, nb_bits);
+            nb_bits = -n;
+
+            index = show_bits(s, nb_bits) + code;
+            code  = table[index][0];
+            n     = table[index][1];
+        }
+    }
+    skip_remaining(s, n);
+
+    return code;
+#else
     int code;
 
     OPEN_READER(re, s);
@@ -502,6 +687,7 @@ static av_always_inline int get_vlc2(GetBitContext *s, VLC_TYPE (*table)[2],
 
     CLOSE_READER(re, s);
     return code;
+#endif
 }
 
 static inline int decode012(GetBitContext *gb)
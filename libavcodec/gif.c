@@ -27,7 +27,9 @@
  * Features and limitations:
  * - currently no compression is performed,
  *   in fact the size of the data is 9/8 the size of the image in 8bpp
- * - uses only a global standard palette
+ * - the palette of the first frame is the global one, frames with another
+ *   palette get a local one
+ * - with gifflags, only the changed rectangle of later frames is coded
  * - tested with IE 5.0, Opera for BeOS, NetPositive (BeOS), and Mozilla (BeOS).
  *
  * Reference documents:
@@ -41,6 +43,7 @@
  * some sites mentions an RLE type compression also.
  */
 
+#include "libavutil/opt.h"
 #include "avcodec.h"
 #include "bytestream.h"
 #include "internal.h"
@@ -53,17 +56,25 @@
 #include "put_bits.h"
 
 typedef struct {
+    const AVClass *class;
     AVFrame picture;
     LZWState *lzw;
     uint8_t *buf;
+    uint8_t *last_frame;        ///< palette indices of the previous frame
+    uint8_t *tmp_line;          ///< rectangle line with unchanged pixels made transparent
+    uint32_t palette[AVPALETTE_COUNT]; ///< global palette, taken from the first frame
+    int palette_loaded;
+    int flags;
 } GIFContext;
 
+#define GF_OFFSETTING (1 << 0)
+#define GF_TRANSDIFF  (1 << 1)
+
 /* GIF header */
 static int gif_image_write_header(AVCodecContext *avctx,
                                   uint8_t **bytestream, uint32_t *palette)
 {
     int i;
-    unsigned int v, smallest_alpha = 0xFF, alpha_component = 0;
 
     bytestream_put_buffer(bytestream, "GIF", 3);
     bytestream_put_buffer(bytestream, "89a", 3);
@@ -75,53 +86,163 @@ static int gif_image_write_header(AVCodecContext *avctx,
     bytestream_put_byte(bytestream, 0); /* aspect ratio */
 
     /* the global palette */
-    for(i=0;i<256;i++) {
-        v = palette[i];
-        bytestream_put_be24(bytestream, v);
-        if (v >> 24 < smallest_alpha) {
-            smallest_alpha = v >> 24;
-            alpha_component = i;
-        }
+    for(i=0;i<256;i++)
+        bytestream_put_be24(bytestream, palette[i]);
+
+    return 0;
+}
+
+/**
+ * Find the smallest rectangle containing all the pixels which differ from
+ * the previous frame. An unchanged frame gives an empty rectangle.
+ */
+static void gif_crop_image(AVCodecContext *avctx, const uint8_t *buf,
+                           int linesize, int *x_start, int *y_start,
+                           int *width, int *height)
+{
+    GIFContext *s = avctx->priv_data;
+    const uint8_t *last = s->last_frame;
+    int w = avctx->width, h = avctx->height;
+    int x0 = w, x1 = -1, y0, y1, y;
+
+    for (y0 = 0; y0 < h; y0++)
+        if (memcmp(buf + y0 * linesize, last + y0 * w, w))
+            break;
+    if (y0 == h) {
+        *x_start = *y_start = *width = *height = 0;
+        return;
     }
+    for (y1 = h - 1; y1 > y0; y1--)
+        if (memcmp(buf + y1 * linesize, last + y1 * w, w))
+            break;
 
-    if (smallest_alpha < 128) {
-        bytestream_put_byte(bytestream, 0x21); /* Extension Introducer */
-        bytestream_put_byte(bytestream, 0xf9); /* Graphic Control Label */
-        bytestream_put_byte(bytestream, 0x04); /* block length */
-        bytestream_put_byte(bytestream, 0x01); /* Transparent Color Flag */
-        bytestream_put_le16(bytestream, 0x00); /* no delay */
-        bytestream_put_byte(bytestream, alpha_component);
-        bytestream_put_byte(bytestream, 0x00);
+    for (y = y0; y <= y1; y++) {
+        const uint8_t *cur  = buf  + y * linesize;
+        const uint8_t *prev = last + y * w;
+        int x;
+
+        for (x = 0; x < x0 && cur[x] == prev[x]; x++)
+            ;
+        x0 = x;
+        for (x = w - 1; x > x1 && cur[x] == prev[x]; x--)
+            ;
+        x1 = x;
     }
 
-    return 0;
+    *x_start = x0;
+    *y_start = y0;
+    *width   = x1 - x0 + 1;
+    *height  = y1 - y0 + 1;
+}
+
+/**
+ * Pick a palette index used by none of the changed pixels of the
+ * rectangle, to mark the unchanged ones as transparent.
+ * @return the index, or -1 if all of them are used
+ */
+static int gif_transdiff_index(AVCodecContext *avctx, const uint8_t *buf,
+                               int linesize, int x_start, int y_start,
+                               int width, int height)
+{
+    GIFContext *s = avctx->priv_data;
+    uint8_t used[256] = { 0 };
+    int x, y;
+
+    for (y = y_start; y < y_start + height; y++) {
+        const uint8_t *cur  = buf + y * linesize;
+        const uint8_t *prev = s->last_frame + y * avctx->width;
+        for (x = x_start; x < x_start + width; x++)
+            if (cur[x] != prev[x])
+                used[cur[x]] = 1;
+    }
+    for (x = 255; x >= 0; x--)
+        if (!used[x])
+            return x;
+    return -1;
 }
 
 static int gif_image_write_image(AVCodecContext *avctx,
                                  uint8_t **bytestream, uint8_t *end,
+                                 const uint32_t *palette,
                                  const uint8_t *buf, int linesize)
 {
     GIFContext *s = avctx->priv_data;
-    int len = 0, height;
+    int len = 0, height = avctx->height, width = avctx->width, x_start = 0, y_start = 0;
+    int i, y, trans = -1, transdiff = 0, disposal = 0;
+    unsigned int smallest_alpha = 0xFF;
     const uint8_t *ptr;
+
+    for (i = 0; i < 256; i++) {
+        if (palette[i] >> 24 < smallest_alpha) {
+            smallest_alpha = palette[i] >> 24;
+            trans = i;
+        }
+    }
+    if (smallest_alpha >= 128)
+        trans = -1;
+
+    if (s->flags & (GF_OFFSETTING | GF_TRANSDIFF)) {
+        /* later frames are drawn over this one */
+        disposal = 1;
+        if (s->last_frame) {
+            if (s->flags & GF_OFFSETTING) {
+                gif_crop_image(avctx, buf, linesize, &x_start, &y_start,
+                               &width, &height);
+                if (!width) {
+                    /* nothing changed, a single unchanged pixel is enough */
+                    width = height = 1;
+                }
+            }
+            /* keep the transparent index of a palette with alpha */
+            if ((s->flags & GF_TRANSDIFF) && trans < 0) {
+                trans = gif_transdiff_index(avctx, buf, linesize, x_start,
+                                            y_start, width, height);
+                transdiff = trans >= 0;
+            }
+        }
+    }
+
+    if (trans >= 0 || disposal) {
+        bytestream_put_byte(bytestream, 0x21); /* Extension Introducer */
+        bytestream_put_byte(bytestream, 0xf9); /* Graphic Control Label */
+        bytestream_put_byte(bytestream, 0x04); /* block length */
+        bytestream_put_byte(bytestream, disposal << 2 | (trans >= 0)); /* Transparent Color Flag */
+        bytestream_put_le16(bytestream, 0x00); /* no delay */
+        bytestream_put_byte(bytestream, trans >= 0 ? trans : 0);
+        bytestream_put_byte(bytestream, 0x00);
+    }
+
     /* image block */
 
     bytestream_put_byte(bytestream, 0x2c);
-    bytestream_put_le16(bytestream, 0);
-    bytestream_put_le16(bytestream, 0);
-    bytestream_put_le16(bytestream, avctx->width);
-    bytestream_put_le16(bytestream, avctx->height);
-    bytestream_put_byte(bytestream, 0x00); /* flags */
-    /* no local clut */
+    bytestream_put_le16(bytestream, x_start);
+    bytestream_put_le16(bytestream, y_start);
+    bytestream_put_le16(bytestream, width);
+    bytestream_put_le16(bytestream, height);
+
+    if (!memcmp(palette, s->palette, AVPALETTE_SIZE)) {
+        bytestream_put_byte(bytestream, 0x00); /* flags */
+        /* no local clut */
+    } else {
+        bytestream_put_byte(bytestream, 0x87); /* flags: local clut, 256 entries */
+        for (i = 0; i < 256; i++)
+            bytestream_put_be24(bytestream, palette[i]);
+    }
 
     bytestream_put_byte(bytestream, 0x08);
 
     ff_lzw_encode_init(s->lzw, s->buf, avctx->width*avctx->height,
                        12, FF_LZW_GIF, put_bits);
 
-    ptr = buf;
-    for (height = avctx->height; height--;) {
-        len += ff_lzw_encode(s->lzw, ptr, avctx->width);
+    ptr = buf + y_start * linesize + x_start;
+    for (y = 0; y < height; y++) {
+        if (transdiff) {
+            const uint8_t *prev = s->last_frame + (y_start + y) * avctx->width + x_start;
+            for (i = 0; i < width; i++)
+                s->tmp_line[i] = ptr[i] == prev[i] ? trans : ptr[i];
+            len += ff_lzw_encode(s->lzw, s->tmp_line, width);
+        } else
+            len += ff_lzw_encode(s->lzw, ptr, width);
         ptr += linesize;
     }
     len += ff_lzw_encode_flush(s->lzw, flush_put_bits);
@@ -157,6 +278,11 @@ static av_cold int gif_encode_init(AVCodecContext *avctx)
     s->buf = av_malloc(avctx->width*avctx->height*2);
     if (!s->buf)
          return AVERROR(ENOMEM);
+    if (s->flags & GF_TRANSDIFF) {
+        s->tmp_line = av_malloc(avctx->width);
+        if (!s->tmp_line)
+            return AVERROR(ENOMEM);
+    }
     return 0;
 }
 
@@ -177,8 +303,26 @@ static int gif_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     *p = *pict;
     p->pict_type = AV_PICTURE_TYPE_I;
     p->key_frame = 1;
-    gif_image_write_header(avctx, &outbuf_ptr, (uint32_t *)pict->data[1]);
-    gif_image_write_image(avctx, &outbuf_ptr, end, pict->data[0], pict->linesize[0]);
+    if (!s->palette_loaded) {
+        memcpy(s->palette, pict->data[1], AVPALETTE_SIZE);
+        s->palette_loaded = 1;
+    }
+    gif_image_write_header(avctx, &outbuf_ptr, s->palette);
+    gif_image_write_image(avctx, &outbuf_ptr, end, (uint32_t *)pict->data[1],
+                          pict->data[0], pict->linesize[0]);
+
+    if (s->flags & (GF_OFFSETTING | GF_TRANSDIFF)) {
+        int y;
+
+        if (!s->last_frame) {
+            s->last_frame = av_malloc(avctx->width * avctx->height);
+            if (!s->last_frame)
+                return AVERROR(ENOMEM);
+        }
+        for (y = 0; y < avctx->height; y++)
+            memcpy(s->last_frame + y * avctx->width,
+                   pict->data[0] + y * pict->linesize[0], avctx->width);
+    }
 
     pkt->size   = outbuf_ptr - pkt->data;
     pkt->flags |= AV_PKT_FLAG_KEY;
@@ -193,9 +337,30 @@ static int gif_encode_close(AVCodecContext *avctx)
 
     av_freep(&s->lzw);
     av_freep(&s->buf);
+    av_freep(&s->last_frame);
+    av_freep(&s->tmp_line);
     return 0;
 }
 
+#define OFFSET(x) offsetof(GIFContext, x)
+#define FLAGS AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_ENCODING_PARAM
+static const AVOption gif_options[] = {
+    { "gifflags", "set GIF flags for animations, each packet then only draws over the previous one",
+      OFFSET(flags), AV_OPT_TYPE_FLAGS, {.i64 = 0}, 0, INT_MAX, FLAGS, "flags" },
+        { "offsetting", "only code the rectangle which changed since the previous frame",
+          0, AV_OPT_TYPE_CONST, {.i64 = GF_OFFSETTING}, INT_MIN, INT_MAX, FLAGS, "flags" },
+        { "transdiff", "code the pixels which did not change as transparent",
+          0, AV_OPT_TYPE_CONST, {.i64 = GF_TRANSDIFF}, INT_MIN, INT_MAX, FLAGS, "flags" },
+    { NULL }
+};
+
+static const AVClass gif_class = {
+    .class_name = "GIF encoder",
+    .item_name  = av_default_item_name,
+    .option     = gif_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 AVCodec ff_gif_encoder = {
     .name           = "gif",
     .type           = AVMEDIA_TYPE_VIDEO,
@@ -204,6 +369,7 @@ AVCodec ff_gif_encoder = {
     .init           = gif_encode_init,
     .encode2        = gif_encode_frame,
     .close          = gif_encode_close,
+    .priv_class     = &gif_class,
     .pix_fmts       = (const enum AVPixelFormat[]){
         AV_PIX_FMT_RGB8, AV_PIX_FMT_BGR8, AV_PIX_FMT_RGB4_BYTE, AV_PIX_FMT_BGR4_BYTE,
         AV_PIX_FMT_GRAY8, AV_PIX_FMT_PAL8, AV_PIX_FMT_NONE
@@ -345,6 +345,36 @@ static int decode_slice(MpegEncContext *s){
     return AVERROR_INVALIDDATA;
 }
 
+/**
+ * Find the frame packed after the current one (divx 5.01+/xvid packed
+ * B-frames).
+ * @param pos position in buf where the current frame ends
+ * @return position of the packed frame in buf, or -1 if there is none
+ */
+static int find_packed_frame(const uint8_t *buf, int buf_size, int pos)
+{
+    int i;
+
+    if (buf_size - pos > 7) {
+        for (i = pos; i < buf_size - 4; i++) {
+            if (buf[i] == 0 && buf[i+1] == 0 && buf[i+2] == 1 && buf[i+3] == 0xB6)
+                return (buf[i+4] & 0x40) ? -1 : pos;
+        }
+    }
+    return -1;
+}
+
+static int store_packed_frame(MpegEncContext *s, const uint8_t *buf, int buf_size, int pos)
+{
+    av_fast_malloc(&s->bitstream_buffer, &s->allocated_bitstream_buffer_size,
+                   buf_size - pos + FF_INPUT_BUFFER_PADDING_SIZE);
+    if (!s->bitstream_buffer)
+        return AVERROR(ENOMEM);
+    memcpy(s->bitstream_buffer, buf + pos, buf_size - pos);
+    s->bitstream_buffer_size = buf_size - pos;
+    return 0;
+}
+
 int ff_h263_decode_frame(AVCodecContext *avctx,
                              void *data, int *got_frame,
                              AVPacket *avpkt)
@@ -353,6 +383,7 @@ int ff_h263_decode_frame(AVCodecContext *avctx,
     int buf_size = avpkt->size;
     MpegEncContext *s = avctx->priv_data;
     int ret;
+    int packed_pos = -1, packed_stored = 0;
     AVFrame *pict = data;
 
 #ifdef PRINT_FRAME_TIME
@@ -657,7 +688,32 @@ retry:
     if ((ret = ff_MPV_frame_start(s, avctx)) < 0)
         return ret;
 
-    if (!s->divx_packed) ff_thread_finish_setup(avctx);
+    /* divx 5.01+ bitstream reorder stuff
+     * The packed frame is stored before decoding the current one, so that
+     * the next frame thread can start with it. Start codes cannot occur
+     * inside a VOP, so the current VOP ends at the next start code. */
+    if (s->codec_id == AV_CODEC_ID_MPEG4 && s->divx_packed) {
+        if (s->gb.buffer == s->bitstream_buffer) {
+            packed_pos = find_packed_frame(buf, buf_size, 0);
+        } else {
+            int end = get_bits_count(&s->gb) >> 3;
+            while (end < buf_size - 3 &&
+                   (buf[end] || buf[end+1] || buf[end+2] != 1))
+                end++;
+            packed_pos = find_packed_frame(buf, buf_size, end);
+        }
+        /* the bitstream buffer is still needed if the current frame is
+         * read from it, in which case the new one is stored at the end */
+        if (packed_pos < 0 || s->gb.buffer != s->bitstream_buffer) {
+            if (packed_pos >= 0 &&
+                (ret = store_packed_frame(s, buf, buf_size, packed_pos)) < 0)
+                return ret;
+            packed_stored = 1;
+        }
+    }
+
+    if (!s->divx_packed || packed_stored)
+        ff_thread_finish_setup(avctx);
 
     if (CONFIG_MPEG4_VDPAU_DECODER && (s->avctx->codec->capabilities & CODEC_CAP_HWACCEL_VDPAU)) {
         ff_vdpau_mpeg4_decode_picture(s, s->gb.buffer, s->gb.buffer_end - s->gb.buffer);
@@ -707,33 +763,12 @@ retry:
             s->error_status_table[s->mb_num-1]= ER_MB_ERROR;
         }
 
-    av_assert1(s->bitstream_buffer_size==0);
+    av_assert1(s->bitstream_buffer_size==0 || packed_stored);
 frame_end:
-    /* divx 5.01+ bitstream reorder stuff */
-    if(s->codec_id==AV_CODEC_ID_MPEG4 && s->divx_packed){
-        int current_pos= s->gb.buffer == s->bitstream_buffer ? 0 : (get_bits_count(&s->gb)>>3);
-        int startcode_found=0;
-
-        if(buf_size - current_pos > 7){
-            int i;
-            for(i=current_pos; i<buf_size-4; i++){
-                if(buf[i]==0 && buf[i+1]==0 && buf[i+2]==1 && buf[i+3]==0xB6){
-                    startcode_found=!(buf[i+4]&0x40);
-                    break;
-                }
-            }
-        }
-
-        if(startcode_found){
-            av_fast_malloc(
-                &s->bitstream_buffer,
-                &s->allocated_bitstream_buffer_size,
-                buf_size - current_pos + FF_INPUT_BUFFER_PADDING_SIZE);
-            if (!s->bitstream_buffer)
-                return AVERROR(ENOMEM);
-            memcpy(s->bitstream_buffer, buf + current_pos, buf_size - current_pos);
-            s->bitstream_buffer_size= buf_size - current_pos;
-        }
+    if (packed_pos >= 0 && !packed_stored) {
+        int err = store_packed_frame(s, buf, buf_size, packed_pos);
+        if (err < 0)
+            return err;
     }
 
 intrax8_decoded:
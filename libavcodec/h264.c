@@ -50,6 +50,14 @@
 
 const uint16_t ff_h264_mb_sizes[4] = { 256, 384, 512, 768 };
 
+/**
+ * Fast preview: only reference frames are decoded and output quality does
+ * not matter, so the reference frames use the 2-tap qpel approximation too
+ * and error concealment is skipped.
+ */
+#define FAST_PREVIEW(s) (((s)->avctx->flags2 & CODEC_FLAG2_FAST) && \
+                         (s)->avctx->skip_frame >= AVDISCARD_NONREF)
+
 static const uint8_t rem6[QP_MAX_NUM + 1] = {
     0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 0, 1, 2,
     3, 4, 5, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5,
@@ -783,6 +791,7 @@ static void free_tables(H264Context *h, int free_rbsp)
 
     av_freep(&h->mb2b_xy);
     av_freep(&h->mb2br_xy);
+    av_freep(&h->lf_context);
 
     for (i = 0; i < MAX_THREADS; i++) {
         hx = h->thread_context[i];
@@ -858,6 +867,7 @@ static void init_dequant4_coeff_table(H264Context *h)
 static void init_dequant_tables(H264Context *h)
 {
     int i, x;
+    h->dequant_coeff_gen++;
     init_dequant4_coeff_table(h);
     if (h->pps.transform_8x8_mode)
         init_dequant8_coeff_table(h);
@@ -1287,8 +1297,11 @@ static int decode_update_thread_context(AVCodecContext *dst,
     h->pps = h1->pps;
 
     // Dequantization matrices
-    // FIXME these are big - can they be only copied when PPS changes?
-    copy_fields(h, h1, dequant4_buffer, dequant4_coeff);
+    // these are big, so only copy them when they were rebuilt
+    if (h->dequant_coeff_gen != h1->dequant_coeff_gen) {
+        copy_fields(h, h1, dequant4_buffer, dequant4_coeff);
+        h->dequant_coeff_gen = h1->dequant_coeff_gen;
+    }
 
     for (i = 0; i < 6; i++)
         h->dequant4_coeff[i] = h->dequant4_buffer[0] +
@@ -2358,7 +2371,7 @@ static int field_end(H264Context *h, int in_setup)
      * past end by one (callers fault) and resync_mb_y != 0
      * causes problems for the first MB line, too.
      */
-    if (!FIELD_PICTURE)
+    if (!FIELD_PICTURE && !FAST_PREVIEW(s))
         ff_er_frame_end(s);
 
     ff_MPV_frame_end(s);
@@ -2668,7 +2681,7 @@ static int decode_slice_header(H264Context *h, H264Context *h0)
 
     /* FIXME: 2tap qpel isn't implemented for high bit depth. */
     if ((s->avctx->flags2 & CODEC_FLAG2_FAST) &&
-        !h->nal_ref_idc && !h->pixel_shift) {
+        (!h->nal_ref_idc || FAST_PREVIEW(s)) && !h->pixel_shift) {
         s->me.qpel_put = s->dsp.put_2tap_qpel_pixels_tab;
         s->me.qpel_avg = s->dsp.avg_2tap_qpel_pixels_tab;
     } else {
@@ -3702,6 +3715,78 @@ static void decode_finish_row(H264Context *h)
                               s->picture_structure == PICT_BOTTOM_FIELD);
 }
 
+/* added to the reported row count once the decoding job stops handing rows
+ * to the loop filter job */
+#define LF_PIPELINE_DONE (1 << 30)
+
+/**
+ * Wait until the loop filter job is far enough ahead in the previous MB
+ * row: the intra prediction of this MB swaps the unfiltered top border
+ * into the picture, up to 8 pixels into the neighbouring MBs, and the
+ * filtering of a MB changes the 3 rightmost columns of its left neighbour.
+ */
+static av_always_inline void lf_pipeline_await(H264Context *h)
+{
+    MpegEncContext *const s = &h->s;
+
+    if (h->lf_pipeline && s->mb_y > h->lf_first_row)
+        ff_thread_await_progress2(s->avctx, 1, (s->mb_y - 1) * s->mb_width +
+                                  FFMIN(s->mb_x + 3, s->mb_width));
+}
+
+/**
+ * Hand the MB row that was just decoded to the loop filter job.
+ */
+static void lf_pipeline_report_row(H264Context *h)
+{
+    MpegEncContext *const s = &h->s;
+
+    h->lf_rows_done = s->mb_y + 1;
+    ff_thread_report_progress2(s->avctx, 0, h->lf_rows_done);
+}
+
+/**
+ * Stop handing rows to the loop filter job and wait until it has filtered
+ * all rows already handed to it.
+ */
+static void lf_pipeline_finish(H264Context *h)
+{
+    MpegEncContext *const s = &h->s;
+
+    if (!h->lf_pipeline)
+        return;
+    h->lf_pipeline = 0;
+
+    ff_thread_report_progress2(s->avctx, 0, LF_PIPELINE_DONE + h->lf_rows_done);
+    if (h->lf_rows_done > h->lf_first_row)
+        ff_thread_await_progress2(s->avctx, 1, h->lf_rows_done * s->mb_width);
+}
+
+/**
+ * Loop filter job: deblock the rows handed over by the decoding job as
+ * soon as they are complete.
+ */
+static void lf_pipeline_filter_rows(H264Context *h)
+{
+    MpegEncContext *const s = &h->s;
+    int mb_x, mb_y, rows;
+
+    for (mb_y = h->lf_first_row; ; mb_y++) {
+        rows = ff_thread_await_progress2(s->avctx, 0, mb_y + 1);
+        if (rows >= LF_PIPELINE_DONE && mb_y >= rows - LF_PIPELINE_DONE)
+            break;
+
+        s->mb_y = mb_y;
+        for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
+            loop_filter(h, mb_x, mb_x + 1);
+            if (mb_x < s->mb_width - 1)
+                ff_thread_report_progress2(s->avctx, 1, mb_y * s->mb_width + mb_x + 1);
+        }
+        decode_finish_row(h);
+        ff_thread_report_progress2(s->avctx, 1, (mb_y + 1) * s->mb_width);
+    }
+}
+
 static int decode_slice(struct AVCodecContext *avctx, void *arg)
 {
     H264Context *h = *(void **)arg;
@@ -3729,8 +3814,10 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
 
         for (;;) {
             // START_TIMER
-            int ret = ff_h264_decode_mb_cabac(h);
-            int eos;
+            int ret, eos;
+
+            lf_pipeline_await(h);
+            ret = ff_h264_decode_mb_cabac(h);
             // STOP_TIMER("decode_mb_cabac")
 
             if (ret >= 0)
@@ -3752,6 +3839,7 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
                 h->cabac.bytestream > h->cabac.bytestream_end + 2) {
                 ff_er_add_slice(s, s->resync_mb_x, s->resync_mb_y, s->mb_x - 1,
                                 s->mb_y, ER_MB_END & part_mask);
+                lf_pipeline_finish(h);
                 if (s->mb_x >= lf_x_start)
                     loop_filter(h, lf_x_start, s->mb_x + 1);
                 return 0;
@@ -3769,9 +3857,14 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
             }
 
             if (++s->mb_x >= s->mb_width) {
-                loop_filter(h, lf_x_start, s->mb_x);
-                s->mb_x = lf_x_start = 0;
-                decode_finish_row(h);
+                if (h->lf_pipeline && !lf_x_start) {
+                    lf_pipeline_report_row(h);
+                    s->mb_x = 0;
+                } else {
+                    loop_filter(h, lf_x_start, s->mb_x);
+                    s->mb_x = lf_x_start = 0;
+                    decode_finish_row(h);
+                }
                 ++s->mb_y;
                 if (FIELD_OR_MBAFF_PICTURE) {
                     ++s->mb_y;
@@ -3785,6 +3878,7 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
                         get_bits_count(&s->gb), s->gb.size_in_bits);
                 ff_er_add_slice(s, s->resync_mb_x, s->resync_mb_y, s->mb_x - 1,
                                 s->mb_y, ER_MB_END & part_mask);
+                lf_pipeline_finish(h);
                 if (s->mb_x > lf_x_start)
                     loop_filter(h, lf_x_start, s->mb_x);
                 return 0;
@@ -3792,7 +3886,10 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
         }
     } else {
         for (;;) {
-            int ret = ff_h264_decode_mb_cavlc(h);
+            int ret;
+
+            lf_pipeline_await(h);
+            ret = ff_h264_decode_mb_cavlc(h);
 
             if (ret >= 0)
                 ff_h264_hl_decode_mb(h);
@@ -3816,9 +3913,14 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
             }
 
             if (++s->mb_x >= s->mb_width) {
-                loop_filter(h, lf_x_start, s->mb_x);
-                s->mb_x = lf_x_start = 0;
-                decode_finish_row(h);
+                if (h->lf_pipeline && !lf_x_start) {
+                    lf_pipeline_report_row(h);
+                    s->mb_x = 0;
+                } else {
+                    loop_filter(h, lf_x_start, s->mb_x);
+                    s->mb_x = lf_x_start = 0;
+                    decode_finish_row(h);
+                }
                 ++s->mb_y;
                 if (FIELD_OR_MBAFF_PICTURE) {
                     ++s->mb_y;
@@ -3853,6 +3955,7 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
                     ff_er_add_slice(s, s->resync_mb_x, s->resync_mb_y,
                                     s->mb_x - 1, s->mb_y,
                                     ER_MB_END & part_mask);
+                    lf_pipeline_finish(h);
                     if (s->mb_x > lf_x_start)
                         loop_filter(h, lf_x_start, s->mb_x);
 
@@ -3868,6 +3971,53 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
     }
 }
 
+static int decode_slice_lf_pipeline(AVCodecContext *avctx, void *arg,
+                                    int jobnr, int threadnr)
+{
+    H264Context *h = arg;
+    int ret = 0;
+
+    if (jobnr) {
+        lf_pipeline_filter_rows(h->lf_context);
+    } else {
+        ret = decode_slice(avctx, &h);
+        lf_pipeline_finish(h);
+    }
+    return ret;
+}
+
+/**
+ * Decode a slice with the deblocking of its complete MB rows running in a
+ * second job, one row behind the decoding.
+ * Entropy decoding and reconstruction stay serial, so this also helps
+ * pictures coded as a single slice and adds no latency.
+ */
+static int decode_slice_pipelined(H264Context *h)
+{
+    MpegEncContext *const s     = &h->s;
+    AVCodecContext *const avctx = s->avctx;
+    int ret[2];
+
+    if (!h->lf_context) {
+        h->lf_context = av_malloc(sizeof(H264Context));
+        if (!h->lf_context)
+            return AVERROR(ENOMEM);
+    }
+    if ((ret[0] = ff_alloc_entries(avctx, 2)) < 0)
+        return ret[0];
+
+    h->lf_pipeline  = 1;
+    h->lf_first_row = s->mb_y + !!s->mb_x;
+    h->lf_rows_done = h->lf_first_row;
+    /* the loop filter job works on a copy of the slice state, sharing the
+     * tables and the top borders with the decoding job */
+    memcpy(h->lf_context, h, sizeof(H264Context));
+
+    avctx->execute2(avctx, decode_slice_lf_pipeline, h, ret, 2);
+
+    return ret[0];
+}
+
 /**
  * Call decode_slice() for each context.
  *
@@ -3885,6 +4035,11 @@ static int execute_decode_slices(H264Context *h, int context_count)
         s->avctx->codec->capabilities & CODEC_CAP_HWACCEL_VDPAU)
         return 0;
     if (context_count == 1) {
+        if (avctx->active_thread_type & FF_THREAD_SLICE &&
+            avctx->thread_count > 1 && h->deblocking_filter &&
+            s->picture_structure == PICT_FRAME && !FRAME_MBAFF &&
+            s->mb_height > 1)
+            return decode_slice_pipelined(h);
         return decode_slice(avctx, &h);
     } else {
         for (i = 1; i < context_count; i++) {
@@ -458,6 +458,7 @@ typedef struct H264Context {
     PPS *pps_buffers[MAX_PPS_COUNT];
 
     int dequant_coeff_pps;      ///< reinit tables when pps changes
+    unsigned dequant_coeff_gen; ///< incremented whenever the dequant tables are rebuilt
 
     uint16_t *slice_table_base;
 
@@ -602,6 +603,16 @@ typedef struct H264Context {
     uint8_t parse_history[4];
     int parse_history_count;
     int parse_last_mb;
+
+    /**
+     * Deblocking of complete MB rows running in a second slice thread
+     * job, pipelined against the decoding of the following rows.
+     * Used for single slice pictures with slice threading.
+     */
+    int lf_pipeline;
+    int lf_first_row;               ///< first MB row deblocked by the loop filter job
+    int lf_rows_done;               ///< MB rows before this one are decoded and handed to the loop filter job
+    struct H264Context *lf_context; ///< context used by the loop filter job
 } H264Context;
 
 extern const uint8_t ff_h264_chroma_qp[7][QP_MAX_NUM + 1]; ///< One chroma qp table for each possible bit depth (8-14).
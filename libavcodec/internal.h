@@ -33,6 +33,7 @@
 #define FF_SANE_NB_CHANNELS 128U
 
 typedef struct InternalBuffer {
+    AVBufferRef *buf[AV_NUM_DATA_POINTERS]; ///< the planes' memory, base[i] == buf[i]->data
     uint8_t *base[AV_NUM_DATA_POINTERS];
     uint8_t *data[AV_NUM_DATA_POINTERS];
     int linesize[AV_NUM_DATA_POINTERS];
@@ -54,6 +55,14 @@ typedef struct AVCodecInternal {
      */
     InternalBuffer *buffer;
 
+    /**
+     * pools the planes of the internal buffers are allocated from, so that
+     * replacing a buffer still referenced elsewhere does not hit the
+     * allocator, and their buffer sizes
+     */
+    AVBufferPool *pool[4];
+    int pool_size[4];
+
     /**
      * Whether the parent AVCodecContext is a copy of the context which had
      * init() called on it.
@@ -78,9 +87,10 @@ typedef struct AVCodecInternal {
 
     /**
      * The data for the last allocated audio frame.
-     * Stored here so we can free it.
+     * Stored here so we can free it, and reused by the next frame.
      */
     uint8_t *audio_data;
+    unsigned int audio_data_size;
 
     /**
      * temporary buffer used for encoders to store their bitstream
@@ -129,6 +139,14 @@ void ff_init_buffer_info(AVCodecContext *s, AVFrame *frame);
  */
 void ff_packet_free_side_data(AVPacket *pkt);
 
+/**
+ * The codec does not modify any global variables in the init and close
+ * functions, so avcodec_open2() and avcodec_close() do not need to take
+ * the global codec lock for it. Such codecs must not call
+ * ff_codec_open2_recursive() or ff_codec_close_recursive().
+ */
+#define FF_CODEC_CAP_INIT_THREADSAFE        (1 << 0)
+
 extern volatile int ff_avcodec_locked;
 int ff_lock_avcodec(AVCodecContext *log_ctx);
 int ff_unlock_avcodec(void);
@@ -189,6 +207,17 @@ int ff_get_logical_cpus(AVCodecContext *avctx);
 
 int avpriv_h264_has_num_reorder_frames(AVCodecContext *avctx);
 
+/**
+ * Make pkt reference size bytes at data, which must lie inside buf and be
+ * followed by FF_INPUT_BUFFER_PADDING_SIZE bytes of buf, instead of
+ * owning a copy of them. A new reference to buf is taken, and released
+ * when the packet is freed. av_copy_packet() and av_dup_packet() share
+ * the data of such packets instead of duplicating it.
+ *
+ * @return 0 on success, a negative AVERROR on failure
+ */
+int avpriv_packet_from_buffer(AVPacket *pkt, AVBufferRef *buf, uint8_t *data, int size);
+
 /**
  * Call avcodec_open2 recursively by decrementing counter, unlocking mutex,
  * calling the function and then restoring again. Assumes the mutex is
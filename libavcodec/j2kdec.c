@@ -47,6 +47,15 @@ typedef struct {
    J2kQuantStyle  qntsty[4];
 } J2kTile;
 
+/** a code-block of a tile, with its position in the component data */
+typedef struct {
+    J2kCblk *cblk;
+    J2kBand *band;
+    int compno;
+    int bandpos;
+    int x0, x1, y0, y1;
+} J2kCblkJob;
+
 typedef struct {
     AVCodecContext *avctx;
     AVFrame picture;
@@ -73,6 +82,9 @@ typedef struct {
     int curtileno;
 
     J2kTile *tile;
+
+    J2kCblkJob *cblk_jobs;       ///< code-blocks of the tile being decoded
+    unsigned int cblk_jobs_size;
 } J2kDecoderContext;
 
 static int get_bits(J2kDecoderContext *s, int n)
@@ -786,13 +798,80 @@ static void mct_decode(J2kDecoderContext *s, J2kTile *tile)
     }
 }
 
-static int decode_tile(J2kDecoderContext *s, J2kTile *tile)
+/**
+ * Decode one code-block and dequantize it into the component data.
+ * The code-blocks of a tile do not overlap, so they are decoded in parallel.
+ */
+static int decode_cblk_thread(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
 {
-    int compno, reslevelno, bandno;
-    int x, y, *src[4];
-    uint8_t *line;
+    J2kDecoderContext *s = avctx->priv_data;
+    J2kTile *tile = arg;
+    J2kCblkJob *job = s->cblk_jobs + jobnr;
+    J2kComponent *comp = tile->comp + job->compno;
+    J2kCodingStyle *codsty = tile->codsty + job->compno;
+    int cdx = s->cdx[job->compno], cdy = s->cdy[job->compno];
+    int w = comp->coord[0][1] - comp->coord[0][0];
+    int x, y;
     J2kT1Context t1;
 
+    decode_cblk(s, codsty, &t1, job->cblk, job->x1 - job->x0, job->y1 - job->y0,
+                job->bandpos);
+    if (codsty->transform == FF_DWT53){
+        for (y = job->y0; y < job->y1; y += cdy){
+            int *ptr = t1.data[y - job->y0];
+            for (x = job->x0; x < job->x1; x += cdx){
+                comp->data[w * y + x] = *ptr++ >> 1;
+            }
+        }
+    } else{
+        for (y = job->y0; y < job->y1; y += cdy){
+            int *ptr = t1.data[y - job->y0];
+            for (x = job->x0; x < job->x1; x += cdx){
+                int tmp = ((int64_t)*ptr++) * ((int64_t)job->band->stepsize) >> 13, tmp2;
+                tmp2 = FFABS(tmp>>1) + (tmp&1);
+                comp->data[w * y + x] = tmp < 0 ? -tmp2 : tmp2;
+            }
+        }
+    }
+    return 0;
+}
+
+static int dwt_decode_thread(AVCodecContext *avctx, void *arg, int compno, int threadnr)
+{
+    J2kTile *tile = arg;
+    J2kComponent *comp = tile->comp + compno;
+
+    ff_j2k_dwt_decode(&comp->dwt, comp->data);
+    return 0;
+}
+
+/**
+ * Collect the code-blocks of a tile into s->cblk_jobs.
+ * @return the number of code-blocks or a negative error code
+ */
+static int get_cblk_jobs(J2kDecoderContext *s, J2kTile *tile)
+{
+    int compno, reslevelno, bandno, nb_jobs = 0;
+    J2kCblkJob *job;
+
+    for (compno = 0; compno < s->ncomponents; compno++){
+        J2kComponent *comp = tile->comp + compno;
+        J2kCodingStyle *codsty = tile->codsty + compno;
+
+        for (reslevelno = 0; reslevelno < codsty->nreslevels; reslevelno++){
+            J2kResLevel *rlevel = comp->reslevel + reslevelno;
+            for (bandno = 0; bandno < rlevel->nbands; bandno++)
+                nb_jobs += rlevel->band[bandno].cblknx * rlevel->band[bandno].cblkny;
+        }
+    }
+
+    if (!nb_jobs)
+        return 0;
+    av_fast_malloc(&s->cblk_jobs, &s->cblk_jobs_size, nb_jobs * sizeof(*s->cblk_jobs));
+    if (!s->cblk_jobs)
+        return AVERROR(ENOMEM);
+    job = s->cblk_jobs;
+
     for (compno = 0; compno < s->ncomponents; compno++){
         J2kComponent *comp = tile->comp + compno;
         J2kCodingStyle *codsty = tile->codsty + compno;
@@ -823,25 +902,16 @@ static int decode_tile(J2kDecoderContext *s, J2kTile *tile)
                                 band->coord[0][1]) - band->coord[0][0] + xx0;
 
                     for (cblkx = 0; cblkx < band->cblknx; cblkx++, cblkno++){
-                        int y, x;
-                        decode_cblk(s, codsty, &t1, band->cblk + cblkno, xx1 - xx0, yy1 - yy0, bandpos);
-                        if (codsty->transform == FF_DWT53){
-                            for (y = yy0; y < yy1; y+=s->cdy[compno]){
-                                int *ptr = t1.data[y-yy0];
-                                for (x = xx0; x < xx1; x+=s->cdx[compno]){
-                                    comp->data[(comp->coord[0][1] - comp->coord[0][0]) * y + x] = *ptr++ >> 1;
-                                }
-                            }
-                        } else{
-                            for (y = yy0; y < yy1; y+=s->cdy[compno]){
-                                int *ptr = t1.data[y-yy0];
-                                for (x = xx0; x < xx1; x+=s->cdx[compno]){
-                                    int tmp = ((int64_t)*ptr++) * ((int64_t)band->stepsize) >> 13, tmp2;
-                                    tmp2 = FFABS(tmp>>1) + (tmp&1);
-                                    comp->data[(comp->coord[0][1] - comp->coord[0][0]) * y + x] = tmp < 0 ? -tmp2 : tmp2;
-                                }
-                            }
-                        }
+                        job->cblk    = band->cblk + cblkno;
+                        job->band    = band;
+                        job->compno  = compno;
+                        job->bandpos = bandpos;
+                        job->x0      = xx0;
+                        job->x1      = xx1;
+                        job->y0      = yy0;
+                        job->y1      = yy1;
+                        job++;
+
                         xx0 = xx1;
                         xx1 = FFMIN(xx1 + band->codeblock_width, band->coord[0][1] - band->coord[0][0] + x0);
                     }
@@ -850,9 +920,25 @@ static int decode_tile(J2kDecoderContext *s, J2kTile *tile)
                 }
             }
         }
-        ff_j2k_dwt_decode(&comp->dwt, comp->data);
-        src[compno] = comp->data;
     }
+    return job - s->cblk_jobs;
+}
+
+static int decode_tile(J2kDecoderContext *s, J2kTile *tile)
+{
+    int compno, nb_jobs;
+    int x, y, *src[4];
+    uint8_t *line;
+
+    if ((nb_jobs = get_cblk_jobs(s, tile)) < 0)
+        return nb_jobs;
+
+    s->avctx->execute2(s->avctx, decode_cblk_thread, tile, NULL, nb_jobs);
+    s->avctx->execute2(s->avctx, dwt_decode_thread, tile, NULL, s->ncomponents);
+
+    for (compno = 0; compno < s->ncomponents; compno++)
+        src[compno] = tile->comp[compno].data;
+
     if (tile->codsty[0].mct)
         mct_decode(s, tile);
 
@@ -1090,6 +1176,7 @@ static av_cold int decode_end(AVCodecContext *avctx)
 
     if (s->picture.data[0])
         avctx->release_buffer(avctx, &s->picture);
+    av_freep(&s->cblk_jobs);
 
     return 0;
 }
@@ -1102,6 +1189,6 @@ AVCodec ff_jpeg2000_decoder = {
     .init           = j2kdec_init,
     .close          = decode_end,
     .decode         = decode_frame,
-    .capabilities   = CODEC_CAP_EXPERIMENTAL,
+    .capabilities   = CODEC_CAP_EXPERIMENTAL | CODEC_CAP_SLICE_THREADS,
     .long_name      = NULL_IF_CONFIG_SMALL("JPEG 2000"),
 };
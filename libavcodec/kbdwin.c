@@ -17,8 +17,10 @@
  */
 
 
-#include <libavutil/avassert.h>
-#include <libavutil/mathematics.h>
+#include <assert.h>
+// do not use libavutil/avassert.h since this is also compiled
+// for the host by aac_tablegen
+#include "libavutil/mathematics.h"
 #include "libavutil/attributes.h"
 #include "kbdwin.h"
 
@@ -31,7 +33,7 @@ av_cold void ff_kbd_window_init(float *window, float alpha, int n)
    double local_window[FF_KBD_WINDOW_MAX];
    double alpha2 = (alpha * M_PI / n) * (alpha * M_PI / n);
 
-   av_assert0(n <= FF_KBD_WINDOW_MAX);
+   assert(n <= FF_KBD_WINDOW_MAX);
 
    for (i = 0; i < n; i++) {
        tmp = i * (n - i) * alpha2;
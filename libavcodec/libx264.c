@@ -73,6 +73,11 @@ typedef struct X264Context {
     int slice_max_size;
     char *stats;
     int nal_hrd;
+
+    /* AVFrame.reordered_opaque of the frames queued in the encoder,
+     * referenced through x264_picture_t.opaque */
+    int64_t *reordered_opaque;
+    int nb_reordered_opaque, next_reordered_opaque;
 } X264Context;
 
 static void X264_log(void *p, int level, const char *fmt, va_list args)
@@ -139,6 +144,9 @@ static int avfmt2_num_planes(int avfmt)
     case AV_PIX_FMT_YUV444P:
         return 3;
 
+    case AV_PIX_FMT_NV12:
+        return 2;
+
     case AV_PIX_FMT_BGR24:
     case AV_PIX_FMT_RGB24:
         return 1;
@@ -169,6 +177,12 @@ static int X264_frame(AVCodecContext *ctx, AVPacket *pkt, const AVFrame *frame,
         }
 
         x4->pic.i_pts  = frame->pts;
+
+        x4->reordered_opaque[x4->next_reordered_opaque] = frame->reordered_opaque;
+        x4->pic.opaque = &x4->reordered_opaque[x4->next_reordered_opaque];
+        if (++x4->next_reordered_opaque == x4->nb_reordered_opaque)
+            x4->next_reordered_opaque = 0;
+
         x4->pic.i_type =
             frame->pict_type == AV_PICTURE_TYPE_I ? X264_TYPE_KEYFRAME :
             frame->pict_type == AV_PICTURE_TYPE_P ? X264_TYPE_P :
@@ -197,6 +211,8 @@ static int X264_frame(AVCodecContext *ctx, AVPacket *pkt, const AVFrame *frame,
 
     pkt->pts = pic_out.i_pts;
     pkt->dts = pic_out.i_dts;
+    if (ret && pic_out.opaque)
+        ctx->reordered_opaque = *(int64_t *)pic_out.opaque;
 
     switch (pic_out.i_type) {
     case X264_TYPE_IDR:
@@ -226,6 +242,7 @@ static av_cold int X264_close(AVCodecContext *avctx)
 
     av_freep(&avctx->extradata);
     av_free(x4->sei);
+    av_freep(&x4->reordered_opaque);
 
     if (x4->enc)
         x264_encoder_close(x4->enc);
@@ -254,6 +271,7 @@ static int convert_pix_fmt(enum AVPixelFormat pix_fmt)
     case AV_PIX_FMT_YUVJ420P:
     case AV_PIX_FMT_YUV420P9:
     case AV_PIX_FMT_YUV420P10: return X264_CSP_I420;
+    case AV_PIX_FMT_NV12:      return X264_CSP_NV12;
     case AV_PIX_FMT_YUV422P:
     case AV_PIX_FMT_YUV422P10: return X264_CSP_I422;
     case AV_PIX_FMT_YUV444P:
@@ -536,6 +554,12 @@ static av_cold int X264_init(AVCodecContext *avctx)
 
     avctx->coded_frame = &x4->out_pic;
 
+    x4->nb_reordered_opaque = x264_encoder_maximum_delayed_frames(x4->enc) + 1;
+    x4->reordered_opaque    = av_malloc(x4->nb_reordered_opaque *
+                                        sizeof(*x4->reordered_opaque));
+    if (!x4->reordered_opaque)
+        return AVERROR(ENOMEM);
+
     if (avctx->flags & CODEC_FLAG_GLOBAL_HEADER) {
         x264_nal_t *nal;
         uint8_t *p;
@@ -567,6 +591,7 @@ static const enum AVPixelFormat pix_fmts_8bit[] = {
     AV_PIX_FMT_YUVJ420P,
     AV_PIX_FMT_YUV422P,
     AV_PIX_FMT_YUV444P,
+    AV_PIX_FMT_NV12,
     AV_PIX_FMT_NONE
 };
 static const enum AVPixelFormat pix_fmts_9bit[] = {
@@ -711,6 +736,7 @@ AVCodec ff_libx264_encoder = {
     .priv_class       = &class,
     .defaults         = x264_defaults,
     .init_static_data = X264_init_static,
+    .caps_internal    = FF_CODEC_CAP_INIT_THREADSAFE,
 };
 
 AVCodec ff_libx264rgb_encoder = {
@@ -726,4 +752,5 @@ AVCodec ff_libx264rgb_encoder = {
     .priv_class     = &rgbclass,
     .defaults       = x264_defaults,
     .pix_fmts       = pix_fmts_8bit_rgb,
+    .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE,
 };
@@ -62,6 +62,7 @@ struct LZWState {
     uint8_t stack[LZW_SIZTABLE];
     uint8_t suffix[LZW_SIZTABLE];
     uint16_t prefix[LZW_SIZTABLE];
+    uint16_t length[LZW_SIZTABLE]; ///< length of the string of each code
     int bs;                     ///< current buffer size for GIF
 };
 
@@ -131,6 +132,7 @@ av_cold void ff_lzw_decode_close(LZWState **p)
 int ff_lzw_decode_init(LZWState *p, int csize, const uint8_t *buf, int buf_size, int mode)
 {
     struct LZWState *s = (struct LZWState *)p;
+    int i;
 
     if(csize < 1 || csize >= LZW_MAXBITS)
         return -1;
@@ -151,6 +153,8 @@ int ff_lzw_decode_init(LZWState *p, int csize, const uint8_t *buf, int buf_size,
     s->slot = s->newcodes = s->clear_code + 2;
     s->oc = s->fc = -1;
     s->sp = s->stack;
+    for (i = 0; i < s->clear_code; i++)
+        s->length[i] = 1;
 
     s->mode = mode;
     s->extra_slot = s->mode == FF_LZW_TIFF;
@@ -168,7 +172,7 @@ int ff_lzw_decode_init(LZWState *p, int csize, const uint8_t *buf, int buf_size,
  * @return number of bytes decoded
  */
 int ff_lzw_decode(LZWState *p, uint8_t *buf, int len){
-    int l, c, code, oc, fc;
+    int l, c, code, oc, fc, n;
     uint8_t *sp;
     struct LZWState *s = (struct LZWState *)p;
 
@@ -202,17 +206,40 @@ int ff_lzw_decode(LZWState *p, uint8_t *buf, int len){
         } else {
             code = c;
             if (code == s->slot && fc>=0) {
-                *sp++ = fc;
-                code = oc;
-            }else if(code >= s->slot)
+                n = s->length[oc] + 1;
+            } else if (code >= s->slot) {
                 break;
-            while (code >= s->newcodes) {
-                *sp++ = s->suffix[code];
-                code = s->prefix[code];
+            } else
+                n = s->length[code];
+            if (n <= l) {
+                /* the whole string fits, write it backwards straight
+                 * into the output instead of going through the stack */
+                uint8_t *dp = buf + n;
+                if (code == s->slot) {
+                    *--dp = fc;
+                    code = oc;
+                }
+                while (code >= s->newcodes) {
+                    *--dp = s->suffix[code];
+                    code = s->prefix[code];
+                }
+                *--dp = code;
+                buf += n;
+                l   -= n;
+            } else {
+                if (code == s->slot) {
+                    *sp++ = fc;
+                    code = oc;
+                }
+                while (code >= s->newcodes) {
+                    *sp++ = s->suffix[code];
+                    code = s->prefix[code];
+                }
+                *sp++ = code;
             }
-            *sp++ = code;
             if (s->slot < s->top_slot && oc>=0) {
                 s->suffix[s->slot] = code;
+                s->length[s->slot] = s->length[oc] + 1;
                 s->prefix[s->slot++] = oc;
             }
             fc = code;
@@ -223,6 +250,8 @@ int ff_lzw_decode(LZWState *p, uint8_t *buf, int len){
                     s->curmask = mask[++s->cursize];
                 }
             }
+            if (!l)
+                goto the_end;
         }
     }
     s->end_code = -1;
@@ -64,25 +64,67 @@ static int build_vlc(VLC *vlc, const uint8_t *bits_table,
                               huff_code, 2, 2, huff_sym, 2, 2, use_static);
 }
 
+/**
+ * Build the VLCs for Huffman table class/index. Most streams repeat the
+ * same DHT (often the default one) in every frame, so nothing is rebuilt
+ * if the table is identical to the one the VLCs were last built from.
+ */
+static int set_huffman_table(MJpegDecodeContext *s, int class, int index,
+                             const uint8_t *bits_table,
+                             const uint8_t *val_table)
+{
+    MJpegHuffTable *h = &s->huff_tables[class][index];
+    int i, ret, nb_vals = 0, code_max = 0;
+
+    for (i = 1; i <= 16; i++)
+        nb_vals += bits_table[i];
+    if (h->nb_vals == nb_vals &&
+        !memcmp(h->bits, bits_table + 1, 16) &&
+        !memcmp(h->vals, val_table, nb_vals))
+        return 0;
+    h->nb_vals = -1;
+
+    for (i = 0; i < nb_vals; i++)
+        code_max = FFMAX(code_max, val_table[i]);
+
+    av_log(s->avctx, AV_LOG_DEBUG, "class=%d index=%d nb_codes=%d\n",
+           class, index, code_max + 1);
+
+    /* build VLC and flush previous vlc if present */
+    ff_free_vlc(&s->vlcs[class][index]);
+    if ((ret = build_vlc(&s->vlcs[class][index], bits_table, val_table,
+                         code_max + 1, 0, class > 0)) < 0)
+        return ret;
+
+    if (class > 0) {
+        ff_free_vlc(&s->vlcs[2][index]);
+        if ((ret = build_vlc(&s->vlcs[2][index], bits_table, val_table,
+                             code_max + 1, 0, 0)) < 0)
+            return ret;
+    }
+
+    memcpy(h->bits, bits_table + 1, 16);
+    memcpy(h->vals, val_table, nb_vals);
+    h->nb_vals = nb_vals;
+    return 0;
+}
+
 static void build_basic_mjpeg_vlc(MJpegDecodeContext *s)
 {
-    build_vlc(&s->vlcs[0][0], avpriv_mjpeg_bits_dc_luminance,
-              avpriv_mjpeg_val_dc, 12, 0, 0);
-    build_vlc(&s->vlcs[0][1], avpriv_mjpeg_bits_dc_chrominance,
-              avpriv_mjpeg_val_dc, 12, 0, 0);
-    build_vlc(&s->vlcs[1][0], avpriv_mjpeg_bits_ac_luminance,
-              avpriv_mjpeg_val_ac_luminance, 251, 0, 1);
-    build_vlc(&s->vlcs[1][1], avpriv_mjpeg_bits_ac_chrominance,
-              avpriv_mjpeg_val_ac_chrominance, 251, 0, 1);
-    build_vlc(&s->vlcs[2][0], avpriv_mjpeg_bits_ac_luminance,
-              avpriv_mjpeg_val_ac_luminance, 251, 0, 0);
-    build_vlc(&s->vlcs[2][1], avpriv_mjpeg_bits_ac_chrominance,
-              avpriv_mjpeg_val_ac_chrominance, 251, 0, 0);
+    set_huffman_table(s, 0, 0, avpriv_mjpeg_bits_dc_luminance,
+                      avpriv_mjpeg_val_dc);
+    set_huffman_table(s, 0, 1, avpriv_mjpeg_bits_dc_chrominance,
+                      avpriv_mjpeg_val_dc);
+    set_huffman_table(s, 1, 0, avpriv_mjpeg_bits_ac_luminance,
+                      avpriv_mjpeg_val_ac_luminance);
+    set_huffman_table(s, 1, 1, avpriv_mjpeg_bits_ac_chrominance,
+                      avpriv_mjpeg_val_ac_chrominance);
 }
 
 av_cold int ff_mjpeg_decode_init(AVCodecContext *avctx)
 {
     MJpegDecodeContext *s = avctx->priv_data;
+    int i, j;
 
     if (!s->picture_ptr)
         s->picture_ptr = &s->picture;
@@ -99,6 +141,9 @@ av_cold int ff_mjpeg_decode_init(AVCodecContext *avctx)
     s->org_height    = avctx->coded_height;
     avctx->chroma_sample_location = AVCHROMA_LOC_CENTER;
 
+    for (i = 0; i < 2; i++)
+        for (j = 0; j < 4; j++)
+            s->huff_tables[i][j].nb_vals = -1;
     build_basic_mjpeg_vlc(s);
 
     if (s->extern_huff) {
@@ -157,7 +202,7 @@ int ff_mjpeg_decode_dqt(MJpegDecodeContext *s)
 /* decode huffman tables and build VLC decoders */
 int ff_mjpeg_decode_dht(MJpegDecodeContext *s)
 {
-    int len, index, i, class, n, v, code_max;
+    int len, index, i, class, n;
     uint8_t bits_table[17];
     uint8_t val_table[256];
     int ret = 0;
@@ -182,29 +227,12 @@ int ff_mjpeg_decode_dht(MJpegDecodeContext *s)
         if (len < n || n > 256)
             return AVERROR_INVALIDDATA;
 
-        code_max = 0;
-        for (i = 0; i < n; i++) {
-            v = get_bits(&s->gb, 8);
-            if (v > code_max)
-                code_max = v;
-            val_table[i] = v;
-        }
+        for (i = 0; i < n; i++)
+            val_table[i] = get_bits(&s->gb, 8);
         len -= n;
 
-        /* build VLC and flush previous vlc if present */
-        ff_free_vlc(&s->vlcs[class][index]);
-        av_log(s->avctx, AV_LOG_DEBUG, "class=%d index=%d nb_codes=%d\n",
-               class, index, code_max + 1);
-        if ((ret = build_vlc(&s->vlcs[class][index], bits_table, val_table,
-                             code_max + 1, 0, class > 0)) < 0)
+        if ((ret = set_huffman_table(s, class, index, bits_table, val_table)) < 0)
             return ret;
-
-        if (class > 0) {
-            ff_free_vlc(&s->vlcs[2][index]);
-            if ((ret = build_vlc(&s->vlcs[2][index], bits_table, val_table,
-                                 code_max + 1, 0, 0)) < 0)
-                return ret;
-        }
     }
     return 0;
 }
@@ -1000,18 +1028,187 @@ static av_always_inline void mjpeg_copy_block(uint8_t *dst, const uint8_t *src,
     }
 }
 
+#define MAX_SCAN_JOBS 64
+
+typedef struct MJpegScan {
+    int nb_components;
+    int Ah, Al;
+    const uint8_t *mb_bitmask;
+    uint8_t *data[MAX_COMPONENTS];
+    const uint8_t *reference_data[MAX_COMPONENTS];
+    int linesize[MAX_COMPONENTS];
+    int first_restart;  ///< index in restart_pos of the marker ending the first interval
+    int nb_intervals;
+    int nb_jobs;
+} MJpegScan;
+
+/* decode the macroblocks mb_start to mb_end - 1 in raster order */
+static int decode_scan_mbs(MJpegDecodeContext *s, const MJpegScan *scan,
+                           int mb_start, int mb_end)
+{
+    int i, mb;
+    const int nb_components = scan->nb_components;
+    const int *linesize     = scan->linesize;
+    GetBitContext mb_bitmask_gb = { 0 };
+
+    if (scan->mb_bitmask) {
+        init_get_bits(&mb_bitmask_gb, scan->mb_bitmask, s->mb_width * s->mb_height);
+        skip_bits_long(&mb_bitmask_gb, mb_start);
+    }
+
+    for (mb = mb_start; mb < mb_end; mb++) {
+        const int mb_x    = mb % s->mb_width;
+        const int mb_y    = mb / s->mb_width;
+        const int copy_mb = scan->mb_bitmask && !get_bits1(&mb_bitmask_gb);
+
+        if (s->restart_interval && !s->restart_count)
+            s->restart_count = s->restart_interval;
+
+        if (get_bits_left(&s->gb) < 0) {
+            av_log(s->avctx, AV_LOG_ERROR, "overread %d\n",
+                   -get_bits_left(&s->gb));
+            return AVERROR_INVALIDDATA;
+        }
+        for (i = 0; i < nb_components; i++) {
+            uint8_t *ptr;
+            int n, h, v, x, y, c, j;
+            int block_offset;
+            n = s->nb_blocks[i];
+            c = s->comp_index[i];
+            h = s->h_scount[i];
+            v = s->v_scount[i];
+            x = 0;
+            y = 0;
+            for (j = 0; j < n; j++) {
+                block_offset = (((linesize[c] * (v * mb_y + y) * 8) +
+                                 (h * mb_x + x) * 8) >> s->avctx->lowres);
+
+                if (s->interlaced && s->bottom_field)
+                    block_offset += linesize[c] >> 1;
+                ptr = scan->data[c] + block_offset;
+                if (!s->progressive) {
+                    if (copy_mb)
+                        mjpeg_copy_block(ptr, scan->reference_data[c] + block_offset,
+                                         linesize[c], s->avctx->lowres);
+                    else {
+                        s->dsp.clear_block(s->block);
+                        if (decode_block(s, s->block, i,
+                                         s->dc_index[i], s->ac_index[i],
+                                         s->quant_matrixes[s->quant_index[c]]) < 0) {
+                            av_log(s->avctx, AV_LOG_ERROR,
+                                   "error y=%d x=%d\n", mb_y, mb_x);
+                            return AVERROR_INVALIDDATA;
+                        }
+                        s->dsp.idct_put(ptr, linesize[c], s->block);
+                    }
+                } else {
+                    int block_idx  = s->block_stride[c] * (v * mb_y + y) +
+                                     (h * mb_x + x);
+                    DCTELEM *block = s->blocks[c][block_idx];
+                    if (scan->Ah)
+                        block[0] += get_bits1(&s->gb) *
+                                    s->quant_matrixes[s->quant_index[c]][0] << scan->Al;
+                    else if (decode_dc_progressive(s, block, i, s->dc_index[i],
+                                                   s->quant_matrixes[s->quant_index[c]],
+                                                   scan->Al) < 0) {
+                        av_log(s->avctx, AV_LOG_ERROR,
+                               "error y=%d x=%d\n", mb_y, mb_x);
+                        return AVERROR_INVALIDDATA;
+                    }
+                }
+                av_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
+                av_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
+                        mb_x, mb_y, x, y, c, s->bottom_field,
+                        (v * mb_y + y) * 8, (h * mb_x + x) * 8);
+                if (++x == h) {
+                    x = 0;
+                    y++;
+                }
+            }
+        }
+
+        handle_rstn(s, nb_components);
+    }
+    return 0;
+}
+
+/**
+ * Decode a run of restart intervals with a private copy of the context.
+ * The bitstream reader starts right after the RST marker preceding the
+ * first interval of the job, the DC predictors are at their reset value.
+ */
+static int decode_scan_slice(AVCodecContext *avctx, void *arg,
+                             int jobnr, int threadnr)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    MJpegDecodeContext *t = &s->slice_ctx[jobnr];
+    const MJpegScan *scan = arg;
+    int first = jobnr       * scan->nb_intervals / scan->nb_jobs;
+    int last  = (jobnr + 1) * scan->nb_intervals / scan->nb_jobs;
+
+    memcpy(t, s, sizeof(*t));
+    if (first) {
+        int pos = s->restart_pos[scan->first_restart + first - 1];
+        skip_bits_long(&t->gb, pos * 8 - get_bits_count(&t->gb));
+    }
+    return decode_scan_mbs(t, scan, first * s->restart_interval,
+                           FFMIN(last * s->restart_interval,
+                                 s->mb_width * s->mb_height));
+}
+
+/**
+ * Set up slice threaded decoding of a scan if its restart intervals can be
+ * located from the RST markers found while unescaping it.
+ * @return the number of jobs, 0 if the scan must be decoded serially
+ */
+static int init_scan_slices(MJpegDecodeContext *s, MJpegScan *scan)
+{
+    AVCodecContext *avctx = s->avctx;
+    int start = get_bits_count(&s->gb) >> 3;
+    int i;
+
+    if (!(avctx->active_thread_type & FF_THREAD_SLICE) ||
+        !s->restart_interval || s->restart_count || s->progressive ||
+        s->nb_restart_pos <= 0 || (get_bits_count(&s->gb) & 7))
+        return 0;
+
+    scan->nb_intervals = (s->mb_width * s->mb_height + s->restart_interval - 1) /
+                         s->restart_interval;
+    scan->nb_jobs      = FFMIN3(scan->nb_intervals, avctx->thread_count,
+                                MAX_SCAN_JOBS);
+    if (scan->nb_jobs < 2)
+        return 0;
+
+    /* skip the markers of earlier fields decoded from the same buffer */
+    for (i = 0; i < s->nb_restart_pos && s->restart_pos[i] <= start; i++)
+        ;
+    scan->first_restart = i;
+    if (s->nb_restart_pos - i < scan->nb_intervals - 1)
+        return 0;
+    for (i = 0; i < scan->nb_intervals - 1; i++)
+        if (s->gb.buffer[s->restart_pos[scan->first_restart + i] - 1] != RST0 + (i & 7))
+            return 0;
+
+    if (!s->slice_ctx) {
+        s->slice_ctx = av_malloc(FFMIN(avctx->thread_count, MAX_SCAN_JOBS) *
+                                 sizeof(*s->slice_ctx));
+        if (!s->slice_ctx)
+            return 0;
+    }
+    return scan->nb_jobs;
+}
+
 static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                              int Al, const uint8_t *mb_bitmask,
                              const AVFrame *reference)
 {
-    int i, mb_x, mb_y;
-    uint8_t *data[MAX_COMPONENTS];
-    const uint8_t *reference_data[MAX_COMPONENTS];
-    int linesize[MAX_COMPONENTS];
-    GetBitContext mb_bitmask_gb;
+    MJpegScan scan = { 0 };
+    int i;
 
-    if (mb_bitmask)
-        init_get_bits(&mb_bitmask_gb, mb_bitmask, s->mb_width * s->mb_height);
+    scan.nb_components = nb_components;
+    scan.Ah            = Ah;
+    scan.Al            = Al;
+    scan.mb_bitmask    = mb_bitmask;
 
     if (s->flipped && s->avctx->lowres) {
         av_log(s->avctx, AV_LOG_ERROR, "Can not flip image with lowres\n");
@@ -1020,94 +1217,37 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
 
     for (i = 0; i < nb_components; i++) {
         int c   = s->comp_index[i];
-        data[c] = s->picture_ptr->data[c];
-        reference_data[c] = reference ? reference->data[c] : NULL;
-        linesize[c] = s->linesize[c];
+        scan.data[c] = s->picture_ptr->data[c];
+        scan.reference_data[c] = reference ? reference->data[c] : NULL;
+        scan.linesize[c] = s->linesize[c];
         s->coefs_finished[c] |= 1;
         if (s->flipped && !(s->avctx->flags & CODEC_FLAG_EMU_EDGE)) {
             // picture should be flipped upside-down for this codec
-            int offset = (linesize[c] * (s->v_scount[i] *
+            int offset = (scan.linesize[c] * (s->v_scount[i] *
                          (8 * s->mb_height - ((s->height / s->v_max) & 7)) - 1));
-            data[c]           += offset;
-            reference_data[c] += offset;
-            linesize[c]       *= -1;
+            scan.data[c]           += offset;
+            scan.reference_data[c] += offset;
+            scan.linesize[c]       *= -1;
         }
     }
 
-    for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
-        for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
-            const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
-
-            if (s->restart_interval && !s->restart_count)
-                s->restart_count = s->restart_interval;
+    if (init_scan_slices(s, &scan)) {
+        MJpegDecodeContext *last = &s->slice_ctx[scan.nb_jobs - 1];
+        int ret[MAX_SCAN_JOBS];
 
-            if (get_bits_left(&s->gb) < 0) {
-                av_log(s->avctx, AV_LOG_ERROR, "overread %d\n",
-                       -get_bits_left(&s->gb));
-                return AVERROR_INVALIDDATA;
-            }
-            for (i = 0; i < nb_components; i++) {
-                uint8_t *ptr;
-                int n, h, v, x, y, c, j;
-                int block_offset;
-                n = s->nb_blocks[i];
-                c = s->comp_index[i];
-                h = s->h_scount[i];
-                v = s->v_scount[i];
-                x = 0;
-                y = 0;
-                for (j = 0; j < n; j++) {
-                    block_offset = (((linesize[c] * (v * mb_y + y) * 8) +
-                                     (h * mb_x + x) * 8) >> s->avctx->lowres);
-
-                    if (s->interlaced && s->bottom_field)
-                        block_offset += linesize[c] >> 1;
-                    ptr = data[c] + block_offset;
-                    if (!s->progressive) {
-                        if (copy_mb)
-                            mjpeg_copy_block(ptr, reference_data[c] + block_offset,
-                                             linesize[c], s->avctx->lowres);
-                        else {
-                            s->dsp.clear_block(s->block);
-                            if (decode_block(s, s->block, i,
-                                             s->dc_index[i], s->ac_index[i],
-                                             s->quant_matrixes[s->quant_index[c]]) < 0) {
-                                av_log(s->avctx, AV_LOG_ERROR,
-                                       "error y=%d x=%d\n", mb_y, mb_x);
-                                return AVERROR_INVALIDDATA;
-                            }
-                            s->dsp.idct_put(ptr, linesize[c], s->block);
-                        }
-                    } else {
-                        int block_idx  = s->block_stride[c] * (v * mb_y + y) +
-                                         (h * mb_x + x);
-                        DCTELEM *block = s->blocks[c][block_idx];
-                        if (Ah)
-                            block[0] += get_bits1(&s->gb) *
-                                        s->quant_matrixes[s->quant_index[c]][0] << Al;
-                        else if (decode_dc_progressive(s, block, i, s->dc_index[i],
-                                                       s->quant_matrixes[s->quant_index[c]],
-                                                       Al) < 0) {
-                            av_log(s->avctx, AV_LOG_ERROR,
-                                   "error y=%d x=%d\n", mb_y, mb_x);
-                            return AVERROR_INVALIDDATA;
-                        }
-                    }
-                    av_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
-                    av_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
-                            mb_x, mb_y, x, y, c, s->bottom_field,
-                            (v * mb_y + y) * 8, (h * mb_x + x) * 8);
-                    if (++x == h) {
-                        x = 0;
-                        y++;
-                    }
-                }
-            }
+        s->avctx->execute2(s->avctx, decode_scan_slice, &scan, ret, scan.nb_jobs);
 
-            handle_rstn(s, nb_components);
-        }
+        /* continue after the scan like the serial decoder would */
+        s->gb            = last->gb;
+        s->restart_count = last->restart_count;
+        memcpy(s->last_dc, last->last_dc, sizeof(s->last_dc));
+        for (i = 0; i < scan.nb_jobs; i++)
+            if (ret[i] < 0)
+                return ret[i];
+        return 0;
     }
-    return 0;
+
+    return decode_scan_mbs(s, &scan, 0, s->mb_width * s->mb_height);
 }
 
 static int mjpeg_decode_scan_progressive_ac(MJpegDecodeContext *s, int ss,
@@ -1534,6 +1674,24 @@ found:
     return val;
 }
 
+/* remember where the data following an RST marker starts */
+static void add_restart_pos(MJpegDecodeContext *s, int pos)
+{
+    int *restart_pos;
+
+    if (s->nb_restart_pos < 0)
+        return;
+    restart_pos = av_fast_realloc(s->restart_pos, &s->restart_pos_size,
+                                  (s->nb_restart_pos + 1) * sizeof(*restart_pos));
+    if (!restart_pos) {
+        av_freep(&s->restart_pos);
+        s->nb_restart_pos = -1;
+        return;
+    }
+    s->restart_pos = restart_pos;
+    s->restart_pos[s->nb_restart_pos++] = pos;
+}
+
 int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                          const uint8_t **buf_ptr, const uint8_t *buf_end,
                          const uint8_t **unescaped_buf_ptr,
@@ -1550,6 +1708,9 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
     if (start_code == SOS && !s->ls) {
         const uint8_t *src = *buf_ptr;
         uint8_t *dst = s->buffer;
+        int record_rst = s->avctx->active_thread_type & FF_THREAD_SLICE;
+
+        s->nb_restart_pos = 0;
 
         while (src < buf_end) {
             uint8_t x = *(src++);
@@ -1560,9 +1721,11 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                     while (src < buf_end && x == 0xff)
                         x = *(src++);
 
-                    if (x >= 0xd0 && x <= 0xd7)
+                    if (x >= 0xd0 && x <= 0xd7) {
                         *(dst++) = x;
-                    else if (x)
+                        if (record_rst)
+                            add_restart_pos(s, dst - s->buffer);
+                    } else if (x)
                         break;
                 }
             }
@@ -1865,6 +2028,8 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
     av_free(s->qscale_table);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
+    av_freep(&s->restart_pos);
+    av_freep(&s->slice_ctx);
 
     for (i = 0; i < 3; i++) {
         for (j = 0; j < 4; j++)
@@ -1908,7 +2073,7 @@ AVCodec ff_mjpeg_decoder = {
     .close          = ff_mjpeg_decode_end,
     .decode         = ff_mjpeg_decode_frame,
     .flush          = decode_flush,
-    .capabilities   = CODEC_CAP_DR1,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_SLICE_THREADS,
     .max_lowres     = 3,
     .long_name      = NULL_IF_CONFIG_SMALL("MJPEG (Motion JPEG)"),
     .priv_class     = &mjpegdec_class,
@@ -37,6 +37,15 @@
 
 #define MAX_COMPONENTS 4
 
+/**
+ * Huffman table the VLCs of one class/index were last built from.
+ */
+typedef struct MJpegHuffTable {
+    int nb_vals;        ///< number of symbols, -1 if unknown
+    uint8_t bits[16];   ///< number of codes of each length 1..16
+    uint8_t vals[256];
+} MJpegHuffTable;
+
 typedef struct MJpegDecodeContext {
     AVClass *class;
     AVCodecContext *avctx;
@@ -48,6 +57,7 @@ typedef struct MJpegDecodeContext {
 
     int16_t quant_matrixes[4][64];
     VLC vlcs[3][4];
+    MJpegHuffTable huff_tables[2][4];
     int qscale[4];      ///< quantizer scale calculated from quant_matrixes
 
     int org_height;  /* size given at codec init */
@@ -114,6 +124,11 @@ typedef struct MJpegDecodeContext {
     unsigned int ljpeg_buffer_size;
 
     int extern_huff;
+
+    int *restart_pos;      ///< offsets after the RST markers of the current scan in buffer
+    unsigned int restart_pos_size;
+    int nb_restart_pos;    ///< number of entries in restart_pos, -1 if they could not be stored
+    struct MJpegDecodeContext *slice_ctx; ///< per job copies of the context for slice threading
 } MJpegDecodeContext;
 
 int ff_mjpeg_decode_init(AVCodecContext *avctx);
@@ -399,6 +399,24 @@ static int qpel_motion_search(MpegEncContext * s,
     }\
 }
 
+#define CHECK_MV_DIR_SCORE(x,y,new_dir,score)\
+{\
+    const unsigned key = ((y)<<ME_MAP_MV_BITS) + (x) + map_generation;\
+    const int index= (((y)<<ME_MAP_SHIFT) + (x))&(ME_MAP_SIZE-1);\
+    if(map[index]!=key){\
+        d= score;\
+        map[index]= key;\
+        score_map[index]= d;\
+        d += (mv_penalty[((x)<<shift)-pred_x] + mv_penalty[((y)<<shift)-pred_y])*penalty_factor;\
+        if(d<dmin){\
+            best[0]=x;\
+            best[1]=y;\
+            dmin=d;\
+            next_dir= new_dir;\
+        }\
+    }\
+}
+
 #define check(x,y,S,v)\
 if( (x)<(xmin<<(S)) ) av_log(NULL, AV_LOG_ERROR, "%d %d %d %d %d xmin" #v, xmin, (x), (y), s->mb_x, s->mb_y);\
 if( (x)>(xmax<<(S)) ) av_log(NULL, AV_LOG_ERROR, "%d %d %d %d %d xmax" #v, xmax, (x), (y), s->mb_x, s->mb_y);\
@@ -420,10 +438,15 @@ static av_always_inline int small_diamond_search(MpegEncContext * s, int *best,
     LOAD_COMMON
     LOAD_COMMON2
     unsigned map_generation = c->map_generation;
+    int batch;
 
     cmpf= s->dsp.me_cmp[size];
     chroma_cmpf= s->dsp.me_cmp[size+1];
 
+    /* plain 16x16 luma SAD, the 4 neighbours can be scored in one pass */
+    batch = s->dsp.sad16_x4 && cmpf == s->dsp.sad[0] &&
+            size == 0 && h == 16 && !(flags & (FLAG_CHROMA|FLAG_DIRECT));
+
     { /* ensure that the best point is in the MAP as h/qpel refinement needs it */
         const unsigned key = (best[1]<<ME_MAP_MV_BITS) + best[0] + map_generation;
         const int index= ((best[1]<<ME_MAP_SHIFT) + best[0])&(ME_MAP_SIZE-1);
@@ -440,10 +463,20 @@ static av_always_inline int small_diamond_search(MpegEncContext * s, int *best,
         const int y= best[1];
         next_dir=-1;
 
+        if (batch && x>xmin && y>ymin && x<xmax && y<ymax) {
+            int scores[4];
+            s->dsp.sad16_x4(scores, c->src[src_index][0],
+                            c->ref[ref_index][0] + x + y*c->stride, c->stride);
+            if(dir!=2) CHECK_MV_DIR_SCORE(x-1, y  , 0, scores[0])
+            if(dir!=3) CHECK_MV_DIR_SCORE(x  , y-1, 1, scores[1])
+            if(dir!=0) CHECK_MV_DIR_SCORE(x+1, y  , 2, scores[2])
+            if(dir!=1) CHECK_MV_DIR_SCORE(x  , y+1, 3, scores[3])
+        } else {
         if(dir!=2 && x>xmin) CHECK_MV_DIR(x-1, y  , 0)
         if(dir!=3 && y>ymin) CHECK_MV_DIR(x  , y-1, 1)
         if(dir!=0 && x<xmax) CHECK_MV_DIR(x+1, y  , 2)
         if(dir!=1 && y<ymax) CHECK_MV_DIR(x  , y+1, 3)
+        }
 
         if(next_dir==-1){
             return dmin;
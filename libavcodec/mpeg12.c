@@ -1170,8 +1170,18 @@ static int mpeg_decode_update_thread_context(AVCodecContext *avctx, const AVCode
     err = ff_mpeg_update_thread_context(avctx, avctx_from);
     if (err) return err;
 
-    if (!ctx->mpeg_enc_ctx_allocated)
-        memcpy(s + 1, s1 + 1, sizeof(Mpeg1Context) - sizeof(MpegEncContext));
+    /* sequence level state, only sent once per GOP or less */
+    memcpy(s + 1, s1 + 1, sizeof(Mpeg1Context) - sizeof(MpegEncContext));
+
+    s->codec_id          = s1->codec_id;
+    avctx->codec_id      = avctx_from->codec_id;
+    s->aspect_ratio_info = s1->aspect_ratio_info;
+    s->frame_rate_index  = s1->frame_rate_index;
+    s->bit_rate          = s1->bit_rate;
+    memcpy(s->intra_matrix,        s1->intra_matrix,        sizeof(s->intra_matrix));
+    memcpy(s->chroma_intra_matrix, s1->chroma_intra_matrix, sizeof(s->chroma_intra_matrix));
+    memcpy(s->inter_matrix,        s1->inter_matrix,        sizeof(s->inter_matrix));
+    memcpy(s->chroma_inter_matrix, s1->chroma_inter_matrix, sizeof(s->chroma_inter_matrix));
 
     if (!(s->pict_type == AV_PICTURE_TYPE_B || s->low_delay))
         s->picture_number++;
@@ -1622,9 +1632,6 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
         }
 
         *s->current_picture_ptr->f.pan_scan = s1->pan_scan;
-
-        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME))
-            ff_thread_finish_setup(avctx);
     } else { // second field
         int i;
 
@@ -1658,6 +1665,12 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
         if (ff_xvmc_field_start(s, avctx) < 0)
             return -1;
 
+    /* With field pictures the next thread may only start once both fields
+     * have been set up, as it continues from the state of the second one. */
+    if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME) &&
+        (s->picture_structure == PICT_FRAME || !s->first_field))
+        ff_thread_finish_setup(avctx);
+
     return 0;
 }
 
@@ -1807,7 +1820,10 @@ static int mpeg_decode_slice(MpegEncContext *s, int mb_y,
             const int mb_size = 16 >> s->avctx->lowres;
 
             ff_draw_horiz_band(s, mb_size*(s->mb_y >> field_pic), mb_size);
-            ff_MPV_report_decode_progress(s);
+            /* rows of a field picture are only complete with the other field,
+             * progress is reported for the whole frame at its end instead */
+            if (!field_pic)
+                ff_MPV_report_decode_progress(s);
 
             s->mb_x = 0;
             s->mb_y += 1 << field_pic;
@@ -2626,7 +2642,7 @@ AVCodec ff_mpeg1video_decoder = {
     .decode                = mpeg_decode_frame,
     .capabilities          = CODEC_CAP_DRAW_HORIZ_BAND | CODEC_CAP_DR1 |
                              CODEC_CAP_TRUNCATED | CODEC_CAP_DELAY |
-                             CODEC_CAP_SLICE_THREADS,
+                             CODEC_CAP_SLICE_THREADS | CODEC_CAP_FRAME_THREADS,
     .flush                 = flush,
     .max_lowres            = 3,
     .long_name             = NULL_IF_CONFIG_SMALL("MPEG-1 video"),
@@ -2643,11 +2659,12 @@ AVCodec ff_mpeg2video_decoder = {
     .decode         = mpeg_decode_frame,
     .capabilities   = CODEC_CAP_DRAW_HORIZ_BAND | CODEC_CAP_DR1 |
                       CODEC_CAP_TRUNCATED | CODEC_CAP_DELAY |
-                      CODEC_CAP_SLICE_THREADS,
+                      CODEC_CAP_SLICE_THREADS | CODEC_CAP_FRAME_THREADS,
     .flush          = flush,
     .max_lowres     = 3,
     .long_name      = NULL_IF_CONFIG_SMALL("MPEG-2 video"),
     .profiles       = NULL_IF_CONFIG_SMALL(mpeg2_video_profiles),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(mpeg_decode_update_thread_context),
 };
 
 //legacy decoder
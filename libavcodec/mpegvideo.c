@@ -631,16 +631,17 @@ int ff_mpeg_update_thread_context(AVCodecContext *dst,
     s->low_delay    = s1->low_delay;
     s->droppable    = s1->droppable;
 
-    // DivX handling (doesn't work)
+    // DivX handling
     s->divx_packed  = s1->divx_packed;
 
-    if (s1->bitstream_buffer) {
-        if (s1->bitstream_buffer_size +
-            FF_INPUT_BUFFER_PADDING_SIZE > s->allocated_bitstream_buffer_size)
-            av_fast_malloc(&s->bitstream_buffer,
-                           &s->allocated_bitstream_buffer_size,
-                           s1->allocated_bitstream_buffer_size);
-            s->bitstream_buffer_size = s1->bitstream_buffer_size;
+    s->bitstream_buffer_size = 0;
+    if (s1->bitstream_buffer_size) {
+        av_fast_malloc(&s->bitstream_buffer,
+                       &s->allocated_bitstream_buffer_size,
+                       s1->bitstream_buffer_size + FF_INPUT_BUFFER_PADDING_SIZE);
+        if (!s->bitstream_buffer)
+            return AVERROR(ENOMEM);
+        s->bitstream_buffer_size = s1->bitstream_buffer_size;
         memcpy(s->bitstream_buffer, s1->bitstream_buffer,
                s1->bitstream_buffer_size);
         memset(s->bitstream_buffer + s->bitstream_buffer_size, 0,
@@ -852,9 +853,14 @@ av_cold int ff_MPV_common_init(MpegEncContext *s)
     int nb_slices = (HAVE_THREADS &&
                      s->avctx->active_thread_type & FF_THREAD_SLICE) ?
                     s->avctx->thread_count : 1;
+    int nb_enc_slices = nb_slices;
 
-    if (s->encoding && s->avctx->slices)
-        nb_slices = s->avctx->slices;
+    /* with fewer slices than threads, the extra contexts only run the
+     * motion estimation */
+    if (s->encoding && s->avctx->slices) {
+        nb_enc_slices = s->avctx->slices;
+        nb_slices     = FFMAX(nb_slices, nb_enc_slices);
+    }
 
     if (s->codec_id == AV_CODEC_ID_MPEG2VIDEO && !s->progressive_sequence)
         s->mb_height = (s->height + 31) / 32 * 2;
@@ -877,6 +883,7 @@ av_cold int ff_MPV_common_init(MpegEncContext *s)
                " reducing to %d\n", nb_slices, max_slices);
         nb_slices = max_slices;
     }
+    nb_enc_slices = FFMIN(nb_enc_slices, nb_slices);
 
     if ((s->width || s->height) &&
         av_image_check_size(s->width, s->height, 0, s->avctx))
@@ -955,6 +962,7 @@ av_cold int ff_MPV_common_init(MpegEncContext *s)
             s->end_mb_y   = s->mb_height;
         }
         s->slice_context_count = nb_slices;
+        s->enc_context_count   = nb_enc_slices;
 //     }
 
     return 0;
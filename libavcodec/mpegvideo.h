@@ -147,6 +147,8 @@ typedef struct Picture{
     uint8_t *mb_mean;           ///< Table for MB luminance
     int32_t *mb_cmp_score;      ///< Table for MB cmp scores, for mb decision FIXME remove
     int b_frame_score;          /* */
+    int duplicate;              ///< input picture flagged as a repeat of the previous one, skipped without comparing
+    int la_cost;                ///< low resolution complexity estimate for the rate control lookahead
     struct MpegEncContext *owner2; ///< pointer to the MpegEncContext that allocated this picture
     int needs_realloc;          ///< Picture needs to be reallocated (eg due to a frame size change)
 } Picture;
@@ -289,6 +291,7 @@ typedef struct MpegEncContext {
     int end_mb_y;              ///< end   mb_y of this thread (so current thread should process start_mb_y <= row < end_mb_y)
     struct MpegEncContext *thread_context[MAX_THREADS];
     int slice_context_count;   ///< number of used thread_contexts
+    int enc_context_count;     ///< thread_contexts encoding a slice, all slice_context_count of them run motion estimation
 
     /**
      * copy of the previous picture structure.
@@ -718,6 +721,10 @@ typedef struct MpegEncContext {
     int mpv_flags;      ///< flags set by private options
     int quantizer_noise_shaping;
 
+    int rc_lookahead;           ///< number of future frames the rate control looks at
+    uint8_t *la_buf[2];         ///< half resolution luma of the current and previous input frames
+    int la_stride;
+
     /* error resilience stuff */
     uint8_t *er_temp_buffer;
 
@@ -752,7 +759,8 @@ typedef struct MpegEncContext {
                                                                       FF_MPV_OFFSET(luma_elim_threshold), AV_OPT_TYPE_INT, { .i64 = 0 }, INT_MIN, INT_MAX, FF_MPV_OPT_FLAGS },\
 { "chroma_elim_threshold", "single coefficient elimination threshold for chrominance (negative values also consider dc coefficient)",\
                                                                       FF_MPV_OFFSET(chroma_elim_threshold), AV_OPT_TYPE_INT, { .i64 = 0 }, INT_MIN, INT_MAX, FF_MPV_OPT_FLAGS },\
-{ "quantizer_noise_shaping", NULL,                                  FF_MPV_OFFSET(quantizer_noise_shaping), AV_OPT_TYPE_INT, { .i64 = 0 },       0, INT_MAX, FF_MPV_OPT_FLAGS },
+{ "quantizer_noise_shaping", NULL,                                  FF_MPV_OFFSET(quantizer_noise_shaping), AV_OPT_TYPE_INT, { .i64 = 0 },       0, INT_MAX, FF_MPV_OPT_FLAGS },\
+{ "rc_lookahead",   "Number of future frames used by the VBV rate control", FF_MPV_OFFSET(rc_lookahead), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 16, FF_MPV_OPT_FLAGS },
 
 extern const AVOption ff_mpv_generic_options[];
 
@@ -27,6 +27,7 @@
  * The simplest mpeg encoder (well, it was the simplest!).
  */
 
+#include "libavutil/dict.h"
 #include "libavutil/intmath.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/pixdesc.h"
@@ -881,6 +882,22 @@ av_cold int ff_MPV_encode_init(AVCodecContext *avctx)
         return -1;
     }
 
+    if (s->rc_lookahead) {
+        if (!(avctx->codec->capabilities & CODEC_CAP_DELAY)) {
+            av_log(avctx, AV_LOG_WARNING,
+                   "rc_lookahead is not supported by this encoder, disabling it\n");
+            s->rc_lookahead = 0;
+        } else if (!avctx->rc_buffer_size || !avctx->rc_max_rate) {
+            av_log(avctx, AV_LOG_WARNING,
+                   "rc_lookahead needs a VBV buffer size and max rate, disabling it\n");
+            s->rc_lookahead = 0;
+        } else {
+            s->rc_lookahead = FFMIN(s->rc_lookahead,
+                                    MAX_PICTURE_COUNT - 8 - s->max_b_frames);
+            avctx->delay   += s->rc_lookahead;
+        }
+    }
+
     avctx->has_b_frames = !s->low_delay;
 
     s->encoding = 1;
@@ -946,6 +963,15 @@ av_cold int ff_MPV_encode_init(AVCodecContext *avctx)
                           31, 0);
     }
 
+    if (s->rc_lookahead) {
+        s->la_stride = s->mb_width * 8;
+        for (i = 0; i < 2; i++) {
+            s->la_buf[i] = av_mallocz(s->la_stride * s->mb_height * 8);
+            if (!s->la_buf[i])
+                return AVERROR(ENOMEM);
+        }
+    }
+
     if (ff_rate_control_init(s) < 0)
         return -1;
 
@@ -958,6 +984,9 @@ av_cold int ff_MPV_encode_end(AVCodecContext *avctx)
 
     ff_rate_control_uninit(s);
 
+    av_freep(&s->la_buf[0]);
+    av_freep(&s->la_buf[1]);
+
     ff_MPV_common_end(s);
     if ((CONFIG_MJPEG_ENCODER || CONFIG_LJPEG_ENCODER) &&
         s->out_format == FMT_MJPEG)
@@ -1006,13 +1035,62 @@ static int get_intra_count(MpegEncContext *s, uint8_t *src,
 }
 
 
+/**
+ * Estimate the coding cost of a frame for the rate control lookahead, from
+ * half resolution luma: the sum over 8x8 blocks of the lower of the SAD
+ * against the previous frame and the SAD against the block mean.
+ */
+static int lookahead_cost(MpegEncContext *s, const AVFrame *frame)
+{
+    uint8_t *cur  = s->la_buf[0];
+    uint8_t *prev = s->la_buf[1];
+    const int stride = s->la_stride;
+    const int w = s->width  >> 1;
+    const int h = s->height >> 1;
+    int x, y, bx, by, cost = 0;
+
+    for (y = 0; y < h; y++) {
+        const uint8_t *src = frame->data[0] + 2 * y * frame->linesize[0];
+        for (x = 0; x < w; x++)
+            cur[y * stride + x] = (src[2 * x] + src[2 * x + 1] +
+                                   src[2 * x + frame->linesize[0]] +
+                                   src[2 * x + frame->linesize[0] + 1] + 2) >> 2;
+    }
+
+    for (by = 0; by + 8 <= h; by += 8) {
+        for (bx = 0; bx + 8 <= w; bx += 8) {
+            uint8_t *blk = cur + by * stride + bx;
+            int sum = 0, intra = 0, inter;
+
+            for (y = 0; y < 8; y++)
+                for (x = 0; x < 8; x++)
+                    sum += blk[y * stride + x];
+            sum = (sum + 32) >> 6;
+            for (y = 0; y < 8; y++)
+                for (x = 0; x < 8; x++)
+                    intra += FFABS(blk[y * stride + x] - sum);
+
+            if (s->input_picture_number > 1) {
+                inter = s->dsp.sad[1](s, blk, prev + by * stride + bx, stride, 8);
+                intra = FFMIN(intra, inter);
+            }
+            cost += intra;
+        }
+    }
+    emms_c();
+
+    FFSWAP(uint8_t *, s->la_buf[0], s->la_buf[1]);
+    return cost;
+}
+
 static int load_input_picture(MpegEncContext *s, AVFrame *pic_arg)
 {
     AVFrame *pic = NULL;
     int64_t pts;
     int i;
-    const int encoding_delay = s->max_b_frames ? s->max_b_frames :
-                                                 (s->low_delay ? 0 : 1);
+    const int encoding_delay = (s->max_b_frames ? s->max_b_frames :
+                                                  (s->low_delay ? 0 : 1)) +
+                               s->rc_lookahead;
     int direct = 1;
 
     if (pic_arg) {
@@ -1127,6 +1205,10 @@ static int load_input_picture(MpegEncContext *s, AVFrame *pic_arg)
     }
     copy_picture_attributes(s, pic, pic_arg);
     pic->pts = pts; // we set this here to avoid modifiying pic_arg
+    ((Picture *) pic)->duplicate =
+        !!av_dict_get(av_frame_get_metadata(pic_arg), "lavfi.fps.duplicate", NULL, 0);
+    if (s->rc_lookahead)
+        ((Picture *) pic)->la_cost = lookahead_cost(s, pic_arg);
   }
 
     /* shift buffer entries */
@@ -1335,7 +1417,8 @@ static int select_input_picture(MpegEncContext *s)
 
             if (s->avctx->frame_skip_threshold || s->avctx->frame_skip_factor) {
                 if (s->picture_in_gop_number < s->gop_size &&
-                    skip_check(s, s->input_picture[0], s->next_picture_ptr)) {
+                    (s->input_picture[0]->duplicate ||
+                     skip_check(s, s->input_picture[0], s->next_picture_ptr))) {
                     // FIXME check that te gop check above is +-1 correct
                     if (s->input_picture[0]->f.type == FF_BUFFER_TYPE_SHARED) {
                         for (i = 0; i < 4; i++)
@@ -1483,6 +1566,7 @@ no_output_pic:
 
             copy_picture_attributes(s, &pic->f,
                                     &s->reordered_input_picture[0]->f);
+            pic->la_cost = s->reordered_input_picture[0]->la_cost;
 
             s->current_picture_ptr = pic;
         } else {
@@ -1507,12 +1591,25 @@ no_output_pic:
     return 0;
 }
 
+/**
+ * Split the macroblock rows evenly among the first count thread contexts.
+ */
+static void set_context_rows(MpegEncContext *s, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        s->thread_context[i]->start_mb_y = (s->mb_height *  i      + count / 2) / count;
+        s->thread_context[i]->end_mb_y   = (s->mb_height * (i + 1) + count / 2) / count;
+    }
+}
+
 int ff_MPV_encode_picture(AVCodecContext *avctx, AVPacket *pkt,
                           AVFrame *pic_arg, int *got_packet)
 {
     MpegEncContext *s = avctx->priv_data;
     int i, stuffing_count, ret;
-    int context_count = s->slice_context_count;
+    int context_count = s->enc_context_count;
 
     s->picture_in_gop_number++;
 
@@ -1534,6 +1631,7 @@ int ff_MPV_encode_picture(AVCodecContext *avctx, AVPacket *pkt,
             s->prev_mb_info = s->last_mb_info = s->mb_info_size = 0;
         }
 
+        set_context_rows(s, context_count);
         for (i = 0; i < context_count; i++) {
             int start_y = s->thread_context[i]->start_mb_y;
             int   end_y = s->thread_context[i]->  end_mb_y;
@@ -3288,6 +3386,10 @@ static int encode_picture(MpegEncContext *s, int picture_number)
     if(ff_init_me(s)<0)
         return -1;
 
+    /* the motion estimation uses all thread contexts even if the
+     * bitstream has fewer slices */
+    set_context_rows(s, context_count);
+
     /* Estimate motion for every MB */
     if(s->pict_type != AV_PICTURE_TYPE_I){
         s->lambda = (s->lambda * s->avctx->me_penalty_compensation + 128)>>8;
@@ -3312,6 +3414,8 @@ static int encode_picture(MpegEncContext *s, int picture_number)
     for(i=1; i<context_count; i++){
         merge_context_after_me(s, s->thread_context[i]);
     }
+    context_count = s->enc_context_count;
+    set_context_rows(s, context_count);
     s->current_picture.mc_mb_var_sum= s->current_picture_ptr->mc_mb_var_sum= s->me.mc_mb_var_sum_temp;
     s->current_picture.   mb_var_sum= s->current_picture_ptr->   mb_var_sum= s->me.   mb_var_sum_temp;
     emms_c();
@@ -35,6 +35,20 @@
 //#define DEBUG
 
 #define IOBUF_SIZE 4096
+#define MAX_SLICES 32
+
+/**
+ * A band of rows compressed on its own. The bands end with a sync flush so
+ * their outputs concatenate into a single deflate stream.
+ */
+typedef struct PNGEncSlice {
+    z_stream zstream;
+    uint8_t *buf;               ///< compressed data of the slice
+    unsigned int buf_size;
+    int size;                   ///< number of compressed bytes in buf
+    uLong adler;                ///< adler32 of the uncompressed slice
+    uLong len;                  ///< size of the uncompressed slice
+} PNGEncSlice;
 
 typedef struct PNGEncContext {
     DSPContext dsp;
@@ -48,6 +62,12 @@ typedef struct PNGEncContext {
 
     z_stream zstream;
     uint8_t buf[IOBUF_SIZE];
+
+    int compression_level;
+    int row_size;
+    int bits_per_pixel;
+    PNGEncSlice *slices;
+    int nb_slices;
 } PNGEncContext;
 
 static void png_get_interlaced_row(uint8_t *dst, int row_size,
@@ -215,6 +235,100 @@ static int png_write_row(PNGEncContext *s, const uint8_t *data, int size)
     return 0;
 }
 
+static int encode_slice(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    PNGEncContext *s = avctx->priv_data;
+    PNGEncSlice *sl  = &s->slices[jobnr];
+    const AVFrame *p = &s->picture;
+    const int last    = jobnr == s->nb_slices - 1;
+    const int y_start = (avctx->height *  jobnr   ) / s->nb_slices;
+    const int y_end   = (avctx->height * (jobnr+1)) / s->nb_slices;
+    uint8_t *crow_base, *crow_buf, *crow, *ptr, *top;
+    int y, ret;
+
+    crow_base = av_malloc((s->row_size + 32) << (s->filter_type == PNG_FILTER_VALUE_MIXED));
+    if (!crow_base)
+        return AVERROR(ENOMEM);
+    crow_buf = crow_base + 15;
+
+    /* only the first slice carries the zlib header, the trailer is written
+     * by the caller from the combined checksums */
+    sl->zstream.zalloc = ff_png_zalloc;
+    sl->zstream.zfree  = ff_png_zfree;
+    sl->zstream.opaque = NULL;
+    if (deflateInit2(&sl->zstream, s->compression_level,
+                     Z_DEFLATED, jobnr ? -15 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        av_free(crow_base);
+        return -1;
+    }
+    sl->zstream.next_out  = sl->buf;
+    sl->zstream.avail_out = sl->buf_size;
+    sl->adler = adler32(0, Z_NULL, 0);
+    sl->len   = 0;
+
+    ret = 0;
+    top = y_start ? p->data[0] + (y_start - 1) * p->linesize[0] : NULL;
+    for (y = y_start; y < y_end; y++) {
+        ptr  = p->data[0] + y * p->linesize[0];
+        crow = png_choose_filter(s, crow_buf, ptr, top, s->row_size, s->bits_per_pixel >> 3);
+        sl->adler = adler32(sl->adler, crow, s->row_size + 1);
+        sl->len  += s->row_size + 1;
+        sl->zstream.next_in  = crow;
+        sl->zstream.avail_in = s->row_size + 1;
+        if (deflate(&sl->zstream, Z_NO_FLUSH) != Z_OK || sl->zstream.avail_in) {
+            ret = -1;
+            break;
+        }
+        top = ptr;
+    }
+    if (!ret &&
+        deflate(&sl->zstream, last ? Z_FINISH : Z_SYNC_FLUSH) != (last ? Z_STREAM_END : Z_OK))
+        ret = -1;
+    sl->size = sl->buf_size - sl->zstream.avail_out;
+
+    deflateEnd(&sl->zstream);
+    av_free(crow_base);
+    return ret;
+}
+
+static int encode_slices(AVCodecContext *avctx)
+{
+    PNGEncContext *s = avctx->priv_data;
+    uLong adler;
+    int i, rets[MAX_SLICES];
+
+    for (i = 0; i < s->nb_slices; i++) {
+        int rows = (avctx->height * (i+1)) / s->nb_slices -
+                   (avctx->height *  i   ) / s->nb_slices;
+        unsigned int size = deflateBound(&s->zstream, rows * (s->row_size + 1)) + 64;
+        PNGEncSlice *sl = &s->slices[i];
+
+        av_fast_malloc(&sl->buf, &sl->buf_size, size);
+        if (!sl->buf)
+            return AVERROR(ENOMEM);
+    }
+
+    avctx->execute2(avctx, encode_slice, NULL, rets, s->nb_slices);
+
+    adler = s->slices[0].adler;
+    for (i = 0; i < s->nb_slices; i++) {
+        PNGEncSlice *sl = &s->slices[i];
+
+        if (rets[i] < 0)
+            return rets[i];
+        if (i)
+            adler = adler32_combine(adler, sl->adler, sl->len);
+        if (i == s->nb_slices - 1) {
+            AV_WB32(sl->buf + sl->size, adler);
+            sl->size += 4;
+        }
+        if (s->bytestream_end - s->bytestream < sl->size + 12 + 100)
+            return AVERROR(ENOMEM);
+        png_write_chunk(&s->bytestream, MKTAG('I', 'D', 'A', 'T'), sl->buf, sl->size);
+    }
+    return 0;
+}
+
 static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                         const AVFrame *pict, int *got_packet)
 {
@@ -288,6 +402,9 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     compression_level = avctx->compression_level == FF_COMPRESSION_DEFAULT ?
                             Z_DEFAULT_COMPRESSION :
                             av_clip(avctx->compression_level, 0, 9);
+    s->compression_level = compression_level;
+    s->row_size          = row_size;
+    s->bits_per_pixel    = bits_per_pixel;
     ret = deflateInit2(&s->zstream, compression_level,
                        Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY);
     if (ret != Z_OK)
@@ -368,7 +485,12 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     /* now put each row */
     s->zstream.avail_out = IOBUF_SIZE;
     s->zstream.next_out = s->buf;
-    if (is_progressive) {
+    if (s->nb_slices > 1 && !is_progressive) {
+        /* the slices write the whole stream, trailer included */
+        if ((ret = encode_slices(avctx)) < 0)
+            goto fail;
+        goto write_end;
+    } else if (is_progressive) {
         int pass;
 
         for(pass = 0; pass < NB_PASSES; pass++) {
@@ -416,6 +538,7 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
             goto fail;
         }
     }
+ write_end:
     png_write_chunk(&s->bytestream, MKTAG('I', 'E', 'N', 'D'), NULL, 0);
 
     pkt->size   = s->bytestream - s->bytestream_start;
@@ -445,6 +568,24 @@ static av_cold int png_enc_init(AVCodecContext *avctx){
     if(avctx->pix_fmt == AV_PIX_FMT_MONOBLACK)
         s->filter_type = PNG_FILTER_VALUE_NONE;
 
+    if (avctx->active_thread_type & FF_THREAD_SLICE) {
+        s->nb_slices = FFMIN(avctx->thread_count, MAX_SLICES);
+        s->slices    = av_mallocz(s->nb_slices * sizeof(*s->slices));
+        if (!s->slices)
+            return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+
+static av_cold int png_enc_close(AVCodecContext *avctx)
+{
+    PNGEncContext *s = avctx->priv_data;
+    int i;
+
+    for (i = 0; i < s->nb_slices; i++)
+        av_freep(&s->slices[i].buf);
+    av_freep(&s->slices);
     return 0;
 }
 
@@ -455,7 +596,8 @@ AVCodec ff_png_encoder = {
     .priv_data_size = sizeof(PNGEncContext),
     .init           = png_enc_init,
     .encode2        = encode_frame,
-    .capabilities   = CODEC_CAP_FRAME_THREADS | CODEC_CAP_INTRA_ONLY,
+    .close          = png_enc_close,
+    .capabilities   = CODEC_CAP_FRAME_THREADS | CODEC_CAP_SLICE_THREADS | CODEC_CAP_INTRA_ONLY,
     .pix_fmts       = (const enum AVPixelFormat[]){
         AV_PIX_FMT_RGB24, AV_PIX_FMT_RGBA,
         AV_PIX_FMT_RGB48BE, AV_PIX_FMT_RGBA64BE,
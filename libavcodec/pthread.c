@@ -31,31 +31,12 @@
 
 #include "config.h"
 
-#if HAVE_SCHED_GETAFFINITY
-#ifndef _GNU_SOURCE
-# define _GNU_SOURCE
-#endif
-#include <sched.h>
-#endif
-#if HAVE_GETPROCESSAFFINITYMASK
-#include <windows.h>
-#endif
-#if HAVE_SYSCTL
-#if HAVE_SYS_PARAM_H
-#include <sys/param.h>
-#endif
-#include <sys/types.h>
-#include <sys/param.h>
-#include <sys/sysctl.h>
-#endif
-#if HAVE_SYSCONF
-#include <unistd.h>
-#endif
-
 #include "avcodec.h"
 #include "internal.h"
 #include "thread.h"
 #include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/slicethread.h"
 
 #if HAVE_PTHREADS
 #include <pthread.h>
@@ -111,6 +92,13 @@ typedef struct ThreadContext {
     int current_job;
     unsigned int current_execute;
     int done;
+
+    volatile int *entries;          ///< progress values shared between the jobs of one execute() call
+    int entries_count;
+    pthread_mutex_t progress_mutex; ///< Mutex used to protect entries
+    pthread_cond_t progress_cond;   ///< Used by ff_thread_await_progress2() to wait for entries to change
+
+    AVSliceThread *shared;          ///< jobs run on the shared thread pool instead of workers
 } ThreadContext;
 
 /// Max number of frame buffers that can be allocated when using frame threads.
@@ -193,33 +181,8 @@ typedef struct FrameThreadContext {
 
 int ff_get_logical_cpus(AVCodecContext *avctx)
 {
-    int ret, nb_cpus = 1;
-#if HAVE_SCHED_GETAFFINITY && defined(CPU_COUNT)
-    cpu_set_t cpuset;
-
-    CPU_ZERO(&cpuset);
+    int nb_cpus = av_cpu_count();
 
-    ret = sched_getaffinity(0, sizeof(cpuset), &cpuset);
-    if (!ret) {
-        nb_cpus = CPU_COUNT(&cpuset);
-    }
-#elif HAVE_GETPROCESSAFFINITYMASK
-    DWORD_PTR proc_aff, sys_aff;
-    ret = GetProcessAffinityMask(GetCurrentProcess(), &proc_aff, &sys_aff);
-    if (ret)
-        nb_cpus = av_popcount64(proc_aff);
-#elif HAVE_SYSCTL && defined(HW_NCPU)
-    int mib[2] = { CTL_HW, HW_NCPU };
-    size_t len = sizeof(nb_cpus);
-
-    ret = sysctl(mib, 2, &nb_cpus, &len, NULL, 0);
-    if (ret == -1)
-        nb_cpus = 0;
-#elif HAVE_SYSCONF && defined(_SC_NPROC_ONLN)
-    nb_cpus = sysconf(_SC_NPROC_ONLN);
-#elif HAVE_SYSCONF && defined(_SC_NPROCESSORS_ONLN)
-    nb_cpus = sysconf(_SC_NPROCESSORS_ONLN);
-#endif
     av_log(avctx, AV_LOG_DEBUG, "detected %d logical cores\n", nb_cpus);
 
     if  (avctx->height)
@@ -265,6 +228,15 @@ static void* attribute_align_arg worker(void *v)
     }
 }
 
+static void shared_worker(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    AVCodecContext *avctx = priv;
+    ThreadContext *c = avctx->thread_opaque;
+
+    c->rets[jobnr%c->rets_count] = c->func ? c->func(avctx, (char*)c->args + jobnr*c->job_size):
+                                             c->func2(avctx, c->args, jobnr, threadnr);
+}
+
 static av_always_inline void avcodec_thread_park_workers(ThreadContext *c, int thread_count)
 {
     while (c->current_job != thread_count + c->job_count)
@@ -277,6 +249,15 @@ static void thread_free(AVCodecContext *avctx)
     ThreadContext *c = avctx->thread_opaque;
     int i;
 
+    if (c->shared) {
+        avpriv_slicethread_free(&c->shared);
+        pthread_mutex_destroy(&c->progress_mutex);
+        pthread_cond_destroy(&c->progress_cond);
+        av_freep(&c->entries);
+        av_freep(&avctx->thread_opaque);
+        return;
+    }
+
     pthread_mutex_lock(&c->current_job_lock);
     c->done = 1;
     pthread_cond_broadcast(&c->current_job_cond);
@@ -288,6 +269,9 @@ static void thread_free(AVCodecContext *avctx)
     pthread_mutex_destroy(&c->current_job_lock);
     pthread_cond_destroy(&c->current_job_cond);
     pthread_cond_destroy(&c->last_job_cond);
+    pthread_mutex_destroy(&c->progress_mutex);
+    pthread_cond_destroy(&c->progress_cond);
+    av_freep(&c->entries);
     av_free(c->workers);
     av_freep(&avctx->thread_opaque);
 }
@@ -303,6 +287,21 @@ static int avcodec_thread_execute(AVCodecContext *avctx, action_func* func, void
     if (job_count <= 0)
         return 0;
 
+    if (c->shared) {
+        c->job_size = job_size;
+        c->args = arg;
+        c->func = func;
+        if (ret) {
+            c->rets = ret;
+            c->rets_count = job_count;
+        } else {
+            c->rets = &dummy_ret;
+            c->rets_count = 1;
+        }
+        avpriv_slicethread_execute(c->shared, job_count);
+        return 0;
+    }
+
     pthread_mutex_lock(&c->current_job_lock);
 
     c->current_job = avctx->thread_count;
@@ -342,7 +341,8 @@ static int thread_init(AVCodecContext *avctx)
         int nb_cpus = ff_get_logical_cpus(avctx);
         // use number of cores + 1 as thread count if there is more than one
         if (nb_cpus > 1)
-            thread_count = avctx->thread_count = FFMIN(nb_cpus + 1, MAX_AUTO_THREADS);
+            thread_count = avctx->thread_count = avctx->shared_threads ? nb_cpus + 1 :
+                                                 FFMIN(nb_cpus + 1, MAX_AUTO_THREADS);
         else
             thread_count = avctx->thread_count = 1;
     }
@@ -363,6 +363,25 @@ static int thread_init(AVCodecContext *avctx)
     }
 
     avctx->thread_opaque = c;
+
+    /* thread_count only limits the number of jobs running at the same time
+     * on the shared pool */
+    if (avctx->shared_threads) {
+        pthread_cond_init(&c->progress_cond, NULL);
+        pthread_mutex_init(&c->progress_mutex, NULL);
+        if (avpriv_slicethread_create_shared(&c->shared, avctx, shared_worker,
+                                             thread_count) >= 0) {
+            av_freep(&c->workers);
+            avctx->execute = avcodec_thread_execute;
+            avctx->execute2 = avcodec_thread_execute2;
+            return 0;
+        }
+        av_log(avctx, AV_LOG_WARNING, "Could not use the shared thread pool, "
+               "starting %d threads\n", thread_count);
+        pthread_mutex_destroy(&c->progress_mutex);
+        pthread_cond_destroy(&c->progress_cond);
+    }
+
     c->current_job = 0;
     c->job_count = 0;
     c->job_size = 0;
@@ -370,6 +389,8 @@ static int thread_init(AVCodecContext *avctx)
     pthread_cond_init(&c->current_job_cond, NULL);
     pthread_cond_init(&c->last_job_cond, NULL);
     pthread_mutex_init(&c->current_job_lock, NULL);
+    pthread_cond_init(&c->progress_cond, NULL);
+    pthread_mutex_init(&c->progress_mutex, NULL);
     pthread_mutex_lock(&c->current_job_lock);
     for (i=0; i<thread_count; i++) {
         if(pthread_create(&c->workers[i], NULL, worker, avctx)) {
@@ -387,6 +408,55 @@ static int thread_init(AVCodecContext *avctx)
     return 0;
 }
 
+int ff_alloc_entries(AVCodecContext *avctx, int count)
+{
+    ThreadContext *c = avctx->thread_opaque;
+    int i;
+
+    if (count > c->entries_count) {
+        av_freep(&c->entries);
+        c->entries = av_malloc(count * sizeof(*c->entries));
+        if (!c->entries) {
+            c->entries_count = 0;
+            return AVERROR(ENOMEM);
+        }
+        c->entries_count = count;
+    }
+    for (i = 0; i < count; i++)
+        c->entries[i] = 0;
+
+    return 0;
+}
+
+void ff_thread_report_progress2(AVCodecContext *avctx, int entry, int n)
+{
+    ThreadContext *c = avctx->thread_opaque;
+
+    if (c->entries[entry] >= n)
+        return;
+
+    pthread_mutex_lock(&c->progress_mutex);
+    c->entries[entry] = n;
+    pthread_cond_broadcast(&c->progress_cond);
+    pthread_mutex_unlock(&c->progress_mutex);
+}
+
+int ff_thread_await_progress2(AVCodecContext *avctx, int entry, int n)
+{
+    ThreadContext *c = avctx->thread_opaque;
+    int val = c->entries[entry];
+
+    if (val >= n)
+        return val;
+
+    pthread_mutex_lock(&c->progress_mutex);
+    while ((val = c->entries[entry]) < n)
+        pthread_cond_wait(&c->progress_cond, &c->progress_mutex);
+    pthread_mutex_unlock(&c->progress_mutex);
+
+    return val;
+}
+
 /**
  * Codec worker thread.
  *
@@ -599,6 +669,18 @@ static int submit_packet(PerThreadContext *p, AVPacket *avpkt)
     memset(buf + avpkt->size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
 
     p->state = STATE_SETTING_UP;
+
+    /* worker threads are only started once they get their first packet */
+    if (!p->thread_init) {
+        int err = AVERROR(pthread_create(&p->thread, NULL, frame_worker_thread, p));
+        p->thread_init = !err;
+        if (err) {
+            p->state = STATE_INPUT_READY;
+            pthread_mutex_unlock(&p->mutex);
+            return err;
+        }
+    }
+
     pthread_cond_signal(&p->input_cond);
     pthread_mutex_unlock(&p->mutex);
 
@@ -909,11 +991,6 @@ static int frame_thread_init(AVCodecContext *avctx)
         }
 
         if (err) goto error;
-
-        err = AVERROR(pthread_create(&p->thread, NULL, frame_worker_thread, p));
-        p->thread_init= !err;
-        if(!p->thread_init)
-            goto error;
     }
 
     return 0;
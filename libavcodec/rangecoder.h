@@ -49,29 +49,29 @@ void ff_init_range_decoder(RangeCoder *c, const uint8_t *buf, int buf_size);
 int ff_rac_terminate(RangeCoder *c);
 void ff_build_rac_states(RangeCoder *c, int factor, int max_p);
 
+/**
+ * Output one byte. Must only be called with range < 0x100, which is
+ * what a single coded bit can shrink the range to at most, so one shift
+ * always restores range >= 0x100.
+ */
 static inline void renorm_encoder(RangeCoder *c)
 {
-    // FIXME: optimize
-    while (c->range < 0x100) {
-        if (c->outstanding_byte < 0) {
-            c->outstanding_byte = c->low >> 8;
-        } else if (c->low <= 0xFF00) {
-            *c->bytestream++ = c->outstanding_byte;
-            for (; c->outstanding_count; c->outstanding_count--)
-                *c->bytestream++ = 0xFF;
-            c->outstanding_byte = c->low >> 8;
-        } else if (c->low >= 0x10000) {
-            *c->bytestream++ = c->outstanding_byte + 1;
-            for (; c->outstanding_count; c->outstanding_count--)
-                *c->bytestream++ = 0x00;
-            c->outstanding_byte = (c->low >> 8) & 0xFF;
-        } else {
-            c->outstanding_count++;
-        }
-
-        c->low     = (c->low & 0xFF) << 8;
-        c->range <<= 8;
+    if (c->low - 0xFF01 >= 0x10000 - 0xFF01U) {
+        /* the carry is known: 0 for low <= 0xFF00, 1 for low >= 0x10000 */
+        int mask = c->low - 0xFF01 >> 31;
+        /* the first call has no outstanding byte yet, the store is then
+         * overwritten by the next one */
+        *c->bytestream = c->outstanding_byte + 1 + mask;
+        c->bytestream += c->outstanding_byte >= 0;
+        for (; c->outstanding_count; c->outstanding_count--)
+            *c->bytestream++ = mask;
+        c->outstanding_byte = c->low >> 8;
+    } else {
+        c->outstanding_count++;
     }
+
+    c->low     = (c->low & 0xFF) << 8;
+    c->range <<= 8;
 }
 
 static inline int get_rac_count(RangeCoder *c)
@@ -98,7 +98,8 @@ static inline void put_rac(RangeCoder *c, uint8_t *const state, int bit)
         *state   = c->one_state[*state];
     }
 
-    renorm_encoder(c);
+    if (c->range < 0x100)
+        renorm_encoder(c);
 }
 
 static inline void refill(RangeCoder *c)
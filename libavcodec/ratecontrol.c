@@ -117,10 +117,13 @@ int ff_rate_control_init(MpegEncContext *s)
             s->avctx->rc_max_available_vbv_use = 1.0;
     }
 
-    res = av_expr_parse(&rcc->rc_eq_eval, s->avctx->rc_eq ? s->avctx->rc_eq : "tex^qComp", const_names, func1_names, func1, NULL, NULL, 0, s->avctx);
-    if (res < 0) {
-        av_log(s->avctx, AV_LOG_ERROR, "Error parsing rc_eq \"%s\"\n", s->avctx->rc_eq);
-        return res;
+    /* the default equation is evaluated directly in get_qscale() */
+    if (s->avctx->rc_eq && strcmp(s->avctx->rc_eq, "tex^qComp")) {
+        res = av_expr_parse(&rcc->rc_eq_eval, s->avctx->rc_eq, const_names, func1_names, func1, NULL, NULL, 0, s->avctx);
+        if (res < 0) {
+            av_log(s->avctx, AV_LOG_ERROR, "Error parsing rc_eq \"%s\"\n", s->avctx->rc_eq);
+            return res;
+        }
     }
 
     for(i=0; i<5; i++){
@@ -324,38 +327,43 @@ static double get_qscale(MpegEncContext *s, RateControlEntry *rce, double rate_f
     const double mb_num= s->mb_num;
     int i;
 
-    double const_values[]={
-        M_PI,
-        M_E,
-        rce->i_tex_bits*rce->qscale,
-        rce->p_tex_bits*rce->qscale,
-        (rce->i_tex_bits + rce->p_tex_bits)*(double)rce->qscale,
-        rce->mv_bits/mb_num,
-        rce->pict_type == AV_PICTURE_TYPE_B ? (rce->f_code + rce->b_code)*0.5 : rce->f_code,
-        rce->i_count/mb_num,
-        rce->mc_mb_var_sum/mb_num,
-        rce->mb_var_sum/mb_num,
-        rce->pict_type == AV_PICTURE_TYPE_I,
-        rce->pict_type == AV_PICTURE_TYPE_P,
-        rce->pict_type == AV_PICTURE_TYPE_B,
-        rcc->qscale_sum[pict_type] / (double)rcc->frame_count[pict_type],
-        a->qcompress,
-/*        rcc->last_qscale_for[AV_PICTURE_TYPE_I],
-        rcc->last_qscale_for[AV_PICTURE_TYPE_P],
-        rcc->last_qscale_for[AV_PICTURE_TYPE_B],
-        rcc->next_non_b_qscale,*/
-        rcc->i_cplx_sum[AV_PICTURE_TYPE_I] / (double)rcc->frame_count[AV_PICTURE_TYPE_I],
-        rcc->i_cplx_sum[AV_PICTURE_TYPE_P] / (double)rcc->frame_count[AV_PICTURE_TYPE_P],
-        rcc->p_cplx_sum[AV_PICTURE_TYPE_P] / (double)rcc->frame_count[AV_PICTURE_TYPE_P],
-        rcc->p_cplx_sum[AV_PICTURE_TYPE_B] / (double)rcc->frame_count[AV_PICTURE_TYPE_B],
-        (rcc->i_cplx_sum[pict_type] + rcc->p_cplx_sum[pict_type]) / (double)rcc->frame_count[pict_type],
-        0
-    };
-
-    bits = av_expr_eval(rcc->rc_eq_eval, const_values, rce);
-    if (isnan(bits)) {
-        av_log(s->avctx, AV_LOG_ERROR, "Error evaluating rc_eq \"%s\"\n", s->avctx->rc_eq);
-        return -1;
+    if (!rcc->rc_eq_eval) {
+        /* default rc_eq, tex^qComp */
+        bits = pow((rce->i_tex_bits + rce->p_tex_bits)*(double)rce->qscale, a->qcompress);
+    } else {
+        double const_values[]={
+            M_PI,
+            M_E,
+            rce->i_tex_bits*rce->qscale,
+            rce->p_tex_bits*rce->qscale,
+            (rce->i_tex_bits + rce->p_tex_bits)*(double)rce->qscale,
+            rce->mv_bits/mb_num,
+            rce->pict_type == AV_PICTURE_TYPE_B ? (rce->f_code + rce->b_code)*0.5 : rce->f_code,
+            rce->i_count/mb_num,
+            rce->mc_mb_var_sum/mb_num,
+            rce->mb_var_sum/mb_num,
+            rce->pict_type == AV_PICTURE_TYPE_I,
+            rce->pict_type == AV_PICTURE_TYPE_P,
+            rce->pict_type == AV_PICTURE_TYPE_B,
+            rcc->qscale_sum[pict_type] / (double)rcc->frame_count[pict_type],
+            a->qcompress,
+/*            rcc->last_qscale_for[AV_PICTURE_TYPE_I],
+            rcc->last_qscale_for[AV_PICTURE_TYPE_P],
+            rcc->last_qscale_for[AV_PICTURE_TYPE_B],
+            rcc->next_non_b_qscale,*/
+            rcc->i_cplx_sum[AV_PICTURE_TYPE_I] / (double)rcc->frame_count[AV_PICTURE_TYPE_I],
+            rcc->i_cplx_sum[AV_PICTURE_TYPE_P] / (double)rcc->frame_count[AV_PICTURE_TYPE_P],
+            rcc->p_cplx_sum[AV_PICTURE_TYPE_P] / (double)rcc->frame_count[AV_PICTURE_TYPE_P],
+            rcc->p_cplx_sum[AV_PICTURE_TYPE_B] / (double)rcc->frame_count[AV_PICTURE_TYPE_B],
+            (rcc->i_cplx_sum[pict_type] + rcc->p_cplx_sum[pict_type]) / (double)rcc->frame_count[pict_type],
+            0
+        };
+
+        bits = av_expr_eval(rcc->rc_eq_eval, const_values, rce);
+        if (isnan(bits)) {
+            av_log(s->avctx, AV_LOG_ERROR, "Error evaluating rc_eq \"%s\"\n", s->avctx->rc_eq);
+            return -1;
+        }
     }
 
     rcc->pass1_rc_eq_output_sum+= bits;
@@ -534,6 +542,36 @@ static void update_predictor(Predictor *p, double q, double var, double size)
     p->coeff+= new_coeff;
 }
 
+/**
+ * Raise q until the frames in the lookahead, predicted from their complexity
+ * relative to the current frame, keep the VBV buffer from running low.
+ */
+static double lookahead_qscale(MpegEncContext *s, RateControlEntry *rce,
+                               double q, int var)
+{
+    RateControlContext *rcc  = &s->rc_context;
+    const double buffer_size = s->avctx->rc_buffer_size;
+    const double max_rate    = s->avctx->rc_max_rate / get_fps(s->avctx);
+    const double cur_cost    = FFMAX(s->current_picture_ptr->la_cost, 1);
+    int i, iter;
+
+    for (iter = 0; iter < 16; iter++) {
+        double bits  = predict_size(&rcc->pred[rce->new_pict_type], q, sqrt(var));
+        double level = rcc->buffer_index - bits;
+        double min_level = level;
+
+        for (i = 0; i < s->rc_lookahead && s->input_picture[i]; i++) {
+            level  = FFMIN(level + max_rate, buffer_size);
+            level -= bits * s->input_picture[i]->la_cost / cur_cost;
+            min_level = FFMIN(min_level, level);
+        }
+        if (min_level >= 0.1 * buffer_size)
+            break;
+        q *= 1.1;
+    }
+    return q;
+}
+
 static void adaptive_quantization(MpegEncContext *s, double q){
     int i;
     const float lumi_masking= s->avctx->lumi_masking / (128.0*128.0);
@@ -777,6 +815,9 @@ float ff_rate_estimate_qscale(MpegEncContext *s, int dry_run)
         }
         assert(q>0.0);
 
+        if (s->rc_lookahead)
+            q= lookahead_qscale(s, rce, q, var);
+
         q= modify_qscale(s, rce, q, picture_number);
 
         rcc->pass1_wanted_bits+= s->bit_rate/fps;
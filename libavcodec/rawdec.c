@@ -25,6 +25,7 @@
  */
 
 #include "avcodec.h"
+#include "internal.h"
 #include "raw.h"
 #include "libavutil/avassert.h"
 #include "libavutil/common.h"
@@ -289,4 +290,5 @@ AVCodec ff_rawvideo_decoder = {
     .decode         = raw_decode,
     .long_name      = NULL_IF_CONFIG_SMALL("raw video"),
     .priv_class     = &class,
+    .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE,
 };
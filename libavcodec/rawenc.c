@@ -77,4 +77,5 @@ AVCodec ff_rawvideo_encoder = {
     .init           = raw_init_encoder,
     .encode2        = raw_encode,
     .long_name      = NULL_IF_CONFIG_SMALL("raw video"),
+    .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE,
 };
@@ -168,6 +168,8 @@ typedef struct SnowContext{
 
     uint8_t *scratchbuf;
     uint8_t *emu_edge_buffer;
+
+    struct SnowContext *thread_ctx[MAX_PLANES]; ///< decoder contexts reconstructing the chroma planes with slice threads
 }SnowContext;
 
 /* Tables */
@@ -366,16 +366,59 @@ static int decode_header(SnowContext *s){
 
 static av_cold int decode_init(AVCodecContext *avctx)
 {
-    int ret;
+    SnowContext *s = avctx->priv_data;
+    int ret, i;
 
     if ((ret = ff_snow_common_init(avctx)) < 0) {
         ff_snow_common_end(avctx->priv_data);
         return ret;
     }
 
+    if (avctx->active_thread_type & FF_THREAD_SLICE && avctx->thread_count > 1) {
+        for (i = 1; i < 3; i++) {
+            s->thread_ctx[i] = av_mallocz(sizeof(SnowContext));
+            if (!s->thread_ctx[i])
+                return AVERROR(ENOMEM);
+        }
+    }
+
     return 0;
 }
 
+/**
+ * Copy the state of the main context into a plane context,
+ * keeping the scratch buffers of the plane context.
+ */
+static int update_thread_context(SnowContext *dst, SnowContext *src)
+{
+    AVCodecContext *avctx    = src->avctx;
+    uint8_t *scratchbuf      = dst->scratchbuf;
+    uint8_t *emu_edge_buffer = dst->emu_edge_buffer;
+    IDWTELEM *temp_idwt_buffer = dst->temp_idwt_buffer;
+    slice_buffer sb          = dst->sb;
+    int stride = FFMAX(src->mconly_picture.linesize[0], 2*avctx->width+256);
+
+    memcpy(dst, src, sizeof(*dst));
+    dst->scratchbuf       = scratchbuf;
+    dst->emu_edge_buffer  = emu_edge_buffer;
+    dst->temp_idwt_buffer = temp_idwt_buffer;
+    dst->sb               = sb;
+    memset(dst->thread_ctx, 0, sizeof(dst->thread_ctx));
+
+    if (!dst->scratchbuf)
+        dst->scratchbuf       = av_mallocz(stride * 7 * MB_SIZE);
+    if (!dst->emu_edge_buffer)
+        dst->emu_edge_buffer  = av_malloc(stride * (2 * MB_SIZE + HTAPS_MAX - 1));
+    if (!dst->temp_idwt_buffer)
+        dst->temp_idwt_buffer = av_mallocz(avctx->width * sizeof(IDWTELEM));
+    if (!dst->scratchbuf || !dst->emu_edge_buffer || !dst->temp_idwt_buffer)
+        return AVERROR(ENOMEM);
+
+    ff_slice_buffer_destroy(&dst->sb);
+    return ff_slice_buffer_init(&dst->sb, src->sb.line_count, src->sb.data_count,
+                                src->sb.line_width, src->spatial_idwt_buffer);
+}
+
 static int decode_blocks(SnowContext *s){
     int x, y;
     int w= s->b_width;
@@ -391,6 +434,96 @@ static int decode_blocks(SnowContext *s){
     return 0;
 }
 
+/**
+ * Reconstruct one plane from its unpacked coefficients.
+ * @param arg array of the contexts to use for each plane
+ */
+static int decode_plane(AVCodecContext *avctx, void *arg, int plane_index, int thread)
+{
+    SnowContext *s = ((SnowContext **)arg)[plane_index];
+    Plane *p= &s->plane[plane_index];
+    int w= p->width;
+    int h= p->height;
+    int x, level, orientation;
+    int decode_state[MAX_DECOMPOSITIONS][4][1]; /* Stored state info for unpack_coeffs. 1 variable per instance. */
+    const int mb_h= s->b_height << s->block_max_depth;
+    const int block_size = MB_SIZE >> s->block_max_depth;
+    const int block_h    = plane_index ? block_size>>s->chroma_v_shift : block_size;
+    int mb_y;
+    DWTCompose cs[MAX_DECOMPOSITIONS];
+    int yd=0, yq=0;
+    int y;
+    int end_y;
+
+    ff_spatial_idwt_buffered_init(cs, &s->sb, w, h, 1, s->spatial_decomposition_type, s->spatial_decomposition_count);
+    for(mb_y=0; mb_y<=mb_h; mb_y++){
+
+        int slice_starty = block_h*mb_y;
+        int slice_h = block_h*(mb_y+1);
+
+        if (!(s->keyframe || s->avctx->debug&512)){
+            slice_starty = FFMAX(0, slice_starty - (block_h >> 1));
+            slice_h -= (block_h >> 1);
+        }
+
+        for(level=0; level<s->spatial_decomposition_count; level++){
+            for(orientation=level ? 1 : 0; orientation<4; orientation++){
+                SubBand *b= &p->band[level][orientation];
+                int start_y;
+                int end_y;
+                int our_mb_start = mb_y;
+                int our_mb_end = (mb_y + 1);
+                const int extra= 3;
+                start_y = (mb_y ? ((block_h * our_mb_start) >> (s->spatial_decomposition_count - level)) + s->spatial_decomposition_count - level + extra: 0);
+                end_y = (((block_h * our_mb_end) >> (s->spatial_decomposition_count - level)) + s->spatial_decomposition_count - level + extra);
+                if (!(s->keyframe || s->avctx->debug&512)){
+                    start_y = FFMAX(0, start_y - (block_h >> (1+s->spatial_decomposition_count - level)));
+                    end_y = FFMAX(0, end_y - (block_h >> (1+s->spatial_decomposition_count - level)));
+                }
+                start_y = FFMIN(b->height, start_y);
+                end_y = FFMIN(b->height, end_y);
+
+                if (start_y != end_y){
+                    if (orientation == 0){
+                        SubBand * correlate_band = &p->band[0][0];
+                        int correlate_end_y = FFMIN(b->height, end_y + 1);
+                        int correlate_start_y = FFMIN(b->height, (start_y ? start_y + 1 : 0));
+                        decode_subband_slice_buffered(s, correlate_band, &s->sb, correlate_start_y, correlate_end_y, decode_state[0][0]);
+                        correlate_slice_buffered(s, &s->sb, correlate_band, correlate_band->ibuf, correlate_band->stride, 1, 0, correlate_start_y, correlate_end_y);
+                        dequantize_slice_buffered(s, &s->sb, correlate_band, correlate_band->ibuf, correlate_band->stride, start_y, end_y);
+                    }
+                    else
+                        decode_subband_slice_buffered(s, b, &s->sb, start_y, end_y, decode_state[level][orientation]);
+                }
+            }
+        }
+
+        for(; yd<slice_h; yd+=4){
+            ff_spatial_idwt_buffered_slice(&s->dwt, cs, &s->sb, s->temp_idwt_buffer, w, h, 1, s->spatial_decomposition_type, s->spatial_decomposition_count, yd);
+        }
+
+        if(s->qlog == LOSSLESS_QLOG){
+            for(; yq<slice_h && yq<h; yq++){
+                IDWTELEM * line = slice_buffer_get_line(&s->sb, yq);
+                for(x=0; x<w; x++){
+                    line[x] <<= FRAC_BITS;
+                }
+            }
+        }
+
+        predict_slice_buffered(s, &s->sb, s->spatial_idwt_buffer, plane_index, 1, mb_y);
+
+        y = FFMIN(p->height, slice_starty);
+        end_y = FFMIN(p->height, slice_h);
+        while(y < end_y)
+            ff_slice_buffer_release(&s->sb, y++);
+    }
+
+    ff_slice_buffer_flush(&s->sb);
+
+    return 0;
+}
+
 static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
                         AVPacket *avpkt)
 {
@@ -400,6 +533,7 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
     RangeCoder * const c= &s->c;
     int bytes_read;
     AVFrame *picture = data;
+    SnowContext *ctx[3];
     int level, orientation, plane_index;
     int res;
 
@@ -444,7 +578,6 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
         int w= p->width;
         int h= p->height;
         int x, y;
-        int decode_state[MAX_DECOMPOSITIONS][4][1]; /* Stored state info for unpack_coeffs. 1 variable per instance. */
 
         if(s->avctx->debug&2048){
             memset(s->spatial_dwt_buffer, 0, sizeof(DWTELEM)*w*h);
@@ -458,92 +591,28 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
             }
         }
 
-        {
         for(level=0; level<s->spatial_decomposition_count; level++){
             for(orientation=level ? 1 : 0; orientation<4; orientation++){
                 SubBand *b= &p->band[level][orientation];
                 unpack_coeffs(s, b, b->parent, orientation);
             }
         }
-        }
-
-        {
-        const int mb_h= s->b_height << s->block_max_depth;
-        const int block_size = MB_SIZE >> s->block_max_depth;
-        const int block_h    = plane_index ? block_size>>s->chroma_v_shift : block_size;
-        int mb_y;
-        DWTCompose cs[MAX_DECOMPOSITIONS];
-        int yd=0, yq=0;
-        int y;
-        int end_y;
-
-        ff_spatial_idwt_buffered_init(cs, &s->sb, w, h, 1, s->spatial_decomposition_type, s->spatial_decomposition_count);
-        for(mb_y=0; mb_y<=mb_h; mb_y++){
-
-            int slice_starty = block_h*mb_y;
-            int slice_h = block_h*(mb_y+1);
-
-            if (!(s->keyframe || s->avctx->debug&512)){
-                slice_starty = FFMAX(0, slice_starty - (block_h >> 1));
-                slice_h -= (block_h >> 1);
-            }
-
-            for(level=0; level<s->spatial_decomposition_count; level++){
-                for(orientation=level ? 1 : 0; orientation<4; orientation++){
-                    SubBand *b= &p->band[level][orientation];
-                    int start_y;
-                    int end_y;
-                    int our_mb_start = mb_y;
-                    int our_mb_end = (mb_y + 1);
-                    const int extra= 3;
-                    start_y = (mb_y ? ((block_h * our_mb_start) >> (s->spatial_decomposition_count - level)) + s->spatial_decomposition_count - level + extra: 0);
-                    end_y = (((block_h * our_mb_end) >> (s->spatial_decomposition_count - level)) + s->spatial_decomposition_count - level + extra);
-                    if (!(s->keyframe || s->avctx->debug&512)){
-                        start_y = FFMAX(0, start_y - (block_h >> (1+s->spatial_decomposition_count - level)));
-                        end_y = FFMAX(0, end_y - (block_h >> (1+s->spatial_decomposition_count - level)));
-                    }
-                    start_y = FFMIN(b->height, start_y);
-                    end_y = FFMIN(b->height, end_y);
-
-                    if (start_y != end_y){
-                        if (orientation == 0){
-                            SubBand * correlate_band = &p->band[0][0];
-                            int correlate_end_y = FFMIN(b->height, end_y + 1);
-                            int correlate_start_y = FFMIN(b->height, (start_y ? start_y + 1 : 0));
-                            decode_subband_slice_buffered(s, correlate_band, &s->sb, correlate_start_y, correlate_end_y, decode_state[0][0]);
-                            correlate_slice_buffered(s, &s->sb, correlate_band, correlate_band->ibuf, correlate_band->stride, 1, 0, correlate_start_y, correlate_end_y);
-                            dequantize_slice_buffered(s, &s->sb, correlate_band, correlate_band->ibuf, correlate_band->stride, start_y, end_y);
-                        }
-                        else
-                            decode_subband_slice_buffered(s, b, &s->sb, start_y, end_y, decode_state[level][orientation]);
-                    }
-                }
-            }
-
-            for(; yd<slice_h; yd+=4){
-                ff_spatial_idwt_buffered_slice(&s->dwt, cs, &s->sb, s->temp_idwt_buffer, w, h, 1, s->spatial_decomposition_type, s->spatial_decomposition_count, yd);
-            }
-
-            if(s->qlog == LOSSLESS_QLOG){
-                for(; yq<slice_h && yq<h; yq++){
-                    IDWTELEM * line = slice_buffer_get_line(&s->sb, yq);
-                    for(x=0; x<w; x++){
-                        line[x] <<= FRAC_BITS;
-                    }
-                }
-            }
-
-            predict_slice_buffered(s, &s->sb, s->spatial_idwt_buffer, plane_index, 1, mb_y);
-
-            y = FFMIN(p->height, slice_starty);
-            end_y = FFMIN(p->height, slice_h);
-            while(y < end_y)
-                ff_slice_buffer_release(&s->sb, y++);
-        }
+    }
 
-        ff_slice_buffer_flush(&s->sb);
+    /* The coefficients of all planes are unpacked, the planes can now be
+     * reconstructed independently, each with its own slice buffer and
+     * scratch buffers. */
+    ctx[0] = ctx[1] = ctx[2] = s;
+    if(s->thread_ctx[1] && !(s->avctx->debug&2048)){
+        for(plane_index=1; plane_index<3; plane_index++){
+            ctx[plane_index] = s->thread_ctx[plane_index];
+            if ((res = update_thread_context(ctx[plane_index], s)) < 0)
+                return res;
         }
-
+        avctx->execute2(avctx, decode_plane, ctx, NULL, 3);
+    }else{
+        for(plane_index=0; plane_index<3; plane_index++)
+            decode_plane(avctx, ctx, plane_index, 0);
     }
 
     emms_c();
@@ -566,6 +635,18 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
 static av_cold int decode_end(AVCodecContext *avctx)
 {
     SnowContext *s = avctx->priv_data;
+    int i;
+
+    for (i = 1; i < 3; i++) {
+        SnowContext *t = s->thread_ctx[i];
+        if (!t)
+            continue;
+        ff_slice_buffer_destroy(&t->sb);
+        av_freep(&t->scratchbuf);
+        av_freep(&t->emu_edge_buffer);
+        av_freep(&t->temp_idwt_buffer);
+        av_freep(&s->thread_ctx[i]);
+    }
 
     ff_slice_buffer_destroy(&s->sb);
 
@@ -582,6 +663,6 @@ AVCodec ff_snow_decoder = {
     .init           = decode_init,
     .close          = decode_end,
     .decode         = decode_frame,
-    .capabilities   = CODEC_CAP_DR1 /*| CODEC_CAP_DRAW_HORIZ_BAND*/,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_SLICE_THREADS /*| CODEC_CAP_DRAW_HORIZ_BAND*/,
     .long_name      = NULL_IF_CONFIG_SMALL("Snow"),
 };
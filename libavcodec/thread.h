@@ -87,6 +87,39 @@ void ff_thread_report_progress(AVFrame *f, int progress, int field);
  */
 void ff_thread_await_progress(AVFrame *f, int progress, int field);
 
+/**
+ * Allocate progress entries for the jobs of one slice threading execute()
+ * call and reset them all to 0.
+ * Only valid while slice threading is active with more than one thread.
+ *
+ * @param avctx The context.
+ * @param count Number of entries needed.
+ * @return 0 on success, a negative AVERROR code on failure.
+ */
+int ff_alloc_entries(AVCodecContext *avctx, int count);
+
+/**
+ * Set a progress entry of a slice threading execute() call and wake up
+ * the jobs waiting for it in ff_thread_await_progress2().
+ * Later calls with lower values have no effect.
+ *
+ * @param avctx The context.
+ * @param entry Index of the entry, smaller than the count passed to ff_alloc_entries().
+ * @param n New progress value.
+ */
+void ff_thread_report_progress2(AVCodecContext *avctx, int entry, int n);
+
+/**
+ * Wait until another job of the same slice threading execute() call has
+ * reported a progress of at least n for the given entry.
+ *
+ * @param avctx The context.
+ * @param entry Index of the entry, smaller than the count passed to ff_alloc_entries().
+ * @param n Progress value to wait for.
+ * @return the current progress value of the entry, at least n.
+ */
+int ff_thread_await_progress2(AVCodecContext *avctx, int entry, int n);
+
 /**
  * Wrapper around get_buffer() for frame-multithreaded codecs.
  * Call this function instead of ff_get_buffer(f).
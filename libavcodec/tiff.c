@@ -36,11 +36,26 @@
 #include "faxcompr.h"
 #include "internal.h"
 #include "mathops.h"
+#include "thread.h"
 #include "libavutil/attributes.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/avstring.h"
 
+/**
+ * Per-thread strip decoding state
+ */
+typedef struct TiffThreadContext {
+    LZWState *lzw;
+    uint8_t *deinvert_buf;
+    int deinvert_buf_size;
+} TiffThreadContext;
+
+typedef struct TiffStrip {
+    const uint8_t *src;
+    int size;
+} TiffStrip;
+
 typedef struct TiffContext {
     AVCodecContext *avctx;
     AVFrame picture;
@@ -60,10 +75,11 @@ typedef struct TiffContext {
     int strips, rps, sstype;
     int sot;
     int stripsizesoff, stripsize, stripoff, strippos;
-    LZWState *lzw;
 
-    uint8_t *deinvert_buf;
-    int deinvert_buf_size;
+    TiffThreadContext *thread;  ///< one per slice thread
+    int nb_threads;
+    TiffStrip *strip;           ///< strips of the current frame
+    unsigned strip_size;
 
     int geotag_count;
     TiffGeoTag *geotags;
@@ -396,7 +412,8 @@ static void av_always_inline horizontal_fill(unsigned int bpp, uint8_t* dst,
     }
 }
 
-static int tiff_unpack_strip(TiffContext *s, uint8_t *dst, int stride,
+static int tiff_unpack_strip(TiffContext *s, TiffThreadContext *t,
+                             uint8_t *dst, int stride,
                              const uint8_t *src, int size, int lines)
 {
     int c, line, pixels, code;
@@ -454,15 +471,15 @@ static int tiff_unpack_strip(TiffContext *s, uint8_t *dst, int stride,
     if (s->compr == TIFF_LZW) {
         if (s->fill_order) {
             int i;
-            av_fast_padded_malloc(&s->deinvert_buf, &s->deinvert_buf_size, size);
-            if (!s->deinvert_buf)
+            av_fast_padded_malloc(&t->deinvert_buf, &t->deinvert_buf_size, size);
+            if (!t->deinvert_buf)
                 return AVERROR(ENOMEM);
             for (i = 0; i < size; i++)
-                s->deinvert_buf[i] = ff_reverse[src[i]];
-            src = s->deinvert_buf;
+                t->deinvert_buf[i] = ff_reverse[src[i]];
+            src = t->deinvert_buf;
             ssrc = src;
         }
-        if (ff_lzw_decode_init(s->lzw, 8, src, size, FF_LZW_TIFF) < 0) {
+        if (ff_lzw_decode_init(t->lzw, 8, src, size, FF_LZW_TIFF) < 0) {
             av_log(s->avctx, AV_LOG_ERROR, "Error initializing LZW decoder\n");
             return -1;
         }
@@ -563,7 +580,7 @@ static int tiff_unpack_strip(TiffContext *s, uint8_t *dst, int stride,
             }
             break;
         case TIFF_LZW:
-            pixels = ff_lzw_decode(s->lzw, dst, width);
+            pixels = ff_lzw_decode(t->lzw, dst, width);
             if (pixels < width) {
                 av_log(s->avctx, AV_LOG_ERROR, "Decoded only %i bytes of %i\n",
                        pixels, width);
@@ -578,6 +595,19 @@ static int tiff_unpack_strip(TiffContext *s, uint8_t *dst, int stride,
     return 0;
 }
 
+static int tiff_unpack_strip_job(AVCodecContext *avctx, void *arg,
+                                 int jobnr, int threadnr)
+{
+    TiffContext *s = avctx->priv_data;
+    int stride = s->picture.linesize[0];
+    int y      = jobnr * s->rps;
+
+    return tiff_unpack_strip(s, &s->thread[threadnr],
+                             s->picture.data[0] + y * stride, stride,
+                             s->strip[jobnr].src, s->strip[jobnr].size,
+                             FFMIN(s->rps, s->height - y));
+}
+
 static int init_image(TiffContext *s)
 {
     int i, ret;
@@ -624,8 +654,8 @@ static int init_image(TiffContext *s)
         avcodec_set_dimensions(s->avctx, s->width, s->height);
     }
     if (s->picture.data[0])
-        s->avctx->release_buffer(s->avctx, &s->picture);
-    if ((ret = ff_get_buffer(s->avctx, &s->picture)) < 0) {
+        ff_thread_release_buffer(s->avctx, &s->picture);
+    if ((ret = ff_thread_get_buffer(s->avctx, &s->picture)) < 0) {
         av_log(s->avctx, AV_LOG_ERROR, "get_buffer() failed\n");
         return ret;
     }
@@ -1104,7 +1134,6 @@ static int decode_frame(AVCodecContext *avctx,
         s->stripsize = avpkt->size - s->stripoff;
     }
     stride = p->linesize[0];
-    dst = p->data[0];
 
     if (s->stripsizesoff) {
         if (s->stripsizesoff >= (unsigned)avpkt->size)
@@ -1122,7 +1151,11 @@ static int decode_frame(AVCodecContext *avctx,
         return AVERROR_INVALIDDATA;
     }
 
-    for (i = 0; i < s->height; i += s->rps) {
+    av_fast_malloc(&s->strip, &s->strip_size,
+                   ((s->height - 1) / s->rps + 1) * sizeof(*s->strip));
+    if (!s->strip)
+        return AVERROR(ENOMEM);
+    for (i = 0, j = 0; i < s->height; i += s->rps, j++) {
         if (s->stripsizesoff)
             ssize = tget(&stripsizes, s->sstype, s->le);
         else
@@ -1137,11 +1170,13 @@ static int decode_frame(AVCodecContext *avctx,
             av_log(avctx, AV_LOG_ERROR, "Invalid strip size/offset\n");
             return -1;
         }
-        if (tiff_unpack_strip(s, dst, stride, avpkt->data + soff, ssize,
-                              FFMIN(s->rps, s->height - i)) < 0)
-            break;
-        dst += s->rps * stride;
+        s->strip[j].src  = avpkt->data + soff;
+        s->strip[j].size = ssize;
     }
+    /* strips are independent, a broken one only leaves its own lines
+     * undecoded */
+    avctx->execute2(avctx, tiff_unpack_strip_job, NULL, NULL, j);
+
     if (s->predictor == 2) {
         dst = p->data[0];
         soff = s->bpp >> 3;
@@ -1183,6 +1218,39 @@ static int decode_frame(AVCodecContext *avctx,
     return avpkt->size;
 }
 
+static av_cold void free_thread_contexts(TiffContext *s)
+{
+    int i;
+
+    for (i = 0; i < s->nb_threads; i++) {
+        ff_lzw_decode_close(&s->thread[i].lzw);
+        av_freep(&s->thread[i].deinvert_buf);
+    }
+    av_freep(&s->thread);
+    s->nb_threads = 0;
+}
+
+static av_cold int init_thread_contexts(TiffContext *s)
+{
+    int i, nb_threads = 1;
+
+    if (s->avctx->active_thread_type & FF_THREAD_SLICE)
+        nb_threads = FFMAX(s->avctx->thread_count, 1);
+
+    s->thread = av_mallocz(nb_threads * sizeof(*s->thread));
+    if (!s->thread)
+        return AVERROR(ENOMEM);
+    s->nb_threads = nb_threads;
+    for (i = 0; i < nb_threads; i++) {
+        ff_lzw_decode_open(&s->thread[i].lzw);
+        if (!s->thread[i].lzw) {
+            free_thread_contexts(s);
+            return AVERROR(ENOMEM);
+        }
+    }
+    return 0;
+}
+
 static av_cold int tiff_init(AVCodecContext *avctx)
 {
     TiffContext *s = avctx->priv_data;
@@ -1192,10 +1260,25 @@ static av_cold int tiff_init(AVCodecContext *avctx)
     s->avctx = avctx;
     avcodec_get_frame_defaults(&s->picture);
     avctx->coded_frame = &s->picture;
-    ff_lzw_decode_open(&s->lzw);
     ff_ccitt_unpack_init();
 
-    return 0;
+    return init_thread_contexts(s);
+}
+
+static av_cold int tiff_init_thread_copy(AVCodecContext *avctx)
+{
+    TiffContext *s = avctx->priv_data;
+
+    s->avctx = avctx;
+    avctx->coded_frame = &s->picture;
+    s->thread            = NULL;
+    s->nb_threads        = 0;
+    s->strip             = NULL;
+    s->strip_size        = 0;
+    s->geotags           = NULL;
+    s->geotag_count      = 0;
+
+    return init_thread_contexts(s);
 }
 
 static av_cold int tiff_end(AVCodecContext *avctx)
@@ -1204,8 +1287,8 @@ static av_cold int tiff_end(AVCodecContext *avctx)
 
     free_geotags(s);
 
-    ff_lzw_decode_close(&s->lzw);
-    av_freep(&s->deinvert_buf);
+    free_thread_contexts(s);
+    av_freep(&s->strip);
     if (s->picture.data[0])
         avctx->release_buffer(avctx, &s->picture);
     return 0;
@@ -1219,6 +1302,8 @@ AVCodec ff_tiff_decoder = {
     .init           = tiff_init,
     .close          = tiff_end,
     .decode         = decode_frame,
-    .capabilities   = CODEC_CAP_DR1,
+    .init_thread_copy = ONLY_IF_THREADS_ENABLED(tiff_init_thread_copy),
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_FRAME_THREADS |
+                      CODEC_CAP_SLICE_THREADS,
     .long_name      = NULL_IF_CONFIG_SMALL("TIFF image"),
 };
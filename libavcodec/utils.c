@@ -117,6 +117,26 @@ void av_fast_padded_mallocz(void *ptr, unsigned int *size, size_t min_size)
 
 /* encoder management */
 static AVCodec *first_avcodec = NULL;
+static AVCodec **last_avcodec = &first_avcodec;
+
+/* registered codecs are also chained into small hash tables so that the
+ * avcodec_find_*() functions do not have to walk the whole list */
+#define CODEC_HASH_SIZE 256
+static AVCodec *codec_id_hash[CODEC_HASH_SIZE];
+static AVCodec *codec_name_hash[CODEC_HASH_SIZE];
+
+static unsigned codec_id_key(enum AVCodecID id)
+{
+    return (unsigned)id % CODEC_HASH_SIZE;
+}
+
+static unsigned codec_name_key(const char *name)
+{
+    unsigned h = 0;
+    while (*name)
+        h = h * 31 + (uint8_t)*name++;
+    return h % CODEC_HASH_SIZE;
+}
 
 AVCodec *av_codec_next(const AVCodec *c)
 {
@@ -151,11 +171,21 @@ void avcodec_register(AVCodec *codec)
 {
     AVCodec **p;
     avcodec_init();
-    p = &first_avcodec;
-    while (*p != NULL)
-        p = &(*p)->next;
-    *p          = codec;
-    codec->next = NULL;
+    *last_avcodec = codec;
+    last_avcodec  = &codec->next;
+    codec->next   = NULL;
+
+    p = &codec_id_hash[codec_id_key(codec->id)];
+    while (*p)
+        p = &(*p)->next_by_id;
+    *p = codec;
+    codec->next_by_id = NULL;
+
+    p = &codec_name_hash[codec_name_key(codec->name)];
+    while (*p)
+        p = &(*p)->next_by_name;
+    *p = codec;
+    codec->next_by_name = NULL;
 
     if (codec->init_static_data)
         codec->init_static_data(codec);
@@ -345,25 +375,24 @@ static int audio_get_buffer(AVCodecContext *avctx, AVFrame *frame)
     AVCodecInternal *avci = avctx->internal;
     int buf_size, ret;
 
-    av_freep(&avci->audio_data);
     buf_size = av_samples_get_buffer_size(NULL, avctx->channels,
                                           frame->nb_samples, avctx->sample_fmt,
                                           0);
     if (buf_size < 0)
         return AVERROR(EINVAL);
 
-    frame->data[0] = av_mallocz(buf_size);
-    if (!frame->data[0])
+    /* The previous frame is invalidated by this call anyway, so its buffer
+     * is reused instead of being freed and allocated again for every
+     * packet. */
+    av_fast_malloc(&avci->audio_data, &avci->audio_data_size, buf_size);
+    if (!avci->audio_data)
         return AVERROR(ENOMEM);
+    memset(avci->audio_data, 0, buf_size);
 
     ret = avcodec_fill_audio_frame(frame, avctx->channels, avctx->sample_fmt,
-                                   frame->data[0], buf_size, 0);
-    if (ret < 0) {
-        av_freep(&frame->data[0]);
+                                   avci->audio_data, buf_size, 0);
+    if (ret < 0)
         return ret;
-    }
-
-    avci->audio_data = frame->data[0];
     if (avctx->debug & FF_DEBUG_BUFFERS)
         av_log(avctx, AV_LOG_DEBUG, "default_get_buffer called on frame %p, "
                                     "internal audio buffer used\n", frame);
@@ -371,6 +400,24 @@ static int audio_get_buffer(AVCodecContext *avctx, AVFrame *frame)
     return 0;
 }
 
+static int internal_buffer_is_writable(const InternalBuffer *buf)
+{
+    int i;
+
+    for (i = 0; i < AV_NUM_DATA_POINTERS && buf->buf[i]; i++)
+        if (!av_buffer_is_writable(buf->buf[i]))
+            return 0;
+    return 1;
+}
+
+static AVBufferRef *alloc_plane(int size)
+{
+    AVBufferRef *ref = av_buffer_alloc(size);
+    if (ref)
+        memset(ref->data, 128, size);
+    return ref;
+}
+
 static int video_get_buffer(AVCodecContext *s, AVFrame *pic)
 {
     int i;
@@ -400,10 +447,13 @@ static int video_get_buffer(AVCodecContext *s, AVFrame *pic)
 
     buf = &avci->buffer[avci->buffer_count];
 
-    if (buf->base[0] && (buf->width != w || buf->height != h || buf->pix_fmt != s->pix_fmt)) {
+    /* Reallocate if the buffer does not fit or if references to the planes
+     * of a previous frame are still held, e.g. by libavfilter. */
+    if (buf->base[0] && (buf->width != w || buf->height != h || buf->pix_fmt != s->pix_fmt ||
+                         !internal_buffer_is_writable(buf))) {
         for (i = 0; i < AV_NUM_DATA_POINTERS; i++) {
-            av_freep(&buf->base[i]);
-            buf->data[i] = NULL;
+            av_buffer_unref(&buf->buf[i]);
+            buf->base[i] = buf->data[i] = NULL;
         }
     }
 
@@ -456,10 +506,17 @@ static int video_get_buffer(AVCodecContext *s, AVFrame *pic)
 
             buf->linesize[i] = picture.linesize[i];
 
-            buf->base[i] = av_malloc(size[i] + 16); //FIXME 16
-            if (buf->base[i] == NULL)
+            if (avci->pool_size[i] != size[i] + 16) { //FIXME 16
+                av_buffer_pool_uninit(&avci->pool[i]);
+                avci->pool[i] = av_buffer_pool_init(size[i] + 16, alloc_plane);
+                if (!avci->pool[i])
+                    return AVERROR(ENOMEM);
+                avci->pool_size[i] = size[i] + 16;
+            }
+            buf->buf[i] = av_buffer_pool_get(avci->pool[i]);
+            if (!buf->buf[i])
                 return AVERROR(ENOMEM);
-            memset(buf->base[i], 128, size[i]);
+            buf->base[i] = buf->buf[i]->data;
 
             // no edge if EDGE EMU or not planar YUV
             if ((s->flags & CODEC_FLAG_EMU_EDGE) || !size[2])
@@ -482,6 +539,9 @@ static int video_get_buffer(AVCodecContext *s, AVFrame *pic)
         pic->base[i]     = buf->base[i];
         pic->data[i]     = buf->data[i];
         pic->linesize[i] = buf->linesize[i];
+        /* only decoders following the get_buffer() rules may have their
+         * frames referenced beyond release_buffer() */
+        pic->buf[i]      = s->codec->capabilities & CODEC_CAP_DR1 ? buf->buf[i] : NULL;
     }
     pic->extended_data = pic->data;
     avci->buffer_count++;
@@ -570,9 +630,11 @@ void avcodec_default_release_buffer(AVCodecContext *s, AVFrame *pic)
             FFSWAP(InternalBuffer, *buf, *last);
     }
 
-    for (i = 0; i < AV_NUM_DATA_POINTERS; i++)
+    for (i = 0; i < AV_NUM_DATA_POINTERS; i++) {
         pic->data[i] = NULL;
 //        pic->base[i]=NULL;
+        pic->buf[i]  = NULL;
+    }
 
     if (s->debug & FF_DEBUG_BUFFERS)
         av_log(s, AV_LOG_DEBUG, "default_release_buffer called on pic %p, %d "
@@ -603,17 +665,25 @@ int avcodec_default_reget_buffer(AVCodecContext *s, AVFrame *pic)
 
     assert(s->pix_fmt == pic->format);
 
-    /* If internal buffer type return the same buffer */
+    /* If internal buffer type return the same buffer, unless it is still
+     * referenced elsewhere */
     if (pic->type == FF_BUFFER_TYPE_INTERNAL) {
-        return 0;
+        for (i = 0; i < AV_NUM_DATA_POINTERS && pic->buf[i]; i++)
+            if (!av_buffer_is_writable(pic->buf[i]))
+                break;
+        if (i == AV_NUM_DATA_POINTERS || !pic->buf[i])
+            return 0;
     }
 
     /*
-     * Not internal type and reget_buffer not overridden, emulate cr buffer
+     * Not internal type or still referenced and reget_buffer not overridden,
+     * emulate cr buffer
      */
     temp_pic = *pic;
-    for (i = 0; i < AV_NUM_DATA_POINTERS; i++)
+    for (i = 0; i < AV_NUM_DATA_POINTERS; i++) {
         pic->data[i] = pic->base[i] = NULL;
+        pic->buf[i]  = NULL;
+    }
     pic->opaque = NULL;
     /* Allocate new frame */
     if ((ret = ff_get_buffer(s, pic)))
@@ -728,6 +798,13 @@ MAKE_ACCESSORS(AVFrame, frame, AVDictionary *, metadata)
 MAKE_ACCESSORS(AVFrame, frame, int,     decode_error_flags)
 MAKE_ACCESSORS(AVFrame, frame, int,     pkt_size)
 
+AVBufferRef *av_frame_get_plane_buffer(const AVFrame *frame, int plane)
+{
+    if (plane < 0 || plane >= AV_NUM_DATA_POINTERS)
+        return NULL;
+    return frame->buf[plane];
+}
+
 MAKE_ACCESSORS(AVCodecContext, codec, AVRational, pkt_timebase)
 MAKE_ACCESSORS(AVCodecContext, codec, const AVCodecDescriptor *, codec_descriptor)
 
@@ -779,9 +856,15 @@ int attribute_align_arg ff_codec_open2_recursive(AVCodecContext *avctx, const AV
     return ret;
 }
 
+static int codec_needs_lock(const AVCodec *codec)
+{
+    return !codec || !(codec->caps_internal & FF_CODEC_CAP_INIT_THREADSAFE);
+}
+
 int attribute_align_arg avcodec_open2(AVCodecContext *avctx, const AVCodec *codec, AVDictionary **options)
 {
     int ret = 0;
+    int lock;
     AVDictionary *tmp = NULL;
 
     if (avcodec_is_open(avctx))
@@ -805,9 +888,11 @@ int attribute_align_arg avcodec_open2(AVCodecContext *avctx, const AVCodec *code
     if (options)
         av_dict_copy(&tmp, *options, 0);
 
-    ret = ff_lock_avcodec(avctx);
-    if (ret < 0)
+    lock = codec_needs_lock(codec);
+    if (lock && (ret = ff_lock_avcodec(avctx)) < 0) {
+        av_dict_free(&tmp);
         return ret;
+    }
 
     avctx->internal = av_mallocz(sizeof(AVCodecInternal));
     if (!avctx->internal) {
@@ -902,9 +987,11 @@ int attribute_align_arg avcodec_open2(AVCodecContext *avctx, const AVCodec *code
         av_log(avctx, AV_LOG_WARNING, "Warning: not compiled with thread support, using thread emulation\n");
 
     if (HAVE_THREADS) {
-        ff_unlock_avcodec(); //we will instanciate a few encoders thus kick the counter to prevent false detection of a problem
+        if (lock)
+            ff_unlock_avcodec(); //we will instanciate a few encoders thus kick the counter to prevent false detection of a problem
         ret = ff_frame_thread_encoder_init(avctx, options ? *options : NULL);
-        ff_lock_avcodec(avctx);
+        if (lock)
+            ff_lock_avcodec(avctx);
         if (ret < 0)
             goto free_and_end;
     }
@@ -1059,7 +1146,8 @@ int attribute_align_arg avcodec_open2(AVCodecContext *avctx, const AVCodec *code
         }
     }
 end:
-    ff_unlock_avcodec();
+    if (lock)
+        ff_unlock_avcodec();
     if (options) {
         av_dict_free(options);
         *options = tmp;
@@ -1888,15 +1976,18 @@ av_cold int ff_codec_close_recursive(AVCodecContext *avctx)
 
 av_cold int avcodec_close(AVCodecContext *avctx)
 {
-    int ret = ff_lock_avcodec(avctx);
-    if (ret < 0)
+    int ret, lock = codec_needs_lock(avctx->codec);
+
+    if (lock && (ret = ff_lock_avcodec(avctx)) < 0)
         return ret;
 
     if (avcodec_is_open(avctx)) {
         if (HAVE_THREADS && avctx->internal->frame_thread_encoder && avctx->thread_count > 1) {
-            ff_unlock_avcodec();
+            if (lock)
+                ff_unlock_avcodec();
             ff_frame_thread_encoder_free(avctx);
-            ff_lock_avcodec(avctx);
+            if (lock)
+                ff_lock_avcodec(avctx);
         }
         if (HAVE_THREADS && avctx->thread_opaque)
             ff_thread_free(avctx);
@@ -1919,7 +2010,8 @@ av_cold int avcodec_close(AVCodecContext *avctx)
     avctx->codec = NULL;
     avctx->active_thread_type = 0;
 
-    ff_unlock_avcodec();
+    if (lock)
+        ff_unlock_avcodec();
     return 0;
 }
 
@@ -1938,8 +2030,8 @@ static enum AVCodecID remap_deprecated_codec_id(enum AVCodecID id)
 static AVCodec *find_encdec(enum AVCodecID id, int encoder)
 {
     AVCodec *p, *experimental = NULL;
-    p = first_avcodec;
     id= remap_deprecated_codec_id(id);
+    p = codec_id_hash[codec_id_key(id)];
     while (p) {
         if ((encoder ? av_codec_is_encoder(p) : av_codec_is_decoder(p)) &&
             p->id == id) {
@@ -1948,7 +2040,7 @@ static AVCodec *find_encdec(enum AVCodecID id, int encoder)
             } else
                 return p;
         }
-        p = p->next;
+        p = p->next_by_id;
     }
     return experimental;
 }
@@ -1963,11 +2055,11 @@ AVCodec *avcodec_find_encoder_by_name(const char *name)
     AVCodec *p;
     if (!name)
         return NULL;
-    p = first_avcodec;
+    p = codec_name_hash[codec_name_key(name)];
     while (p) {
         if (av_codec_is_encoder(p) && strcmp(name, p->name) == 0)
             return p;
-        p = p->next;
+        p = p->next_by_name;
     }
     return NULL;
 }
@@ -1982,11 +2074,11 @@ AVCodec *avcodec_find_decoder_by_name(const char *name)
     AVCodec *p;
     if (!name)
         return NULL;
-    p = first_avcodec;
+    p = codec_name_hash[codec_name_key(name)];
     while (p) {
         if (av_codec_is_decoder(p) && strcmp(name, p->name) == 0)
             return p;
-        p = p->next;
+        p = p->next_by_name;
     }
     return NULL;
 }
@@ -2194,11 +2286,15 @@ static void video_free_buffers(AVCodecContext *s)
     for (i = 0; i < INTERNAL_BUFFER_SIZE; i++) {
         InternalBuffer *buf = &avci->buffer[i];
         for (j = 0; j < 4; j++) {
-            av_freep(&buf->base[j]);
-            buf->data[j] = NULL;
+            av_buffer_unref(&buf->buf[j]);
+            buf->base[j] = buf->data[j] = NULL;
         }
     }
     av_freep(&avci->buffer);
+    for (i = 0; i < FF_ARRAY_ELEMS(avci->pool); i++) {
+        av_buffer_pool_uninit(&avci->pool[i]);
+        avci->pool_size[i] = 0;
+    }
 
     avci->buffer_count = 0;
 }
@@ -2207,6 +2303,7 @@ static void audio_free_buffers(AVCodecContext *avctx)
 {
     AVCodecInternal *avci = avctx->internal;
     av_freep(&avci->audio_data);
+    avci->audio_data_size = 0;
 }
 
 void avcodec_default_free_buffers(AVCodecContext *avctx)
@@ -2658,6 +2755,20 @@ int ff_thread_can_start_frame(AVCodecContext *avctx)
     return 1;
 }
 
+int ff_alloc_entries(AVCodecContext *avctx, int count)
+{
+    return AVERROR(ENOSYS);
+}
+
+void ff_thread_report_progress2(AVCodecContext *avctx, int entry, int n)
+{
+}
+
+int ff_thread_await_progress2(AVCodecContext *avctx, int entry, int n)
+{
+    return n;
+}
+
 #endif
 
 enum AVMediaType avcodec_get_type(enum AVCodecID codec_id)
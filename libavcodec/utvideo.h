@@ -63,6 +63,12 @@ extern const int ff_ut_pred_order[5];
 /* Order of RGB(A) planes in Ut Video */
 extern const int ff_ut_rgb_order[4];
 
+typedef struct HuffEntry {
+    uint8_t  sym;
+    uint8_t  len;
+    uint32_t code;
+} HuffEntry;
+
 typedef struct UtvideoContext {
     AVCodecContext *avctx;
     AVFrame        pic;
@@ -78,13 +84,16 @@ typedef struct UtvideoContext {
     int      slice_stride;
     uint8_t *slice_bits, *slice_buffer[4];
     int      slice_bits_size;
-} UtvideoContext;
 
-typedef struct HuffEntry {
-    uint8_t  sym;
-    uint8_t  len;
-    uint32_t code;
-} HuffEntry;
+    /* encoder: the plane being coded, shared by the slice jobs */
+    uint8_t   *pred_buffer;
+    uint8_t   *plane_src, *plane_dst;
+    int        plane_stride, plane_width, plane_height;
+    int        plane_cmask;
+    HuffEntry *plane_he;
+    uint32_t (*slice_counts)[256];
+    int       *slice_sizes;
+} UtvideoContext;
 
 /* Compare huffman tree nodes */
 int ff_ut_huff_cmp_len(const void *a, const void *b);
@@ -24,6 +24,8 @@
  * Ut Video decoder
  */
 
+#define CACHED_BITSTREAM_READER HAVE_FAST_64BIT
+
 #include <stdlib.h>
 
 #include "libavutil/intreadwrite.h"
@@ -28,7 +28,6 @@
 #include "avcodec.h"
 #include "internal.h"
 #include "bytestream.h"
-#include "put_bits.h"
 #include "dsputil.h"
 #include "mathops.h"
 #include "utvideo.h"
@@ -48,6 +47,9 @@ static av_cold int utvideo_encode_close(AVCodecContext *avctx)
 
     av_freep(&avctx->coded_frame);
     av_freep(&c->slice_bits);
+    av_freep(&c->pred_buffer);
+    av_freep(&c->slice_counts);
+    av_freep(&c->slice_sizes);
     for (i = 0; i < 4; i++)
         av_freep(&c->slice_buffer[i]);
 
@@ -174,9 +176,32 @@ static av_cold int utvideo_encode_init(AVCodecContext *avctx)
 
     /*
      * Set how many slices are going to be used.
-     * Set one slice for now.
+     * Every slice of every plane must hold at least one line,
+     * and 4:2:0 luma slices an even number of lines.
      */
-    c->slices = 1;
+    c->slices = avctx->slices ? avctx->slices : 1;
+    if (c->slices > 256 ||
+        c->slices > avctx->height >> (avctx->pix_fmt == AV_PIX_FMT_YUV420P)) {
+        av_log(avctx, AV_LOG_ERROR,
+               "%d slices are not supported for a frame height of %d.\n",
+               c->slices, avctx->height);
+        utvideo_encode_close(avctx);
+        return AVERROR(EINVAL);
+    }
+
+    /*
+     * RGB planes are predicted out of place, since the slice jobs
+     * would otherwise overwrite the lines their neighbours still read.
+     */
+    c->pred_buffer  = av_malloc(avctx->width * avctx->height +
+                                FF_INPUT_BUFFER_PADDING_SIZE);
+    c->slice_counts = av_malloc(c->slices * sizeof(*c->slice_counts));
+    c->slice_sizes  = av_malloc(c->slices * sizeof(*c->slice_sizes));
+    if (!c->pred_buffer || !c->slice_counts || !c->slice_sizes) {
+        av_log(avctx, AV_LOG_ERROR, "Cannot allocate slice tables.\n");
+        utvideo_encode_close(avctx);
+        return AVERROR(ENOMEM);
+    }
 
     /* Set compression mode */
     c->compression = COMP_HUFF;
@@ -245,19 +270,19 @@ static void write_plane(uint8_t *src, uint8_t *dst, int stride,
 }
 
 /* Write data to a plane with left prediction */
-static void left_predict(uint8_t *src, uint8_t *dst, int stride,
-                         int width, int height)
+static void left_predict(UtvideoContext *c, uint8_t *src, uint8_t *dst,
+                         int stride, int width, int height)
 {
-    int i, j;
+    int j;
     uint8_t prev;
 
     prev = 0x80; /* Set the initial value */
     for (j = 0; j < height; j++) {
-        for (i = 0; i < width; i++) {
-            *dst++ = src[i] - prev;
-            prev   = src[i];
-        }
-        src += stride;
+        dst[0] = src[0] - prev;
+        c->dsp.diff_bytes(dst + 1, src + 1, src, width - 1);
+        prev   = src[width - 1];
+        dst   += width;
+        src   += stride;
     }
 }
 
@@ -297,16 +322,23 @@ static void median_predict(UtvideoContext *c, uint8_t *src, uint8_t *dst, int st
 
 /* Count the usage of values in a plane */
 static void count_usage(uint8_t *src, int width,
-                        int height, uint64_t *counts)
+                        int height, uint32_t *counts)
 {
-    int i, j;
-
-    for (j = 0; j < height; j++) {
-        for (i = 0; i < width; i++) {
-            counts[src[i]]++;
-        }
-        src += width;
+    uint32_t tmp[3][256] = { { 0 } };
+    int i, size = width * height;
+
+    /* Spread runs of equal values over four tables to avoid store stalls */
+    for (i = 0; i < (size & ~3); i += 4) {
+        counts[src[i    ]]++;
+        tmp[0][src[i + 1]]++;
+        tmp[1][src[i + 2]]++;
+        tmp[2][src[i + 3]]++;
     }
+    for (; i < size; i++)
+        counts[src[i]]++;
+
+    for (i = 0; i < 256; i++)
+        counts[i] += tmp[0][i] + tmp[1][i] + tmp[2][i];
 }
 
 /* Calculate the actual huffman codes from the code lengths */
@@ -330,42 +362,94 @@ static void calculate_codes(HuffEntry *he)
     qsort(he, 256, sizeof(*he), huff_cmp_sym);
 }
 
-/* Write huffman bit codes to a memory block */
-static int write_huff_codes(uint8_t *src, uint8_t *dst, int dst_size,
+/*
+ * Write huffman bit codes to a memory block.
+ * The codes are packed MSB first into 32-bit words which are stored
+ * little-endian, as the bitstream expects, so no byteswap pass is needed.
+ * Codes are at most 31 bits long, so 64 bits of cache never overflow.
+ */
+static int write_huff_codes(uint8_t *src, uint8_t *dst,
                             int width, int height, HuffEntry *he)
 {
-    PutBitContext pb;
-    int i, j;
-    int count;
+    uint8_t *start = dst;
+    uint64_t cache = 0;
+    int i, size    = width * height;
+    int bits       = 0;
+
+    for (i = 0; i < size; i++) {
+        cache = cache << he[src[i]].len | he[src[i]].code;
+        bits += he[src[i]].len;
+        if (bits >= 32) {
+            bits -= 32;
+            AV_WL32(dst, cache >> bits);
+            dst  += 4;
+        }
+    }
 
-    init_put_bits(&pb, dst, dst_size);
+    /* Pad output to a 32bit boundary */
+    if (bits) {
+        AV_WL32(dst, cache << (32 - bits));
+        dst += 4;
+    }
 
-    /* Write the codes */
-    for (j = 0; j < height; j++) {
-        for (i = 0; i < width; i++)
-            put_bits(&pb, he[src[i]].len, he[src[i]].code);
+    /* Return the amount of bits written */
+    return (dst - start) * 8;
+}
 
-        src += width;
+/*
+ * Offset of the coded data of a slice starting at the given pixel in
+ * slice_bits: codes are up to 31 bits, so a slice takes at most 4 bytes
+ * per pixel even if its symbols are rare in the plane as a whole.
+ */
+#define SLICE_BITS_SIZE(pixels) (4 * (pixels))
+
+/* Apply the prediction to a slice of the plane and count its symbols */
+static int predict_slice(AVCodecContext *avctx, void *arg, int slice, int thread)
+{
+    UtvideoContext *c = avctx->priv_data;
+    int width  = c->plane_width, stride = c->plane_stride;
+    int sstart = (c->plane_height *  slice      / c->slices) & c->plane_cmask;
+    int send   = (c->plane_height * (slice + 1) / c->slices) & c->plane_cmask;
+    uint8_t *src = c->plane_src + sstart * stride;
+    uint8_t *dst = c->plane_dst + sstart * width;
+
+    switch (c->frame_pred) {
+    case PRED_NONE:
+        write_plane(src, dst, stride, width, send - sstart);
+        break;
+    case PRED_LEFT:
+        left_predict(c, src, dst, stride, width, send - sstart);
+        break;
+    case PRED_MEDIAN:
+        median_predict(c, src, dst, stride, width, send - sstart);
+        break;
     }
 
-    /* Pad output to a 32bit boundary */
-    count = put_bits_count(&pb) & 0x1F;
+    memset(c->slice_counts[slice], 0, sizeof(c->slice_counts[slice]));
+    count_usage(dst, width, send - sstart, c->slice_counts[slice]);
 
-    if (count)
-        put_bits(&pb, 32 - count, 0);
+    return 0;
+}
 
-    /* Get the amount of bits written */
-    count = put_bits_count(&pb);
+/* Huffman code a predicted slice into its own part of slice_bits */
+static int code_slice(AVCodecContext *avctx, void *arg, int slice, int thread)
+{
+    UtvideoContext *c = avctx->priv_data;
+    int width  = c->plane_width;
+    int sstart = (c->plane_height *  slice      / c->slices) & c->plane_cmask;
+    int send   = (c->plane_height * (slice + 1) / c->slices) & c->plane_cmask;
 
-    /* Flush the rest with zeroes */
-    flush_put_bits(&pb);
+    c->slice_sizes[slice] =
+        write_huff_codes(c->plane_dst + sstart * width,
+                         c->slice_bits + SLICE_BITS_SIZE(sstart * width),
+                         width, send - sstart, c->plane_he) >> 3;
 
-    return count;
+    return 0;
 }
 
 static int encode_plane(AVCodecContext *avctx, uint8_t *src,
-                        uint8_t *dst, int stride,
-                        int width, int height, PutByteContext *pb)
+                        uint8_t *dst, int stride, int width, int height,
+                        int cmask, PutByteContext *pb)
 {
     UtvideoContext *c        = avctx->priv_data;
     uint8_t  lengths[256];
@@ -373,44 +457,31 @@ static int encode_plane(AVCodecContext *avctx, uint8_t *src,
 
     HuffEntry he[256];
 
-    uint32_t offset = 0, slice_len = 0;
-    int      i, sstart, send = 0;
+    uint32_t offset = 0;
+    int      i, j, sstart;
     int      symbol;
 
-    /* Do prediction / make planes */
-    switch (c->frame_pred) {
-    case PRED_NONE:
-        for (i = 0; i < c->slices; i++) {
-            sstart = send;
-            send   = height * (i + 1) / c->slices;
-            write_plane(src + sstart * stride, dst + sstart * width,
-                        stride, width, send - sstart);
-        }
-        break;
-    case PRED_LEFT:
-        for (i = 0; i < c->slices; i++) {
-            sstart = send;
-            send   = height * (i + 1) / c->slices;
-            left_predict(src + sstart * stride, dst + sstart * width,
-                         stride, width, send - sstart);
-        }
-        break;
-    case PRED_MEDIAN:
-        for (i = 0; i < c->slices; i++) {
-            sstart = send;
-            send   = height * (i + 1) / c->slices;
-            median_predict(c, src + sstart * stride, dst + sstart * width,
-                           stride, width, send - sstart);
-        }
-        break;
-    default:
+    if (c->frame_pred != PRED_NONE && c->frame_pred != PRED_LEFT &&
+        c->frame_pred != PRED_MEDIAN) {
         av_log(avctx, AV_LOG_ERROR, "Unknown prediction mode: %d\n",
                c->frame_pred);
         return AVERROR_OPTION_NOT_FOUND;
     }
 
-    /* Count the usage of values */
-    count_usage(dst, width, height, counts);
+    c->plane_src    = src;
+    c->plane_dst    = dst;
+    c->plane_stride = stride;
+    c->plane_width  = width;
+    c->plane_height = height;
+    c->plane_cmask  = cmask;
+    c->plane_he     = he;
+
+    /* Do prediction / make planes, and count the usage of values */
+    avctx->execute2(avctx, predict_slice, NULL, NULL, c->slices);
+
+    for (i = 0; i < c->slices; i++)
+        for (j = 0; j < 256; j++)
+            counts[j] += c->slice_counts[i][j];
 
     /* Check for a special case where only one symbol was used */
     for (symbol = 0; symbol < 256; symbol++) {
@@ -458,45 +529,22 @@ static int encode_plane(AVCodecContext *avctx, uint8_t *src,
     /* Calculate the huffman codes themselves */
     calculate_codes(he);
 
-    send = 0;
-    for (i = 0; i < c->slices; i++) {
-        sstart  = send;
-        send    = height * (i + 1) / c->slices;
-
-        /*
-         * Write the huffman codes to a buffer,
-         * get the offset in bits and convert to bytes.
-         */
-        offset += write_huff_codes(dst + sstart * width, c->slice_bits,
-                                   width * (send - sstart), width,
-                                   send - sstart, he) >> 3;
-
-        slice_len = offset - slice_len;
+    /* Write the huffman codes of each slice to its part of slice_bits */
+    avctx->execute2(avctx, code_slice, NULL, NULL, c->slices);
 
-        /* Byteswap the written huffman codes */
-        c->dsp.bswap_buf((uint32_t *) c->slice_bits,
-                         (uint32_t *) c->slice_bits,
-                         slice_len >> 2);
-
-        /* Write the offset to the stream */
+    /* Write the slice end offsets to the stream */
+    for (i = 0; i < c->slices; i++) {
+        offset += c->slice_sizes[i];
         bytestream2_put_le32(pb, offset);
-
-        /* Seek to the data part of the packet */
-        bytestream2_seek_p(pb, 4 * (c->slices - i - 1) +
-                           offset - slice_len, SEEK_CUR);
-
-        /* Write the slices' data into the output packet */
-        bytestream2_put_buffer(pb, c->slice_bits, slice_len);
-
-        /* Seek back to the slice offsets */
-        bytestream2_seek_p(pb, -4 * (c->slices - i - 1) - offset,
-                           SEEK_CUR);
-
-        slice_len = offset;
     }
 
-    /* And at the end seek to the end of written slice(s) */
-    bytestream2_seek_p(pb, offset, SEEK_CUR);
+    /* Write the slices' data into the output packet */
+    for (i = 0; i < c->slices; i++) {
+        sstart = (height * i / c->slices) & cmask;
+        bytestream2_put_buffer(pb, c->slice_bits +
+                               SLICE_BITS_SIZE(sstart * width),
+                               c->slice_sizes[i]);
+    }
 
     return 0;
 }
@@ -526,7 +574,8 @@ static int utvideo_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     bytestream2_init_writer(&pb, dst, pkt->size);
 
     av_fast_malloc(&c->slice_bits, &c->slice_bits_size,
-                   width * height + FF_INPUT_BUFFER_PADDING_SIZE);
+                   SLICE_BITS_SIZE(width * height) +
+                   FF_INPUT_BUFFER_PADDING_SIZE);
 
     if (!c->slice_bits) {
         av_log(avctx, AV_LOG_ERROR, "Cannot allocate temporary buffer 2.\n");
@@ -544,8 +593,8 @@ static int utvideo_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     case AV_PIX_FMT_RGBA:
         for (i = 0; i < c->planes; i++) {
             ret = encode_plane(avctx, c->slice_buffer[i] + 2 * c->slice_stride,
-                               c->slice_buffer[i], c->slice_stride,
-                               width, height, &pb);
+                               c->pred_buffer, c->slice_stride,
+                               width, height, ~0, &pb);
 
             if (ret) {
                 av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
@@ -556,7 +605,8 @@ static int utvideo_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     case AV_PIX_FMT_YUV422P:
         for (i = 0; i < c->planes; i++) {
             ret = encode_plane(avctx, pic->data[i], c->slice_buffer[0],
-                               pic->linesize[i], width >> !!i, height, &pb);
+                               pic->linesize[i], width >> !!i, height,
+                               ~0, &pb);
 
             if (ret) {
                 av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
@@ -568,7 +618,7 @@ static int utvideo_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
         for (i = 0; i < c->planes; i++) {
             ret = encode_plane(avctx, pic->data[i], c->slice_buffer[0],
                                pic->linesize[i], width >> !!i, height >> !!i,
-                               &pb);
+                               i ? ~0 : ~1, &pb);
 
             if (ret) {
                 av_log(avctx, AV_LOG_ERROR, "Error encoding plane %d.\n", i);
@@ -615,6 +665,8 @@ AVCodec ff_utvideo_encoder = {
     .init           = utvideo_encode_init,
     .encode2        = utvideo_encode_frame,
     .close          = utvideo_encode_close,
+    .capabilities   = CODEC_CAP_FRAME_THREADS | CODEC_CAP_SLICE_THREADS |
+                      CODEC_CAP_INTRA_ONLY,
     .pix_fmts       = (const enum AVPixelFormat[]) {
                           AV_PIX_FMT_RGB24, AV_PIX_FMT_RGBA, AV_PIX_FMT_YUV422P,
                           AV_PIX_FMT_YUV420P, AV_PIX_FMT_NONE
@@ -24,9 +24,38 @@
 #include "avcodec.h"
 #include "bytestream.h"
 #include "internal.h"
+#include "v210enc.h"
+
+#define CLIP(v) av_clip(v, 4, 1019)
+
+#define WRITE_PIXELS(a, b, c)           \
+    do {                                \
+        val =   CLIP(*a++);             \
+        val |= (CLIP(*b++) << 10) |     \
+               (CLIP(*c++) << 20);      \
+        AV_WL32(dst, val);              \
+        dst += 4;                       \
+    } while (0)
+
+static void v210_planar_pack_10_c(const uint16_t *y, const uint16_t *u,
+                                  const uint16_t *v, uint8_t *dst,
+                                  ptrdiff_t width)
+{
+    uint32_t val;
+    int i;
+
+    for (i = 0; i < width; i += 6) {
+        WRITE_PIXELS(u, y, v);
+        WRITE_PIXELS(y, u, y);
+        WRITE_PIXELS(v, y, u);
+        WRITE_PIXELS(y, v, y);
+    }
+}
 
 static av_cold int encode_init(AVCodecContext *avctx)
 {
+    V210EncContext *s = avctx->priv_data;
+
     if (avctx->width & 1) {
         av_log(avctx, AV_LOG_ERROR, "v210 needs even width\n");
         return AVERROR(EINVAL);
@@ -42,12 +71,17 @@ static av_cold int encode_init(AVCodecContext *avctx)
 
     avctx->coded_frame->pict_type = AV_PICTURE_TYPE_I;
 
+    s->pack_line_10 = v210_planar_pack_10_c;
+    if (ARCH_X86)
+        ff_v210enc_init_x86(s);
+
     return 0;
 }
 
 static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
                         const AVFrame *pic, int *got_packet)
 {
+    V210EncContext *s = avctx->priv_data;
     int aligned_width = ((avctx->width + 47) / 48) * 48;
     int stride = aligned_width * 8 / 3;
     int line_padding = stride - ((avctx->width * 8 + 11) / 12) * 4;
@@ -62,26 +96,19 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
 
     bytestream2_init_writer(&p, pkt->data, pkt->size);
 
-#define CLIP(v) av_clip(v, 4, 1019)
-
-#define WRITE_PIXELS(a, b, c)           \
-    do {                                \
-        val =   CLIP(*a++);             \
-        val |= (CLIP(*b++) << 10) |     \
-               (CLIP(*c++) << 20);      \
-        bytestream2_put_le32u(&p, val); \
-    } while (0)
-
     for (h = 0; h < avctx->height; h++) {
         uint32_t val;
-        for (w = 0; w < avctx->width - 5; w += 6) {
-            WRITE_PIXELS(u, y, v);
-            WRITE_PIXELS(y, u, y);
-            WRITE_PIXELS(v, y, u);
-            WRITE_PIXELS(y, v, y);
-        }
+
+        w = avctx->width / 6 * 6;
+        s->pack_line_10(y, u, v, p.buffer, w);
+        bytestream2_skip_p(&p, w / 6 * 16);
+        y += w;
+        u += w >> 1;
+        v += w >> 1;
+
         if (w < avctx->width - 1) {
-            WRITE_PIXELS(u, y, v);
+            val = CLIP(*u++) | (CLIP(*y++) << 10) | (CLIP(*v++) << 20);
+            bytestream2_put_le32u(&p, val);
 
             val = CLIP(*y++);
             if (w == avctx->width - 2)
@@ -118,6 +145,7 @@ AVCodec ff_v210_encoder = {
     .name           = "v210",
     .type           = AVMEDIA_TYPE_VIDEO,
     .id             = AV_CODEC_ID_V210,
+    .priv_data_size = sizeof(V210EncContext),
     .init           = encode_init,
     .encode2        = encode_frame,
     .close          = encode_close,
@@ -51,7 +51,8 @@ struct vaapi_context {
     /**
      * Window system dependent data
      *
-     * - encoding: unused
+     * - encoding: Set by user, optional. The VA API encoders open their
+     *             own DRM display if this is not set.
      * - decoding: Set by user
      */
     void *display;
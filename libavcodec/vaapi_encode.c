@@ -0,0 +1,691 @@
+/*
+ * VA API encoding framework
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Common code of the VA API encoders.
+ *
+ * Pictures are encoded one at a time as an IDR/intra picture followed by
+ * P pictures which reference the previous picture only, so there is no
+ * reordering delay. Frames in system memory are uploaded to a surface,
+ * frames in AV_PIX_FMT_VAAPI_VLD are encoded directly from their surface,
+ * which must belong to the display set in hwaccel_context.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#if HAVE_VAGETDISPLAYDRM
+#include <fcntl.h>
+#include <unistd.h>
+#include <va/va_drm.h>
+#endif
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "avcodec.h"
+#include "internal.h"
+#include "vaapi.h"
+#include "vaapi_encode.h"
+
+/**
+ * @addtogroup VAAPI_Encoding
+ *
+ * @{
+ */
+
+static int make_param_buffer(AVCodecContext *avctx, int type,
+                             void *data, size_t size, int count)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    VABufferID buffer;
+    VAStatus vas;
+
+    if (ctx->nb_param_buffers >= VAAPI_ENCODE_MAX_PARAM_BUFFERS)
+        return AVERROR_BUG;
+
+    vas = vaCreateBuffer(ctx->display, ctx->context_id, type, size, count,
+                         data, &buffer);
+    if (vas != VA_STATUS_SUCCESS) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to create parameter buffer "
+               "of type %d: %s.\n", type, vaErrorStr(vas));
+        return AVERROR(EIO);
+    }
+    ctx->param_buffers[ctx->nb_param_buffers++] = buffer;
+    return 0;
+}
+
+static int make_packed_header(AVCodecContext *avctx, int type,
+                              uint8_t *data, size_t bit_len)
+{
+    VAEncPackedHeaderParameterBuffer params = {
+        .type                = type,
+        .bit_length          = bit_len,
+        .has_emulation_bytes = 1,
+    };
+    int ret;
+
+    ret = make_param_buffer(avctx, VAEncPackedHeaderParameterBufferType,
+                            &params, sizeof(params), 1);
+    if (ret < 0)
+        return ret;
+    return make_param_buffer(avctx, VAEncPackedHeaderDataBufferType,
+                             data, (bit_len + 7) / 8, 1);
+}
+
+static int make_rate_control_buffers(AVCodecContext *avctx)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    struct {
+        VAEncMiscParameterBuffer      misc;
+        VAEncMiscParameterRateControl rc;
+    } rc_params;
+    struct {
+        VAEncMiscParameterBuffer misc;
+        VAEncMiscParameterHRD    hrd;
+    } hrd_params;
+    struct {
+        VAEncMiscParameterBuffer   misc;
+        VAEncMiscParameterFrameRate fr;
+    } fr_params;
+    unsigned int max_rate = ctx->rc_mode == VAAPI_ENCODE_RC_VBR && avctx->rc_max_rate > avctx->bit_rate ?
+                            avctx->rc_max_rate : avctx->bit_rate;
+    unsigned int buffer_size = avctx->rc_buffer_size ? avctx->rc_buffer_size : max_rate;
+    int ret;
+
+    memset(&rc_params, 0, sizeof(rc_params));
+    rc_params.misc.type             = VAEncMiscParameterTypeRateControl;
+    rc_params.rc.bits_per_second    = max_rate;
+    rc_params.rc.target_percentage  = ctx->rc_mode == VAAPI_ENCODE_RC_CBR ? 100 :
+                                      avctx->bit_rate * 100LL / max_rate;
+    rc_params.rc.window_size        = 1000;
+    rc_params.rc.initial_qp         = 0;
+    rc_params.rc.min_qp             = 0;
+    ret = make_param_buffer(avctx, VAEncMiscParameterBufferType,
+                            &rc_params, sizeof(rc_params), 1);
+    if (ret < 0)
+        return ret;
+
+    memset(&hrd_params, 0, sizeof(hrd_params));
+    hrd_params.misc.type                   = VAEncMiscParameterTypeHRD;
+    hrd_params.hrd.buffer_size             = buffer_size;
+    hrd_params.hrd.initial_buffer_fullness = avctx->rc_initial_buffer_occupancy ?
+                                             avctx->rc_initial_buffer_occupancy :
+                                             buffer_size * 3LL / 4;
+    ret = make_param_buffer(avctx, VAEncMiscParameterBufferType,
+                            &hrd_params, sizeof(hrd_params), 1);
+    if (ret < 0)
+        return ret;
+
+    memset(&fr_params, 0, sizeof(fr_params));
+    fr_params.misc.type     = VAEncMiscParameterTypeFrameRate;
+    fr_params.fr.framerate  = (avctx->time_base.den + avctx->time_base.num / 2) /
+                              (avctx->time_base.num * FFMAX(avctx->ticks_per_frame, 1));
+    return make_param_buffer(avctx, VAEncMiscParameterBufferType,
+                             &fr_params, sizeof(fr_params), 1);
+}
+
+static int upload_frame(AVCodecContext *avctx, const AVFrame *frame)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    VAImage image;
+    VAStatus vas;
+    uint8_t *addr;
+    int derived, x, y, ret = 0;
+
+    vas = vaDeriveImage(ctx->display, ctx->input_surface, &image);
+    derived = vas == VA_STATUS_SUCCESS;
+    if (!derived) {
+        VAImageFormat format = {
+            .fourcc         = VA_FOURCC_NV12,
+            .byte_order     = VA_LSB_FIRST,
+            .bits_per_pixel = 12,
+        };
+        vas = vaCreateImage(ctx->display, &format, ctx->aligned_width,
+                            ctx->aligned_height, &image);
+        if (vas != VA_STATUS_SUCCESS) {
+            av_log(avctx, AV_LOG_ERROR, "Failed to create upload image: %s.\n",
+                   vaErrorStr(vas));
+            return AVERROR(EIO);
+        }
+    }
+
+    if (image.format.fourcc != VA_FOURCC_NV12) {
+        av_log(avctx, AV_LOG_ERROR, "Unsupported surface layout.\n");
+        ret = AVERROR(ENOSYS);
+        goto end;
+    }
+
+    vas = vaMapBuffer(ctx->display, image.buf, (void **)&addr);
+    if (vas != VA_STATUS_SUCCESS) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to map upload image: %s.\n",
+               vaErrorStr(vas));
+        ret = AVERROR(EIO);
+        goto end;
+    }
+
+    for (y = 0; y < avctx->height; y++)
+        memcpy(addr + image.offsets[0] + y * image.pitches[0],
+               frame->data[0] + y * frame->linesize[0], avctx->width);
+
+    for (y = 0; y < (avctx->height + 1) >> 1; y++) {
+        uint8_t *dst = addr + image.offsets[1] + y * image.pitches[1];
+        if (frame->format == AV_PIX_FMT_NV12) {
+            memcpy(dst, frame->data[1] + y * frame->linesize[1],
+                   avctx->width + 1 & ~1);
+        } else {
+            const uint8_t *u = frame->data[1] + y * frame->linesize[1];
+            const uint8_t *v = frame->data[2] + y * frame->linesize[2];
+            for (x = 0; x < (avctx->width + 1) >> 1; x++) {
+                dst[2 * x    ] = u[x];
+                dst[2 * x + 1] = v[x];
+            }
+        }
+    }
+
+    vaUnmapBuffer(ctx->display, image.buf);
+
+    if (!derived) {
+        vas = vaPutImage(ctx->display, ctx->input_surface, image.image_id,
+                         0, 0, avctx->width, avctx->height,
+                         0, 0, avctx->width, avctx->height);
+        if (vas != VA_STATUS_SUCCESS) {
+            av_log(avctx, AV_LOG_ERROR, "Failed to upload image: %s.\n",
+                   vaErrorStr(vas));
+            ret = AVERROR(EIO);
+        }
+    }
+
+end:
+    vaDestroyImage(ctx->display, image.image_id);
+    return ret;
+}
+
+static int render_picture(AVCodecContext *avctx, VAAPIEncodePicture *pic)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    const VAAPIEncodeType *codec = ctx->codec;
+    uint8_t header[VAAPI_ENCODE_MAX_HEADER_SIZE];
+    size_t bit_len;
+    VAStatus vas;
+    int ret;
+
+    if (pic->type == VAAPI_ENCODE_PICTURE_IDR) {
+        ret = make_param_buffer(avctx, VAEncSequenceParameterBufferType,
+                                ctx->codec_sequence_params,
+                                codec->sequence_params_size, 1);
+        if (ret < 0)
+            return ret;
+
+        if (ctx->rc_mode != VAAPI_ENCODE_RC_CQP) {
+            ret = make_rate_control_buffers(avctx);
+            if (ret < 0)
+                return ret;
+        }
+
+        if (ctx->packed_headers & VA_ENC_PACKED_HEADER_SEQUENCE) {
+            bit_len = 8 * sizeof(header);
+            ret = codec->write_sequence_header(avctx, pic, header, &bit_len);
+            if (ret < 0)
+                return ret;
+            ret = make_packed_header(avctx, codec->sequence_header_type,
+                                     header, bit_len);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    ret = codec->init_picture_params(avctx, pic);
+    if (ret < 0)
+        return ret;
+    ret = make_param_buffer(avctx, VAEncPictureParameterBufferType,
+                            ctx->codec_picture_params,
+                            codec->picture_params_size, 1);
+    if (ret < 0)
+        return ret;
+
+    if (ctx->packed_headers & VA_ENC_PACKED_HEADER_PICTURE) {
+        bit_len = 8 * sizeof(header);
+        ret = codec->write_picture_header(avctx, pic, header, &bit_len);
+        if (ret < 0)
+            return ret;
+        ret = make_packed_header(avctx, codec->picture_header_type,
+                                 header, bit_len);
+        if (ret < 0)
+            return ret;
+    }
+
+    ret = codec->init_slice_params(avctx, pic);
+    if (ret < 0)
+        return ret;
+    ret = make_param_buffer(avctx, VAEncSliceParameterBufferType,
+                            ctx->codec_slice_params,
+                            codec->slice_params_size, ctx->nb_slices);
+    if (ret < 0)
+        return ret;
+
+    vas = vaBeginPicture(ctx->display, ctx->context_id, pic->input_surface);
+    if (vas != VA_STATUS_SUCCESS)
+        goto fail;
+    vas = vaRenderPicture(ctx->display, ctx->context_id,
+                          ctx->param_buffers, ctx->nb_param_buffers);
+    if (vas != VA_STATUS_SUCCESS)
+        goto fail;
+    vas = vaEndPicture(ctx->display, ctx->context_id);
+    if (vas != VA_STATUS_SUCCESS)
+        goto fail;
+    vas = vaSyncSurface(ctx->display, pic->input_surface);
+    if (vas != VA_STATUS_SUCCESS)
+        goto fail;
+    return 0;
+
+fail:
+    av_log(avctx, AV_LOG_ERROR, "Failed to encode picture: %s.\n",
+           vaErrorStr(vas));
+    return AVERROR(EIO);
+}
+
+static int output_packet(AVCodecContext *avctx, AVPacket *pkt)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    VACodedBufferSegment *segments, *seg;
+    VAStatus vas;
+    uint8_t *ptr;
+    int size = 0, ret;
+
+    vas = vaMapBuffer(ctx->display, ctx->coded_buf, (void **)&segments);
+    if (vas != VA_STATUS_SUCCESS) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to map coded buffer: %s.\n",
+               vaErrorStr(vas));
+        return AVERROR(EIO);
+    }
+
+    for (seg = segments; seg; seg = seg->next)
+        size += seg->size;
+
+    if ((ret = ff_alloc_packet2(avctx, pkt, size)) < 0)
+        goto end;
+
+    ptr = pkt->data;
+    for (seg = segments; seg; seg = seg->next) {
+        memcpy(ptr, seg->buf, seg->size);
+        ptr += seg->size;
+    }
+
+end:
+    vaUnmapBuffer(ctx->display, ctx->coded_buf);
+    return ret;
+}
+
+int ff_vaapi_encode2(AVCodecContext *avctx, AVPacket *pkt,
+                     const AVFrame *frame, int *got_packet)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    VAAPIEncodePicture pic = { 0 };
+    int i, ret;
+
+    if (!frame) {
+        *got_packet = 0;
+        return 0;
+    }
+
+    if (!ctx->frame_count || ctx->gop_count >= avctx->gop_size ||
+        frame->pict_type == AV_PICTURE_TYPE_I)
+        ctx->gop_count = 0;
+
+    pic.type          = ctx->gop_count ? VAAPI_ENCODE_PICTURE_P :
+                                         VAAPI_ENCODE_PICTURE_IDR;
+    pic.pts           = frame->pts;
+    pic.encode_order  = ctx->frame_count;
+    pic.gop_order     = ctx->gop_count;
+    pic.recon_surface = ctx->recon_surfaces[ctx->recon_index];
+    pic.ref_surface   = pic.type == VAAPI_ENCODE_PICTURE_P ?
+                        ctx->recon_surfaces[!ctx->recon_index] : VA_INVALID_SURFACE;
+
+    if (frame->format == AV_PIX_FMT_VAAPI_VLD) {
+        pic.input_surface = (uintptr_t)frame->data[3];
+    } else {
+        if ((ret = upload_frame(avctx, frame)) < 0)
+            return ret;
+        pic.input_surface = ctx->input_surface;
+    }
+
+    ret = render_picture(avctx, &pic);
+    for (i = 0; i < ctx->nb_param_buffers; i++)
+        vaDestroyBuffer(ctx->display, ctx->param_buffers[i]);
+    ctx->nb_param_buffers = 0;
+    if (ret < 0)
+        return ret;
+
+    if ((ret = output_packet(avctx, pkt)) < 0)
+        return ret;
+
+    pkt->pts = pkt->dts = frame->pts;
+    if (pic.type == VAAPI_ENCODE_PICTURE_IDR)
+        pkt->flags |= AV_PKT_FLAG_KEY;
+    avctx->coded_frame->key_frame = pic.type == VAAPI_ENCODE_PICTURE_IDR;
+    avctx->coded_frame->pict_type = pic.type == VAAPI_ENCODE_PICTURE_IDR ?
+                                    AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_P;
+
+    ctx->recon_index ^= 1;
+    ctx->frame_count++;
+    ctx->gop_count++;
+    *got_packet = 1;
+    return 0;
+}
+
+static int open_display(AVCodecContext *avctx)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    struct vaapi_context *hwctx = avctx->hwaccel_context;
+    int major, minor;
+    VAStatus vas;
+
+    if (hwctx && hwctx->display) {
+        ctx->display = hwctx->display;
+        return 0;
+    }
+
+#if HAVE_VAGETDISPLAYDRM
+    ctx->drm_fd = open(ctx->device, O_RDWR);
+    if (ctx->drm_fd < 0) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to open %s.\n", ctx->device);
+        return AVERROR(errno);
+    }
+    ctx->display = vaGetDisplayDRM(ctx->drm_fd);
+    if (!ctx->display) {
+        av_log(avctx, AV_LOG_ERROR, "No VA display on %s.\n", ctx->device);
+        return AVERROR(EIO);
+    }
+    vas = vaInitialize(ctx->display, &major, &minor);
+    if (vas != VA_STATUS_SUCCESS) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to initialize VA display: %s.\n",
+               vaErrorStr(vas));
+        ctx->display = NULL;
+        return AVERROR(EIO);
+    }
+    ctx->own_display = 1;
+    av_log(avctx, AV_LOG_VERBOSE, "VA API version %d.%d on %s.\n",
+           major, minor, ctx->device);
+    return 0;
+#else
+    av_log(avctx, AV_LOG_ERROR, "No VA display was set in hwaccel_context.\n");
+    return AVERROR(EINVAL);
+#endif
+}
+
+static int create_config(AVCodecContext *avctx)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    static const unsigned int rc_modes[] = {
+        [VAAPI_ENCODE_RC_CQP] = VA_RC_CQP,
+        [VAAPI_ENCODE_RC_CBR] = VA_RC_CBR,
+        [VAAPI_ENCODE_RC_VBR] = VA_RC_VBR,
+    };
+    VAConfigAttrib attr[3] = {
+        { .type = VAConfigAttribRTFormat         },
+        { .type = VAConfigAttribRateControl      },
+        { .type = VAConfigAttribEncPackedHeaders },
+    };
+    VAEntrypoint *entrypoints;
+    unsigned int packed_headers = 0;
+    int i, nb_entrypoints, nb_attr = 2;
+    VAStatus vas;
+
+    entrypoints = av_malloc(vaMaxNumEntrypoints(ctx->display) * sizeof(*entrypoints));
+    if (!entrypoints)
+        return AVERROR(ENOMEM);
+    vas = vaQueryConfigEntrypoints(ctx->display, ctx->va_profile,
+                                   entrypoints, &nb_entrypoints);
+    for (i = 0; vas == VA_STATUS_SUCCESS && i < nb_entrypoints; i++)
+        if (entrypoints[i] == VAEntrypointEncSlice)
+            break;
+    av_free(entrypoints);
+    if (vas != VA_STATUS_SUCCESS || i == nb_entrypoints) {
+        av_log(avctx, AV_LOG_ERROR, "The driver cannot encode this profile.\n");
+        return AVERROR(ENOSYS);
+    }
+
+    vas = vaGetConfigAttributes(ctx->display, ctx->va_profile,
+                                VAEntrypointEncSlice, attr, FF_ARRAY_ELEMS(attr));
+    if (vas != VA_STATUS_SUCCESS) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to query encoder attributes: %s.\n",
+               vaErrorStr(vas));
+        return AVERROR(EIO);
+    }
+
+    if (attr[0].value == VA_ATTRIB_NOT_SUPPORTED ||
+        !(attr[0].value & VA_RT_FORMAT_YUV420)) {
+        av_log(avctx, AV_LOG_ERROR, "The driver cannot encode 4:2:0 video.\n");
+        return AVERROR(ENOSYS);
+    }
+    attr[0].value = VA_RT_FORMAT_YUV420;
+
+    if (attr[1].value == VA_ATTRIB_NOT_SUPPORTED ||
+        !(attr[1].value & rc_modes[ctx->rc_mode])) {
+        av_log(avctx, AV_LOG_ERROR, "The driver does not support the "
+               "requested %s rate control.\n",
+               ctx->rc_mode == VAAPI_ENCODE_RC_CQP ? "constant quantizer" :
+               ctx->rc_mode == VAAPI_ENCODE_RC_CBR ? "constant bitrate" :
+                                                     "variable bitrate");
+        return AVERROR(ENOSYS);
+    }
+    attr[1].value = rc_modes[ctx->rc_mode];
+
+    if (ctx->codec->sequence_header_type)
+        packed_headers |= VA_ENC_PACKED_HEADER_SEQUENCE;
+    if (ctx->codec->picture_header_type)
+        packed_headers |= VA_ENC_PACKED_HEADER_PICTURE;
+    if (attr[2].value != VA_ATTRIB_NOT_SUPPORTED)
+        ctx->packed_headers = packed_headers & attr[2].value;
+    if (ctx->packed_headers) {
+        attr[2].value = ctx->packed_headers;
+        nb_attr = 3;
+    }
+    if (ctx->packed_headers != packed_headers)
+        av_log(avctx, AV_LOG_WARNING, "The driver writes the stream headers "
+               "itself, they may not match the encoder parameters.\n");
+
+    vas = vaCreateConfig(ctx->display, ctx->va_profile, VAEntrypointEncSlice,
+                         attr, nb_attr, &ctx->config_id);
+    if (vas != VA_STATUS_SUCCESS) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to create encoder configuration: "
+               "%s.\n", vaErrorStr(vas));
+        ctx->config_id = VA_INVALID_ID;
+        return AVERROR(EIO);
+    }
+    return 0;
+}
+
+static int create_context(AVCodecContext *avctx)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    VASurfaceID surfaces[3];
+    VAStatus vas;
+
+    vas = vaCreateSurfaces(ctx->display, VA_RT_FORMAT_YUV420,
+                           ctx->aligned_width, ctx->aligned_height,
+                           surfaces, FF_ARRAY_ELEMS(surfaces), NULL, 0);
+    if (vas != VA_STATUS_SUCCESS) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to create surfaces: %s.\n",
+               vaErrorStr(vas));
+        return AVERROR(ENOMEM);
+    }
+    ctx->input_surface     = surfaces[0];
+    ctx->recon_surfaces[0] = surfaces[1];
+    ctx->recon_surfaces[1] = surfaces[2];
+
+    vas = vaCreateContext(ctx->display, ctx->config_id,
+                          ctx->aligned_width, ctx->aligned_height,
+                          VA_PROGRESSIVE, surfaces, FF_ARRAY_ELEMS(surfaces),
+                          &ctx->context_id);
+    if (vas != VA_STATUS_SUCCESS) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to create encoder context: %s.\n",
+               vaErrorStr(vas));
+        ctx->context_id = VA_INVALID_ID;
+        return AVERROR(EIO);
+    }
+
+    /* Enough for any sane picture; the driver fails rather than overflows. */
+    ctx->coded_buf_size = ctx->aligned_width * ctx->aligned_height * 3 + (1 << 16);
+    vas = vaCreateBuffer(ctx->display, ctx->context_id, VAEncCodedBufferType,
+                         ctx->coded_buf_size, 1, NULL, &ctx->coded_buf);
+    if (vas != VA_STATUS_SUCCESS) {
+        av_log(avctx, AV_LOG_ERROR, "Failed to create coded buffer: %s.\n",
+               vaErrorStr(vas));
+        ctx->coded_buf = VA_INVALID_ID;
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+static int write_extradata(AVCodecContext *avctx)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    uint8_t header[VAAPI_ENCODE_MAX_HEADER_SIZE];
+    size_t bit_len = 8 * sizeof(header);
+    int ret;
+
+    if (!ctx->codec->write_sequence_header)
+        return 0;
+
+    ret = ctx->codec->write_sequence_header(avctx, NULL, header, &bit_len);
+    if (ret < 0)
+        return ret;
+
+    avctx->extradata_size = (bit_len + 7) / 8;
+    avctx->extradata = av_mallocz(avctx->extradata_size + FF_INPUT_BUFFER_PADDING_SIZE);
+    if (!avctx->extradata)
+        return AVERROR(ENOMEM);
+    memcpy(avctx->extradata, header, avctx->extradata_size);
+    return 0;
+}
+
+int ff_vaapi_encode_init(AVCodecContext *avctx, const VAAPIEncodeType *type)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+    int ret;
+
+    ctx->codec             = type;
+    ctx->drm_fd            = -1;
+    ctx->config_id         = VA_INVALID_ID;
+    ctx->context_id        = VA_INVALID_ID;
+    ctx->input_surface     = VA_INVALID_SURFACE;
+    ctx->recon_surfaces[0] = VA_INVALID_SURFACE;
+    ctx->recon_surfaces[1] = VA_INVALID_SURFACE;
+    ctx->coded_buf         = VA_INVALID_ID;
+    ctx->max_slices        = 1;
+    ctx->aligned_width     = FFALIGN(avctx->width,  16);
+    ctx->aligned_height    = FFALIGN(avctx->height, 16);
+
+    if (avctx->max_b_frames > 0)
+        av_log(avctx, AV_LOG_WARNING, "B-frames are not supported, "
+               "encoding with P-frames only.\n");
+
+    if (avctx->flags & CODEC_FLAG_QSCALE)
+        ctx->rc_mode = VAAPI_ENCODE_RC_CQP;
+    else if (avctx->rc_max_rate && avctx->rc_max_rate == avctx->bit_rate)
+        ctx->rc_mode = VAAPI_ENCODE_RC_CBR;
+    else
+        ctx->rc_mode = VAAPI_ENCODE_RC_VBR;
+    if (ctx->rc_mode != VAAPI_ENCODE_RC_CQP && avctx->bit_rate <= 0) {
+        av_log(avctx, AV_LOG_ERROR, "A bitrate or a fixed quality must be set.\n");
+        return AVERROR(EINVAL);
+    }
+
+    if (type->priv_data_size) {
+        ctx->codec_priv = av_mallocz(type->priv_data_size);
+        if (!ctx->codec_priv) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+    }
+
+    if ((ret = type->init(avctx)) < 0)
+        goto fail;
+
+    ctx->codec_sequence_params = av_mallocz(type->sequence_params_size);
+    ctx->codec_picture_params  = av_mallocz(type->picture_params_size);
+    ctx->codec_slice_params    = av_mallocz(type->slice_params_size * ctx->max_slices);
+    avctx->coded_frame         = avcodec_alloc_frame();
+    if (!ctx->codec_sequence_params || !ctx->codec_picture_params ||
+        !ctx->codec_slice_params || !avctx->coded_frame) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    if ((ret = open_display(avctx))   < 0 ||
+        (ret = create_config(avctx))  < 0 ||
+        (ret = create_context(avctx)) < 0 ||
+        (ret = type->init_sequence_params(avctx)) < 0)
+        goto fail;
+
+    if (avctx->flags & CODEC_FLAG_GLOBAL_HEADER) {
+        if (!(ctx->packed_headers & VA_ENC_PACKED_HEADER_SEQUENCE))
+            av_log(avctx, AV_LOG_WARNING, "Global headers requested, but the "
+                   "driver writes its own stream headers.\n");
+        if ((ret = write_extradata(avctx)) < 0)
+            goto fail;
+    }
+
+    return 0;
+
+fail:
+    ff_vaapi_encode_close(avctx);
+    return ret;
+}
+
+int ff_vaapi_encode_close(AVCodecContext *avctx)
+{
+    VAAPIEncodeContext *ctx = avctx->priv_data;
+
+    if (ctx->display) {
+        if (ctx->coded_buf != VA_INVALID_ID)
+            vaDestroyBuffer(ctx->display, ctx->coded_buf);
+        if (ctx->context_id != VA_INVALID_ID)
+            vaDestroyContext(ctx->display, ctx->context_id);
+        if (ctx->input_surface != VA_INVALID_SURFACE) {
+            VASurfaceID surfaces[3] = { ctx->input_surface,
+                                        ctx->recon_surfaces[0],
+                                        ctx->recon_surfaces[1] };
+            vaDestroySurfaces(ctx->display, surfaces, FF_ARRAY_ELEMS(surfaces));
+        }
+        if (ctx->config_id != VA_INVALID_ID)
+            vaDestroyConfig(ctx->display, ctx->config_id);
+        if (ctx->own_display)
+            vaTerminate(ctx->display);
+        ctx->display = NULL;
+    }
+#if HAVE_VAGETDISPLAYDRM
+    if (ctx->drm_fd >= 0)
+        close(ctx->drm_fd);
+#endif
+    ctx->drm_fd = -1;
+
+    av_freep(&ctx->codec_sequence_params);
+    av_freep(&ctx->codec_picture_params);
+    av_freep(&ctx->codec_slice_params);
+    av_freep(&ctx->codec_priv);
+    av_freep(&avctx->coded_frame);
+    return 0;
+}
+
+/* @} */
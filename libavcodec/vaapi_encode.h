@@ -0,0 +1,158 @@
+/*
+ * VA API encoding framework
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_VAAPI_ENCODE_H
+#define AVCODEC_VAAPI_ENCODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <va/va.h>
+
+#include "libavutil/opt.h"
+#include "avcodec.h"
+
+/**
+ * @addtogroup VAAPI_Encoding
+ *
+ * @{
+ */
+
+enum {
+    VAAPI_ENCODE_PICTURE_IDR,
+    VAAPI_ENCODE_PICTURE_P,
+};
+
+enum {
+    VAAPI_ENCODE_RC_CQP,
+    VAAPI_ENCODE_RC_CBR,
+    VAAPI_ENCODE_RC_VBR,
+};
+
+/** The picture being encoded. */
+typedef struct VAAPIEncodePicture {
+    int         type;           ///< VAAPI_ENCODE_PICTURE_*
+    int64_t     pts;
+    int64_t     encode_order;   ///< number of pictures encoded before this one
+    int64_t     gop_order;      ///< number of pictures since the last intra picture
+
+    VASurfaceID input_surface;
+    VASurfaceID recon_surface;  ///< reconstructed picture, reference for the next one
+    VASurfaceID ref_surface;    ///< reconstructed previous picture, VA_INVALID_SURFACE for intra pictures
+} VAAPIEncodePicture;
+
+typedef struct VAAPIEncodeType {
+    /** Size of the codec specific state in VAAPIEncodeContext.codec_priv. */
+    size_t priv_data_size;
+
+    /**
+     * Check the codec parameters, set profile and constant QP.
+     * Called before the encoding pipeline is created.
+     */
+    int (*init)(AVCodecContext *avctx);
+
+    /** Sizes of the codec specific VA parameter structures. */
+    size_t sequence_params_size;
+    size_t picture_params_size;
+    size_t slice_params_size;
+
+    /**
+     * Fill VAAPIEncodeContext.codec_sequence_params. Called once, after the
+     * encoding pipeline has been created.
+     */
+    int (*init_sequence_params)(AVCodecContext *avctx);
+    /** Fill codec_picture_params, including the coded buffer to write to. */
+    int (*init_picture_params)(AVCodecContext *avctx, VAAPIEncodePicture *pic);
+    /** Fill codec_slice_params and set nb_slices. */
+    int (*init_slice_params)(AVCodecContext *avctx, VAAPIEncodePicture *pic);
+
+    /**
+     * Packed headers, written by the encoder rather than the driver when
+     * the driver supports it. The callbacks write the header into data and
+     * set data_len to its size in bits. write_sequence_header() is also
+     * called with pic set to NULL to build the extradata.
+     */
+    int sequence_header_type;   ///< VAEncPackedHeaderType, 0 if unused
+    int (*write_sequence_header)(AVCodecContext *avctx, VAAPIEncodePicture *pic,
+                                 uint8_t *data, size_t *data_len);
+    int picture_header_type;    ///< VAEncPackedHeaderType, 0 if unused
+    int (*write_picture_header)(AVCodecContext *avctx, VAAPIEncodePicture *pic,
+                                uint8_t *data, size_t *data_len);
+} VAAPIEncodeType;
+
+#define VAAPI_ENCODE_MAX_PARAM_BUFFERS 16
+#define VAAPI_ENCODE_MAX_HEADER_SIZE   1024
+
+typedef struct VAAPIEncodeContext {
+    const AVClass *class;
+    const VAAPIEncodeType *codec;
+    void *codec_priv;
+
+    char *device;               ///< DRM device to open if the user gives no display
+
+    VADisplay   display;
+    int         own_display;
+    int         drm_fd;
+    VAProfile   va_profile;     ///< set by VAAPIEncodeType.init()
+    VAConfigID  config_id;
+    VAContextID context_id;
+
+    int         aligned_width;
+    int         aligned_height;
+
+    /** Upload target for frames in system memory. */
+    VASurfaceID input_surface;
+    /** Reconstructed pictures, used alternately as output and reference. */
+    VASurfaceID recon_surfaces[2];
+    int         recon_index;
+    VABufferID  coded_buf;
+    size_t      coded_buf_size;
+
+    VABufferID  param_buffers[VAAPI_ENCODE_MAX_PARAM_BUFFERS];
+    int         nb_param_buffers;
+
+    unsigned int packed_headers; ///< VA_ENC_PACKED_HEADER_* supported and used
+
+    int         rc_mode;        ///< VAAPI_ENCODE_RC_*
+    int         fixed_qp;       ///< quantizer for VAAPI_ENCODE_RC_CQP, set by the codec
+
+    void       *codec_sequence_params;
+    void       *codec_picture_params;
+    void       *codec_slice_params;
+    int         nb_slices;
+    int         max_slices;     ///< slice parameters allocated, set by VAAPIEncodeType.init()
+
+    int64_t     frame_count;
+    int64_t     gop_count;
+} VAAPIEncodeContext;
+
+int ff_vaapi_encode_init(AVCodecContext *avctx, const VAAPIEncodeType *type);
+int ff_vaapi_encode2(AVCodecContext *avctx, AVPacket *pkt,
+                     const AVFrame *frame, int *got_packet);
+int ff_vaapi_encode_close(AVCodecContext *avctx);
+
+#define VAAPI_ENCODE_COMMON_OPTIONS \
+    { "device", "DRM device to open when no VA display is given in hwaccel_context", \
+      offsetof(VAAPIEncodeContext, device), AV_OPT_TYPE_STRING, \
+      { .str = "/dev/dri/card0" }, 0, 0, AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_ENCODING_PARAM }
+
+/* @} */
+
+#endif /* AVCODEC_VAAPI_ENCODE_H */
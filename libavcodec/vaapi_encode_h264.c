@@ -0,0 +1,443 @@
+/*
+ * VA API H.264 encoder
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include <va/va.h>
+#include <va/va_enc_h264.h>
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/opt.h"
+#include "avcodec.h"
+#include "golomb.h"
+#include "internal.h"
+#include "put_bits.h"
+#include "vaapi_encode.h"
+
+#define LOG2_MAX_FRAME_NUM   8
+#define LOG2_MAX_POC_LSB     8
+
+typedef struct VAAPIEncodeH264Context {
+    int profile_idc;
+    int constraint_set_flags;
+    int level_idc;
+    int mb_width;
+    int mb_height;
+    int crop_right;
+    int crop_bottom;
+    int entropy_coding_mode;
+    int transform_8x8_mode;
+    int pic_init_qp;
+    int idr_pic_count;
+} VAAPIEncodeH264Context;
+
+/**
+ * Append a NAL unit to dst, with start code and emulation prevention.
+ */
+static int write_nal_unit(uint8_t *dst, size_t *pos, size_t size,
+                          const uint8_t *rbsp, int rbsp_len)
+{
+    size_t p = *pos;
+    int i, zeros = 0;
+
+    if (p + 4 + rbsp_len * 3 / 2 + 1 > size)
+        return AVERROR(ENOSPC);
+
+    AV_WB32(dst + p, 1);
+    p += 4;
+    for (i = 0; i < rbsp_len; i++) {
+        if (zeros >= 2 && rbsp[i] <= 3) {
+            dst[p++] = 3;
+            zeros    = 0;
+        }
+        dst[p++] = rbsp[i];
+        zeros    = rbsp[i] ? 0 : zeros + 1;
+    }
+    *pos = p;
+    return 0;
+}
+
+static int rbsp_trailing_bits(PutBitContext *pb)
+{
+    put_bits(pb, 1, 1);
+    flush_put_bits(pb);
+    return put_bits_count(pb) / 8;
+}
+
+static int write_sps(AVCodecContext *avctx, uint8_t *data, size_t *pos, size_t size)
+{
+    VAAPIEncodeContext      *ctx = avctx->priv_data;
+    VAAPIEncodeH264Context *priv = ctx->codec_priv;
+    uint8_t rbsp[128];
+    PutBitContext pb;
+    int sar_num = 0, sar_den = 0;
+
+    if (avctx->sample_aspect_ratio.num > 0 && avctx->sample_aspect_ratio.den > 0)
+        av_reduce(&sar_num, &sar_den, avctx->sample_aspect_ratio.num,
+                  avctx->sample_aspect_ratio.den, 65535);
+
+    init_put_bits(&pb, rbsp, sizeof(rbsp));
+
+    put_bits(&pb, 8, 0x67);                     // nal_ref_idc 3, SPS
+    put_bits(&pb, 8, priv->profile_idc);
+    put_bits(&pb, 8, priv->constraint_set_flags);
+    put_bits(&pb, 8, priv->level_idc);
+    set_ue_golomb(&pb, 0);                      // seq_parameter_set_id
+    if (priv->profile_idc >= 100) {
+        set_ue_golomb(&pb, 1);                  // chroma_format_idc
+        set_ue_golomb(&pb, 0);                  // bit_depth_luma_minus8
+        set_ue_golomb(&pb, 0);                  // bit_depth_chroma_minus8
+        put_bits(&pb, 1, 0);                    // qpprime_y_zero_transform_bypass_flag
+        put_bits(&pb, 1, 0);                    // seq_scaling_matrix_present_flag
+    }
+    set_ue_golomb(&pb, LOG2_MAX_FRAME_NUM - 4);
+    set_ue_golomb(&pb, 0);                      // pic_order_cnt_type
+    set_ue_golomb(&pb, LOG2_MAX_POC_LSB - 4);
+    set_ue_golomb(&pb, 1);                      // max_num_ref_frames
+    put_bits(&pb, 1, 0);                        // gaps_in_frame_num_value_allowed_flag
+    set_ue_golomb(&pb, priv->mb_width  - 1);
+    set_ue_golomb(&pb, priv->mb_height - 1);
+    put_bits(&pb, 1, 1);                        // frame_mbs_only_flag
+    put_bits(&pb, 1, 1);                        // direct_8x8_inference_flag
+    put_bits(&pb, 1, priv->crop_right || priv->crop_bottom);
+    if (priv->crop_right || priv->crop_bottom) {
+        set_ue_golomb(&pb, 0);
+        set_ue_golomb(&pb, priv->crop_right);
+        set_ue_golomb(&pb, 0);
+        set_ue_golomb(&pb, priv->crop_bottom);
+    }
+
+    put_bits(&pb, 1, 1);                        // vui_parameters_present_flag
+    put_bits(&pb, 1, sar_num > 0);              // aspect_ratio_info_present_flag
+    if (sar_num > 0) {
+        put_bits(&pb, 8, 255);                  // Extended_SAR
+        put_bits(&pb, 16, sar_num);
+        put_bits(&pb, 16, sar_den);
+    }
+    put_bits(&pb, 1, 0);                        // overscan_info_present_flag
+    put_bits(&pb, 1, 0);                        // video_signal_type_present_flag
+    put_bits(&pb, 1, 0);                        // chroma_loc_info_present_flag
+    put_bits(&pb, 1, 1);                        // timing_info_present_flag
+    put_bits32(&pb, avctx->time_base.num);      // num_units_in_tick
+    put_bits32(&pb, avctx->time_base.den * 2);  // time_scale
+    put_bits(&pb, 1, 1);                        // fixed_frame_rate_flag
+    put_bits(&pb, 1, 0);                        // nal_hrd_parameters_present_flag
+    put_bits(&pb, 1, 0);                        // vcl_hrd_parameters_present_flag
+    put_bits(&pb, 1, 0);                        // pic_struct_present_flag
+    put_bits(&pb, 1, 1);                        // bitstream_restriction_flag
+    put_bits(&pb, 1, 1);                        // motion_vectors_over_pic_boundaries_flag
+    set_ue_golomb(&pb, 0);                      // max_bytes_per_pic_denom
+    set_ue_golomb(&pb, 0);                      // max_bits_per_mb_denom
+    set_ue_golomb(&pb, 16);                     // log2_max_mv_length_horizontal
+    set_ue_golomb(&pb, 16);                     // log2_max_mv_length_vertical
+    set_ue_golomb(&pb, 0);                      // max_num_reorder_frames
+    set_ue_golomb(&pb, 1);                      // max_dec_frame_buffering
+
+    return write_nal_unit(data, pos, size, rbsp, rbsp_trailing_bits(&pb));
+}
+
+static int write_pps(AVCodecContext *avctx, uint8_t *data, size_t *pos, size_t size)
+{
+    VAAPIEncodeContext      *ctx = avctx->priv_data;
+    VAAPIEncodeH264Context *priv = ctx->codec_priv;
+    uint8_t rbsp[32];
+    PutBitContext pb;
+
+    init_put_bits(&pb, rbsp, sizeof(rbsp));
+
+    put_bits(&pb, 8, 0x68);                     // nal_ref_idc 3, PPS
+    set_ue_golomb(&pb, 0);                      // pic_parameter_set_id
+    set_ue_golomb(&pb, 0);                      // seq_parameter_set_id
+    put_bits(&pb, 1, priv->entropy_coding_mode);
+    put_bits(&pb, 1, 0);                        // bottom_field_pic_order_in_frame_present_flag
+    set_ue_golomb(&pb, 0);                      // num_slice_groups_minus1
+    set_ue_golomb(&pb, 0);                      // num_ref_idx_l0_default_active_minus1
+    set_ue_golomb(&pb, 0);                      // num_ref_idx_l1_default_active_minus1
+    put_bits(&pb, 1, 0);                        // weighted_pred_flag
+    put_bits(&pb, 2, 0);                        // weighted_bipred_idc
+    set_se_golomb(&pb, priv->pic_init_qp - 26);
+    set_se_golomb(&pb, 0);                      // pic_init_qs_minus26
+    set_se_golomb(&pb, 0);                      // chroma_qp_index_offset
+    put_bits(&pb, 1, 1);                        // deblocking_filter_control_present_flag
+    put_bits(&pb, 1, 0);                        // constrained_intra_pred_flag
+    put_bits(&pb, 1, 0);                        // redundant_pic_cnt_present_flag
+    if (priv->transform_8x8_mode) {
+        put_bits(&pb, 1, 1);                    // transform_8x8_mode_flag
+        put_bits(&pb, 1, 0);                    // pic_scaling_matrix_present_flag
+        set_se_golomb(&pb, 0);                  // second_chroma_qp_index_offset
+    }
+
+    return write_nal_unit(data, pos, size, rbsp, rbsp_trailing_bits(&pb));
+}
+
+/* The extradata carries both parameter sets, in the stream the PPS is
+ * sent as the picture header. */
+static int vaapi_encode_h264_write_sequence_header(AVCodecContext *avctx,
+                                                   VAAPIEncodePicture *pic,
+                                                   uint8_t *data, size_t *data_len)
+{
+    size_t pos = 0;
+    int ret;
+
+    if ((ret = write_sps(avctx, data, &pos, *data_len / 8)) < 0)
+        return ret;
+    if (!pic && (ret = write_pps(avctx, data, &pos, *data_len / 8)) < 0)
+        return ret;
+    *data_len = 8 * pos;
+    return 0;
+}
+
+static int vaapi_encode_h264_write_picture_header(AVCodecContext *avctx,
+                                                  VAAPIEncodePicture *pic,
+                                                  uint8_t *data, size_t *data_len)
+{
+    size_t pos = 0;
+    int ret;
+
+    if ((ret = write_pps(avctx, data, &pos, *data_len / 8)) < 0)
+        return ret;
+    *data_len = 8 * pos;
+    return 0;
+}
+
+static int vaapi_encode_h264_init_sequence_params(AVCodecContext *avctx)
+{
+    VAAPIEncodeContext                 *ctx = avctx->priv_data;
+    VAAPIEncodeH264Context            *priv = ctx->codec_priv;
+    VAEncSequenceParameterBufferH264 *vseq = ctx->codec_sequence_params;
+
+    vseq->seq_parameter_set_id = 0;
+    vseq->level_idc            = priv->level_idc;
+    vseq->intra_period         = avctx->gop_size;
+    vseq->intra_idr_period     = avctx->gop_size;
+    vseq->ip_period            = 1;
+    vseq->bits_per_second      = avctx->bit_rate;
+    vseq->max_num_ref_frames   = 1;
+    vseq->picture_width_in_mbs  = priv->mb_width;
+    vseq->picture_height_in_mbs = priv->mb_height;
+
+    vseq->seq_fields.bits.chroma_format_idc                 = 1;
+    vseq->seq_fields.bits.frame_mbs_only_flag               = 1;
+    vseq->seq_fields.bits.direct_8x8_inference_flag         = 1;
+    vseq->seq_fields.bits.log2_max_frame_num_minus4         = LOG2_MAX_FRAME_NUM - 4;
+    vseq->seq_fields.bits.pic_order_cnt_type                = 0;
+    vseq->seq_fields.bits.log2_max_pic_order_cnt_lsb_minus4 = LOG2_MAX_POC_LSB - 4;
+
+    vseq->frame_cropping_flag       = priv->crop_right || priv->crop_bottom;
+    vseq->frame_crop_right_offset   = priv->crop_right;
+    vseq->frame_crop_bottom_offset  = priv->crop_bottom;
+
+    vseq->vui_parameters_present_flag = 1;
+    if (avctx->sample_aspect_ratio.num > 0 && avctx->sample_aspect_ratio.den > 0) {
+        int sar_num, sar_den;
+        av_reduce(&sar_num, &sar_den, avctx->sample_aspect_ratio.num,
+                  avctx->sample_aspect_ratio.den, 65535);
+        vseq->vui_fields.bits.aspect_ratio_info_present_flag = 1;
+        vseq->aspect_ratio_idc = 255;
+        vseq->sar_width        = sar_num;
+        vseq->sar_height       = sar_den;
+    }
+    vseq->vui_fields.bits.timing_info_present_flag   = 1;
+    vseq->vui_fields.bits.bitstream_restriction_flag = 1;
+    vseq->vui_fields.bits.log2_max_mv_length_horizontal = 16;
+    vseq->vui_fields.bits.log2_max_mv_length_vertical   = 16;
+    vseq->num_units_in_tick = avctx->time_base.num;
+    vseq->time_scale        = avctx->time_base.den * 2;
+
+    return 0;
+}
+
+static void invalidate_picture(VAPictureH264 *pic)
+{
+    pic->picture_id = VA_INVALID_SURFACE;
+    pic->flags      = VA_PICTURE_H264_INVALID;
+}
+
+static int vaapi_encode_h264_init_picture_params(AVCodecContext *avctx,
+                                                 VAAPIEncodePicture *pic)
+{
+    VAAPIEncodeContext                *ctx = avctx->priv_data;
+    VAAPIEncodeH264Context           *priv = ctx->codec_priv;
+    VAEncPictureParameterBufferH264 *vpic = ctx->codec_picture_params;
+    int i;
+
+    memset(vpic, 0, sizeof(*vpic));
+
+    vpic->CurrPic.picture_id          = pic->recon_surface;
+    vpic->CurrPic.frame_idx           = pic->gop_order & ((1 << LOG2_MAX_FRAME_NUM) - 1);
+    vpic->CurrPic.TopFieldOrderCnt    = 2 * pic->gop_order;
+    vpic->CurrPic.BottomFieldOrderCnt = 2 * pic->gop_order;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(vpic->ReferenceFrames); i++)
+        invalidate_picture(&vpic->ReferenceFrames[i]);
+    if (pic->type == VAAPI_ENCODE_PICTURE_P) {
+        VAPictureH264 *ref = &vpic->ReferenceFrames[0];
+        ref->picture_id          = pic->ref_surface;
+        ref->frame_idx           = (pic->gop_order - 1) & ((1 << LOG2_MAX_FRAME_NUM) - 1);
+        ref->flags               = VA_PICTURE_H264_SHORT_TERM_REFERENCE;
+        ref->TopFieldOrderCnt    = 2 * (pic->gop_order - 1);
+        ref->BottomFieldOrderCnt = 2 * (pic->gop_order - 1);
+    }
+
+    vpic->coded_buf            = ctx->coded_buf;
+    vpic->pic_parameter_set_id = 0;
+    vpic->seq_parameter_set_id = 0;
+    vpic->frame_num            = vpic->CurrPic.frame_idx;
+    vpic->pic_init_qp          = priv->pic_init_qp;
+
+    vpic->pic_fields.bits.idr_pic_flag       = pic->type == VAAPI_ENCODE_PICTURE_IDR;
+    vpic->pic_fields.bits.reference_pic_flag = 1;
+    vpic->pic_fields.bits.entropy_coding_mode_flag = priv->entropy_coding_mode;
+    vpic->pic_fields.bits.transform_8x8_mode_flag  = priv->transform_8x8_mode;
+    vpic->pic_fields.bits.deblocking_filter_control_present_flag = 1;
+
+    return 0;
+}
+
+static int vaapi_encode_h264_init_slice_params(AVCodecContext *avctx,
+                                               VAAPIEncodePicture *pic)
+{
+    VAAPIEncodeContext                *ctx = avctx->priv_data;
+    VAAPIEncodeH264Context           *priv = ctx->codec_priv;
+    VAEncPictureParameterBufferH264 *vpic = ctx->codec_picture_params;
+    VAEncSliceParameterBufferH264  *slice = ctx->codec_slice_params;
+    int i;
+
+    memset(slice, 0, sizeof(*slice));
+
+    slice->macroblock_address   = 0;
+    slice->num_macroblocks      = priv->mb_width * priv->mb_height;
+    slice->macroblock_info      = VA_INVALID_ID;
+    slice->slice_type           = pic->type == VAAPI_ENCODE_PICTURE_P ? 0 : 2;
+    slice->pic_parameter_set_id = 0;
+    slice->pic_order_cnt_lsb    = (2 * pic->gop_order) & ((1 << LOG2_MAX_POC_LSB) - 1);
+    if (pic->type == VAAPI_ENCODE_PICTURE_IDR)
+        slice->idr_pic_id = priv->idr_pic_count++ & 0xffff;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(slice->RefPicList0); i++) {
+        invalidate_picture(&slice->RefPicList0[i]);
+        invalidate_picture(&slice->RefPicList1[i]);
+    }
+    if (pic->type == VAAPI_ENCODE_PICTURE_P)
+        slice->RefPicList0[0] = vpic->ReferenceFrames[0];
+
+    ctx->nb_slices = 1;
+    return 0;
+}
+
+static int vaapi_encode_h264_init(AVCodecContext *avctx)
+{
+    VAAPIEncodeContext      *ctx = avctx->priv_data;
+    VAAPIEncodeH264Context *priv = ctx->codec_priv;
+
+    if (avctx->width & 1 || avctx->height & 1) {
+        av_log(avctx, AV_LOG_ERROR, "Odd dimensions are not supported.\n");
+        return AVERROR(EINVAL);
+    }
+
+    switch (avctx->profile) {
+    case FF_PROFILE_H264_CONSTRAINED_BASELINE:
+        ctx->va_profile            = VAProfileH264ConstrainedBaseline;
+        priv->profile_idc          = 66;
+        priv->constraint_set_flags = 0xc0;  // constraint_set0_flag, constraint_set1_flag
+        break;
+    case FF_PROFILE_H264_MAIN:
+        ctx->va_profile            = VAProfileH264Main;
+        priv->profile_idc          = 77;
+        priv->constraint_set_flags = 0x40;  // constraint_set1_flag
+        break;
+    case FF_PROFILE_UNKNOWN:
+    case FF_PROFILE_H264_HIGH:
+        ctx->va_profile            = VAProfileH264High;
+        priv->profile_idc          = 100;
+        priv->transform_8x8_mode   = 1;
+        break;
+    default:
+        av_log(avctx, AV_LOG_ERROR, "Unsupported profile %d, only constrained "
+               "baseline, main and high are supported.\n", avctx->profile);
+        return AVERROR(EINVAL);
+    }
+
+    priv->level_idc   = avctx->level == FF_LEVEL_UNKNOWN ? 41 : avctx->level;
+    priv->entropy_coding_mode = priv->profile_idc != 66 &&
+                                avctx->coder_type != FF_CODER_TYPE_VLC;
+    priv->mb_width    = ctx->aligned_width  / 16;
+    priv->mb_height   = ctx->aligned_height / 16;
+    priv->crop_right  = (ctx->aligned_width  - avctx->width)  / 2;
+    priv->crop_bottom = (ctx->aligned_height - avctx->height) / 2;
+
+    if (ctx->rc_mode == VAAPI_ENCODE_RC_CQP)
+        ctx->fixed_qp = av_clip(avctx->global_quality / FF_QP2LAMBDA, 0, 51);
+    priv->pic_init_qp = ctx->rc_mode == VAAPI_ENCODE_RC_CQP ? ctx->fixed_qp : 26;
+
+    return 0;
+}
+
+static const VAAPIEncodeType vaapi_encode_type_h264 = {
+    .priv_data_size        = sizeof(VAAPIEncodeH264Context),
+    .init                  = &vaapi_encode_h264_init,
+
+    .sequence_params_size  = sizeof(VAEncSequenceParameterBufferH264),
+    .picture_params_size   = sizeof(VAEncPictureParameterBufferH264),
+    .slice_params_size     = sizeof(VAEncSliceParameterBufferH264),
+
+    .init_sequence_params  = &vaapi_encode_h264_init_sequence_params,
+    .init_picture_params   = &vaapi_encode_h264_init_picture_params,
+    .init_slice_params     = &vaapi_encode_h264_init_slice_params,
+
+    .sequence_header_type  = VAEncPackedHeaderSequence,
+    .write_sequence_header = &vaapi_encode_h264_write_sequence_header,
+    .picture_header_type   = VAEncPackedHeaderPicture,
+    .write_picture_header  = &vaapi_encode_h264_write_picture_header,
+};
+
+static av_cold int vaapi_encode_h264_init_encoder(AVCodecContext *avctx)
+{
+    return ff_vaapi_encode_init(avctx, &vaapi_encode_type_h264);
+}
+
+static const AVOption options[] = {
+    VAAPI_ENCODE_COMMON_OPTIONS,
+    { NULL },
+};
+
+static const AVClass vaapi_encode_h264_class = {
+    .class_name = "h264_vaapi",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+AVCodec ff_h264_vaapi_encoder = {
+    .name           = "h264_vaapi",
+    .type           = AVMEDIA_TYPE_VIDEO,
+    .id             = AV_CODEC_ID_H264,
+    .priv_data_size = sizeof(VAAPIEncodeContext),
+    .init           = &vaapi_encode_h264_init_encoder,
+    .encode2        = &ff_vaapi_encode2,
+    .close          = &ff_vaapi_encode_close,
+    .priv_class     = &vaapi_encode_h264_class,
+    .pix_fmts       = (const enum AVPixelFormat[]){ AV_PIX_FMT_NV12,
+                                                    AV_PIX_FMT_YUV420P,
+                                                    AV_PIX_FMT_VAAPI_VLD,
+                                                    AV_PIX_FMT_NONE },
+    .long_name      = NULL_IF_CONFIG_SMALL("H.264/AVC (VAAPI)"),
+};
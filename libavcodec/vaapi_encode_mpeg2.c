@@ -0,0 +1,337 @@
+/*
+ * VA API MPEG-2 encoder
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include <va/va.h>
+#include <va/va_enc_mpeg2.h>
+
+#include "libavutil/common.h"
+#include "libavutil/opt.h"
+#include "avcodec.h"
+#include "internal.h"
+#include "mpeg12data.h"
+#include "put_bits.h"
+#include "vaapi_encode.h"
+
+#define SEQ_START_CODE          0x000001b3
+#define EXT_START_CODE          0x000001b5
+#define GOP_START_CODE          0x000001b8
+#define PICTURE_START_CODE      0x00000100
+
+/* f_code of the forward vectors of P pictures, 15 marks unused vectors */
+#define P_F_CODE                4
+
+typedef struct VAAPIEncodeMPEG2Context {
+    int frame_rate_code;
+    int aspect_ratio_info;
+    int profile_and_level;
+    int bit_rate;           ///< in units of 400 bit/s, 0x3ffff if unspecified
+    int vbv_buffer_size;    ///< in units of 16 kbit
+    int fps;                ///< frame rate rounded for the time codes
+    int mb_width;
+    int mb_height;
+} VAAPIEncodeMPEG2Context;
+
+static int vaapi_encode_mpeg2_write_sequence_header(AVCodecContext *avctx,
+                                                    VAAPIEncodePicture *pic,
+                                                    uint8_t *data, size_t *data_len)
+{
+    VAAPIEncodeContext       *ctx = avctx->priv_data;
+    VAAPIEncodeMPEG2Context *priv = ctx->codec_priv;
+    PutBitContext pb;
+
+    init_put_bits(&pb, data, *data_len / 8);
+
+    put_bits32(&pb, SEQ_START_CODE);
+    put_bits(&pb, 12, avctx->width  & 0xfff);
+    put_bits(&pb, 12, avctx->height & 0xfff);
+    put_bits(&pb,  4, priv->aspect_ratio_info);
+    put_bits(&pb,  4, priv->frame_rate_code);
+    put_bits(&pb, 18, priv->bit_rate & 0x3ffff);
+    put_bits(&pb,  1, 1);                       // marker_bit
+    put_bits(&pb, 10, priv->vbv_buffer_size & 0x3ff);
+    put_bits(&pb,  1, 0);                       // constrained_parameters_flag
+    put_bits(&pb,  1, 0);                       // load_intra_quantiser_matrix
+    put_bits(&pb,  1, 0);                       // load_non_intra_quantiser_matrix
+
+    put_bits32(&pb, EXT_START_CODE);
+    put_bits(&pb,  4, 1);                       // sequence extension
+    put_bits(&pb,  8, priv->profile_and_level);
+    put_bits(&pb,  1, 1);                       // progressive_sequence
+    put_bits(&pb,  2, 1);                       // chroma_format 4:2:0
+    put_bits(&pb,  2, avctx->width  >> 12);
+    put_bits(&pb,  2, avctx->height >> 12);
+    put_bits(&pb, 12, priv->bit_rate >> 18);
+    put_bits(&pb,  1, 1);                       // marker_bit
+    put_bits(&pb,  8, priv->vbv_buffer_size >> 10);
+    put_bits(&pb,  1, 0);                       // low_delay
+    put_bits(&pb,  2, 0);                       // frame_rate_extension_n
+    put_bits(&pb,  5, 0);                       // frame_rate_extension_d
+
+    /* The extradata stops here, a GOP starts with every intra picture. */
+    if (pic) {
+        int64_t n = pic->encode_order;
+        put_bits32(&pb, GOP_START_CODE);
+        put_bits(&pb, 1, 0);                    // drop_frame_flag
+        put_bits(&pb, 5, n / (priv->fps * 3600) % 24);
+        put_bits(&pb, 6, n / (priv->fps * 60)   % 60);
+        put_bits(&pb, 1, 1);                    // marker_bit
+        put_bits(&pb, 6, n /  priv->fps         % 60);
+        put_bits(&pb, 6, n %  priv->fps);
+        put_bits(&pb, 1, 1);                    // closed_gop
+        put_bits(&pb, 1, 0);                    // broken_link
+        put_bits(&pb, 5, 0);                    // byte alignment
+    }
+
+    flush_put_bits(&pb);
+    *data_len = put_bits_count(&pb);
+    return 0;
+}
+
+static int vaapi_encode_mpeg2_write_picture_header(AVCodecContext *avctx,
+                                                   VAAPIEncodePicture *pic,
+                                                   uint8_t *data, size_t *data_len)
+{
+    int p = pic->type == VAAPI_ENCODE_PICTURE_P;
+    PutBitContext pb;
+
+    init_put_bits(&pb, data, *data_len / 8);
+
+    put_bits32(&pb, PICTURE_START_CODE);
+    put_bits(&pb, 10, pic->gop_order & 0x3ff); // temporal_reference
+    put_bits(&pb,  3, p ? 2 : 1);               // picture_coding_type
+    put_bits(&pb, 16, 0xffff);                  // vbv_delay
+    if (p) {
+        put_bits(&pb, 1, 0);                    // full_pel_forward_vector
+        put_bits(&pb, 3, 7);                    // forward_f_code
+    }
+    put_bits(&pb, 1, 0);                        // extra_bit_picture
+    avpriv_align_put_bits(&pb);
+
+    put_bits32(&pb, EXT_START_CODE);
+    put_bits(&pb, 4, 8);                        // picture coding extension
+    put_bits(&pb, 4, p ? P_F_CODE : 15);        // f_code[0][0]
+    put_bits(&pb, 4, p ? P_F_CODE : 15);        // f_code[0][1]
+    put_bits(&pb, 4, 15);                       // f_code[1][0]
+    put_bits(&pb, 4, 15);                       // f_code[1][1]
+    put_bits(&pb, 2, 0);                        // intra_dc_precision, 8 bits
+    put_bits(&pb, 2, 3);                        // picture_structure, frame
+    put_bits(&pb, 1, 0);                        // top_field_first
+    put_bits(&pb, 1, 1);                        // frame_pred_frame_dct
+    put_bits(&pb, 1, 0);                        // concealment_motion_vectors
+    put_bits(&pb, 1, 0);                        // q_scale_type
+    put_bits(&pb, 1, 0);                        // intra_vlc_format
+    put_bits(&pb, 1, 0);                        // alternate_scan
+    put_bits(&pb, 1, 0);                        // repeat_first_field
+    put_bits(&pb, 1, 1);                        // chroma_420_type
+    put_bits(&pb, 1, 1);                        // progressive_frame
+    put_bits(&pb, 1, 0);                        // composite_display_flag
+
+    flush_put_bits(&pb);
+    *data_len = put_bits_count(&pb);
+    return 0;
+}
+
+static int vaapi_encode_mpeg2_init_sequence_params(AVCodecContext *avctx)
+{
+    VAAPIEncodeContext                  *ctx = avctx->priv_data;
+    VAAPIEncodeMPEG2Context            *priv = ctx->codec_priv;
+    VAEncSequenceParameterBufferMPEG2 *vseq = ctx->codec_sequence_params;
+
+    vseq->intra_period             = avctx->gop_size;
+    vseq->ip_period                = 1;
+    vseq->picture_width            = avctx->width;
+    vseq->picture_height           = avctx->height;
+    vseq->bits_per_second          = avctx->bit_rate;
+    vseq->frame_rate               = av_q2d(ff_mpeg12_frame_rate_tab[priv->frame_rate_code]);
+    vseq->aspect_ratio_information = priv->aspect_ratio_info;
+    vseq->vbv_buffer_size          = priv->vbv_buffer_size;
+
+    vseq->sequence_extension.bits.profile_and_level_indication = priv->profile_and_level;
+    vseq->sequence_extension.bits.progressive_sequence         = 1;
+    vseq->sequence_extension.bits.chroma_format                = 1;
+
+    vseq->new_gop_header              = 1;
+    vseq->gop_header.bits.closed_gop  = 1;
+
+    return 0;
+}
+
+static int vaapi_encode_mpeg2_init_picture_params(AVCodecContext *avctx,
+                                                  VAAPIEncodePicture *pic)
+{
+    VAAPIEncodeContext                 *ctx = avctx->priv_data;
+    VAEncPictureParameterBufferMPEG2 *vpic = ctx->codec_picture_params;
+    int p = pic->type == VAAPI_ENCODE_PICTURE_P;
+
+    memset(vpic, 0, sizeof(*vpic));
+
+    vpic->forward_reference_picture  = p ? pic->ref_surface : VA_INVALID_SURFACE;
+    vpic->backward_reference_picture = VA_INVALID_SURFACE;
+    vpic->reconstructed_picture      = pic->recon_surface;
+    vpic->coded_buf                  = ctx->coded_buf;
+    vpic->picture_type               = p ? VAEncPictureTypePredictive :
+                                           VAEncPictureTypeIntra;
+    vpic->temporal_reference         = pic->gop_order & 0x3ff;
+    vpic->vbv_delay                  = 0xffff;
+
+    vpic->f_code[0][0] = p ? P_F_CODE : 15;
+    vpic->f_code[0][1] = p ? P_F_CODE : 15;
+    vpic->f_code[1][0] = 15;
+    vpic->f_code[1][1] = 15;
+
+    vpic->picture_coding_extension.bits.picture_structure    = 3;
+    vpic->picture_coding_extension.bits.frame_pred_frame_dct = 1;
+    vpic->picture_coding_extension.bits.progressive_frame    = 1;
+
+    return 0;
+}
+
+static int vaapi_encode_mpeg2_init_slice_params(AVCodecContext *avctx,
+                                                VAAPIEncodePicture *pic)
+{
+    VAAPIEncodeContext                *ctx = avctx->priv_data;
+    VAAPIEncodeMPEG2Context          *priv = ctx->codec_priv;
+    VAEncSliceParameterBufferMPEG2 *slices = ctx->codec_slice_params;
+    int i;
+
+    /* Every macroblock row must start a new slice. */
+    for (i = 0; i < priv->mb_height; i++) {
+        slices[i].macroblock_address   = i * priv->mb_width;
+        slices[i].num_macroblocks      = priv->mb_width;
+        slices[i].quantiser_scale_code = ctx->fixed_qp;
+        slices[i].is_intra_slice       = pic->type != VAAPI_ENCODE_PICTURE_P;
+    }
+    ctx->nb_slices = priv->mb_height;
+    return 0;
+}
+
+static int vaapi_encode_mpeg2_init(AVCodecContext *avctx)
+{
+    VAAPIEncodeContext       *ctx = avctx->priv_data;
+    VAAPIEncodeMPEG2Context *priv = ctx->codec_priv;
+    AVRational frame_rate = av_inv_q(avctx->time_base);
+    int i;
+
+    for (i = 1; i < 9; i++)
+        if (!av_cmp_q(frame_rate, ff_mpeg12_frame_rate_tab[i]))
+            break;
+    if (i == 9) {
+        av_log(avctx, AV_LOG_ERROR, "Frame rate %d/%d is not supported by "
+               "MPEG-2.\n", frame_rate.num, frame_rate.den);
+        return AVERROR(EINVAL);
+    }
+    priv->frame_rate_code = i;
+    priv->fps             = FFMAX(lrint(av_q2d(frame_rate)), 1);
+
+    priv->aspect_ratio_info = 1;
+    if (avctx->sample_aspect_ratio.num > 0 && avctx->sample_aspect_ratio.den > 0 &&
+        av_cmp_q(avctx->sample_aspect_ratio, (AVRational){ 1, 1 })) {
+        double dar = av_q2d(avctx->sample_aspect_ratio) * avctx->width / avctx->height;
+        for (i = 2; i < 5; i++)
+            if (fabs(dar - av_q2d(ff_mpeg2_aspect[i])) < 0.01 * dar)
+                break;
+        if (i < 5)
+            priv->aspect_ratio_info = i;
+        else
+            av_log(avctx, AV_LOG_WARNING, "Aspect ratio cannot be signalled "
+                   "in MPEG-2, coding square pixels.\n");
+    }
+
+    if (avctx->width > 1920 || avctx->height > 1152) {
+        av_log(avctx, AV_LOG_ERROR, "Picture too large for MPEG-2 main profile.\n");
+        return AVERROR(EINVAL);
+    }
+    if (avctx->width <= 720 && avctx->height <= 576)
+        priv->profile_and_level = 0x48;
+    else if (avctx->width <= 1440)
+        priv->profile_and_level = 0x46;
+    else
+        priv->profile_and_level = 0x44;
+    ctx->va_profile = VAProfileMPEG2Main;
+
+    priv->bit_rate        = ctx->rc_mode == VAAPI_ENCODE_RC_CQP ? 0x3ffff :
+                            (avctx->bit_rate + 399) / 400;
+    priv->vbv_buffer_size = avctx->rc_buffer_size ?
+                            (avctx->rc_buffer_size + 16383) / 16384 :
+                            priv->profile_and_level == 0x48 ? 112 :
+                            priv->profile_and_level == 0x46 ? 592 : 1000;
+
+    priv->mb_width   = ctx->aligned_width  / 16;
+    priv->mb_height  = ctx->aligned_height / 16;
+    ctx->max_slices  = priv->mb_height;
+
+    ctx->fixed_qp = ctx->rc_mode == VAAPI_ENCODE_RC_CQP ?
+                    av_clip(avctx->global_quality / FF_QP2LAMBDA / 2, 1, 31) : 8;
+
+    return 0;
+}
+
+static const VAAPIEncodeType vaapi_encode_type_mpeg2 = {
+    .priv_data_size        = sizeof(VAAPIEncodeMPEG2Context),
+    .init                  = &vaapi_encode_mpeg2_init,
+
+    .sequence_params_size  = sizeof(VAEncSequenceParameterBufferMPEG2),
+    .picture_params_size   = sizeof(VAEncPictureParameterBufferMPEG2),
+    .slice_params_size     = sizeof(VAEncSliceParameterBufferMPEG2),
+
+    .init_sequence_params  = &vaapi_encode_mpeg2_init_sequence_params,
+    .init_picture_params   = &vaapi_encode_mpeg2_init_picture_params,
+    .init_slice_params     = &vaapi_encode_mpeg2_init_slice_params,
+
+    .sequence_header_type  = VAEncPackedHeaderSequence,
+    .write_sequence_header = &vaapi_encode_mpeg2_write_sequence_header,
+    .picture_header_type   = VAEncPackedHeaderPicture,
+    .write_picture_header  = &vaapi_encode_mpeg2_write_picture_header,
+};
+
+static av_cold int vaapi_encode_mpeg2_init_encoder(AVCodecContext *avctx)
+{
+    return ff_vaapi_encode_init(avctx, &vaapi_encode_type_mpeg2);
+}
+
+static const AVOption options[] = {
+    VAAPI_ENCODE_COMMON_OPTIONS,
+    { NULL },
+};
+
+static const AVClass vaapi_encode_mpeg2_class = {
+    .class_name = "mpeg2_vaapi",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+AVCodec ff_mpeg2_vaapi_encoder = {
+    .name           = "mpeg2_vaapi",
+    .type           = AVMEDIA_TYPE_VIDEO,
+    .id             = AV_CODEC_ID_MPEG2VIDEO,
+    .priv_data_size = sizeof(VAAPIEncodeContext),
+    .init           = &vaapi_encode_mpeg2_init_encoder,
+    .encode2        = &ff_vaapi_encode2,
+    .close          = &ff_vaapi_encode_close,
+    .priv_class     = &vaapi_encode_mpeg2_class,
+    .pix_fmts       = (const enum AVPixelFormat[]){ AV_PIX_FMT_NV12,
+                                                    AV_PIX_FMT_YUV420P,
+                                                    AV_PIX_FMT_VAAPI_VLD,
+                                                    AV_PIX_FMT_NONE },
+    .long_name      = NULL_IF_CONFIG_SMALL("MPEG-2 video (VAAPI)"),
+};
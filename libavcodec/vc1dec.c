@@ -38,6 +38,7 @@
 #include "unary.h"
 #include "mathops.h"
 #include "vdpau_internal.h"
+#include "thread.h"
 #include "libavutil/avassert.h"
 
 #undef NDEBUG
@@ -4325,6 +4326,48 @@ static void vc1_decode_b_mb_intfi(VC1Context *v)
     }
 }
 
+/** Report the rows of the current picture that are final to other frame
+ * threads.
+ * Interlaced pictures are only released as a whole by ff_MPV_frame_end().
+ * For progressive ones the block output, overlap smoothing and loop filter
+ * run up to two rows behind the decoding loop, so only the rows above
+ * those are reported.
+ */
+static void vc1_report_decode_progress(VC1Context *v)
+{
+    MpegEncContext *s = &v->s;
+
+    if (v->fcm == PROGRESSIVE && s->pict_type != AV_PICTURE_TYPE_B &&
+        !s->error_occurred)
+        ff_thread_report_progress(&s->current_picture_ptr->f, s->mb_y - 3, 0);
+}
+
+/** Wait until the reference pictures are decoded far enough for the
+ * motion compensation of the current macroblock row.
+ */
+static void vc1_await_references(VC1Context *v)
+{
+    MpegEncContext *s = &v->s;
+    int row = s->mb_height - 1;
+
+    if (!(s->avctx->active_thread_type & FF_THREAD_FRAME))
+        return;
+
+    if (v->fcm == PROGRESSIVE) {
+        /* direct mode MVs are scaled from the next picture, which may
+         * have used a larger MV range than the current one */
+        int range_y = s->pict_type == AV_PICTURE_TYPE_B && v->extended_mv ?
+                      1 << 10 : v->range_y;
+        /* range_y is in quarter pels, add the last MB line, the subpel
+         * filter taps and one row of margin */
+        row = FFMIN(s->mb_y + ((range_y >> 2) + 15 + 3) / 16 + 1, row);
+    }
+    if (s->last_picture_ptr)
+        ff_thread_await_progress(&s->last_picture_ptr->f, row, 0);
+    if (s->pict_type == AV_PICTURE_TYPE_B && s->next_picture_ptr)
+        ff_thread_await_progress(&s->next_picture_ptr->f, row, 0);
+}
+
 /** Decode blocks of I-frame
  */
 static void vc1_decode_i_blocks(VC1Context *v)
@@ -4454,6 +4497,7 @@ static void vc1_decode_i_blocks(VC1Context *v)
             ff_draw_horiz_band(s, s->mb_y * 16, 16);
         else if (s->mb_y)
             ff_draw_horiz_band(s, (s->mb_y - 1) * 16, 16);
+        vc1_report_decode_progress(v);
 
         s->first_slice_line = 0;
     }
@@ -4582,6 +4626,7 @@ static void vc1_decode_i_blocks_adv(VC1Context *v)
             ff_draw_horiz_band(s, s->mb_y * 16, 16);
         else if (s->mb_y)
             ff_draw_horiz_band(s, (s->mb_y-1) * 16, 16);
+        vc1_report_decode_progress(v);
         s->first_slice_line = 0;
     }
 
@@ -4636,6 +4681,7 @@ static void vc1_decode_p_blocks(VC1Context *v)
     for (s->mb_y = s->start_mb_y; s->mb_y < s->end_mb_y; s->mb_y++) {
         s->mb_x = 0;
         ff_init_block_index(s);
+        vc1_await_references(v);
         for (; s->mb_x < s->mb_width; s->mb_x++) {
             ff_update_block_index(s);
 
@@ -4659,6 +4705,7 @@ static void vc1_decode_p_blocks(VC1Context *v)
         memmove(v->is_intra_base, v->is_intra, sizeof(v->is_intra_base[0]) * s->mb_stride);
         memmove(v->luma_mv_base,  v->luma_mv,  sizeof(v->luma_mv_base[0])  * s->mb_stride);
         if (s->mb_y != s->start_mb_y) ff_draw_horiz_band(s, (s->mb_y - 1) * 16, 16);
+        vc1_report_decode_progress(v);
         s->first_slice_line = 0;
     }
     if (apply_loop_filter && v->fcm == PROGRESSIVE) {
@@ -4708,6 +4755,7 @@ static void vc1_decode_b_blocks(VC1Context *v)
     for (s->mb_y = s->start_mb_y; s->mb_y < s->end_mb_y; s->mb_y++) {
         s->mb_x = 0;
         ff_init_block_index(s);
+        vc1_await_references(v);
         for (; s->mb_x < s->mb_width; s->mb_x++) {
             ff_update_block_index(s);
 
@@ -4746,12 +4794,14 @@ static void vc1_decode_skip_blocks(VC1Context *v)
         s->mb_x = 0;
         ff_init_block_index(s);
         ff_update_block_index(s);
+        vc1_await_references(v);
         if (s->last_picture.f.data[0]) {
             memcpy(s->dest[0], s->last_picture.f.data[0] + s->mb_y * 16 * s->linesize,   s->linesize   * 16);
             memcpy(s->dest[1], s->last_picture.f.data[1] + s->mb_y *  8 * s->uvlinesize, s->uvlinesize *  8);
             memcpy(s->dest[2], s->last_picture.f.data[2] + s->mb_y *  8 * s->uvlinesize, s->uvlinesize *  8);
         }
         ff_draw_horiz_band(s, s->mb_y * 16, 16);
+        vc1_report_decode_progress(v);
         s->first_slice_line = 0;
     }
     s->pict_type = AV_PICTURE_TYPE_P;
@@ -5295,22 +5345,12 @@ static av_cold int vc1_decode_init(AVCodecContext *avctx)
     return 0;
 }
 
-/** Close a VC1/WMV3 decoder
- * @warning Initial try at using MpegEncContext stuff
- */
-av_cold int ff_vc1_decode_end(AVCodecContext *avctx)
+static av_cold void vc1_free_tables(VC1Context *v)
 {
-    VC1Context *v = avctx->priv_data;
     int i;
 
-    if ((avctx->codec_id == AV_CODEC_ID_WMV3IMAGE || avctx->codec_id == AV_CODEC_ID_VC1IMAGE)
-        && v->sprite_output_frame.data[0])
-        avctx->release_buffer(avctx, &v->sprite_output_frame);
     for (i = 0; i < 4; i++)
         av_freep(&v->sr_rows[i >> 1][i & 1]);
-    av_freep(&v->hrd_rate);
-    av_freep(&v->hrd_buffer);
-    ff_MPV_common_end(&v->s);
     av_freep(&v->mv_type_mb_plane);
     av_freep(&v->direct_mb_plane);
     av_freep(&v->forward_mb_plane);
@@ -5328,6 +5368,95 @@ av_cold int ff_vc1_decode_end(AVCodecContext *avctx)
     av_freep(&v->is_intra_base); // FIXME use v->mb_type[]
     av_freep(&v->luma_mv_base);
     ff_intrax8_common_end(&v->x8);
+}
+
+/** Close a VC1/WMV3 decoder
+ * @warning Initial try at using MpegEncContext stuff
+ */
+av_cold int ff_vc1_decode_end(AVCodecContext *avctx)
+{
+    VC1Context *v = avctx->priv_data;
+
+    if ((avctx->codec_id == AV_CODEC_ID_WMV3IMAGE || avctx->codec_id == AV_CODEC_ID_VC1IMAGE)
+        && v->sprite_output_frame.data[0])
+        avctx->release_buffer(avctx, &v->sprite_output_frame);
+    av_freep(&v->hrd_rate);
+    av_freep(&v->hrd_buffer);
+    ff_MPV_common_end(&v->s);
+    vc1_free_tables(v);
+    return 0;
+}
+
+static uint8_t *vc1_rebase_mv_f(VC1Context *v, const VC1Context *v1,
+                                uint8_t *mv_f, int size)
+{
+    if (mv_f >= v1->mv_f_last_base && mv_f < v1->mv_f_last_base + size)
+        return v->mv_f_last_base + (mv_f - v1->mv_f_last_base);
+    if (mv_f >= v1->mv_f_next_base && mv_f < v1->mv_f_next_base + size)
+        return v->mv_f_next_base + (mv_f - v1->mv_f_next_base);
+    return v->mv_f_base + (mv_f - v1->mv_f_base);
+}
+
+static int vc1_decode_update_thread_context(AVCodecContext *dst,
+                                            const AVCodecContext *src)
+{
+    VC1Context *v = dst->priv_data, *v1 = src->priv_data;
+    MpegEncContext *s = &v->s, *s1 = &v1->s;
+    int mb_stride = s->mb_stride, mb_height = s->mb_height;
+    int i, err, mv_f_size;
+
+    if (dst == src || !s1->context_initialized)
+        return 0;
+
+    if ((err = ff_mpeg_update_thread_context(dst, src)) < 0)
+        return err;
+
+    if (v->mv_type_mb_plane &&
+        (s->mb_stride != mb_stride || s->mb_height != mb_height))
+        vc1_free_tables(v);
+    if (!v->mv_type_mb_plane && ff_vc1_decode_init_alloc_tables(v) < 0)
+        return AVERROR(ENOMEM);
+
+    /* sequence header and entry point */
+    memcpy(&v->res_sprite, &v1->res_sprite,
+           (char *) &v1->mv_mode - (char *) &v1->res_sprite);
+    s->loop_filter          = s1->loop_filter;
+    s->resync_marker        = s1->resync_marker;
+    v->broken_link          = v1->broken_link;
+    v->closed_entry         = v1->closed_entry;
+    v->hrd_num_leaky_buckets = v1->hrd_num_leaky_buckets;
+    v->bit_rate_exponent    = v1->bit_rate_exponent;
+    v->buffer_size_exponent = v1->buffer_size_exponent;
+    v->range_mapy_flag      = v1->range_mapy_flag;
+    v->range_mapuv_flag     = v1->range_mapuv_flag;
+    v->range_mapy           = v1->range_mapy;
+    v->range_mapuv          = v1->range_mapuv;
+
+    /* state carried over from the previous pictures */
+    v->rnd       = v1->rnd;
+    v->use_ic    = v1->use_ic;
+    v->qs_last   = v1->qs_last;
+    v->refdist   = v1->refdist;
+    v->lumscale  = v1->lumscale;
+    v->lumshift  = v1->lumshift;
+    v->lumscale2 = v1->lumscale2;
+    v->lumshift2 = v1->lumshift2;
+    memcpy(v->luty,   v1->luty,   sizeof(v->luty));
+    memcpy(v->lutuv,  v1->lutuv,  sizeof(v->lutuv));
+    memcpy(v->luty2,  v1->luty2,  sizeof(v->luty2));
+    memcpy(v->lutuv2, v1->lutuv2, sizeof(v->lutuv2));
+
+    /* field pictures use the MV field flags of their references */
+    mv_f_size = 2 * (s->b8_stride * (s->mb_height * 2 + 1) + s->mb_stride * (s->mb_height + 1) * 2);
+    memcpy(v->mv_f_base,      v1->mv_f_base,      mv_f_size);
+    memcpy(v->mv_f_last_base, v1->mv_f_last_base, mv_f_size);
+    memcpy(v->mv_f_next_base, v1->mv_f_next_base, mv_f_size);
+    for (i = 0; i < 2; i++) {
+        v->mv_f[i]      = vc1_rebase_mv_f(v, v1, v1->mv_f[i],      mv_f_size);
+        v->mv_f_last[i] = vc1_rebase_mv_f(v, v1, v1->mv_f_last[i], mv_f_size);
+        v->mv_f_next[i] = vc1_rebase_mv_f(v, v1, v1->mv_f_next[i], mv_f_size);
+    }
+
     return 0;
 }
 
@@ -5597,6 +5726,11 @@ static int vc1_decode_frame(AVCodecContext *avctx, void *data,
     s->me.qpel_put = s->dsp.put_qpel_pixels_tab;
     s->me.qpel_avg = s->dsp.avg_qpel_pixels_tab;
 
+    /* Field pictures rotate the per-field MV tables while decoding, so the
+     * next thread may only start once they are final. */
+    if (!v->field_mode)
+        ff_thread_finish_setup(avctx);
+
     if ((CONFIG_VC1_VDPAU_DECODER)
         &&s->avctx->codec->capabilities&CODEC_CAP_HWACCEL_VDPAU)
         ff_vdpau_vc1_decode_picture(s, buf_start, (buf + buf_size) - buf_start);
@@ -5792,10 +5926,11 @@ AVCodec ff_vc1_decoder = {
     .close          = ff_vc1_decode_end,
     .decode         = vc1_decode_frame,
     .flush          = ff_mpeg_flush,
-    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_DELAY,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_DELAY | CODEC_CAP_FRAME_THREADS,
     .long_name      = NULL_IF_CONFIG_SMALL("SMPTE VC-1"),
     .pix_fmts       = ff_hwaccel_pixfmt_list_420,
-    .profiles       = NULL_IF_CONFIG_SMALL(profiles)
+    .profiles       = NULL_IF_CONFIG_SMALL(profiles),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(vc1_decode_update_thread_context)
 };
 
 #if CONFIG_WMV3_DECODER
@@ -5808,10 +5943,11 @@ AVCodec ff_wmv3_decoder = {
     .close          = ff_vc1_decode_end,
     .decode         = vc1_decode_frame,
     .flush          = ff_mpeg_flush,
-    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_DELAY,
+    .capabilities   = CODEC_CAP_DR1 | CODEC_CAP_DELAY | CODEC_CAP_FRAME_THREADS,
     .long_name      = NULL_IF_CONFIG_SMALL("Windows Media Video 9"),
     .pix_fmts       = ff_hwaccel_pixfmt_list_420,
-    .profiles       = NULL_IF_CONFIG_SMALL(profiles)
+    .profiles       = NULL_IF_CONFIG_SMALL(profiles),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(vc1_decode_update_thread_context)
 };
 #endif
 
@@ -1041,8 +1041,10 @@ void intra_predict(VP8Context *s, VP8ThreadData *td, uint8_t *dst[3],
     uint32_t tr;
 
     // for the first row, we need to run xchg_mb_border to init the top edge to 127
-    // otherwise, skip it if we aren't going to deblock
-    if (!(avctx->flags & CODEC_FLAG_EMU_EDGE && !mb_y) && (s->deblock_filter || !mb_y) && td->thread_nr == 0)
+    // otherwise, skip it if we aren't going to deblock or if the filter job
+    // only filters the row above once this row has been decoded
+    if (!(avctx->flags & CODEC_FLAG_EMU_EDGE && !mb_y) && (s->deblock_filter || !mb_y) &&
+        (td->thread_nr == 0 && !s->filter_job || !mb_y))
         xchg_mb_border(s->top_border[mb_x+1], dst[0], dst[1], dst[2],
                        s->linesize, s->uvlinesize, mb_x, mb_y, s->mb_width,
                        s->filter.simple, 1);
@@ -1148,7 +1150,8 @@ void intra_predict(VP8Context *s, VP8ThreadData *td, uint8_t *dst[3],
     s->hpc.pred8x8[mode](dst[1], s->uvlinesize);
     s->hpc.pred8x8[mode](dst[2], s->uvlinesize);
 
-    if (!(avctx->flags & CODEC_FLAG_EMU_EDGE && !mb_y) && (s->deblock_filter || !mb_y) && td->thread_nr == 0)
+    if (!(avctx->flags & CODEC_FLAG_EMU_EDGE && !mb_y) && (s->deblock_filter || !mb_y) &&
+        (td->thread_nr == 0 && !s->filter_job || !mb_y))
         xchg_mb_border(s->top_border[mb_x+1], dst[0], dst[1], dst[2],
                        s->linesize, s->uvlinesize, mb_x, mb_y, s->mb_width,
                        s->filter.simple, 0);
@@ -1675,6 +1678,8 @@ static void vp8_decode_mb_row_no_filter(AVCodecContext *avctx, void *tdata,
     int num_jobs = s->num_jobs;
     AVFrame *curframe = s->curframe, *prev_frame = s->prev_frame;
     VP56RangeCoder *c = &s->coeff_partition[mb_y & (s->num_coeff_partitions-1)];
+    VP8FilterStrength *filter_strength = s->filter_job ? s->thread_data[mb_y & 1].filter_strength
+                                                       : td->filter_strength;
     VP8Macroblock *mb;
     uint8_t *dst[3] = {
         curframe->data[0] + 16*mb_y*s->linesize,
@@ -1708,8 +1713,13 @@ static void vp8_decode_mb_row_no_filter(AVCodecContext *avctx, void *tdata,
     s->mv_max.x = ((s->mb_width  - 1) << 6) + MARGIN;
 
     for (mb_x = 0; mb_x < s->mb_width; mb_x++, mb_xy++, mb++) {
-        // Wait for previous thread to read mb_x+2, and reach mb_y-1.
-        if (prev_td != td) {
+        if (s->filter_job) {
+            // Wait for the filter job to be done with the strength of mb_y-2.
+            if (mb_y > 1) {
+                check_thread_pos(td, prev_td, (s->mb_width+3) + mb_x, mb_y-2);
+            }
+        } else if (prev_td != td) {
+            // Wait for previous thread to read mb_x+2, and reach mb_y-1.
             if (threadnr != 0) {
                 check_thread_pos(td, prev_td, mb_x+1, mb_y-1);
             } else {
@@ -1750,7 +1760,7 @@ static void vp8_decode_mb_row_no_filter(AVCodecContext *avctx, void *tdata,
         }
 
         if (s->deblock_filter)
-            filter_level_for_mb(s, mb, &td->filter_strength[mb_x]);
+            filter_level_for_mb(s, mb, &filter_strength[mb_x]);
 
         if (s->deblock_filter && num_jobs != 1 && threadnr == num_jobs-1) {
             if (s->filter.simple)
@@ -1802,7 +1812,16 @@ static void vp8_filter_mb_row(AVCodecContext *avctx, void *tdata,
 
     for (mb_x = 0; mb_x < s->mb_width; mb_x++, mb++) {
         VP8FilterStrength *f = &td->filter_strength[mb_x];
-        if (prev_td != td) {
+        if (s->filter_job) {
+            // Wait until the row below has used the unfiltered bottom edge.
+            VP8ThreadData *dec_td = &s->thread_data[0];
+            f = &s->thread_data[mb_y & 1].filter_strength[mb_x];
+            if (mb_y < s->mb_height-1) {
+                check_thread_pos(td, dec_td, FFMIN(mb_x+1, s->mb_width-1), mb_y+1);
+            } else {
+                check_thread_pos(td, dec_td, mb_x, mb_y);
+            }
+        } else if (prev_td != td) {
             check_thread_pos(td, prev_td, (mb_x+1) + (s->mb_width+3), mb_y-1);
         }
         if (next_td != td)
@@ -1856,6 +1875,32 @@ static int vp8_decode_mb_row_sliced(AVCodecContext *avctx, void *tdata,
     return 0;
 }
 
+/**
+ * Job 0 decodes all rows, job 1 runs the loop filter on them one row behind.
+ */
+static int vp8_decode_mb_row_pipelined(AVCodecContext *avctx, void *tdata,
+                                       int jobnr, int threadnr)
+{
+    VP8Context *s = avctx->priv_data;
+    VP8ThreadData *td = &s->thread_data[jobnr];
+    VP8ThreadData *next_td = NULL, *prev_td = NULL;
+    int mb_y, num_jobs = s->num_jobs;
+    td->thread_nr = jobnr;
+    for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
+        td->thread_mb_pos = mb_y<<16;
+        if (jobnr) {
+            vp8_filter_mb_row(avctx, tdata, jobnr, jobnr);
+        } else {
+            vp8_decode_mb_row_no_filter(avctx, tdata, jobnr, jobnr);
+            s->mv_min.y -= 64;
+            s->mv_max.y -= 64;
+        }
+        update_pos(td, mb_y, INT_MAX & 0xFFFF);
+    }
+
+    return 0;
+}
+
 static int vp8_decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
                             AVPacket *avpkt)
 {
@@ -1983,6 +2028,13 @@ static int vp8_decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
         num_jobs = 1;
     else
         num_jobs = FFMIN(s->num_coeff_partitions, avctx->thread_count);
+    /* Rows of a single token partition can't be decoded in parallel, but the
+     * loop filter can run beside the decoding. Both jobs must run at the same
+     * time, which a pool shared with other contexts doesn't guarantee. */
+    s->filter_job = num_jobs == 1 && s->deblock_filter && !avctx->shared_threads &&
+                    avctx->active_thread_type == FF_THREAD_SLICE && avctx->thread_count > 1;
+    if (s->filter_job)
+        num_jobs = 2;
     s->num_jobs   = num_jobs;
     s->curframe   = curframe;
     s->prev_frame = prev_frame;
@@ -1992,7 +2044,8 @@ static int vp8_decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
         s->thread_data[i].thread_mb_pos = 0;
         s->thread_data[i].wait_mb_pos = INT_MAX;
     }
-    avctx->execute2(avctx, vp8_decode_mb_row_sliced, s->thread_data, NULL, num_jobs);
+    avctx->execute2(avctx, s->filter_job ? vp8_decode_mb_row_pipelined : vp8_decode_mb_row_sliced,
+                    s->thread_data, NULL, num_jobs);
 
     ff_thread_report_progress(curframe, INT_MAX, 0);
     memcpy(&s->framep[0], &s->next_framep[0], sizeof(s->framep[0]) * 4);
@@ -265,6 +265,12 @@ typedef struct VP8Context {
     int num_maps_to_be_freed;
     int maps_are_invalid;
     int num_jobs;
+    /**
+     * With a single token partition, the rows can only be decoded by one job.
+     * If set, a second job runs the loop filter a row behind the decoding job;
+     * filter_strength of thread_data[mb_y & 1] then holds the row mb_y.
+     */
+    int filter_job;
     /**
      * This describes the macroblock memory layout.
      * 0 -> Only width+height*2+1 macroblocks allocated (frame/single thread).
@@ -0,0 +1,154 @@
+/*
+ * SIMD optimized AAC encoder quantization functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavcodec/aacenc.h"
+
+#if HAVE_INLINE_ASM
+
+DECLARE_ALIGNED(32, static const uint32_t, abs_mask)[8] = {
+    0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff,
+    0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff,
+};
+DECLARE_ALIGNED(16, static const float, round_bias)[4] = {
+    0.4054f, 0.4054f, 0.4054f, 0.4054f,
+};
+
+#if HAVE_SSE_INLINE
+static void abs_pow34_sse(float *out, const float *in, const int size)
+{
+    x86_reg i = -4 * size;
+
+    __asm__ volatile (
+        "movaps   %3,       %%xmm2      \n\t"
+        "1:                             \n\t"
+        "movups   (%2, %0), %%xmm0      \n\t"
+        "andps    %%xmm2,   %%xmm0      \n\t"
+        "sqrtps   %%xmm0,   %%xmm1      \n\t"
+        "mulps    %%xmm1,   %%xmm0      \n\t"
+        "sqrtps   %%xmm0,   %%xmm0      \n\t"
+        "movups   %%xmm0,   (%1, %0)    \n\t"
+        "add      $16,      %0          \n\t"
+        "jl       1b                    \n\t"
+        : "+&r"(i)
+        : "r"(out + size), "r"(in + size), "m"(*abs_mask)
+        : XMM_CLOBBERS("xmm0", "xmm1", "xmm2",)
+          "memory"
+    );
+}
+#endif /* HAVE_SSE_INLINE */
+
+#if HAVE_SSE2_INLINE
+static void quantize_bands_sse2(int *out, const float *in, const float *scaled,
+                                int size, float Q34, int is_signed, int maxval)
+{
+    x86_reg i = -4 * size;
+    float fmaxval = maxval;
+    int sign_mask = is_signed ? -1 : 0;
+
+    __asm__ volatile (
+        "movss     %4,       %%xmm3     \n\t"
+        "movss     %5,       %%xmm4     \n\t"
+        "movd      %6,       %%xmm5     \n\t"
+        "movaps    %7,       %%xmm6     \n\t"
+        "shufps    $0, %%xmm3, %%xmm3   \n\t"
+        "shufps    $0, %%xmm4, %%xmm4   \n\t"
+        "pshufd    $0, %%xmm5, %%xmm5   \n\t"
+        "1:                             \n\t"
+        "movups    (%3, %0), %%xmm0     \n\t"
+        "movups    (%2, %0), %%xmm1     \n\t"
+        "mulps     %%xmm3,   %%xmm0     \n\t"
+        "psrad     $31,      %%xmm1     \n\t"
+        "addps     %%xmm6,   %%xmm0     \n\t"
+        "pand      %%xmm5,   %%xmm1     \n\t"
+        "minps     %%xmm4,   %%xmm0     \n\t"
+        "cvttps2dq %%xmm0,   %%xmm0     \n\t"
+        "pxor      %%xmm1,   %%xmm0     \n\t"
+        "psubd     %%xmm1,   %%xmm0     \n\t"
+        "movdqu    %%xmm0,   (%1, %0)   \n\t"
+        "add       $16,      %0         \n\t"
+        "jl        1b                   \n\t"
+        : "+&r"(i)
+        : "r"(out + size), "r"(in + size), "r"(scaled + size),
+          "m"(Q34), "m"(fmaxval), "m"(sign_mask), "m"(*round_bias)
+        : XMM_CLOBBERS("xmm0", "xmm1", "xmm3", "xmm4", "xmm5", "xmm6",)
+          "memory"
+    );
+}
+#endif /* HAVE_SSE2_INLINE */
+
+#if HAVE_AVX_INLINE
+static void abs_pow34_avx(float *out, const float *in, const int size)
+{
+    x86_reg i = -4 * size;
+
+    __asm__ volatile (
+        "vmovaps  %3,       %%ymm2              \n\t"
+        "test     $16,      %0                  \n\t"
+        "jz       1f                            \n\t"
+        "vandps   (%2, %0), %%xmm2, %%xmm0      \n\t"
+        "vsqrtps  %%xmm0,   %%xmm1              \n\t"
+        "vmulps   %%xmm1,   %%xmm0, %%xmm0      \n\t"
+        "vsqrtps  %%xmm0,   %%xmm0              \n\t"
+        "vmovups  %%xmm0,   (%1, %0)            \n\t"
+        "add      $16,      %0                  \n\t"
+        "jz       2f                            \n\t"
+        "1:                                     \n\t"
+        "vandps   (%2, %0), %%ymm2, %%ymm0      \n\t"
+        "vsqrtps  %%ymm0,   %%ymm1              \n\t"
+        "vmulps   %%ymm1,   %%ymm0, %%ymm0      \n\t"
+        "vsqrtps  %%ymm0,   %%ymm0              \n\t"
+        "vmovups  %%ymm0,   (%1, %0)            \n\t"
+        "add      $32,      %0                  \n\t"
+        "jl       1b                            \n\t"
+        "2:                                     \n\t"
+        "vzeroupper                             \n\t"
+        : "+&r"(i)
+        : "r"(out + size), "r"(in + size), "m"(*abs_mask)
+        : XMM_CLOBBERS("xmm0", "xmm1", "xmm2",)
+          "memory"
+    );
+}
+#endif /* HAVE_AVX_INLINE */
+
+#endif /* HAVE_INLINE_ASM */
+
+av_cold void ff_aac_coder_init_x86(AACEncContext *s)
+{
+#if HAVE_INLINE_ASM
+    int mm_flags = av_get_cpu_flags();
+
+#if HAVE_SSE_INLINE
+    if (mm_flags & AV_CPU_FLAG_SSE)
+        s->abs_pow34   = abs_pow34_sse;
+#endif
+#if HAVE_SSE2_INLINE
+    if (mm_flags & AV_CPU_FLAG_SSE2)
+        s->quant_bands = quantize_bands_sse2;
+#endif
+#if HAVE_AVX_INLINE
+    if (mm_flags & AV_CPU_FLAG_AVX)
+        s->abs_pow34   = abs_pow34_avx;
+#endif
+#endif /* HAVE_INLINE_ASM */
+}
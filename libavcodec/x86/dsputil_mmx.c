@@ -1655,6 +1655,60 @@ void ff_avg_rv40_qpel16_mc33_mmx(uint8_t *dst, uint8_t *src, int stride)
   avg_pixels16_xy2_mmx(dst, src, stride, 16);
 }
 
+static void gmc1_mmx(uint8_t *dst, uint8_t *src, int stride, int h,
+                     int x16, int y16, int rounder)
+{
+    /* the weights sum to 256, so the weighted sum of 4 pixels plus the
+     * rounder fits in an unsigned word */
+    const uint16_t A4[4] = { (16 - x16) * (16 - y16), (16 - x16) * (16 - y16),
+                             (16 - x16) * (16 - y16), (16 - x16) * (16 - y16) };
+    const uint16_t B4[4] = { x16 * (16 - y16), x16 * (16 - y16),
+                             x16 * (16 - y16), x16 * (16 - y16) };
+    const uint16_t C4[4] = { (16 - x16) * y16, (16 - x16) * y16,
+                             (16 - x16) * y16, (16 - x16) * y16 };
+    const uint16_t D4[4] = { x16 * y16, x16 * y16, x16 * y16, x16 * y16 };
+    const uint16_t r4[4] = { rounder, rounder, rounder, rounder };
+
+    __asm__ volatile (
+        "pxor       %%mm7, %%mm7    \n\t"
+        "movq          %4, %%mm4    \n\t"
+        "movq          %5, %%mm5    \n\t"
+        "movq          %6, %%mm6    \n\t"
+        "1:                         \n\t"
+#define GMC1_4(off)                                         \
+        "movd   "#off"(%1),     %%mm0 \n\t"                 \
+        "movd 1+"#off"(%1),     %%mm1 \n\t"                 \
+        "movd   "#off"(%1, %3), %%mm2 \n\t"                 \
+        "movd 1+"#off"(%1, %3), %%mm3 \n\t"                 \
+        "punpcklbw  %%mm7, %%mm0    \n\t"                   \
+        "punpcklbw  %%mm7, %%mm1    \n\t"                   \
+        "punpcklbw  %%mm7, %%mm2    \n\t"                   \
+        "punpcklbw  %%mm7, %%mm3    \n\t"                   \
+        "pmullw     %%mm4, %%mm0    \n\t" /* src[0] * A */  \
+        "pmullw     %%mm5, %%mm1    \n\t" /* src[1] * B */  \
+        "pmullw     %%mm6, %%mm2    \n\t" /* src[stride] * C */ \
+        "pmullw        %7, %%mm3    \n\t" /* src[stride + 1] * D */ \
+        "paddw         %8, %%mm0    \n\t"                   \
+        "paddw      %%mm1, %%mm0    \n\t"                   \
+        "paddw      %%mm3, %%mm2    \n\t"                   \
+        "paddw      %%mm2, %%mm0    \n\t"                   \
+        "psrlw         $8, %%mm0    \n\t"                   \
+        "packuswb   %%mm0, %%mm0    \n\t"                   \
+        "movd       %%mm0, "#off"(%0) \n\t"
+        GMC1_4(0)
+        GMC1_4(4)
+#undef GMC1_4
+        "add           %3, %0       \n\t"
+        "add           %3, %1       \n\t"
+        "decl          %2           \n\t"
+        "jnz           1b           \n\t"
+        : "+r"(dst), "+r"(src), "+g"(h)
+        : "r"((x86_reg)stride), "m"(*A4), "m"(*B4), "m"(*C4), "m"(*D4),
+          "m"(*r4)
+        : "memory"
+    );
+}
+
 typedef void emulated_edge_mc_func(uint8_t *dst, const uint8_t *src,
                                    ptrdiff_t linesize, int block_w, int block_h,
                                    int src_x, int src_y, int w, int h);
@@ -2069,106 +2123,6 @@ static void vorbis_inverse_coupling_sse(float *mag, float *ang, int blocksize)
     }
 }
 
-#if HAVE_6REGS
-static void vector_fmul_window_3dnowext(float *dst, const float *src0,
-                                        const float *src1, const float *win,
-                                        int len)
-{
-    x86_reg i = -len * 4;
-    x86_reg j =  len * 4 - 8;
-    __asm__ volatile (
-        "1:                             \n"
-        "pswapd (%5, %1), %%mm1         \n"
-        "movq   (%5, %0), %%mm0         \n"
-        "pswapd (%4, %1), %%mm5         \n"
-        "movq   (%3, %0), %%mm4         \n"
-        "movq      %%mm0, %%mm2         \n"
-        "movq      %%mm1, %%mm3         \n"
-        "pfmul     %%mm4, %%mm2         \n" // src0[len + i] * win[len + i]
-        "pfmul     %%mm5, %%mm3         \n" // src1[j]       * win[len + j]
-        "pfmul     %%mm4, %%mm1         \n" // src0[len + i] * win[len + j]
-        "pfmul     %%mm5, %%mm0         \n" // src1[j]       * win[len + i]
-        "pfadd     %%mm3, %%mm2         \n"
-        "pfsub     %%mm0, %%mm1         \n"
-        "pswapd    %%mm2, %%mm2         \n"
-        "movq      %%mm1, (%2, %0)      \n"
-        "movq      %%mm2, (%2, %1)      \n"
-        "sub          $8, %1            \n"
-        "add          $8, %0            \n"
-        "jl           1b                \n"
-        "femms                          \n"
-        : "+r"(i), "+r"(j)
-        : "r"(dst + len), "r"(src0 + len), "r"(src1), "r"(win + len)
-    );
-}
-
-static void vector_fmul_window_sse(float *dst, const float *src0,
-                                   const float *src1, const float *win, int len)
-{
-    x86_reg i = -len * 4;
-    x86_reg j =  len * 4 - 16;
-    __asm__ volatile (
-        "1:                             \n"
-        "movaps      (%5, %1), %%xmm1   \n"
-        "movaps      (%5, %0), %%xmm0   \n"
-        "movaps      (%4, %1), %%xmm5   \n"
-        "movaps      (%3, %0), %%xmm4   \n"
-        "shufps $0x1b, %%xmm1, %%xmm1   \n"
-        "shufps $0x1b, %%xmm5, %%xmm5   \n"
-        "movaps        %%xmm0, %%xmm2   \n"
-        "movaps        %%xmm1, %%xmm3   \n"
-        "mulps         %%xmm4, %%xmm2   \n" // src0[len + i] * win[len + i]
-        "mulps         %%xmm5, %%xmm3   \n" // src1[j]       * win[len + j]
-        "mulps         %%xmm4, %%xmm1   \n" // src0[len + i] * win[len + j]
-        "mulps         %%xmm5, %%xmm0   \n" // src1[j]       * win[len + i]
-        "addps         %%xmm3, %%xmm2   \n"
-        "subps         %%xmm0, %%xmm1   \n"
-        "shufps $0x1b, %%xmm2, %%xmm2   \n"
-        "movaps        %%xmm1, (%2, %0) \n"
-        "movaps        %%xmm2, (%2, %1) \n"
-        "sub              $16, %1       \n"
-        "add              $16, %0       \n"
-        "jl                1b           \n"
-        : "+r"(i), "+r"(j)
-        : "r"(dst + len), "r"(src0 + len), "r"(src1), "r"(win + len)
-    );
-}
-#endif /* HAVE_6REGS */
-
-static void vector_clipf_sse(float *dst, const float *src,
-                             float min, float max, int len)
-{
-    x86_reg i = (len - 16) * 4;
-    __asm__ volatile (
-        "movss          %3, %%xmm4      \n\t"
-        "movss          %4, %%xmm5      \n\t"
-        "shufps $0, %%xmm4, %%xmm4      \n\t"
-        "shufps $0, %%xmm5, %%xmm5      \n\t"
-        "1:                             \n\t"
-        "movaps   (%2, %0), %%xmm0      \n\t" // 3/1 on intel
-        "movaps 16(%2, %0), %%xmm1      \n\t"
-        "movaps 32(%2, %0), %%xmm2      \n\t"
-        "movaps 48(%2, %0), %%xmm3      \n\t"
-        "maxps      %%xmm4, %%xmm0      \n\t"
-        "maxps      %%xmm4, %%xmm1      \n\t"
-        "maxps      %%xmm4, %%xmm2      \n\t"
-        "maxps      %%xmm4, %%xmm3      \n\t"
-        "minps      %%xmm5, %%xmm0      \n\t"
-        "minps      %%xmm5, %%xmm1      \n\t"
-        "minps      %%xmm5, %%xmm2      \n\t"
-        "minps      %%xmm5, %%xmm3      \n\t"
-        "movaps     %%xmm0,   (%1, %0)  \n\t"
-        "movaps     %%xmm1, 16(%1, %0)  \n\t"
-        "movaps     %%xmm2, 32(%1, %0)  \n\t"
-        "movaps     %%xmm3, 48(%1, %0)  \n\t"
-        "sub           $64, %0          \n\t"
-        "jge            1b              \n\t"
-        : "+&r"(i)
-        : "r"(dst), "r"(src), "m"(min), "m"(max)
-        : "memory"
-    );
-}
-
 #endif /* HAVE_INLINE_ASM */
 
 int32_t ff_scalarproduct_int16_mmxext(const int16_t *v1, const int16_t *v2,
@@ -2201,6 +2155,9 @@ void ff_apply_window_int16_ssse3_atom(int16_t *output, const int16_t *input,
 void ff_bswap32_buf_ssse3(uint32_t *dst, const uint32_t *src, int w);
 void ff_bswap32_buf_sse2(uint32_t *dst, const uint32_t *src, int w);
 
+void ff_simple_idct10_put_sse2(uint8_t *dest, int line_size, DCTELEM *block);
+void ff_simple_idct10_put_avx (uint8_t *dest, int line_size, DCTELEM *block);
+
 void ff_add_hfyu_median_prediction_mmxext(uint8_t *dst, const uint8_t *top,
                                           const uint8_t *diff, int w,
                                           int *left, int *left_top);
@@ -2209,18 +2166,6 @@ int  ff_add_hfyu_left_prediction_ssse3(uint8_t *dst, const uint8_t *src,
 int  ff_add_hfyu_left_prediction_sse4(uint8_t *dst, const uint8_t *src,
                                       int w, int left);
 
-float ff_scalarproduct_float_sse(const float *v1, const float *v2, int order);
-
-void ff_vector_fmul_reverse_sse(float *dst, const float *src0,
-                                const float *src1, int len);
-void ff_vector_fmul_reverse_avx(float *dst, const float *src0,
-                                const float *src1, int len);
-
-void ff_vector_fmul_add_sse(float *dst, const float *src0, const float *src1,
-                            const float *src2, int len);
-void ff_vector_fmul_add_avx(float *dst, const float *src0, const float *src1,
-                            const float *src2, int len);
-
 void ff_vector_clip_int32_mmx     (int32_t *dst, const int32_t *src,
                                    int32_t min, int32_t max, unsigned int len);
 void ff_vector_clip_int32_sse2    (int32_t *dst, const int32_t *src,
@@ -2301,6 +2246,8 @@ static void dsputil_init_mmx(DSPContext *c, AVCodecContext *avctx, int mm_flags)
         SET_HPEL_FUNCS(put_no_rnd, 1,  8, mmx);
         SET_HPEL_FUNCS(avg,        1,  8, mmx);
         SET_HPEL_FUNCS(avg_no_rnd, 1,  8, mmx);
+
+        c->gmc1 = gmc1_mmx;
     }
 
 #if ARCH_X86_32 || !HAVE_YASM
@@ -2481,14 +2428,6 @@ static void dsputil_init_3dnow(DSPContext *c, AVCodecContext *avctx,
 #endif /* HAVE_YASM */
 }
 
-static void dsputil_init_3dnowext(DSPContext *c, AVCodecContext *avctx,
-                                  int mm_flags)
-{
-#if HAVE_AMD3DNOWEXT_INLINE && HAVE_6REGS
-    c->vector_fmul_window  = vector_fmul_window_3dnowext;
-#endif
-}
-
 static void dsputil_init_sse(DSPContext *c, AVCodecContext *avctx, int mm_flags)
 {
     const int high_bit_depth = avctx->bits_per_raw_sample > 8;
@@ -2503,19 +2442,9 @@ static void dsputil_init_sse(DSPContext *c, AVCodecContext *avctx, int mm_flags)
     }
 
     c->vorbis_inverse_coupling = vorbis_inverse_coupling_sse;
-
-#if HAVE_6REGS
-    c->vector_fmul_window = vector_fmul_window_sse;
-#endif
-
-    c->vector_clipf = vector_clipf_sse;
 #endif /* HAVE_INLINE_ASM */
 
 #if HAVE_YASM
-    c->vector_fmul_reverse = ff_vector_fmul_reverse_sse;
-    c->vector_fmul_add     = ff_vector_fmul_add_sse;
-
-    c->scalarproduct_float          = ff_scalarproduct_float_sse;
     c->butterflies_float_interleave = ff_butterflies_float_interleave_sse;
 
 #if HAVE_INLINE_ASM
@@ -2524,6 +2453,16 @@ static void dsputil_init_sse(DSPContext *c, AVCodecContext *avctx, int mm_flags)
 #endif /* HAVE_YASM */
 }
 
+/* The SIMD 10-bit IDCT is not bitexact, so only use it for the default IDCT
+ * when bitexact output is not requested. It keeps FF_NO_IDCT_PERM and only
+ * replaces idct_put, which is all the intra-only 10-bit decoders use. */
+#define IDCT10_SIMD(avctx)                                      \
+    ((avctx)->bits_per_raw_sample == 10 && !(avctx)->lowres &&  \
+     !((avctx)->flags & CODEC_FLAG_BITEXACT) &&                 \
+     ((avctx)->idct_algo == FF_IDCT_AUTO   ||                   \
+      (avctx)->idct_algo == FF_IDCT_SIMPLE ||                   \
+      (avctx)->idct_algo == FF_IDCT_SIMPLEMMX))
+
 static void dsputil_init_sse2(DSPContext *c, AVCodecContext *avctx,
                               int mm_flags)
 {
@@ -2595,6 +2534,11 @@ static void dsputil_init_sse2(DSPContext *c, AVCodecContext *avctx,
         c->apply_window_int16 = ff_apply_window_int16_round_sse2;
     }
     c->bswap_buf = ff_bswap32_buf_sse2;
+
+#if ARCH_X86_64
+    if (IDCT10_SIMD(avctx))
+        c->idct_put = ff_simple_idct10_put_sse2;
+#endif
 #endif /* HAVE_SSE2_EXTERNAL */
 }
 
@@ -2670,10 +2614,12 @@ static void dsputil_init_avx(DSPContext *c, AVCodecContext *avctx, int mm_flags)
             c->put_h264_chroma_pixels_tab[0] = ff_put_h264_chroma_mc8_10_avx;
             c->avg_h264_chroma_pixels_tab[0] = ff_avg_h264_chroma_mc8_10_avx;
         }
+#if ARCH_X86_64
+        if (IDCT10_SIMD(avctx))
+            c->idct_put = ff_simple_idct10_put_avx;
+#endif
     }
     c->butterflies_float_interleave = ff_butterflies_float_interleave_avx;
-    c->vector_fmul_reverse = ff_vector_fmul_reverse_avx;
-    c->vector_fmul_add = ff_vector_fmul_add_avx;
 #endif /* HAVE_AVX_EXTERNAL */
 }
 
@@ -2737,9 +2683,6 @@ void ff_dsputil_init_mmx(DSPContext *c, AVCodecContext *avctx)
     if (mm_flags & AV_CPU_FLAG_3DNOW)
         dsputil_init_3dnow(c, avctx, mm_flags);
 
-    if (mm_flags & AV_CPU_FLAG_3DNOWEXT)
-        dsputil_init_3dnowext(c, avctx, mm_flags);
-
     if (mm_flags & AV_CPU_FLAG_SSE)
         dsputil_init_sse(c, avctx, mm_flags);
 
@@ -109,11 +109,32 @@ static void horizontal_compose_haar1i##ext(IDWTELEM *b, IDWTELEM *tmp, int w)\
 }\
 \
 
+#define COMPOSE_DAUB97_VERTICAL(ext, align, step) \
+void ff_vertical_compose_daub97i##step##ext(IDWTELEM *b0, IDWTELEM *b1, IDWTELEM *b2, int width); \
+\
+static void vertical_compose_daub97i##step##ext(IDWTELEM *b0, IDWTELEM *b1, IDWTELEM *b2, int width) \
+{ \
+    int i, width_align = width&~(align-1); \
+\
+    for(i=width_align; i<width; i++) \
+        b1[i] = COMPOSE_DAUB97i##step(b0[i], b1[i], b2[i]); \
+\
+    ff_vertical_compose_daub97i##step##ext(b0, b1, b2, width_align); \
+}
+
+#define COMPOSE_DAUB97(ext, align) \
+COMPOSE_DAUB97_VERTICAL(ext, align, L0) \
+COMPOSE_DAUB97_VERTICAL(ext, align, H0) \
+COMPOSE_DAUB97_VERTICAL(ext, align, L1) \
+COMPOSE_DAUB97_VERTICAL(ext, align, H1)
+
 #if HAVE_YASM
 #if !ARCH_X86_64
 COMPOSE_VERTICAL(_mmx, 4)
+COMPOSE_DAUB97(_mmx, 4)
 #endif
 COMPOSE_VERTICAL(_sse2, 8)
+COMPOSE_DAUB97(_sse2, 8)
 
 
 void ff_horizontal_compose_dd97i_ssse3(IDWTELEM *b, IDWTELEM *tmp, int w);
@@ -161,6 +182,12 @@ void ff_spatial_idwt_init_mmx(DWTContext *d, enum dwt_type type)
         d->vertical_compose   = (void*)vertical_compose_haar_mmx;
         d->horizontal_compose = horizontal_compose_haar1i_mmx;
         break;
+    case DWT_DIRAC_DAUB9_7:
+        d->vertical_compose_l0 = (void*)vertical_compose_daub97iL0_mmx;
+        d->vertical_compose_h0 = (void*)vertical_compose_daub97iH0_mmx;
+        d->vertical_compose_l1 = (void*)vertical_compose_daub97iL1_mmx;
+        d->vertical_compose_h1 = (void*)vertical_compose_daub97iH1_mmx;
+        break;
     }
 #endif
 
@@ -188,6 +215,12 @@ void ff_spatial_idwt_init_mmx(DWTContext *d, enum dwt_type type)
         d->vertical_compose   = (void*)vertical_compose_haar_sse2;
         d->horizontal_compose = horizontal_compose_haar1i_sse2;
         break;
+    case DWT_DIRAC_DAUB9_7:
+        d->vertical_compose_l0 = (void*)vertical_compose_daub97iL0_sse2;
+        d->vertical_compose_h0 = (void*)vertical_compose_daub97iH0_sse2;
+        d->vertical_compose_l1 = (void*)vertical_compose_daub97iL1_sse2;
+        d->vertical_compose_h1 = (void*)vertical_compose_daub97iH1_sse2;
+        break;
     }
 
     if (!(mm_flags & AV_CPU_FLAG_SSSE3))
@@ -27,6 +27,12 @@ pw_2: times 8 dw 2
 pw_8: times 8 dw 8
 pw_16: times 8 dw 16
 pw_1991: times 4 dw 9,-1
+pw_113:  times 8 dw 113
+pw_217:  times 8 dw 217
+pw_1817: times 8 dw 1817
+pw_6497: times 8 dw 6497
+pd_64:   times 4 dd 64
+pd_2048: times 4 dd 2048
 
 section .text
 
@@ -146,6 +152,42 @@ cglobal vertical_compose_haar_%1, 3,4,3, b0, b1, width
     REP_RET
 %endmacro
 
+; b1 = b1 %6 ((%3*(b0 + b2) + %4) >> %5), the sum is computed in 32 bits
+; as in C by multiplying the interleaved b0, b2 pairs with pmaddwd
+%macro DAUB97_VERTICAL 6
+; void vertical_compose_daub97i(IDWTELEM *b0, IDWTELEM *b1, IDWTELEM *b2,
+;                               int width)
+cglobal vertical_compose_daub97i%2_%1, 4,4,5, b0, b1, b2, width
+    mova    m3, [%3]
+    mova    m4, [%4]
+.loop:
+    sub     widthq, mmsize/2
+    mova    m0, [b0q+2*widthq]
+    mova    m1, [b2q+2*widthq]
+    mova    m2, m0
+    punpcklwd m0, m1
+    punpckhwd m2, m1
+    pmaddwd m0, m3
+    pmaddwd m2, m3
+    paddd   m0, m4
+    paddd   m2, m4
+    psrad   m0, %5
+    psrad   m2, %5
+    packssdw m0, m2
+    mova    m1, [b1q+2*widthq]
+    %6      m1, m0
+    mova    [b1q+2*widthq], m1
+    jg      .loop
+    REP_RET
+%endmacro
+
+%macro DAUB97_VERTICAL_ALL 1
+DAUB97_VERTICAL %1, L1, pw_1817, pd_2048, 12, psubw
+DAUB97_VERTICAL %1, H1, pw_113,  pd_64,    7, psubw
+DAUB97_VERTICAL %1, L0, pw_217,  pd_2048, 12, paddw
+DAUB97_VERTICAL %1, H0, pw_6497, pd_2048, 12, paddw
+%endmacro
+
 ; extend the left and right edges of the tmp array by %1 and %2 respectively
 %macro EDGE_EXTENSION 3
     mov     %3, [tmpq]
@@ -280,6 +322,7 @@ cglobal horizontal_compose_dd97i_ssse3, 3,6,8, b, tmp, w, x, w2, b_w2
 %if ARCH_X86_64 == 0
 INIT_MMX
 COMPOSE_VERTICAL mmx
+DAUB97_VERTICAL_ALL mmx
 HAAR_HORIZONTAL mmx, 0
 HAAR_HORIZONTAL mmx, 1
 %endif
@@ -287,5 +330,6 @@ HAAR_HORIZONTAL mmx, 1
 ;;INIT_XMM
 INIT_XMM
 COMPOSE_VERTICAL sse2
+DAUB97_VERTICAL_ALL sse2
 HAAR_HORIZONTAL sse2, 0
 HAAR_HORIZONTAL sse2, 1
@@ -315,3 +315,92 @@ cglobal h264_biweight_8, 7, 8, 8
     dec        r3d
     jnz .nextrow
     REP_RET
+
+; AVX2 versions, the two 128-bit lanes hold two consecutive rows.
+; The shift counts have to stay in xmm registers, so the registers are
+; named explicitly instead of using the mN aliases.
+%if HAVE_AVX2_EXTERNAL
+INIT_YMM avx2
+cglobal h264_weight_16, 6, 6, 8
+    add        r5, r5
+    inc        r5
+    vmovd      xmm3, r4d
+    vmovd      xmm5, r5d
+    vmovd      xmm6, r3d
+    vpslld     xmm5, xmm5, xmm6
+    vpsrld     xmm5, xmm5, 1
+    vpbroadcastw ymm3, xmm3
+    vpbroadcastw ymm5, xmm5
+    vpxor      ymm7, ymm7, ymm7
+    sar        r2d, 1
+    lea        r3, [r1*2]
+.nextrow:
+    vmovdqu    xmm0, [r0]
+    vinserti128 ymm0, ymm0, [r0+r1], 1
+    vpunpckhbw ymm1, ymm0, ymm7
+    vpunpcklbw ymm0, ymm0, ymm7
+    vpmullw    ymm0, ymm0, ymm3
+    vpmullw    ymm1, ymm1, ymm3
+    vpaddsw    ymm0, ymm0, ymm5
+    vpaddsw    ymm1, ymm1, ymm5
+    vpsraw     ymm0, ymm0, xmm6
+    vpsraw     ymm1, ymm1, xmm6
+    vpackuswb  ymm0, ymm0, ymm1
+    vmovdqa    [r0], xmm0
+    vextracti128 [r0+r1], ymm0, 1
+    add        r0, r3
+    dec        r2d
+    jnz .nextrow
+    RET
+
+cglobal h264_biweight_16, 7, 8, 8
+%if ARCH_X86_64
+%define off_regd r7d
+%else
+%define off_regd r3d
+%endif
+    mov  off_regd, r7m
+    add  off_regd, 1
+    or   off_regd, 1
+    add        r4, 1
+    cmp        r5, 128
+     jne .normal
+    sar        r5, 1
+    sar        r6, 1
+    sar  off_regd, 1
+    sub        r4, 1
+.normal
+    vmovd      xmm4, r5d
+    vmovd      xmm0, r6d
+    vmovd      xmm5, off_regd
+    vmovd      xmm6, r4d
+    vpslld     xmm5, xmm5, xmm6
+    vpsrld     xmm5, xmm5, 1
+    vpunpcklbw xmm4, xmm4, xmm0
+    vpbroadcastw ymm4, xmm4
+    vpbroadcastw ymm5, xmm5
+    movifnidn r3d, r3m
+    sar       r3d, 1
+    lea        r4, [r2*2]
+.nextrow:
+    vmovdqu    xmm0, [r0]
+    vmovdqu    xmm1, [r1]
+    vinserti128 ymm0, ymm0, [r0+r2], 1
+    vinserti128 ymm1, ymm1, [r1+r2], 1
+    vpunpckhbw ymm2, ymm0, ymm1
+    vpunpcklbw ymm0, ymm0, ymm1
+    vpmaddubsw ymm0, ymm0, ymm4
+    vpmaddubsw ymm2, ymm2, ymm4
+    vpaddsw    ymm0, ymm0, ymm5
+    vpaddsw    ymm2, ymm2, ymm5
+    vpsraw     ymm0, ymm0, xmm6
+    vpsraw     ymm2, ymm2, xmm6
+    vpackuswb  ymm0, ymm0, ymm2
+    vmovdqa    [r0], xmm0
+    vextracti128 [r0+r2], ymm0, 1
+    add        r0, r4
+    add        r1, r4
+    dec        r3d
+    jnz .nextrow
+    RET
+%endif ; HAVE_AVX2_EXTERNAL
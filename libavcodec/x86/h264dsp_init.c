@@ -178,6 +178,8 @@ void ff_h264_biweight_ ## W ## _ ## OPT(uint8_t *dst, uint8_t *src,     \
 H264_BIWEIGHT_MMX_SSE(16)
 H264_BIWEIGHT_MMX_SSE(8)
 H264_BIWEIGHT_MMX(4)
+H264_WEIGHT(16, avx2)
+H264_BIWEIGHT(16, avx2)
 
 #define H264_WEIGHT_10(W, DEPTH, OPT)                                   \
 void ff_h264_weight_ ## W ## _ ## DEPTH ## _ ## OPT(uint8_t *dst,       \
@@ -291,6 +293,10 @@ void ff_h264dsp_init_x86(H264DSPContext *c, const int bit_depth,
                     c->h264_v_loop_filter_luma_intra = ff_deblock_v_luma_intra_8_avx;
                     c->h264_h_loop_filter_luma_intra = ff_deblock_h_luma_intra_8_avx;
                 }
+                if (EXTERNAL_AVX2(mm_flags)) {
+                    c->weight_h264_pixels_tab[0]   = ff_h264_weight_16_avx2;
+                    c->biweight_h264_pixels_tab[0] = ff_h264_biweight_16_avx2;
+                }
             }
         }
     } else if (bit_depth == 10) {
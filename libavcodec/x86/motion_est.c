@@ -121,6 +121,53 @@ static int sad16_sse2(void *v, uint8_t *blk2, uint8_t *blk1, int stride, int h)
     return ret;
 }
 
+static void sad16_x4_sse2(int scores[4], uint8_t *src, uint8_t *ref, int stride)
+{
+    int h = 16;
+
+    ref -= stride;
+    __asm__ volatile(
+        "pxor %%xmm4, %%xmm4            \n\t"
+        "pxor %%xmm5, %%xmm5            \n\t"
+        "pxor %%xmm6, %%xmm6            \n\t"
+        "pxor %%xmm7, %%xmm7            \n\t"
+        ".p2align 4                     \n\t"
+        "1:                             \n\t"
+        "movdqu -1(%2, %3), %%xmm0      \n\t"
+        "movdqu   (%2),     %%xmm1      \n\t"
+        "movdqu  1(%2, %3), %%xmm2      \n\t"
+        "movdqu   (%2, %3, 2), %%xmm3   \n\t"
+        "psadbw (%1), %%xmm0            \n\t"
+        "psadbw (%1), %%xmm1            \n\t"
+        "psadbw (%1), %%xmm2            \n\t"
+        "psadbw (%1), %%xmm3            \n\t"
+        "paddw %%xmm0, %%xmm4           \n\t"
+        "paddw %%xmm1, %%xmm5           \n\t"
+        "paddw %%xmm2, %%xmm6           \n\t"
+        "paddw %%xmm3, %%xmm7           \n\t"
+        "add %3, %1                     \n\t"
+        "add %3, %2                     \n\t"
+        "sub $1, %0                     \n\t"
+        " jg 1b                         \n\t"
+        "movhlps %%xmm4, %%xmm0         \n\t"
+        "movhlps %%xmm5, %%xmm1         \n\t"
+        "movhlps %%xmm6, %%xmm2         \n\t"
+        "movhlps %%xmm7, %%xmm3         \n\t"
+        "paddw   %%xmm0, %%xmm4         \n\t"
+        "paddw   %%xmm1, %%xmm5         \n\t"
+        "paddw   %%xmm2, %%xmm6         \n\t"
+        "paddw   %%xmm3, %%xmm7         \n\t"
+        "movd    %%xmm4,   (%4)         \n\t"
+        "movd    %%xmm5,  4(%4)         \n\t"
+        "movd    %%xmm6,  8(%4)         \n\t"
+        "movd    %%xmm7, 12(%4)         \n\t"
+        : "+r" (h), "+r" (src), "+r" (ref)
+        : "r" ((x86_reg)stride), "r" (scores)
+        : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",
+                       "xmm4", "xmm5", "xmm6", "xmm7",) "memory"
+    );
+}
+
 static inline void sad8_x2a_mmxext(uint8_t *blk1, uint8_t *blk2,
                                    int stride, int h)
 {
@@ -468,6 +515,7 @@ void ff_dsputil_init_pix_mmx(DSPContext* c, AVCodecContext *avctx)
     }
     if ((mm_flags & AV_CPU_FLAG_SSE2) && !(mm_flags & AV_CPU_FLAG_3DNOW) && avctx->codec_id != AV_CODEC_ID_SNOW) {
         c->sad[0]= sad16_sse2;
+        c->sad16_x4 = sad16_x4_sse2;
     }
 #endif /* HAVE_INLINE_ASM */
 }
@@ -0,0 +1,123 @@
+;******************************************************************************
+;* x86-SIMD-optimized 10-bit IDCT
+;* this is the "simple" IDCT written by Michael Niedermayer, but it is not
+;* bitexact with the C version: the row pass has no DC-only shortcut and
+;* uses 16-bit coefficients
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+%if ARCH_X86_64
+
+%include "libavcodec/x86/simple_idct10_template.asm"
+
+SECTION_RODATA
+
+pw_1023:    times 8 dw 1023
+pd_round:   times 4 dd 1 << 12
+
+cextern pw_8
+
+section .text align=16
+
+; void simple_idct10_put_<opt>(uint8_t *pixels, int stride, DCTELEM *block);
+%macro idct10_put_fn 1
+cglobal simple_idct10_put, 3, 3, %1
+    movsxd      r1,  r1d
+    pxor        m15, m15           ; zero
+
+    ; the passes below work on 8 columns at once, so transpose the block
+    ; to keep the natural coefficient order (FF_NO_IDCT_PERM)
+    mova        m0, [r2+  0]
+    mova        m1, [r2+ 16]
+    mova        m2, [r2+ 32]
+    mova        m3, [r2+ 48]
+    mova        m4, [r2+ 64]
+    mova        m5, [r2+ 80]
+    mova        m6, [r2+ 96]
+    mova        m7, [r2+112]
+    TRANSPOSE8x8W 0, 1, 2, 3, 4, 5, 6, 7, 8
+    mova   [r2+ 16], m1
+    mova   [r2+ 48], m3
+    mova   [r2+ 80], m5
+    mova   [r2+112], m7
+    SWAP         0,  10
+    SWAP         2,   8
+    SWAP         4,  13
+    SWAP         6,  12
+
+    ; for (i = 0; i < 8; i++)
+    ;     idctRowCondDC(block + i*8);
+    IDCT_1D     none, 13, none, pd_round
+
+    ; transpose for second part of IDCT
+    TRANSPOSE8x8W 8, 0, 1, 2, 4, 11, 9, 10, 3
+    mova   [r2+ 16], m0
+    mova   [r2+ 48], m2
+    mova   [r2+ 80], m11
+    mova   [r2+112], m10
+    SWAP         8,  10
+    SWAP         1,   8
+    SWAP         4,  13
+    SWAP         9,  12
+
+    ; for (i = 0; i < 8; i++)
+    ;     idctSparseColPut(dest + i, line_size, block + i);
+    IDCT_1D     pw_8, 18
+
+    ; clip/store
+    mova        m5, [pw_1023]
+    pmaxsw      m8,  m15
+    pmaxsw      m0,  m15
+    pmaxsw      m1,  m15
+    pmaxsw      m2,  m15
+    pmaxsw      m4,  m15
+    pmaxsw      m11, m15
+    pmaxsw      m9,  m15
+    pmaxsw      m10, m15
+    pminsw      m8,  m5
+    pminsw      m0,  m5
+    pminsw      m1,  m5
+    pminsw      m2,  m5
+    pminsw      m4,  m5
+    pminsw      m11, m5
+    pminsw      m9,  m5
+    pminsw      m10, m5
+
+    lea         r2, [r1*3]
+    mova  [r0     ], m8
+    mova  [r0+r1  ], m0
+    mova  [r0+r1*2], m1
+    mova  [r0+r2  ], m2
+    lea         r0, [r0+r1*4]
+    mova  [r0     ], m4
+    mova  [r0+r1  ], m11
+    mova  [r0+r1*2], m9
+    mova  [r0+r2  ], m10
+    RET
+%endmacro
+
+INIT_XMM sse2
+idct10_put_fn 16
+%if HAVE_AVX_EXTERNAL
+INIT_XMM avx
+idct10_put_fn 16
+%endif
+
+%endif
@@ -0,0 +1,122 @@
+/*
+ * SSE optimized DCA QMF synthesis filter
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavcodec/synth_filter.h"
+
+#if HAVE_SSE_INLINE && HAVE_7REGS
+
+/**
+ * Accumulate the window products of 4 consecutive output samples over the
+ * 64-float blocks [start, end) of the synthesis buffer, exactly in the
+ * order of the C version. acc holds the a, b, c and d sums of the C code.
+ */
+static av_always_inline void synth_window_sse(float acc[16], const float *window,
+                                              const float *buf, int i,
+                                              intptr_t start, intptr_t end)
+{
+    intptr_t j = start * sizeof(float);
+
+    __asm__ volatile (
+        "movups      (%1), %%xmm4           \n"
+        "movups    16(%1), %%xmm5           \n"
+        "movups    32(%1), %%xmm6           \n"
+        "movups    48(%1), %%xmm7           \n"
+        "1:                                 \n"
+        "movups  (%4, %0), %%xmm0           \n"
+        "movups  (%2, %0), %%xmm1           \n"
+        "shufps $0x1b, %%xmm0, %%xmm0       \n"
+        "mulps     %%xmm1, %%xmm0           \n"
+        "subps     %%xmm0, %%xmm4           \n"
+        "movups  (%3, %0), %%xmm0           \n"
+        "movups 64(%2, %0), %%xmm1          \n"
+        "mulps     %%xmm1, %%xmm0           \n"
+        "addps     %%xmm0, %%xmm5           \n"
+        "movups 64(%3, %0), %%xmm0          \n"
+        "movups 128(%2, %0), %%xmm1         \n"
+        "mulps     %%xmm1, %%xmm0           \n"
+        "addps     %%xmm0, %%xmm6           \n"
+        "movups 64(%4, %0), %%xmm0          \n"
+        "movups 192(%2, %0), %%xmm1         \n"
+        "shufps $0x1b, %%xmm0, %%xmm0       \n"
+        "mulps     %%xmm1, %%xmm0           \n"
+        "addps     %%xmm0, %%xmm7           \n"
+        "add          $256, %0              \n"
+        "cmp            %5, %0              \n"
+        "jl              1b                 \n"
+        "movups    %%xmm4,   (%1)           \n"
+        "movups    %%xmm5, 16(%1)           \n"
+        "movups    %%xmm6, 32(%1)           \n"
+        "movups    %%xmm7, 48(%1)           \n"
+        : "+&r"(j)
+        : "r"(acc), "r"(window + i), "r"(buf + i), "r"(buf + 12 - i),
+          "r"(end * (intptr_t)sizeof(float))
+        : XMM_CLOBBERS("xmm0", "xmm1", "xmm4", "xmm5", "xmm6", "xmm7",)
+          "memory"
+    );
+}
+
+static void synth_filter_sse(FFTContext *imdct,
+                             float *synth_buf_ptr, int *synth_buf_offset,
+                             float synth_buf2[32], const float window[512],
+                             float out[32], const float in[32], float scale)
+{
+    float *synth_buf = synth_buf_ptr + *synth_buf_offset;
+    /* first 64-float block that wraps around to the start of the buffer */
+    intptr_t wrap = FFALIGN(512 - *synth_buf_offset, 64);
+    float acc[16];
+    int i, k;
+
+    imdct->imdct_half(imdct, synth_buf, in);
+
+    for (i = 0; i < 16; i += 4) {
+        for (k = 0; k < 4; k++) {
+            acc[k     ] = synth_buf2[i + k     ];
+            acc[k +  4] = synth_buf2[i + k + 16];
+            acc[k +  8] = 0;
+            acc[k + 12] = 0;
+        }
+        synth_window_sse(acc, window, synth_buf, i, 0, wrap);
+        if (wrap < 512)
+            synth_window_sse(acc, window, synth_buf - 512, i, wrap, 512);
+        for (k = 0; k < 4; k++) {
+            out[i + k     ]        = acc[k     ] * scale;
+            out[i + k + 16]        = acc[k +  4] * scale;
+            synth_buf2[i + k     ] = acc[k +  8];
+            synth_buf2[i + k + 16] = acc[k + 12];
+        }
+    }
+    *synth_buf_offset = (*synth_buf_offset - 32) & 511;
+}
+
+#endif /* HAVE_SSE_INLINE && HAVE_7REGS */
+
+av_cold void ff_synth_filter_init_x86(SynthFilterContext *c)
+{
+#if HAVE_SSE_INLINE && HAVE_7REGS
+    int mm_flags = av_get_cpu_flags();
+
+    if (INLINE_SSE(mm_flags))
+        c->synth_filter_float = synth_filter_sse;
+#endif
+}
@@ -0,0 +1,110 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavcodec/v210enc.h"
+
+#if HAVE_SSSE3_INLINE && HAVE_7REGS
+
+DECLARE_ALIGNED(16, static const uint16_t, v210_enc_min_10)[8] = {
+    4, 4, 4, 4, 4, 4, 4, 4
+};
+DECLARE_ALIGNED(16, static const uint16_t, v210_enc_max_10)[8] = {
+    1019, 1019, 1019, 1019, 1019, 1019, 1019, 1019
+};
+
+/* the multipliers shift each sample to its bit position within the
+ * 16-bit word the shuffles move it to */
+DECLARE_ALIGNED(16, static const uint16_t, v210_enc_luma_mult_10)[8] = {
+    4, 1, 16, 4, 1, 16, 0, 0
+};
+DECLARE_ALIGNED(16, static const uint16_t, v210_enc_chroma_mult_10)[8] = {
+    1, 4, 16, 0, 16, 1, 4, 0
+};
+DECLARE_ALIGNED(16, static const int8_t, v210_enc_luma_shuf_10)[16] = {
+    -1, 0, 1, -1, 2, 3, 4, 5, -1, 6, 7, -1, 8, 9, 10, 11
+};
+DECLARE_ALIGNED(16, static const int8_t, v210_enc_chroma_shuf_10)[16] = {
+    0, 1, 8, 9, -1, 2, 3, -1, 10, 11, 4, 5, -1, 12, 13, -1
+};
+
+/* 6 pixels per iteration, loaded without reading past them */
+static void v210_planar_pack_10_ssse3(const uint16_t *y, const uint16_t *u,
+                                      const uint16_t *v, uint8_t *dst,
+                                      ptrdiff_t width)
+{
+    x86_reg i = -width;
+
+    if (!width)
+        return;
+
+    y += width;
+    u += width >> 1;
+    v += width >> 1;
+
+    __asm__ volatile(
+        "movdqa            %5, %%xmm4       \n"
+        "movdqa            %6, %%xmm5       \n"
+        "movdqa            %7, %%xmm6       \n"
+        "movdqa            %8, %%xmm7       \n"
+        "1:                                 \n"
+        "movq     (%1,%0,2), %%xmm0         \n"
+        "movd    8(%1,%0,2), %%xmm1         \n"
+        "punpcklqdq    %%xmm1, %%xmm0       \n"
+        "movd       (%2,%0), %%xmm1         \n"
+        "pinsrw $2, 4(%2,%0), %%xmm1        \n"
+        "movd       (%3,%0), %%xmm2         \n"
+        "pinsrw $2, 4(%3,%0), %%xmm2        \n"
+        "punpcklqdq    %%xmm2, %%xmm1       \n"
+        "pmaxsw        %%xmm4, %%xmm0       \n"
+        "pmaxsw        %%xmm4, %%xmm1       \n"
+        "pminsw        %%xmm5, %%xmm0       \n"
+        "pminsw        %%xmm5, %%xmm1       \n"
+        "pmullw            %9, %%xmm0       \n"
+        "pmullw           %10, %%xmm1       \n"
+        "pshufb        %%xmm6, %%xmm0       \n"
+        "pshufb        %%xmm7, %%xmm1       \n"
+        "por           %%xmm1, %%xmm0       \n"
+        "movdqu        %%xmm0, (%4)         \n"
+        "add              $16, %4           \n"
+        "add               $6, %0           \n"
+        "jl                1b               \n"
+        : "+r"(i), "+r"(y), "+r"(u), "+r"(v), "+r"(dst)
+        : "m"(*v210_enc_min_10), "m"(*v210_enc_max_10),
+          "m"(*v210_enc_luma_shuf_10), "m"(*v210_enc_chroma_shuf_10),
+          "m"(*v210_enc_luma_mult_10), "m"(*v210_enc_chroma_mult_10)
+        : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm4", "xmm5",
+                       "xmm6", "xmm7",) "memory"
+    );
+}
+
+#endif /* HAVE_SSSE3_INLINE && HAVE_7REGS */
+
+av_cold void ff_v210enc_init_x86(V210EncContext *s)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+#if HAVE_SSSE3_INLINE && HAVE_7REGS
+    if (INLINE_SSSE3(cpu_flags))
+        s->pack_line_10 = v210_planar_pack_10_ssse3;
+#endif
+}
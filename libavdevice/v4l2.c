@@ -46,7 +46,9 @@
 #endif
 #include <linux/videodev2.h>
 #endif
+#include "libavutil/atomic.h"
 #include "libavutil/avassert.h"
+#include "libavutil/buffer.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/log.h"
 #include "libavutil/opt.h"
@@ -68,7 +70,11 @@
 #define v4l2_munmap munmap
 #endif
 
-static const int desired_video_buffers = 256;
+#ifdef V4L2_CAP_VIDEO_CAPTURE_MPLANE
+#define IS_MPLANE(type) ((type) == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE)
+#else
+#define IS_MPLANE(type) 0
+#endif
 
 #define V4L_ALLFORMATS  3
 #define V4L_RAWFORMATS  1
@@ -108,9 +114,9 @@ struct video_data {
     TimeFilter *timefilter;
     int64_t last_time_m;
 
-    int buffers;
-    void **buf_start;
-    unsigned int *buf_len;
+    int buf_type;       /**< V4L2_BUF_TYPE_VIDEO_CAPTURE(_MPLANE) */
+    AVBufferRef *mappings; /**< struct v4l2_mappings */
+    int desired_buffers; /**< Set by a private option. */
     char *standard;
     int channel;
     char *pixel_format; /**< Set by a private option. */
@@ -118,9 +124,35 @@ struct video_data {
     char *framerate;    /**< Set by a private option. */
 };
 
+/**
+ * The mmap()ed driver buffers. They are shared between the demuxer and the
+ * packets it returns, so that packets may outlive the demuxer: the buffers
+ * are unmapped and the duplicated device fd is closed when the last
+ * reference goes away.
+ */
+struct v4l2_mappings {
+    int fd;
+    int buf_type;
+    int nb_buffers;
+    void **buf_start;
+    unsigned int *buf_len;
+    volatile int buffers_queued; /**< number of buffers owned by the driver */
+};
+
 struct buff_data {
     int index;
-    int fd;
+    AVBufferRef *mappings;
+};
+
+/**
+ * A v4l2_buffer along with the storage for its plane when the
+ * multi-planar API is used; only single-plane formats are supported.
+ */
+struct capture_buffer {
+    struct v4l2_buffer buf;
+#ifdef V4L2_CAP_VIDEO_CAPTURE_MPLANE
+    struct v4l2_plane plane;
+#endif
 };
 
 struct fmt_map {
@@ -160,6 +192,7 @@ static struct fmt_map fmt_conversion_table[] = {
 
 static int device_open(AVFormatContext *ctx)
 {
+    struct video_data *s = ctx->priv_data;
     struct v4l2_capability cap;
     int fd;
     int res, err;
@@ -191,7 +224,14 @@ static int device_open(AVFormatContext *ctx)
     av_log(ctx, AV_LOG_VERBOSE, "[%d]Capabilities: %x\n",
            fd, cap.capabilities);
 
-    if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE)) {
+    if (cap.capabilities & V4L2_CAP_VIDEO_CAPTURE) {
+        s->buf_type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+#ifdef V4L2_CAP_VIDEO_CAPTURE_MPLANE
+    } else if (cap.capabilities & V4L2_CAP_VIDEO_CAPTURE_MPLANE) {
+        av_log(ctx, AV_LOG_VERBOSE, "Using the multi-planar API\n");
+        s->buf_type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
+#endif
+    } else {
         av_log(ctx, AV_LOG_ERROR, "Not a video capture device.\n");
         err = ENODEV;
 
@@ -218,35 +258,67 @@ static int device_init(AVFormatContext *ctx, int *width, int *height,
 {
     struct video_data *s = ctx->priv_data;
     int fd = s->fd;
-    struct v4l2_format fmt = { .type = V4L2_BUF_TYPE_VIDEO_CAPTURE };
+    struct v4l2_format fmt = { .type = s->buf_type };
     struct v4l2_pix_format *pix = &fmt.fmt.pix;
+    uint32_t new_width, new_height, new_fmt, field;
 
     int res;
 
-    pix->width = *width;
-    pix->height = *height;
-    pix->pixelformat = pix_fmt;
-    pix->field = V4L2_FIELD_ANY;
+#ifdef V4L2_CAP_VIDEO_CAPTURE_MPLANE
+    if (IS_MPLANE(s->buf_type)) {
+        struct v4l2_pix_format_mplane *pix_mp = &fmt.fmt.pix_mp;
+
+        pix_mp->width       = *width;
+        pix_mp->height      = *height;
+        pix_mp->pixelformat = pix_fmt;
+        pix_mp->field       = V4L2_FIELD_ANY;
+        pix_mp->num_planes  = 1;
+
+        res = v4l2_ioctl(fd, VIDIOC_S_FMT, &fmt);
+        if (res >= 0 && pix_mp->num_planes != 1) {
+            av_log(ctx, AV_LOG_DEBUG,
+                   "Pixel format 0x%08X uses %d planes, only single-plane "
+                   "formats are supported\n", pix_fmt, pix_mp->num_planes);
+            res = -1;
+        }
 
-    res = v4l2_ioctl(fd, VIDIOC_S_FMT, &fmt);
+        new_width  = pix_mp->width;
+        new_height = pix_mp->height;
+        new_fmt    = pix_mp->pixelformat;
+        field      = pix_mp->field;
+    } else
+#endif
+    {
+        pix->width = *width;
+        pix->height = *height;
+        pix->pixelformat = pix_fmt;
+        pix->field = V4L2_FIELD_ANY;
+
+        res = v4l2_ioctl(fd, VIDIOC_S_FMT, &fmt);
+
+        new_width  = pix->width;
+        new_height = pix->height;
+        new_fmt    = pix->pixelformat;
+        field      = pix->field;
+    }
 
-    if ((*width != fmt.fmt.pix.width) || (*height != fmt.fmt.pix.height)) {
+    if ((*width != new_width) || (*height != new_height)) {
         av_log(ctx, AV_LOG_INFO,
                "The V4L2 driver changed the video from %dx%d to %dx%d\n",
-               *width, *height, fmt.fmt.pix.width, fmt.fmt.pix.height);
-        *width = fmt.fmt.pix.width;
-        *height = fmt.fmt.pix.height;
+               *width, *height, new_width, new_height);
+        *width = new_width;
+        *height = new_height;
     }
 
-    if (pix_fmt != fmt.fmt.pix.pixelformat) {
+    if (pix_fmt != new_fmt) {
         av_log(ctx, AV_LOG_DEBUG,
                "The V4L2 driver changed the pixel format "
                "from 0x%08X to 0x%08X\n",
-               pix_fmt, fmt.fmt.pix.pixelformat);
+               pix_fmt, new_fmt);
         res = -1;
     }
 
-    if (fmt.fmt.pix.field == V4L2_FIELD_INTERLACED) {
+    if (field == V4L2_FIELD_INTERLACED) {
         av_log(ctx, AV_LOG_DEBUG, "The V4L2 driver using the interlaced mode");
         s->interlaced = 1;
     }
@@ -341,7 +413,8 @@ static void list_framesizes(AVFormatContext *ctx, int fd, uint32_t pixelformat)
 
 static void list_formats(AVFormatContext *ctx, int fd, int type)
 {
-    struct v4l2_fmtdesc vfd = { .type = V4L2_BUF_TYPE_VIDEO_CAPTURE };
+    struct video_data *s = ctx->priv_data;
+    struct v4l2_fmtdesc vfd = { .type = s->buf_type };
 
     while(!ioctl(fd, VIDIOC_ENUM_FMT, &vfd)) {
         enum AVCodecID codec_id = fmt_v4l2codec(vfd.pixelformat);
@@ -378,15 +451,52 @@ static void list_formats(AVFormatContext *ctx, int fd, int type)
     }
 }
 
+static void capture_buffer_init(struct capture_buffer *b, int buf_type,
+                                int index)
+{
+    memset(b, 0, sizeof(*b));
+    b->buf.type   = buf_type;
+    b->buf.memory = V4L2_MEMORY_MMAP;
+    b->buf.index  = index;
+#ifdef V4L2_CAP_VIDEO_CAPTURE_MPLANE
+    if (IS_MPLANE(buf_type)) {
+        b->buf.m.planes = &b->plane;
+        b->buf.length   = 1;
+    }
+#endif
+}
+
+#ifdef V4L2_CAP_VIDEO_CAPTURE_MPLANE
+#define BUF_FIELD(b, field, mp_field) \
+    (IS_MPLANE((b)->buf.type) ? (b)->plane.mp_field : (b)->buf.field)
+#else
+#define BUF_FIELD(b, field, mp_field) ((b)->buf.field)
+#endif
+
+static void mappings_free(void *opaque, uint8_t *data)
+{
+    struct v4l2_mappings *map = (struct v4l2_mappings *)data;
+    int i;
+
+    for (i = 0; i < map->nb_buffers; i++)
+        v4l2_munmap(map->buf_start[i], map->buf_len[i]);
+    av_free(map->buf_start);
+    av_free(map->buf_len);
+    if (map->fd >= 0)
+        v4l2_close(map->fd);
+    av_free(map);
+}
+
 static int mmap_init(AVFormatContext *ctx)
 {
     int i, res;
     struct video_data *s = ctx->priv_data;
     struct v4l2_requestbuffers req = {
-        .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-        .count  = desired_video_buffers,
+        .type   = s->buf_type,
+        .count  = s->desired_buffers,
         .memory = V4L2_MEMORY_MMAP
     };
+    struct v4l2_mappings *map;
 
     res = v4l2_ioctl(s->fd, VIDIOC_REQBUFS, &req);
     if (res < 0) {
@@ -402,72 +512,111 @@ static int mmap_init(AVFormatContext *ctx)
         av_log(ctx, AV_LOG_ERROR, "Insufficient buffer memory\n");
         return AVERROR(ENOMEM);
     }
-    s->buffers = req.count;
-    s->buf_start = av_malloc(sizeof(void *) * s->buffers);
-    if (s->buf_start == NULL) {
-        av_log(ctx, AV_LOG_ERROR, "Cannot allocate buffer pointers\n");
+    if (req.count != s->desired_buffers)
+        av_log(ctx, AV_LOG_VERBOSE, "The V4L2 driver allocated %d buffers\n",
+               req.count);
+
+    map = av_mallocz(sizeof(*map));
+    if (!map)
         return AVERROR(ENOMEM);
+    map->fd       = -1;
+    map->buf_type = s->buf_type;
+    s->mappings = av_buffer_create((uint8_t *)map, sizeof(*map),
+                                   mappings_free, NULL, 0);
+    if (!s->mappings) {
+        av_free(map);
+        return AVERROR(ENOMEM);
+    }
+
+    map->buf_start = av_malloc(sizeof(void *) * req.count);
+    if (map->buf_start == NULL) {
+        av_log(ctx, AV_LOG_ERROR, "Cannot allocate buffer pointers\n");
+        res = AVERROR(ENOMEM);
+        goto fail;
     }
-    s->buf_len = av_malloc(sizeof(unsigned int) * s->buffers);
-    if (s->buf_len == NULL) {
+    map->buf_len = av_malloc(sizeof(unsigned int) * req.count);
+    if (map->buf_len == NULL) {
         av_log(ctx, AV_LOG_ERROR, "Cannot allocate buffer sizes\n");
-        av_free(s->buf_start);
-        return AVERROR(ENOMEM);
+        res = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    /* The packets keep their own reference to the device, so that they
+     * can be given back to the driver after the demuxer is closed. */
+    map->fd = v4l2_dup(s->fd);
+    if (map->fd < 0) {
+        res = AVERROR(errno);
+        av_log(ctx, AV_LOG_ERROR, "dup: %s\n", strerror(errno));
+        goto fail;
     }
 
     for (i = 0; i < req.count; i++) {
-        struct v4l2_buffer buf = {
-            .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-            .index  = i,
-            .memory = V4L2_MEMORY_MMAP
-        };
-        res = v4l2_ioctl(s->fd, VIDIOC_QUERYBUF, &buf);
+        struct capture_buffer b;
+
+        capture_buffer_init(&b, s->buf_type, i);
+        res = v4l2_ioctl(s->fd, VIDIOC_QUERYBUF, &b.buf);
         if (res < 0) {
             av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_QUERYBUF)\n");
-            return AVERROR(errno);
+            res = AVERROR(errno);
+            goto fail;
         }
 
-        s->buf_len[i] = buf.length;
-        if (s->frame_size > 0 && s->buf_len[i] < s->frame_size) {
+        map->buf_len[i] = BUF_FIELD(&b, length, length);
+        if (s->frame_size > 0 && map->buf_len[i] < s->frame_size) {
             av_log(ctx, AV_LOG_ERROR,
                    "Buffer len [%d] = %d != %d\n",
-                   i, s->buf_len[i], s->frame_size);
+                   i, map->buf_len[i], s->frame_size);
 
-            return -1;
+            res = -1;
+            goto fail;
         }
-        s->buf_start[i] = v4l2_mmap(NULL, buf.length,
-                               PROT_READ | PROT_WRITE, MAP_SHARED,
-                               s->fd, buf.m.offset);
+        map->buf_start[i] = v4l2_mmap(NULL, map->buf_len[i],
+                                      PROT_READ | PROT_WRITE, MAP_SHARED,
+                                      s->fd, BUF_FIELD(&b, m.offset, m.mem_offset));
 
-        if (s->buf_start[i] == MAP_FAILED) {
+        if (map->buf_start[i] == MAP_FAILED) {
             av_log(ctx, AV_LOG_ERROR, "mmap: %s\n", strerror(errno));
-            return AVERROR(errno);
+            res = AVERROR(errno);
+            goto fail;
         }
+        map->nb_buffers++;
     }
 
     return 0;
+
+fail:
+    av_buffer_unref(&s->mappings);
+    return res;
+}
+
+static int enqueue_buffer(int fd, int buf_type, int index)
+{
+    struct capture_buffer b;
+
+    capture_buffer_init(&b, buf_type, index);
+    if (v4l2_ioctl(fd, VIDIOC_QBUF, &b.buf) < 0) {
+        int err = errno;
+        av_log(NULL, AV_LOG_ERROR, "ioctl(VIDIOC_QBUF): %s\n",
+               strerror(err));
+        return AVERROR(err);
+    }
+    return 0;
 }
 
 static void mmap_release_buffer(AVPacket *pkt)
 {
-    struct v4l2_buffer buf = { 0 };
-    int res, fd;
     struct buff_data *buf_descriptor = pkt->priv;
+    struct v4l2_mappings *map;
 
     if (pkt->data == NULL)
         return;
 
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
-    buf.index = buf_descriptor->index;
-    fd = buf_descriptor->fd;
+    map = (struct v4l2_mappings *)buf_descriptor->mappings->data;
+    if (enqueue_buffer(map->fd, map->buf_type, buf_descriptor->index) >= 0)
+        avpriv_atomic_int_add_and_fetch(&map->buffers_queued, 1);
+    av_buffer_unref(&buf_descriptor->mappings);
     av_free(buf_descriptor);
 
-    res = v4l2_ioctl(fd, VIDIOC_QBUF, &buf);
-    if (res < 0)
-        av_log(NULL, AV_LOG_ERROR, "ioctl(VIDIOC_QBUF): %s\n",
-               strerror(errno));
-
     pkt->data = NULL;
     pkt->size = 0;
 }
@@ -535,15 +684,16 @@ static int convert_timestamp(AVFormatContext *ctx, int64_t *ts)
 static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
 {
     struct video_data *s = ctx->priv_data;
-    struct v4l2_buffer buf = {
-        .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-        .memory = V4L2_MEMORY_MMAP
-    };
+    struct v4l2_mappings *map = (struct v4l2_mappings *)s->mappings->data;
+    struct capture_buffer b;
     struct buff_data *buf_descriptor;
-    int res;
+    int res, bytesused;
+    int64_t pts;
+
+    capture_buffer_init(&b, s->buf_type, 0);
 
     /* FIXME: Some special treatment might be needed in case of loss of signal... */
-    while ((res = v4l2_ioctl(s->fd, VIDIOC_DQBUF, &buf)) < 0 && (errno == EINTR));
+    while ((res = v4l2_ioctl(s->fd, VIDIOC_DQBUF, &b.buf)) < 0 && (errno == EINTR));
     if (res < 0) {
         if (errno == EAGAIN) {
             pkt->size = 0;
@@ -554,70 +704,83 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
 
         return AVERROR(errno);
     }
-    av_assert0(buf.index < s->buffers);
+    av_assert0(b.buf.index < map->nb_buffers);
+    avpriv_atomic_int_add_and_fetch(&map->buffers_queued, -1);
+    bytesused = BUF_FIELD(&b, bytesused, bytesused);
 
     /* CPIA is a compressed format and we don't know the exact number of bytes
      * used by a frame, so set it here as the driver announces it.
      */
     if (ctx->video_codec_id == AV_CODEC_ID_CPIA)
-        s->frame_size = buf.bytesused;
+        s->frame_size = bytesused;
 
-    if (s->frame_size > 0 && buf.bytesused != s->frame_size) {
+    if (s->frame_size > 0 && bytesused != s->frame_size) {
         av_log(ctx, AV_LOG_ERROR,
                "The v4l2 frame is %d bytes, but %d bytes are expected\n",
-               buf.bytesused, s->frame_size);
-
-        return AVERROR_INVALIDDATA;
+               bytesused, s->frame_size);
+        res = AVERROR_INVALIDDATA;
+        goto requeue;
     }
 
-    /* Image is at s->buff_start[buf.index] */
-    pkt->data= s->buf_start[buf.index];
-    pkt->size = buf.bytesused;
-    pkt->pts = buf.timestamp.tv_sec * INT64_C(1000000) + buf.timestamp.tv_usec;
-    res = convert_timestamp(ctx, &pkt->pts);
+    pts = b.buf.timestamp.tv_sec * INT64_C(1000000) + b.buf.timestamp.tv_usec;
+    res = convert_timestamp(ctx, &pts);
     if (res < 0)
-        return res;
-    pkt->destruct = mmap_release_buffer;
-    buf_descriptor = av_malloc(sizeof(struct buff_data));
-    if (buf_descriptor == NULL) {
-        /* Something went wrong... Since av_malloc() failed, we cannot even
-         * allocate a buffer for memcopying into it
-         */
-        av_log(ctx, AV_LOG_ERROR, "Failed to allocate a buffer descriptor\n");
-        res = v4l2_ioctl(s->fd, VIDIOC_QBUF, &buf);
+        goto requeue;
+
+    /* Hand out the driver buffer itself, unless this was the last one the
+     * driver had: then it would have nowhere to capture the next frame to
+     * while the caller holds on to the packet, so copy it instead. */
+    if (avpriv_atomic_int_get(&map->buffers_queued) > 0) {
+        buf_descriptor = av_malloc(sizeof(struct buff_data));
+        if (buf_descriptor == NULL ||
+            !(buf_descriptor->mappings = av_buffer_ref(s->mappings))) {
+            av_log(ctx, AV_LOG_ERROR, "Failed to allocate a buffer descriptor\n");
+            av_free(buf_descriptor);
+            res = AVERROR(ENOMEM);
+            goto requeue;
+        }
+        buf_descriptor->index = b.buf.index;
 
-        return AVERROR(ENOMEM);
+        /* Image is at map->buf_start[b.buf.index] */
+        pkt->data     = map->buf_start[b.buf.index];
+        pkt->size     = bytesused;
+        pkt->destruct = mmap_release_buffer;
+        pkt->priv     = buf_descriptor;
+    } else {
+        if ((res = av_new_packet(pkt, bytesused)) < 0)
+            goto requeue;
+        memcpy(pkt->data, map->buf_start[b.buf.index], bytesused);
+
+        if ((res = enqueue_buffer(s->fd, s->buf_type, b.buf.index)) < 0) {
+            av_free_packet(pkt);
+            return res;
+        }
+        avpriv_atomic_int_add_and_fetch(&map->buffers_queued, 1);
     }
-    buf_descriptor->fd = s->fd;
-    buf_descriptor->index = buf.index;
-    pkt->priv = buf_descriptor;
+    pkt->pts = pts;
+
+    return pkt->size;
 
-    return s->buf_len[buf.index];
+requeue:
+    if (enqueue_buffer(s->fd, s->buf_type, b.buf.index) >= 0)
+        avpriv_atomic_int_add_and_fetch(&map->buffers_queued, 1);
+    return res;
 }
 
 static int mmap_start(AVFormatContext *ctx)
 {
     struct video_data *s = ctx->priv_data;
+    struct v4l2_mappings *map = (struct v4l2_mappings *)s->mappings->data;
     enum v4l2_buf_type type;
     int i, res;
 
-    for (i = 0; i < s->buffers; i++) {
-        struct v4l2_buffer buf = {
-            .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-            .index  = i,
-            .memory = V4L2_MEMORY_MMAP
-        };
-
-        res = v4l2_ioctl(s->fd, VIDIOC_QBUF, &buf);
-        if (res < 0) {
-            av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_QBUF): %s\n",
-                   strerror(errno));
-
-            return AVERROR(errno);
-        }
+    for (i = 0; i < map->nb_buffers; i++) {
+        if ((res = enqueue_buffer(s->fd, s->buf_type, i)) < 0)
+            return res;
     }
+    avpriv_atomic_int_set(&map->buffers_queued, map->nb_buffers);
 
-    type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    type = s->buf_type;
     res = v4l2_ioctl(s->fd, VIDIOC_STREAMON, &type);
     if (res < 0) {
         av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_STREAMON): %s\n",
@@ -632,18 +795,14 @@ static int mmap_start(AVFormatContext *ctx)
 static void mmap_close(struct video_data *s)
 {
     enum v4l2_buf_type type;
-    int i;
 
-    type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    type = s->buf_type;
     /* We do not check for the result, because we could
      * not do anything about it anyway...
      */
     v4l2_ioctl(s->fd, VIDIOC_STREAMOFF, &type);
-    for (i = 0; i < s->buffers; i++) {
-        v4l2_munmap(s->buf_start[i], s->buf_len[i]);
-    }
-    av_free(s->buf_start);
-    av_free(s->buf_len);
+    /* the buffers are unmapped once the last packet referencing them is freed */
+    av_buffer_unref(&s->mappings);
 }
 
 static int v4l2_set_parameters(AVFormatContext *s1)
@@ -656,7 +815,7 @@ static int v4l2_set_parameters(AVFormatContext *s1)
     AVRational framerate_q = { 0 };
     int i, ret;
 
-    streamparm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    streamparm.type = s->buf_type;
 
     if (s->framerate &&
         (ret = av_parse_video_rate(&framerate_q, s->framerate)) < 0) {
@@ -825,7 +984,7 @@ static int v4l2_read_header(AVFormatContext *s1)
 
         av_log(s1, AV_LOG_VERBOSE,
                "Querying the device for the current frame size\n");
-        fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        fmt.type = s->buf_type;
         if (v4l2_ioctl(s->fd, VIDIOC_G_FMT, &fmt) < 0) {
             av_log(s1, AV_LOG_ERROR, "ioctl(VIDIOC_G_FMT): %s\n",
                    strerror(errno));
@@ -833,8 +992,16 @@ static int v4l2_read_header(AVFormatContext *s1)
             goto out;
         }
 
-        s->width  = fmt.fmt.pix.width;
-        s->height = fmt.fmt.pix.height;
+#ifdef V4L2_CAP_VIDEO_CAPTURE_MPLANE
+        if (IS_MPLANE(s->buf_type)) {
+            s->width  = fmt.fmt.pix_mp.width;
+            s->height = fmt.fmt.pix_mp.height;
+        } else
+#endif
+        {
+            s->width  = fmt.fmt.pix.width;
+            s->height = fmt.fmt.pix.height;
+        }
         av_log(s1, AV_LOG_VERBOSE,
                "Setting frame size to %dx%d\n", s->width, s->height);
     }
@@ -871,6 +1038,7 @@ static int v4l2_read_header(AVFormatContext *s1)
 
     if ((res = mmap_init(s1)) ||
         (res = mmap_start(s1)) < 0) {
+        av_buffer_unref(&s->mappings);
         v4l2_close(s->fd);
         goto out;
     }
@@ -940,6 +1108,7 @@ static const AVOption options[] = {
     { "abs",          "Use absolute timestamps (wall clock)",                      OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_ABS      }, 0, 2, DEC, "timestamps" },
     { "mono2abs",     "Force conversion from monotonic to absolute timestamps",    OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_MONO2ABS }, 0, 2, DEC, "timestamps" },
     { "ts",           "Kind of timestamps for grabbed frames",                     OFFSET(ts_mode),      AV_OPT_TYPE_INT,    {.i64 = 0 }, 0, 2, DEC, "timestamps" },
+    { "buffers",      "Number of capture buffers to request from the driver",      OFFSET(desired_buffers), AV_OPT_TYPE_INT, {.i64 = 256 }, 2, INT_MAX, DEC },
     { NULL },
 };
 
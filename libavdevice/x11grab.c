@@ -53,6 +53,9 @@
 #include <X11/extensions/shape.h>
 #include <X11/extensions/XShm.h>
 #include <X11/extensions/Xfixes.h>
+#if HAVE_XDAMAGEQUERYEXTENSION
+#include <X11/extensions/Xdamage.h>
+#endif
 #include "avdevice.h"
 
 /**
@@ -77,8 +80,24 @@ struct x11grab {
     int  follow_mouse;       /**< Set by a private option. */
     int  show_region;        /**< set by a private option. */
     char *framerate;         /**< Set by a private option. */
+    int  use_damage;         /**< Set by a private option. */
+    int  drop_unchanged;     /**< Set by a private option. */
 
     Window region_win;       /**< This is used by show_region option. */
+    Cursor cursor;           /**< Cursor set on the root window for draw_mouse */
+
+    /* state used to grab only what changed since the previous frame */
+    int frame_valid;         /**< image holds the region at grab_x/grab_y */
+    int grab_x, grab_y;      /**< region offset of the previous grab */
+    int cursor_x, cursor_y;  /**< position of the painted cursor */
+    int cursor_w, cursor_h;  /**< size of the painted cursor, 0 if none */
+    int pointer_x, pointer_y; /**< pointer position of the painted cursor */
+    unsigned long cursor_serial; /**< serial of the painted cursor image */
+#if HAVE_XDAMAGEQUERYEXTENSION
+    Damage damage;           /**< damage object on the root window, or 0 */
+    XserverRegion damage_region; /**< damage fetched for the current frame */
+    int damage_event_base;
+#endif
 };
 
 #define REGION_WIN_BORDER 3
@@ -306,6 +325,32 @@ x11grab_read_header(AVFormatContext *s1)
         goto out;
     }
 
+#if HAVE_XDAMAGEQUERYEXTENSION
+    if (x11grab->use_damage) {
+        int error_base;
+        if (XDamageQueryExtension(dpy, &x11grab->damage_event_base, &error_base)) {
+            x11grab->damage = XDamageCreate(dpy, RootWindow(dpy, screen),
+                                            XDamageReportNonEmpty);
+            x11grab->damage_region = XFixesCreateRegion(dpy, NULL, 0);
+        } else {
+            av_log(s1, AV_LOG_WARNING,
+                   "damage extension not found, grabbing full frames\n");
+        }
+    }
+#else
+    if (x11grab->use_damage)
+        av_log(s1, AV_LOG_WARNING,
+               "built without damage extension support, grabbing full frames\n");
+#endif
+
+    if (x11grab->draw_mouse) {
+        XSetWindowAttributes attr;
+
+        x11grab->cursor = XCreateFontCursor(dpy, XC_left_ptr);
+        attr.cursor = x11grab->cursor;
+        XChangeWindowAttributes(dpy, RootWindow(dpy, screen), CWCursor, &attr);
+    }
+
     x11grab->frame_size = x11grab->width * x11grab->height * image->bits_per_pixel/8;
     x11grab->dpy = dpy;
     x11grab->time_base  = av_inv_q(framerate);
@@ -334,16 +379,15 @@ out:
  * @param image image to paint the mouse pointer to
  * @param s context used to retrieve original grabbing rectangle
  *          coordinates
+ * @param xcim cursor image to paint
  */
 static void
-paint_mouse_pointer(XImage *image, struct x11grab *s)
+paint_mouse_pointer(XImage *image, struct x11grab *s, XFixesCursorImage *xcim)
 {
     int x_off = s->x_off;
     int y_off = s->y_off;
     int width = s->width;
     int height = s->height;
-    Display *dpy = s->dpy;
-    XFixesCursorImage *xcim;
     int x, y;
     int line, column;
     int to_line, to_column;
@@ -353,27 +397,26 @@ paint_mouse_pointer(XImage *image, struct x11grab *s)
      * Anyone who performs further investigation of the xlib API likely risks
      * permanent brain damage. */
     uint8_t *pix = image->data;
-    Cursor c;
-    Window w;
-    XSetWindowAttributes attr;
+
+    s->cursor_w = s->cursor_h = 0;
 
     /* Code doesn't currently support 16-bit or PAL8 */
     if (image->bits_per_pixel != 24 && image->bits_per_pixel != 32)
         return;
 
-    c = XCreateFontCursor(dpy, XC_left_ptr);
-    w = DefaultRootWindow(dpy);
-    attr.cursor = c;
-    XChangeWindowAttributes(dpy, w, CWCursor, &attr);
-
-    xcim = XFixesGetCursorImage(dpy);
-
     x = xcim->x - xcim->xhot;
     y = xcim->y - xcim->yhot;
 
     to_line = FFMIN((y + xcim->height), (height + y_off));
     to_column = FFMIN((x + xcim->width), (width + x_off));
 
+    /* remember what gets overwritten, it has to be grabbed again before
+     * the next frame can be built on top of this one */
+    s->cursor_x = FFMAX(x, x_off);
+    s->cursor_y = FFMAX(y, y_off);
+    s->cursor_w = FFMAX(to_column - s->cursor_x, 0);
+    s->cursor_h = FFMAX(to_line   - s->cursor_y, 0);
+
     for (line = FFMAX(y, y_off); line < to_line; line++) {
         for (column = FFMAX(x, x_off); column < to_column; column++) {
             int  xcim_addr = (line - y) * xcim->width + column - x;
@@ -395,11 +438,54 @@ paint_mouse_pointer(XImage *image, struct x11grab *s)
             }
         }
     }
+}
+
+/**
+ * Add a rectangle in screen coordinates to a bounding box relative to the
+ * grabbing region, clipping it to the region.
+ */
+static void
+add_dirty_rect(struct x11grab *s, int box[4], int x, int y, int w, int h)
+{
+    int x0 = FFMAX(x - s->x_off, 0);
+    int y0 = FFMAX(y - s->y_off, 0);
+    int x1 = FFMIN(x - s->x_off + w, s->width);
+    int y1 = FFMIN(y - s->y_off + h, s->height);
 
-    XFree(xcim);
-    xcim = NULL;
+    if (x0 >= x1 || y0 >= y1)
+        return;
+    if (box[0] >= box[2]) {
+        box[0] = x0; box[1] = y0; box[2] = x1; box[3] = y1;
+    } else {
+        box[0] = FFMIN(box[0], x0); box[1] = FFMIN(box[1], y0);
+        box[2] = FFMAX(box[2], x1); box[3] = FFMAX(box[3], y1);
+    }
 }
 
+#if HAVE_XDAMAGEQUERYEXTENSION
+/**
+ * Fetch and clear the screen damage accumulated since the previous call,
+ * and add its bounding box to box.
+ */
+static void
+add_damage(struct x11grab *s, int box[4])
+{
+    XRectangle *rects;
+    XEvent evt;
+    int i, nrects = 0;
+
+    XDamageSubtract(s->dpy, s->damage, None, s->damage_region);
+    rects = XFixesFetchRegion(s->dpy, s->damage_region, &nrects);
+    for (i = 0; i < nrects; i++)
+        add_dirty_rect(s, box, rects[i].x, rects[i].y,
+                       rects[i].width, rects[i].height);
+    if (rects)
+        XFree(rects);
+    /* only the region is used, drop the notifications */
+    while (XCheckTypedEvent(s->dpy, s->damage_event_base + XDamageNotify, &evt))
+        ;
+}
+#endif
 
 /**
  * Read new data in the image structure.
@@ -470,7 +556,11 @@ x11grab_read_packet(AVFormatContext *s1, AVPacket *pkt)
 
     int64_t curtime, delay;
     struct timespec ts;
+    XFixesCursorImage *xcim = NULL;
+    int box[4] = { 0 };
+    int full_grab, cursor_moved;
 
+next_frame:
     /* Calculate the time of the next frame */
     s->time_frame += INT64_C(1000000);
 
@@ -542,18 +632,71 @@ x11grab_read_packet(AVFormatContext *s1, AVPacket *pkt)
         }
     }
 
-    if(s->use_shm) {
-        if (!XShmGetImage(dpy, root, image, x_off, y_off, AllPlanes)) {
-            av_log (s1, AV_LOG_INFO, "XShmGetImage() failed\n");
+    if (s->draw_mouse)
+        xcim = XFixesGetCursorImage(dpy);
+    cursor_moved = xcim && (xcim->x != s->pointer_x || xcim->y != s->pointer_y ||
+                            xcim->cursor_serial != s->cursor_serial);
+
+    full_grab = !s->frame_valid || x_off != s->grab_x || y_off != s->grab_y;
+#if HAVE_XDAMAGEQUERYEXTENSION
+    if (!s->damage)
+        full_grab = 1;
+    else
+        add_damage(s, box);
+#else
+    full_grab = 1;
+#endif
+
+    if (!full_grab) {
+        /* the painted cursor is blended into the image, so all of it has
+         * to be grabbed again whenever it is painted again */
+        if ((box[0] < box[2] || cursor_moved) && s->cursor_w)
+            add_dirty_rect(s, box, s->cursor_x, s->cursor_y,
+                           s->cursor_w, s->cursor_h);
+
+        if (box[0] >= box[2] && !cursor_moved) {
+            /* nothing changed, image still holds the previous frame */
+            if (xcim)
+                XFree(xcim);
+            xcim = NULL;
+            if (s->drop_unchanged)
+                goto next_frame;
+            return s->frame_size;
         }
-    } else {
-        if (!xget_zpixmap(dpy, root, image, x_off, y_off)) {
-            av_log (s1, AV_LOG_INFO, "XGetZPixmap() failed\n");
+        if ((box[2] - box[0]) * (box[3] - box[1]) * 2 > s->width * s->height)
+            full_grab = 1;
+    }
+
+    if (full_grab) {
+        s->frame_valid = 1;
+        if(s->use_shm) {
+            if (!XShmGetImage(dpy, root, image, x_off, y_off, AllPlanes)) {
+                av_log (s1, AV_LOG_INFO, "XShmGetImage() failed\n");
+                s->frame_valid = 0;
+            }
+        } else {
+            if (!xget_zpixmap(dpy, root, image, x_off, y_off)) {
+                av_log (s1, AV_LOG_INFO, "XGetZPixmap() failed\n");
+                s->frame_valid = 0;
+            }
+        }
+        s->grab_x = x_off;
+        s->grab_y = y_off;
+    } else if (box[0] < box[2]) {
+        if (!XGetSubImage(dpy, root, x_off + box[0], y_off + box[1],
+                          box[2] - box[0], box[3] - box[1],
+                          AllPlanes, ZPixmap, image, box[0], box[1])) {
+            av_log(s1, AV_LOG_INFO, "XGetSubImage() failed\n");
+            s->frame_valid = 0;
         }
     }
 
-    if (s->draw_mouse) {
-        paint_mouse_pointer(image, s);
+    if (xcim) {
+        paint_mouse_pointer(image, s, xcim);
+        s->pointer_x     = xcim->x;
+        s->pointer_y     = xcim->y;
+        s->cursor_serial = xcim->cursor_serial;
+        XFree(xcim);
     }
 
     return s->frame_size;
@@ -587,6 +730,15 @@ x11grab_read_close(AVFormatContext *s1)
         XDestroyWindow(x11grab->dpy, x11grab->region_win);
     }
 
+#if HAVE_XDAMAGEQUERYEXTENSION
+    if (x11grab->damage) {
+        XDamageDestroy(x11grab->dpy, x11grab->damage);
+        XFixesDestroyRegion(x11grab->dpy, x11grab->damage_region);
+    }
+#endif
+    if (x11grab->cursor)
+        XFreeCursor(x11grab->dpy, x11grab->cursor);
+
     /* Free X11 display */
     XCloseDisplay(x11grab->dpy);
     return 0;
@@ -605,6 +757,8 @@ static const AVOption options[] = {
     { "framerate",  "set video frame rate",      OFFSET(framerate),   AV_OPT_TYPE_STRING,     {.str = "ntsc"}, 0, 0, DEC },
     { "show_region", "show the grabbing region", OFFSET(show_region), AV_OPT_TYPE_INT,        {.i64 = 0}, 0, 1, DEC },
     { "video_size",  "set video frame size",     OFFSET(width),       AV_OPT_TYPE_IMAGE_SIZE, {.str = "vga"}, 0, 0, DEC },
+    { "damage",      "only grab the parts of the screen that changed", OFFSET(use_damage), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, DEC },
+    { "drop_unchanged", "do not return frames identical to the previous one", OFFSET(drop_unchanged), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, DEC },
     { NULL },
 };
 
@@ -164,9 +164,14 @@ typedef struct MixContext {
     int nb_channels;            /**< number of channels */
     int sample_rate;            /**< sample rate */
     int planar;
+    enum AVSampleFormat sample_fmt; /**< sample format, packed */
     AVAudioFifo **fifos;        /**< audio fifo for each input */
     uint8_t *input_state;       /**< current state of each input */
     float *input_scale;         /**< mixing scale factor for each input */
+    int *input_scale_q15;       /**< input_scale in Q15, for the integer formats */
+    uint8_t **in_data;          /**< samples read from each input, one set of planes per input */
+    int in_data_samples;        /**< number of samples allocated in in_data */
+    uint8_t **fifo_data;        /**< samples used in place in each input fifo, same layout as in_data */
     float scale_norm;           /**< normalization factor for all inputs */
     int64_t next_pts;           /**< calculated pts for next output frame */
     FrameList *frame_list;      /**< list of frame info for the first input */
@@ -212,9 +217,34 @@ static void calculate_scales(MixContext *s, int nb_samples)
             s->input_scale[i] = 1.0f / s->scale_norm;
         else
             s->input_scale[i] = 0.0f;
+        s->input_scale_q15[i] = lrintf(s->input_scale[i] * (1 << 15));
     }
 }
 
+/* The scales of the active inputs sum to at most 1, so the accumulator
+ * only needs 16 bits of headroom over the Q15 scales. */
+#define MIX_INT(name, type, acc_type, clip)                                 \
+static void name(type *dst, type **src, const int *mul, int nb_src, int len)\
+{                                                                           \
+    acc_type acc[256];                                                      \
+    int i, j, k;                                                            \
+                                                                            \
+    for (i = 0; i < len; i += 256) {                                        \
+        int block = FFMIN(len - i, 256);                                    \
+                                                                            \
+        for (j = 0; j < block; j++)                                         \
+            acc[j] = (acc_type)src[0][i + j] * mul[0];                      \
+        for (k = 1; k < nb_src; k++)                                        \
+            for (j = 0; j < block; j++)                                     \
+                acc[j] += (acc_type)src[k][i + j] * mul[k];                 \
+        for (j = 0; j < block; j++)                                         \
+            dst[i + j] = clip((acc[j] + (1 << 14)) >> 15);                  \
+    }                                                                       \
+}
+
+MIX_INT(mix_s16, int16_t, int,     av_clip_int16)
+MIX_INT(mix_s32, int32_t, int64_t, av_clipl_int32)
+
 static int config_output(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
@@ -223,6 +253,7 @@ static int config_output(AVFilterLink *outlink)
     char buf[64];
 
     s->planar          = av_sample_fmt_is_planar(outlink->format);
+    s->sample_fmt      = av_get_packed_sample_fmt(outlink->format);
     s->sample_rate     = outlink->sample_rate;
     outlink->time_base = (AVRational){ 1, outlink->sample_rate };
     s->next_pts        = AV_NOPTS_VALUE;
@@ -248,8 +279,11 @@ static int config_output(AVFilterLink *outlink)
     memset(s->input_state, INPUT_ON, s->nb_inputs);
     s->active_inputs = s->nb_inputs;
 
-    s->input_scale = av_mallocz(s->nb_inputs * sizeof(*s->input_scale));
-    if (!s->input_scale)
+    s->input_scale     = av_mallocz(s->nb_inputs * sizeof(*s->input_scale));
+    s->input_scale_q15 = av_mallocz(s->nb_inputs * sizeof(*s->input_scale_q15));
+    s->in_data         = av_mallocz(s->nb_inputs * s->nb_channels * sizeof(*s->in_data));
+    s->fifo_data       = av_mallocz(s->nb_inputs * s->nb_channels * sizeof(*s->fifo_data));
+    if (!s->input_scale || !s->input_scale_q15 || !s->in_data || !s->fifo_data)
         return AVERROR(ENOMEM);
     s->scale_norm = s->active_inputs;
     calculate_scales(s, 0);
@@ -263,6 +297,32 @@ static int config_output(AVFilterLink *outlink)
     return 0;
 }
 
+/**
+ * Make sure in_data can hold nb_samples samples for each input.
+ */
+static int alloc_in_data(AVFilterLink *outlink, int nb_samples)
+{
+    MixContext *s = outlink->src->priv;
+    int i, ret;
+
+    if (nb_samples <= s->in_data_samples)
+        return 0;
+
+    /* the mixing functions work on multiples of 16 samples */
+    nb_samples = FFALIGN(nb_samples, 16);
+    for (i = 0; i < s->nb_inputs; i++) {
+        av_freep(&s->in_data[i * s->nb_channels]);
+        if ((ret = av_samples_alloc(&s->in_data[i * s->nb_channels], NULL,
+                                    s->nb_channels, nb_samples,
+                                    outlink->format, 0)) < 0) {
+            s->in_data_samples = 0;
+            return ret;
+        }
+    }
+    s->in_data_samples = nb_samples;
+    return 0;
+}
+
 /**
  * Read samples from the input FIFOs, mix, and write to the output link.
  */
@@ -270,8 +330,14 @@ static int output_frame(AVFilterLink *outlink, int nb_samples)
 {
     AVFilterContext *ctx = outlink->src;
     MixContext      *s = ctx->priv;
-    AVFilterBufferRef *out_buf, *in_buf;
-    int i;
+    AVFilterBufferRef *out_buf;
+    uint8_t **in_data;
+    uint8_t *src[32];
+    float scale[32];
+    int scale_q15[32];
+    int i, p, ret, nb_src = 0, in_place;
+    int planes     = s->planar ? s->nb_channels : 1;
+    int plane_size = nb_samples * (s->planar ? 1 : s->nb_channels);
 
     calculate_scales(s, nb_samples);
 
@@ -279,31 +345,77 @@ static int output_frame(AVFilterLink *outlink, int nb_samples)
     if (!out_buf)
         return AVERROR(ENOMEM);
 
-    in_buf = ff_get_audio_buffer(outlink, AV_PERM_WRITE, nb_samples);
-    if (!in_buf) {
-        avfilter_unref_buffer(out_buf);
-        return AVERROR(ENOMEM);
+    /* The integer mixing functions can read the samples directly from the
+     * fifos. The float ones need aligned and padded input, so the samples
+     * are copied out for them. */
+    in_place = s->sample_fmt != AV_SAMPLE_FMT_FLT;
+    for (i = 0; i < s->nb_inputs && in_place; i++) {
+        if (s->input_state[i] == INPUT_ON &&
+            av_audio_fifo_size(s->fifos[i]) < nb_samples)
+            in_place = 0;
     }
 
-    for (i = 0; i < s->nb_inputs; i++) {
-        if (s->input_state[i] == INPUT_ON) {
-            int planes, plane_size, p;
+    if (in_place) {
+        in_data = s->fifo_data;
+        for (i = 0; i < s->nb_inputs; i++) {
+            if (s->input_state[i] == INPUT_ON &&
+                (ret = av_audio_fifo_peek_ptr(s->fifos[i],
+                                              (void **)&in_data[i * s->nb_channels],
+                                              nb_samples)) < 0) {
+                avfilter_unref_buffer(out_buf);
+                return ret;
+            }
+        }
+    } else {
+        if ((ret = alloc_in_data(outlink, nb_samples)) < 0) {
+            avfilter_unref_buffer(out_buf);
+            return ret;
+        }
+        in_data = s->in_data;
+        for (i = 0; i < s->nb_inputs; i++) {
+            if (s->input_state[i] == INPUT_ON)
+                av_audio_fifo_read(s->fifos[i], (void **)&in_data[i * s->nb_channels],
+                                   nb_samples);
+        }
+    }
 
-            av_audio_fifo_read(s->fifos[i], (void **)in_buf->extended_data,
-                               nb_samples);
+    /* mix all the inputs of a plane in one pass over the output */
+    for (p = 0; p < planes; p++) {
+        nb_src = 0;
+        for (i = 0; i < s->nb_inputs; i++) {
+            if (s->input_state[i] == INPUT_ON) {
+                src[nb_src]       = in_data[i * s->nb_channels + p];
+                scale[nb_src]     = s->input_scale[i];
+                scale_q15[nb_src] = s->input_scale_q15[i];
+                nb_src++;
+            }
+        }
+        if (!nb_src)
+            break;
 
-            planes     = s->planar ? s->nb_channels : 1;
-            plane_size = nb_samples * (s->planar ? 1 : s->nb_channels);
-            plane_size = FFALIGN(plane_size, 16);
+        switch (s->sample_fmt) {
+        case AV_SAMPLE_FMT_FLT:
+            s->fdsp.vector_fmul_scalar_sum((float *)out_buf->extended_data[p],
+                                           (const float **)src, scale, nb_src,
+                                           FFALIGN(plane_size, 16));
+            break;
+        case AV_SAMPLE_FMT_S16:
+            mix_s16((int16_t *)out_buf->extended_data[p], (int16_t **)src,
+                    scale_q15, nb_src, plane_size);
+            break;
+        case AV_SAMPLE_FMT_S32:
+            mix_s32((int32_t *)out_buf->extended_data[p], (int32_t **)src,
+                    scale_q15, nb_src, plane_size);
+            break;
+        }
+    }
 
-            for (p = 0; p < planes; p++) {
-                s->fdsp.vector_fmac_scalar((float *)out_buf->extended_data[p],
-                                           (float *) in_buf->extended_data[p],
-                                           s->input_scale[i], plane_size);
-            }
+    if (in_place) {
+        for (i = 0; i < s->nb_inputs; i++) {
+            if (s->input_state[i] == INPUT_ON)
+                av_audio_fifo_drain(s->fifos[i], nb_samples);
         }
     }
-    avfilter_unref_buffer(in_buf);
 
     out_buf->pts = s->next_pts;
     if (s->next_pts != AV_NOPTS_VALUE)
@@ -526,6 +638,13 @@ static void uninit(AVFilterContext *ctx)
     av_freep(&s->frame_list);
     av_freep(&s->input_state);
     av_freep(&s->input_scale);
+    av_freep(&s->input_scale_q15);
+    if (s->in_data) {
+        for (i = 0; i < s->nb_inputs; i++)
+            av_freep(&s->in_data[i * s->nb_channels]);
+        av_freep(&s->in_data);
+    }
+    av_freep(&s->fifo_data);
 
     for (i = 0; i < ctx->nb_inputs; i++)
         av_freep(&ctx->input_pads[i].name);
@@ -536,6 +655,10 @@ static int query_formats(AVFilterContext *ctx)
     AVFilterFormats *formats = NULL;
     ff_add_format(&formats, AV_SAMPLE_FMT_FLT);
     ff_add_format(&formats, AV_SAMPLE_FMT_FLTP);
+    ff_add_format(&formats, AV_SAMPLE_FMT_S16);
+    ff_add_format(&formats, AV_SAMPLE_FMT_S16P);
+    ff_add_format(&formats, AV_SAMPLE_FMT_S32);
+    ff_add_format(&formats, AV_SAMPLE_FMT_S32P);
     ff_set_common_formats(ctx, formats);
     ff_set_common_channel_layouts(ctx, ff_all_channel_layouts());
     ff_set_common_samplerates(ctx, ff_all_samplerates());
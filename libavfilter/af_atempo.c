@@ -65,8 +65,12 @@ typedef struct {
     // number of samples in this fragment:
     int nsamples;
 
-    // rDFT transform of the down-mixed mono fragment, used for
-    // fast waveform alignment via correlation in frequency domain:
+    // down-mixed mono fragment, used to refine the alignment:
+    FFTSample *mono;
+
+    // rDFT transform of the down-mixed mono fragment decimated by 2,
+    // used for fast coarse waveform alignment via correlation
+    // in frequency domain:
     FFTSample *xdat;
 } AudioFragment;
 
@@ -197,6 +201,8 @@ static void yae_release_buffers(ATempoContext *atempo)
     av_freep(&atempo->frag[1].data);
     av_freep(&atempo->frag[0].xdat);
     av_freep(&atempo->frag[1].xdat);
+    av_freep(&atempo->frag[0].mono);
+    av_freep(&atempo->frag[1].mono);
 
     av_freep(&atempo->buffer);
     av_freep(&atempo->hann);
@@ -255,29 +261,32 @@ static int yae_reset(ATempoContext *atempo,
     // initialize audio fragment buffers:
     RE_MALLOC_OR_FAIL(atempo->frag[0].data, atempo->window * atempo->stride);
     RE_MALLOC_OR_FAIL(atempo->frag[1].data, atempo->window * atempo->stride);
-    RE_MALLOC_OR_FAIL(atempo->frag[0].xdat, atempo->window * sizeof(FFTComplex));
-    RE_MALLOC_OR_FAIL(atempo->frag[1].xdat, atempo->window * sizeof(FFTComplex));
+    RE_MALLOC_OR_FAIL(atempo->frag[0].xdat, atempo->window * sizeof(FFTSample));
+    RE_MALLOC_OR_FAIL(atempo->frag[1].xdat, atempo->window * sizeof(FFTSample));
+    RE_MALLOC_OR_FAIL(atempo->frag[0].mono, atempo->window * sizeof(FFTSample));
+    RE_MALLOC_OR_FAIL(atempo->frag[1].mono, atempo->window * sizeof(FFTSample));
 
-    // initialize rDFT contexts:
+    // initialize rDFT contexts, the correlation is computed at half the
+    // sample rate, over a zero padded window:
     av_rdft_end(atempo->real_to_complex);
     atempo->real_to_complex = NULL;
 
     av_rdft_end(atempo->complex_to_real);
     atempo->complex_to_real = NULL;
 
-    atempo->real_to_complex = av_rdft_init(nlevels + 1, DFT_R2C);
+    atempo->real_to_complex = av_rdft_init(nlevels, DFT_R2C);
     if (!atempo->real_to_complex) {
         yae_release_buffers(atempo);
         return AVERROR(ENOMEM);
     }
 
-    atempo->complex_to_real = av_rdft_init(nlevels + 1, IDFT_C2R);
+    atempo->complex_to_real = av_rdft_init(nlevels, IDFT_C2R);
     if (!atempo->complex_to_real) {
         yae_release_buffers(atempo);
         return AVERROR(ENOMEM);
     }
 
-    RE_MALLOC_OR_FAIL(atempo->correlation, atempo->window * sizeof(FFTComplex));
+    RE_MALLOC_OR_FAIL(atempo->correlation, atempo->window * sizeof(FFTSample));
 
     atempo->ring = atempo->window * 3;
     RE_MALLOC_OR_FAIL(atempo->buffer, atempo->ring * atempo->stride);
@@ -327,7 +336,7 @@ inline static AudioFragment *yae_prev_frag(ATempoContext *atempo)
 }
 
 /**
- * A helper macro for initializing complex data buffer with scalar data
+ * A helper macro for initializing the mono data buffer with scalar data
  * of a given type.
  */
 #define yae_init_xdat(scalar_type, scalar_max)                          \
@@ -335,7 +344,7 @@ inline static AudioFragment *yae_prev_frag(ATempoContext *atempo)
         const uint8_t *src_end = src +                                  \
             frag->nsamples * atempo->channels * sizeof(scalar_type);    \
                                                                         \
-        FFTSample *xdat = frag->xdat;                                   \
+        FFTSample *xdat = frag->mono;                                   \
         scalar_type tmp;                                                \
                                                                         \
         if (atempo->channels == 1) {                                    \
@@ -377,16 +386,19 @@ inline static AudioFragment *yae_prev_frag(ATempoContext *atempo)
     } while (0)
 
 /**
- * Initialize complex data buffer of a given audio fragment
+ * Initialize the mono and complex data buffers of a given audio fragment
  * with down-mixed mono data of appropriate scalar type.
  */
 static void yae_downmix(ATempoContext *atempo, AudioFragment *frag)
 {
     // shortcuts:
     const uint8_t *src = frag->data;
+    const int half_window = atempo->window / 2;
+    int i;
 
-    // init complex data buffer used for FFT and Correlation:
-    memset(frag->xdat, 0, sizeof(FFTComplex) * atempo->window);
+    // zero the part of the window past the end of the fragment:
+    memset(frag->mono + frag->nsamples, 0,
+           sizeof(FFTSample) * (atempo->window - frag->nsamples));
 
     if (atempo->format == AV_SAMPLE_FMT_U8) {
         yae_init_xdat(uint8_t, 127);
@@ -399,6 +411,12 @@ static void yae_downmix(ATempoContext *atempo, AudioFragment *frag)
     } else if (atempo->format == AV_SAMPLE_FMT_DBL) {
         yae_init_xdat(double, 1);
     }
+
+    // init complex data buffer used for FFT and Correlation,
+    // decimated by 2 and zero padded:
+    for (i = 0; i < half_window; i++)
+        frag->xdat[i] = 0.5f * (frag->mono[2 * i] + frag->mono[2 * i + 1]);
+    memset(frag->xdat + half_window, 0, sizeof(FFTSample) * half_window);
 }
 
 /**
@@ -617,6 +635,9 @@ static void yae_xcorr_via_rdft(FFTSample *xcorr,
  * Calculate alignment offset for given fragment
  * relative to the previous fragment.
  *
+ * The correlation peak is first searched at half the sample rate, then
+ * refined at full rate around the coarse peak.
+ *
  * @return alignment offset of current fragment relative to previous.
  */
 static int yae_align(AudioFragment *frag,
@@ -629,17 +650,18 @@ static int yae_align(AudioFragment *frag,
 {
     int       best_offset = -drift;
     FFTSample best_metric = -FLT_MAX;
-    FFTSample *xcorr;
+    int       best_i      = -1;
 
     int i0;
     int i1;
     int i;
+    int n;
 
     yae_xcorr_via_rdft(correlation,
                        complex_to_real,
                        (const FFTComplex *)prev->xdat,
                        (const FFTComplex *)frag->xdat,
-                       window);
+                       window / 2);
 
     // identify search window boundaries:
     i0 = FFMAX(window / 2 - delta_max - drift, 0);
@@ -648,16 +670,40 @@ static int yae_align(AudioFragment *frag,
     i1 = FFMIN(window / 2 + delta_max - drift, window - window / 16);
     i1 = FFMAX(i1, 0);
 
-    // identify cross-correlation peaks within search window:
-    xcorr = correlation + i0;
-
-    for (i = i0; i < i1; i++, xcorr++) {
-        FFTSample metric = *xcorr;
+    // identify cross-correlation peaks within search window,
+    // at the even offsets available in the decimated correlation:
+    for (i = i0 + (i0 & 1); i < i1; i += 2) {
+        FFTSample metric = correlation[i / 2];
 
         // normalize:
         FFTSample drifti = (FFTSample)(drift + i);
         metric *= drifti * (FFTSample)(i - i0) * (FFTSample)(i1 - i);
 
+        if (metric > best_metric) {
+            best_metric = metric;
+            best_i      = i;
+        }
+    }
+
+    if (best_i < 0) {
+        return best_offset;
+    }
+
+    // refine the peak at full rate, the correlation at offset i being
+    // the sum of prev[n + i] * frag[n]:
+    best_metric = -FLT_MAX;
+
+    for (i = FFMAX(best_i - 1, i0); i <= FFMIN(best_i + 1, i1 - 1); i++) {
+        FFTSample metric = 0;
+        FFTSample drifti = (FFTSample)(drift + i);
+
+        for (n = 0; n < window - i; n++) {
+            metric += prev->mono[n + i] * frag->mono[n];
+        }
+
+        // normalize:
+        metric *= drifti * (FFTSample)(i - i0) * (FFTSample)(i1 - i);
+
         if (metric > best_metric) {
             best_metric = metric;
             best_offset = i - window / 2;
@@ -720,15 +766,19 @@ static int yae_adjust_position(ATempoContext *atempo)
             float w1 = *wb;                                             \
             int j;                                                      \
                                                                         \
+            if (frag->position[0] + i < 0) {                            \
+                for (j = 0; j < atempo->channels; j++)                  \
+                    *out++ = *aaa++;                                    \
+                bbb += atempo->channels;                                \
+                continue;                                               \
+            }                                                           \
+                                                                        \
             for (j = 0; j < atempo->channels;                           \
                  j++, aaa++, bbb++, out++) {                            \
                 float t0 = (float)*aaa;                                 \
                 float t1 = (float)*bbb;                                 \
                                                                         \
-                *out =                                                  \
-                    frag->position[0] + i < 0 ?                         \
-                    *aaa :                                              \
-                    (scalar_type)(t0 * w0 + t1 * w1);                   \
+                *out = (scalar_type)(t0 * w0 + t1 * w1);                \
             }                                                           \
         }                                                               \
         dst = (uint8_t *)out;                                           \
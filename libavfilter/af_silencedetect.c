@@ -76,9 +76,60 @@ static char *get_metadata_val(AVFilterBufferRef *insamples, const char *key)
     return e && e->value ? e->value : NULL;
 }
 
+static av_always_inline void update(SilenceDetectContext *silence, AVFilterBufferRef *insamples,
+                                    int is_silence, int64_t nb_samples_notify,
+                                    AVRational time_base)
+{
+    if (is_silence) {
+        if (!silence->start) {
+            silence->nb_null_samples++;
+            if (silence->nb_null_samples >= nb_samples_notify) {
+                silence->start = insamples->pts - (int64_t)(silence->duration / av_q2d(time_base) + .5);
+                av_dict_set(&insamples->metadata, "lavfi.silence_start",
+                            av_ts2timestr(silence->start, &time_base), 0);
+                av_log(silence, AV_LOG_INFO, "silence_start: %s\n",
+                       get_metadata_val(insamples, "lavfi.silence_start"));
+            }
+        }
+    } else {
+        if (silence->start) {
+            av_dict_set(&insamples->metadata, "lavfi.silence_end",
+                        av_ts2timestr(insamples->pts, &time_base), 0);
+            av_dict_set(&insamples->metadata, "lavfi.silence_duration",
+                        av_ts2timestr(insamples->pts - silence->start, &time_base), 0);
+            av_log(silence, AV_LOG_INFO,
+                   "silence_end: %s | silence_duration: %s\n",
+                   get_metadata_val(insamples, "lavfi.silence_end"),
+                   get_metadata_val(insamples, "lavfi.silence_duration"));
+        }
+        silence->nb_null_samples = silence->start = 0;
+    }
+}
+
+/* The integer formats compare against the noise level scaled to their
+ * range and rounded up, which matches the comparison done on the samples
+ * converted to double. */
+#define SILENCE_DETECT(name, type, noise_type, noise_expr)                      \
+static void silencedetect_##name(SilenceDetectContext *s, AVFilterBufferRef *insamples, \
+                                 int nb_samples, int64_t nb_samples_notify,    \
+                                 AVRational time_base)                         \
+{                                                                              \
+    const type *p = (const type *)insamples->data[0];                          \
+    const noise_type noise = noise_expr;                                       \
+    int i;                                                                     \
+                                                                               \
+    for (i = 0; i < nb_samples; i++, p++)                                      \
+        update(s, insamples, *p < noise && *p > -noise,                        \
+               nb_samples_notify, time_base);                                  \
+}
+
+SILENCE_DETECT(dbl, double,  double,  s->noise)
+SILENCE_DETECT(flt, float,   double,  s->noise)
+SILENCE_DETECT(s32, int32_t, int64_t, FFMIN(ceil(s->noise * 2147483648.), 2147483649.))
+SILENCE_DETECT(s16, int16_t, int,     FFMIN(ceil(s->noise * 32768.), 32769.))
+
 static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *insamples)
 {
-    int i;
     SilenceDetectContext *silence = inlink->dst->priv;
     const int nb_channels           = av_get_channel_layout_nb_channels(inlink->channel_layout);
     const int srate                 = inlink->sample_rate;
@@ -91,37 +142,20 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *insamples)
             srate * silence->nb_null_samples / silence->last_sample_rate;
     silence->last_sample_rate = srate;
 
-    // TODO: support more sample formats
     // TODO: document metadata
-    if (insamples->format == AV_SAMPLE_FMT_DBL) {
-        double *p = (double *)insamples->data[0];
-
-        for (i = 0; i < nb_samples; i++, p++) {
-            if (*p < silence->noise && *p > -silence->noise) {
-                if (!silence->start) {
-                    silence->nb_null_samples++;
-                    if (silence->nb_null_samples >= nb_samples_notify) {
-                        silence->start = insamples->pts - (int64_t)(silence->duration / av_q2d(inlink->time_base) + .5);
-                        av_dict_set(&insamples->metadata, "lavfi.silence_start",
-                                    av_ts2timestr(silence->start, &inlink->time_base), 0);
-                        av_log(silence, AV_LOG_INFO, "silence_start: %s\n",
-                               get_metadata_val(insamples, "lavfi.silence_start"));
-                    }
-                }
-            } else {
-                if (silence->start) {
-                    av_dict_set(&insamples->metadata, "lavfi.silence_end",
-                                av_ts2timestr(insamples->pts, &inlink->time_base), 0);
-                    av_dict_set(&insamples->metadata, "lavfi.silence_duration",
-                                av_ts2timestr(insamples->pts - silence->start, &inlink->time_base), 0);
-                    av_log(silence, AV_LOG_INFO,
-                           "silence_end: %s | silence_duration: %s\n",
-                           get_metadata_val(insamples, "lavfi.silence_end"),
-                           get_metadata_val(insamples, "lavfi.silence_duration"));
-                }
-                silence->nb_null_samples = silence->start = 0;
-            }
-        }
+    switch (insamples->format) {
+    case AV_SAMPLE_FMT_DBL:
+        silencedetect_dbl(silence, insamples, nb_samples, nb_samples_notify, inlink->time_base);
+        break;
+    case AV_SAMPLE_FMT_FLT:
+        silencedetect_flt(silence, insamples, nb_samples, nb_samples_notify, inlink->time_base);
+        break;
+    case AV_SAMPLE_FMT_S32:
+        silencedetect_s32(silence, insamples, nb_samples, nb_samples_notify, inlink->time_base);
+        break;
+    case AV_SAMPLE_FMT_S16:
+        silencedetect_s16(silence, insamples, nb_samples, nb_samples_notify, inlink->time_base);
+        break;
     }
 
     return ff_filter_frame(inlink->dst->outputs[0], insamples);
@@ -133,6 +167,9 @@ static int query_formats(AVFilterContext *ctx)
     AVFilterChannelLayouts *layouts = NULL;
     static const enum AVSampleFormat sample_fmts[] = {
         AV_SAMPLE_FMT_DBL,
+        AV_SAMPLE_FMT_FLT,
+        AV_SAMPLE_FMT_S32,
+        AV_SAMPLE_FMT_S16,
         AV_SAMPLE_FMT_NONE
     };
 
@@ -199,6 +199,7 @@ static void volume_init(VolumeContext *vol)
         break;
     case AV_SAMPLE_FMT_FLT:
         avpriv_float_dsp_init(&vol->fdsp, 0);
+        vol->scale_samples_flt = vol->fdsp.vector_fmul_scalar;
         vol->samples_align = 4;
         break;
     case AV_SAMPLE_FMT_DBL:
@@ -207,6 +208,8 @@ static void volume_init(VolumeContext *vol)
         break;
     }
 
+    if (ARCH_ARM)
+        ff_volume_init_arm(vol);
     if (ARCH_X86)
         ff_volume_init_x86(vol);
 }
@@ -262,9 +265,9 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *buf)
             }
         } else if (av_get_packed_sample_fmt(vol->sample_fmt) == AV_SAMPLE_FMT_FLT) {
             for (p = 0; p < vol->planes; p++) {
-                vol->fdsp.vector_fmul_scalar((float *)out_buf->extended_data[p],
-                                             (const float *)buf->extended_data[p],
-                                             vol->volume, plane_samples);
+                vol->scale_samples_flt((float *)out_buf->extended_data[p],
+                                       (const float *)buf->extended_data[p],
+                                       vol->volume, plane_samples);
             }
         } else {
             for (p = 0; p < vol->planes; p++) {
@@ -273,6 +276,10 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *buf)
                                              vol->volume, plane_samples);
             }
         }
+    } else if (out_buf == buf) {
+        /* a new buffer is already silent, the input one must be cleared */
+        av_samples_set_silence(out_buf->extended_data, 0, nb_samples,
+                               vol->channels, buf->format);
     }
 
     if (buf != out_buf)
@@ -47,9 +47,12 @@ typedef struct VolumeContext {
 
     void (*scale_samples)(uint8_t *dst, const uint8_t *src, int nb_samples,
                           int volume);
+    void (*scale_samples_flt)(float *dst, const float *src, float volume,
+                              int nb_samples);
     int samples_align;
 } VolumeContext;
 
+void ff_volume_init_arm(VolumeContext *vol);
 void ff_volume_init_x86(VolumeContext *vol);
 
 #endif /* AVFILTER_AF_VOLUME_H */
@@ -0,0 +1,47 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/cpu.h"
+#include "libavutil/samplefmt.h"
+#include "libavutil/arm/cpu.h"
+#include "libavfilter/af_volume.h"
+
+void ff_scale_samples_s16_neon(uint8_t *dst, const uint8_t *src, int len,
+                               int volume);
+void ff_scale_samples_s32_neon(uint8_t *dst, const uint8_t *src, int len,
+                               int volume);
+
+void ff_volume_init_arm(VolumeContext *vol)
+{
+    int cpu_flags = av_get_cpu_flags();
+    enum AVSampleFormat sample_fmt = av_get_packed_sample_fmt(vol->sample_fmt);
+
+    if (!have_neon(cpu_flags))
+        return;
+
+    if (sample_fmt == AV_SAMPLE_FMT_S16) {
+        if (vol->volume_i < 0x10000) {
+            vol->scale_samples = ff_scale_samples_s16_neon;
+            vol->samples_align = 8;
+        }
+    } else if (sample_fmt == AV_SAMPLE_FMT_S32) {
+        vol->scale_samples = ff_scale_samples_s32_neon;
+        vol->samples_align = 4;
+    }
+}
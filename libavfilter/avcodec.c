@@ -144,6 +144,7 @@ int avfilter_copy_buf_props(AVFrame *dst, const AVFilterBufferRef *src)
     dst->pts     = src->pts;
     dst->format  = src->format;
     av_frame_set_pkt_pos(dst, src->pos);
+    av_frame_set_metadata(dst, src->metadata);
 
     switch (src->type) {
     case AVMEDIA_TYPE_VIDEO:
@@ -43,6 +43,9 @@ int avfilter_copy_frame_props(AVFilterBufferRef *dst, const AVFrame *src);
  * Copy the frame properties and data pointers of src to dst, without copying
  * the actual data.
  *
+ * The metadata dictionary of dst is set to the one of src, it is not
+ * duplicated and stays owned by src.
+ *
  * @return 0 on success, a negative number on error.
  */
 int avfilter_copy_buf_props(AVFrame *dst, const AVFilterBufferRef *src);
@@ -119,6 +122,12 @@ int avfilter_fill_frame_from_buffer_ref(AVFrame *frame,
 /**
  * Add frame data to buffer_src.
  *
+ * The data of reference counted video frames is passed on without copying.
+ * Frames in hardware accelerated pixel formats cannot be copied and must
+ * be reference counted, buf[0] then keeps the surface alive for as long
+ * as the filter graph uses it. Such frames can only go through filters
+ * with the AVFILTER_FLAG_HWFRAME_AWARE flag.
+ *
  * @param buffer_src  pointer to a buffer source context
  * @param frame       a frame, or NULL to mark EOF
  * @param flags       a combination of AV_BUFFERSRC_FLAG_*
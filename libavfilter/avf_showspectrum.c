@@ -45,6 +45,14 @@ typedef struct {
     int filled;                 ///< number of samples (per channel) filled in current rdft_buffer
     int consumed;               ///< number of samples (per channel) consumed from the input frame
     float *window_func_lut;     ///< Window function LUT
+    uint8_t *magnitude;         ///< scaled magnitudes of the current column, per channel
+    uint8_t *column;            ///< RGB values of the current column, from top to bottom
+    int single_pic;             ///< render the whole input into one picture
+    uint8_t *bins;              ///< merged columns of the single picture
+    int nb_bins;                ///< number of bins in use, the last one may be partial
+    int bin_size;               ///< number of columns in a complete bin
+    int bin_fill;               ///< number of columns in the last bin
+    int64_t first_pts;
 } ShowSpectrumContext;
 
 #define OFFSET(x) offsetof(ShowSpectrumContext, x)
@@ -54,6 +62,7 @@ static const AVOption showspectrum_options[] = {
     { "size", "set video size", OFFSET(w), AV_OPT_TYPE_IMAGE_SIZE, {.str = "640x480"}, 0, 0, FLAGS },
     { "s",    "set video size", OFFSET(w), AV_OPT_TYPE_IMAGE_SIZE, {.str = "640x480"}, 0, 0, FLAGS },
     { "slide", "set sliding mode", OFFSET(sliding), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, FLAGS },
+    { "single_pic", "render the whole input into a single picture", OFFSET(single_pic), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, FLAGS },
     { NULL },
 };
 
@@ -80,6 +89,9 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_rdft_end(showspectrum->rdft);
     av_freep(&showspectrum->rdft_data);
     av_freep(&showspectrum->window_func_lut);
+    av_freep(&showspectrum->magnitude);
+    av_freep(&showspectrum->column);
+    av_freep(&showspectrum->bins);
     avfilter_unref_bufferp(&showspectrum->outpicref);
 }
 
@@ -173,6 +185,27 @@ static int config_output(AVFilterLink *outlink)
     if (showspectrum->xpos >= outlink->w)
         showspectrum->xpos = 0;
 
+    av_freep(&showspectrum->magnitude);
+    av_freep(&showspectrum->column);
+    showspectrum->magnitude = av_malloc(2 * outlink->h);
+    showspectrum->column    = av_malloc(3 * outlink->h);
+    if (!showspectrum->magnitude || !showspectrum->column)
+        return AVERROR(ENOMEM);
+
+    if (showspectrum->single_pic) {
+        /* at most 2 * w bins are kept: when they are all used, pairs of
+         * bins are merged, so the memory use does not depend on the
+         * input duration */
+        av_freep(&showspectrum->bins);
+        showspectrum->bins = av_malloc_array(2 * outlink->w, 3 * outlink->h);
+        if (!showspectrum->bins)
+            return AVERROR(ENOMEM);
+        showspectrum->nb_bins   = 0;
+        showspectrum->bin_size  = 1;
+        showspectrum->bin_fill  = 0;
+        showspectrum->first_pts = AV_NOPTS_VALUE;
+    }
+
     av_log(ctx, AV_LOG_VERBOSE, "s:%dx%d RDFT window size:%d\n",
            showspectrum->w, showspectrum->h, win_size);
     return 0;
@@ -191,6 +224,36 @@ inline static void push_frame(AVFilterLink *outlink)
     ff_filter_frame(outlink, avfilter_ref_buffer(showspectrum->outpicref, ~AV_PERM_WRITE));
 }
 
+static int push_single_pic(AVFilterLink *outlink)
+{
+    ShowSpectrumContext *showspectrum = outlink->src->priv;
+    AVFilterBufferRef *outpicref = showspectrum->outpicref;
+    const int col_size = 3 * outlink->h;
+    const int nb_bins = showspectrum->nb_bins;
+    uint8_t *column = showspectrum->column;
+    int x, y, b, i;
+
+    for (x = 0; x < outlink->w; x++) {
+        const int b0 = (int64_t)x * nb_bins / outlink->w;
+        const int b1 = FFMAX((int64_t)(x + 1) * nb_bins / outlink->w, b0 + 1);
+
+        memcpy(column, showspectrum->bins + b0 * col_size, col_size);
+        for (b = b0 + 1; b < b1; b++) {
+            const uint8_t *bin = showspectrum->bins + b * col_size;
+            for (i = 0; i < col_size; i++)
+                column[i] = FFMAX(column[i], bin[i]);
+        }
+        for (y = 0; y < outlink->h; y++)
+            memcpy(outpicref->data[0] + y * outpicref->linesize[0] + 3 * x,
+                   column + 3 * y, 3);
+    }
+
+    showspectrum->nb_bins = 0;
+    showspectrum->req_fullfilled = 1;
+    outpicref->pts = showspectrum->first_pts;
+    return ff_filter_frame(outlink, avfilter_ref_buffer(outpicref, ~AV_PERM_WRITE));
+}
+
 static int request_frame(AVFilterLink *outlink)
 {
     ShowSpectrumContext *showspectrum = outlink->src->priv;
@@ -202,11 +265,90 @@ static int request_frame(AVFilterLink *outlink)
         ret = ff_request_frame(inlink);
     } while (!showspectrum->req_fullfilled && ret >= 0);
 
-    if (ret == AVERROR_EOF && showspectrum->outpicref)
+    if (ret == AVERROR_EOF && showspectrum->single_pic) {
+        if (showspectrum->nb_bins) {
+            int err = push_single_pic(outlink);
+            if (err < 0)
+                return err;
+        }
+    } else if (ret == AVERROR_EOF && showspectrum->outpicref)
         push_frame(outlink);
     return ret;
 }
 
+/**
+ * Compute the colors of a new spectrum column from the RDFT output.
+ *
+ * The magnitudes are computed in a loop of their own which does not touch
+ * the picture, so that the compiler can vectorize it.
+ */
+static void calc_column(ShowSpectrumContext *showspectrum, FFTSample *data[2],
+                        int nb_display_channels, int h)
+{
+    const int nb_freq = 1 << (showspectrum->rdft_bits - 1);
+    const float scale = 1.f / nb_freq;
+    uint8_t *column = showspectrum->column;
+    int ch, y;
+
+    for (ch = 0; ch < nb_display_channels; ch++) {
+        const FFTSample *d = data[ch];
+        uint8_t *mag = showspectrum->magnitude + ch * h;
+
+        // FIXME: bin[0] contains first and last bins
+        for (y = 0; y < h; y++) {
+            const float re = d[2*y], im = d[2*y + 1];
+            const float v  = sqrtf(sqrtf((re*re + im*im) * scale));
+            mag[y] = FFMIN(v, 255);
+        }
+    }
+    if (nb_display_channels < 2)
+        memcpy(showspectrum->magnitude + h, showspectrum->magnitude, h);
+
+    for (y = 0; y < h; y++) {
+        const int a = showspectrum->magnitude[y];
+        const int b = showspectrum->magnitude[h + y];
+        uint8_t *p = column + 3 * (h - y - 1);
+
+        p[0] = a;
+        p[1] = b;
+        p[2] = (a + b) / 2;
+    }
+}
+
+/**
+ * Add the current column to the bins of the single picture.
+ */
+static void add_to_bins(ShowSpectrumContext *showspectrum, int h)
+{
+    const int col_size = 3 * h;
+    uint8_t *bin;
+    int b, i;
+
+    if (!showspectrum->bin_fill) {
+        if (showspectrum->nb_bins == 2 * showspectrum->w) {
+            /* merge pairs of bins to make room */
+            for (b = 0; b < showspectrum->w; b++) {
+                const uint8_t *b0 = showspectrum->bins +  2 * b      * col_size;
+                const uint8_t *b1 = showspectrum->bins + (2 * b + 1) * col_size;
+                bin = showspectrum->bins + b * col_size;
+                for (i = 0; i < col_size; i++)
+                    bin[i] = FFMAX(b0[i], b1[i]);
+            }
+            showspectrum->nb_bins   = showspectrum->w;
+            showspectrum->bin_size *= 2;
+        }
+        memcpy(showspectrum->bins + showspectrum->nb_bins * col_size,
+               showspectrum->column, col_size);
+        showspectrum->nb_bins++;
+    } else {
+        bin = showspectrum->bins + (showspectrum->nb_bins - 1) * col_size;
+        for (i = 0; i < col_size; i++)
+            bin[i] = FFMAX(bin[i], showspectrum->column[i]);
+    }
+    if (++showspectrum->bin_fill == showspectrum->bin_size)
+        showspectrum->bin_fill = 0;
+}
+
 static int plot_spectrum_column(AVFilterLink *inlink, AVFilterBufferRef *insamples, int nb_samples)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -244,17 +386,18 @@ static int plot_spectrum_column(AVFilterLink *inlink, AVFilterBufferRef *insampl
         for (ch = 0; ch < nb_display_channels; ch++)
             av_rdft_calc(showspectrum->rdft, data[ch]);
 
-        /* fill a new spectrum column */
-#define RE(ch) data[ch][2*y + 0]
-#define IM(ch) data[ch][2*y + 1]
-#define MAGNITUDE(re, im) sqrt((re)*(re) + (im)*(im))
+        calc_column(showspectrum, data, nb_display_channels, outlink->h);
 
+        if (showspectrum->single_pic) {
+            add_to_bins(showspectrum, outlink->h);
+            showspectrum->filled = 0;
+            return add_samples;
+        }
+
+        /* fill a new spectrum column */
         for (y = 0; y < outlink->h; y++) {
-            // FIXME: bin[0] contains first and last bins
-            uint8_t *p = outpicref->data[0] + (outlink->h - y - 1) * outpicref->linesize[0];
-            const double w = 1. / sqrt(nb_freq);
-            int a =                           sqrt(w * MAGNITUDE(RE(0), IM(0)));
-            int b = nb_display_channels > 1 ? sqrt(w * MAGNITUDE(RE(1), IM(1))) : a;
+            uint8_t *p = outpicref->data[0] + y * outpicref->linesize[0];
+            const uint8_t *c = showspectrum->column + 3 * y;
 
             if (showspectrum->sliding) {
                 memmove(p, p + 3, (outlink->w - 1) * 3);
@@ -262,12 +405,9 @@ static int plot_spectrum_column(AVFilterLink *inlink, AVFilterBufferRef *insampl
             } else {
                 p += showspectrum->xpos * 3;
             }
-
-            a = FFMIN(a, 255);
-            b = FFMIN(b, 255);
-            p[0] = a;
-            p[1] = b;
-            p[2] = (a + b) / 2;
+            p[0] = c[0];
+            p[1] = c[1];
+            p[2] = c[2];
         }
         outpicref->pts = insamples->pts +
             av_rescale_q(showspectrum->consumed,
@@ -285,6 +425,9 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *insamples)
     ShowSpectrumContext *showspectrum = ctx->priv;
     int left_samples = insamples->audio->nb_samples;
 
+    if (showspectrum->single_pic && showspectrum->first_pts == AV_NOPTS_VALUE)
+        showspectrum->first_pts = insamples->pts;
+
     showspectrum->consumed = 0;
     while (left_samples) {
         const int added_samples = plot_spectrum_column(inlink, insamples, left_samples);
@@ -32,6 +32,12 @@
 #include "video.h"
 #include "internal.h"
 
+enum ShowWavesMode {
+    MODE_POINT,
+    MODE_MINMAX,
+    MODE_NB,
+};
+
 typedef struct {
     const AVClass *class;
     int w, h;
@@ -42,6 +48,15 @@ typedef struct {
     int req_fullfilled;
     int n;
     int sample_count_mod;
+    enum ShowWavesMode mode;
+    int nb_channels;
+    int16_t *col_min, *col_max; ///< per channel extremes of the current column
+    int single_pic;             ///< render the whole input into one picture
+    int16_t *bin_min, *bin_max; ///< per channel extremes of each bin
+    int nb_bins;                ///< number of bins in use, the last one may be partial
+    int bin_size;               ///< number of samples in a complete bin
+    int bin_fill;               ///< number of samples in the last bin
+    int64_t first_pts;
 } ShowWavesContext;
 
 #define OFFSET(x) offsetof(ShowWavesContext, x)
@@ -53,6 +68,10 @@ static const AVOption showwaves_options[] = {
     { "size", "set video size", OFFSET(w), AV_OPT_TYPE_IMAGE_SIZE, {.str = "600x240"}, 0, 0, FLAGS },
     { "s",    "set video size", OFFSET(w), AV_OPT_TYPE_IMAGE_SIZE, {.str = "600x240"}, 0, 0, FLAGS },
     { "n",    "set how many samples to show in the same point", OFFSET(n), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, FLAGS },
+    { "mode", "select how the samples of a column are drawn", OFFSET(mode), AV_OPT_TYPE_INT, {.i64 = MODE_POINT}, 0, MODE_NB-1, FLAGS, "mode" },
+        { "point",  "draw a point for each sample",                   0, AV_OPT_TYPE_CONST, {.i64 = MODE_POINT},  0, 0, FLAGS, "mode" },
+        { "minmax", "draw a line between the extremes of the column", 0, AV_OPT_TYPE_CONST, {.i64 = MODE_MINMAX}, 0, 0, FLAGS, "mode" },
+    { "single_pic", "render the whole input into a single picture", OFFSET(single_pic), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, FLAGS },
     { NULL },
 };
 
@@ -78,6 +97,10 @@ static av_cold void uninit(AVFilterContext *ctx)
     ShowWavesContext *showwaves = ctx->priv;
 
     av_freep(&showwaves->rate_str);
+    av_freep(&showwaves->col_min);
+    av_freep(&showwaves->col_max);
+    av_freep(&showwaves->bin_min);
+    av_freep(&showwaves->bin_max);
     avfilter_unref_bufferp(&showwaves->outpicref);
 }
 
@@ -120,7 +143,37 @@ static int config_output(AVFilterLink *outlink)
     AVFilterContext *ctx = outlink->src;
     AVFilterLink *inlink = ctx->inputs[0];
     ShowWavesContext *showwaves = ctx->priv;
-    int err;
+    int i, err;
+
+    showwaves->nb_channels = av_get_channel_layout_nb_channels(inlink->channel_layout);
+    av_freep(&showwaves->col_min);
+    av_freep(&showwaves->col_max);
+    showwaves->col_min = av_malloc_array(showwaves->nb_channels, sizeof(*showwaves->col_min));
+    showwaves->col_max = av_malloc_array(showwaves->nb_channels, sizeof(*showwaves->col_max));
+    if (!showwaves->col_min || !showwaves->col_max)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < showwaves->nb_channels; i++) {
+        showwaves->col_min[i] = INT16_MAX;
+        showwaves->col_max[i] = INT16_MIN;
+    }
+
+    if (showwaves->single_pic) {
+        /* at most 2 * w bins are kept: when they are all used, pairs of
+         * bins are merged, so the memory use does not depend on the
+         * input duration */
+        av_freep(&showwaves->bin_min);
+        av_freep(&showwaves->bin_max);
+        showwaves->bin_min = av_malloc_array(2 * showwaves->w * showwaves->nb_channels,
+                                             sizeof(*showwaves->bin_min));
+        showwaves->bin_max = av_malloc_array(2 * showwaves->w * showwaves->nb_channels,
+                                             sizeof(*showwaves->bin_max));
+        if (!showwaves->bin_min || !showwaves->bin_max)
+            return AVERROR(ENOMEM);
+        showwaves->nb_bins   = 0;
+        showwaves->bin_size  = 1;
+        showwaves->bin_fill  = 0;
+        showwaves->first_pts = AV_NOPTS_VALUE;
+    }
 
     if (showwaves->n && showwaves->rate_str) {
         av_log(ctx, AV_LOG_ERROR, "Options 'n' and 'rate' cannot be set at the same time\n");
@@ -149,6 +202,25 @@ static int config_output(AVFilterLink *outlink)
     return 0;
 }
 
+#define MAX_INT16 ((1<<15) -1)
+
+/**
+ * Draw a vertical line between the positions of two sample values.
+ */
+static void draw_column(ShowWavesContext *showwaves, AVFilterBufferRef *outpicref,
+                        int x, int min, int max)
+{
+    const int h = showwaves->h;
+    const int linesize = outpicref->linesize[0];
+    const int v = 255 / showwaves->nb_channels;
+    int top    = FFMAX(h/2 - av_rescale(max, h/2, MAX_INT16), 0);
+    int bottom = FFMIN(h/2 - av_rescale(min, h/2, MAX_INT16), h - 1);
+    uint8_t *p = outpicref->data[0] + x + top * linesize;
+
+    for (; top <= bottom; top++, p += linesize)
+        *p += v;
+}
+
 inline static void push_frame(AVFilterLink *outlink)
 {
     ShowWavesContext *showwaves = outlink->src->priv;
@@ -159,6 +231,42 @@ inline static void push_frame(AVFilterLink *outlink)
     showwaves->buf_idx = 0;
 }
 
+static int push_single_pic(AVFilterLink *outlink)
+{
+    ShowWavesContext *showwaves = outlink->src->priv;
+    const int nb_channels = showwaves->nb_channels;
+    const int nb_bins = showwaves->nb_bins;
+    AVFilterBufferRef *outpicref;
+    int x, j, b;
+
+    outpicref = ff_get_video_buffer(outlink, AV_PERM_WRITE|AV_PERM_ALIGN,
+                                    outlink->w, outlink->h);
+    if (!outpicref)
+        return AVERROR(ENOMEM);
+    outpicref->video->w = outlink->w;
+    outpicref->video->h = outlink->h;
+    outpicref->pts = showwaves->first_pts;
+    memset(outpicref->data[0], 0, showwaves->h * outpicref->linesize[0]);
+
+    for (x = 0; x < outlink->w; x++) {
+        const int b0 = (int64_t)x * nb_bins / outlink->w;
+        const int b1 = FFMAX((int64_t)(x + 1) * nb_bins / outlink->w, b0 + 1);
+
+        for (j = 0; j < nb_channels; j++) {
+            int min = INT16_MAX, max = INT16_MIN;
+            for (b = b0; b < b1; b++) {
+                min = FFMIN(min, showwaves->bin_min[b * nb_channels + j]);
+                max = FFMAX(max, showwaves->bin_max[b * nb_channels + j]);
+            }
+            draw_column(showwaves, outpicref, x, min, max);
+        }
+    }
+
+    showwaves->nb_bins = 0;
+    showwaves->req_fullfilled = 1;
+    return ff_filter_frame(outlink, outpicref);
+}
+
 static int request_frame(AVFilterLink *outlink)
 {
     ShowWavesContext *showwaves = outlink->src->priv;
@@ -170,12 +278,67 @@ static int request_frame(AVFilterLink *outlink)
         ret = ff_request_frame(inlink);
     } while (!showwaves->req_fullfilled && ret >= 0);
 
-    if (ret == AVERROR_EOF && showwaves->outpicref)
+    if (ret == AVERROR_EOF && showwaves->nb_bins) {
+        int err = push_single_pic(outlink);
+        if (err < 0)
+            return err;
+    }
+    if (ret == AVERROR_EOF && showwaves->outpicref) {
+        if (showwaves->mode == MODE_MINMAX && showwaves->sample_count_mod) {
+            int j;
+            for (j = 0; j < showwaves->nb_channels; j++)
+                draw_column(showwaves, showwaves->outpicref, showwaves->buf_idx,
+                            showwaves->col_min[j], showwaves->col_max[j]);
+        }
         push_frame(outlink);
+    }
     return ret;
 }
 
-#define MAX_INT16 ((1<<15) -1)
+/**
+ * Add the samples to the bins of the single picture.
+ */
+static void add_to_bins(ShowWavesContext *showwaves, const int16_t *p, int nb_samples)
+{
+    const int nb_channels = showwaves->nb_channels;
+    int16_t *bin_min = showwaves->bin_min, *bin_max = showwaves->bin_max;
+    int i, j, b;
+
+    for (i = 0; i < nb_samples; i++) {
+        int16_t *cur_min, *cur_max;
+
+        if (!showwaves->bin_fill) {
+            if (showwaves->nb_bins == 2 * showwaves->w) {
+                /* merge pairs of bins to make room */
+                for (b = 0; b < showwaves->w; b++) {
+                    for (j = 0; j < nb_channels; j++) {
+                        bin_min[b * nb_channels + j] = FFMIN(bin_min[ 2 * b      * nb_channels + j],
+                                                             bin_min[(2 * b + 1) * nb_channels + j]);
+                        bin_max[b * nb_channels + j] = FFMAX(bin_max[ 2 * b      * nb_channels + j],
+                                                             bin_max[(2 * b + 1) * nb_channels + j]);
+                    }
+                }
+                showwaves->nb_bins   = showwaves->w;
+                showwaves->bin_size *= 2;
+            }
+            cur_min = bin_min + showwaves->nb_bins * nb_channels;
+            cur_max = bin_max + showwaves->nb_bins * nb_channels;
+            for (j = 0; j < nb_channels; j++)
+                cur_min[j] = cur_max[j] = p[j];
+            showwaves->nb_bins++;
+        } else {
+            cur_min = bin_min + (showwaves->nb_bins - 1) * nb_channels;
+            cur_max = bin_max + (showwaves->nb_bins - 1) * nb_channels;
+            for (j = 0; j < nb_channels; j++) {
+                cur_min[j] = FFMIN(cur_min[j], p[j]);
+                cur_max[j] = FFMAX(cur_max[j], p[j]);
+            }
+        }
+        p += nb_channels;
+        if (++showwaves->bin_fill == showwaves->bin_size)
+            showwaves->bin_fill = 0;
+    }
+}
 
 static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *insamples)
 {
@@ -186,11 +349,19 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *insamples)
     AVFilterBufferRef *outpicref = showwaves->outpicref;
     int linesize = outpicref ? outpicref->linesize[0] : 0;
     int16_t *p = (int16_t *)insamples->data[0];
-    int nb_channels = av_get_channel_layout_nb_channels(insamples->audio->channel_layout);
+    int nb_channels = showwaves->nb_channels;
     int i, j, h;
     const int n = showwaves->n;
     const int x = 255 / (nb_channels * n); /* multiplication factor, pre-computed to avoid in-loop divisions */
 
+    if (showwaves->single_pic) {
+        if (showwaves->first_pts == AV_NOPTS_VALUE)
+            showwaves->first_pts = insamples->pts;
+        add_to_bins(showwaves, p, nb_samples);
+        avfilter_unref_buffer(insamples);
+        return 0;
+    }
+
     /* draw data in the buffer */
     for (i = 0; i < nb_samples; i++) {
         if (!outpicref) {
@@ -208,13 +379,28 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *insamples)
             linesize = outpicref->linesize[0];
             memset(outpicref->data[0], 0, showwaves->h*linesize);
         }
-        for (j = 0; j < nb_channels; j++) {
-            h = showwaves->h/2 - av_rescale(*p++, showwaves->h/2, MAX_INT16);
-            if (h >= 0 && h < outlink->h)
-                *(outpicref->data[0] + showwaves->buf_idx + h * linesize) += x;
+        if (showwaves->mode == MODE_POINT) {
+            for (j = 0; j < nb_channels; j++) {
+                h = showwaves->h/2 - av_rescale(*p++, showwaves->h/2, MAX_INT16);
+                if (h >= 0 && h < outlink->h)
+                    *(outpicref->data[0] + showwaves->buf_idx + h * linesize) += x;
+            }
+        } else {
+            for (j = 0; j < nb_channels; j++, p++) {
+                showwaves->col_min[j] = FFMIN(showwaves->col_min[j], *p);
+                showwaves->col_max[j] = FFMAX(showwaves->col_max[j], *p);
+            }
         }
         showwaves->sample_count_mod++;
         if (showwaves->sample_count_mod == n) {
+            if (showwaves->mode == MODE_MINMAX) {
+                for (j = 0; j < nb_channels; j++) {
+                    draw_column(showwaves, outpicref, showwaves->buf_idx,
+                                showwaves->col_min[j], showwaves->col_max[j]);
+                    showwaves->col_min[j] = INT16_MAX;
+                    showwaves->col_max[j] = INT16_MIN;
+                }
+            }
             showwaves->sample_count_mod = 0;
             showwaves->buf_idx++;
         }
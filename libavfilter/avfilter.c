@@ -32,6 +32,7 @@
 #include "avfilter.h"
 #include "formats.h"
 #include "internal.h"
+#include "thread.h"
 #include "audio.h"
 
 char *ff_get_ref_perms_string(char *buf, size_t buf_size, int perms)
@@ -328,32 +329,87 @@ void ff_tlog_link(void *ctx, AVFilterLink *link, int end)
     }
 }
 
+/**
+ * Follow the chain of filters which forward frame requests to their first
+ * input, starting at link.
+ *
+ * @param depth set to the number of links the request is forwarded through
+ * @return the link whose source actually handles the request, or whose
+ *         source has no input
+ */
+static AVFilterLink *request_target(AVFilterLink *link, int *depth)
+{
+    *depth = 0;
+    while (!link->closed && !link->srcpad->request_frame &&
+           link->src->nb_inputs && link->src->inputs[0]) {
+        link = link->src->inputs[0];
+        (*depth)++;
+    }
+    return link;
+}
+
+/**
+ * Propagate EOF back along the first depth + 1 links of a request chain,
+ * as the recursive request would do when unwinding: the links are closed
+ * down to the one nearest to the source which still holds a partial audio
+ * buffer, which is then sent instead.
+ */
+static int request_frame_eof(AVFilterLink *link, int depth)
+{
+    AVFilterLink *flush = NULL, *l;
+    AVFilterBufferRef *pbuf;
+    int i, flush_index = -1;
+
+    for (i = 0, l = link; i <= depth; i++) {
+        if (l->partial_buf) {
+            flush       = l;
+            flush_index = i;
+        }
+        if (i < depth)
+            l = l->src->inputs[0];
+    }
+    for (i = 0, l = link; i <= depth; i++) {
+        if (i > flush_index)
+            l->closed = 1;
+        if (i < depth)
+            l = l->src->inputs[0];
+    }
+    if (!flush)
+        return AVERROR_EOF;
+    pbuf = flush->partial_buf;
+    flush->partial_buf = NULL;
+    ff_filter_samples_framed(flush, pbuf);
+    return 0;
+}
+
 int ff_request_frame(AVFilterLink *link)
 {
-    int ret = -1;
+    AVFilterLink *target;
+    int depth, ret = -1;
     FF_TPRINTF_START(NULL, request_frame); ff_tlog_link(NULL, link, 1);
 
-    if (link->closed)
-        return AVERROR_EOF;
-    if (link->srcpad->request_frame)
-        ret = link->srcpad->request_frame(link);
-    else if (link->src->inputs[0])
-        ret = ff_request_frame(link->src->inputs[0]);
-    if (ret == AVERROR_EOF && link->partial_buf) {
-        AVFilterBufferRef *pbuf = link->partial_buf;
-        link->partial_buf = NULL;
-        ff_filter_samples_framed(link, pbuf);
-        return 0;
-    }
-    if (ret == AVERROR_EOF)
-        link->closed = 1;
-    return ret;
+    /* Requests through filters without a request_frame() callback are
+       forwarded iteratively rather than recursively, so that long chains
+       of simple filters cost neither a stack frame nor a call each. */
+    target = request_target(link, &depth);
+    if (target->closed)
+        return depth ? request_frame_eof(link, depth - 1) : AVERROR_EOF;
+    if (target->srcpad->request_frame)
+        ret = target->srcpad->request_frame(target);
+    if (ret != AVERROR_EOF)
+        return ret;
+    return request_frame_eof(link, depth);
 }
 
 int ff_poll_frame(AVFilterLink *link)
 {
     int i, min = INT_MAX;
 
+    while (!link->srcpad->poll_frame && link->src->nb_inputs == 1) {
+        if (!link->src->inputs[0])
+            return -1;
+        link = link->src->inputs[0];
+    }
     if (link->srcpad->poll_frame)
         return link->srcpad->poll_frame(link);
 
@@ -374,8 +430,15 @@ void ff_update_link_current_pts(AVFilterLink *link, int64_t pts)
         return;
     link->current_pts = av_rescale_q(pts, link->time_base, AV_TIME_BASE_Q);
     /* TODO use duration */
-    if (link->graph && link->age_index >= 0)
-        ff_avfilter_graph_update_heap(link->graph, link);
+    if (link->graph && !link->dst->nb_outputs) {
+        /* sink links of concurrent branches share the heap */
+        if (HAVE_THREADS)
+            ff_graph_thread_lock(link->graph);
+        if (link->age_index >= 0)
+            ff_avfilter_graph_update_heap(link->graph, link);
+        if (HAVE_THREADS)
+            ff_graph_thread_unlock(link->graph);
+    }
 }
 
 int avfilter_process_command(AVFilterContext *filter, const char *cmd, const char *arg, char *res, int res_len, int flags)
@@ -650,3 +713,31 @@ int ff_filter_frame(AVFilterLink *link, AVFilterBufferRef *frame)
     default: return AVERROR(EINVAL);
     }
 }
+
+static int default_execute(AVFilterContext *ctx, avfilter_action_func *func,
+                           void *arg, int *ret, int nb_jobs)
+{
+    int i;
+
+    for (i = 0; i < nb_jobs; i++) {
+        int r = func(ctx, arg, i, nb_jobs);
+        if (ret)
+            ret[i] = r;
+    }
+    return 0;
+}
+
+int ff_filter_execute(AVFilterContext *ctx, avfilter_action_func *func,
+                      void *arg, int *ret, int nb_jobs)
+{
+    if (ctx->graph && ctx->graph->execute)
+        return ctx->graph->execute(ctx, func, arg, ret, nb_jobs);
+    return default_execute(ctx, func, arg, ret, nb_jobs);
+}
+
+int ff_filter_get_nb_threads(AVFilterContext *ctx)
+{
+    if (ctx->graph && ctx->graph->execute)
+        return ctx->graph->nb_threads;
+    return 1;
+}
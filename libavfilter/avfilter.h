@@ -406,6 +406,24 @@ const char *avfilter_pad_get_name(AVFilterPad *pads, int pad_idx);
  */
 enum AVMediaType avfilter_pad_get_type(AVFilterPad *pads, int pad_idx);
 
+/**
+ * The filter supports multithreading by splitting frames into multiple parts
+ * and processing them concurrently, see ff_filter_execute().
+ */
+#define AVFILTER_FLAG_SLICE_THREADS         (1 << 0)
+/**
+ * The filter never accesses the picture data of its video frames, so it
+ * can pass through frames in hardware accelerated pixel formats, whose
+ * data pointers are API specific surface handles. Only applies to filters
+ * using the default query_formats().
+ */
+#define AVFILTER_FLAG_HWFRAME_AWARE         (1 << 1)
+/**
+ * The filter can push frames to its outputs concurrently, on the worker
+ * threads of the graph, see ff_filter_execute().
+ */
+#define AVFILTER_FLAG_BRANCH_THREADS        (1 << 2)
+
 /**
  * Filter definition. This defines the pads a filter contains, and all the
  * callback functions used to interact with the filter.
@@ -477,8 +495,41 @@ typedef struct AVFilter {
     int (*init_opaque)(AVFilterContext *ctx, const char *args, void *opaque);
 
     const AVClass *priv_class;      ///< private class, containing filter specific options
+
+    /**
+     * A combination of AVFILTER_FLAG_*
+     */
+    int flags;
 } AVFilter;
 
+/**
+ * A function pointer passed to the AVFilterGraph.execute callback to be
+ * executed multiple times, possibly in parallel.
+ *
+ * @param ctx the filter context the job belongs to
+ * @param arg an opaque parameter passed through from the execute callback
+ * @param jobnr the index of the job being executed
+ * @param nb_jobs the total number of jobs
+ *
+ * @return 0 on success, a negative AVERROR on error
+ */
+typedef int (avfilter_action_func)(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs);
+
+/**
+ * A function executing multiple jobs, possibly in parallel.
+ *
+ * @param ctx the filter context to which the jobs belong
+ * @param func the function to be called multiple times
+ * @param arg the argument to be passed to func
+ * @param ret a nb_jobs-sized array to be filled with return values from each
+ *            invocation of func, may be NULL
+ * @param nb_jobs the number of jobs to execute
+ *
+ * @return 0 on success, a negative AVERROR on error
+ */
+typedef int (avfilter_execute_func)(AVFilterContext *ctx, avfilter_action_func *func,
+                                    void *arg, int *ret, int nb_jobs);
+
 /** An instance of a filter */
 struct AVFilterContext {
     const AVClass *av_class;        ///< needed for av_log()
@@ -504,6 +555,8 @@ struct AVFilterContext {
     void *priv;                     ///< private data for use by the filter
 
     struct AVFilterCommand *command_queue;
+
+    struct AVFilterGraph *graph;    ///< filtergraph this filter belongs to
 };
 
 /**
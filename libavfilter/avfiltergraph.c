@@ -32,12 +32,14 @@
 #include "avfiltergraph.h"
 #include "formats.h"
 #include "internal.h"
+#include "thread.h"
 
 #define OFFSET(x) offsetof(AVFilterGraph,x)
 
 static const AVOption options[]={
 {"scale_sws_opts"       , "default scale filter options"        , OFFSET(scale_sws_opts)        ,  AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, 0 },
 {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,  AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, 0 },
+{"threads"              , "maximum number of threads"           , OFFSET(nb_threads)            ,  AV_OPT_TYPE_INT,    {.i64 = 0   }, 0, INT_MAX, 0 },
 {0}
 };
 
@@ -56,6 +58,7 @@ AVFilterGraph *avfilter_graph_alloc(void)
     if (!ret)
         return NULL;
     ret->av_class = &filtergraph_class;
+    av_opt_set_defaults(ret);
     return ret;
 }
 
@@ -65,6 +68,8 @@ void avfilter_graph_free(AVFilterGraph **graph)
         return;
     for (; (*graph)->filter_count > 0; (*graph)->filter_count--)
         avfilter_free((*graph)->filters[(*graph)->filter_count - 1]);
+    if (HAVE_THREADS)
+        ff_graph_thread_free(*graph);
     av_freep(&(*graph)->sink_links);
     av_freep(&(*graph)->scale_sws_opts);
     av_freep(&(*graph)->aresample_swr_opts);
@@ -81,6 +86,7 @@ int avfilter_graph_add_filter(AVFilterGraph *graph, AVFilterContext *filter)
 
     graph->filters = filters;
     graph->filters[graph->filter_count++] = filter;
+    filter->graph = graph;
 
     return 0;
 }
@@ -523,6 +529,40 @@ do {                                                                   \
     }                                                                  \
 } while (0)
 
+/* Same as REDUCE_FORMATS, from the outputs of the filter to its inputs:
+ * if an output already has a single format, try to make the filter get it
+ * at its input, so that the conversion, if any, happens where it is really
+ * needed rather than once more inside or after this filter. */
+#define REDUCE_FORMATS_BACKWARD(fmt_type, list_type, list, var, nb)    \
+do {                                                                   \
+    for (i = 0; i < filter->nb_outputs; i++) {                         \
+        AVFilterLink *link = filter->outputs[i];                       \
+        fmt_type fmt;                                                  \
+                                                                       \
+        if (!link->in_ ## list || link->in_ ## list->nb != 1)          \
+            continue;                                                  \
+        fmt = link->in_ ## list->var[0];                               \
+                                                                       \
+        for (j = 0; j < filter->nb_inputs; j++) {                      \
+            AVFilterLink *in_link = filter->inputs[j];                 \
+            list_type *fmts;                                           \
+                                                                       \
+            if (link->type != in_link->type || !in_link->out_ ## list || \
+                in_link->out_ ## list->nb <= 1)                        \
+                continue;                                              \
+            fmts = in_link->out_ ## list;                              \
+                                                                       \
+            for (k = 0; k < fmts->nb; k++)                             \
+                if (fmts->var[k] == fmt) {                             \
+                    fmts->var[0]  = fmt;                               \
+                    fmts->nb = 1;                                      \
+                    ret = 1;                                           \
+                    break;                                             \
+                }                                                      \
+        }                                                              \
+    }                                                                  \
+} while (0)
+
 static int reduce_formats_on_filter(AVFilterContext *filter)
 {
     int i, j, k, ret = 0;
@@ -537,6 +577,20 @@ static int reduce_formats_on_filter(AVFilterContext *filter)
     return ret;
 }
 
+static int reduce_formats_backward_on_filter(AVFilterContext *filter)
+{
+    int i, j, k, ret = 0;
+
+    REDUCE_FORMATS_BACKWARD(int,      AVFilterFormats,        formats,
+                            formats,         format_count);
+    REDUCE_FORMATS_BACKWARD(int,      AVFilterFormats,        samplerates,
+                            formats,         format_count);
+    REDUCE_FORMATS_BACKWARD(uint64_t, AVFilterChannelLayouts, channel_layouts,
+                            channel_layouts, nb_channel_layouts);
+
+    return ret;
+}
+
 static void reduce_formats(AVFilterGraph *graph)
 {
     int i, reduced;
@@ -546,6 +600,12 @@ static void reduce_formats(AVFilterGraph *graph)
 
         for (i = 0; i < graph->filter_count; i++)
             reduced |= reduce_formats_on_filter(graph->filters[i]);
+        if (reduced)
+            continue;
+        /* only once the formats fixed by the sources are propagated,
+           propagate those fixed by the sinks */
+        for (i = graph->filter_count - 1; i >= 0; i--)
+            reduced |= reduce_formats_backward_on_filter(graph->filters[i]);
     } while (reduced);
 }
 
@@ -829,6 +889,44 @@ static int pick_formats(AVFilterGraph *graph)
     return 0;
 }
 
+/**
+ * Log the conversions done by the automatically inserted filters.
+ */
+static void report_conversions(AVFilterGraph *graph, AVClass *log_ctx)
+{
+    int i, nb_conversions = 0;
+
+    for (i = 0; i < graph->filter_count; i++) {
+        AVFilterContext *f = graph->filters[i];
+        AVFilterLink *in, *out;
+        char in_layout[64], out_layout[64];
+
+        if (!f->name || strncmp(f->name, "auto-inserted", 13) ||
+            f->nb_inputs != 1 || f->nb_outputs != 1)
+            continue;
+        in  = f->inputs[0];
+        out = f->outputs[0];
+        nb_conversions++;
+
+        if (in->type == AVMEDIA_TYPE_VIDEO) {
+            av_log(log_ctx, AV_LOG_VERBOSE, "%s between '%s' and '%s': %s -> %s\n",
+                   f->name, in->src->name, out->dst->name,
+                   av_get_pix_fmt_name(in->format), av_get_pix_fmt_name(out->format));
+        } else {
+            av_get_channel_layout_string(in_layout,  sizeof(in_layout),  -1, in->channel_layout);
+            av_get_channel_layout_string(out_layout, sizeof(out_layout), -1, out->channel_layout);
+            av_log(log_ctx, AV_LOG_VERBOSE,
+                   "%s between '%s' and '%s': %s %dHz %s -> %s %dHz %s\n",
+                   f->name, in->src->name, out->dst->name,
+                   av_get_sample_fmt_name(in->format), in->sample_rate, in_layout,
+                   av_get_sample_fmt_name(out->format), out->sample_rate, out_layout);
+        }
+    }
+    if (nb_conversions)
+        av_log(log_ctx, AV_LOG_VERBOSE, "%d conversion filter(s) inserted\n",
+               nb_conversions);
+}
+
 /**
  * Configure the formats of all the links in the graph.
  */
@@ -854,6 +952,8 @@ static int graph_config_formats(AVFilterGraph *graph, AVClass *log_ctx)
     if ((ret = pick_formats(graph)) < 0)
         return ret;
 
+    report_conversions(graph, log_ctx);
+
     return 0;
 }
 
@@ -937,6 +1037,23 @@ static int graph_insert_fifos(AVFilterGraph *graph, AVClass *log_ctx)
     return 0;
 }
 
+/**
+ * Start the worker threads of the graph if any of its filters can use them.
+ */
+static int graph_config_threads(AVFilterGraph *graph, AVClass *log_ctx)
+{
+    int i;
+
+    for (i = 0; i < graph->filter_count; i++)
+        if (graph->filters[i]->filter->flags & (AVFILTER_FLAG_SLICE_THREADS |
+                                                AVFILTER_FLAG_BRANCH_THREADS))
+            break;
+    if (i == graph->filter_count)
+        return 0;
+
+    return HAVE_THREADS ? ff_graph_thread_init(graph) : 0;
+}
+
 int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
 {
     int ret;
@@ -951,6 +1068,8 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
         return ret;
     if ((ret = ff_avfilter_graph_config_pointers(graphctx, log_ctx)))
         return ret;
+    if ((ret = graph_config_threads(graphctx, log_ctx)) < 0)
+        return ret;
 
     return 0;
 }
@@ -34,6 +34,14 @@ typedef struct AVFilterGraph {
 
     char *aresample_swr_opts; ///< swr options to use for the auto-inserted aresample filters, Access ONLY through AVOptions
 
+    /**
+     * Maximum number of threads used by filters in this graph. May be set by
+     * the caller before calling avfilter_graph_config(). 0 (the default)
+     * selects a number of threads automatically, 1 disables multithreading.
+     * Access ONLY through AVOptions ("threads").
+     */
+    int nb_threads;
+
     /**
      * Private fields
      *
@@ -45,6 +53,15 @@ typedef struct AVFilterGraph {
     int sink_links_count;
 
     unsigned disable_auto_convert;
+
+    void *thread_opaque;            ///< used by the threading code
+
+    /**
+     * Executes func on behalf of a multithreaded filter, set up by the
+     * threading code during avfilter_graph_config(). NULL if the graph runs
+     * single-threaded. Filters must use ff_filter_execute() instead.
+     */
+    avfilter_execute_func *execute;
 } AVFilterGraph;
 
 /**
@@ -21,6 +21,7 @@
  */
 
 #include "libavutil/channel_layout.h"
+#include "libavutil/atomic.h"
 #include "libavutil/avassert.h"
 #include "libavutil/common.h"
 #include "libavutil/imgutils.h"
@@ -88,7 +89,9 @@ AVFilterBufferRef *avfilter_ref_buffer(AVFilterBufferRef *ref, int pmask)
             ret->extended_data = ret->data;
     }
     ret->perms &= pmask;
-    ret->buf->refcount ++;
+    /* references to one buffer may be taken and dropped concurrently by
+       filter branches running on different threads */
+    avpriv_atomic_int_add_and_fetch((volatile int *)&ret->buf->refcount, 1);
     return ret;
 }
 
@@ -163,7 +166,7 @@ void avfilter_unref_buffer(AVFilterBufferRef *ref)
     if (!ref)
         return;
     av_assert0(ref->buf->refcount > 0);
-    if (!(--ref->buf->refcount)) {
+    if (!avpriv_atomic_int_add_and_fetch((volatile int *)&ref->buf->refcount, -1)) {
         if (!ref->buf->free) {
             store_in_pool(ref);
             return;
@@ -28,6 +28,7 @@
 #include "libavutil/fifo.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
 #include "libavutil/samplefmt.h"
 #include "audio.h"
 #include "avfilter.h"
@@ -64,6 +65,9 @@ typedef struct {
 #define CHECK_VIDEO_PARAM_CHANGE(s, c, width, height, format)\
     if (c->w != width || c->h != height || c->pix_fmt != format) {\
         av_log(s, AV_LOG_INFO, "Changing frame properties on the fly is not supported by all filters.\n");\
+        c->w       = width;\
+        c->h       = height;\
+        c->pix_fmt = format;\
     }
 
 #define CHECK_AUDIO_PARAM_CHANGE(s, c, srate, ch_layout, format)\
@@ -73,6 +77,79 @@ typedef struct {
         return AVERROR(EINVAL);\
     }
 
+static void free_frame_buffers(AVFilterBuffer *buf)
+{
+    AVBufferRef **refs = buf->priv;
+    int i;
+
+    for (i = 0; i < AV_NUM_DATA_POINTERS; i++)
+        av_buffer_unref(&refs[i]);
+    av_free(refs);
+    av_free(buf);
+}
+
+/**
+ * Check that every data plane of frame lies inside one of its buffers.
+ */
+static int frame_planes_in_buffers(const AVFrame *frame)
+{
+    int i, j;
+
+    for (i = 0; i < 4 && frame->data[i]; i++) {
+        for (j = 0; j < AV_NUM_DATA_POINTERS; j++) {
+            AVBufferRef *buf = av_frame_get_plane_buffer(frame, j);
+            if (!buf)
+                return 0;
+            if (frame->data[i] >= buf->data && frame->data[i] < buf->data + buf->size)
+                break;
+        }
+        if (j == AV_NUM_DATA_POINTERS)
+            return 0;
+    }
+    return 1;
+}
+
+/**
+ * Check whether the frame is in a hardware accelerated pixel format, its
+ * data pointers are then surface handles and not pointers to the planes.
+ */
+static int frame_is_hwaccel(const AVFrame *frame)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    return desc && desc->flags & PIX_FMT_HWACCEL;
+}
+
+/**
+ * Wrap the data of a reference counted video frame, without copying it.
+ */
+static AVFilterBufferRef *wrap_frame_buffers(const AVFrame *frame)
+{
+    AVFilterBufferRef *picref;
+    AVBufferRef **refs;
+    int i;
+
+    refs = av_mallocz(sizeof(*refs) * AV_NUM_DATA_POINTERS);
+    if (!refs)
+        return NULL;
+    for (i = 0; i < AV_NUM_DATA_POINTERS && av_frame_get_plane_buffer(frame, i); i++) {
+        if (!(refs[i] = av_buffer_ref(av_frame_get_plane_buffer(frame, i))))
+            goto fail;
+    }
+
+    picref = avfilter_get_video_buffer_ref_from_frame(frame, AV_PERM_READ | AV_PERM_PRESERVE);
+    if (!picref)
+        goto fail;
+    picref->buf->priv = refs;
+    picref->buf->free = free_frame_buffers;
+    return picref;
+
+fail:
+    for (i = 0; i < AV_NUM_DATA_POINTERS; i++)
+        av_buffer_unref(&refs[i]);
+    av_free(refs);
+    return NULL;
+}
+
 int av_buffersrc_add_frame(AVFilterContext *buffer_src,
                            const AVFrame *frame, int flags)
 {
@@ -82,6 +159,32 @@ int av_buffersrc_add_frame(AVFilterContext *buffer_src,
     if (!frame) /* NULL for EOF */
         return av_buffersrc_add_ref(buffer_src, NULL, flags);
 
+    if (buffer_src->outputs[0]->type == AVMEDIA_TYPE_VIDEO &&
+        frame_is_hwaccel(frame) && !av_frame_get_plane_buffer(frame, 0)) {
+        av_log(buffer_src, AV_LOG_ERROR, "Hardware frames cannot be copied, "
+               "the surface must be held by the frame buffers.\n");
+        return AVERROR(EINVAL);
+    }
+
+    if (buffer_src->outputs[0]->type == AVMEDIA_TYPE_VIDEO &&
+        av_frame_get_plane_buffer(frame, 0) &&
+        (frame_is_hwaccel(frame) || frame_planes_in_buffers(frame))) {
+        picref = wrap_frame_buffers(frame);
+        if (!picref)
+            return AVERROR(ENOMEM);
+        /* push separately so that picref is known to be queued on success */
+        ret = av_buffersrc_add_ref(buffer_src, picref,
+                                   (flags & ~AV_BUFFERSRC_FLAG_PUSH) | AV_BUFFERSRC_FLAG_NO_COPY);
+        if (ret < 0) {
+            avfilter_unref_buffer(picref);
+            return ret;
+        }
+        if ((flags & AV_BUFFERSRC_FLAG_PUSH) &&
+            (ret = buffer_src->output_pads[0].request_frame(buffer_src->outputs[0])) < 0)
+            return ret;
+        return 0;
+    }
+
     picref = avfilter_get_buffer_ref_from_frame(buffer_src->outputs[0]->type,
                                                 frame, AV_PERM_WRITE);
     if (!picref)
@@ -402,6 +402,63 @@ static void blend_pixel(uint8_t *dst, unsigned src, unsigned alpha,
     *dst = ((0x1010101 - alpha) * *dst + alpha * src) >> 24;
 }
 
+/* Same as blend_pixel() for 8-bit masks; mask points to the first sample. */
+static void blend_pixel8(uint8_t *dst, unsigned src, unsigned alpha,
+                         const uint8_t *mask, int mask_linesize,
+                         unsigned w, unsigned h, unsigned shift)
+{
+    unsigned x, y, t = 0;
+
+    for (y = 0; y < h; y++) {
+        for (x = 0; x < w; x++)
+            t += mask[x];
+        mask += mask_linesize;
+    }
+    /* a zero alpha leaves the pixel as it is */
+    if (!(t >>= shift))
+        return;
+    alpha = t * alpha;
+    *dst = ((0x1010101 - alpha) * *dst + alpha * src) >> 24;
+}
+
+/* Same as blend_line_hv() for 8-bit masks, as used by libass and
+ * antialiased glyphs; mostly empty masks are skipped quickly. */
+static void blend_line_hv8(uint8_t *dst, int dst_delta,
+                           unsigned src, unsigned alpha,
+                           const uint8_t *mask, int mask_linesize, int w,
+                           unsigned hsub, unsigned vsub,
+                           int xm, int left, int right, int hband)
+{
+    unsigned shift = hsub + vsub;
+    int x;
+
+    mask += xm;
+    if (!hsub && hband == 1) {
+        for (x = 0; x < w; x++) {
+            unsigned a = mask[x] >> shift;
+            if (a) {
+                a *= alpha;
+                *dst = ((0x1010101 - a) * *dst + a * src) >> 24;
+            }
+            dst += dst_delta;
+        }
+        return;
+    }
+    if (left) {
+        blend_pixel8(dst, src, alpha, mask, mask_linesize, left, hband, shift);
+        dst  += dst_delta;
+        mask += left;
+    }
+    for (x = 0; x < w; x++) {
+        blend_pixel8(dst, src, alpha, mask, mask_linesize,
+                     1 << hsub, hband, shift);
+        dst  += dst_delta;
+        mask += 1 << hsub;
+    }
+    if (right)
+        blend_pixel8(dst, src, alpha, mask, mask_linesize, right, hband, shift);
+}
+
 static void blend_line_hv(uint8_t *dst, int dst_delta,
                           unsigned src, unsigned alpha,
                           uint8_t *mask, int mask_linesize, int l2depth, int w,
@@ -410,6 +467,11 @@ static void blend_line_hv(uint8_t *dst, int dst_delta,
 {
     int x;
 
+    if (l2depth == 3) {
+        blend_line_hv8(dst, dst_delta, src, alpha, mask, mask_linesize, w,
+                       hsub, vsub, xm, left, right, hband);
+        return;
+    }
     if (left) {
         blend_pixel(dst, src, alpha, mask, mask_linesize, l2depth,
                     left, hband, hsub + vsub, xm);
@@ -99,6 +99,7 @@ typedef struct {
     struct rect gauge;              ///< rectangle for the gauge on the right
     AVFilterBufferRef *outpicref;   ///< output picture reference, updated regularly
     int meter;                      ///< select a EBU mode between +9 and +18
+    int metadata;                   ///< export the loudness values as frame metadata
     int scale_range;                ///< the range of LU values according to the meter
     int y_zero_lu;                  ///< the y value (pixel position) for 0 LU
     int *y_line_ref;                ///< y reference values for drawing the LU lines in the graph and the gauge
@@ -133,6 +134,7 @@ static const AVOption ebur128_options[] = {
     { "video", "set video output", OFFSET(do_video), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, V|F },
     { "size",  "set video size",   OFFSET(w), AV_OPT_TYPE_IMAGE_SIZE, {.str = "640x480"}, 0, 0, V|F },
     { "meter", "set scale meter (+9 to +18)",  OFFSET(meter), AV_OPT_TYPE_INT, {.i64 = 9}, 9, 18, V|F },
+    { "metadata", "inject metadata in the filtergraph", OFFSET(metadata), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, A|F },
     { NULL },
 };
 
@@ -436,9 +438,69 @@ static int gate_update(struct integrator *integ, double power,
     return gate_hist_pos;
 }
 
+/**
+ * Run the K-weighting filters on a run of samples of one channel and add
+ * their power to the integrators. The filter state is kept in locals for
+ * the whole run instead of going through the context for every sample.
+ */
+static void filter_channel(EBUR128Context *ebur128, int ch, const double *samples,
+                           int stride, int nb_samples)
+{
+    double *x = ebur128->x + ch * 3;
+    double *y = ebur128->y + ch * 3;
+    double *z = ebur128->z + ch * 3;
+    double x0 = x[0], x1 = x[1], x2 = x[2];
+    double y0 = y[0], y1 = y[1], y2 = y[2];
+    double z0 = z[0], z1 = z[1], z2 = z[2];
+    double sum_400  = ebur128->i400.sum[ch];
+    double sum_3000 = ebur128->i3000.sum[ch];
+    double *cache_400  = ebur128->i400.cache[ch];
+    double *cache_3000 = ebur128->i3000.cache[ch];
+    int pos_400  = ebur128->i400.cache_pos;
+    int pos_3000 = ebur128->i3000.cache_pos;
+    int i;
+
+    for (i = 0; i < nb_samples; i++) {
+        double bin;
+
+        /* Y[i] = X[i]*b0 + X[i-1]*b1 + X[i-2]*b2 - Y[i-1]*a1 - Y[i-2]*a2 */
+        x0 = *samples;
+        samples += stride;
+
+        // TODO: merge both filters in one?
+        y2 = y1;
+        y1 = y0;
+        y0 = x0*PRE_B0 + x1*PRE_B1 + x2*PRE_B2 - y1*PRE_A1 - y2*PRE_A2; // apply pre-filter
+        x2 = x1;
+        x1 = x0;
+        z2 = z1;
+        z1 = z0;
+        z0 = y0*RLB_B0 + y1*RLB_B1 + y2*RLB_B2 - z1*RLB_A1 - z2*RLB_A2; // apply RLB-filter
+
+        bin = z0 * z0;
+
+        /* add the new value, and limit the sum to the cache size (400ms or 3s)
+         * by removing the oldest one */
+        sum_400  = sum_400  + bin - cache_400 [pos_400 ];
+        sum_3000 = sum_3000 + bin - cache_3000[pos_3000];
+
+        /* override old cache entry with the new value */
+        cache_400 [pos_400 ] = bin;
+        cache_3000[pos_3000] = bin;
+        if (++pos_400  == I400_BINS)  pos_400  = 0;
+        if (++pos_3000 == I3000_BINS) pos_3000 = 0;
+    }
+
+    x[0] = x0; x[1] = x1; x[2] = x2;
+    y[0] = y0; y[1] = y1; y[2] = y2;
+    z[0] = z0; z[1] = z1; z[2] = z2;
+    ebur128->i400.sum[ch]  = sum_400;
+    ebur128->i3000.sum[ch] = sum_3000;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *insamples)
 {
-    int i, ch;
+    int i, ch, idx, run;
     AVFilterContext *ctx = inlink->dst;
     EBUR128Context *ebur128 = ctx->priv;
     const int nb_channels = ebur128->nb_channels;
@@ -446,66 +508,38 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *insamples)
     const double *samples = (double *)insamples->data[0];
     AVFilterBufferRef *pic = ebur128->outpicref;
 
-    for (i = 0; i < nb_samples; i++) {
-        const int bin_id_400  = ebur128->i400.cache_pos;
-        const int bin_id_3000 = ebur128->i3000.cache_pos;
-
-#define MOVE_TO_NEXT_CACHED_ENTRY(time) do {                \
-    ebur128->i##time.cache_pos++;                           \
-    if (ebur128->i##time.cache_pos == I##time##_BINS) {     \
-        ebur128->i##time.filled    = 1;                     \
-        ebur128->i##time.cache_pos = 0;                     \
-    }                                                       \
-} while (0)
-
-        MOVE_TO_NEXT_CACHED_ENTRY(400);
-        MOVE_TO_NEXT_CACHED_ENTRY(3000);
+    /* filter the samples up to the end of the next 100ms block at once */
+    for (idx = 0; idx < nb_samples; idx += run) {
+        run = FFMIN(nb_samples - idx, 4800 - ebur128->sample_count);
 
         for (ch = 0; ch < nb_channels; ch++) {
-            double bin;
-
             if (!ebur128->ch_weighting[ch])
                 continue;
+            filter_channel(ebur128, ch, samples + idx * nb_channels + ch,
+                           nb_channels, run);
+        }
 
-            /* Y[i] = X[i]*b0 + X[i-1]*b1 + X[i-2]*b2 - Y[i-1]*a1 - Y[i-2]*a2 */
-#define FILTER(Y, X, name) do {                                                 \
-            double *dst = ebur128->Y + ch*3;                                    \
-            double *src = ebur128->X + ch*3;                                    \
-            dst[2] = dst[1];                                                    \
-            dst[1] = dst[0];                                                    \
-            dst[0] = src[0]*name##_B0 + src[1]*name##_B1 + src[2]*name##_B2     \
-                                      - dst[1]*name##_A1 - dst[2]*name##_A2;    \
+#define MOVE_TO_NEXT_CACHED_ENTRIES(time) do {              \
+    ebur128->i##time.cache_pos += run;                      \
+    if (ebur128->i##time.cache_pos >= I##time##_BINS) {     \
+        ebur128->i##time.filled     = 1;                    \
+        ebur128->i##time.cache_pos -= I##time##_BINS;       \
+    }                                                       \
 } while (0)
 
-            ebur128->x[ch * 3] = *samples++; // set X[i]
-
-            // TODO: merge both filters in one?
-            FILTER(y, x, PRE);  // apply pre-filter
-            ebur128->x[ch * 3 + 2] = ebur128->x[ch * 3 + 1];
-            ebur128->x[ch * 3 + 1] = ebur128->x[ch * 3    ];
-            FILTER(z, y, RLB);  // apply RLB-filter
-
-            bin = ebur128->z[ch * 3] * ebur128->z[ch * 3];
-
-            /* add the new value, and limit the sum to the cache size (400ms or 3s)
-             * by removing the oldest one */
-            ebur128->i400.sum [ch] = ebur128->i400.sum [ch] + bin - ebur128->i400.cache [ch][bin_id_400];
-            ebur128->i3000.sum[ch] = ebur128->i3000.sum[ch] + bin - ebur128->i3000.cache[ch][bin_id_3000];
-
-            /* override old cache entry with the new value */
-            ebur128->i400.cache [ch][bin_id_400 ] = bin;
-            ebur128->i3000.cache[ch][bin_id_3000] = bin;
-        }
+        MOVE_TO_NEXT_CACHED_ENTRIES(400);
+        MOVE_TO_NEXT_CACHED_ENTRIES(3000);
 
         /* For integrated loudness, gating blocks are 400ms long with 75%
          * overlap (see BS.1770-2 p5), so a re-computation is needed each 100ms
          * (4800 samples at 48kHz). */
-        if (++ebur128->sample_count == 4800) {
+        ebur128->sample_count += run;
+        if (ebur128->sample_count == 4800) {
             double loudness_400, loudness_3000;
             double power_400 = 1e-12, power_3000 = 1e-12;
             AVFilterLink *outlink = ctx->outputs[0];
             const int64_t pts = insamples->pts +
-                av_rescale_q(i, (AVRational){ 1, inlink->sample_rate },
+                av_rescale_q(idx + run - 1, (AVRational){ 1, inlink->sample_rate },
                              outlink->time_base);
 
             ebur128->sample_count = 0;
@@ -630,7 +664,21 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *insamples)
                     return ret;
             }
 
-            av_log(ctx, ebur128->do_video ? AV_LOG_VERBOSE : AV_LOG_INFO,
+            if (ebur128->metadata) { /* the last block of the frame wins */
+                char metabuf[128];
+#define SET_META(name, var) do {                                            \
+    snprintf(metabuf, sizeof(metabuf), "%.3f", var);                        \
+    av_dict_set(&insamples->metadata, "lavfi.r128." name, metabuf, 0);      \
+} while (0)
+                SET_META("M",        loudness_400);
+                SET_META("S",        loudness_3000);
+                SET_META("I",        ebur128->integrated_loudness);
+                SET_META("LRA",      ebur128->loudness_range);
+                SET_META("LRA.low",  ebur128->lra_low);
+                SET_META("LRA.high", ebur128->lra_high);
+            }
+
+            av_log(ctx, ebur128->do_video || ebur128->metadata ? AV_LOG_VERBOSE : AV_LOG_INFO,
                    "t: %-10s " LOG_FMT "\n", av_ts2timestr(pts, &outlink->time_base),
                    loudness_400, loudness_3000,
                    ebur128->integrated_loudness, ebur128->loudness_range);
@@ -31,12 +31,9 @@
 #include "audio.h"
 #include "formats.h"
 #include "internal.h"
+#include "scene_sad.h"
 #include "video.h"
 
-#if CONFIG_AVCODEC
-#include "libavcodec/dsputil.h"
-#endif
-
 static const char *const var_names[] = {
     "TB",                ///< timebase
 
@@ -129,11 +126,9 @@ typedef struct {
     char *expr_str;
     double var_values[VAR_VARS_NB];
     int do_scene_detect;            ///< 1 if the expression requires scene detection variables, 0 otherwise
-#if CONFIG_AVCODEC
-    AVCodecContext *avctx;          ///< codec context required for the DSPContext (scene detect only)
-    DSPContext c;                   ///< context providing optimized SAD methods   (scene detect only)
+    int scene_luma;                 ///< use the luma plane for the scene score    (scene detect only)
+    ff_scene_sad_fn sad;            ///< sum of absolute differences               (scene detect only)
     double prev_mafd;               ///< previous MAFD                             (scene detect only)
-#endif
     AVFilterBufferRef *prev_picref; ///< previous frame                            (scene detect only)
     double select;
 } SelectContext;
@@ -143,6 +138,7 @@ typedef struct {
 static const AVOption options[] = {
     { "expr", "set selection expression", OFFSET(expr_str), AV_OPT_TYPE_STRING, {.str = "1"}, 0, 0, FLAGS },
     { "e",    "set selection expression", OFFSET(expr_str), AV_OPT_TYPE_STRING, {.str = "1"}, 0, 0, FLAGS },
+    { "scene_luma", "compute the scene score on every other line of the luma plane", OFFSET(scene_luma), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, FLAGS },
     {NULL},
 };
 
@@ -172,6 +168,22 @@ static av_cold int init(AVFilterContext *ctx, const char *args, const AVClass *c
 #define INTERLACE_TYPE_T 1
 #define INTERLACE_TYPE_B 2
 
+static int64_t scene_sad_c(const uint8_t *src1, int stride1,
+                           const uint8_t *src2, int stride2,
+                           int width, int height)
+{
+    int64_t sad = 0;
+    int x, y;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++)
+            sad += FFABS(src1[x] - src2[x]);
+        src1 += stride1;
+        src2 += stride2;
+    }
+    return sad;
+}
+
 static int config_input(AVFilterLink *inlink)
 {
     SelectContext *select = inlink->dst->priv;
@@ -206,18 +218,17 @@ static int config_input(AVFilterLink *inlink)
     select->var_values[VAR_SAMPLE_RATE] =
         inlink->type == AVMEDIA_TYPE_AUDIO ? inlink->sample_rate : NAN;
 
-#if CONFIG_AVCODEC
     if (select->do_scene_detect) {
-        select->avctx = avcodec_alloc_context3(NULL);
-        if (!select->avctx)
-            return AVERROR(ENOMEM);
-        dsputil_init(&select->c, select->avctx);
+        select->sad = scene_sad_c;
+        if (ARCH_X86) {
+            ff_scene_sad_fn sad = ff_scene_sad_get_fn_x86();
+            if (sad)
+                select->sad = sad;
+        }
     }
-#endif
     return 0;
 }
 
-#if CONFIG_AVCODEC
 static double get_scene_score(AVFilterContext *ctx, AVFilterBufferRef *picref)
 {
     double ret = 0;
@@ -226,25 +237,19 @@ static double get_scene_score(AVFilterContext *ctx, AVFilterBufferRef *picref)
 
     if (prev_picref &&
         picref->video->h    == prev_picref->video->h &&
-        picref->video->w    == prev_picref->video->w &&
-        picref->linesize[0] == prev_picref->linesize[0]) {
-        int x, y, nb_sad = 0;
-        int64_t sad = 0;
+        picref->video->w    == prev_picref->video->w) {
+        /* the 8x8 blocks starting before the last 8 samples of each
+         * dimension, in luma mode only every other line of them is used */
+        int width   = select->scene_luma ? picref->video->w : picref->video->w * 3;
+        int step    = select->scene_luma ? 2 : 1;
+        int nb_x    = FFMAX(width            - 8 + 7, 0) / 8;
+        int nb_y    = FFMAX(picref->video->h - 8 + 7, 0) / 8;
+        int nb_sad  = nb_x * 8 * nb_y * 8 / step;
+        int64_t sad = select->sad(     picref->data[0],      picref->linesize[0] * step,
+                                  prev_picref->data[0], prev_picref->linesize[0] * step,
+                                  nb_x * 8, nb_y * 8 / step);
         double mafd, diff;
-        uint8_t *p1 =      picref->data[0];
-        uint8_t *p2 = prev_picref->data[0];
-        const int linesize = picref->linesize[0];
-
-        for (y = 0; y < picref->video->h - 8; y += 8) {
-            for (x = 0; x < picref->video->w*3 - 8; x += 8) {
-                sad += select->c.sad[1](select, p1 + x, p2 + x,
-                                        linesize, 8);
-                nb_sad += 8 * 8;
-            }
-            p1 += 8 * linesize;
-            p2 += 8 * linesize;
-        }
-        emms_c();
+
         mafd = nb_sad ? sad / nb_sad : 0;
         diff = fabs(mafd - select->prev_mafd);
         ret  = av_clipf(FFMIN(mafd, diff) / 100., 0, 1);
@@ -254,7 +259,6 @@ static double get_scene_score(AVFilterContext *ctx, AVFilterBufferRef *picref)
     select->prev_picref = avfilter_ref_buffer(picref, ~0);
     return ret;
 }
-#endif
 
 #define D2TS(d)  (isnan(d) ? AV_NOPTS_VALUE : (int64_t)(d))
 #define TS2D(ts) ((ts) == AV_NOPTS_VALUE ? NAN : (double)(ts))
@@ -285,15 +289,12 @@ static int select_frame(AVFilterContext *ctx, AVFilterBufferRef *ref)
             !ref->video->interlaced ? INTERLACE_TYPE_P :
         ref->video->top_field_first ? INTERLACE_TYPE_T : INTERLACE_TYPE_B;
         select->var_values[VAR_PICT_TYPE] = ref->video->pict_type;
-#if CONFIG_AVCODEC
         if (select->do_scene_detect) {
             char buf[32];
             select->var_values[VAR_SCENE] = get_scene_score(ctx, ref);
-            // TODO: document metadata
             snprintf(buf, sizeof(buf), "%f", select->var_values[VAR_SCENE]);
             av_dict_set(&ref->metadata, "lavfi.scene_score", buf, 0);
         }
-#endif
         break;
     }
 
@@ -374,15 +375,8 @@ static av_cold void uninit(AVFilterContext *ctx)
     select->expr = NULL;
     av_opt_free(select);
 
-#if CONFIG_AVCODEC
-    if (select->do_scene_detect) {
+    if (select->do_scene_detect)
         avfilter_unref_bufferp(&select->prev_picref);
-        if (select->avctx) {
-            avcodec_close(select->avctx);
-            av_freep(&select->avctx);
-        }
-    }
-#endif
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -391,6 +385,19 @@ static int query_formats(AVFilterContext *ctx)
 
     if (!select->do_scene_detect) {
         return ff_default_query_formats(ctx);
+    } else if (select->scene_luma) {
+        /* the first plane of these is 8-bit luma */
+        static const enum AVPixelFormat pix_fmts[] = {
+            AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUVJ420P, AV_PIX_FMT_YUVA420P,
+            AV_PIX_FMT_YUV422P, AV_PIX_FMT_YUVJ422P,
+            AV_PIX_FMT_YUV444P, AV_PIX_FMT_YUVJ444P,
+            AV_PIX_FMT_YUV440P, AV_PIX_FMT_YUVJ440P,
+            AV_PIX_FMT_YUV411P, AV_PIX_FMT_YUV410P,
+            AV_PIX_FMT_NV12,    AV_PIX_FMT_NV21,
+            AV_PIX_FMT_GRAY8,
+            AV_PIX_FMT_NONE
+        };
+        ff_set_common_formats(ctx, ff_make_format_list(pix_fmts));
     } else {
         static const enum AVPixelFormat pix_fmts[] = {
             AV_PIX_FMT_RGB24, AV_PIX_FMT_BGR24,
@@ -460,18 +467,7 @@ AVFILTER_DEFINE_CLASS(select);
 
 static av_cold int select_init(AVFilterContext *ctx, const char *args)
 {
-    SelectContext *select = ctx->priv;
-    int ret;
-
-    if ((ret = init(ctx, args, &select_class)) < 0)
-        return ret;
-
-    if (select->do_scene_detect && !CONFIG_AVCODEC) {
-        av_log(ctx, AV_LOG_ERROR, "Scene detection is not available without libavcodec.\n");
-        return AVERROR(EINVAL);
-    }
-
-    return 0;
+    return init(ctx, args, &select_class);
 }
 
 static const AVFilterPad avfilter_vf_select_inputs[] = {
@@ -258,5 +258,6 @@ AVFilter avfilter_vf_setpts = {
 
     .inputs    = avfilter_vf_setpts_inputs,
     .outputs   = avfilter_vf_setpts_outputs,
+    .flags     = AVFILTER_FLAG_HWFRAME_AWARE,
 };
 #endif /* CONFIG_SETPTS_FILTER */
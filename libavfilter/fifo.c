@@ -272,6 +272,7 @@ AVFilter avfilter_vf_fifo = {
 
     .inputs    = avfilter_vf_fifo_inputs,
     .outputs   = avfilter_vf_fifo_outputs,
+    .flags     = AVFILTER_FLAG_HWFRAME_AWARE,
 };
 
 static const AVFilterPad avfilter_af_afifo_inputs[] = {
@@ -261,7 +261,7 @@ int ff_add_channel_layout(AVFilterChannelLayouts **l, uint64_t channel_layout)
     ADD_FORMAT(l, channel_layout, uint64_t, channel_layouts, nb_channel_layouts);
 }
 
-AVFilterFormats *ff_all_formats(enum AVMediaType type)
+static AVFilterFormats *all_formats(enum AVMediaType type, int hwaccel)
 {
     AVFilterFormats *ret = NULL;
     int fmt;
@@ -270,7 +270,7 @@ AVFilterFormats *ff_all_formats(enum AVMediaType type)
 
     for (fmt = 0; fmt < num_formats; fmt++) {
         const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
-        if ((type != AVMEDIA_TYPE_VIDEO) ||
+        if ((type != AVMEDIA_TYPE_VIDEO) || hwaccel ||
             (type == AVMEDIA_TYPE_VIDEO && !(desc->flags & PIX_FMT_HWACCEL)))
             ff_add_format(&ret, fmt);
     }
@@ -278,6 +278,11 @@ AVFilterFormats *ff_all_formats(enum AVMediaType type)
     return ret;
 }
 
+AVFilterFormats *ff_all_formats(enum AVMediaType type)
+{
+    return all_formats(type, 0);
+}
+
 const int64_t avfilter_all_channel_layouts[] = {
 #include "all_channel_layouts.inc"
     -1
@@ -449,7 +454,8 @@ int ff_default_query_formats(AVFilterContext *ctx)
                             ctx->outputs && ctx->outputs[0] ? ctx->outputs[0]->type :
                             AVMEDIA_TYPE_VIDEO;
 
-    ff_set_common_formats(ctx, ff_all_formats(type));
+    ff_set_common_formats(ctx, all_formats(type,
+                               ctx->filter->flags & AVFILTER_FLAG_HWFRAME_AWARE));
     if (type == AVMEDIA_TYPE_AUDIO) {
         ff_set_common_channel_layouts(ctx, ff_all_channel_layouts());
         ff_set_common_samplerates(ctx, ff_all_samplerates());
@@ -133,6 +133,11 @@ void ff_channel_layouts_unref(AVFilterChannelLayouts **ref);
 void ff_channel_layouts_changeref(AVFilterChannelLayouts **oldref,
                                   AVFilterChannelLayouts **newref);
 
+/**
+ * Set all formats of the media type of the filter pads on all its pads,
+ * including hardware accelerated pixel formats for filters with the
+ * AVFILTER_FLAG_HWFRAME_AWARE flag.
+ */
 int ff_default_query_formats(AVFilterContext *ctx);
 
 
@@ -157,6 +162,7 @@ int ff_add_format(AVFilterFormats **avff, int64_t fmt);
 
 /**
  * Return a list of all formats supported by FFmpeg for the given media type.
+ * Hardware accelerated pixel formats are not included.
  */
 AVFilterFormats *ff_all_formats(enum AVMediaType type);
 
@@ -381,4 +381,24 @@ int ff_buffersink_read_samples_compat(AVFilterContext *ctx, AVFilterBufferRef **
  */
 int ff_filter_frame(AVFilterLink *link, AVFilterBufferRef *frame);
 
+/**
+ * Run func nb_jobs times, possibly in parallel on the worker threads of the
+ * graph ctx belongs to. Jobs are executed sequentially on the calling thread
+ * if the graph has no worker threads.
+ *
+ * Only filters flagged with AVFILTER_FLAG_SLICE_THREADS may use this.
+ *
+ * @param ret an array of nb_jobs ints to store the return value of each job
+ *            into, may be NULL
+ * @return 0 on success, a negative AVERROR on error
+ */
+int ff_filter_execute(AVFilterContext *ctx, avfilter_action_func *func,
+                      void *arg, int *ret, int nb_jobs);
+
+/**
+ * Get the number of threads a filter can split its work into, 1 if it runs
+ * single-threaded.
+ */
+int ff_filter_get_nb_threads(AVFilterContext *ctx);
+
 #endif /* AVFILTER_INTERNAL_H */
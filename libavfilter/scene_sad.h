@@ -0,0 +1,37 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_SCENE_SAD_H
+#define AVFILTER_SCENE_SAD_H
+
+#include <stdint.h>
+
+/**
+ * Compute the sum of absolute differences between two areas of
+ * width x height 8-bit samples, width must be a multiple of 8.
+ */
+typedef int64_t (*ff_scene_sad_fn)(const uint8_t *src1, int stride1,
+                                   const uint8_t *src2, int stride2,
+                                   int width, int height);
+
+/**
+ * @return the fastest SAD function for the CPU, or NULL if there is none
+ */
+ff_scene_sad_fn ff_scene_sad_get_fn_x86(void);
+
+#endif /* AVFILTER_SCENE_SAD_H */
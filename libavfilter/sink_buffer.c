@@ -254,6 +254,7 @@ AVFilter avfilter_vsink_ffbuffersink = {
     .query_formats = vsink_query_formats,
     .inputs        = ffbuffersink_inputs,
     .outputs       = NULL,
+    .flags         = AVFILTER_FLAG_HWFRAME_AWARE,
 };
 
 static const AVFilterPad buffersink_inputs[] = {
@@ -276,6 +277,7 @@ AVFilter avfilter_vsink_buffersink = {
     .query_formats = vsink_query_formats,
     .inputs        = buffersink_inputs,
     .outputs       = NULL,
+    .flags         = AVFILTER_FLAG_HWFRAME_AWARE,
 };
 
 static int filter_frame(AVFilterLink *link, AVFilterBufferRef *samplesref)
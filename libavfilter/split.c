@@ -28,12 +28,20 @@
 #include "libavutil/internal.h"
 #include "libavutil/mem.h"
 #include "avfilter.h"
+#include "avfiltergraph.h"
 #include "audio.h"
 #include "internal.h"
 #include "video.h"
 
+typedef struct SplitContext {
+    int branch_threads;         ///< 1 if the outputs can be served concurrently, -1 if unknown
+    AVFilterBufferRef **refs;   ///< per output frame references for the jobs
+    int *rets;
+} SplitContext;
+
 static int split_init(AVFilterContext *ctx, const char *args)
 {
+    SplitContext *s = ctx->priv;
     int i, nb_outputs = 2;
 
     if (args) {
@@ -57,22 +65,134 @@ static int split_init(AVFilterContext *ctx, const char *args)
         ff_insert_outpad(ctx, i, &pad);
     }
 
+    s->branch_threads = -1;
+    s->refs = av_mallocz(sizeof(*s->refs) * nb_outputs);
+    s->rets = av_mallocz(sizeof(*s->rets) * nb_outputs);
+    if (!s->refs || !s->rets)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
 static void split_uninit(AVFilterContext *ctx)
 {
+    SplitContext *s = ctx->priv;
     int i;
 
     for (i = 0; i < ctx->nb_outputs; i++)
         av_freep(&ctx->output_pads[i].name);
+    av_freep(&s->refs);
+    av_freep(&s->rets);
+}
+
+/**
+ * Mark the filters fed by output out of ctx with out in owner, which is
+ * indexed like the filters of the graph.
+ *
+ * @return 0 if all of them have a single input and none of them is fed by
+ *         another output, which is then marked in owner, a negative value
+ *         otherwise
+ */
+static int mark_branch(AVFilterContext *ctx, AVFilterContext *f, int out, int *owner)
+{
+    AVFilterGraph *graph = ctx->graph;
+    int i, idx;
+
+    for (idx = 0; idx < graph->filter_count; idx++)
+        if (graph->filters[idx] == f)
+            break;
+    if (idx == graph->filter_count || f->nb_inputs != 1 ||
+        (owner[idx] >= 0 && owner[idx] != out))
+        return -1;
+    owner[idx] = out;
+
+    for (i = 0; i < f->nb_outputs; i++)
+        if (!f->outputs[i] || mark_branch(ctx, f->outputs[i]->dst, out, owner) < 0)
+            return -1;
+    return 0;
+}
+
+/**
+ * Check that the outputs of ctx feed disjoint chains of single input
+ * filters, which can then process the frames concurrently.
+ */
+static int branches_independent(AVFilterContext *ctx)
+{
+    int *owner, i, ret = 1;
+
+    if (!ctx->graph)
+        return 0;
+    owner = av_malloc(sizeof(*owner) * ctx->graph->filter_count);
+    if (!owner)
+        return 0;
+    for (i = 0; i < ctx->graph->filter_count; i++)
+        owner[i] = -1;
+    for (i = 0; i < ctx->nb_outputs && ret; i++)
+        if (!ctx->outputs[i] || mark_branch(ctx, ctx->outputs[i]->dst, i, owner) < 0)
+            ret = 0;
+    av_free(owner);
+
+    av_log(ctx, AV_LOG_DEBUG, "Outputs %s processed concurrently.\n",
+           ret ? "are" : "are not");
+    return ret;
+}
+
+static int filter_frame_job(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    SplitContext *s = ctx->priv;
+    AVFilterBufferRef *buf_out = s->refs[jobnr];
+
+    if (!buf_out)
+        return AVERROR_EOF;
+    s->refs[jobnr] = NULL;
+    return ff_filter_frame(ctx->outputs[jobnr], buf_out);
+}
+
+static int filter_frame_threaded(AVFilterContext *ctx, AVFilterBufferRef *frame)
+{
+    SplitContext *s = ctx->priv;
+    int i, ret = 0;
+
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        if (ctx->outputs[i]->closed)
+            continue;
+        s->refs[i] = avfilter_ref_buffer(frame, ~AV_PERM_WRITE);
+        if (!s->refs[i]) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+    }
+    avfilter_unref_bufferp(&frame);
+    if (ret < 0) {
+        for (i = 0; i < ctx->nb_outputs; i++)
+            avfilter_unref_bufferp(&s->refs[i]);
+        return ret;
+    }
+
+    ff_filter_execute(ctx, filter_frame_job, NULL, s->rets, ctx->nb_outputs);
+
+    ret = AVERROR_EOF;
+    for (i = 0; i < ctx->nb_outputs; i++) {
+        if (s->rets[i] < 0 && s->rets[i] != AVERROR_EOF)
+            return s->rets[i];
+        if (s->rets[i] != AVERROR_EOF)
+            ret = s->rets[i];
+    }
+    return ret;
 }
 
 static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *frame)
 {
     AVFilterContext *ctx = inlink->dst;
+    SplitContext *s = ctx->priv;
     int i, ret = AVERROR_EOF;
 
+    if (s->branch_threads < 0)
+        s->branch_threads = ff_filter_get_nb_threads(ctx) > 1 &&
+                            branches_independent(ctx);
+    if (s->branch_threads)
+        return filter_frame_threaded(ctx, frame);
+
     for (i = 0; i < ctx->nb_outputs; i++) {
         AVFilterBufferRef *buf_out;
 
@@ -109,8 +229,11 @@ AVFilter avfilter_vf_split = {
     .init   = split_init,
     .uninit = split_uninit,
 
+    .priv_size = sizeof(SplitContext),
+
     .inputs    = avfilter_vf_split_inputs,
     .outputs   = NULL,
+    .flags     = AVFILTER_FLAG_HWFRAME_AWARE | AVFILTER_FLAG_BRANCH_THREADS,
 };
 
 static const AVFilterPad avfilter_af_asplit_inputs[] = {
@@ -130,6 +253,9 @@ AVFilter avfilter_af_asplit = {
     .init   = split_init,
     .uninit = split_uninit,
 
+    .priv_size = sizeof(SplitContext),
+
     .inputs  = avfilter_af_asplit_inputs,
     .outputs = NULL,
+    .flags   = AVFILTER_FLAG_BRANCH_THREADS,
 };
@@ -46,6 +46,7 @@
 typedef struct {
     AVStream *st;
     int done;
+    int64_t discard_until; ///< frames before this pts are dropped after a seek, or AV_NOPTS_VALUE
 } MovieStream;
 
 typedef struct {
@@ -142,6 +143,22 @@ static AVStream *find_stream(void *log, AVFormatContext *avf, const char *spec)
     return found;
 }
 
+/**
+ * Drop the frames decoded from the keyframe preceding the seek point up to
+ * the seek point, so that the output starts exactly at the seek point.
+ *
+ * @param timestamp seek point in AV_TIME_BASE, including the start time
+ */
+static void start_preroll(AVFilterContext *ctx, int64_t timestamp)
+{
+    MovieContext *movie = ctx->priv;
+    int i;
+
+    for (i = 0; i < ctx->nb_outputs; i++)
+        movie->st[i].discard_until = av_rescale_q(timestamp, AV_TIME_BASE_Q,
+                                                  movie->st[i].st->time_base);
+}
+
 static int open_stream(void *log, MovieStream *st)
 {
     AVCodec *codec;
@@ -188,7 +205,7 @@ static av_cold int movie_common_init(AVFilterContext *ctx, const char *args, con
 {
     MovieContext *movie = ctx->priv;
     AVInputFormat *iformat = NULL;
-    int64_t timestamp;
+    int64_t timestamp = 0;
     int nb_streams, ret, i;
     char default_streams[16], *stream_specs, *spec, *cursor;
     char name[16];
@@ -280,6 +297,7 @@ static av_cold int movie_common_init(AVFilterContext *ctx, const char *args, con
             return AVERROR(EINVAL);
         st->discard = AVDISCARD_DEFAULT;
         movie->st[i].st = st;
+        movie->st[i].discard_until = AV_NOPTS_VALUE;
         movie->max_stream_index = FFMAX(movie->max_stream_index, st->index);
     }
     if (av_strtok(NULL, "+", &cursor))
@@ -318,6 +336,9 @@ static av_cold int movie_common_init(AVFilterContext *ctx, const char *args, con
         return AVERROR(ENOMEM);
     }
 
+    if (movie->seek_point > 0)
+        start_preroll(ctx, timestamp);
+
     av_log(ctx, AV_LOG_VERBOSE, "seek_point:%"PRIi64" format_name:%s file_name:%s stream_index:%d\n",
            movie->seek_point, movie->format_name, movie->file_name,
            movie->stream_index);
@@ -468,6 +489,8 @@ static int rewind_file(AVFilterContext *ctx)
         movie->st[i].done = 0;
     }
     movie->eof = 0;
+    if (movie->seek_point > 0)
+        start_preroll(ctx, timestamp);
     return 0;
 }
 
@@ -532,6 +555,14 @@ static int movie_push_frame(AVFilterContext *ctx, unsigned out_id)
     st = &movie->st[pkt_out_id];
     outlink = ctx->outputs[pkt_out_id];
 
+    /* the non-reference pictures before the seek point are not needed to
+     * decode the following ones; the loop filter is kept on the reference
+     * pictures, which would be corrupted without it */
+    if (st->discard_until != AV_NOPTS_VALUE)
+        st->st->codec->skip_frame = pkt->pts != AV_NOPTS_VALUE &&
+                                    pkt->pts < st->discard_until ?
+                                    AVDISCARD_NONREF : AVDISCARD_DEFAULT;
+
     switch (st->st->codec->codec_type) {
     case AVMEDIA_TYPE_VIDEO:
         ret = avcodec_decode_video2(st->st->codec, movie->frame, &got_frame, pkt);
@@ -563,6 +594,20 @@ static int movie_push_frame(AVFilterContext *ctx, unsigned out_id)
         return 0;
     }
 
+    if (st->discard_until != AV_NOPTS_VALUE) {
+        int64_t pts = av_frame_get_best_effort_timestamp(movie->frame);
+
+        /* audio frames are dropped when they end before the seek point */
+        if (pts != AV_NOPTS_VALUE && st->st->codec->codec_type == AVMEDIA_TYPE_AUDIO)
+            pts += av_rescale_q(movie->frame->nb_samples,
+                                (AVRational){ 1, st->st->codec->sample_rate },
+                                st->st->time_base) - 1;
+        if (pts != AV_NOPTS_VALUE && pts < st->discard_until)
+            return 0;
+        st->discard_until = AV_NOPTS_VALUE;
+        st->st->codec->skip_frame = AVDISCARD_DEFAULT;
+    }
+
     buf = frame_to_buf(st->st->codec->codec_type, movie->frame, outlink);
     if (!buf)
         return AVERROR(ENOMEM);
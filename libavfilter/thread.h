@@ -0,0 +1,46 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFILTER_THREAD_H
+#define AVFILTER_THREAD_H
+
+#include "avfilter.h"
+
+/**
+ * Start the worker threads of the graph, according to graph->nb_threads.
+ * If no more than one thread is requested, this is a no-op and the filters
+ * run their jobs sequentially on the calling thread.
+ *
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int ff_graph_thread_init(AVFilterGraph *graph);
+
+/**
+ * Lock and unlock the graph state which filters running concurrently on the
+ * worker threads may share, like the heap of sink links. No-ops if the graph
+ * has no worker threads.
+ */
+void ff_graph_thread_lock(AVFilterGraph *graph);
+void ff_graph_thread_unlock(AVFilterGraph *graph);
+
+/**
+ * Stop and join the worker threads of the graph, if any.
+ */
+void ff_graph_thread_free(AVFilterGraph *graph);
+
+#endif /* AVFILTER_THREAD_H */
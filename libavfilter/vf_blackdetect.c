@@ -42,6 +42,7 @@ typedef struct {
     double       picture_black_ratio_th;
     double       pixel_black_th;
     unsigned int pixel_black_th_i;
+    int          step;              ///< analyse one line out of step
 
     unsigned int frame_count;       ///< frame number
     unsigned int nb_black_pixels;   ///< number of black pixels counted so far
@@ -57,6 +58,7 @@ static const AVOption blackdetect_options[] = {
     { "pic_th",                 "set the picture black ratio threshold", OFFSET(picture_black_ratio_th), AV_OPT_TYPE_DOUBLE, {.dbl=.98}, 0, 1, FLAGS },
     { "pixel_black_th", "set the pixel black threshold", OFFSET(pixel_black_th), AV_OPT_TYPE_DOUBLE, {.dbl=.10}, 0, 1, FLAGS },
     { "pix_th",         "set the pixel black threshold", OFFSET(pixel_black_th), AV_OPT_TYPE_DOUBLE, {.dbl=.10}, 0, 1, FLAGS },
+    { "step",           "set the analysed line step",    OFFSET(step),           AV_OPT_TYPE_INT,    {.i64=1},   1, INT_MAX, FLAGS },
     { NULL },
 };
 
@@ -152,15 +154,17 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *picref)
     BlackDetectContext *blackdetect = ctx->priv;
     double picture_black_ratio = 0;
     const uint8_t *p = picref->data[0];
+    const int step = blackdetect->step;
     int x, i;
 
-    for (i = 0; i < inlink->h; i++) {
+    for (i = 0; i < inlink->h; i += step) {
         for (x = 0; x < inlink->w; x++)
             blackdetect->nb_black_pixels += p[x] <= blackdetect->pixel_black_th_i;
-        p += picref->linesize[0];
+        p += picref->linesize[0] * step;
     }
 
-    picture_black_ratio = (double)blackdetect->nb_black_pixels / (inlink->w * inlink->h);
+    picture_black_ratio = (double)blackdetect->nb_black_pixels /
+                          (inlink->w * ((inlink->h + step - 1) / step));
 
     av_log(ctx, AV_LOG_DEBUG,
            "frame:%u picture_black_ratio:%f pos:%"PRId64" pts:%s t:%s type:%c\n",
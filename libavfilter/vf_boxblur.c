@@ -70,7 +70,9 @@ typedef struct {
     int hsub, vsub;
     int radius[4];
     int power[4];
-    uint8_t *temp[2]; ///< temporary buffer used in blur_power()
+    uint8_t **temp;   ///< pairs of temporary buffers used in blur_power(), one per job
+    int nb_temp;      ///< number of pairs in temp
+    int temp_size;
 } BoxBlurContext;
 
 #define Y 0
@@ -118,8 +120,12 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     BoxBlurContext *boxblur = ctx->priv;
 
-    av_freep(&boxblur->temp[0]);
-    av_freep(&boxblur->temp[1]);
+    int i;
+
+    for (i = 0; i < 2 * boxblur->nb_temp; i++)
+        av_freep(&boxblur->temp[i]);
+    av_freep(&boxblur->temp);
+    boxblur->nb_temp = 0;
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -148,9 +154,8 @@ static int config_input(AVFilterLink *inlink)
     char *expr;
     int ret;
 
-    if (!(boxblur->temp[0] = av_malloc(FFMAX(w, h))) ||
-        !(boxblur->temp[1] = av_malloc(FFMAX(w, h))))
-        return AVERROR(ENOMEM);
+    uninit(ctx);
+    boxblur->temp_size = FFMAX(w, h);
 
     boxblur->hsub = desc->log2_chroma_w;
     boxblur->vsub = desc->log2_chroma_h;
@@ -302,16 +307,74 @@ static void vblur(uint8_t *dst, int dst_linesize, const uint8_t *src, int src_li
                    h, radius, power, temp);
 }
 
+typedef struct ThreadData {
+    AVFilterBufferRef *in, *out;
+    int w[4], h[4];
+} ThreadData;
+
+/* blur horizontally a slice of the rows of each plane */
+static int hblur_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    BoxBlurContext *boxblur = ctx->priv;
+    ThreadData *td = arg;
+    AVFilterBufferRef *in = td->in, *out = td->out;
+    int plane;
+
+    for (plane = 0; in->data[plane] && plane < 4; plane++) {
+        const int start = (td->h[plane] *  jobnr   ) / nb_jobs;
+        const int end   = (td->h[plane] * (jobnr+1)) / nb_jobs;
+
+        hblur(out->data[plane] + start * out->linesize[plane], out->linesize[plane],
+              in ->data[plane] + start * in ->linesize[plane], in ->linesize[plane],
+              td->w[plane], end - start, boxblur->radius[plane], boxblur->power[plane],
+              boxblur->temp + 2 * jobnr);
+    }
+    return 0;
+}
+
+/* blur vertically, in place, a slice of the columns of each plane */
+static int vblur_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    BoxBlurContext *boxblur = ctx->priv;
+    ThreadData *td = arg;
+    AVFilterBufferRef *out = td->out;
+    int plane;
+
+    for (plane = 0; td->in->data[plane] && plane < 4; plane++) {
+        const int start = (td->w[plane] *  jobnr   ) / nb_jobs;
+        const int end   = (td->w[plane] * (jobnr+1)) / nb_jobs;
+
+        vblur(out->data[plane] + start, out->linesize[plane],
+              out->data[plane] + start, out->linesize[plane],
+              end - start, td->h[plane], boxblur->radius[plane], boxblur->power[plane],
+              boxblur->temp + 2 * jobnr);
+    }
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *in)
 {
     AVFilterContext *ctx = inlink->dst;
     BoxBlurContext *boxblur = ctx->priv;
     AVFilterLink *outlink = inlink->dst->outputs[0];
     AVFilterBufferRef *out;
-    int plane;
+    ThreadData td;
+    int i, nb_jobs;
     int cw = inlink->w >> boxblur->hsub, ch = in->video->h >> boxblur->vsub;
-    int w[4] = { inlink->w, cw, cw, inlink->w };
-    int h[4] = { in->video->h, ch, ch, in->video->h };
+
+    if (!boxblur->nb_temp) {
+        int nb_temp = ff_filter_get_nb_threads(ctx);
+        if (!(boxblur->temp = av_mallocz(sizeof(*boxblur->temp) * 2 * nb_temp))) {
+            avfilter_unref_bufferp(&in);
+            return AVERROR(ENOMEM);
+        }
+        boxblur->nb_temp = nb_temp;
+        for (i = 0; i < 2 * nb_temp; i++)
+            if (!(boxblur->temp[i] = av_malloc(boxblur->temp_size))) {
+                avfilter_unref_bufferp(&in);
+                return AVERROR(ENOMEM);
+            }
+    }
 
     out = ff_get_video_buffer(outlink, AV_PERM_WRITE, outlink->w, outlink->h);
     if (!out) {
@@ -320,17 +383,16 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *in)
     }
     avfilter_copy_buffer_ref_props(out, in);
 
-    for (plane = 0; in->data[plane] && plane < 4; plane++)
-        hblur(out->data[plane], out->linesize[plane],
-              in ->data[plane], in ->linesize[plane],
-              w[plane], h[plane], boxblur->radius[plane], boxblur->power[plane],
-              boxblur->temp);
+    td.in   = in;
+    td.out  = out;
+    td.w[0] = td.w[3] = inlink->w;
+    td.w[1] = td.w[2] = cw;
+    td.h[0] = td.h[3] = in->video->h;
+    td.h[1] = td.h[2] = ch;
+    nb_jobs = FFMAX(1, FFMIN3(boxblur->nb_temp, cw, ch));
 
-    for (plane = 0; in->data[plane] && plane < 4; plane++)
-        vblur(out->data[plane], out->linesize[plane],
-              out->data[plane], out->linesize[plane],
-              w[plane], h[plane], boxblur->radius[plane], boxblur->power[plane],
-              boxblur->temp);
+    ff_filter_execute(ctx, hblur_slice, &td, NULL, nb_jobs);
+    ff_filter_execute(ctx, vblur_slice, &td, NULL, nb_jobs);
 
     avfilter_unref_bufferp(&in);
 
@@ -366,4 +428,5 @@ AVFilter avfilter_vf_boxblur = {
 
     .inputs    = avfilter_vf_boxblur_inputs,
     .outputs   = avfilter_vf_boxblur_outputs,
+    .flags     = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -37,6 +37,7 @@ typedef struct {
     int limit;
     int round;
     int reset_count;
+    int step;           ///< pixel step along the scanned lines
     int frame_nb;
     int max_pixsteps[4];
 } CropDetectContext;
@@ -60,9 +61,16 @@ static int checkline(void *ctx, const unsigned char *src, int stride, int len, i
 {
     int total = 0;
     int div = len;
+    int i;
 
     switch (bpp) {
     case 1:
+        if (stride == 1) {
+            /* contiguous, let the compiler vectorize it */
+            for (i = 0; i < len; i++)
+                total += src[i];
+            break;
+        }
         while (--len >= 0) {
             total += src[0];
             src += stride;
@@ -91,12 +99,19 @@ static av_cold int init(AVFilterContext *ctx, const char *args)
     cd->round = 0;
     cd->reset_count = 0;
     cd->frame_nb = -2;
+    cd->step = 1;
 
     if (args)
-        sscanf(args, "%d:%d:%d", &cd->limit, &cd->round, &cd->reset_count);
+        sscanf(args, "%d:%d:%d:%d", &cd->limit, &cd->round, &cd->reset_count,
+               &cd->step);
+
+    if (cd->step < 1) {
+        av_log(ctx, AV_LOG_ERROR, "Invalid step %d\n", cd->step);
+        return AVERROR(EINVAL);
+    }
 
-    av_log(ctx, AV_LOG_VERBOSE, "limit:%d round:%d reset_count:%d\n",
-           cd->limit, cd->round, cd->reset_count);
+    av_log(ctx, AV_LOG_VERBOSE, "limit:%d round:%d reset_count:%d step:%d\n",
+           cd->limit, cd->round, cd->reset_count, cd->step);
 
     return 0;
 }
@@ -122,6 +137,10 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *frame)
     AVFilterContext *ctx = inlink->dst;
     CropDetectContext *cd = ctx->priv;
     int bpp = cd->max_pixsteps[0];
+    int step = cd->step;
+    /* only every step-th pixel of each scanned row and column is used */
+    int row_len = (frame->video->w + step - 1) / step;
+    int col_len = (frame->video->h + step - 1) / step;
     int w, h, x, y, shrink_by;
 
     // ignore first 2 frames - they may be empty
@@ -136,28 +155,28 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *frame)
         }
 
         for (y = 0; y < cd->y1; y++) {
-            if (checkline(ctx, frame->data[0] + frame->linesize[0] * y, bpp, frame->video->w, bpp) > cd->limit) {
+            if (checkline(ctx, frame->data[0] + frame->linesize[0] * y, bpp * step, row_len, bpp) > cd->limit) {
                 cd->y1 = y;
                 break;
             }
         }
 
         for (y = frame->video->h-1; y > cd->y2; y--) {
-            if (checkline(ctx, frame->data[0] + frame->linesize[0] * y, bpp, frame->video->w, bpp) > cd->limit) {
+            if (checkline(ctx, frame->data[0] + frame->linesize[0] * y, bpp * step, row_len, bpp) > cd->limit) {
                 cd->y2 = y;
                 break;
             }
         }
 
         for (y = 0; y < cd->x1; y++) {
-            if (checkline(ctx, frame->data[0] + bpp*y, frame->linesize[0], frame->video->h, bpp) > cd->limit) {
+            if (checkline(ctx, frame->data[0] + bpp*y, frame->linesize[0] * step, col_len, bpp) > cd->limit) {
                 cd->x1 = y;
                 break;
             }
         }
 
         for (y = frame->video->w-1; y > cd->x2; y--) {
-            if (checkline(ctx, frame->data[0] + bpp*y, frame->linesize[0], frame->video->h, bpp) > cd->limit) {
+            if (checkline(ctx, frame->data[0] + bpp*y, frame->linesize[0] * step, col_len, bpp) > cd->limit) {
                 cd->x2 = y;
                 break;
             }
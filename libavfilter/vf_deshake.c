@@ -66,6 +66,7 @@
 enum SearchMethod {
     EXHAUSTIVE,        ///< Search all possible positions
     SMART_EXHAUSTIVE,  ///< Search most possible positions (faster)
+    HIERARCHICAL,      ///< Search at half resolution, then refine (fastest)
     SEARCH_COUNT
 };
 
@@ -104,6 +105,10 @@ typedef struct {
     int ch;
     int cx;
     int cy;
+    uint8_t *half[2];          ///< Half resolution luma of the reference and current frames
+    int half_stride;
+    IntMotionVector *mvs;      ///< Motion vector of each block, (-1, -1) if unusable
+    int nb_mvs;
 } DeshakeContext;
 
 static int cmp(const double *a, const double *b)
@@ -136,7 +141,8 @@ static double clean_mean(double *values, int count)
  * chooses the most likely shift by the smallest difference in blocks.
  */
 static void find_block_motion(DeshakeContext *deshake, uint8_t *src1,
-                              uint8_t *src2, int cx, int cy, int stride,
+                              uint8_t *src2, uint8_t *half1, uint8_t *half2,
+                              int cx, int cy, int stride, int half_stride,
                               IntMotionVector *mv)
 {
     int x, y;
@@ -182,6 +188,41 @@ static void find_block_motion(DeshakeContext *deshake, uint8_t *src1,
                 if (x == tmp && y == tmp2)
                     continue;
 
+                diff = CMP(cx - x, cy - y);
+                if (diff < smallest) {
+                    smallest = diff;
+                    mv->x = x;
+                    mv->y = y;
+                }
+            }
+        }
+    } else if (deshake->search == HIERARCHICAL) {
+        // Compare every position at half resolution, with 8 pixel wide blocks
+        const int hcx = cx >> 1, hcy = cy >> 1;
+
+        #define HCMP(i, j) deshake->c.sad[1](deshake, half1 + hcy * half_stride + hcx, \
+                                             half2 + (j) * half_stride + (i), half_stride, \
+                                             FFMAX(deshake->blocksize >> 1, 1))
+
+        mv->x = mv->y = 0;
+        for (y = -(deshake->ry >> 1); y <= deshake->ry >> 1; y++) {
+            for (x = -(deshake->rx >> 1); x <= deshake->rx >> 1; x++) {
+                diff = HCMP(hcx - x, hcy - y);
+                if (diff < smallest) {
+                    smallest = diff;
+                    mv->x = x;
+                    mv->y = y;
+                }
+            }
+        }
+
+        // Refine around the scaled up match at full resolution
+        tmp  = mv->x * 2;
+        tmp2 = mv->y * 2;
+        smallest = INT_MAX;
+
+        for (y = FFMAX(tmp2 - 1, -deshake->ry); y <= FFMIN(tmp2 + 1, deshake->ry); y++) {
+            for (x = FFMAX(tmp - 1, -deshake->rx); x <= FFMIN(tmp + 1, deshake->rx); x++) {
                 diff = CMP(cx - x, cy - y);
                 if (diff < smallest) {
                     smallest = diff;
@@ -244,6 +285,44 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
            diff;
 }
 
+typedef struct ThreadData {
+    uint8_t *src1, *src2;
+    uint8_t *half1, *half2;
+    int width, height, stride;
+    int nb_bx, nb_by;           ///< number of blocks in each direction
+} ThreadData;
+
+/**
+ * Find the motion vectors of a slice of the rows of blocks.
+ */
+static int find_motion_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DeshakeContext *deshake = ctx->priv;
+    ThreadData *td = arg;
+    const int by_start = (td->nb_by *  jobnr   ) / nb_jobs;
+    const int by_end   = (td->nb_by * (jobnr+1)) / nb_jobs;
+    int bx, by;
+
+    for (by = by_start; by < by_end; by++) {
+        const int y = deshake->ry + by * deshake->blocksize * 2;
+        for (bx = 0; bx < td->nb_bx; bx++) {
+            // We use a width of 16 here to match the libavcodec sad functions
+            const int x = deshake->rx + bx * 16;
+            IntMotionVector *mv = &deshake->mvs[by * td->nb_bx + bx];
+
+            // If the contrast is too low, just skip this block as it probably
+            // won't be very useful to us.
+            mv->x = mv->y = -1;
+            if (block_contrast(td->src2, x, y, td->stride, deshake->blocksize) > deshake->contrast) {
+                mv->x = mv->y = 0;
+                find_block_motion(deshake, td->src1, td->src2, td->half1, td->half2,
+                                  x, y, td->stride, deshake->half_stride, mv);
+            }
+        }
+    }
+    return 0;
+}
+
 /**
  * Find the estimated global motion for a scene given the most likely shift
  * for each block in the frame. The global motion is estimated to be the
@@ -251,14 +330,17 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
  * move one pixel to the right and two pixels down, this would yield a
  * motion vector (1, -2).
  */
-static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
+static void find_motion(AVFilterContext *ctx, uint8_t *src1, uint8_t *src2,
+                        uint8_t *half1, uint8_t *half2,
                         int width, int height, int stride, Transform *t)
 {
+    DeshakeContext *deshake = ctx->priv;
     int x, y;
-    IntMotionVector mv = {0, 0};
+    IntMotionVector mv;
     int counts[128][128];
     int count_max_value = 0;
-    int contrast;
+    ThreadData td;
+    int i;
 
     int pos;
     double *angles = av_malloc(sizeof(*angles) * width * height / (16 * deshake->blocksize));
@@ -272,26 +354,45 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
         }
     }
 
+    td.src1   = src1;
+    td.src2   = src2;
+    td.half1  = half1;
+    td.half2  = half2;
+    td.width  = width;
+    td.height = height;
+    td.stride = stride;
+    td.nb_bx  = FFMAX(0, (width  - 2 * deshake->rx - 16 + 15) / 16);
+    td.nb_by  = FFMAX(0, (height - 2 * deshake->ry - 2 * deshake->blocksize +
+                          2 * deshake->blocksize - 1) / (2 * deshake->blocksize));
+    if (td.nb_bx * td.nb_by > deshake->nb_mvs) {
+        av_freep(&deshake->mvs);
+        deshake->nb_mvs = 0;
+        if (!(deshake->mvs = av_malloc(sizeof(*deshake->mvs) * td.nb_bx * td.nb_by)) || !angles) {
+            av_free(angles);
+            t->vector.x = t->vector.y = t->angle = 0;
+            return;
+        }
+        deshake->nb_mvs = td.nb_bx * td.nb_by;
+    }
+
+    // Find motion for every block, the rows of blocks being independent
+    if (td.nb_by)
+        ff_filter_execute(ctx, find_motion_slice, &td, NULL,
+                          FFMIN(td.nb_by, ff_filter_get_nb_threads(ctx)));
+
     pos = 0;
-    // Find motion for every block and store the motion vector in the counts
-    for (y = deshake->ry; y < height - deshake->ry - (deshake->blocksize * 2); y += deshake->blocksize * 2) {
-        // We use a width of 16 here to match the libavcodec sad functions
-        for (x = deshake->rx; x < width - deshake->rx - 16; x += 16) {
-            // If the contrast is too low, just skip this block as it probably
-            // won't be very useful to us.
-            contrast = block_contrast(src2, x, y, stride, deshake->blocksize);
-            if (contrast > deshake->contrast) {
-                //av_log(NULL, AV_LOG_ERROR, "%d\n", contrast);
-                find_block_motion(deshake, src1, src2, x, y, stride, &mv);
-                if (mv.x != -1 && mv.y != -1) {
-                    counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
-                    if (x > deshake->rx && y > deshake->ry)
-                        angles[pos++] = block_angle(x, y, 0, 0, &mv);
-
-                    center_x += mv.x;
-                    center_y += mv.y;
-                }
-            }
+    // Store the motion vectors in the counts, in the order of the blocks
+    for (i = 0; i < td.nb_bx * td.nb_by; i++) {
+        x = deshake->rx + (i % td.nb_bx) * 16;
+        y = deshake->ry + (i / td.nb_bx) * deshake->blocksize * 2;
+        mv = deshake->mvs[i];
+        if (mv.x != -1 && mv.y != -1) {
+            counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
+            if (x > deshake->rx && y > deshake->ry)
+                angles[pos++] = block_angle(x, y, 0, 0, &mv);
+
+            center_x += mv.x;
+            center_y += mv.y;
         }
     }
 
@@ -411,14 +512,43 @@ static int config_props(AVFilterLink *link)
     deshake->avctx = avcodec_alloc_context3(NULL);
     dsputil_init(&deshake->c, deshake->avctx);
 
+    if (deshake->search == HIERARCHICAL) {
+        /* padded for the blocks at the edges of the search area */
+        deshake->half_stride = FFALIGN((link->w >> 1) + 32, 16);
+        av_freep(&deshake->half[0]);
+        av_freep(&deshake->half[1]);
+        if (!(deshake->half[0] = av_mallocz(deshake->half_stride * ((link->h >> 1) + 32))) ||
+            !(deshake->half[1] = av_mallocz(deshake->half_stride * ((link->h >> 1) + 32))))
+            return AVERROR(ENOMEM);
+    }
+
     return 0;
 }
 
+/**
+ * Downscale a plane by two in both directions, averaging each 2x2 group.
+ */
+static void downscale_half(uint8_t *dst, int dst_stride,
+                           const uint8_t *src, int src_stride, int w, int h)
+{
+    int x, y;
+
+    for (y = 0; y < h >> 1; y++) {
+        const uint8_t *s0 = src + 2 * y * src_stride, *s1 = s0 + src_stride;
+        for (x = 0; x < w >> 1; x++)
+            dst[x] = (s0[2 * x] + s0[2 * x + 1] + s1[2 * x] + s1[2 * x + 1] + 2) >> 2;
+        dst += dst_stride;
+    }
+}
+
 static av_cold void uninit(AVFilterContext *ctx)
 {
     DeshakeContext *deshake = ctx->priv;
 
     avfilter_unref_buffer(deshake->ref);
+    av_freep(&deshake->half[0]);
+    av_freep(&deshake->half[1]);
+    av_freep(&deshake->mvs);
     if (deshake->fp)
         fclose(deshake->fp);
     if (deshake->avctx)
@@ -435,6 +565,7 @@ static int filter_frame(AVFilterLink *link, AVFilterBufferRef *in)
     float matrix[9];
     float alpha = 2.0 / deshake->refcount;
     char tmp[256];
+    uint8_t *half1 = NULL, *half2 = NULL;
 
     out = ff_get_video_buffer(outlink, AV_PERM_WRITE, outlink->w, outlink->h);
     if (!out) {
@@ -443,9 +574,17 @@ static int filter_frame(AVFilterLink *link, AVFilterBufferRef *in)
     }
     avfilter_copy_buffer_ref_props(out, in);
 
+    if (deshake->search == HIERARCHICAL) {
+        downscale_half(deshake->half[1], deshake->half_stride,
+                       in->data[0], in->linesize[0], link->w, link->h);
+        half1 = deshake->half[deshake->ref ? 0 : 1];
+        half2 = deshake->half[1];
+    }
+
     if (deshake->cx < 0 || deshake->cy < 0 || deshake->cw < 0 || deshake->ch < 0) {
         // Find the most likely global motion for the current frame
-        find_motion(deshake, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
+        find_motion(link->dst, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0],
+                    half1, half2, link->w, link->h, in->linesize[0], &t);
     } else {
         uint8_t *src1 = (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0];
         uint8_t *src2 = in->data[0];
@@ -461,8 +600,12 @@ static int filter_frame(AVFilterLink *link, AVFilterBufferRef *in)
 
         src1 += deshake->cy * in->linesize[0] + deshake->cx;
         src2 += deshake->cy * in->linesize[0] + deshake->cx;
+        if (half1) {
+            half1 += (deshake->cy >> 1) * deshake->half_stride + (deshake->cx >> 1);
+            half2 += (deshake->cy >> 1) * deshake->half_stride + (deshake->cx >> 1);
+        }
 
-        find_motion(deshake, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+        find_motion(link->dst, src1, src2, half1, half2, deshake->cw, deshake->ch, in->linesize[0], &t);
     }
 
 
@@ -533,6 +676,7 @@ static int filter_frame(AVFilterLink *link, AVFilterBufferRef *in)
     // Store the current frame as the reference frame for calculating the
     // motion of the next frame
     deshake->ref = in;
+    FFSWAP(uint8_t *, deshake->half[0], deshake->half[1]);
 
     return ff_filter_frame(outlink, out);
 }
@@ -565,4 +709,5 @@ AVFilter avfilter_vf_deshake = {
     .query_formats = query_formats,
     .inputs        = deshake_inputs,
     .outputs       = deshake_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
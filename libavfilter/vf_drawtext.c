@@ -166,6 +166,10 @@ typedef struct {
     int tc24hmax;                   ///< 1 if timecode is wrapped to 24 hours, 0 otherwise
     int frame_id;
     int reload;                     ///< reload text file for each frame
+    char *layout_text;              ///< expanded text of the current layout, NULL if none
+    uint8_t *mask;                  ///< glyphs of the current layout, pre-composited
+    int mask_w, mask_h;             ///< size of the mask
+    int mask_x, mask_y;             ///< position of the mask relative to the text
 } DrawTextContext;
 
 #define OFFSET(x) offsetof(DrawTextContext, x)
@@ -546,6 +550,9 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     av_freep(&dtext->positions);
     dtext->nb_positions = 0;
+    av_freep(&dtext->layout_text);
+    av_freep(&dtext->mask);
+    dtext->mask_w = dtext->mask_h = 0;
 
     av_tree_enumerate(dtext->glyphs, NULL, NULL, glyph_enu_free);
     av_tree_destroy(dtext->glyphs);
@@ -784,21 +791,28 @@ static int expand_text(AVFilterContext *ctx)
     return 0;
 }
 
-static int draw_glyphs(DrawTextContext *dtext, AVFilterBufferRef *picref,
-                       int width, int height, const uint8_t rgbcolor[4], FFDrawColor *color, int x, int y)
+/**
+ * Render the glyphs of the current layout into a single alpha mask, so
+ * that they can be blended with one call per frame.
+ */
+static int render_mask(DrawTextContext *dtext)
 {
     char *text = dtext->expanded_text.str;
     uint32_t code = 0;
-    int i, x1, y1;
+    int i, x, y, x1, y1;
+    int x_min = INT_MAX, y_min = INT_MAX, x_max = INT_MIN, y_max = INT_MIN;
     uint8_t *p;
     Glyph *glyph = NULL;
 
+    av_freep(&dtext->mask);
+    dtext->mask_w = dtext->mask_h = 0;
+
     for (i = 0, p = text; *p; i++) {
         Glyph dummy = { 0 };
         GET_UTF8(code, *p++, continue;);
 
         /* skip new line chars, just go to new line */
-        if (code == '\n' || code == '\r' || code == '\t')
+        if (is_newline(code) || code == '\t')
             continue;
 
         dummy.code = code;
@@ -807,21 +821,67 @@ static int draw_glyphs(DrawTextContext *dtext, AVFilterBufferRef *picref,
         if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
             glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
             return AVERROR(EINVAL);
+        if (!glyph->bitmap.width || !glyph->bitmap.rows)
+            continue;
+
+        x_min = FFMIN(x_min, dtext->positions[i].x);
+        y_min = FFMIN(y_min, dtext->positions[i].y);
+        x_max = FFMAX(x_max, dtext->positions[i].x + glyph->bitmap.width);
+        y_max = FFMAX(y_max, dtext->positions[i].y + glyph->bitmap.rows);
+    }
+    if (x_min >= x_max || y_min >= y_max)
+        return 0;
+
+    if (!(dtext->mask = av_mallocz((x_max - x_min) * (y_max - y_min))))
+        return AVERROR(ENOMEM);
+    dtext->mask_x = x_min;
+    dtext->mask_y = y_min;
+    dtext->mask_w = x_max - x_min;
+    dtext->mask_h = y_max - y_min;
+
+    for (i = 0, p = text; *p; i++) {
+        Glyph dummy = { 0 };
+        GET_UTF8(code, *p++, continue;);
+
+        if (is_newline(code) || code == '\t')
+            continue;
 
-        x1 = dtext->positions[i].x+dtext->x+x;
-        y1 = dtext->positions[i].y+dtext->y+y;
+        dummy.code = code;
+        glyph = av_tree_find(dtext->glyphs, &dummy, (void *)glyph_cmp, NULL);
 
-        ff_blend_mask(&dtext->dc, color,
-                      picref->data, picref->linesize, width, height,
-                      glyph->bitmap.buffer, glyph->bitmap.pitch,
-                      glyph->bitmap.width, glyph->bitmap.rows,
-                      glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
-                      0, x1, y1);
+        x1 = dtext->positions[i].x - x_min;
+        y1 = dtext->positions[i].y - y_min;
+        for (y = 0; y < glyph->bitmap.rows; y++) {
+            const uint8_t *src = glyph->bitmap.buffer + y * glyph->bitmap.pitch;
+            uint8_t *dst = dtext->mask + (y1 + y) * dtext->mask_w + x1;
+
+            /* overlapping glyphs keep the highest coverage */
+            if (glyph->bitmap.pixel_mode == FT_PIXEL_MODE_MONO) {
+                for (x = 0; x < glyph->bitmap.width; x++)
+                    if (src[x >> 3] & (0x80 >> (x & 7)))
+                        dst[x] = 255;
+            } else {
+                for (x = 0; x < glyph->bitmap.width; x++)
+                    dst[x] = FFMAX(dst[x], src[x]);
+            }
+        }
     }
 
     return 0;
 }
 
+static void draw_glyphs(DrawTextContext *dtext, AVFilterBufferRef *picref,
+                        int width, int height, FFDrawColor *color, int x, int y)
+{
+    if (!dtext->mask)
+        return;
+
+    ff_blend_mask(&dtext->dc, color,
+                  picref->data, picref->linesize, width, height,
+                  dtext->mask, dtext->mask_w, dtext->mask_w, dtext->mask_h,
+                  3, 0, dtext->mask_x + dtext->x + x, dtext->mask_y + dtext->y + y);
+}
+
 static int draw_text(AVFilterContext *ctx, AVFilterBufferRef *picref,
                      int width, int height)
 {
@@ -871,6 +931,12 @@ static int draw_text(AVFilterContext *ctx, AVFilterBufferRef *picref,
     if (!av_bprint_is_complete(bp))
         return AVERROR(ENOMEM);
     text = dtext->expanded_text.str;
+
+    /* the layout only depends on the text, reuse it while it does not change */
+    if (dtext->layout_text && !strcmp(dtext->layout_text, text))
+        goto draw;
+    av_freep(&dtext->layout_text);
+
     if ((len = dtext->expanded_text.len) > dtext->nb_positions) {
         if (!(dtext->positions =
               av_realloc(dtext->positions, len*sizeof(*dtext->positions))))
@@ -948,6 +1014,12 @@ static int draw_text(AVFilterContext *ctx, AVFilterBufferRef *picref,
 
     dtext->var_values[VAR_LINE_H] = dtext->var_values[VAR_LH] = dtext->max_glyph_h;
 
+    if ((ret = render_mask(dtext)) < 0)
+        return ret;
+    if (!(dtext->layout_text = av_strdup(text)))
+        return AVERROR(ENOMEM);
+
+draw:
     dtext->x = dtext->var_values[VAR_X] = av_expr_eval(dtext->x_pexpr, dtext->var_values, &dtext->prng);
     dtext->y = dtext->var_values[VAR_Y] = av_expr_eval(dtext->y_pexpr, dtext->var_values, &dtext->prng);
     dtext->x = dtext->var_values[VAR_X] = av_expr_eval(dtext->x_pexpr, dtext->var_values, &dtext->prng);
@@ -956,8 +1028,8 @@ static int draw_text(AVFilterContext *ctx, AVFilterBufferRef *picref,
     if(!dtext->draw)
         return 0;
 
-    box_w = FFMIN(width - 1 , max_text_line_w);
-    box_h = FFMIN(height - 1, y + dtext->max_glyph_h);
+    box_w = FFMIN(width - 1 , dtext->var_values[VAR_TEXT_W]);
+    box_h = FFMIN(height - 1, dtext->var_values[VAR_TEXT_H]);
 
     /* draw box */
     if (dtext->draw_box)
@@ -965,15 +1037,11 @@ static int draw_text(AVFilterContext *ctx, AVFilterBufferRef *picref,
                            picref->data, picref->linesize, width, height,
                            dtext->x, dtext->y, box_w, box_h);
 
-    if (dtext->shadowx || dtext->shadowy) {
-        if ((ret = draw_glyphs(dtext, picref, width, height, dtext->shadowcolor.rgba,
-                               &dtext->shadowcolor, dtext->shadowx, dtext->shadowy)) < 0)
-            return ret;
-    }
+    if (dtext->shadowx || dtext->shadowy)
+        draw_glyphs(dtext, picref, width, height,
+                    &dtext->shadowcolor, dtext->shadowx, dtext->shadowy);
 
-    if ((ret = draw_glyphs(dtext, picref, width, height, dtext->fontcolor.rgba,
-                           &dtext->fontcolor, 0, 0)) < 0)
-        return ret;
+    draw_glyphs(dtext, picref, width, height, &dtext->fontcolor, 0, 0);
 
     return 0;
 }
@@ -236,9 +236,14 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *buf)
             AVFilterBufferRef *dup = avfilter_ref_buffer(buf_out, ~0);
 
             av_log(ctx, AV_LOG_DEBUG, "Duplicating frame.\n");
-            if (dup)
-                ret = write_to_fifo(s->fifo, dup);
-            else
+            if (dup) {
+                /* let the encoder know it can code the duplicate as a skip */
+                ret = av_dict_set(&dup->metadata, "lavfi.fps.duplicate", "1", 0);
+                if (ret >= 0)
+                    ret = write_to_fifo(s->fifo, dup);
+                else
+                    avfilter_unref_bufferp(&dup);
+            } else
                 ret = AVERROR(ENOMEM);
 
             if (ret < 0) {
@@ -28,6 +28,7 @@
 
 #include "avfilter.h"
 #include "formats.h"
+#include "hflip.h"
 #include "internal.h"
 #include "video.h"
 #include "libavutil/pixdesc.h"
@@ -35,11 +36,6 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/imgutils.h"
 
-typedef struct {
-    int max_step[4];    ///< max pixel step for each plane, expressed as a number of bytes
-    int hsub, vsub;     ///< chroma subsampling
-} FlipContext;
-
 static int query_formats(AVFilterContext *ctx)
 {
     static const enum AVPixelFormat pix_fmts[] = {
@@ -74,15 +70,62 @@ static int query_formats(AVFilterContext *ctx)
     return 0;
 }
 
+static void hflip_byte_c(const uint8_t *src, uint8_t *dst, int w)
+{
+    int j;
+    for (j = 0; j < w; j++)
+        dst[j] = src[-j];
+}
+
+static void hflip_short_c(const uint8_t *src, uint8_t *dst, int w)
+{
+    const uint16_t *src16 = (const uint16_t *)src;
+    uint16_t *dst16 = (uint16_t *)dst;
+    int j;
+    for (j = 0; j < w; j++)
+        dst16[j] = src16[-j];
+}
+
+static void hflip_b24_c(const uint8_t *src, uint8_t *dst, int w)
+{
+    int j;
+    for (j = 0; j < w; j++, dst += 3, src -= 3) {
+        int32_t v = AV_RB24(src);
+        AV_WB24(dst, v);
+    }
+}
+
+static void hflip_dword_c(const uint8_t *src, uint8_t *dst, int w)
+{
+    const uint32_t *src32 = (const uint32_t *)src;
+    uint32_t *dst32 = (uint32_t *)dst;
+    int j;
+    for (j = 0; j < w; j++)
+        dst32[j] = src32[-j];
+}
+
 static int config_props(AVFilterLink *inlink)
 {
     FlipContext *flip = inlink->dst->priv;
     const AVPixFmtDescriptor *pix_desc = av_pix_fmt_desc_get(inlink->format);
+    int i;
 
     av_image_fill_max_pixsteps(flip->max_step, NULL, pix_desc);
     flip->hsub = pix_desc->log2_chroma_w;
     flip->vsub = pix_desc->log2_chroma_h;
 
+    for (i = 0; i < 4; i++) {
+        switch (flip->max_step[i]) {
+        case 1: flip->flip_line[i] = hflip_byte_c;  break;
+        case 2: flip->flip_line[i] = hflip_short_c; break;
+        case 3: flip->flip_line[i] = hflip_b24_c;   break;
+        case 4: flip->flip_line[i] = hflip_dword_c; break;
+        default: flip->flip_line[i] = NULL;
+        }
+    }
+    if (ARCH_X86)
+        ff_hflip_init_x86(flip);
+
     return 0;
 }
 
@@ -114,45 +157,11 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *in)
         outrow = out->data[plane];
         inrow  = in ->data[plane] + ((inlink->w >> hsub) - 1) * step;
         for (i = 0; i < in->video->h >> vsub; i++) {
-            switch (step) {
-            case 1:
-                for (j = 0; j < (inlink->w >> hsub); j++)
-                    outrow[j] = inrow[-j];
-            break;
-
-            case 2:
-            {
-                uint16_t *outrow16 = (uint16_t *)outrow;
-                uint16_t * inrow16 = (uint16_t *) inrow;
-                for (j = 0; j < (inlink->w >> hsub); j++)
-                    outrow16[j] = inrow16[-j];
-            }
-            break;
-
-            case 3:
-            {
-                uint8_t *in  =  inrow;
-                uint8_t *out = outrow;
-                for (j = 0; j < (inlink->w >> hsub); j++, out += 3, in -= 3) {
-                    int32_t v = AV_RB24(in);
-                    AV_WB24(out, v);
-                }
-            }
-            break;
-
-            case 4:
-            {
-                uint32_t *outrow32 = (uint32_t *)outrow;
-                uint32_t * inrow32 = (uint32_t *) inrow;
-                for (j = 0; j < (inlink->w >> hsub); j++)
-                    outrow32[j] = inrow32[-j];
-            }
-            break;
-
-            default:
+            if (flip->flip_line[plane])
+                flip->flip_line[plane](inrow, outrow, inlink->w >> hsub);
+            else
                 for (j = 0; j < (inlink->w >> hsub); j++)
                     memcpy(outrow + j*step, inrow - j*step, step);
-            }
 
             inrow  += in ->linesize[plane];
             outrow += out->linesize[plane];
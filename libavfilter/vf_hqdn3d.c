@@ -34,13 +34,20 @@
 #include "internal.h"
 #include "video.h"
 
+/* Slices start with the vertical filter state estimated over this many
+ * lines above them. */
+#define SLICE_OVERLAP 32
+#define SLICE_MIN_H   256
+
 typedef struct {
     int16_t *coefs[4];
     uint16_t *line;
     uint16_t *frame_prev[3];
+    int frame_prev_init;
     double strength[4];
     int hsub, vsub;
     int depth;
+    int nb_slices;
     void (*denoise_row[17])(uint8_t *src, uint8_t *dst, uint16_t *line_ant, uint16_t *frame_ant, ptrdiff_t w, int16_t *spatial, int16_t *temporal);
 } HQDN3DContext;
 
@@ -83,11 +90,15 @@ static void denoise_temporal(uint8_t *src, uint8_t *dst,
     }
 }
 
+/**
+ * @param prime number of lines above src to run the vertical filter on
+ *              before the first line, 0 if src is the first line of the plane
+ */
 av_always_inline
 static void denoise_spatial(HQDN3DContext *hqdn3d,
                             uint8_t *src, uint8_t *dst,
                             uint16_t *line_ant, uint16_t *frame_ant,
-                            int w, int h, int sstride, int dstride,
+                            int w, int h, int sstride, int dstride, int prime,
                             int16_t *spatial, int16_t *temporal, int depth)
 {
     long x, y;
@@ -97,16 +108,36 @@ static void denoise_spatial(HQDN3DContext *hqdn3d,
     spatial  += 256 << LUT_BITS;
     temporal += 256 << LUT_BITS;
 
-    /* First line has no top neighbor. Only left one for each tmp and
-     * last frame */
-    pixel_ant = LOAD(0);
-    for (x = 0; x < w; x++) {
-        line_ant[x] = tmp = pixel_ant = lowpass(pixel_ant, LOAD(x), spatial, depth);
-        frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
-        STORE(x, tmp);
+    if (prime) {
+        src -= prime * sstride;
+        pixel_ant = LOAD(0);
+        for (x = 0; x < w; x++)
+            line_ant[x] = pixel_ant = lowpass(pixel_ant, LOAD(x), spatial, depth);
+        for (y = 1; y < prime; y++) {
+            src += sstride;
+            pixel_ant = LOAD(0);
+            for (x = 0; x < w-1; x++) {
+                line_ant[x] = lowpass(line_ant[x], pixel_ant, spatial, depth);
+                pixel_ant = lowpass(pixel_ant, LOAD(x+1), spatial, depth);
+            }
+            line_ant[x] = lowpass(line_ant[x], pixel_ant, spatial, depth);
+        }
+        dst       -= dstride;
+        frame_ant -= w;
+        y = 0;
+    } else {
+        /* First line has no top neighbor. Only left one for each tmp and
+         * last frame */
+        pixel_ant = LOAD(0);
+        for (x = 0; x < w; x++) {
+            line_ant[x] = tmp = pixel_ant = lowpass(pixel_ant, LOAD(x), spatial, depth);
+            frame_ant[x] = tmp = lowpass(frame_ant[x], tmp, temporal, depth);
+            STORE(x, tmp);
+        }
+        y = 1;
     }
 
-    for (y = 1; y < h; y++) {
+    for (; y < h; y++) {
         src += sstride;
         dst += dstride;
         frame_ant += w;
@@ -130,27 +161,26 @@ static void denoise_spatial(HQDN3DContext *hqdn3d,
 av_always_inline
 static void denoise_depth(HQDN3DContext *hqdn3d,
                           uint8_t *src, uint8_t *dst,
-                          uint16_t *line_ant, uint16_t **frame_ant_ptr,
-                          int w, int h, int sstride, int dstride,
+                          uint16_t *line_ant, uint16_t *frame_ant, int init,
+                          int w, int h, int sstride, int dstride, int prime,
                           int16_t *spatial, int16_t *temporal, int depth)
 {
     // FIXME: For 16bit depth, frame_ant could be a pointer to the previous
     // filtered frame rather than a separate buffer.
     long x, y;
-    uint16_t *frame_ant = *frame_ant_ptr;
-    if (!frame_ant) {
+    if (init) {
         uint8_t *frame_src = src;
-        *frame_ant_ptr = frame_ant = av_malloc(w*h*sizeof(uint16_t));
+        uint16_t *frame_start = frame_ant;
         for (y = 0; y < h; y++, src += sstride, frame_ant += w)
             for (x = 0; x < w; x++)
                 frame_ant[x] = LOAD(x);
         src = frame_src;
-        frame_ant = *frame_ant_ptr;
+        frame_ant = frame_start;
     }
 
     if (spatial[0])
         denoise_spatial(hqdn3d, src, dst, line_ant, frame_ant,
-                        w, h, sstride, dstride, spatial, temporal, depth);
+                        w, h, sstride, dstride, prime, spatial, temporal, depth);
     else
         denoise_temporal(src, dst, frame_ant,
                          w, h, sstride, dstride, temporal, depth);
@@ -256,6 +286,7 @@ static void uninit(AVFilterContext *ctx)
     av_freep(&hqdn3d->coefs[2]);
     av_freep(&hqdn3d->coefs[3]);
     av_freep(&hqdn3d->line);
+    hqdn3d->nb_slices = 0;
     av_freep(&hqdn3d->frame_prev[0]);
     av_freep(&hqdn3d->frame_prev[1]);
     av_freep(&hqdn3d->frame_prev[2]);
@@ -301,9 +332,13 @@ static int config_input(AVFilterLink *inlink)
     hqdn3d->vsub  = desc->log2_chroma_h;
     hqdn3d->depth = desc->comp[0].depth_minus1+1;
 
-    hqdn3d->line = av_malloc(inlink->w * sizeof(*hqdn3d->line));
-    if (!hqdn3d->line)
-        return AVERROR(ENOMEM);
+    for (i = 0; i < 3; i++) {
+        int w = inlink->w >> (i ? hqdn3d->hsub : 0);
+        int h = inlink->h >> (i ? hqdn3d->vsub : 0);
+        hqdn3d->frame_prev[i] = av_malloc(w * h * sizeof(*hqdn3d->frame_prev[i]));
+        if (!hqdn3d->frame_prev[i])
+            return AVERROR(ENOMEM);
+    }
 
     for (i = 0; i < 4; i++) {
         hqdn3d->coefs[i] = precalc_coefs(hqdn3d->strength[i], hqdn3d->depth);
@@ -321,13 +356,54 @@ static int config_input(AVFilterLink *inlink)
     return 0;
 }
 
+typedef struct ThreadData {
+    AVFilterBufferRef *in, *out;
+} ThreadData;
+
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HQDN3DContext *hqdn3d = ctx->priv;
+    ThreadData *td = arg;
+    AVFilterBufferRef *in = td->in, *out = td->out;
+    int c;
+
+    for (c = 0; c < 3; c++) {
+        const int w  = in->video->w >> (!!c * hqdn3d->hsub);
+        const int h  = in->video->h >> (!!c * hqdn3d->vsub);
+        const int y0 = h *  jobnr      / nb_jobs;
+        const int y1 = h * (jobnr + 1) / nb_jobs;
+
+        denoise(hqdn3d, in->data[c]  + y0 * in->linesize[c],
+                        out->data[c] + y0 * out->linesize[c],
+                hqdn3d->line + jobnr * in->video->w,
+                hqdn3d->frame_prev[c] + y0 * w, !hqdn3d->frame_prev_init,
+                w, y1 - y0,
+                in->linesize[c], out->linesize[c], FFMIN(y0, SLICE_OVERLAP),
+                hqdn3d->coefs[c?2:0], hqdn3d->coefs[c?3:1]);
+    }
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *in)
 {
-    HQDN3DContext *hqdn3d = inlink->dst->priv;
-    AVFilterLink *outlink = inlink->dst->outputs[0];
+    AVFilterContext *ctx  = inlink->dst;
+    HQDN3DContext *hqdn3d = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
 
     AVFilterBufferRef *out;
-    int direct = 0, c;
+    ThreadData td;
+    int direct = 0;
+
+    if (!hqdn3d->nb_slices) {
+        int nb_slices = av_clip(inlink->h / SLICE_MIN_H, 1,
+                                ff_filter_get_nb_threads(ctx));
+        hqdn3d->line = av_malloc(nb_slices * inlink->w * sizeof(*hqdn3d->line));
+        if (!hqdn3d->line) {
+            avfilter_unref_bufferp(&in);
+            return AVERROR(ENOMEM);
+        }
+        hqdn3d->nb_slices = nb_slices;
+    }
 
     if (in->perms & AV_PERM_WRITE) {
         direct = 1;
@@ -341,14 +417,10 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *in)
         avfilter_copy_buffer_ref_props(out, in);
     }
 
-    for (c = 0; c < 3; c++) {
-        denoise(hqdn3d, in->data[c], out->data[c],
-                hqdn3d->line, &hqdn3d->frame_prev[c],
-                in->video->w >> (!!c * hqdn3d->hsub),
-                in->video->h >> (!!c * hqdn3d->vsub),
-                in->linesize[c], out->linesize[c],
-                hqdn3d->coefs[c?2:0], hqdn3d->coefs[c?3:1]);
-    }
+    td.in  = in;
+    td.out = out;
+    ff_filter_execute(ctx, filter_slice, &td, NULL, hqdn3d->nb_slices);
+    hqdn3d->frame_prev_init = 1;
 
     if (!direct)
         avfilter_unref_bufferp(&in);
@@ -387,4 +459,5 @@ AVFilter avfilter_vf_hqdn3d = {
     .inputs    = avfilter_vf_hqdn3d_inputs,
 
     .outputs   = avfilter_vf_hqdn3d_outputs,
+    .flags     = AVFILTER_FLAG_SLICE_THREADS,
 };
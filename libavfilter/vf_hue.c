@@ -78,6 +78,9 @@ typedef struct {
     int      vsub;
     int32_t hue_sin;
     int32_t hue_cos;
+    /* chroma rotation products for each input value, see compute_sin_and_cos() */
+    int32_t tab_c[256];
+    int32_t tab_s[256];
     int      flat_syntax;
     double   var_values[VAR_NB];
 } HueContext;
@@ -98,6 +101,8 @@ AVFILTER_DEFINE_CLASS(hue);
 
 static inline void compute_sin_and_cos(HueContext *hue)
 {
+    int i;
+
     /*
      * Scale the value to the norm of the resulting (U,V) vector, that is
      * the saturation.
@@ -105,6 +110,16 @@ static inline void compute_sin_and_cos(HueContext *hue)
      */
     hue->hue_sin = rint(sin(hue->hue) * (1 << 16) * hue->saturation);
     hue->hue_cos = rint(cos(hue->hue) * (1 << 16) * hue->saturation);
+
+    /*
+     * Precompute the products of the components, normalized from [16;240]
+     * to [-112;112], with the cosine and sine. The cosine table also holds
+     * the rounding and the de-normalization (128 scaled by << 16).
+     */
+    for (i = 0; i < 256; i++) {
+        hue->tab_c[i] = hue->hue_cos * (i - 128) + (1 << 15) + (128 << 16);
+        hue->tab_s[i] = hue->hue_sin * (i - 128);
+    }
 }
 
 #define SET_EXPRESSION(attr, name) do {                                           \
@@ -268,9 +283,9 @@ static int config_props(AVFilterLink *inlink)
 static void process_chrominance(uint8_t *udst, uint8_t *vdst, const int dst_linesize,
                                 uint8_t *usrc, uint8_t *vsrc, const int src_linesize,
                                 int w, int h,
-                                const int32_t c, const int32_t s)
+                                const int32_t *tab_c, const int32_t *tab_s)
 {
-    int32_t u, v, new_u, new_v;
+    int32_t new_u, new_v;
     int i;
 
     /*
@@ -279,18 +294,15 @@ static void process_chrominance(uint8_t *udst, uint8_t *vdst, const int dst_line
      */
     while (h--) {
         for (i = 0; i < w; i++) {
-            /* Normalize the components from range [16;140] to [-112;112] */
-            u = usrc[i] - 128;
-            v = vsrc[i] - 128;
+            const int u = usrc[i], v = vsrc[i];
             /*
              * Apply the rotation of the vector : (c * u) - (s * v)
              *                                    (s * u) + (c * v)
-             * De-normalize the components (without forgetting to scale 128
-             * by << 16)
-             * Finally scale back the result by >> 16
+             * with the products, normalization and rounding precomputed in
+             * the tables, and scale back the result by >> 16
              */
-            new_u = ((c * u) - (s * v) + (1 << 15) + (128 << 16)) >> 16;
-            new_v = ((s * u) + (c * v) + (1 << 15) + (128 << 16)) >> 16;
+            new_u = (tab_c[u] - tab_s[v]) >> 16;
+            new_v = (tab_s[u] + tab_c[v]) >> 16;
 
             /* Prevent a potential overflow */
             udst[i] = av_clip_uint8_c(new_u);
@@ -304,6 +316,39 @@ static void process_chrominance(uint8_t *udst, uint8_t *vdst, const int dst_line
     }
 }
 
+typedef struct ThreadData {
+    AVFilterBufferRef *in, *out;
+    int w, h;
+    int direct;
+} ThreadData;
+
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    HueContext *hue = ctx->priv;
+    ThreadData *td = arg;
+    AVFilterBufferRef *in = td->in, *out = td->out;
+    const int cw = td->w >> hue->hsub, ch = td->h >> hue->vsub;
+    const int slice_start = (ch *  jobnr   ) / nb_jobs;
+    const int slice_end   = (ch * (jobnr+1)) / nb_jobs;
+    const int in_offset   = slice_start * in ->linesize[1];
+    const int out_offset  = slice_start * out->linesize[1];
+
+    if (!td->direct) {
+        /* copy the luma rows matching the chroma rows of the slice */
+        const int y_start = jobnr     ? slice_start << hue->vsub : 0;
+        const int y_end   = jobnr + 1 < nb_jobs ? slice_end << hue->vsub : td->h;
+
+        av_image_copy_plane(out->data[0] + y_start * out->linesize[0], out->linesize[0],
+                            in ->data[0] + y_start * in ->linesize[0], in ->linesize[0],
+                            td->w, y_end - y_start);
+    }
+
+    process_chrominance(out->data[1] + out_offset, out->data[2] + out_offset, out->linesize[1],
+                        in ->data[1] + in_offset,  in ->data[2] + in_offset,  in ->linesize[1],
+                        cw, slice_end - slice_start, hue->tab_c, hue->tab_s);
+    return 0;
+}
+
 #define TS2D(ts) ((ts) == AV_NOPTS_VALUE ? NAN : (double)(ts))
 #define TS2T(ts, tb) ((ts) == AV_NOPTS_VALUE ? NAN : (double)(ts) * av_q2d(tb))
 
@@ -312,13 +357,21 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *inpic)
     HueContext *hue = inlink->dst->priv;
     AVFilterLink *outlink = inlink->dst->outputs[0];
     AVFilterBufferRef *outpic;
-
-    outpic = ff_get_video_buffer(outlink, AV_PERM_WRITE, outlink->w, outlink->h);
-    if (!outpic) {
-        avfilter_unref_bufferp(&inpic);
-        return AVERROR(ENOMEM);
+    ThreadData td;
+
+    if (inpic->perms & AV_PERM_WRITE) {
+        /* the luma is left as is */
+        td.direct = 1;
+        outpic = inpic;
+    } else {
+        td.direct = 0;
+        outpic = ff_get_video_buffer(outlink, AV_PERM_WRITE, outlink->w, outlink->h);
+        if (!outpic) {
+            avfilter_unref_bufferp(&inpic);
+            return AVERROR(ENOMEM);
+        }
+        avfilter_copy_buffer_ref_props(outpic, inpic);
     }
-    avfilter_copy_buffer_ref_props(outpic, inpic);
 
     if (!hue->flat_syntax) {
         hue->var_values[VAR_T]   = TS2T(inpic->pts, inlink->time_base);
@@ -352,16 +405,16 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *inpic)
 
     hue->var_values[VAR_N] += 1;
 
-    av_image_copy_plane(outpic->data[0], outpic->linesize[0],
-                        inpic->data[0],  inpic->linesize[0],
-                        inlink->w, inlink->h);
+    td.in  = inpic;
+    td.out = outpic;
+    td.w   = inlink->w;
+    td.h   = inlink->h;
+    ff_filter_execute(inlink->dst, filter_slice, &td, NULL,
+                      FFMAX(1, FFMIN(inlink->h >> hue->vsub,
+                                     ff_filter_get_nb_threads(inlink->dst))));
 
-    process_chrominance(outpic->data[1], outpic->data[2], outpic->linesize[1],
-                        inpic->data[1],  inpic->data[2],  inpic->linesize[1],
-                        inlink->w >> hue->hsub, inlink->h >> hue->vsub,
-                        hue->hue_cos, hue->hue_sin);
-
-    avfilter_unref_bufferp(&inpic);
+    if (!td.direct)
+        avfilter_unref_bufferp(&inpic);
     return ff_filter_frame(outlink, outpic);
 }
 
@@ -406,4 +459,5 @@ AVFilter avfilter_vf_hue = {
     .inputs          = hue_inputs,
     .outputs         = hue_outputs,
     .priv_class      = &hue_class,
+    .flags           = AVFILTER_FLAG_SLICE_THREADS,
 };
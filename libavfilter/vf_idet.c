@@ -25,42 +25,16 @@
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "avfilter.h"
+#include "idet.h"
 #include "internal.h"
 
-#define HIST_SIZE 4
-
-typedef enum {
-    TFF,
-    BFF,
-    PROGRSSIVE,
-    UNDETERMINED,
-} Type;
-
-typedef struct {
-    const AVClass *class;
-    float interlace_threshold;
-    float progressive_threshold;
-
-    Type last_type;
-    int prestat[4];
-    int poststat[4];
-
-    uint8_t history[HIST_SIZE];
-
-    AVFilterBufferRef *cur;
-    AVFilterBufferRef *next;
-    AVFilterBufferRef *prev;
-    int (*filter_line)(const uint8_t *prev, const uint8_t *cur, const uint8_t *next, int w);
-
-    const AVPixFmtDescriptor *csp;
-} IDETContext;
-
 #define OFFSET(x) offsetof(IDETContext, x)
 #define FLAGS AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
 
 static const AVOption idet_options[] = {
     { "intl_thres", "set interlacing threshold", OFFSET(interlace_threshold),   AV_OPT_TYPE_FLOAT, {.dbl = 1.01}, -1, FLT_MAX, FLAGS },
     { "prog_thres", "set progressive threshold", OFFSET(progressive_threshold), AV_OPT_TYPE_FLOAT, {.dbl = 2.5},  -1, FLT_MAX, FLAGS },
+    { "step",       "analyse one pair of lines out of step", OFFSET(step),  AV_OPT_TYPE_INT,   {.i64 = 1},     1, INT_MAX, FLAGS },
     { NULL }
 };
 
@@ -83,7 +57,8 @@ static int filter_line_c(const uint8_t *a, const uint8_t *b, const uint8_t *c, i
     int ret=0;
 
     for(x=0; x<w; x++){
-        ret += FFABS((*a++ + *c++) - 2 * *b++);
+        int v = (*a++ + *c++) - 2 * *b++;
+        ret += FFABS(v);
     }
 
     return ret;
@@ -95,7 +70,8 @@ static int filter_line_c_16bit(const uint16_t *a, const uint16_t *b, const uint1
     int ret=0;
 
     for(x=0; x<w; x++){
-        ret += FFABS((*a++ + *c++) - 2 * *b++);
+        int v = (*a++ + *c++) - 2 * *b++;
+        ret += FFABS(v);
     }
 
     return ret;
@@ -104,7 +80,7 @@ static int filter_line_c_16bit(const uint16_t *a, const uint16_t *b, const uint1
 static void filter(AVFilterContext *ctx)
 {
     IDETContext *idet = ctx->priv;
-    int y, i;
+    int y, y2, i;
     int64_t alpha[2]={0};
     int64_t delta=0;
     Type type, best_type;
@@ -120,13 +96,16 @@ static void filter(AVFilterContext *ctx)
             h >>= idet->csp->log2_chroma_h;
         }
 
-        for (y = 2; y < h - 2; y++) {
-            uint8_t *prev = &idet->prev->data[i][y*refs];
-            uint8_t *cur  = &idet->cur ->data[i][y*refs];
-            uint8_t *next = &idet->next->data[i][y*refs];
-            alpha[ y   &1] += idet->filter_line(cur-refs, prev, cur+refs, w);
-            alpha[(y^1)&1] += idet->filter_line(cur-refs, next, cur+refs, w);
-            delta          += idet->filter_line(cur-refs,  cur, cur+refs, w);
+        /* lines are taken in pairs so that both fields are analysed */
+        for (y2 = 2; y2 < h - 2; y2 += 2 * idet->step) {
+            for (y = y2; y < FFMIN(y2 + 2, h - 2); y++) {
+                uint8_t *prev = &idet->prev->data[i][y*refs];
+                uint8_t *cur  = &idet->cur ->data[i][y*refs];
+                uint8_t *next = &idet->next->data[i][y*refs];
+                alpha[ y   &1] += idet->filter_line(cur-refs, prev, cur+refs, w);
+                alpha[(y^1)&1] += idet->filter_line(cur-refs, next, cur+refs, w);
+                delta          += idet->filter_line(cur-refs,  cur, cur+refs, w);
+            }
         }
     }
 
@@ -194,10 +173,13 @@ static int filter_frame(AVFilterLink *link, AVFilterBufferRef *picref)
     if (!idet->prev)
         idet->prev = avfilter_ref_buffer(idet->cur, ~0);
 
-    if (!idet->csp)
+    if (!idet->csp) {
         idet->csp = av_pix_fmt_desc_get(link->format);
-    if (idet->csp->comp[0].depth_minus1 / 8 == 1)
-        idet->filter_line = (void*)filter_line_c_16bit;
+        if (idet->csp->comp[0].depth_minus1 / 8 == 1)
+            idet->filter_line = (void*)filter_line_c_16bit;
+        else if (ARCH_X86)
+            ff_idet_init_x86(idet);
+    }
 
     filter(ctx);
 
@@ -274,7 +256,7 @@ static int query_formats(AVFilterContext *ctx)
 static av_cold int init(AVFilterContext *ctx, const char *args)
 {
     IDETContext *idet = ctx->priv;
-    static const char *shorthand[] = { "intl_thres", "prog_thres", NULL };
+    static const char *shorthand[] = { "intl_thres", "prog_thres", "step", NULL };
     int ret;
 
     idet->class = &idet_class;
@@ -26,6 +26,7 @@
 
 #include "libavutil/common.h"
 #include "libavutil/eval.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
 #include "avfilter.h"
@@ -58,6 +59,8 @@ enum var_name {
 typedef struct {
     const AVClass *class;
     uint8_t lut[4][256];  ///< lookup table for each component
+    int identity[4];      ///< whether the table of a component leaves it unchanged
+    int all_identity;
     char   *comp_expr_str[4];
     AVExpr *comp_expr[4];
     int hsub, vsub;
@@ -256,73 +259,166 @@ static int config_props(AVFilterLink *inlink)
         }
     }
 
+    lut->all_identity = 1;
+    for (comp = 0; comp < 4; comp++) {
+        lut->identity[comp] = comp < desc->nb_components;
+        for (val = 0; val < 256 && lut->identity[comp]; val++)
+            lut->identity[comp] = lut->lut[comp][val] == val;
+        if (comp < desc->nb_components)
+            lut->all_identity &= lut->identity[comp];
+    }
+
     return 0;
 }
 
-static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *in)
+typedef struct ThreadData {
+    AVFilterBufferRef *in, *out;
+    int w, h;
+    int direct;
+} ThreadData;
+
+static void lut_packed(const LutContext *lut, uint8_t *dst, int dst_linesize,
+                       const uint8_t *src, int src_linesize, int w, int h)
 {
-    AVFilterContext *ctx = inlink->dst;
-    LutContext *lut = ctx->priv;
-    AVFilterLink *outlink = ctx->outputs[0];
-    AVFilterBufferRef *out;
-    uint8_t *inrow, *outrow, *inrow0, *outrow0;
-    int i, j, plane;
+    const uint8_t *tab0 = lut->lut[0], *tab1 = lut->lut[1];
+    const uint8_t *tab2 = lut->lut[2], *tab3 = lut->lut[3];
+    const int step = lut->step;
+    int i, j;
+
+    /* the components are applied together, with the loop specialized on
+       the pixel size, rather than testing it for every component */
+    for (i = 0; i < h; i++) {
+        const uint8_t *in = src;
+        uint8_t *out = dst;
+
+        switch (step) {
+        case 4:
+            for (j = 0; j < w; j++) {
+                out[0] = tab0[in[0]];
+                out[1] = tab1[in[1]];
+                out[2] = tab2[in[2]];
+                out[3] = tab3[in[3]];
+                out += 4;
+                in  += 4;
+            }
+            break;
+        case 3:
+            for (j = 0; j < w; j++) {
+                out[0] = tab0[in[0]];
+                out[1] = tab1[in[1]];
+                out[2] = tab2[in[2]];
+                out += 3;
+                in  += 3;
+            }
+            break;
+        default:
+            for (j = 0; j < w; j++) {
+                out[0] = tab0[in[0]];
+                if (step > 1)
+                    out[1] = tab1[in[1]];
+                out += step;
+                in  += step;
+            }
+        }
+        src += src_linesize;
+        dst += dst_linesize;
+    }
+}
 
-    out = ff_get_video_buffer(outlink, AV_PERM_WRITE, outlink->w, outlink->h);
-    if (!out) {
-        avfilter_unref_bufferp(&in);
-        return AVERROR(ENOMEM);
+static void lut_planar(const uint8_t *tab, uint8_t *dst, int dst_linesize,
+                       const uint8_t *src, int src_linesize, int w, int h)
+{
+    int i, j;
+
+    for (i = 0; i < h; i++) {
+        for (j = 0; j < w - 3; j += 4) {
+            uint8_t a = tab[src[j    ]], b = tab[src[j + 1]];
+            uint8_t c = tab[src[j + 2]], d = tab[src[j + 3]];
+            dst[j    ] = a;
+            dst[j + 1] = b;
+            dst[j + 2] = c;
+            dst[j + 3] = d;
+        }
+        for (; j < w; j++)
+            dst[j] = tab[src[j]];
+        src += src_linesize;
+        dst += dst_linesize;
     }
-    avfilter_copy_buffer_ref_props(out, in);
+}
+
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    LutContext *lut = ctx->priv;
+    ThreadData *td = arg;
+    AVFilterBufferRef *in = td->in, *out = td->out;
+    int plane;
 
     if (lut->is_rgb) {
         /* packed */
-        inrow0  = in ->data[0];
-        outrow0 = out->data[0];
-
-        for (i = 0; i < in->video->h; i ++) {
-            int w = inlink->w;
-            const uint8_t (*tab)[256] = (const uint8_t (*)[256])lut->lut;
-            inrow  = inrow0;
-            outrow = outrow0;
-            for (j = 0; j < w; j++) {
-                outrow[0] = tab[0][inrow[0]];
-                if (lut->step>1) {
-                    outrow[1] = tab[1][inrow[1]];
-                    if (lut->step>2) {
-                        outrow[2] = tab[2][inrow[2]];
-                        if (lut->step>3) {
-                            outrow[3] = tab[3][inrow[3]];
-                        }
-                    }
-                }
-                outrow += lut->step;
-                inrow  += lut->step;
-            }
-            inrow0  += in ->linesize[0];
-            outrow0 += out->linesize[0];
-        }
+        const int slice_start = (td->h *  jobnr   ) / nb_jobs;
+        const int slice_end   = (td->h * (jobnr+1)) / nb_jobs;
+
+        lut_packed(lut, out->data[0] + slice_start * out->linesize[0], out->linesize[0],
+                   in ->data[0] + slice_start * in ->linesize[0], in ->linesize[0],
+                   td->w, slice_end - slice_start);
     } else {
         /* planar */
         for (plane = 0; plane < 4 && in->data[plane]; plane++) {
             int vsub = plane == 1 || plane == 2 ? lut->vsub : 0;
             int hsub = plane == 1 || plane == 2 ? lut->hsub : 0;
+            const int h = (td->h + (1<<vsub) - 1)>>vsub;
+            const int w = (td->w + (1<<hsub) - 1)>>hsub;
+            const int slice_start = (h *  jobnr   ) / nb_jobs;
+            const int slice_end   = (h * (jobnr+1)) / nb_jobs;
+            uint8_t       *dst = out->data[plane] + slice_start * out->linesize[plane];
+            const uint8_t *src = in ->data[plane] + slice_start * in ->linesize[plane];
+
+            if (lut->identity[plane]) {
+                if (!td->direct)
+                    av_image_copy_plane(dst, out->linesize[plane], src, in->linesize[plane],
+                                        w, slice_end - slice_start);
+                continue;
+            }
+            lut_planar(lut->lut[plane], dst, out->linesize[plane],
+                       src, in->linesize[plane], w, slice_end - slice_start);
+        }
+    }
 
-            inrow  = in ->data[plane];
-            outrow = out->data[plane];
+    return 0;
+}
 
-            for (i = 0; i < (in->video->h + (1<<vsub) - 1)>>vsub; i ++) {
-                const uint8_t *tab = lut->lut[plane];
-                int w = (inlink->w + (1<<hsub) - 1)>>hsub;
-                for (j = 0; j < w; j++)
-                    outrow[j] = tab[inrow[j]];
-                inrow  += in ->linesize[plane];
-                outrow += out->linesize[plane];
-            }
+static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *in)
+{
+    AVFilterContext *ctx = inlink->dst;
+    LutContext *lut = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    AVFilterBufferRef *out;
+    ThreadData td;
+
+    if (in->perms & AV_PERM_WRITE) {
+        td.direct = 1;
+        out = in;
+    } else {
+        td.direct = 0;
+        out = ff_get_video_buffer(outlink, AV_PERM_WRITE, outlink->w, outlink->h);
+        if (!out) {
+            avfilter_unref_bufferp(&in);
+            return AVERROR(ENOMEM);
         }
+        avfilter_copy_buffer_ref_props(out, in);
     }
 
-    avfilter_unref_bufferp(&in);
+    if (!td.direct || !lut->all_identity) {
+        td.in  = in;
+        td.out = out;
+        td.w   = inlink->w;
+        td.h   = in->video->h;
+        ff_filter_execute(ctx, filter_slice, &td, NULL,
+                          FFMIN(td.h, ff_filter_get_nb_threads(ctx)));
+    }
+
+    if (!td.direct)
+        avfilter_unref_bufferp(&in);
     return ff_filter_frame(outlink, out);
 }
 
@@ -352,6 +448,7 @@ static const AVFilterPad outputs[] = {
         .inputs        = inputs,                                        \
         .outputs       = outputs,                                       \
         .priv_class    = &name_##_class,                                \
+        .flags         = AVFILTER_FLAG_SLICE_THREADS,                   \
     }
 
 #if CONFIG_LUT_FILTER
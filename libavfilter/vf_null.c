@@ -52,4 +52,5 @@ AVFilter avfilter_vf_null = {
     .inputs    = avfilter_vf_null_inputs,
 
     .outputs   = avfilter_vf_null_outputs,
+    .flags     = AVFILTER_FLAG_HWFRAME_AWARE,
 };
@@ -92,6 +92,10 @@ typedef struct {
     int overlay_pix_step[4];    ///< steps per pixel for each plane of the overlay
     int hsub, vsub;             ///< chroma subsampling values
 
+    /* area of the current overlay picture which is not fully transparent */
+    int bbox_valid;
+    int bbox_x0, bbox_y0, bbox_x1, bbox_y1;
+
     char *x_expr, *y_expr;
 } OverlayContext;
 
@@ -272,24 +276,91 @@ static int config_output(AVFilterLink *outlink)
 #define UNPREMULTIPLY_ALPHA(x, y) ((((x) << 16) - ((x) << 9) + (x)) / ((((x) + (y)) << 8) - ((x) + (y)) - (y) * (x)))
 
 /**
- * Blend image in src to destination buffer dst at position (x, y).
+ * Compute the smallest rectangle of the overlay picture out of which all
+ * its pixels are fully transparent, aligned on the chroma subsampling.
+ */
+static void compute_alpha_bbox(OverlayContext *over, AVFilterBufferRef *src)
+{
+    const int width  = src->video->w;
+    const int height = src->video->h;
+    const uint8_t *ap;
+    int step, i, j;
+    int x0 = width, x1 = 0, y0 = height, y1 = 0;
+
+    if (over->overlay_is_packed_rgb) {
+        ap   = src->data[0] + over->overlay_rgba_map[A];
+        step = over->overlay_pix_step[0];
+    } else {
+        ap   = src->data[3];
+        step = 1;
+    }
+
+    for (i = 0; i < height; i++) {
+        const uint8_t *a = ap;
+        int first = -1, last = -1;
+        for (j = 0; j < width; j++) {
+            if (*a) {
+                if (first < 0)
+                    first = j;
+                last = j;
+            }
+            a += step;
+        }
+        if (first >= 0) {
+            x0 = FFMIN(x0, first);
+            x1 = FFMAX(x1, last + 1);
+            y0 = FFMIN(y0, i);
+            y1 = i + 1;
+        }
+        ap += src->linesize[over->overlay_is_packed_rgb ? 0 : 3];
+    }
+
+    if (y1 <= y0) {
+        over->bbox_x0 = over->bbox_x1 = over->bbox_y0 = over->bbox_y1 = 0;
+    } else if (over->main_is_packed_rgb) {
+        over->bbox_x0 = x0; over->bbox_x1 = x1;
+        over->bbox_y0 = y0; over->bbox_y1 = y1;
+    } else {
+        /* chroma samples are blended with the average alpha of their luma
+           samples, so keep whole groups of them */
+        over->bbox_x0 = x0 & ~((1 << over->hsub) - 1);
+        over->bbox_y0 = y0 & ~((1 << over->vsub) - 1);
+        over->bbox_x1 = FFMIN(FFALIGN(x1, 1 << over->hsub), width);
+        over->bbox_y1 = FFMIN(FFALIGN(y1, 1 << over->vsub), height);
+    }
+    over->bbox_valid = 1;
+}
+
+typedef struct ThreadData {
+    AVFilterBufferRef *dst, *src;
+    int x, y;
+} ThreadData;
+
+/**
+ * Blend a slice of the image in src to destination buffer dst at position
+ * (x, y), limited to the non transparent area of src.
  *
  * It is assumed that the src image at position (x, y) is contained in
  * dst.
  */
-static void blend_image(AVFilterContext *ctx,
-                        AVFilterBufferRef *dst, AVFilterBufferRef *src,
-                        int x, int y)
+static int blend_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
     OverlayContext *over = ctx->priv;
+    ThreadData *td = arg;
+    AVFilterBufferRef *dst = td->dst, *src = td->src;
+    const int x = td->x, y = td->y;
     int i, j, k;
     int width   = src->video->w;
     int height  = src->video->h;
+    const int x0 = over->bbox_x0, x1 = over->bbox_x1;
 
     if (over->main_is_packed_rgb) {
-        uint8_t *dp = dst->data[0] + x * over->main_pix_step[0] +
-                      y * dst->linesize[0];
-        uint8_t *sp = src->data[0];
+        const int y0 = over->bbox_y0 + ((over->bbox_y1 - over->bbox_y0) *  jobnr   ) / nb_jobs;
+        const int y1 = over->bbox_y0 + ((over->bbox_y1 - over->bbox_y0) * (jobnr+1)) / nb_jobs;
+        uint8_t *dp = dst->data[0] + (x + x0) * over->main_pix_step[0] +
+                      (y + y0) * dst->linesize[0];
+        uint8_t *sp = src->data[0] + x0 * over->overlay_pix_step[0] +
+                      y0 * src->linesize[0];
         uint8_t alpha;          ///< the amount of overlay to blend on to main
         const int dr = over->main_rgba_map[R];
         const int dg = over->main_rgba_map[G];
@@ -302,9 +373,9 @@ static void blend_image(AVFilterContext *ctx,
         const int sa = over->overlay_rgba_map[A];
         const int sstep = over->overlay_pix_step[0];
         const int main_has_alpha = over->main_has_alpha;
-        for (i = 0; i < height; i++) {
+        for (i = y0; i < y1; i++) {
             uint8_t *d = dp, *s = sp;
-            for (j = 0; j < width; j++) {
+            for (j = x0; j < x1; j++) {
                 alpha = s[sa];
 
                 // if the main channel has an alpha channel, alpha has to be calculated
@@ -349,14 +420,22 @@ static void blend_image(AVFilterContext *ctx,
         }
     } else {
         const int main_has_alpha = over->main_has_alpha;
+        /* slices are made of whole chroma rows */
+        const int cy0 = over->bbox_y0 >> over->vsub;
+        const int cy1 = (over->bbox_y1 + (1 << over->vsub) - 1) >> over->vsub;
+        const int slice_start = cy0 + ((cy1 - cy0) *  jobnr   ) / nb_jobs;
+        const int slice_end   = cy0 + ((cy1 - cy0) * (jobnr+1)) / nb_jobs;
+        const int y0 = slice_start << over->vsub;
+        const int y1 = FFMIN(slice_end << over->vsub, height);
+
         if (main_has_alpha) {
-            uint8_t *da = dst->data[3] + x * over->main_pix_step[3] +
-                          y * dst->linesize[3];
-            uint8_t *sa = src->data[3];
+            uint8_t *da = dst->data[3] + (x + x0) * over->main_pix_step[3] +
+                          (y + y0) * dst->linesize[3];
+            uint8_t *sa = src->data[3] + x0 + y0 * src->linesize[3];
             uint8_t alpha;          ///< the amount of overlay to blend on to main
-            for (i = 0; i < height; i++) {
+            for (i = y0; i < y1; i++) {
                 uint8_t *d = da, *s = sa;
-                for (j = 0; j < width; j++) {
+                for (j = x0; j < x1; j++) {
                     alpha = *s;
                     if (alpha != 0 && alpha != 255) {
                         uint8_t alpha_d = *d;
@@ -382,15 +461,19 @@ static void blend_image(AVFilterContext *ctx,
         for (i = 0; i < 3; i++) {
             int hsub = i ? over->hsub : 0;
             int vsub = i ? over->vsub : 0;
-            uint8_t *dp = dst->data[i] + (x >> hsub) +
-                (y >> vsub) * dst->linesize[i];
-            uint8_t *sp = src->data[i];
-            uint8_t *ap = src->data[3];
             int wp = FFALIGN(width, 1<<hsub) >> hsub;
             int hp = FFALIGN(height, 1<<vsub) >> vsub;
-            for (j = 0; j < hp; j++) {
+            int k0 = x0 >> hsub;
+            int k1 = (x1 + (1 << hsub) - 1) >> hsub;
+            int j0 = i ? slice_start : y0;
+            int j1 = i ? FFMIN(slice_end, hp) : y1;
+            uint8_t *dp = dst->data[i] + ((x >> hsub) + k0) +
+                ((y >> vsub) + j0) * dst->linesize[i];
+            uint8_t *sp = src->data[i] + k0 + j0 * src->linesize[i];
+            uint8_t *ap = src->data[3] + (k0 << hsub) + (j0 << vsub) * src->linesize[3];
+            for (j = j0; j < j1; j++) {
                 uint8_t *d = dp, *s = sp, *a = ap;
-                for (k = 0; k < wp; k++) {
+                for (k = k0; k < k1; k++) {
                     // average alpha for color components, improve quality
                     int alpha_v, alpha_h, alpha;
                     if (hsub && vsub && j+1 < hp && k+1 < wp) {
@@ -433,6 +516,27 @@ static void blend_image(AVFilterContext *ctx,
             }
         }
     }
+    return 0;
+}
+
+static void blend_image(AVFilterContext *ctx,
+                        AVFilterBufferRef *dst, AVFilterBufferRef *src,
+                        int x, int y)
+{
+    OverlayContext *over = ctx->priv;
+    ThreadData td = { .dst = dst, .src = src, .x = x, .y = y };
+    int h;
+
+    if (!over->bbox_valid)
+        compute_alpha_bbox(over, src);
+    if (over->bbox_x1 <= over->bbox_x0)
+        return; /* fully transparent */
+
+    h = over->bbox_y1 - over->bbox_y0;
+    if (!over->main_is_packed_rgb)
+        h = (h + (1 << over->vsub) - 1) >> over->vsub;
+    ff_filter_execute(ctx, blend_slice, &td, NULL,
+                      FFMIN(h, ff_filter_get_nb_threads(ctx)));
 }
 
 static int try_filter_frame(AVFilterContext *ctx, AVFilterBufferRef *mainpic)
@@ -452,6 +556,7 @@ static int try_filter_frame(AVFilterContext *ctx, AVFilterBufferRef *mainpic)
         ff_bufqueue_get(&over->queue_over);
         avfilter_unref_buffer(over->overpicref);
         over->overpicref = next_overpic;
+        over->bbox_valid = 0;
     }
 
     /* If there is no next frame and no EOF and the overlay frame is before
@@ -605,4 +710,5 @@ AVFilter avfilter_vf_overlay = {
     .inputs    = avfilter_vf_overlay_inputs,
     .outputs   = avfilter_vf_overlay_outputs,
     .priv_class = &overlay_class,
+    .flags     = AVFILTER_FLAG_SLICE_THREADS,
 };
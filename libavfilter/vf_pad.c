@@ -216,16 +216,28 @@ static int config_output(AVFilterLink *outlink)
     return 0;
 }
 
+/**
+ * Check whether the output is the input unchanged, in which case frames
+ * are passed on as they are, even when they are not writable.
+ */
+static int no_border(PadContext *pad, AVFilterLink *inlink)
+{
+    return pad->w == inlink->w && pad->h == inlink->h;
+}
+
 static AVFilterBufferRef *get_video_buffer(AVFilterLink *inlink, int perms, int w, int h)
 {
     PadContext *pad = inlink->dst->priv;
     int align = (perms&AV_PERM_ALIGN) ? AVFILTER_ALIGN : 1;
-
-    AVFilterBufferRef *picref = ff_get_video_buffer(inlink->dst->outputs[0], perms,
-                                                    w + (pad->w - pad->in_w) + 4*align,
-                                                    h + (pad->h - pad->in_h));
+    AVFilterBufferRef *picref;
     int plane;
 
+    if (no_border(pad, inlink))
+        return ff_null_get_video_buffer(inlink, perms, w, h);
+
+    picref = ff_get_video_buffer(inlink->dst->outputs[0], perms,
+                                 w + (pad->w - pad->in_w) + 4*align,
+                                 h + (pad->h - pad->in_h));
     if (!picref)
         return NULL;
 
@@ -265,9 +277,13 @@ static int does_clip(PadContext *pad, AVFilterBufferRef *outpicref, int plane, i
 static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *in)
 {
     PadContext *pad = inlink->dst->priv;
-    AVFilterBufferRef *out = avfilter_ref_buffer(in, ~0);
+    AVFilterBufferRef *out;
     int plane, needs_copy;
 
+    if (no_border(pad, inlink))
+        return ff_filter_frame(inlink->dst->outputs[0], in);
+
+    out = avfilter_ref_buffer(in, ~0);
     if (!out) {
         avfilter_unref_bufferp(&in);
         return AVERROR(ENOMEM);
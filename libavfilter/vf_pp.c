@@ -25,17 +25,64 @@
  */
 
 #include "libavutil/avassert.h"
+#include "libavutil/avstring.h"
+#include "libavutil/imgutils.h"
 #include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
 #include "internal.h"
 
 #include "libpostproc/postprocess.h"
 
+/* lines of context processed above and below each slice, so that the
+ * filters see the same neighbourhood as when filtering the whole frame */
+#define SLICE_MARGIN 32
+#define SLICE_MIN_H  256
+
+typedef struct {
+    void *pp_ctx;
+    uint8_t *data[4];
+    int linesize[4];
+} PPSlice;
+
 typedef struct {
     int mode_id;
     pp_mode *modes[PP_QUALITY_MAX + 1];
     void *pp_ctx;
+    int pp_flags;
+    int hsub, vsub;
+    int autolevels;
+    PPSlice *slices;
+    int nb_slices;
 } PPFilterContext;
 
+typedef struct ThreadData {
+    AVFilterBufferRef *in, *out;
+    int w, h;
+} ThreadData;
+
+/**
+ * Check whether the autolevels subfilter is enabled. Its levels are
+ * computed over the whole frame, so it cannot run on separate slices.
+ */
+static int uses_autolevels(const char *args)
+{
+    char *buf = av_strdup(args), *tok, *saveptr = NULL;
+    int found = 0;
+
+    if (!buf)
+        return 1;
+    for (tok = av_strtok(buf, ",/", &saveptr); tok;
+         tok = av_strtok(NULL, ",/", &saveptr)) {
+        size_t len = strcspn(tok, ":|");
+
+        if ((len == 2 && !strncmp(tok, "al", 2)) ||
+            (len == 10 && !strncmp(tok, "autolevels", 10)))
+            found = 1;
+    }
+    av_free(buf);
+    return found;
+}
+
 static av_cold int pp_init(AVFilterContext *ctx, const char *args)
 {
     int i;
@@ -50,6 +97,7 @@ static av_cold int pp_init(AVFilterContext *ctx, const char *args)
             return AVERROR_EXTERNAL;
     }
     pp->mode_id = PP_QUALITY_MAX;
+    pp->autolevels = uses_autolevels(args);
     return 0;
 }
 
@@ -82,6 +130,7 @@ static int pp_config_props(AVFilterLink *inlink)
 {
     int flags = PP_CPU_CAPS_AUTO;
     PPFilterContext *pp = inlink->dst->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
 
     switch (inlink->format) {
     case AV_PIX_FMT_YUVJ420P:
@@ -94,12 +143,110 @@ static int pp_config_props(AVFilterLink *inlink)
     default: av_assert0(0);
     }
 
+    pp->pp_flags = flags;
+    pp->hsub     = desc->log2_chroma_w;
+    pp->vsub     = desc->log2_chroma_h;
+
     pp->pp_ctx = pp_get_context(inlink->w, inlink->h, flags);
     if (!pp->pp_ctx)
         return AVERROR(ENOMEM);
     return 0;
 }
 
+static void free_slices(PPFilterContext *pp)
+{
+    int i;
+
+    for (i = 0; pp->slices && i < pp->nb_slices; i++) {
+        if (pp->slices[i].pp_ctx)
+            pp_free_context(pp->slices[i].pp_ctx);
+        av_freep(&pp->slices[i].data[0]);
+    }
+    av_freep(&pp->slices);
+    pp->nb_slices = 0;
+}
+
+/**
+ * Set up one postprocessing context and one scratch image per slice.
+ * Every slice is filtered into its scratch image together with its
+ * margins, and only its own lines are copied to the output.
+ */
+static int alloc_slices(AVFilterContext *ctx, AVFilterLink *inlink)
+{
+    PPFilterContext *pp = ctx->priv;
+    const int aligned_w = FFALIGN(inlink->w, 8);
+    int i, ret, max_h, nb_slices;
+
+    nb_slices = FFMIN(ff_filter_get_nb_threads(ctx), inlink->h / SLICE_MIN_H);
+    if (pp->autolevels || nb_slices <= 1) {
+        pp->nb_slices = 1;
+        return 0;
+    }
+
+    pp->slices = av_mallocz(nb_slices * sizeof(*pp->slices));
+    if (!pp->slices)
+        return AVERROR(ENOMEM);
+    pp->nb_slices = nb_slices;
+
+    max_h = FFALIGN(inlink->h / nb_slices + 32 + 2 * SLICE_MARGIN, 16);
+    for (i = 0; i < nb_slices; i++) {
+        PPSlice *s = &pp->slices[i];
+
+        s->pp_ctx = pp_get_context(aligned_w, max_h, pp->pp_flags);
+        if (!s->pp_ctx) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        if ((ret = av_image_alloc(s->data, s->linesize, aligned_w, max_h,
+                                  inlink->format, 16)) < 0)
+            goto fail;
+    }
+    return 0;
+
+fail:
+    free_slices(pp);
+    return ret;
+}
+
+static int pp_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PPFilterContext *pp = ctx->priv;
+    ThreadData *td = arg;
+    PPSlice *s = &pp->slices[jobnr];
+    AVFilterBufferRef *in = td->in, *out = td->out;
+    const int y0 = (td->h * jobnr / nb_jobs) & ~15;
+    const int y1 = jobnr == nb_jobs - 1 ? td->h
+                                        : (td->h * (jobnr + 1) / nb_jobs) & ~15;
+    const int s0 = FFMAX(y0 - SLICE_MARGIN, 0);
+    const int s1 = FFMIN(y1 + SLICE_MARGIN, td->h);
+    const int8_t *qp_table = out->video->qp_table;
+    const uint8_t *src[3];
+    int i;
+
+    for (i = 0; i < 3; i++)
+        src[i] = in->data[i] + (s0 >> (i ? pp->vsub : 0)) * in->linesize[i];
+    if (qp_table)
+        qp_table += (s0 >> 4) * out->video->qp_table_linesize;
+
+    pp_postprocess(src, in->linesize, s->data, s->linesize,
+                   td->w, s1 - s0,
+                   qp_table, out->video->qp_table_linesize,
+                   pp->modes[pp->mode_id],
+                   s->pp_ctx,
+                   out->video->pict_type);
+
+    for (i = 0; i < 3; i++) {
+        const int hsub = i ? pp->hsub : 0, vsub = i ? pp->vsub : 0;
+
+        av_image_copy_plane(out->data[i] + (y0 >> vsub) * out->linesize[i],
+                            out->linesize[i],
+                            s->data[i] + ((y0 - s0) >> vsub) * s->linesize[i],
+                            s->linesize[i],
+                            td->w >> hsub, (y1 >> vsub) - (y0 >> vsub));
+    }
+    return 0;
+}
+
 static int pp_filter_frame(AVFilterLink *inlink, AVFilterBufferRef *inbuf)
 {
     AVFilterContext *ctx = inlink->dst;
@@ -108,6 +255,12 @@ static int pp_filter_frame(AVFilterLink *inlink, AVFilterBufferRef *inbuf)
     const int aligned_w = FFALIGN(outlink->w, 8);
     const int aligned_h = FFALIGN(outlink->h, 8);
     AVFilterBufferRef *outbuf;
+    int ret;
+
+    if (!pp->nb_slices && (ret = alloc_slices(ctx, inlink)) < 0) {
+        avfilter_unref_buffer(inbuf);
+        return ret;
+    }
 
     outbuf = ff_get_video_buffer(outlink, AV_PERM_WRITE, aligned_w, aligned_h);
     if (!outbuf) {
@@ -116,14 +269,20 @@ static int pp_filter_frame(AVFilterLink *inlink, AVFilterBufferRef *inbuf)
     }
     avfilter_copy_buffer_ref_props(outbuf, inbuf);
 
-    pp_postprocess((const uint8_t **)inbuf->data, inbuf->linesize,
-                   outbuf->data,                 outbuf->linesize,
-                   aligned_w, outlink->h,
-                   outbuf->video->qp_table,
-                   outbuf->video->qp_table_linesize,
-                   pp->modes[pp->mode_id],
-                   pp->pp_ctx,
-                   outbuf->video->pict_type);
+    if (pp->nb_slices > 1) {
+        ThreadData td = { .in = inbuf, .out = outbuf,
+                          .w  = aligned_w, .h = outlink->h };
+        ff_filter_execute(ctx, pp_slice, &td, NULL, pp->nb_slices);
+    } else {
+        pp_postprocess((const uint8_t **)inbuf->data, inbuf->linesize,
+                       outbuf->data,                 outbuf->linesize,
+                       aligned_w, outlink->h,
+                       outbuf->video->qp_table,
+                       outbuf->video->qp_table_linesize,
+                       pp->modes[pp->mode_id],
+                       pp->pp_ctx,
+                       outbuf->video->pict_type);
+    }
 
     avfilter_unref_buffer(inbuf);
     return ff_filter_frame(outlink, outbuf);
@@ -138,6 +297,7 @@ static av_cold void pp_uninit(AVFilterContext *ctx)
         pp_free_mode(pp->modes[i]);
     if (pp->pp_ctx)
         pp_free_context(pp->pp_ctx);
+    free_slices(pp);
 }
 
 static const AVFilterPad pp_inputs[] = {
@@ -169,4 +329,5 @@ AVFilter avfilter_vf_pp = {
     .inputs          = pp_inputs,
     .outputs         = pp_outputs,
     .process_command = pp_process_command,
+    .flags           = AVFILTER_FLAG_SLICE_THREADS,
 };
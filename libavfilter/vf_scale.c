@@ -67,11 +67,29 @@ enum var_name {
     VARS_NB
 };
 
+/**
+ * Scaler contexts for one input/output configuration. They are kept around
+ * so that an input switching back and forth between a few sizes or formats
+ * does not reinitialize libswscale on every change.
+ */
+typedef struct {
+    int src_w, src_h, src_format;
+    int dst_w, dst_h, dst_format;
+    unsigned int flags;
+    struct SwsContext *sws;
+    struct SwsContext *isws[2];
+} ScaleCacheEntry;
+
+#define SCALE_CACHE_SIZE 4
+
 typedef struct {
     const AVClass *class;
     struct SwsContext *sws;     ///< software scaler context
     struct SwsContext *isws[2]; ///< software scaler context for interlaced material
 
+    ScaleCacheEntry cache[SCALE_CACHE_SIZE]; ///< recently used contexts, most recent first
+    int nb_cached;
+
     /**
      * New dimensions. Special values are:
      *   0 = original width/height
@@ -87,6 +105,7 @@ typedef struct {
     int input_is_pal;           ///< set to 1 if the input format is paletted
     int output_is_pal;          ///< set to 1 if the output format is paletted
     int interlaced;
+    int nb_threads;             ///< number of libswscale threads
 
     char *w_expr;               ///< width  expression string
     char *h_expr;               ///< height expression string
@@ -102,6 +121,7 @@ static const AVOption scale_options[] = {
     { "height", "set height expression",   OFFSET(h_expr), AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, FLAGS },
     { "flags",  "set libswscale flags",    OFFSET(flags_str), AV_OPT_TYPE_STRING, {.str = NULL}, 0, INT_MAX, FLAGS },
     { "interl", "set interlacing", OFFSET(interlaced), AV_OPT_TYPE_INT, {.i64 = 0 }, -1, 1, FLAGS },
+    { "threads", "set number of libswscale threads", OFFSET(nb_threads), AV_OPT_TYPE_INT, {.i64 = 1 }, 0, INT_MAX, FLAGS },
     { "size",   "set video size",          OFFSET(size_str), AV_OPT_TYPE_STRING, {.str = NULL}, 0, FLAGS },
     { "s",      "set video size",          OFFSET(size_str), AV_OPT_TYPE_STRING, {.str = NULL}, 0, FLAGS },
     { NULL },
@@ -169,13 +189,23 @@ static av_cold int init(AVFilterContext *ctx, const char *args)
     return 0;
 }
 
+static void free_cache_entry(ScaleCacheEntry *e)
+{
+    sws_freeContext(e->sws);
+    sws_freeContext(e->isws[0]);
+    sws_freeContext(e->isws[1]);
+    e->sws = e->isws[0] = e->isws[1] = NULL;
+}
+
 static av_cold void uninit(AVFilterContext *ctx)
 {
     ScaleContext *scale = ctx->priv;
-    sws_freeContext(scale->sws);
-    sws_freeContext(scale->isws[0]);
-    sws_freeContext(scale->isws[1]);
-    scale->sws = NULL;
+    int i;
+
+    for (i = 0; i < scale->nb_cached; i++)
+        free_cache_entry(&scale->cache[i]);
+    scale->nb_cached = 0;
+    scale->sws = scale->isws[0] = scale->isws[1] = NULL;
     av_opt_free(scale);
 }
 
@@ -209,6 +239,76 @@ static int query_formats(AVFilterContext *ctx)
     return 0;
 }
 
+static struct SwsContext *alloc_sws(ScaleContext *scale,
+                                    int srcW, int srcH, enum AVPixelFormat srcFormat,
+                                    int dstW, int dstH, enum AVPixelFormat dstFormat)
+{
+    struct SwsContext *sws;
+
+    if (scale->nb_threads == 1)
+        return sws_getContext(srcW, srcH, srcFormat, dstW, dstH, dstFormat,
+                              scale->flags, NULL, NULL, NULL);
+
+    if (!(sws = sws_alloc_context()))
+        return NULL;
+    av_opt_set_int(sws, "srcw",       srcW,              0);
+    av_opt_set_int(sws, "srch",       srcH,              0);
+    av_opt_set_int(sws, "src_format", srcFormat,         0);
+    av_opt_set_int(sws, "dstw",       dstW,              0);
+    av_opt_set_int(sws, "dsth",       dstH,              0);
+    av_opt_set_int(sws, "dst_format", dstFormat,         0);
+    av_opt_set_int(sws, "sws_flags",  scale->flags,      0);
+    av_opt_set_int(sws, "threads",    scale->nb_threads, 0);
+    if (sws_init_context(sws, NULL, NULL) < 0) {
+        sws_freeContext(sws);
+        return NULL;
+    }
+    return sws;
+}
+
+/**
+ * Make the scaler contexts for the given configuration current, taking them
+ * from the cache if that configuration was used recently.
+ */
+static int get_sws(ScaleContext *scale,
+                   int srcW, int srcH, enum AVPixelFormat srcFormat,
+                   int dstW, int dstH, enum AVPixelFormat dstFormat)
+{
+    ScaleCacheEntry e = { srcW, srcH, srcFormat, dstW, dstH, dstFormat, scale->flags };
+    int i;
+
+    for (i = 0; i < scale->nb_cached; i++) {
+        ScaleCacheEntry *c = &scale->cache[i];
+        if (c->src_w == srcW && c->src_h == srcH && c->src_format == srcFormat &&
+            c->dst_w == dstW && c->dst_h == dstH && c->dst_format == dstFormat &&
+            c->flags == scale->flags)
+            break;
+    }
+
+    if (i < scale->nb_cached) {
+        e = scale->cache[i];
+    } else {
+        e.sws     = alloc_sws(scale, srcW, srcH,   srcFormat, dstW, dstH,   dstFormat);
+        e.isws[0] = alloc_sws(scale, srcW, srcH/2, srcFormat, dstW, dstH/2, dstFormat);
+        e.isws[1] = alloc_sws(scale, srcW, srcH/2, srcFormat, dstW, dstH/2, dstFormat);
+        if (!e.sws || !e.isws[0] || !e.isws[1]) {
+            free_cache_entry(&e);
+            return AVERROR(EINVAL);
+        }
+        if (scale->nb_cached == SCALE_CACHE_SIZE)
+            free_cache_entry(&scale->cache[--i]);
+        else
+            scale->nb_cached++;
+    }
+    memmove(&scale->cache[1], &scale->cache[0], i * sizeof(*scale->cache));
+    scale->cache[0] = e;
+
+    scale->sws     = e.sws;
+    scale->isws[0] = e.isws[0];
+    scale->isws[1] = e.isws[1];
+    return 0;
+}
+
 static int config_props(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
@@ -285,28 +385,12 @@ static int config_props(AVFilterLink *outlink)
     scale->output_is_pal = av_pix_fmt_desc_get(outfmt)->flags & PIX_FMT_PAL ||
                            av_pix_fmt_desc_get(outfmt)->flags & PIX_FMT_PSEUDOPAL;
 
-    if (scale->sws)
-        sws_freeContext(scale->sws);
     if (inlink->w == outlink->w && inlink->h == outlink->h &&
         inlink->format == outlink->format)
-        scale->sws = NULL;
-    else {
-        scale->sws = sws_getContext(inlink ->w, inlink ->h, inlink ->format,
-                                    outlink->w, outlink->h, outfmt,
-                                    scale->flags, NULL, NULL, NULL);
-        if (scale->isws[0])
-            sws_freeContext(scale->isws[0]);
-        scale->isws[0] = sws_getContext(inlink ->w, inlink ->h/2, inlink ->format,
-                                        outlink->w, outlink->h/2, outfmt,
-                                        scale->flags, NULL, NULL, NULL);
-        if (scale->isws[1])
-            sws_freeContext(scale->isws[1]);
-        scale->isws[1] = sws_getContext(inlink ->w, inlink ->h/2, inlink ->format,
-                                        outlink->w, outlink->h/2, outfmt,
-                                        scale->flags, NULL, NULL, NULL);
-        if (!scale->sws || !scale->isws[0] || !scale->isws[1])
-            return AVERROR(EINVAL);
-    }
+        scale->sws = scale->isws[0] = scale->isws[1] = NULL;
+    else if ((ret = get_sws(scale, inlink->w, inlink->h, inlink->format,
+                            outlink->w, outlink->h, outfmt)) < 0)
+        return ret;
 
     if (inlink->sample_aspect_ratio.num){
         outlink->sample_aspect_ratio = av_mul_q((AVRational){outlink->h * inlink->w, outlink->w * inlink->h}, inlink->sample_aspect_ratio);
@@ -41,6 +41,8 @@ typedef struct {
     int n;                      ///< current frame
     int n_frames;               ///< number of frames for analysis
     struct thumb_frame *frames; ///< the n_frames frames
+    int *thread_hist;           ///< partial histogram of each slice job
+    int nb_thread_hist;         ///< number of partial histograms allocated
 } ThumbContext;
 
 static av_cold int init(AVFilterContext *ctx, const char *args)
@@ -86,6 +88,33 @@ static double frame_sum_square_err(const int *hist, const double *median)
     return sum_sq_err;
 }
 
+typedef struct ThreadData {
+    AVFilterBufferRef *frame;
+    int w, h;
+} ThreadData;
+
+static int histogram_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ThumbContext *thumb = ctx->priv;
+    ThreadData *td = arg;
+    const int slice_start = (td->h *  jobnr   ) / nb_jobs;
+    const int slice_end   = (td->h * (jobnr+1)) / nb_jobs;
+    const uint8_t *p = td->frame->data[0] + slice_start * td->frame->linesize[0];
+    int *hist = thumb->thread_hist + jobnr * HIST_SIZE;
+    int i, j;
+
+    memset(hist, 0, HIST_SIZE * sizeof(*hist));
+    for (j = slice_start; j < slice_end; j++) {
+        for (i = 0; i < td->w; i++) {
+            hist[0*256 + p[i*3    ]]++;
+            hist[1*256 + p[i*3 + 1]]++;
+            hist[2*256 + p[i*3 + 2]]++;
+        }
+        p += td->frame->linesize[0];
+    }
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *frame)
 {
     int i, j, best_frame_idx = 0;
@@ -95,21 +124,30 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *frame)
     AVFilterLink *outlink = ctx->outputs[0];
     AVFilterBufferRef *picref;
     int *hist = thumb->frames[thumb->n].histogram;
-    const uint8_t *p = frame->data[0];
+    int nb_jobs = FFMAX(1, FFMIN(inlink->h, ff_filter_get_nb_threads(ctx)));
+    ThreadData td;
 
     // keep a reference of each frame
     thumb->frames[thumb->n].buf = frame;
 
-    // update current frame RGB histogram
-    for (j = 0; j < inlink->h; j++) {
-        for (i = 0; i < inlink->w; i++) {
-            hist[0*256 + p[i*3    ]]++;
-            hist[1*256 + p[i*3 + 1]]++;
-            hist[2*256 + p[i*3 + 2]]++;
-        }
-        p += frame->linesize[0];
+    if (nb_jobs > thumb->nb_thread_hist) {
+        av_freep(&thumb->thread_hist);
+        thumb->nb_thread_hist = 0;
+        thumb->thread_hist = av_malloc(nb_jobs * HIST_SIZE * sizeof(*thumb->thread_hist));
+        if (!thumb->thread_hist)
+            return AVERROR(ENOMEM);
+        thumb->nb_thread_hist = nb_jobs;
     }
 
+    // update current frame RGB histogram, from the histograms of the slices
+    td.frame = frame;
+    td.w     = inlink->w;
+    td.h     = inlink->h;
+    ff_filter_execute(ctx, histogram_slice, &td, NULL, nb_jobs);
+    for (j = 0; j < nb_jobs; j++)
+        for (i = 0; i < HIST_SIZE; i++)
+            hist[i] += thumb->thread_hist[j * HIST_SIZE + i];
+
     // no selection until the buffer of N frames is filled up
     if (thumb->n < thumb->n_frames - 1) {
         thumb->n++;
@@ -154,6 +192,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     for (i = 0; i < thumb->n_frames && thumb->frames[i].buf; i++)
         avfilter_unref_bufferp(&thumb->frames[i].buf);
     av_freep(&thumb->frames);
+    av_freep(&thumb->thread_hist);
 }
 
 static int request_frame(AVFilterLink *link)
@@ -232,4 +271,5 @@ AVFilter avfilter_vf_thumbnail = {
     .query_formats = query_formats,
     .inputs        = thumbnail_inputs,
     .outputs       = thumbnail_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -35,6 +35,7 @@
 #include "avfilter.h"
 #include "formats.h"
 #include "internal.h"
+#include "transpose.h"
 #include "video.h"
 
 typedef enum {
@@ -54,6 +55,8 @@ typedef struct {
     /* 3    Rotate by 90 degrees clockwise and vflip.        */
     int dir;
     PassthroughType passthrough; ///< landscape passthrough mode enabled
+
+    TransVtable vtables[4];
 } TransContext;
 
 #define OFFSET(x) offsetof(TransContext, x)
@@ -111,6 +114,45 @@ static int query_formats(AVFilterContext *ctx)
     return 0;
 }
 
+#define TRANSPOSE_FUNCS(name, type)                                          \
+static void transpose_block_##name##_c(uint8_t *src, int src_linesize,    \
+                                       uint8_t *dst, int dst_linesize,    \
+                                       int w, int h)                      \
+{                                                                         \
+    int x, y;                                                             \
+    for (y = 0; y < h; y++, dst += dst_linesize, src += sizeof(type))     \
+        for (x = 0; x < w; x++)                                           \
+            ((type *)dst)[x] = *(type *)(src + x*src_linesize);           \
+}                                                                         \
+                                                                          \
+static void transpose_8x8_##name##_c(uint8_t *src, int src_linesize,      \
+                                     uint8_t *dst, int dst_linesize)      \
+{                                                                         \
+    transpose_block_##name##_c(src, src_linesize, dst, dst_linesize, 8, 8); \
+}
+
+TRANSPOSE_FUNCS(8,  uint8_t)
+TRANSPOSE_FUNCS(16, uint16_t)
+TRANSPOSE_FUNCS(32, uint32_t)
+
+static void transpose_block_24_c(uint8_t *src, int src_linesize,
+                                 uint8_t *dst, int dst_linesize,
+                                 int w, int h)
+{
+    int x, y;
+    for (y = 0; y < h; y++, dst += dst_linesize, src += 3)
+        for (x = 0; x < w; x++) {
+            int32_t v = AV_RB24(src + x*src_linesize);
+            AV_WB24(dst + 3*x, v);
+        }
+}
+
+static void transpose_8x8_24_c(uint8_t *src, int src_linesize,
+                               uint8_t *dst, int dst_linesize)
+{
+    transpose_block_24_c(src, src_linesize, dst, dst_linesize, 8, 8);
+}
+
 static int config_props_output(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
@@ -118,6 +160,7 @@ static int config_props_output(AVFilterLink *outlink)
     AVFilterLink *inlink = ctx->inputs[0];
     const AVPixFmtDescriptor *desc_out = av_pix_fmt_desc_get(outlink->format);
     const AVPixFmtDescriptor *desc_in  = av_pix_fmt_desc_get(inlink->format);
+    int i;
 
     if (trans->dir&4) {
         av_log(ctx, AV_LOG_WARNING,
@@ -141,6 +184,22 @@ static int config_props_output(AVFilterLink *outlink)
 
     av_image_fill_max_pixsteps(trans->pixsteps, NULL, desc_out);
 
+    for (i = 0; i < 4; i++) {
+        TransVtable *v = &trans->vtables[i];
+        switch (trans->pixsteps[i]) {
+        case 1: v->transpose_block = transpose_block_8_c;
+                v->transpose_8x8   = transpose_8x8_8_c;  break;
+        case 2: v->transpose_block = transpose_block_16_c;
+                v->transpose_8x8   = transpose_8x8_16_c; break;
+        case 3: v->transpose_block = transpose_block_24_c;
+                v->transpose_8x8   = transpose_8x8_24_c; break;
+        case 4: v->transpose_block = transpose_block_32_c;
+                v->transpose_8x8   = transpose_8x8_32_c; break;
+        }
+        if (ARCH_X86)
+            ff_transpose_init_x86(v, trans->pixsteps[i]);
+    }
+
     outlink->w = inlink->h;
     outlink->h = inlink->w;
 
@@ -194,6 +253,7 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *in)
         int hsub = plane == 1 || plane == 2 ? trans->hsub : 0;
         int vsub = plane == 1 || plane == 2 ? trans->vsub : 0;
         int pixstep = trans->pixsteps[plane];
+        TransVtable *v = &trans->vtables[plane];
         int inh  = in->video->h>>vsub;
         int outw = out->video->w>>hsub;
         int outh = out->video->h>>vsub;
@@ -201,6 +261,9 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *in)
         int dstlinesize, srclinesize;
         int x, y;
 
+        if (!v->transpose_8x8)
+            continue;
+
         dst = out->data[plane];
         dstlinesize = out->linesize[plane];
         src = in->data[plane];
@@ -216,28 +279,20 @@ static int filter_frame(AVFilterLink *inlink, AVFilterBufferRef *in)
             dstlinesize *= -1;
         }
 
-        for (y = 0; y < outh; y++) {
-            switch (pixstep) {
-            case 1:
-                for (x = 0; x < outw; x++)
-                    dst[x] = src[x*srclinesize + y];
-                break;
-            case 2:
-                for (x = 0; x < outw; x++)
-                    *((uint16_t *)(dst + 2*x)) = *((uint16_t *)(src + x*srclinesize + y*2));
-                break;
-            case 3:
-                for (x = 0; x < outw; x++) {
-                    int32_t v = AV_RB24(src + x*srclinesize + y*3);
-                    AV_WB24(dst + 3*x, v);
-                }
-                break;
-            case 4:
-                for (x = 0; x < outw; x++)
-                    *((uint32_t *)(dst + 4*x)) = *((uint32_t *)(src + x*srclinesize + y*4));
-                break;
+        /* work on 8x8 tiles so that both the source and the destination
+         * rows of a band of 8 output lines stay in the cache */
+        for (y = 0; y < outh; y += 8) {
+            int bh = FFMIN(8, outh - y);
+            for (x = 0; x < outw; x += 8) {
+                int bw = FFMIN(8, outw - x);
+                uint8_t *s = src + x * srclinesize + y * pixstep;
+                uint8_t *d = dst + x * pixstep;
+                if (bw == 8 && bh == 8)
+                    v->transpose_8x8(s, srclinesize, d, dstlinesize);
+                else
+                    v->transpose_block(s, srclinesize, d, dstlinesize, bw, bh);
             }
-            dst += dstlinesize;
+            dst += 8 * dstlinesize;
         }
     }
 
@@ -58,7 +58,9 @@ typedef struct FilterParam {
     int steps_y;                             ///< vertical step count
     int scalebits;                           ///< bits to shift pixel
     int32_t halfscale;                       ///< amount to add to pixel
-    uint32_t *sc[(MAX_SIZE * MAX_SIZE) - 1]; ///< finite state machine storage
+    int width;                               ///< width of the planes
+    uint32_t **sc;                           ///< finite state machine storage, 2 * steps_y rows per job
+    int nb_sc;                               ///< number of jobs sc is allocated for
 } FilterParam;
 
 typedef struct {
@@ -67,22 +69,33 @@ typedef struct {
     int hsub, vsub;
 } UnsharpContext;
 
+/**
+ * Filter the rows slice_start to slice_end - 1 of a plane.
+ *
+ * The matrix is applied as cascaded sums of adjacent samples, whose state
+ * only depends on the last 2 * steps_y rows, so a slice is computed exactly
+ * by starting the vertical sums that many rows before its first output row.
+ *
+ * @param sc 2 * steps_y rows of width + 2 * steps_x sums owned by the caller
+ */
 static void apply_unsharp(      uint8_t *dst, int dst_stride,
                           const uint8_t *src, int src_stride,
-                          int width, int height, FilterParam *fp)
+                          int width, int height, FilterParam *fp,
+                          uint32_t **sc, int slice_start, int slice_end)
 {
-    uint32_t **sc = fp->sc;
     uint32_t sr[(MAX_SIZE * MAX_SIZE) - 1], tmp1, tmp2;
 
     int32_t res;
     int x, y, z;
-    const uint8_t *src2 = NULL;  //silence a warning
+    const uint8_t *src2;
 
     if (!fp->amount) {
+        dst += slice_start * dst_stride;
+        src += slice_start * src_stride;
         if (dst_stride == src_stride)
-            memcpy(dst, src, src_stride * height);
+            memcpy(dst, src, src_stride * (slice_end - slice_start));
         else
-            for (y = 0; y < height; y++, dst += dst_stride, src += src_stride)
+            for (y = slice_start; y < slice_end; y++, dst += dst_stride, src += src_stride)
                 memcpy(dst, src, width);
         return;
     }
@@ -90,9 +103,8 @@ static void apply_unsharp(      uint8_t *dst, int dst_stride,
     for (y = 0; y < 2 * fp->steps_y; y++)
         memset(sc[y], 0, sizeof(sc[y][0]) * (width + 2 * fp->steps_x));
 
-    for (y = -fp->steps_y; y < height + fp->steps_y; y++) {
-        if (y < height)
-            src2 = src;
+    for (y = slice_start - fp->steps_y; y < slice_end + fp->steps_y; y++) {
+        src2 = src + av_clip(y, 0, height - 1) * src_stride;
 
         memset(sr, 0, sizeof(sr[0]) * (2 * fp->steps_x - 1));
         for (x = -fp->steps_x; x < width + fp->steps_x; x++) {
@@ -105,18 +117,14 @@ static void apply_unsharp(      uint8_t *dst, int dst_stride,
                 tmp2 = sc[z + 0][x + fp->steps_x] + tmp1; sc[z + 0][x + fp->steps_x] = tmp1;
                 tmp1 = sc[z + 1][x + fp->steps_x] + tmp2; sc[z + 1][x + fp->steps_x] = tmp2;
             }
-            if (x >= fp->steps_x && y >= fp->steps_y) {
-                const uint8_t *srx = src - fp->steps_y * src_stride + x - fp->steps_x;
-                uint8_t *dsx       = dst - fp->steps_y * dst_stride + x - fp->steps_x;
+            if (x >= fp->steps_x && y >= slice_start + fp->steps_y) {
+                const uint8_t *srx = src + (y - fp->steps_y) * src_stride + x - fp->steps_x;
+                uint8_t *dsx       = dst + (y - fp->steps_y) * dst_stride + x - fp->steps_x;
 
                 res = (int32_t)*srx + ((((int32_t) * srx - (int32_t)((tmp1 + fp->halfscale) >> fp->scalebits)) * fp->amount) >> 16);
                 *dsx = av_clip_uint8(res);
             }
         }
-        if (y >= 0) {
-            dst += dst_stride;
-            src += src_stride;
-        }
     }
 }
 
@@ -172,7 +180,6 @@ static int query_formats(AVFilterContext *ctx)
 
 static void init_filter_param(AVFilterContext *ctx, FilterParam *fp, const char *effect_type, int width)
 {
-    int z;
     const char *effect;
 
     effect = fp->amount == 0 ? "none" : fp->amount < 0 ? "blur" : "sharpen";
@@ -180,8 +187,20 @@ static void init_filter_param(AVFilterContext *ctx, FilterParam *fp, const char
     av_log(ctx, AV_LOG_VERBOSE, "effect:%s type:%s msize_x:%d msize_y:%d amount:%0.2f\n",
            effect, effect_type, fp->msize_x, fp->msize_y, fp->amount / 65535.0);
 
-    for (z = 0; z < 2 * fp->steps_y; z++)
-        fp->sc[z] = av_malloc(sizeof(*(fp->sc[z])) * (width + 2 * fp->steps_x));
+    fp->width = width;
+}
+
+static int alloc_filter_param(FilterParam *fp, int nb_jobs)
+{
+    int z;
+
+    if (!(fp->sc = av_mallocz(sizeof(*fp->sc) * 2 * fp->steps_y * nb_jobs)))
+        return AVERROR(ENOMEM);
+    fp->nb_sc = nb_jobs;
+    for (z = 0; z < 2 * fp->steps_y * nb_jobs; z++)
+        if (!(fp->sc[z] = av_malloc(sizeof(*(fp->sc[z])) * (fp->width + 2 * fp->steps_x))))
+            return AVERROR(ENOMEM);
+    return 0;
 }
 
 static int config_props(AVFilterLink *link)
@@ -202,8 +221,11 @@ static void free_filter_param(FilterParam *fp)
 {
     int z;
 
-    for (z = 0; z < 2 * fp->steps_y; z++)
-        av_free(fp->sc[z]);
+    if (fp->sc)
+        for (z = 0; z < 2 * fp->steps_y * fp->nb_sc; z++)
+            av_free(fp->sc[z]);
+    av_freep(&fp->sc);
+    fp->nb_sc = 0;
 }
 
 static av_cold void uninit(AVFilterContext *ctx)
@@ -214,13 +236,49 @@ static av_cold void uninit(AVFilterContext *ctx)
     free_filter_param(&unsharp->chroma);
 }
 
+typedef struct ThreadData {
+    AVFilterBufferRef *in, *out;
+    int w, h, cw, ch;
+} ThreadData;
+
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    UnsharpContext *unsharp = ctx->priv;
+    ThreadData *td = arg;
+    AVFilterBufferRef *in = td->in, *out = td->out;
+    FilterParam *luma = &unsharp->luma, *chroma = &unsharp->chroma;
+    uint32_t **luma_sc   = luma  ->sc + jobnr * 2 * luma  ->steps_y;
+    uint32_t **chroma_sc = chroma->sc + jobnr * 2 * chroma->steps_y;
+    const int start  = (td->h  *  jobnr   ) / nb_jobs, end  = (td->h  * (jobnr+1)) / nb_jobs;
+    const int cstart = (td->ch *  jobnr   ) / nb_jobs, cend = (td->ch * (jobnr+1)) / nb_jobs;
+
+    apply_unsharp(out->data[0], out->linesize[0], in->data[0], in->linesize[0],
+                  td->w,  td->h,  luma,   luma_sc,   start,  end);
+    apply_unsharp(out->data[1], out->linesize[1], in->data[1], in->linesize[1],
+                  td->cw, td->ch, chroma, chroma_sc, cstart, cend);
+    apply_unsharp(out->data[2], out->linesize[2], in->data[2], in->linesize[2],
+                  td->cw, td->ch, chroma, chroma_sc, cstart, cend);
+    return 0;
+}
+
 static int filter_frame(AVFilterLink *link, AVFilterBufferRef *in)
 {
     UnsharpContext *unsharp = link->dst->priv;
     AVFilterLink *outlink   = link->dst->outputs[0];
     AVFilterBufferRef *out;
+    ThreadData td;
     int cw = SHIFTUP(link->w, unsharp->hsub);
     int ch = SHIFTUP(link->h, unsharp->vsub);
+    int ret;
+
+    if (!unsharp->luma.sc) {
+        int nb_jobs = ff_filter_get_nb_threads(link->dst);
+        if ((ret = alloc_filter_param(&unsharp->luma,   nb_jobs)) < 0 ||
+            (ret = alloc_filter_param(&unsharp->chroma, nb_jobs)) < 0) {
+            avfilter_unref_bufferp(&in);
+            return ret;
+        }
+    }
 
     out = ff_get_video_buffer(outlink, AV_PERM_WRITE, outlink->w, outlink->h);
     if (!out) {
@@ -229,9 +287,14 @@ static int filter_frame(AVFilterLink *link, AVFilterBufferRef *in)
     }
     avfilter_copy_buffer_ref_props(out, in);
 
-    apply_unsharp(out->data[0], out->linesize[0], in->data[0], in->linesize[0], link->w, link->h, &unsharp->luma);
-    apply_unsharp(out->data[1], out->linesize[1], in->data[1], in->linesize[1], cw,      ch,      &unsharp->chroma);
-    apply_unsharp(out->data[2], out->linesize[2], in->data[2], in->linesize[2], cw,      ch,      &unsharp->chroma);
+    td.in  = in;
+    td.out = out;
+    td.w   = link->w;
+    td.h   = link->h;
+    td.cw  = cw;
+    td.ch  = ch;
+    ff_filter_execute(link->dst, filter_slice, &td, NULL,
+                      FFMAX(1, FFMIN(ch, unsharp->luma.nb_sc)));
 
     avfilter_unref_bufferp(&in);
     return ff_filter_frame(outlink, out);
@@ -269,4 +332,6 @@ AVFilter avfilter_vf_unsharp = {
     .inputs    = avfilter_vf_unsharp_inputs,
 
     .outputs   = avfilter_vf_unsharp_outputs,
+
+    .flags     = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -105,18 +105,80 @@ static void filter_line_c_16bit(uint16_t *dst,
     FILTER
 }
 
+typedef struct ThreadData {
+    AVFilterBufferRef *frame;
+    int plane;
+    int w, h;
+    int parity;
+    int tff;
+} ThreadData;
+
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    YADIFContext *yadif = ctx->priv;
+    ThreadData *td = arg;
+    AVFilterBufferRef *dstpic = td->frame;
+    const int i = td->plane;
+    const int w = td->w, h = td->h;
+    const int parity = td->parity;
+    const int slice_start = (h *  jobnr   ) / nb_jobs;
+    const int slice_end   = (h * (jobnr+1)) / nb_jobs;
+    int refs = yadif->cur->linesize[i];
+    int absrefs = FFABS(refs);
+    int df = (yadif->csp->comp[i].depth_minus1 + 8) / 8;
+    uint8_t *temp_line = yadif->temp_line + jobnr * (2*64 + 5*yadif->temp_line_size);
+    int y;
+
+    for (y = slice_start; y < slice_end; y++) {
+        if ((y ^ parity) & 1) {
+            uint8_t *prev = &yadif->prev->data[i][y * refs];
+            uint8_t *cur  = &yadif->cur ->data[i][y * refs];
+            uint8_t *next = &yadif->next->data[i][y * refs];
+            uint8_t *dst  = &dstpic->data[i][y * dstpic->linesize[i]];
+            int     mode  = y == 1 || y + 2 == h ? 2 : yadif->mode;
+            int     prefs = y+1<h ? refs : -refs;
+            int     mrefs =     y ?-refs :  refs;
+
+            if(y<=1 || y+2>=h) {
+                uint8_t *tmp = temp_line + 64 + 2*absrefs;
+                if(mode<2)
+                    memcpy(tmp+2*mrefs, cur+2*mrefs, w*df);
+                memcpy(tmp+mrefs, cur+mrefs, w*df);
+                memcpy(tmp      , cur      , w*df);
+                if(prefs != mrefs) {
+                    memcpy(tmp+prefs, cur+prefs, w*df);
+                    if(mode<2)
+                        memcpy(tmp+2*prefs, cur+2*prefs, w*df);
+                }
+                cur = tmp;
+            }
+
+            yadif->filter_line(dst, prev, cur, next, w,
+                               prefs, mrefs,
+                               parity ^ td->tff, mode);
+        } else {
+            memcpy(&dstpic->data[i][y * dstpic->linesize[i]],
+                   &yadif->cur->data[i][y * refs], w * df);
+        }
+    }
+
+    /* the jobs may run on other threads, each one must leave MMX state */
+    emms_c();
+    return 0;
+}
+
 static void filter(AVFilterContext *ctx, AVFilterBufferRef *dstpic,
                    int parity, int tff)
 {
     YADIFContext *yadif = ctx->priv;
-    int y, i;
+    ThreadData td = { .frame = dstpic, .parity = parity, .tff = tff };
+    int i;
 
     for (i = 0; i < yadif->csp->nb_components; i++) {
         int w = dstpic->video->w;
         int h = dstpic->video->h;
-        int refs = yadif->cur->linesize[i];
-        int absrefs = FFABS(refs);
-        int df = (yadif->csp->comp[i].depth_minus1 + 8) / 8;
+        int absrefs = FFABS(yadif->cur->linesize[i]);
+        int nb_jobs;
 
         if (i == 1 || i == 2) {
         /* Why is this not part of the per-plane description thing? */
@@ -124,47 +186,22 @@ static void filter(AVFilterContext *ctx, AVFilterBufferRef *dstpic,
             h >>= yadif->csp->log2_chroma_h;
         }
 
-        if(yadif->temp_line_size < absrefs) {
+        nb_jobs = FFMAX(1, FFMIN(h, ff_filter_get_nb_threads(ctx)));
+        if (yadif->temp_line_size < absrefs || yadif->nb_temp_lines < nb_jobs) {
+            int size = FFMAX(yadif->temp_line_size, absrefs);
             av_free(yadif->temp_line);
-            yadif->temp_line = av_mallocz(2*64 + 5*absrefs);
-            yadif->temp_line_size = absrefs;
+            yadif->temp_line = av_mallocz(nb_jobs * (2*64 + 5*size));
+            yadif->temp_line_size = yadif->temp_line ? size : 0;
+            yadif->nb_temp_lines  = yadif->temp_line ? nb_jobs : 0;
+            if (!yadif->temp_line)
+                return;
         }
 
-        for (y = 0; y < h; y++) {
-            if ((y ^ parity) & 1) {
-                uint8_t *prev = &yadif->prev->data[i][y * refs];
-                uint8_t *cur  = &yadif->cur ->data[i][y * refs];
-                uint8_t *next = &yadif->next->data[i][y * refs];
-                uint8_t *dst  = &dstpic->data[i][y * dstpic->linesize[i]];
-                int     mode  = y == 1 || y + 2 == h ? 2 : yadif->mode;
-                int     prefs = y+1<h ? refs : -refs;
-                int     mrefs =     y ?-refs :  refs;
-
-                if(y<=1 || y+2>=h) {
-                    uint8_t *tmp = yadif->temp_line + 64 + 2*absrefs;
-                    if(mode<2)
-                        memcpy(tmp+2*mrefs, cur+2*mrefs, w*df);
-                    memcpy(tmp+mrefs, cur+mrefs, w*df);
-                    memcpy(tmp      , cur      , w*df);
-                    if(prefs != mrefs) {
-                        memcpy(tmp+prefs, cur+prefs, w*df);
-                        if(mode<2)
-                            memcpy(tmp+2*prefs, cur+2*prefs, w*df);
-                    }
-                    cur = tmp;
-                }
-
-                yadif->filter_line(dst, prev, cur, next, w,
-                                   prefs, mrefs,
-                                   parity ^ tff, mode);
-            } else {
-                memcpy(&dstpic->data[i][y * dstpic->linesize[i]],
-                       &yadif->cur->data[i][y * refs], w * df);
-            }
-        }
+        td.plane = i;
+        td.w     = w;
+        td.h     = h;
+        ff_filter_execute(ctx, filter_slice, &td, NULL, nb_jobs);
     }
-
-    emms_c();
 }
 
 static int return_frame(AVFilterContext *ctx, int is_second)
@@ -337,7 +374,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     if (yadif->prev) avfilter_unref_bufferp(&yadif->prev);
     if (yadif->cur ) avfilter_unref_bufferp(&yadif->cur );
     if (yadif->next) avfilter_unref_bufferp(&yadif->next);
-    av_freep(&yadif->temp_line); yadif->temp_line_size = 0;
+    av_freep(&yadif->temp_line); yadif->temp_line_size = yadif->nb_temp_lines = 0;
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -444,4 +481,6 @@ AVFilter avfilter_vf_yadif = {
     .inputs    = avfilter_vf_yadif_inputs,
 
     .outputs   = avfilter_vf_yadif_outputs,
+
+    .flags     = AVFILTER_FLAG_SLICE_THREADS,
 };
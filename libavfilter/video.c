@@ -26,6 +26,7 @@
 #include "libavutil/avassert.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
 
 #include "avfilter.h"
 #include "internal.h"
@@ -227,6 +228,15 @@ int ff_start_frame(AVFilterLink *link, AVFilterBufferRef *picref)
         perms |= AV_PERM_NEG_LINESIZES;
     /* prepare to copy the picture if it has insufficient permissions */
     if ((dst->min_perms & perms) != dst->min_perms || dst->rej_perms & perms) {
+        if (av_pix_fmt_desc_get(link->format)->flags & PIX_FMT_HWACCEL) {
+            av_log(link->dst, AV_LOG_ERROR,
+                   "Cannot copy a frame in the hardware format %s "
+                   "(have perms %x, need %x, reject %x).\n",
+                   av_get_pix_fmt_name(link->format), picref->perms,
+                   link->dstpad->min_perms, link->dstpad->rej_perms);
+            avfilter_unref_bufferp(&picref);
+            return AVERROR(EINVAL);
+        }
         av_log(link->dst, AV_LOG_DEBUG,
                 "frame copy needed (have perms %x, need %x, reject %x)\n",
                 picref->perms,
@@ -138,3 +138,33 @@ cglobal scale_samples_s32, 4,4,8, dst, src, len, volume
     sub       lenq, mmsize
     jge .loop
     REP_RET
+
+;------------------------------------------------------------------------------
+; void ff_scale_samples_flt(float *dst, const float *src, float volume,
+;                           int len)
+;------------------------------------------------------------------------------
+
+%if HAVE_AVX_EXTERNAL
+INIT_YMM avx
+%if UNIX64
+cglobal scale_samples_flt, 3,3,2, dst, src, len
+%else
+cglobal scale_samples_flt, 4,4,3, dst, src, volume, len
+%endif
+%if ARCH_X86_32
+    VBROADCASTSS m0, volumem
+%else
+%if WIN64
+    mova      xmm0, xmm2
+%endif
+    shufps    xmm0, xmm0, 0
+    vinsertf128  m0, m0, xmm0, 1
+%endif
+    lea       lenq, [lend*4-mmsize]
+.loop:
+    mulps       m1, m0, [srcq+lenq]
+    mova  [dstq+lenq], m1
+    sub       lenq, mmsize
+    jge .loop
+    REP_RET
+%endif
@@ -32,6 +32,9 @@ void ff_scale_samples_s32_ssse3_atom(uint8_t *dst, const uint8_t *src, int len,
 void ff_scale_samples_s32_avx(uint8_t *dst, const uint8_t *src, int len,
                               int volume);
 
+void ff_scale_samples_flt_avx(float *dst, const float *src, float volume,
+                              int len);
+
 void ff_volume_init_x86(VolumeContext *vol)
 {
     int mm_flags = av_get_cpu_flags();
@@ -55,5 +58,10 @@ void ff_volume_init_x86(VolumeContext *vol)
             vol->scale_samples = ff_scale_samples_s32_avx;
             vol->samples_align = 8;
         }
+    } else if (sample_fmt == AV_SAMPLE_FMT_FLT) {
+        if (EXTERNAL_AVX(mm_flags)) {
+            vol->scale_samples_flt = ff_scale_samples_flt_avx;
+            vol->samples_align = 8;
+        }
     }
 }
@@ -0,0 +1,135 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/mem.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/hflip.h"
+
+/* The SIMD loops mirror 16 bytes per iteration, reading them from
+ * src - 15 upwards and leaving the remaining pixels to the C tail. */
+
+#if HAVE_SSSE3_INLINE
+DECLARE_ALIGNED(16, static const uint8_t, pb_reverse)[16] = {
+    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+};
+
+static void hflip_byte_ssse3(const uint8_t *src, uint8_t *dst, int w)
+{
+    x86_reg n = w & ~15;
+    int j;
+
+    if (n) {
+        w -= n;
+        __asm__ volatile(
+            "movdqa           %3, %%xmm1 \n"
+            "1:                          \n"
+            "movdqu      -15(%1), %%xmm0 \n"
+            "pshufb       %%xmm1, %%xmm0 \n"
+            "movdqu       %%xmm0, (%2)   \n"
+            "sub             $16, %1     \n"
+            "add             $16, %2     \n"
+            "sub             $16, %0     \n"
+            "jg               1b         \n"
+            : "+r"(n), "+r"(src), "+r"(dst)
+            : "m"(*pb_reverse)
+            : XMM_CLOBBERS("xmm0", "xmm1",)
+              "memory"
+        );
+    }
+    for (j = 0; j < w; j++)
+        dst[j] = src[-j];
+}
+#endif /* HAVE_SSSE3_INLINE */
+
+#if HAVE_SSE2_INLINE
+static void hflip_short_sse2(const uint8_t *src, uint8_t *dst, int w)
+{
+    x86_reg n = w & ~7;
+    int j;
+
+    if (n) {
+        w -= n;
+        __asm__ volatile(
+            "1:                               \n"
+            "movdqu           -14(%1), %%xmm0 \n"
+            "pshuflw   $0x1b, %%xmm0,  %%xmm0 \n"
+            "pshufhw   $0x1b, %%xmm0,  %%xmm0 \n"
+            "pshufd    $0x4e, %%xmm0,  %%xmm0 \n"
+            "movdqu            %%xmm0, (%2)   \n"
+            "sub                  $16, %1     \n"
+            "add                  $16, %2     \n"
+            "sub                   $8, %0     \n"
+            "jg                    1b         \n"
+            : "+r"(n), "+r"(src), "+r"(dst)
+            :
+            : XMM_CLOBBERS("xmm0",)
+              "memory"
+        );
+    }
+    for (j = 0; j < w; j++)
+        ((uint16_t *)dst)[j] = ((const uint16_t *)src)[-j];
+}
+
+static void hflip_dword_sse2(const uint8_t *src, uint8_t *dst, int w)
+{
+    x86_reg n = w & ~3;
+    int j;
+
+    if (n) {
+        w -= n;
+        __asm__ volatile(
+            "1:                               \n"
+            "movdqu           -12(%1), %%xmm0 \n"
+            "pshufd    $0x1b, %%xmm0,  %%xmm0 \n"
+            "movdqu            %%xmm0, (%2)   \n"
+            "sub                  $16, %1     \n"
+            "add                  $16, %2     \n"
+            "sub                   $4, %0     \n"
+            "jg                    1b         \n"
+            : "+r"(n), "+r"(src), "+r"(dst)
+            :
+            : XMM_CLOBBERS("xmm0",)
+              "memory"
+        );
+    }
+    for (j = 0; j < w; j++)
+        ((uint32_t *)dst)[j] = ((const uint32_t *)src)[-j];
+}
+#endif /* HAVE_SSE2_INLINE */
+
+av_cold void ff_hflip_init_x86(FlipContext *flip)
+{
+    int cpu_flags = av_get_cpu_flags();
+    int i;
+
+    for (i = 0; i < 4; i++) {
+#if HAVE_SSE2_INLINE
+        if (INLINE_SSE2(cpu_flags) && flip->max_step[i] == 2)
+            flip->flip_line[i] = hflip_short_sse2;
+        if (INLINE_SSE2(cpu_flags) && flip->max_step[i] == 4)
+            flip->flip_line[i] = hflip_dword_sse2;
+#endif
+#if HAVE_SSSE3_INLINE
+        if (INLINE_SSSE3(cpu_flags) && flip->max_step[i] == 1)
+            flip->flip_line[i] = hflip_byte_ssse3;
+#endif
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/idet.h"
+
+#if HAVE_SSE2_INLINE
+/* sum of |a + c - 2 * b|, 16 pixels per iteration on 16-bit words */
+static int idet_filter_line_sse2(const uint8_t *a, const uint8_t *b,
+                                 const uint8_t *c, int w)
+{
+    x86_reg w16 = w & ~15, i = -w16;
+    int ret = 0, x;
+
+    if (w16) {
+        __asm__ volatile(
+            "pxor          %%xmm7, %%xmm7       \n"
+            "pxor          %%xmm6, %%xmm6       \n"
+            "pcmpeqw       %%xmm5, %%xmm5       \n"
+            "psrlw            $15, %%xmm5       \n"
+            "1:                                 \n"
+            "movdqu      (%2,%0), %%xmm0        \n"
+            "movdqu      (%4,%0), %%xmm2        \n"
+            "movdqu      (%3,%0), %%xmm4        \n"
+            "movdqa        %%xmm0, %%xmm1       \n"
+            "movdqa        %%xmm2, %%xmm3       \n"
+            "punpcklbw     %%xmm7, %%xmm0       \n"
+            "punpckhbw     %%xmm7, %%xmm1       \n"
+            "punpcklbw     %%xmm7, %%xmm2       \n"
+            "punpckhbw     %%xmm7, %%xmm3       \n"
+            "paddw         %%xmm2, %%xmm0       \n"
+            "paddw         %%xmm3, %%xmm1       \n"
+            "movdqa        %%xmm4, %%xmm2       \n"
+            "punpcklbw     %%xmm7, %%xmm2       \n"
+            "punpckhbw     %%xmm7, %%xmm4       \n"
+            "psllw             $1, %%xmm2       \n"
+            "psllw             $1, %%xmm4       \n"
+            "psubw         %%xmm2, %%xmm0       \n"
+            "psubw         %%xmm4, %%xmm1       \n"
+            "pxor          %%xmm2, %%xmm2       \n"
+            "pxor          %%xmm3, %%xmm3       \n"
+            "psubw         %%xmm0, %%xmm2       \n"
+            "psubw         %%xmm1, %%xmm3       \n"
+            "pmaxsw        %%xmm2, %%xmm0       \n"
+            "pmaxsw        %%xmm3, %%xmm1       \n"
+            "pmaddwd       %%xmm5, %%xmm0       \n"
+            "pmaddwd       %%xmm5, %%xmm1       \n"
+            "paddd         %%xmm0, %%xmm6       \n"
+            "paddd         %%xmm1, %%xmm6       \n"
+            "add              $16, %0           \n"
+            "jl                1b               \n"
+            "pshufd $0x4e, %%xmm6, %%xmm0       \n"
+            "paddd         %%xmm0, %%xmm6       \n"
+            "pshufd $0xb1, %%xmm6, %%xmm0       \n"
+            "paddd         %%xmm0, %%xmm6       \n"
+            "movd          %%xmm6, %1           \n"
+            : "+r"(i), "=r"(ret)
+            : "r"(a + w16), "r"(b + w16), "r"(c + w16)
+            : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",
+                           "xmm4", "xmm5", "xmm6", "xmm7",) "memory"
+        );
+    }
+
+    for (x = w16; x < w; x++)
+        ret += FFABS((a[x] + c[x]) - 2 * b[x]);
+
+    return ret;
+}
+#endif /* HAVE_SSE2_INLINE */
+
+av_cold void ff_idet_init_x86(IDETContext *idet)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+#if HAVE_SSE2_INLINE
+    if (INLINE_SSE2(cpu_flags))
+        idet->filter_line = idet_filter_line_sse2;
+#endif
+}
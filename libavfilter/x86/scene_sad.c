@@ -0,0 +1,82 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/scene_sad.h"
+
+#if HAVE_SSE2_INLINE
+static int64_t scene_sad_sse2(const uint8_t *src1, int stride1,
+                              const uint8_t *src2, int stride2,
+                              int width, int height)
+{
+    x86_reg w16 = width & ~15, neg_w16 = -w16;
+    x86_reg s1 = stride1, s2 = stride2;
+    const uint8_t *p1 = src1 + w16, *p2 = src2 + w16;
+    uint64_t sad = 0;
+    int h = height, x, y;
+
+    if (w16 && h > 0) {
+        __asm__ volatile(
+            "pxor          %%xmm2, %%xmm2       \n"
+            "1:                                 \n"
+            "mov               %4, %%"REG_a"    \n"
+            "2:                                 \n"
+            "movdqu (%0,%%"REG_a"), %%xmm0      \n"
+            "movdqu (%1,%%"REG_a"), %%xmm1      \n"
+            "psadbw        %%xmm1, %%xmm0       \n"
+            "paddq         %%xmm0, %%xmm2       \n"
+            "add              $16, %%"REG_a"    \n"
+            "jl                2b               \n"
+            "add               %5, %0           \n"
+            "add               %6, %1           \n"
+            "decl              %2               \n"
+            "jg                1b               \n"
+            "pshufd $0x4e, %%xmm2, %%xmm0       \n"
+            "paddq         %%xmm2, %%xmm0       \n"
+            "movq          %%xmm0, %3           \n"
+            : "+r"(p1), "+r"(p2), "+m"(h), "=m"(sad)
+            : "m"(neg_w16), "m"(s1), "m"(s2)
+            : "%"REG_a, XMM_CLOBBERS("xmm0", "xmm1", "xmm2",) "memory"
+        );
+    }
+
+    /* the last 8 columns of widths that are not a multiple of 16 */
+    for (y = 0; y < height && w16 < width; y++) {
+        for (x = w16; x < width; x++)
+            sad += FFABS(src1[x] - src2[x]);
+        src1 += stride1;
+        src2 += stride2;
+    }
+    return sad;
+}
+#endif /* HAVE_SSE2_INLINE */
+
+av_cold ff_scene_sad_fn ff_scene_sad_get_fn_x86(void)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+#if HAVE_SSE2_INLINE
+    if (INLINE_SSE2(cpu_flags))
+        return scene_sad_sse2;
+#endif
+    return NULL;
+}
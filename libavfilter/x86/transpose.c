@@ -0,0 +1,174 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/transpose.h"
+
+#if HAVE_SSE2_INLINE
+
+static void transpose_8x8_8_sse2(uint8_t *src, int src_linesize,
+                                 uint8_t *dst, int dst_linesize)
+{
+    x86_reg ss = src_linesize, ds = dst_linesize;
+
+    __asm__ volatile(
+        "movq          (%0), %%xmm0 \n"
+        "movq       (%0,%2), %%xmm1 \n"
+        "lea     (%0,%2,2),  %0     \n"
+        "movq          (%0), %%xmm2 \n"
+        "movq       (%0,%2), %%xmm3 \n"
+        "lea     (%0,%2,2),  %0     \n"
+        "movq          (%0), %%xmm4 \n"
+        "movq       (%0,%2), %%xmm5 \n"
+        "lea     (%0,%2,2),  %0     \n"
+        "movq          (%0), %%xmm6 \n"
+        "movq       (%0,%2), %%xmm7 \n"
+        "punpcklbw   %%xmm1, %%xmm0 \n"
+        "punpcklbw   %%xmm3, %%xmm2 \n"
+        "punpcklbw   %%xmm5, %%xmm4 \n"
+        "punpcklbw   %%xmm7, %%xmm6 \n"
+        "movdqa      %%xmm0, %%xmm1 \n"
+        "punpcklwd   %%xmm2, %%xmm0 \n"
+        "punpckhwd   %%xmm2, %%xmm1 \n"
+        "movdqa      %%xmm4, %%xmm5 \n"
+        "punpcklwd   %%xmm6, %%xmm4 \n"
+        "punpckhwd   %%xmm6, %%xmm5 \n"
+        "movdqa      %%xmm0, %%xmm2 \n"
+        "punpckldq   %%xmm4, %%xmm0 \n" // rows 0, 1
+        "punpckhdq   %%xmm4, %%xmm2 \n" // rows 2, 3
+        "movdqa      %%xmm1, %%xmm3 \n"
+        "punpckldq   %%xmm5, %%xmm1 \n" // rows 4, 5
+        "punpckhdq   %%xmm5, %%xmm3 \n" // rows 6, 7
+        "movq        %%xmm0, (%1)    \n"
+        "movhps      %%xmm0, (%1,%3) \n"
+        "lea     (%1,%3,2),  %1     \n"
+        "movq        %%xmm2, (%1)    \n"
+        "movhps      %%xmm2, (%1,%3) \n"
+        "lea     (%1,%3,2),  %1     \n"
+        "movq        %%xmm1, (%1)    \n"
+        "movhps      %%xmm1, (%1,%3) \n"
+        "lea     (%1,%3,2),  %1     \n"
+        "movq        %%xmm3, (%1)    \n"
+        "movhps      %%xmm3, (%1,%3) \n"
+        : "+&r"(src), "+&r"(dst)
+        : "r"(ss), "r"(ds)
+        : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",
+                       "xmm4", "xmm5", "xmm6", "xmm7",)
+          "memory"
+    );
+}
+
+static av_always_inline void transpose_4x4_16_sse2(uint8_t *src, x86_reg ss,
+                                                   uint8_t *dst, x86_reg ds)
+{
+    __asm__ volatile(
+        "movq          (%0), %%xmm0 \n"
+        "movq       (%0,%2), %%xmm1 \n"
+        "lea     (%0,%2,2),  %0     \n"
+        "movq          (%0), %%xmm2 \n"
+        "movq       (%0,%2), %%xmm3 \n"
+        "punpcklwd   %%xmm1, %%xmm0 \n"
+        "punpcklwd   %%xmm3, %%xmm2 \n"
+        "movdqa      %%xmm0, %%xmm1 \n"
+        "punpckldq   %%xmm2, %%xmm0 \n" // rows 0, 1
+        "punpckhdq   %%xmm2, %%xmm1 \n" // rows 2, 3
+        "movq        %%xmm0, (%1)    \n"
+        "movhps      %%xmm0, (%1,%3) \n"
+        "lea     (%1,%3,2),  %1     \n"
+        "movq        %%xmm1, (%1)    \n"
+        "movhps      %%xmm1, (%1,%3) \n"
+        : "+&r"(src), "+&r"(dst)
+        : "r"(ss), "r"(ds)
+        : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",)
+          "memory"
+    );
+}
+
+static av_always_inline void transpose_4x4_32_sse2(uint8_t *src, x86_reg ss,
+                                                   uint8_t *dst, x86_reg ds)
+{
+    __asm__ volatile(
+        "movdqu        (%0), %%xmm0 \n"
+        "movdqu     (%0,%2), %%xmm1 \n"
+        "lea     (%0,%2,2),  %0     \n"
+        "movdqu        (%0), %%xmm2 \n"
+        "movdqu     (%0,%2), %%xmm3 \n"
+        "movdqa      %%xmm0, %%xmm4 \n"
+        "punpckldq   %%xmm1, %%xmm0 \n"
+        "punpckhdq   %%xmm1, %%xmm4 \n"
+        "movdqa      %%xmm2, %%xmm5 \n"
+        "punpckldq   %%xmm3, %%xmm2 \n"
+        "punpckhdq   %%xmm3, %%xmm5 \n"
+        "movdqa      %%xmm0, %%xmm1 \n"
+        "punpcklqdq  %%xmm2, %%xmm0 \n" // row 0
+        "punpckhqdq  %%xmm2, %%xmm1 \n" // row 1
+        "movdqa      %%xmm4, %%xmm3 \n"
+        "punpcklqdq  %%xmm5, %%xmm4 \n" // row 2
+        "punpckhqdq  %%xmm5, %%xmm3 \n" // row 3
+        "movdqu      %%xmm0, (%1)    \n"
+        "movdqu      %%xmm1, (%1,%3) \n"
+        "lea     (%1,%3,2),  %1     \n"
+        "movdqu      %%xmm4, (%1)    \n"
+        "movdqu      %%xmm3, (%1,%3) \n"
+        : "+&r"(src), "+&r"(dst)
+        : "r"(ss), "r"(ds)
+        : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",)
+          "memory"
+    );
+}
+
+/* 8x8 blocks of wider pixels are transposed as 4x4 quadrants, the top right
+ * quadrant of the source becoming the bottom left one of the destination */
+#define TRANSPOSE_8X8_QUADS(bits, step)                                    \
+static void transpose_8x8_##bits##_sse2(uint8_t *src, int src_linesize,    \
+                                        uint8_t *dst, int dst_linesize)    \
+{                                                                          \
+    x86_reg ss = src_linesize, ds = dst_linesize;                          \
+                                                                           \
+    transpose_4x4_##bits##_sse2(src,                 ss,                   \
+                                dst,                 ds);                  \
+    transpose_4x4_##bits##_sse2(src + 4*step,        ss,                   \
+                                dst + 4*ds,          ds);                  \
+    transpose_4x4_##bits##_sse2(src + 4*ss,          ss,                   \
+                                dst + 4*step,        ds);                  \
+    transpose_4x4_##bits##_sse2(src + 4*ss + 4*step, ss,                   \
+                                dst + 4*ds + 4*step, ds);                  \
+}
+
+TRANSPOSE_8X8_QUADS(16, 2)
+TRANSPOSE_8X8_QUADS(32, 4)
+
+#endif /* HAVE_SSE2_INLINE */
+
+av_cold void ff_transpose_init_x86(TransVtable *v, int pixstep)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+#if HAVE_SSE2_INLINE
+    if (INLINE_SSE2(cpu_flags)) {
+        switch (pixstep) {
+        case 1: v->transpose_8x8 = transpose_8x8_8_sse2;  break;
+        case 2: v->transpose_8x8 = transpose_8x8_16_sse2; break;
+        case 4: v->transpose_8x8 = transpose_8x8_32_sse2; break;
+        }
+    }
+#endif
+}
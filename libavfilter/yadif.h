@@ -56,8 +56,9 @@ typedef struct YADIFContext {
 
     const AVPixFmtDescriptor *csp;
     int eof;
-    uint8_t *temp_line;
+    uint8_t *temp_line;         ///< edge lines buffers, one per slice job
     int temp_line_size;
+    int nb_temp_lines;
 } YADIFContext;
 
 void ff_yadif_init_x86(YADIFContext *yadif);
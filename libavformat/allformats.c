@@ -258,6 +258,7 @@ void av_register_all(void)
     REGISTER_MUXDEMUX (SWF, swf);
     REGISTER_DEMUXER  (TAK, tak);
     REGISTER_DEMUXER  (TEDCAPTIONS, tedcaptions);
+    REGISTER_MUXER    (TEE, tee);
     REGISTER_MUXER    (TG2, tg2);
     REGISTER_MUXER    (TGP, tgp);
     REGISTER_DEMUXER  (THP, thp);
@@ -295,6 +296,7 @@ void av_register_all(void)
 #if FF_API_APPLEHTTP_PROTO
     REGISTER_PROTOCOL (APPLEHTTP, applehttp);
 #endif
+    REGISTER_PROTOCOL (ASYNC, async);
     REGISTER_PROTOCOL (BLURAY, bluray);
     REGISTER_PROTOCOL (CACHE, cache);
     REGISTER_PROTOCOL (CONCAT, concat);
@@ -0,0 +1,308 @@
+/*
+ * Asynchronous read-ahead protocol
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Read-ahead of a nested protocol in a separate thread.
+ *
+ * A thread reads the nested protocol into a ring buffer, so that the
+ * reader only waits for the network or the disk when the buffer is empty.
+ * Seeks inside the buffered data are done without touching the nested
+ * protocol, other seeks discard the buffer.
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/fifo.h"
+#include "libavutil/opt.h"
+#include "libavutil/time.h"
+#include "avformat.h"
+#include "url.h"
+
+#define READ_CHUNK_SIZE 4096
+
+typedef struct AsyncContext {
+    const AVClass *class;
+    int buffer_size;
+    URLContext *inner;
+    int64_t pos;                /* position of the next byte returned by async_read() */
+    int64_t size;               /* size of the nested resource, or <0 if unknown */
+
+    pthread_t thread;
+    pthread_mutex_t mutex;      /* lock for everything below */
+    pthread_cond_t cond_main;   /* signaled by the thread */
+    pthread_cond_t cond_thread; /* signaled by the reader */
+    AVFifoBuffer *fifo;         /* data read ahead, starting at pos */
+    int eof;
+    int error;
+    int abort;
+    int seek_request;
+    int64_t seek_pos;
+    int64_t seek_ret;
+    int seek_done;
+    AVIOInterruptCB interrupt_callback;
+} AsyncContext;
+
+/* interrupts blocking reads of the nested protocol when closing */
+static int async_check_interrupt(void *arg)
+{
+    URLContext *h = arg;
+    AsyncContext *c = h->priv_data;
+
+    if (c->abort)
+        return 1;
+    return ff_check_interrupt(&h->interrupt_callback);
+}
+
+static void *async_thread(void *arg)
+{
+    URLContext *h = arg;
+    AsyncContext *c = h->priv_data;
+    uint8_t buf[READ_CHUNK_SIZE];
+    int ret;
+
+    pthread_mutex_lock(&c->mutex);
+    while (!c->abort) {
+        if (c->seek_request) {
+            int64_t pos = c->seek_pos;
+
+            pthread_mutex_unlock(&c->mutex);
+            ret = ffurl_seek(c->inner, pos, SEEK_SET);
+            pthread_mutex_lock(&c->mutex);
+
+            av_fifo_reset(c->fifo);
+            c->eof          = 0;
+            c->error        = 0;
+            c->seek_ret     = ret;
+            c->seek_request = 0;
+            c->seek_done    = 1;
+            pthread_cond_signal(&c->cond_main);
+            continue;
+        }
+
+        if (c->eof || c->error || av_fifo_space(c->fifo) < READ_CHUNK_SIZE) {
+            pthread_cond_wait(&c->cond_thread, &c->mutex);
+            continue;
+        }
+
+        pthread_mutex_unlock(&c->mutex);
+        ret = ffurl_read(c->inner, buf, sizeof(buf));
+        pthread_mutex_lock(&c->mutex);
+
+        /* the data belongs to the position before the seek */
+        if (c->seek_request)
+            continue;
+
+        if (ret > 0)
+            av_fifo_generic_write(c->fifo, buf, ret, NULL);
+        else if (!ret || ret == AVERROR_EOF)
+            c->eof = 1;
+        else
+            c->error = ret;
+        pthread_cond_signal(&c->cond_main);
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    return NULL;
+}
+
+static int async_open(URLContext *h, const char *arg, int flags)
+{
+    AsyncContext *c = h->priv_data;
+    int ret;
+
+    av_strstart(arg, "async:", &arg);
+
+    if (flags & AVIO_FLAG_WRITE)
+        return AVERROR(ENOSYS);
+
+    c->interrupt_callback.callback = async_check_interrupt;
+    c->interrupt_callback.opaque   = h;
+    if ((ret = ffurl_open(&c->inner, arg, flags & ~AVIO_FLAG_NONBLOCK,
+                          &c->interrupt_callback, NULL)) < 0)
+        return ret;
+
+    h->is_streamed = c->inner->is_streamed;
+    c->size        = ffurl_size(c->inner);
+
+    if (!(c->fifo = av_fifo_alloc(FFMAX(c->buffer_size, READ_CHUNK_SIZE)))) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    pthread_mutex_init(&c->mutex, NULL);
+    pthread_cond_init(&c->cond_main, NULL);
+    pthread_cond_init(&c->cond_thread, NULL);
+    if ((ret = pthread_create(&c->thread, NULL, async_thread, h))) {
+        av_log(h, AV_LOG_ERROR, "pthread_create failed: %s\n", strerror(ret));
+        pthread_cond_destroy(&c->cond_thread);
+        pthread_cond_destroy(&c->cond_main);
+        pthread_mutex_destroy(&c->mutex);
+        ret = AVERROR(ret);
+        goto fail;
+    }
+
+    return 0;
+fail:
+    av_fifo_free(c->fifo);
+    c->fifo = NULL;
+    ffurl_close(c->inner);
+    return ret;
+}
+
+/* wait for the thread for at most 100ms, with the mutex held */
+static int async_wait(AsyncContext *c)
+{
+    /* FIXME: using the monotonic clock would be better,
+       but it does not exist on all supported platforms. */
+    int64_t t = av_gettime() + 100000;
+    struct timespec tv = { .tv_sec  =  t / 1000000,
+                           .tv_nsec = (t % 1000000) * 1000 };
+    int ret = pthread_cond_timedwait(&c->cond_main, &c->mutex, &tv);
+    return ret == ETIMEDOUT ? AVERROR(EAGAIN) : AVERROR(ret);
+}
+
+static int async_read(URLContext *h, unsigned char *buf, int size)
+{
+    AsyncContext *c = h->priv_data;
+    int ret;
+
+    pthread_mutex_lock(&c->mutex);
+    for (;;) {
+        int avail = av_fifo_size(c->fifo);
+
+        if (avail) {
+            ret = FFMIN(avail, size);
+            av_fifo_generic_read(c->fifo, buf, ret, NULL);
+            c->pos += ret;
+            pthread_cond_signal(&c->cond_thread);
+            break;
+        } else if (c->error) {
+            ret = c->error;
+            break;
+        } else if (c->eof) {
+            ret = 0;
+            break;
+        } else if (h->flags & AVIO_FLAG_NONBLOCK) {
+            ret = AVERROR(EAGAIN);
+            break;
+        } else if ((ret = async_wait(c)) < 0 && av_fifo_size(c->fifo) <= 0 &&
+                   !c->eof && !c->error) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&c->mutex);
+
+    return ret;
+}
+
+static int64_t async_seek(URLContext *h, int64_t pos, int whence)
+{
+    AsyncContext *c = h->priv_data;
+    int64_t ret;
+
+    if (whence == AVSEEK_SIZE)
+        return c->size;
+    if (whence == SEEK_CUR)
+        pos += c->pos;
+    else if (whence == SEEK_END) {
+        if (c->size < 0)
+            return AVERROR(ENOSYS);
+        pos += c->size;
+    } else if (whence != SEEK_SET)
+        return AVERROR(EINVAL);
+    if (pos < 0)
+        return AVERROR(EINVAL);
+
+    pthread_mutex_lock(&c->mutex);
+
+    /* seek forward inside the data read ahead */
+    if (pos >= c->pos && pos - c->pos <= av_fifo_size(c->fifo)) {
+        av_fifo_drain(c->fifo, pos - c->pos);
+        c->pos = pos;
+        pthread_cond_signal(&c->cond_thread);
+        pthread_mutex_unlock(&c->mutex);
+        return pos;
+    }
+
+    c->seek_request = 1;
+    c->seek_pos     = pos;
+    c->seek_done    = 0;
+    pthread_cond_signal(&c->cond_thread);
+    while (!c->seek_done) {
+        if (ff_check_interrupt(&h->interrupt_callback)) {
+            pthread_mutex_unlock(&c->mutex);
+            return AVERROR_EXIT;
+        }
+        async_wait(c);
+    }
+    ret = c->seek_ret;
+    if (ret >= 0)
+        c->pos = ret;
+
+    pthread_mutex_unlock(&c->mutex);
+
+    return ret;
+}
+
+static int async_close(URLContext *h)
+{
+    AsyncContext *c = h->priv_data;
+
+    pthread_mutex_lock(&c->mutex);
+    c->abort = 1;
+    pthread_cond_signal(&c->cond_thread);
+    pthread_mutex_unlock(&c->mutex);
+
+    pthread_join(c->thread, NULL);
+
+    pthread_cond_destroy(&c->cond_thread);
+    pthread_cond_destroy(&c->cond_main);
+    pthread_mutex_destroy(&c->mutex);
+    av_fifo_free(c->fifo);
+
+    return ffurl_close(c->inner);
+}
+
+#define OFFSET(x) offsetof(AsyncContext, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+static const AVOption options[] = {
+    { "async_buffer_size", "Size of the read-ahead buffer in bytes", OFFSET(buffer_size), AV_OPT_TYPE_INT, { .i64 = 4 * 1024 * 1024 }, READ_CHUNK_SIZE, INT_MAX, D },
+    { NULL }
+};
+
+static const AVClass async_class = {
+    .class_name = "async",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+URLProtocol ff_async_protocol = {
+    .name            = "async",
+    .url_open        = async_open,
+    .url_read        = async_read,
+    .url_seek        = async_seek,
+    .url_close       = async_close,
+    .priv_data_size  = sizeof(AsyncContext),
+    .priv_data_class = &async_class,
+};
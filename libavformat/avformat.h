@@ -759,6 +759,11 @@ typedef struct AVStream {
         int64_t codec_info_duration_fields;
         int found_decoder;
 
+        /**
+         * Set if the parameters were set by avformat_load_stream_info().
+         */
+        int params_loaded;
+
         /**
          * Those are used for average framerate estimation.
          */
@@ -1205,6 +1210,14 @@ typedef struct AVFormatContext {
      */
     unsigned int correct_ts_overflow;
 
+    /**
+     * Number of threads used to decode the streams in
+     * avformat_find_stream_info(), 0 for automatic.
+     * - encoding: unused
+     * - decoding: Set by user via AVOptions (NO direct access)
+     */
+    int info_threads;
+
     /*****************************************************************
      * All fields below this line are not part of the public API. They
      * may not be used outside of libavformat and can be changed and
@@ -1242,6 +1255,23 @@ typedef struct AVFormatContext {
      */
 #define RAW_PACKET_BUFFER_SIZE 2500000
     int raw_packet_buffer_remaining_size;
+
+    /**
+     * Stream parameters set by avformat_load_stream_info(), an entry is
+     * freed once it was applied to its stream.
+     */
+    char **stream_info;
+    int nb_stream_info;
+
+    /**
+     * Number of streams with a non-NULL last_in_packet_buffer when muxing.
+     */
+    int nb_buffered_streams;
+    /**
+     * Unused packet_buffer entries of the muxing interleaver, kept to
+     * avoid an allocation per packet.
+     */
+    struct AVPacketList *packet_pool;
 } AVFormatContext;
 
 /**
@@ -1529,6 +1559,35 @@ int av_find_stream_info(AVFormatContext *ic);
  */
 int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options);
 
+/**
+ * Save the stream parameters found by avformat_find_stream_info() as a
+ * string, so that they can be passed to avformat_load_stream_info() when
+ * the same source is opened again.
+ *
+ * @param ic   media file handle
+ * @param info set to the string, which must be freed with av_free()
+ * @return >=0 if OK, AVERROR_xxx on error
+ */
+int avformat_save_stream_info(AVFormatContext *ic, char **info);
+
+/**
+ * Set stream parameters saved with avformat_save_stream_info(). This must
+ * be called after avformat_open_input() and before
+ * avformat_find_stream_info().
+ *
+ * A saved stream is applied to the stream with the same index and id, if
+ * the codec of the stream is unknown or the same as the saved one. Once all
+ * saved streams have been found, avformat_find_stream_info() does not
+ * decode these streams and only reads until it has the timestamps, even if
+ * the format has no header. To also skip format probing, pass the input
+ * format of the previous session to avformat_open_input().
+ *
+ * @param ic   media file handle
+ * @param info string returned by avformat_save_stream_info()
+ * @return >=0 if OK, AVERROR_xxx on error
+ */
+int avformat_load_stream_info(AVFormatContext *ic, const char *info);
+
 /**
  * Find the programs which belong to a given stream.
  *
@@ -160,9 +160,10 @@ static int read_braindead_odml_indx(AVFormatContext *s, int frame_num){
     int stream_id= 10*((chunk_id&0xFF) - '0') + (((chunk_id>>8)&0xFF) - '0');
     AVStream *st;
     AVIStream *ast;
-    int i;
+    int i, j, n;
     int64_t last_pos= -1;
     int64_t filesize= avi->fsize;
+    uint8_t buf[8 * 512];
 
     av_dlog(s, "longs_pre_entry:%d index_type:%d entries_in_use:%d chunk_id:%X base:%16"PRIX64"\n",
             longs_pre_entry,index_type, entries_in_use, chunk_id, base);
@@ -190,27 +191,35 @@ static int read_braindead_odml_indx(AVFormatContext *s, int frame_num){
             return -1;
     }
 
-    for(i=0; i<entries_in_use; i++){
-        if(index_type){
-            int64_t pos= avio_rl32(pb) + base - 8;
-            int len    = avio_rl32(pb);
-            int key= len >= 0;
-            len &= 0x7FFFFFFF;
+    if(index_type){
+        /* standard index: read the entries in blocks rather than
+         * field by field, they can number in the millions */
+        for(i=0; i<entries_in_use; i+=n){
+            n = FFMIN(entries_in_use - i, sizeof(buf) / 8);
+            n = avio_read(pb, buf, 8 * n) / 8;
+            if(n <= 0)
+                return -1;
+
+            for(j=0; j<n; j++){
+                int64_t pos= AV_RL32(buf + 8*j) + base - 8;
+                int len    = AV_RL32(buf + 8*j + 4);
+                int key= len >= 0;
+                len &= 0x7FFFFFFF;
 
 #ifdef DEBUG_SEEK
-            av_log(s, AV_LOG_ERROR, "pos:%"PRId64", len:%X\n", pos, len);
+                av_log(s, AV_LOG_ERROR, "pos:%"PRId64", len:%X\n", pos, len);
 #endif
-            if(url_feof(pb))
-                return -1;
-
-            if(last_pos == pos || pos == base - 8)
-                avi->non_interleaved= 1;
-            if(last_pos != pos && (len || !ast->sample_size))
-                av_add_index_entry(st, pos, ast->cum_len, len, 0, key ? AVINDEX_KEYFRAME : 0);
+                if(last_pos == pos || pos == base - 8)
+                    avi->non_interleaved= 1;
+                if(last_pos != pos && (len || !ast->sample_size))
+                    av_add_index_entry(st, pos, ast->cum_len, len, 0, key ? AVINDEX_KEYFRAME : 0);
 
-            ast->cum_len += get_duration(ast, len);
-            last_pos= pos;
-        }else{
+                ast->cum_len += get_duration(ast, len);
+                last_pos= pos;
+            }
+        }
+    }else{
+        for(i=0; i<entries_in_use; i++){
             int64_t offset, pos;
             int duration;
             offset = avio_rl64(pb);
@@ -238,7 +247,6 @@ static int read_braindead_odml_indx(AVFormatContext *s, int frame_num){
                 av_log(s, AV_LOG_ERROR, "Failed to restore position after reading index\n");
                 return -1;
             }
-
         }
     }
     avi->index_loaded=2;
@@ -1260,6 +1268,9 @@ static int avi_read_idx1(AVFormatContext *s, int size)
     unsigned last_idx= -1;
     int64_t idx1_pos, first_packet_pos = 0, data_offset = 0;
     int anykey = 0;
+    uint8_t buf[16 * 256];
+    const uint8_t *entry = buf;
+    int left = 0;
 
     nb_index_entries = size / 16;
     if (nb_index_entries <= 0)
@@ -1280,13 +1291,20 @@ static int avi_read_idx1(AVFormatContext *s, int size)
 
     /* Read the entries and sort them in each stream component. */
     for(i = 0; i < nb_index_entries; i++) {
-        if(url_feof(pb))
-            return -1;
+        if (!left) {
+            left = FFMIN(nb_index_entries - i, sizeof(buf) / 16);
+            left = avio_read(pb, buf, 16 * left) / 16;
+            if (left <= 0)
+                return -1;
+            entry = buf;
+        }
+        left--;
 
-        tag = avio_rl32(pb);
-        flags = avio_rl32(pb);
-        pos = avio_rl32(pb);
-        len = avio_rl32(pb);
+        tag   = AV_RL32(entry);
+        flags = AV_RL32(entry +  4);
+        pos   = AV_RL32(entry +  8);
+        len   = AV_RL32(entry + 12);
+        entry += 16;
         av_dlog(s, "%d: tag=0x%x flags=0x%x pos=0x%x len=%d/",
                 i, tag, flags, pos, len);
 
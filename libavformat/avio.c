@@ -406,6 +406,14 @@ int ffurl_get_multi_file_handle(URLContext *h, int **handles, int *numhandles)
     return h->prot->url_get_multi_file_handle(h, handles, numhandles);
 }
 
+int ffurl_get_mapped(URLContext *h, int64_t pos, int size,
+                     AVBufferRef **buf, uint8_t **data)
+{
+    if (!h->prot->url_get_mapped)
+        return AVERROR(ENOSYS);
+    return h->prot->url_get_mapped(h, pos, size, buf, data);
+}
+
 int ffurl_shutdown(URLContext *h, int flags)
 {
     if (!h->prot->url_shutdown)
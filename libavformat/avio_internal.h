@@ -45,8 +45,36 @@ int ffio_init_context(AVIOContext *s,
  */
 int ffio_read_partial(AVIOContext *s, unsigned char *buf, int size);
 
+/**
+ * Read size bytes from AVIOContext, returning a pointer.
+ * Note that the data pointed at by the returned pointer is only
+ * valid until the next call that references the same IO context.
+ * @param s IO context
+ * @param buf pointer to buffer into which to assemble the requested
+ *    data if it is not available in contiguous addresses in the
+ *    underlying buffer
+ * @param size number of bytes requested
+ * @param data address at which to store pointer: this will be a
+ *    a direct pointer into the underlying buffer if the requested
+ *    number of bytes are available at contiguous addresses, otherwise
+ *    will be a copy of buf
+ * @return number of bytes read or AVERROR
+ */
+int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsigned char **data);
+
 void ffio_fill(AVIOContext *s, int b, int count);
 
+/**
+ * Read size bytes from AVIOContext into a packet that references the
+ * protocol's memory mapping of the data instead of copying it.
+ * The padding of such a packet contains the following bytes of the
+ * resource instead of zeros.
+ *
+ * @return 0 on success, a negative value if the data is not mapped, in
+ *         which case nothing was read
+ */
+int ffio_read_mapped(AVIOContext *s, struct AVPacket *pkt, int size);
+
 static av_always_inline void ffio_wfourcc(AVIOContext *pb, const uint8_t *s)
 {
     avio_wl32(pb, MKTAG(s[0], s[1], s[2], s[3]));
@@ -25,6 +25,7 @@
 #include "libavutil/log.h"
 #include "libavutil/opt.h"
 #include "libavutil/avassert.h"
+#include "libavcodec/internal.h"
 #include "avformat.h"
 #include "avio.h"
 #include "avio_internal.h"
@@ -177,7 +178,17 @@ void avio_write(AVIOContext *s, const unsigned char *buf, int size)
         return;
     }
     while (size > 0) {
-        int len = FFMIN(s->buf_end - s->buf_ptr, size);
+        int len;
+
+        /* blocks at least as large as the buffer are written directly
+         * instead of being copied to the buffer piece by piece */
+        if (s->buf_ptr == s->buffer && size >= s->buffer_size &&
+            !s->update_checksum && !s->max_packet_size) {
+            writeout(s, buf, size);
+            return;
+        }
+
+        len = FFMIN(s->buf_end - s->buf_ptr, size);
         memcpy(s->buf_ptr, buf, len);
         s->buf_ptr += len;
 
@@ -522,6 +533,18 @@ int avio_read(AVIOContext *s, unsigned char *buf, int size)
     return size1 - size;
 }
 
+int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsigned char **data)
+{
+    if (s->buf_end - s->buf_ptr >= size && !s->write_flag) {
+        *data = s->buf_ptr;
+        s->buf_ptr += size;
+        return size;
+    } else {
+        *data = buf;
+        return avio_read(s, buf, size);
+    }
+}
+
 int ffio_read_partial(AVIOContext *s, unsigned char *buf, int size)
 {
     int len;
@@ -545,6 +568,32 @@ int ffio_read_partial(AVIOContext *s, unsigned char *buf, int size)
     return len;
 }
 
+int ffio_read_mapped(AVIOContext *s, AVPacket *pkt, int size)
+{
+    AVBufferRef *buf;
+    uint8_t *data;
+    int64_t pos, ret;
+
+    if (size <= 0 || s->read_packet != (void*)ffurl_read || s->write_flag ||
+        s->update_checksum || !s->opaque)
+        return AVERROR(ENOSYS);
+
+    pos = avio_tell(s);
+    if ((ret = ffurl_get_mapped(s->opaque, pos, size, &buf, &data)) < 0)
+        return ret;
+    ret = avpriv_packet_from_buffer(pkt, buf, data, size);
+    av_buffer_unref(&buf);
+    if (ret < 0)
+        return ret;
+    if ((ret = avio_skip(s, size)) < 0) {
+        av_free_packet(pkt);
+        return ret;
+    }
+
+    pkt->pos = pos;
+    return 0;
+}
+
 unsigned int avio_rl16(AVIOContext *s)
 {
     unsigned int val;
@@ -684,6 +733,8 @@ int ffio_fdopen(AVIOContext **s, URLContext *h)
     max_packet_size = h->max_packet_size;
     if (max_packet_size) {
         buffer_size = max_packet_size; /* no need to bufferize more than one packet */
+    } else if (h->io_buffer_size > 0) {
+        buffer_size = h->io_buffer_size;
     } else {
         buffer_size = IO_BUFFER_SIZE;
     }
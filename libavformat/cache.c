@@ -23,14 +23,17 @@
 
 /**
  * @TODO
- *      support non continuous caching
  *      support keeping files
- *      support filling with a background thread
+ *
+ * Filling in the background is done by caching the async protocol,
+ * e.g. cache:async:http://...
  */
 
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/file.h"
+#include "libavutil/opt.h"
+#include "libavutil/tree.h"
 #include "avformat.h"
 #include <fcntl.h>
 #if HAVE_IO_H
@@ -44,13 +47,36 @@
 #include "os_support.h"
 #include "url.h"
 
+/**
+ * A range of the input that is stored contiguously in the cache file.
+ */
+typedef struct CacheEntry {
+    int64_t logical_pos;        ///< must be first, entries are their own keys
+    int64_t physical_pos;
+    int size;
+} CacheEntry;
+
 typedef struct Context {
+    AVClass *class;
     int fd;
-    int64_t end;
-    int64_t pos;
+    struct AVTreeNode *root;    ///< CacheEntry indexed by logical_pos
+    int64_t logical_pos;        ///< position of the next byte returned by cache_read()
+    int64_t cache_pos;          ///< position in the cache file
+    int64_t inner_pos;          ///< position in the inner protocol
+    int64_t end;                ///< largest known position of the input
+    int is_true_eof;            ///< end is the size of the input
     URLContext *inner;
+    int64_t cache_hit, cache_miss;
+    int read_ahead_limit;
 } Context;
 
+static int cmp(void *key, const void *node)
+{
+    int64_t a = *(const int64_t *)key;
+    int64_t b = ((const CacheEntry *)node)->logical_pos;
+    return (a > b) - (a < b);
+}
+
 static int cache_open(URLContext *h, const char *arg, int flags)
 {
     char *buffername;
@@ -70,66 +96,236 @@ static int cache_open(URLContext *h, const char *arg, int flags)
     return ffurl_open(&c->inner, arg, flags, &h->interrupt_callback, NULL);
 }
 
+static int add_entry(URLContext *h, const unsigned char *buf, int size)
+{
+    Context *c= h->priv_data;
+    int64_t pos;
+    int ret;
+    CacheEntry *entry, *old, *next[2] = { NULL, NULL };
+    struct AVTreeNode *node;
+
+    /* new data is always appended to the cache file */
+    pos = lseek(c->fd, 0, SEEK_END);
+    if (pos < 0) {
+        ret = AVERROR(errno);
+        av_log(h, AV_LOG_ERROR, "Failed to seek in cache\n");
+        return ret;
+    }
+    c->cache_pos = pos;
+
+    ret = write(c->fd, buf, size);
+    if (ret < 0) {
+        ret = AVERROR(errno);
+        av_log(h, AV_LOG_ERROR, "Failed to write to cache\n");
+        return ret;
+    }
+    c->cache_pos += ret;
+
+    entry = av_tree_find(c->root, &c->logical_pos, cmp, (void **)next);
+    if (!entry)
+        entry = next[0];
+
+    /* extend the previous entry if the data follows it in both files */
+    if (entry &&
+        entry->logical_pos  + entry->size == c->logical_pos &&
+        entry->physical_pos + entry->size == pos) {
+        entry->size += ret;
+        return 0;
+    }
+
+    entry = av_malloc(sizeof(*entry));
+    node  = av_tree_node_alloc();
+    if (!entry || !node) {
+        av_free(entry);
+        av_free(node);
+        return AVERROR(ENOMEM);
+    }
+    entry->logical_pos  = c->logical_pos;
+    entry->physical_pos = pos;
+    entry->size         = ret;
+
+    old = av_tree_insert(&c->root, entry, cmp, &node);
+    if (old && old != entry) {
+        /* the entry starting at this position could not be read back,
+         * replace its data */
+        old->physical_pos = entry->physical_pos;
+        old->size         = entry->size;
+        av_free(entry);
+    }
+    av_free(node);
+
+    return 0;
+}
+
 static int cache_read(URLContext *h, unsigned char *buf, int size)
 {
     Context *c= h->priv_data;
-    int r;
-
-    if(c->pos<c->end){
-        r = read(c->fd, buf, FFMIN(size, c->end - c->pos));
-        if(r>0)
-            c->pos += r;
-        return (-1 == r)?AVERROR(errno):r;
-    }else{
-        r = ffurl_read(c->inner, buf, size);
-        if(r > 0){
-            int r2= write(c->fd, buf, r);
-            av_assert0(r2==r); // FIXME handle cache failure
-            c->pos += r;
-            c->end += r;
+    CacheEntry *entry, *next[2] = { NULL, NULL };
+    int64_t r;
+
+    entry = av_tree_find(c->root, &c->logical_pos, cmp, (void **)next);
+    if (!entry)
+        entry = next[0];
+
+    if (entry) {
+        int64_t in_block_pos = c->logical_pos - entry->logical_pos;
+        av_assert0(entry->logical_pos <= c->logical_pos);
+        if (in_block_pos < entry->size) {
+            int64_t physical_target = entry->physical_pos + in_block_pos;
+
+            if (c->cache_pos != physical_target)
+                r = lseek(c->fd, physical_target, SEEK_SET);
+            else
+                r = c->cache_pos;
+
+            if (r >= 0) {
+                c->cache_pos = r;
+                r = read(c->fd, buf, FFMIN(size, entry->size - in_block_pos));
+            }
+
+            if (r > 0) {
+                c->cache_pos   += r;
+                c->logical_pos += r;
+                c->cache_hit++;
+                return r;
+            }
         }
-        return r;
     }
+
+    /* cache miss or failure of the cache, read from the inner protocol */
+    if (c->logical_pos != c->inner_pos) {
+        r = ffurl_seek(c->inner, c->logical_pos, SEEK_SET);
+        if (r < 0) {
+            av_log(h, AV_LOG_ERROR, "Failed to perform internal seek\n");
+            return r;
+        }
+        c->inner_pos = r;
+    }
+
+    r = ffurl_read(c->inner, buf, size);
+    if (r == 0 && size > 0)
+        c->is_true_eof = 1;
+    if (r <= 0)
+        return r;
+    c->inner_pos += r;
+    c->cache_miss++;
+
+    /* the data is returned even if it could not be cached */
+    add_entry(h, buf, r);
+    c->logical_pos += r;
+    c->end = FFMAX(c->end, c->logical_pos);
+
+    return r;
 }
 
 static int64_t cache_seek(URLContext *h, int64_t pos, int whence)
 {
     Context *c= h->priv_data;
+    int64_t ret;
 
     if (whence == AVSEEK_SIZE) {
         pos= ffurl_seek(c->inner, pos, whence);
         if(pos <= 0){
             pos= ffurl_seek(c->inner, -1, SEEK_END);
-            ffurl_seek(c->inner, c->end, SEEK_SET);
-            if(pos <= 0)
-                return c->end;
+            if (ffurl_seek(c->inner, c->inner_pos, SEEK_SET) < 0)
+                av_log(h, AV_LOG_ERROR, "Inner protocol failed to seek back\n");
         }
-        return pos;
+        if (pos > 0)
+            c->is_true_eof = 1;
+        c->end = FFMAX(c->end, pos);
+        return pos > 0 ? pos : c->end;
     }
 
-    pos= lseek(c->fd, pos, whence);
-    if(pos<0){
-        return pos;
-    }else if(pos <= c->end){
-        c->pos= pos;
+    if (whence == SEEK_CUR) {
+        whence = SEEK_SET;
+        pos += c->logical_pos;
+    } else if (whence == SEEK_END && c->is_true_eof) {
+resolve_eof:
+        whence = SEEK_SET;
+        pos += c->end;
+    }
+
+    /* within the known size, a read will either hit the cache or seek the
+     * inner protocol */
+    if (whence == SEEK_SET && pos >= 0 && pos < c->end) {
+        c->logical_pos = pos;
         return pos;
-    }else{
-        if(lseek(c->fd, c->pos, SEEK_SET) < 0) {
-            av_log(h, AV_LOG_ERROR, "Failure to seek in cache\n");
+    }
+
+    ret = ffurl_seek(c->inner, pos, whence);
+    if ((whence == SEEK_SET && pos >= c->logical_pos ||
+         whence == SEEK_END && pos <= 0) && ret < 0) {
+        /* the inner protocol cannot seek, read forward through the cache
+         * from where the inner protocol is, which is at most end */
+        if ((whence == SEEK_SET && c->read_ahead_limit >= pos - c->inner_pos) ||
+            c->read_ahead_limit < 0) {
+            int64_t logical_pos = c->logical_pos;
+            uint8_t tmp[32768];
+
+            c->logical_pos = c->inner_pos;
+            while (c->logical_pos < pos || whence == SEEK_END) {
+                int size = sizeof(tmp);
+                if (whence == SEEK_SET)
+                    size = FFMIN(sizeof(tmp), pos - c->logical_pos);
+                ret = cache_read(h, tmp, size);
+                if (ret == 0 && whence == SEEK_END) {
+                    av_assert0(c->is_true_eof);
+                    goto resolve_eof;
+                }
+                if (ret <= 0) {
+                    c->logical_pos = logical_pos;
+                    return ret < 0 ? ret : AVERROR_EOF;
+                }
+            }
+            return c->logical_pos;
         }
-        return AVERROR(EPIPE);
     }
+
+    if (ret >= 0) {
+        c->inner_pos   = ret;
+        c->logical_pos = ret;
+        c->end = FFMAX(c->end, ret);
+    }
+
+    return ret;
+}
+
+static int enu_free(void *opaque, void *elem)
+{
+    av_free(elem);
+    return 0;
 }
 
 static int cache_close(URLContext *h)
 {
     Context *c= h->priv_data;
+
+    av_log(h, AV_LOG_VERBOSE, "Statistics, cache hits:%"PRId64" cache misses:%"PRId64"\n",
+           c->cache_hit, c->cache_miss);
+
     close(c->fd);
     ffurl_close(c->inner);
+    av_tree_enumerate(c->root, NULL, NULL, enu_free);
+    av_tree_destroy(c->root);
 
     return 0;
 }
 
+#define OFFSET(x) offsetof(Context, x)
+#define D AV_OPT_FLAG_DECODING_PARAM
+
+static const AVOption options[] = {
+    { "read_ahead_limit", "Amount in bytes that may be read ahead when seeking isn't supported, -1 for unlimited", OFFSET(read_ahead_limit), AV_OPT_TYPE_INT, { .i64 = 65536 }, -1, INT_MAX, D },
+    { NULL },
+};
+
+static const AVClass cache_context_class = {
+    .class_name = "Cache",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 URLProtocol ff_cache_protocol = {
     .name                = "cache",
     .url_open            = cache_open,
@@ -137,4 +333,5 @@ URLProtocol ff_cache_protocol = {
     .url_seek            = cache_seek,
     .url_close           = cache_close,
     .priv_data_size      = sizeof(Context),
+    .priv_data_class     = &cache_context_class,
 };
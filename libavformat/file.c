@@ -20,6 +20,7 @@
  */
 
 #include "libavutil/avstring.h"
+#include "libavutil/buffer.h"
 #include "libavutil/opt.h"
 #include "avformat.h"
 #include <fcntl.h>
@@ -33,6 +34,9 @@
 #include <stdlib.h>
 #include "os_support.h"
 #include "url.h"
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 /* Some systems may not have S_ISFIFO */
 #ifndef S_ISFIFO
@@ -49,10 +53,19 @@ typedef struct FileContext {
     const AVClass *class;
     int fd;
     int trunc;
+    int buffer_size;
+    int use_mmap;
+    AVBufferRef *map;   /* the whole file mapped in memory, with use_mmap */
+    int64_t map_size;
+    int64_t map_pos;    /* read position in the mapping */
 } FileContext;
 
 static const AVOption file_options[] = {
     { "truncate", "Truncate existing files on write", offsetof(FileContext, trunc), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
+    { "buffer_size", "Size of the I/O buffer in bytes, 0 for the default", offsetof(FileContext, buffer_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM | AV_OPT_FLAG_DECODING_PARAM },
+#if HAVE_MMAP
+    { "mmap", "Map files opened for reading in memory", offsetof(FileContext, use_mmap), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+#endif
     { NULL }
 };
 
@@ -66,7 +79,16 @@ static const AVClass file_class = {
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
-    int r = read(c->fd, buf, size);
+    int r;
+
+    if (c->map) {
+        size = FFMIN(size, FFMAX(c->map_size - c->map_pos, 0));
+        memcpy(buf, c->map->data + c->map_pos, size);
+        c->map_pos += size;
+        return size;
+    }
+
+    r = read(c->fd, buf, size);
     return (-1 == r)?AVERROR(errno):r;
 }
 
@@ -109,6 +131,60 @@ static int file_check(URLContext *h, int mask)
 
 #if CONFIG_FILE_PROTOCOL
 
+#if HAVE_MMAP
+static void file_unmap(void *opaque, uint8_t *data)
+{
+    size_t *size = opaque;
+    munmap(data, *size);
+    av_free(size);
+}
+
+static void file_map(URLContext *h, const struct stat *st)
+{
+    FileContext *c = h->priv_data;
+    size_t *size;
+    void *ptr;
+
+    if (!S_ISREG(st->st_mode) || !st->st_size || st->st_size > SIZE_MAX)
+        return;
+    if (!(size = av_malloc(sizeof(*size))))
+        return;
+    *size = st->st_size;
+
+    /* private and writable, so that writes to the padding of packets
+     * referencing the mapping never reach the file */
+    ptr = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE, c->fd, 0);
+    if (ptr == MAP_FAILED) {
+        av_log(h, AV_LOG_VERBOSE, "mmap() failed, reading the file instead\n");
+        av_free(size);
+        return;
+    }
+    c->map = av_buffer_create(ptr, FFMIN(*size, INT_MAX), file_unmap, size,
+                              AV_BUFFER_FLAG_READONLY);
+    if (!c->map) {
+        munmap(ptr, *size);
+        av_free(size);
+        return;
+    }
+    c->map_size = st->st_size;
+    c->map_pos  = 0;
+}
+
+static int file_get_mapped(URLContext *h, int64_t pos, int size,
+                           AVBufferRef **buf, uint8_t **data)
+{
+    FileContext *c = h->priv_data;
+
+    if (!c->map || pos < 0 || size < 0 ||
+        pos + size + FF_INPUT_BUFFER_PADDING_SIZE > c->map_size)
+        return AVERROR(ENOSYS);
+    if (!(*buf = av_buffer_ref(c->map)))
+        return AVERROR(ENOMEM);
+    *data = c->map->data + pos;
+    return 0;
+}
+#endif
+
 static int file_open(URLContext *h, const char *filename, int flags)
 {
     FileContext *c = h->priv_data;
@@ -138,6 +214,12 @@ static int file_open(URLContext *h, const char *filename, int flags)
     c->fd = fd;
 
     h->is_streamed = !fstat(fd, &st) && S_ISFIFO(st.st_mode);
+    h->io_buffer_size = c->buffer_size;
+
+#if HAVE_MMAP
+    if (c->use_mmap && !(flags & AVIO_FLAG_WRITE) && !h->is_streamed)
+        file_map(h, &st);
+#endif
 
     return 0;
 }
@@ -154,6 +236,16 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
         return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
     }
 
+    if (c->map) {
+        if (whence == SEEK_CUR)
+            pos += c->map_pos;
+        else if (whence == SEEK_END)
+            pos += c->map_size;
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        return c->map_pos = pos;
+    }
+
     ret = lseek(c->fd, pos, whence);
 
     return ret < 0 ? AVERROR(errno) : ret;
@@ -162,6 +254,8 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
+    /* the mapping stays valid as long as packets reference it */
+    av_buffer_unref(&c->map);
     return close(c->fd);
 }
 
@@ -174,6 +268,9 @@ URLProtocol ff_file_protocol = {
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
     .url_check           = file_check,
+#if HAVE_MMAP
+    .url_get_mapped      = file_get_mapped,
+#endif
     .priv_data_size      = sizeof(FileContext),
     .priv_data_class     = &file_class,
 };
@@ -881,12 +881,49 @@ leave:
     return ret;
 }
 
+/**
+ * Seek to a keyframe from the index, which holds the keyframes object of
+ * onMetaData and the keyframes found while reading. Audio packets are not
+ * indexed, so seeks on an audio stream use the keyframes of the video
+ * stream instead of scanning the file from the start.
+ */
+static int flv_seek_index(AVFormatContext *s, int stream_index,
+                          int64_t ts, int flags)
+{
+    AVStream *st = s->streams[stream_index];
+    int i, index;
+    int64_t ret;
+
+    if (!st->nb_index_entries) {
+        /* all streams use a 1/1000 time base */
+        for (i = 0; i < s->nb_streams; i++)
+            if (s->streams[i]->nb_index_entries > st->nb_index_entries)
+                st = s->streams[i];
+    }
+
+    index = av_index_search_timestamp(st, ts, flags);
+    /* past the last known keyframe, let the generic code look for later ones */
+    if (index < 0 || index == st->nb_index_entries - 1)
+        return -1;
+
+    if ((ret = avio_seek(s->pb, st->index_entries[index].pos, SEEK_SET)) < 0)
+        return ret;
+    ff_update_cur_dts(s, st, st->index_entries[index].timestamp);
+
+    return 0;
+}
+
 static int flv_read_seek(AVFormatContext *s, int stream_index,
     int64_t ts, int flags)
 {
     FLVContext *flv = s->priv_data;
+    int ret;
+
     flv->validate_count = 0;
-    return avio_seek_time(s->pb, stream_index, ts, flags);
+    ret = avio_seek_time(s->pb, stream_index, ts, flags);
+    if (ret == AVERROR(ENOSYS))
+        ret = flv_seek_index(s, stream_index, ts, flags);
+    return ret;
 }
 
 #define OFFSET(x) offsetof(FLVContext, x)
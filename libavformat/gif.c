@@ -117,36 +117,8 @@ static const rgb_triplet gif_clut[216] = {
     { 0xff, 0xff, 0x00 }, { 0xff, 0xff, 0x33 }, { 0xff, 0xff, 0x66 }, { 0xff, 0xff, 0x99 }, { 0xff, 0xff, 0xcc }, { 0xff, 0xff, 0xff },
 };
 
-/* GIF header */
-static int gif_image_write_header(AVIOContext *pb, int width, int height,
-                                  int loop_count, uint32_t *palette)
+static void gif_write_loop_ext(AVIOContext *pb, int loop_count)
 {
-    int i;
-    unsigned int v;
-
-    avio_write(pb, "GIF", 3);
-    avio_write(pb, "89a", 3);
-    avio_wl16(pb, width);
-    avio_wl16(pb, height);
-
-    avio_w8(pb, 0xf7); /* flags: global clut, 256 entries */
-    avio_w8(pb, 0x1f); /* background color index */
-    avio_w8(pb, 0);    /* aspect ratio */
-
-    /* the global palette */
-    if (!palette) {
-        avio_write(pb, (const unsigned char *)gif_clut, 216 * 3);
-        for (i = 0; i < ((256 - 216) * 3); i++)
-            avio_w8(pb, 0);
-    } else {
-        for (i = 0; i < 256; i++) {
-            v = palette[i];
-            avio_w8(pb, (v >> 16) & 0xff);
-            avio_w8(pb, (v >>  8) & 0xff);
-            avio_w8(pb, (v)       & 0xff);
-        }
-    }
-
     /* update: this is the 'NETSCAPE EXTENSION' that allows for looped animated
      * GIF, see http://members.aol.com/royalef/gifabout.htm#net-extension
      *
@@ -180,6 +152,39 @@ static int gif_image_write_header(AVIOContext *pb, int width, int height,
         avio_w8(pb, 0x00); // byte 19
     }
 #endif
+}
+
+/* GIF header */
+static int gif_image_write_header(AVIOContext *pb, int width, int height,
+                                  int loop_count, uint32_t *palette)
+{
+    int i;
+    unsigned int v;
+
+    avio_write(pb, "GIF", 3);
+    avio_write(pb, "89a", 3);
+    avio_wl16(pb, width);
+    avio_wl16(pb, height);
+
+    avio_w8(pb, 0xf7); /* flags: global clut, 256 entries */
+    avio_w8(pb, 0x1f); /* background color index */
+    avio_w8(pb, 0);    /* aspect ratio */
+
+    /* the global palette */
+    if (!palette) {
+        avio_write(pb, (const unsigned char *)gif_clut, 216 * 3);
+        for (i = 0; i < ((256 - 216) * 3); i++)
+            avio_w8(pb, 0);
+    } else {
+        for (i = 0; i < 256; i++) {
+            v = palette[i];
+            avio_w8(pb, (v >> 16) & 0xff);
+            avio_w8(pb, (v >>  8) & 0xff);
+            avio_w8(pb, (v)       & 0xff);
+        }
+    }
+
+    gif_write_loop_ext(pb, loop_count);
     return 0;
 }
 
@@ -258,6 +263,7 @@ typedef struct {
     int64_t time, file_time;
     uint8_t buffer[100]; /* data chunks */
     int loop;
+    int header_written;
 } GIFContext;
 
 static int gif_write_header(AVFormatContext *s)
@@ -290,13 +296,19 @@ static int gif_write_header(AVFormatContext *s)
 //        rate = video_enc->time_base.den;
     }
 
-    if (video_enc->pix_fmt != AV_PIX_FMT_RGB24) {
+    /* the header of the first GIF encoder packet is used as file header */
+    if (video_enc->codec_id == AV_CODEC_ID_GIF)
+        return 0;
+
+    if (video_enc->codec_id != AV_CODEC_ID_RAWVIDEO ||
+        video_enc->pix_fmt != AV_PIX_FMT_RGB24) {
         av_log(s, AV_LOG_ERROR,
                "ERROR: gif only handles the rgb24 pixel format. Use -pix_fmt rgb24.\n");
         return AVERROR(EIO);
     }
 
     gif_image_write_header(pb, width, height, gif->loop, NULL);
+    gif->header_written = 1;
 
     avio_flush(s->pb);
     return 0;
@@ -333,11 +345,64 @@ static int gif_write_video(AVFormatContext *s, AVCodecContext *enc,
     return 0;
 }
 
+/**
+ * Append a packet of the GIF encoder, which is a complete GIF image, to
+ * the animation: its header is only kept for the first one, its graphic
+ * control extension gets the frame delay and its trailer is dropped.
+ */
+static int gif_write_gif_packet(AVFormatContext *s, AVCodecContext *enc,
+                                const uint8_t *buf, int size)
+{
+    GIFContext *gif = s->priv_data;
+    AVIOContext *pb = s->pb;
+    const uint8_t *end = buf + size;
+    int header_size, jiffies;
+
+    if (size < 13 || memcmp(buf, "GIF", 3))
+        return AVERROR_INVALIDDATA;
+    header_size = 13;
+    if (buf[10] & 0x80)
+        header_size += 3 << ((buf[10] & 7) + 1);
+    if (size < header_size + 1)
+        return AVERROR_INVALIDDATA;
+
+    if (!gif->header_written) {
+        avio_write(pb, buf, header_size);
+        gif_write_loop_ext(pb, gif->loop);
+        gif->header_written = 1;
+    }
+    buf += header_size;
+    if (end[-1] == 0x3b)
+        end--;
+
+    jiffies = (70 * enc->time_base.num / enc->time_base.den) - 1;
+
+    if (end - buf >= 8 && buf[0] == 0x21 && buf[1] == 0xf9 && buf[2] == 0x04) {
+        avio_write(pb, buf, 4);
+        avio_wl16(pb, jiffies);
+        buf += 6;
+    } else {
+        avio_w8(pb, 0x21);
+        avio_w8(pb, 0xf9);
+        avio_w8(pb, 0x04); /* block size */
+        avio_w8(pb, 0x04); /* flags */
+        avio_wl16(pb, jiffies);
+        avio_w8(pb, 0x1f); /* transparent color index */
+        avio_w8(pb, 0x00);
+    }
+    avio_write(pb, buf, end - buf);
+
+    avio_flush(s->pb);
+    return 0;
+}
+
 static int gif_write_packet(AVFormatContext *s, AVPacket *pkt)
 {
     AVCodecContext *codec = s->streams[pkt->stream_index]->codec;
     if (codec->codec_type == AVMEDIA_TYPE_AUDIO)
         return 0; /* just ignore audio */
+    else if (codec->codec_id == AV_CODEC_ID_GIF)
+        return gif_write_gif_packet(s, codec, pkt->data, pkt->size);
     else
         return gif_write_video(s, codec, pkt->data, pkt->size);
 }
@@ -34,9 +34,15 @@
 #include "avformat.h"
 #include "internal.h"
 #include "avio_internal.h"
+#include "http.h"
 #include "url.h"
 
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #define INITIAL_BUFFER_SIZE 32768
+#define PREFETCH_READ_SIZE  65536
 
 /*
  * An apple http stream consists of a playlist with media segment files,
@@ -63,6 +69,27 @@ struct segment {
     uint8_t iv[16];
 };
 
+#if HAVE_PTHREADS
+/*
+ * A segment downloaded into memory by its own thread, ahead of the
+ * segment currently read.
+ */
+struct prefetch {
+    struct variant *var;
+    int active;             /* the thread has been started and not joined */
+    int seq_no;
+    char url[MAX_URL_SIZE];
+    pthread_t thread;
+    uint8_t *data;
+    int size;
+    int max_size;
+    int read_pos;
+    int done;               /* protected by prefetch_lock */
+    int error;              /* protected by prefetch_lock */
+    int abort;
+};
+#endif
+
 /*
  * Each variant has its own demuxer. If it currently is active,
  * it has an open AVIOContext too, and potentially an AVPacket
@@ -74,6 +101,7 @@ struct variant {
     AVIOContext pb;
     uint8_t* read_buffer;
     URLContext *input;
+    URLContext *http_input; /* persistent connection of the previous segment */
     AVFormatContext *parent;
     int index;
     AVFormatContext *ctx;
@@ -91,9 +119,20 @@ struct variant {
 
     char key_url[MAX_URL_SIZE];
     uint8_t key[16];
+
+#if HAVE_PTHREADS
+    struct prefetch *prefetch;      /* prefetch_segments slots, or NULL */
+    struct prefetch *cur_prefetch;  /* slot the current segment is read from */
+    pthread_mutex_t prefetch_lock;
+    pthread_cond_t prefetch_cond;
+#endif
 };
 
 typedef struct HLSContext {
+    const AVClass *class;
+    int http_persistent;
+    int prefetch_segments;
+    int prefetch_max_size;
     int n_variants;
     struct variant **variants;
     int cur_seq_no;
@@ -122,16 +161,186 @@ static void free_segment_list(struct variant *var)
     var->n_segments = 0;
 }
 
+#if HAVE_PTHREADS
+static int prefetch_interrupt(void *opaque)
+{
+    struct prefetch *p = opaque;
+    return p->abort || ff_check_interrupt(&p->var->parent->interrupt_callback);
+}
+
+static void *prefetch_thread(void *opaque)
+{
+    struct prefetch *p = opaque;
+    struct variant *var = p->var;
+    AVIOInterruptCB int_cb = { prefetch_interrupt, p };
+    AVDictionary *opts = NULL;
+    URLContext *uc;
+    int alloc = 0, ret;
+
+    av_dict_set(&opts, "seekable", "0", 0);
+    ret = ffurl_open(&uc, p->url, AVIO_FLAG_READ, &int_cb, &opts);
+    av_dict_free(&opts);
+
+    if (ret >= 0) {
+        for (;;) {
+            if (alloc - p->size < PREFETCH_READ_SIZE) {
+                uint8_t *data;
+                if (alloc >= p->max_size) {
+                    /* too large for the memory budget, read it directly */
+                    ret = AVERROR(ENOSPC);
+                    break;
+                }
+                alloc = FFMIN(FFMAX(2 * alloc, 4 * PREFETCH_READ_SIZE), p->max_size);
+                if (!(data = av_realloc(p->data, alloc))) {
+                    ret = AVERROR(ENOMEM);
+                    break;
+                }
+                p->data = data;
+            }
+            ret = ffurl_read(uc, p->data + p->size, alloc - p->size);
+            if (ret <= 0)
+                break;
+            p->size += ret;
+        }
+        ffurl_close(uc);
+    }
+
+    pthread_mutex_lock(&var->prefetch_lock);
+    p->done  = 1;
+    p->error = ret == AVERROR_EOF ? 0 : FFMIN(ret, 0);
+    pthread_cond_signal(&var->prefetch_cond);
+    pthread_mutex_unlock(&var->prefetch_lock);
+
+    return NULL;
+}
+
+static void release_prefetch(struct prefetch *p)
+{
+    if (!p->active)
+        return;
+    p->abort = 1;
+    pthread_join(p->thread, NULL);
+    av_freep(&p->data);
+    p->active = 0;
+    if (p->var->cur_prefetch == p)
+        p->var->cur_prefetch = NULL;
+}
+
+static void cancel_prefetch(HLSContext *c, struct variant *var)
+{
+    int i;
+    if (!var->prefetch)
+        return;
+    for (i = 0; i < c->prefetch_segments; i++)
+        release_prefetch(&var->prefetch[i]);
+}
+
+/* start downloading the segments following the current one */
+static void start_prefetch(HLSContext *c, struct variant *var)
+{
+    int seq_no, i;
+
+    if (c->prefetch_segments <= 0)
+        return;
+    if (!var->prefetch &&
+        !(var->prefetch = av_mallocz(c->prefetch_segments * sizeof(*var->prefetch))))
+        return;
+
+    for (seq_no = var->cur_seq_no + 1;
+         seq_no <= var->cur_seq_no + c->prefetch_segments &&
+         seq_no < var->start_seq_no + var->n_segments; seq_no++) {
+        struct segment *seg = var->segments[seq_no - var->start_seq_no];
+        struct prefetch *p = NULL;
+
+        /* encrypted segments need the key state of the variant */
+        if (seg->key_type != KEY_NONE)
+            break;
+        for (i = 0; i < c->prefetch_segments; i++) {
+            if (var->prefetch[i].active && var->prefetch[i].seq_no == seq_no)
+                break;
+            if (!var->prefetch[i].active && !p)
+                p = &var->prefetch[i];
+        }
+        if (i < c->prefetch_segments)
+            continue;
+        if (!p)
+            break;
+
+        memset(p, 0, sizeof(*p));
+        p->var      = var;
+        p->seq_no   = seq_no;
+        p->max_size = FFMAX(c->prefetch_max_size / c->prefetch_segments,
+                            PREFETCH_READ_SIZE);
+        av_strlcpy(p->url, seg->url, sizeof(p->url));
+        if (pthread_create(&p->thread, NULL, prefetch_thread, p))
+            break;
+        p->active = 1;
+    }
+}
+
+/*
+ * Return 1 and set var->cur_prefetch if the current segment has been
+ * downloaded, 0 if it has to be read directly.
+ */
+static int get_prefetched(HLSContext *c, struct variant *var)
+{
+    struct prefetch *p = NULL;
+    int i, ret = 0;
+
+    if (!var->prefetch)
+        return 0;
+    for (i = 0; i < c->prefetch_segments; i++) {
+        if (!var->prefetch[i].active)
+            continue;
+        if (var->prefetch[i].seq_no == var->cur_seq_no)
+            p = &var->prefetch[i];
+        else if (var->prefetch[i].seq_no < var->cur_seq_no)
+            release_prefetch(&var->prefetch[i]);
+    }
+    if (!p)
+        return 0;
+
+    pthread_mutex_lock(&var->prefetch_lock);
+    while (!p->done) {
+        int64_t t = av_gettime() + 100000;
+        struct timespec tv = { .tv_sec  =  t / 1000000,
+                               .tv_nsec = (t % 1000000) * 1000 };
+        if (ff_check_interrupt(c->interrupt_callback)) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+        pthread_cond_timedwait(&var->prefetch_cond, &var->prefetch_lock, &tv);
+    }
+    if (p->done && !p->error) {
+        var->cur_prefetch = p;
+        ret = 1;
+    }
+    pthread_mutex_unlock(&var->prefetch_lock);
+
+    if (ret <= 0)
+        release_prefetch(p);
+    return ret;
+}
+#endif
+
 static void free_variant_list(HLSContext *c)
 {
     int i;
     for (i = 0; i < c->n_variants; i++) {
         struct variant *var = c->variants[i];
+#if HAVE_PTHREADS
+        cancel_prefetch(c, var);
+        av_freep(&var->prefetch);
+        pthread_mutex_destroy(&var->prefetch_lock);
+        pthread_cond_destroy(&var->prefetch_cond);
+#endif
         free_segment_list(var);
         av_free_packet(&var->pkt);
         av_free(var->pb.buffer);
         if (var->input)
             ffurl_close(var->input);
+        if (var->http_input)
+            ffurl_close(var->http_input);
         if (var->ctx) {
             var->ctx->pb = NULL;
             avformat_close_input(&var->ctx);
@@ -159,6 +368,10 @@ static struct variant *new_variant(HLSContext *c, int bandwidth,
     if (!var)
         return NULL;
     reset_packet(&var->pkt);
+#if HAVE_PTHREADS
+    pthread_mutex_init(&var->prefetch_lock, NULL);
+    pthread_cond_init(&var->prefetch_cond, NULL);
+#endif
     var->bandwidth = bandwidth;
     ff_make_absolute_url(var->url, sizeof(var->url), base, url);
     dynarray_add(&c->variants, &c->n_variants, var);
@@ -328,13 +541,29 @@ fail:
     return ret;
 }
 
-static int open_input(struct variant *var)
+static int open_input(HLSContext *c, struct variant *var)
 {
     AVDictionary *opts = NULL;
     int ret;
     struct segment *seg = var->segments[var->cur_seq_no - var->start_seq_no];
     av_dict_set(&opts, "seekable", "0", 0);
     if (seg->key_type == KEY_NONE) {
+#if CONFIG_HTTP_PROTOCOL
+        if (var->http_input) {
+            /* send the request on the connection of the previous segment */
+            if (ff_http_can_reuse_connection(var->http_input, seg->url) &&
+                ff_http_do_new_request(var->http_input, seg->url) >= 0) {
+                var->input      = var->http_input;
+                var->http_input = NULL;
+                ret = 0;
+                goto cleanup;
+            }
+            ffurl_close(var->http_input);
+            var->http_input = NULL;
+        }
+        if (c->http_persistent)
+            av_dict_set(&opts, "multiple_requests", "1", 0);
+#endif
         ret = ffurl_open(&var->input, seg->url, AVIO_FLAG_READ,
                           &var->parent->interrupt_callback, &opts);
         goto cleanup;
@@ -393,6 +622,19 @@ static int read_data(void *opaque, uint8_t *buf, int buf_size)
     int ret, i;
 
 restart:
+#if HAVE_PTHREADS
+    if (v->cur_prefetch) {
+        struct prefetch *p = v->cur_prefetch;
+        ret = FFMIN(buf_size, p->size - p->read_pos);
+        if (ret > 0) {
+            memcpy(buf, p->data + p->read_pos, ret);
+            p->read_pos += ret;
+            return ret;
+        }
+        release_prefetch(p);
+        goto segment_end;
+    }
+#endif
     if (!v->input) {
         /* If this is a live stream and the reload interval has elapsed since
          * the last playlist reload, reload the variant playlists now. */
@@ -429,15 +671,31 @@ reload:
             goto reload;
         }
 
-        ret = open_input(v);
+#if HAVE_PTHREADS
+        ret = get_prefetched(c, v);
+        if (ret < 0)
+            return ret;
+        start_prefetch(c, v);
+        if (ret)
+            goto restart;
+#endif
+        ret = open_input(c, v);
         if (ret < 0)
             return ret;
     }
     ret = ffurl_read(v->input, buf, buf_size);
     if (ret > 0)
         return ret;
-    ffurl_close(v->input);
+    if (c->http_persistent && !ret &&
+        (!strcmp(v->input->prot->name, "http") ||
+         !strcmp(v->input->prot->name, "https")))
+        v->http_input = v->input;
+    else
+        ffurl_close(v->input);
     v->input = NULL;
+#if HAVE_PTHREADS
+segment_end:
+#endif
     v->cur_seq_no++;
 
     c->end_of_segment = 1;
@@ -454,6 +712,9 @@ reload:
     if (!v->needed) {
         av_log(v->parent, AV_LOG_INFO, "No longer receiving variant %d\n",
                v->index);
+#if HAVE_PTHREADS
+        cancel_prefetch(c, v);
+#endif
         return AVERROR_EOF;
     }
     goto restart;
@@ -611,6 +872,9 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             if (v->input)
                 ffurl_close(v->input);
             v->input = NULL;
+#if HAVE_PTHREADS
+            cancel_prefetch(c, v);
+#endif
             v->needed = 0;
             changed = 1;
             av_log(s, AV_LOG_INFO, "No longer receiving variant %d\n", i);
@@ -747,6 +1011,9 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
             ffurl_close(var->input);
             var->input = NULL;
         }
+#if HAVE_PTHREADS
+        cancel_prefetch(c, var);
+#endif
         av_free_packet(&var->pkt);
         reset_packet(&var->pkt);
         var->pb.eof_reached = 0;
@@ -784,10 +1051,32 @@ static int hls_probe(AVProbeData *p)
     return 0;
 }
 
+#define OFFSET(x) offsetof(HLSContext, x)
+#define FLAGS AV_OPT_FLAG_DECODING_PARAM
+static const AVOption hls_options[] = {
+    { "http_persistent", "use persistent HTTP connections for the segments",
+      OFFSET(http_persistent), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, 1, FLAGS },
+#if HAVE_PTHREADS
+    { "prefetch_segments", "number of following segments downloaded in parallel",
+      OFFSET(prefetch_segments), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 64, FLAGS },
+    { "prefetch_max_size", "memory budget in bytes for the downloaded segments of a variant",
+      OFFSET(prefetch_max_size), AV_OPT_TYPE_INT, { .i64 = 64 << 20 }, 0, INT_MAX, FLAGS },
+#endif
+    { NULL }
+};
+
+static const AVClass hls_class = {
+    .class_name = "hls demuxer",
+    .item_name  = av_default_item_name,
+    .option     = hls_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 AVInputFormat ff_hls_demuxer = {
     .name           = "hls,applehttp",
     .long_name      = NULL_IF_CONFIG_SMALL("Apple HTTP Live Streaming"),
     .priv_data_size = sizeof(HLSContext),
+    .priv_class     = &hls_class,
     .read_probe     = hls_probe,
     .read_header    = hls_read_header,
     .read_packet    = hls_read_packet,
@@ -44,6 +44,7 @@ typedef struct HLSContext {
     float time;            // Set by a private option.
     int  size;             // Set by a private option.
     int  wrap;             // Set by a private option.
+    int  flush_packets;    // Set by a private option.
     int64_t recording_time;
     int has_video;
     int64_t start_pts;
@@ -281,6 +282,11 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
 
     ret = ff_write_chained(oc, pkt->stream_index, pkt, s);
 
+    /* Push the data out immediately, so that e.g. a chunked HTTP POST
+     * delivers the segment progressively instead of in buffer sized bursts. */
+    if (hls->flush_packets && ret >= 0)
+        avio_flush(oc->pb);
+
     return ret;
 }
 
@@ -307,6 +313,7 @@ static const AVOption options[] = {
     { "hls_time",     "set segment length in seconds",           OFFSET(time),    AV_OPT_TYPE_FLOAT,  {.dbl = 2},     0, FLT_MAX, E},
     { "hls_list_size","set maximum number of playlist entries",  OFFSET(size),    AV_OPT_TYPE_INT,    {.i64 = 5},     0, INT_MAX, E},
     { "hls_wrap",     "set number after which the index wraps",  OFFSET(wrap),    AV_OPT_TYPE_INT,    {.i64 = 0},     0, INT_MAX, E},
+    { "hls_flush_packets", "flush the segment output after each packet", OFFSET(flush_packets), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E},
     { NULL },
 };
 
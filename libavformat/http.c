@@ -211,6 +211,26 @@ static int http_open_cnx(URLContext *h)
     return AVERROR(EIO);
 }
 
+int ff_http_can_reuse_connection(URLContext *h, const char *uri)
+{
+    HTTPContext *s = h->priv_data;
+    char proto1[10], hostname1[1024], proto2[10], hostname2[1024];
+    int port1, port2;
+
+    /* the previous reply must have been read completely, and the server
+     * must not have asked to close the connection */
+    if (!s->hd || !s->multiple_requests || s->willclose ||
+        s->filesize < 0 || s->off < s->filesize || s->buf_ptr < s->buf_end)
+        return 0;
+
+    av_url_split(proto1, sizeof(proto1), NULL, 0, hostname1, sizeof(hostname1),
+                 &port1, NULL, 0, s->location);
+    av_url_split(proto2, sizeof(proto2), NULL, 0, hostname2, sizeof(hostname2),
+                 &port2, NULL, 0, uri);
+    return !strcmp(proto1, proto2) && !av_strcasecmp(hostname1, hostname2) &&
+           port1 == port2;
+}
+
 int ff_http_do_new_request(URLContext *h, const char *uri)
 {
     HTTPContext *s = h->priv_data;
@@ -35,6 +35,15 @@
  */
 void ff_http_init_auth_state(URLContext *dest, const URLContext *src);
 
+/**
+ * Check if the connection of h can be used for a new request to uri,
+ * i.e. if it is a persistent connection to the same server and the
+ * previous reply has been read completely.
+ *
+ * @return non zero if ff_http_do_new_request() can reuse the connection
+ */
+int ff_http_can_reuse_connection(URLContext *h, const char *uri);
+
 /**
  * Send a new HTTP request, reusing the old connection.
  *
@@ -22,6 +22,7 @@
 #define AVFORMAT_INTERNAL_H
 
 #include <stdint.h>
+#include "libavutil/buffer.h"
 #include "avformat.h"
 
 #define MAX_URL_SIZE 4096
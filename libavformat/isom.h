@@ -143,6 +143,10 @@ typedef struct MOVStreamContext {
     int start_pad;        ///< amount of samples to skip due to enc-dec delay
     unsigned int rap_group_count;
     MOVSbgp *rap_group;
+    int index_pending;    ///< the index is not built from the sample tables yet
+    int64_t next_dts;     ///< dts of the current sample in AV_TIME_BASE units
+    int next_dts_sample;  ///< current_sample next_dts was computed for
+    int next_dts_entries; ///< nb_index_entries when next_dts was computed
 } MOVStreamContext;
 
 typedef struct MOVContext {
@@ -163,6 +167,8 @@ typedef struct MOVContext {
     int use_absolute_path;
     int ignore_editlist;
     int64_t next_root_atom; ///< offset of the next root atom
+    int lazy_index;       ///< build the index of a track only when it is needed
+    int64_t last_dts;     ///< dts of the last sample read, in AV_TIME_BASE
 } MOVContext;
 
 int ff_mp4_read_descr_len(AVIOContext *pb);
@@ -38,6 +38,7 @@
 #include "rmsipr.h"
 #include "matroska.h"
 #include "libavcodec/bytestream.h"
+#include "libavcodec/internal.h"
 #include "libavcodec/mpeg4audio.h"
 #include "libavutil/intfloat.h"
 #include "libavutil/intreadwrite.h"
@@ -51,6 +52,9 @@
 #include <bzlib.h>
 #endif
 
+/* the lace count of a block is stored in a single byte */
+#define MAX_LACES 256
+
 typedef enum {
     EBML_NONE,
     EBML_UINT,
@@ -255,6 +259,7 @@ typedef struct {
     /* the packet queue */
     AVPacket **packets;
     int num_packets;
+    unsigned int packets_allocated;
     AVPacket *prev_pkt;
 
     int done;
@@ -272,6 +277,9 @@ typedef struct {
 
     /* File has SSA subtitles which prevent incremental cluster parsing. */
     int contains_ssa;
+
+    /* Clusters are only parsed to find a seek point, no packet is output. */
+    int seek_scan;
 } MatroskaDemuxContext;
 
 typedef struct {
@@ -1857,56 +1865,60 @@ static int matroska_deliver_packet(MatroskaDemuxContext *matroska,
     if (matroska->num_packets > 0) {
         memcpy(pkt, matroska->packets[0], sizeof(AVPacket));
         av_free(matroska->packets[0]);
-        if (matroska->num_packets > 1) {
-            void *newpackets;
-            memmove(&matroska->packets[0], &matroska->packets[1],
-                    (matroska->num_packets - 1) * sizeof(AVPacket *));
-            newpackets = av_realloc(matroska->packets,
-                            (matroska->num_packets - 1) * sizeof(AVPacket *));
-            if (newpackets)
-                matroska->packets = newpackets;
-        } else {
-            av_freep(&matroska->packets);
-            matroska->prev_pkt = NULL;
-        }
         matroska->num_packets--;
+        /* the queue array is kept allocated, it is reused for the next block */
+        memmove(&matroska->packets[0], &matroska->packets[1],
+                matroska->num_packets * sizeof(AVPacket *));
+        if (!matroska->num_packets)
+            matroska->prev_pkt = NULL;
         return 0;
     }
 
     return -1;
 }
 
+/*
+ * Append a packet to our internal queue.
+ */
+static int matroska_queue_packet(MatroskaDemuxContext *matroska, AVPacket *pkt)
+{
+    AVPacket **packets = av_fast_realloc(matroska->packets,
+                                         &matroska->packets_allocated,
+                                         (matroska->num_packets + 1) * sizeof(*packets));
+    if (!packets)
+        return AVERROR(ENOMEM);
+    matroska->packets = packets;
+    matroska->packets[matroska->num_packets++] = pkt;
+    return 0;
+}
+
 /*
  * Free all packets in our internal queue.
  */
 static void matroska_clear_queue(MatroskaDemuxContext *matroska)
 {
-    if (matroska->packets) {
-        int n;
-        for (n = 0; n < matroska->num_packets; n++) {
-            av_free_packet(matroska->packets[n]);
-            av_free(matroska->packets[n]);
-        }
-        av_freep(&matroska->packets);
-        matroska->num_packets = 0;
+    int n;
+    for (n = 0; n < matroska->num_packets; n++) {
+        av_free_packet(matroska->packets[n]);
+        av_free(matroska->packets[n]);
     }
+    matroska->num_packets = 0;
 }
 
+/*
+ * Split a block into its laces. lace_size must have room for
+ * MAX_LACES entries.
+ */
 static int matroska_parse_laces(MatroskaDemuxContext *matroska, uint8_t **buf,
                                 int size, int type,
-                                uint32_t **lace_buf, int *laces)
+                                uint32_t *lace_size, int *laces)
 {
     int res = 0, n;
     uint8_t *data = *buf;
-    uint32_t *lace_size;
 
     if (!type) {
         *laces = 1;
-        *lace_buf = av_mallocz(sizeof(int));
-        if (!*lace_buf)
-            return AVERROR(ENOMEM);
-
-        *lace_buf[0] = size;
+        lace_size[0] = size;
         return 0;
     }
 
@@ -1914,9 +1926,7 @@ static int matroska_parse_laces(MatroskaDemuxContext *matroska, uint8_t **buf,
     *laces = *data + 1;
     data += 1;
     size -= 1;
-    lace_size = av_mallocz(*laces * sizeof(int));
-    if (!lace_size)
-        return AVERROR(ENOMEM);
+    memset(lace_size, 0, *laces * sizeof(*lace_size));
 
     switch (type) {
     case 0x1: /* Xiph lacing */ {
@@ -1993,7 +2003,6 @@ static int matroska_parse_laces(MatroskaDemuxContext *matroska, uint8_t **buf,
     }
 
     *buf      = data;
-    *lace_buf = lace_size;
 
     return res;
 }
@@ -2062,7 +2071,11 @@ static int matroska_parse_rm_audio(MatroskaDemuxContext *matroska,
         track->audio.buf_timecode = AV_NOPTS_VALUE;
         pkt->pos = pos;
         pkt->stream_index = st->index;
-        dynarray_add(&matroska->packets,&matroska->num_packets,pkt);
+        if (matroska_queue_packet(matroska, pkt) < 0) {
+            av_free_packet(pkt);
+            av_free(pkt);
+            return AVERROR(ENOMEM);
+        }
     }
 
     return 0;
@@ -2070,7 +2083,7 @@ static int matroska_parse_rm_audio(MatroskaDemuxContext *matroska,
 static int matroska_parse_frame(MatroskaDemuxContext *matroska,
                                 MatroskaTrack *track,
                                 AVStream *st,
-                                uint8_t *data, int pkt_size,
+                                AVBufferRef *buf, uint8_t *data, int pkt_size,
                                 uint64_t timecode, uint64_t lace_duration,
                                 int64_t pos, int is_keyframe)
 {
@@ -2089,22 +2102,31 @@ static int matroska_parse_frame(MatroskaDemuxContext *matroska,
         offset = 8;
 
     pkt = av_mallocz(sizeof(AVPacket));
-    /* XXX: prevent data copy... */
-    if (av_new_packet(pkt, pkt_size + offset) < 0) {
-        av_free(pkt);
+    if (!pkt)
         return AVERROR(ENOMEM);
-    }
+    if (buf && pkt_data == data && !offset) {
+        /* reference the block data, the buffer is padded after it */
+        if (avpriv_packet_from_buffer(pkt, buf, data, pkt_size) < 0) {
+            av_free(pkt);
+            return AVERROR(ENOMEM);
+        }
+    } else {
+        if (av_new_packet(pkt, pkt_size + offset) < 0) {
+            av_free(pkt);
+            return AVERROR(ENOMEM);
+        }
 
-    if (st->codec->codec_id == AV_CODEC_ID_PRORES) {
-        uint8_t *buf = pkt->data;
-        bytestream_put_be32(&buf, pkt_size);
-        bytestream_put_be32(&buf, MKBETAG('i', 'c', 'p', 'f'));
-    }
+        if (st->codec->codec_id == AV_CODEC_ID_PRORES) {
+            uint8_t *p = pkt->data;
+            bytestream_put_be32(&p, pkt_size);
+            bytestream_put_be32(&p, MKBETAG('i', 'c', 'p', 'f'));
+        }
 
-    memcpy(pkt->data + offset, pkt_data, pkt_size);
+        memcpy(pkt->data + offset, pkt_data, pkt_size);
 
-    if (pkt_data != data)
-        av_free(pkt_data);
+        if (pkt_data != data)
+            av_free(pkt_data);
+    }
 
     pkt->flags = is_keyframe;
     pkt->stream_index = st->index;
@@ -2148,14 +2170,23 @@ static int matroska_parse_frame(MatroskaDemuxContext *matroska,
         st->codec->codec_id == AV_CODEC_ID_SSA)
         matroska_merge_packets(matroska->prev_pkt, pkt);
     else {
-        dynarray_add(&matroska->packets,&matroska->num_packets,pkt);
+        if (matroska_queue_packet(matroska, pkt) < 0) {
+            av_free_packet(pkt);
+            av_free(pkt);
+            return AVERROR(ENOMEM);
+        }
         matroska->prev_pkt = pkt;
     }
 
     return 0;
 }
 
-static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
+/**
+ * @param buf if not NULL, the buffer holding data, padded after the end
+ *            of the block, which packets may reference instead of copying
+ */
+static int matroska_parse_block(MatroskaDemuxContext *matroska,
+                                AVBufferRef *buf, uint8_t *data,
                                 int size, int64_t pos, uint64_t cluster_time,
                                 uint64_t block_duration, int is_keyframe,
                                 int64_t cluster_pos)
@@ -2165,7 +2196,7 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
     int res = 0;
     AVStream *st;
     int16_t block_time;
-    uint32_t *lace_size = NULL;
+    uint32_t lace_size[MAX_LACES];
     int n, flags, laces = 0;
     uint64_t num;
 
@@ -2201,10 +2232,21 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
         if (track->type == MATROSKA_TRACK_TYPE_SUBTITLE
             && timecode < track->end_timecode)
             is_keyframe = 0;  /* overlapping subtitles are not key frame */
-        if (is_keyframe)
-            av_add_index_entry(st, cluster_pos, timecode, 0,0,AVINDEX_KEYFRAME);
+        if (is_keyframe) {
+            AVIndexEntry *last = st->nb_index_entries ?
+                                 &st->index_entries[st->nb_index_entries - 1] : NULL;
+            /* one entry per cluster is enough to seek, seeking reads the
+               cluster from its start anyway */
+            if (!last || last->pos != cluster_pos || last->timestamp > timecode) {
+                ff_reduce_index(matroska->ctx, st->index);
+                av_add_index_entry(st, cluster_pos, timecode, 0,0,AVINDEX_KEYFRAME);
+            }
+        }
     }
 
+    if (matroska->seek_scan)
+        return 0;
+
     if (matroska->skip_to_keyframe && track->type != MATROSKA_TRACK_TYPE_SUBTITLE) {
         if (timecode < matroska->skip_to_timecode)
             return res;
@@ -2217,7 +2259,7 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
     }
 
     res = matroska_parse_laces(matroska, &data, size, (flags & 0x06) >> 1,
-                               &lace_size, &laces);
+                               lace_size, &laces);
 
     if (res)
         goto end;
@@ -2249,7 +2291,10 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
                 goto end;
 
         } else {
-            res = matroska_parse_frame(matroska, track, st, data, lace_size[n],
+            /* only the last lace is followed by the zeroed padding */
+            res = matroska_parse_frame(matroska, track, st,
+                                      n == laces - 1 ? buf : NULL,
+                                      data, lace_size[n],
                                       timecode, lace_duration,
                                       pos, !n? is_keyframe : 0);
             if (res)
@@ -2263,7 +2308,6 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
     }
 
 end:
-    av_free(lace_size);
     return res;
 }
 
@@ -2307,15 +2351,27 @@ static int matroska_parse_cluster_incremental(MatroskaDemuxContext *matroska)
         i = blocks_list->nb_elem - 1;
         if (blocks[i].bin.size > 0 && blocks[i].bin.data) {
             int is_keyframe = blocks[i].non_simple ? !blocks[i].reference : -1;
+            uint8_t *data = blocks[i].bin.data;
+            AVBufferRef *buf = av_buffer_create(data, blocks[i].bin.size +
+                                                FF_INPUT_BUFFER_PADDING_SIZE,
+                                                av_buffer_default_free, NULL, 0);
+            /* the packets take over the block data */
+            if (buf)
+                blocks[i].bin.data = NULL;
             if (!blocks[i].non_simple)
                 blocks[i].duration = 0;
-            res = matroska_parse_block(matroska,
-                                       blocks[i].bin.data, blocks[i].bin.size,
+            res = matroska_parse_block(matroska, buf,
+                                       data, blocks[i].bin.size,
                                        blocks[i].bin.pos,
                                        matroska->current_cluster.timecode,
                                        blocks[i].duration, is_keyframe,
                                        matroska->current_cluster_pos);
+            av_buffer_unref(&buf);
         }
+        /* the block is not needed anymore, do not let the list grow */
+        ebml_free(matroska_blockgroup, &blocks[i]);
+        blocks_list->nb_elem = 0;
+        matroska->current_cluster_num_blocks = 0;
     }
 
     if (res < 0)  matroska->done = 1;
@@ -2341,7 +2397,7 @@ static int matroska_parse_cluster(MatroskaDemuxContext *matroska)
     for (i=0; i<blocks_list->nb_elem; i++)
         if (blocks[i].bin.size > 0 && blocks[i].bin.data) {
             int is_keyframe = blocks[i].non_simple ? !blocks[i].reference : -1;
-            res=matroska_parse_block(matroska,
+            res=matroska_parse_block(matroska, NULL,
                                      blocks[i].bin.data, blocks[i].bin.size,
                                      blocks[i].bin.pos,  cluster.timecode,
                                      blocks[i].duration, is_keyframe,
@@ -2387,12 +2443,14 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     if ((index = av_index_search_timestamp(st, timestamp, flags)) < 0) {
         avio_seek(s->pb, st->index_entries[st->nb_index_entries-1].pos, SEEK_SET);
         matroska->current_id = 0;
+        matroska->seek_scan = 1;
         while ((index = av_index_search_timestamp(st, timestamp, flags)) < 0) {
             matroska->prev_pkt = NULL;
             matroska_clear_queue(matroska);
             if (matroska_parse_cluster(matroska) < 0)
                 break;
         }
+        matroska->seek_scan = 0;
     }
 
     matroska_clear_queue(matroska);
@@ -2443,6 +2501,7 @@ static int matroska_read_close(AVFormatContext *s)
     int n;
 
     matroska_clear_queue(matroska);
+    av_freep(&matroska->packets);
 
     for (n=0; n < matroska->tracks.nb_elem; n++)
         if (tracks[n].type == MATROSKA_TRACK_TYPE_AUDIO)
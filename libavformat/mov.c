@@ -781,11 +781,37 @@ static int mov_read_ftyp(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 }
 
 /* this atom should contain all header atoms */
+/* largest 'moov' atom that is read into memory before parsing it */
+#define MAX_MOOV_BUFFER_SIZE (64 << 20)
+
 static int mov_read_moov(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 {
     int ret;
 
-    if ((ret = mov_read_default(c, pb, atom)) < 0)
+    if (atom.size > 0 && atom.size <= MAX_MOOV_BUFFER_SIZE) {
+        /* fetch the whole atom with a single read and parse it from memory,
+         * the many small reads of the child atoms are slow on network
+         * protocols */
+        AVIOContext ctx;
+        int64_t pos = avio_tell(pb);
+        uint8_t *moov_data = av_malloc(atom.size);
+        int moov_len;
+
+        if (!moov_data)
+            return AVERROR(ENOMEM);
+        moov_len = avio_read(pb, moov_data, atom.size);
+        if (moov_len < 0) {
+            av_free(moov_data);
+            return moov_len;
+        }
+        ffio_init_context(&ctx, moov_data, moov_len, 0, NULL, NULL, NULL, NULL);
+        /* make avio_tell() on ctx return offsets in the file */
+        ctx.pos = pos + moov_len;
+        ret = mov_read_default(c, &ctx, atom);
+        av_free(moov_data);
+        if (ret < 0)
+            return ret;
+    } else if ((ret = mov_read_default(c, pb, atom)) < 0)
         return ret;
     /* we parsed the 'moov' atom, we can terminate the parsing as soon as we find the 'mdat' */
     /* so we don't parse the whole file if over a network */
@@ -1923,25 +1949,15 @@ static int mov_read_sbgp(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     return pb->eof_reached ? AVERROR_EOF : 0;
 }
 
-static void mov_build_index(MOVContext *mov, AVStream *st)
+static void mov_fix_index_start(MOVContext *mov, AVStream *st)
 {
     MOVStreamContext *sc = st->priv_data;
-    int64_t current_offset;
-    int64_t current_dts = 0;
-    unsigned int stts_index = 0;
-    unsigned int stsc_index = 0;
-    unsigned int stss_index = 0;
-    unsigned int stps_index = 0;
-    unsigned int i, j;
-    uint64_t stream_size = 0;
-    AVIndexEntry *mem;
 
     /* adjust first dts according to edit list */
     if ((sc->empty_duration || sc->start_time) && mov->time_scale > 0) {
         if (sc->empty_duration)
             sc->empty_duration = av_rescale(sc->empty_duration, sc->time_scale, mov->time_scale);
         sc->time_offset = sc->start_time - sc->empty_duration;
-        current_dts = -sc->time_offset;
         if (sc->ctts_count>0 && sc->stts_count>0 &&
             sc->ctts_data[0].duration / FFMAX(sc->stts_data[0].duration, 1) > 16) {
             /* more than 16 frames delay, dts are likely wrong
@@ -1950,10 +1966,31 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
             st->codec->has_b_frames = 1;
         }
     }
+}
+
+/* only use old uncompressed audio chunk demuxing when stts specifies it */
+static int mov_use_chunk_index(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    return st->codec->codec_type == AVMEDIA_TYPE_AUDIO &&
+           sc->stts_count == 1 && sc->stts_data[0].duration == 1;
+}
+
+static void mov_build_index(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int64_t current_offset;
+    int64_t current_dts = -sc->time_offset;
+    unsigned int stts_index = 0;
+    unsigned int stsc_index = 0;
+    unsigned int stss_index = 0;
+    unsigned int stps_index = 0;
+    unsigned int i, j;
+    uint64_t stream_size = 0;
+    AVIndexEntry *mem;
 
-    /* only use old uncompressed audio chunk demuxing when stts specifies it */
-    if (!(st->codec->codec_type == AVMEDIA_TYPE_AUDIO &&
-          sc->stts_count == 1 && sc->stts_data[0].duration == 1)) {
+    if (!mov_use_chunk_index(st)) {
         unsigned int current_sample = 0;
         unsigned int stts_sample = 0;
         unsigned int sample_size;
@@ -2121,6 +2158,51 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     }
 }
 
+static void mov_free_sample_tables(MOVStreamContext *sc)
+{
+    av_freep(&sc->chunk_offsets);
+    av_freep(&sc->stsc_data);
+    av_freep(&sc->sample_sizes);
+    av_freep(&sc->keyframes);
+    av_freep(&sc->stts_data);
+    av_freep(&sc->stps_data);
+    av_freep(&sc->rap_group);
+}
+
+/**
+ * Build the index of a track whose index was deferred by the lazy_index
+ * option. If samples of other tracks were already returned, the track is
+ * positioned at the last returned dts.
+ */
+static void mov_build_pending_index(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    if (!sc->index_pending)
+        return;
+    sc->index_pending = 0;
+    mov_build_index(mov, st);
+    mov_free_sample_tables(sc);
+
+    if (mov->last_dts != AV_NOPTS_VALUE) {
+        int64_t timestamp = av_rescale(mov->last_dts, sc->time_scale, AV_TIME_BASE);
+        int sample = av_index_search_timestamp(st, timestamp, AVSEEK_FLAG_ANY);
+        if (sample >= 0) {
+            int i, time_sample = 0;
+            sc->current_sample = sample;
+            for (i = 0; i < sc->ctts_count; i++) {
+                int next = time_sample + sc->ctts_data[i].count;
+                if (next > sample) {
+                    sc->ctts_index  = i;
+                    sc->ctts_sample = sample - time_sample;
+                    break;
+                }
+                time_sample = next;
+            }
+        }
+    }
+}
+
 static int mov_open_dref(AVIOContext **pb, const char *src, MOVDref *ref,
                          AVIOInterruptCB *int_cb, int use_absolute_path, AVFormatContext *fc)
 {
@@ -2211,7 +2293,22 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
 
     avpriv_set_pts_info(st, 64, 1, sc->time_scale);
 
-    mov_build_index(c, st);
+    mov_fix_index_start(c, st);
+    if (c->lazy_index && sc->sample_count) {
+        sc->index_pending = 1;
+        /* the bitrate is otherwise computed while building the index */
+        if (!mov_use_chunk_index(st) && st->duration > 0) {
+            uint64_t stream_size = 0;
+            unsigned int i;
+            if (sc->alt_sample_size > 0)
+                stream_size = (uint64_t)sc->alt_sample_size * sc->sample_count;
+            else if (sc->sample_sizes)
+                for (i = 0; i < sc->sample_count; i++)
+                    stream_size += sc->sample_sizes[i];
+            st->codec->bit_rate = stream_size*8*sc->time_scale/st->duration;
+        }
+    } else
+        mov_build_index(c, st);
 
     if (sc->dref_id-1 < sc->drefs_count && sc->drefs[sc->dref_id-1].path) {
         MOVDref *dref = &sc->drefs[sc->dref_id - 1];
@@ -2259,13 +2356,8 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     }
 
     /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
-    av_freep(&sc->stsc_data);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
-    av_freep(&sc->stts_data);
-    av_freep(&sc->stps_data);
-    av_freep(&sc->rap_group);
+    if (!sc->index_pending)
+        mov_free_sample_tables(sc);
 
     return 0;
 }
@@ -2483,6 +2575,7 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id)
         return 0;
+    mov_build_pending_index(c, st);
     avio_r8(pb); /* version */
     flags = avio_rb24(pb);
     entries = avio_rb32(pb);
@@ -2962,6 +3055,7 @@ static void mov_read_chapters(AVFormatContext *s)
 
     st->discard = AVDISCARD_ALL;
     sc = st->priv_data;
+    mov_build_pending_index(mov, st);
     cur_pos = avio_tell(sc->pb);
 
     for (i = 0; i < st->nb_index_entries; i++) {
@@ -3033,6 +3127,7 @@ static int mov_read_timecode_track(AVFormatContext *s, AVStream *st)
     int64_t cur_pos = avio_tell(sc->pb);
     uint32_t value;
 
+    mov_build_pending_index(s->priv_data, st);
     if (!st->nb_index_entries)
         return -1;
 
@@ -3079,6 +3174,7 @@ static int mov_read_close(AVFormatContext *s)
         av_freep(&sc->stps_data);
         av_freep(&sc->stsc_data);
         av_freep(&sc->stts_data);
+        av_freep(&sc->rap_group);
     }
 
     if (mov->dv_demux) {
@@ -3139,6 +3235,7 @@ static int mov_read_header(AVFormatContext *s)
     MOVAtom atom = { AV_RL32("root") };
 
     mov->fc = s;
+    mov->last_dts = AV_NOPTS_VALUE;
     /* .mov and .mp4 aren't streamable anyway (only progressive download if moov is before mdat) */
     if (pb->seekable)
         atom.size = avio_size(pb);
@@ -3212,9 +3309,24 @@ static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *avst = s->streams[i];
         MOVStreamContext *msc = avst->priv_data;
+        if (msc->index_pending) {
+            /* samples of discarded streams are skipped anyway */
+            if (avst->discard == AVDISCARD_ALL)
+                continue;
+            mov_build_pending_index(s->priv_data, avst);
+        }
         if (msc->pb && msc->current_sample < avst->nb_index_entries) {
             AVIndexEntry *current_sample = &avst->index_entries[msc->current_sample];
-            int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
+            int64_t dts;
+            /* the rescaled dts only changes when the stream advances, so do
+             * not redo the division for every stream on every packet */
+            if (msc->next_dts_sample  != msc->current_sample ||
+                msc->next_dts_entries != avst->nb_index_entries) {
+                msc->next_dts         = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
+                msc->next_dts_sample  = msc->current_sample;
+                msc->next_dts_entries = avst->nb_index_entries;
+            }
+            dts = msc->next_dts;
             av_dlog(s, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!sample || (!s->pb->seekable && current_sample->pos < sample->pos) ||
                 (s->pb->seekable &&
@@ -3255,6 +3367,7 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
     sc = st->priv_data;
     /* must be done just before reading, to avoid infinite loop on sample */
     sc->current_sample++;
+    mov->last_dts = sc->next_dts;
 
     if (st->discard != AVDISCARD_ALL) {
         if (avio_seek(sc->pb, sample->pos, SEEK_SET) != sample->pos) {
@@ -3348,6 +3461,7 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
 
 static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_time, int flags)
 {
+    MOVContext *mov = s->priv_data;
     AVStream *st;
     int64_t seek_timestamp, timestamp;
     int sample;
@@ -3357,19 +3471,22 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
         return AVERROR_INVALIDDATA;
 
     st = s->streams[stream_index];
+    mov_build_pending_index(mov, st);
     sample = mov_seek_stream(s, st, sample_time, flags);
     if (sample < 0)
         return sample;
 
     /* adjust seek timestamp to found sample timestamp */
     seek_timestamp = st->index_entries[sample].timestamp;
+    mov->last_dts = av_rescale_q(seek_timestamp, st->time_base, AV_TIME_BASE_Q);
 
     for (i = 0; i < s->nb_streams; i++) {
         MOVStreamContext *sc = s->streams[i]->priv_data;
         st = s->streams[i];
         st->skip_samples = (sample_time <= 0) ? sc->start_pad : 0;
 
-        if (stream_index == i)
+        /* positioned from last_dts when the index is built */
+        if (stream_index == i || sc->index_pending)
             continue;
 
         timestamp = av_rescale_q(seek_timestamp, s->streams[stream_index]->time_base, st->time_base);
@@ -3385,6 +3502,9 @@ static const AVOption options[] = {
         0, 1, AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_DECODING_PARAM},
     {"ignore_editlist", "", offsetof(MOVContext, ignore_editlist), FF_OPT_TYPE_INT, {.i64 = 0},
         0, 1, AV_OPT_FLAG_VIDEO_PARAM|AV_OPT_FLAG_DECODING_PARAM},
+    {"lazy_index", "build the index of a track only when its samples are needed",
+        offsetof(MOVContext, lazy_index), FF_OPT_TYPE_INT, {.i64 = 0},
+        0, 1, AV_OPT_FLAG_DECODING_PARAM},
     {NULL}
 };
 
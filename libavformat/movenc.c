@@ -3065,11 +3065,14 @@ static int mov_flush_fragment(AVFormatContext *s)
         if (write_moof) {
             MOVFragmentInfo *info;
             avio_flush(s->pb);
-            track->nb_frag_info++;
-            track->frag_info = av_realloc(track->frag_info,
-                                          sizeof(*track->frag_info) *
-                                          track->nb_frag_info);
-            info = &track->frag_info[track->nb_frag_info - 1];
+            track->frag_info = av_realloc_f(track->frag_info,
+                                            sizeof(*track->frag_info),
+                                            track->nb_frag_info + 1);
+            if (!track->frag_info) {
+                track->nb_frag_info = 0;
+                return AVERROR(ENOMEM);
+            }
+            info = &track->frag_info[track->nb_frag_info++];
             info->offset   = avio_tell(s->pb);
             info->time     = mov->tracks[i].frag_start;
             info->duration = duration;
@@ -3185,10 +3188,16 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
         memcpy(trk->vos_data, pkt->data, size);
     }
 
-    if (!(trk->entry % MOV_INDEX_CLUSTER_SIZE)) {
-        trk->cluster = av_realloc_f(trk->cluster, sizeof(*trk->cluster), (trk->entry + MOV_INDEX_CLUSTER_SIZE));
-        if (!trk->cluster)
-            return -1;
+    /* In fragmented mode, entry is reset after every fragment, so the
+     * sample table never grows beyond the largest fragment. */
+    if (trk->entry >= trk->cluster_capacity) {
+        unsigned new_capacity = trk->entry + MOV_INDEX_CLUSTER_SIZE;
+        trk->cluster = av_realloc_f(trk->cluster, sizeof(*trk->cluster), new_capacity);
+        if (!trk->cluster) {
+            trk->cluster_capacity = trk->entry = 0;
+            return AVERROR(ENOMEM);
+        }
+        trk->cluster_capacity = new_capacity;
     }
 
     trk->cluster[trk->entry].pos = avio_tell(pb) - size;
@@ -3486,7 +3495,7 @@ static int mov_write_header(AVFormatContext *s)
     if (mov->flags & FF_MOV_FLAG_FASTSTART) {
         if (mov->flags & FF_MOV_FLAG_FRAGMENT)
             mov->flags &= ~FF_MOV_FLAG_FASTSTART;
-        else
+        else if (!mov->reserved_moov_size)
             mov->reserved_moov_size = -1;
     }
 
@@ -3729,23 +3738,37 @@ static int mov_write_header(AVFormatContext *s)
     return -1;
 }
 
+/**
+ * Get the number of bytes the data has to be moved by to make room for a moov
+ * of moov_size bytes, when reserved bytes are already available in front of
+ * it. If the moov does not fill the reserved space exactly, enough room is
+ * left for a free atom.
+ */
+static int get_shift_size(int moov_size, int reserved)
+{
+    if (moov_size >= reserved)
+        return moov_size - reserved;
+    return moov_size + 8 - reserved;
+}
+
 /**
  * This function gets the moov size if moved to the top of the file: the chunk
  * offset table can switch between stco (32-bit entries) to co64 (64-bit
  * entries) when the moov is moved to the top, so the size of the moov would
  * change. It also updates the chunk offset tables.
  */
-static int compute_moov_size(AVFormatContext *s)
+static int compute_moov_size(AVFormatContext *s, int reserved)
 {
-    int i, moov_size, moov_size2;
+    int i, moov_size, moov_size2, shift;
     MOVMuxContext *mov = s->priv_data;
 
     moov_size = get_moov_size(s);
     if (moov_size < 0)
         return moov_size;
 
+    shift = get_shift_size(moov_size, reserved);
     for (i = 0; i < mov->nb_streams; i++)
-        mov->tracks[i].data_offset += moov_size;
+        mov->tracks[i].data_offset += shift;
 
     moov_size2 = get_moov_size(s);
     if (moov_size2 < 0)
@@ -3755,14 +3778,18 @@ static int compute_moov_size(AVFormatContext *s)
      * update the offsets */
     if (moov_size2 != moov_size)
         for (i = 0; i < mov->nb_streams; i++)
-            mov->tracks[i].data_offset += moov_size2 - moov_size;
+            mov->tracks[i].data_offset += get_shift_size(moov_size2, reserved) - shift;
 
     return moov_size2;
 }
 
-static int shift_data(AVFormatContext *s)
+/**
+ * Move the data written after the reserved bytes at reserved_moov_pos so that
+ * the moov fits in front of it.
+ */
+static int shift_data(AVFormatContext *s, int reserved)
 {
-    int ret = 0, moov_size;
+    int ret = 0, moov_size, shift;
     MOVMuxContext *mov = s->priv_data;
     int64_t pos, pos_end = avio_tell(s->pb);
     uint8_t *buf, *read_buf[2];
@@ -3770,10 +3797,13 @@ static int shift_data(AVFormatContext *s)
     int read_size[2];
     AVIOContext *read_pb;
 
-    moov_size = compute_moov_size(s);
+    moov_size = compute_moov_size(s, reserved);
     if (moov_size < 0)
         return moov_size;
+    shift = get_shift_size(moov_size, reserved);
 
+    /* blocks must be at least as large as the shift, so that a block is
+     * always read before it gets overwritten */
     buf = av_malloc(moov_size * 2);
     if (!buf)
         return AVERROR(ENOMEM);
@@ -3794,10 +3824,10 @@ static int shift_data(AVFormatContext *s)
     /* mark the end of the shift to up to the last data we wrote, and get ready
      * for writing */
     pos_end = avio_tell(s->pb);
-    avio_seek(s->pb, mov->reserved_moov_pos + moov_size, SEEK_SET);
+    avio_seek(s->pb, mov->reserved_moov_pos + reserved + shift, SEEK_SET);
 
-    /* start reading at where the new moov will be placed */
-    avio_seek(read_pb, mov->reserved_moov_pos, SEEK_SET);
+    /* start reading at where the data currently starts */
+    avio_seek(read_pb, mov->reserved_moov_pos + reserved, SEEK_SET);
     pos = avio_tell(read_pb);
 
 #define READ_BLOCK do {                                                             \
@@ -3823,6 +3853,28 @@ end:
     return ret;
 }
 
+/**
+ * Write the moov at reserved_moov_pos, and fill the space up to end with
+ * a free atom.
+ */
+static int mov_write_reserved_moov(AVFormatContext *s, int64_t end)
+{
+    MOVMuxContext *mov = s->priv_data;
+    AVIOContext *pb = s->pb;
+    int64_t size, i;
+
+    avio_seek(pb, mov->reserved_moov_pos, SEEK_SET);
+    mov_write_moov_tag(pb, mov, s);
+    size = end - avio_tell(pb);
+    if (size > 0) {
+        avio_wb32(pb, size);
+        ffio_wfourcc(pb, "free");
+        for (i = 0; i < size - 8; i++)
+            avio_w8(pb, 0);
+    }
+    return 0;
+}
+
 static int mov_write_trailer(AVFormatContext *s)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -3860,28 +3912,38 @@ static int mov_write_trailer(AVFormatContext *s)
             ffio_wfourcc(pb, "mdat");
             avio_wb64(pb, mov->mdat_size + 16);
         }
-        avio_seek(pb, mov->reserved_moov_size > 0 ? mov->reserved_moov_pos : moov_pos, SEEK_SET);
-
-        if (mov->reserved_moov_size == -1) {
+        avio_seek(pb, moov_pos, SEEK_SET);
+
+        if (mov->reserved_moov_size > 0) {
+            int reserved  = mov->reserved_moov_size;
+            int moov_size = get_moov_size(s);
+            if (moov_size < 0)
+                return moov_size;
+            if (moov_size == reserved || moov_size + 8 <= reserved) {
+                mov_write_reserved_moov(s, mov->reserved_moov_pos + reserved);
+                avio_seek(pb, moov_pos, SEEK_SET);
+            } else if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+                av_log(s, AV_LOG_WARNING, "reserved_moov_size is too small, "
+                       "needed %d bytes, moving data with a second pass\n",
+                       moov_size + 8);
+                res = shift_data(s, reserved);
+                if (res == 0) {
+                    moov_size = get_moov_size(s);
+                    mov_write_reserved_moov(s, mov->reserved_moov_pos + reserved +
+                                            get_shift_size(moov_size, reserved));
+                }
+            } else {
+                av_log(s, AV_LOG_ERROR, "reserved_moov_size is too small, needed %d additional\n",
+                       moov_size + 8 - reserved);
+                return -1;
+            }
+        } else if (mov->reserved_moov_size == -1) {
             av_log(s, AV_LOG_INFO, "Starting second pass: moving header on top of the file\n");
-            res = shift_data(s);
+            res = shift_data(s, 0);
             if (res == 0) {
                 avio_seek(s->pb, mov->reserved_moov_pos, SEEK_SET);
                 mov_write_moov_tag(pb, mov, s);
             }
-        } else if (mov->reserved_moov_size > 0) {
-            int64_t size;
-            mov_write_moov_tag(pb, mov, s);
-            size = mov->reserved_moov_size - (avio_tell(pb) - mov->reserved_moov_pos);
-            if(size < 8){
-                av_log(s, AV_LOG_ERROR, "reserved_moov_size is too small, needed %"PRId64" additional\n", 8-size);
-                return -1;
-            }
-            avio_wb32(pb, size);
-            ffio_wfourcc(pb, "free");
-            for(i=0; i<size; i++)
-                avio_w8(pb, 0);
-            avio_seek(pb, moov_pos, SEEK_SET);
         } else {
             mov_write_moov_tag(pb, mov, s);
         }
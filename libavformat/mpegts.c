@@ -89,6 +89,7 @@ struct Program {
     unsigned int id; //program id/service id
     unsigned int nb_pids;
     unsigned int pids[MAX_PIDS_PER_PROGRAM];
+    int pmt_found;
 };
 
 struct MpegTSContext {
@@ -129,6 +130,14 @@ struct MpegTSContext {
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
     int current_pid;
+
+    /** bit set for the pids discard_pid() returns 1 for */
+    uint8_t discard_map[NB_PID_MAX / 8];
+    /** the program table changed, discard_map must be rebuilt */
+    int discard_map_dirty;
+    /** AVProgram.discard values discard_map was built with */
+    enum AVDiscard *prg_discard;
+    int nb_prg_discard;
 };
 
 static const AVOption options[] = {
@@ -205,6 +214,7 @@ static void clear_program(MpegTSContext *ts, unsigned int programid)
     for(i=0; i<ts->nb_prg; i++)
         if(ts->prg[i].id == programid)
             ts->prg[i].nb_pids = 0;
+    ts->discard_map_dirty = 1;
 }
 
 static void clear_programs(MpegTSContext *ts)
@@ -214,6 +224,7 @@ static void clear_programs(MpegTSContext *ts)
         clear_avprogram(ts, ts->prg[i].id);
     av_freep(&ts->prg);
     ts->nb_prg=0;
+    ts->discard_map_dirty = 1;
 }
 
 static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
@@ -226,9 +237,40 @@ static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
     p = &ts->prg[ts->nb_prg];
     p->id = programid;
     p->nb_pids = 0;
+    p->pmt_found = 0;
     ts->nb_prg++;
 }
 
+/**
+ * Once the PMTs of all programs have been parsed, all streams are known,
+ * so avformat_find_stream_info() can stop as soon as it has the codec
+ * parameters instead of reading up to probesize.
+ */
+static void set_pmt_found(MpegTSContext *ts, unsigned int programid)
+{
+    int i, all_found = ts->nb_prg > 0;
+
+    for (i = 0; i < ts->nb_prg; i++) {
+        if (ts->prg[i].id == programid)
+            ts->prg[i].pmt_found = 1;
+        all_found &= ts->prg[i].pmt_found;
+    }
+    if (all_found && ts->stream->ctx_flags & AVFMTCTX_NOHEADER) {
+        av_log(ts->stream, AV_LOG_DEBUG, "All programs have a PMT\n");
+        ts->stream->ctx_flags &= ~AVFMTCTX_NOHEADER;
+    }
+}
+
+static int all_pmts_found(MpegTSContext *ts)
+{
+    int i;
+
+    for (i = 0; i < ts->nb_prg; i++)
+        if (!ts->prg[i].pmt_found)
+            return 0;
+    return ts->nb_prg > 0;
+}
+
 static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid, unsigned int pid)
 {
     int i;
@@ -245,6 +287,7 @@ static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid, unsigned i
     if(p->nb_pids >= MAX_PIDS_PER_PROGRAM)
         return;
     p->pids[p->nb_pids++] = pid;
+    ts->discard_map_dirty = 1;
 }
 
 static void set_pcr_pid(AVFormatContext *s, unsigned int programid, unsigned int pid)
@@ -291,6 +334,46 @@ static int discard_pid(MpegTSContext *ts, unsigned int pid)
     return !used && discarded;
 }
 
+/**
+ * Rebuild discard_map if the program table or the discard value of any
+ * program changed since it was last built.
+ * @return 0 if discard_map is usable, a negative value otherwise
+ */
+static int update_discard_map(MpegTSContext *ts)
+{
+    AVFormatContext *s = ts->stream;
+    int i, j;
+
+    if (ts->nb_prg_discard != s->nb_programs) {
+        enum AVDiscard *tmp = av_realloc(ts->prg_discard,
+                                         s->nb_programs * sizeof(*tmp));
+        if (!tmp && s->nb_programs)
+            return AVERROR(ENOMEM);
+        ts->prg_discard       = tmp;
+        ts->nb_prg_discard    = s->nb_programs;
+        ts->discard_map_dirty = 1;
+    }
+    for (i = 0; i < s->nb_programs; i++) {
+        if (ts->prg_discard[i] != s->programs[i]->discard) {
+            ts->prg_discard[i]    = s->programs[i]->discard;
+            ts->discard_map_dirty = 1;
+        }
+    }
+    if (!ts->discard_map_dirty)
+        return 0;
+
+    memset(ts->discard_map, 0, sizeof(ts->discard_map));
+    for (i = 0; i < ts->nb_prg; i++) {
+        for (j = 0; j < ts->prg[i].nb_pids; j++) {
+            unsigned int pid = ts->prg[i].pids[j];
+            if (pid < NB_PID_MAX && discard_pid(ts, pid))
+                ts->discard_map[pid >> 3] |= 1 << (pid & 7);
+        }
+    }
+    ts->discard_map_dirty = 0;
+    return 0;
+}
+
 /**
  *  Assemble PES packets out of TS packets, and then call the "section_cb"
  *  function when they are complete.
@@ -1585,6 +1668,8 @@ static void pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
         p = desc_list_end;
     }
 
+    set_pmt_found(ts, h->id);
+
  out:
     for (i = 0; i < mp4_descr_count; i++)
         av_free(mp4_descr[i].dec_config_descr);
@@ -1760,10 +1845,16 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
     int64_t pos;
 
     pid = AV_RB16(packet + 1) & 0x1fff;
-    if(pid && discard_pid(ts, pid))
+    tss = ts->pids[pid];
+    /* nothing to do for pids without a filter */
+    if (!tss && !ts->auto_guess)
+        return 0;
+    if (ts->discard_map_dirty)
+        update_discard_map(ts);
+    if (pid && (ts->discard_map_dirty ? discard_pid(ts, pid) :
+                ts->discard_map[pid >> 3] & (1 << (pid & 7))))
         return 0;
     is_start = packet[1] & 0x40;
-    tss = ts->pids[pid];
     if (ts->auto_guess && tss == NULL && is_start) {
         add_pes_stream(ts, pid, -1);
         tss = ts->pids[pid];
@@ -1856,9 +1947,23 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
 static int mpegts_resync(AVFormatContext *s)
 {
     AVIOContext *pb = s->pb;
-    int c, i;
-
-    for(i = 0;i < MAX_RESYNC_SIZE; i++) {
+    const uint8_t *p;
+    int c, i, len;
+
+    for(i = 0;i < MAX_RESYNC_SIZE; ) {
+        /* search the buffered data first, memchr() is much faster than
+           reading byte by byte */
+        len = FFMIN(pb->buf_end - pb->buf_ptr, MAX_RESYNC_SIZE - i);
+        if (len > 0) {
+            p = memchr(pb->buf_ptr, 0x47, len);
+            if (p) {
+                pb->buf_ptr = (uint8_t *)p;
+                return 0;
+            }
+            pb->buf_ptr += len;
+            i += len;
+            continue;
+        }
         c = avio_r8(pb);
         if (url_feof(pb))
             return -1;
@@ -1866,24 +1971,28 @@ static int mpegts_resync(AVFormatContext *s)
             avio_seek(pb, -1, SEEK_CUR);
             return 0;
         }
+        i++;
     }
     av_log(s, AV_LOG_ERROR, "max resync size reached, could not find sync byte\n");
     /* no sync found */
     return -1;
 }
 
-/* return -1 if error or EOF. Return 0 if OK. */
-static int read_packet(AVFormatContext *s, uint8_t *buf, int raw_packet_size)
+/* return -1 if error or EOF. Return 0 if OK.
+   *data is set to buf or, if the packet is in the AVIOContext buffer, to
+   the packet there, which is valid until the next read from s->pb. */
+static int read_packet(AVFormatContext *s, uint8_t *buf, int raw_packet_size,
+                       const uint8_t **data)
 {
     AVIOContext *pb = s->pb;
     int skip, len;
 
     for(;;) {
-        len = avio_read(pb, buf, TS_PACKET_SIZE);
+        len = ffio_read_indirect(pb, buf, TS_PACKET_SIZE, data);
         if (len != TS_PACKET_SIZE)
             return len < 0 ? len : AVERROR_EOF;
         /* check packet sync byte */
-        if (buf[0] != 0x47) {
+        if ((*data)[0] != 0x47) {
             /* find a new packet start */
             avio_seek(pb, -TS_PACKET_SIZE, SEEK_CUR);
             if (mpegts_resync(s) < 0)
@@ -1904,6 +2013,7 @@ static int handle_packets(MpegTSContext *ts, int nb_packets)
 {
     AVFormatContext *s = ts->stream;
     uint8_t packet[TS_PACKET_SIZE + FF_INPUT_BUFFER_PADDING_SIZE];
+    const uint8_t *data;
     int packet_num, ret = 0;
 
     if (avio_tell(s->pb) != ts->last_pos) {
@@ -1936,10 +2046,10 @@ static int handle_packets(MpegTSContext *ts, int nb_packets)
         if (ts->stop_parse > 0)
             break;
 
-        ret = read_packet(s, packet, ts->raw_packet_size);
+        ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             break;
-        ret = handle_packet(ts, packet);
+        ret = handle_packet(ts, data);
         if (ret != 0)
             break;
     }
@@ -2086,13 +2196,15 @@ static int mpegts_read_header(AVFormatContext *s)
 
         av_dlog(ts->stream, "tuning done\n");
 
-        s->ctx_flags |= AVFMTCTX_NOHEADER;
+        if (!all_pmts_found(ts))
+            s->ctx_flags |= AVFMTCTX_NOHEADER;
     } else {
         AVStream *st;
         int pcr_pid, pid, nb_packets, nb_pcrs, ret, pcr_l;
         int64_t pcrs[2], pcr_h;
         int packet_count[2];
         uint8_t packet[TS_PACKET_SIZE];
+        const uint8_t *data;
 
         /* only read packets */
 
@@ -2108,12 +2220,12 @@ static int mpegts_read_header(AVFormatContext *s)
         nb_pcrs = 0;
         nb_packets = 0;
         for(;;) {
-            ret = read_packet(s, packet, ts->raw_packet_size);
+            ret = read_packet(s, packet, ts->raw_packet_size, &data);
             if (ret < 0)
                 return -1;
-            pid = AV_RB16(packet + 1) & 0x1fff;
+            pid = AV_RB16(data + 1) & 0x1fff;
             if ((pcr_pid == -1 || pcr_pid == pid) &&
-                parse_pcr(&pcr_h, &pcr_l, packet) == 0) {
+                parse_pcr(&pcr_h, &pcr_l, data) == 0) {
                 pcr_pid = pid;
                 packet_count[nb_pcrs] = nb_packets;
                 pcrs[nb_pcrs] = pcr_h * 300 + pcr_l;
@@ -2151,15 +2263,18 @@ static int mpegts_raw_read_packet(AVFormatContext *s,
     int64_t pcr_h, next_pcr_h, pos;
     int pcr_l, next_pcr_l;
     uint8_t pcr_buf[12];
+    const uint8_t *data;
 
     if (av_new_packet(pkt, TS_PACKET_SIZE) < 0)
         return AVERROR(ENOMEM);
     pkt->pos= avio_tell(s->pb);
-    ret = read_packet(s, pkt->data, ts->raw_packet_size);
+    ret = read_packet(s, pkt->data, ts->raw_packet_size, &data);
     if (ret < 0) {
         av_free_packet(pkt);
         return ret;
     }
+    if (data != pkt->data)
+        memcpy(pkt->data, data, TS_PACKET_SIZE);
     if (ts->mpeg2ts_compute_pcr) {
         /* compute exact PCR for each packet */
         if (parse_pcr(&pcr_h, &pcr_l, pkt->data) == 0) {
@@ -2226,6 +2341,7 @@ static int mpegts_read_close(AVFormatContext *s)
 
     for(i=0;i<NB_PID_MAX;i++)
         if (ts->pids[i]) mpegts_close_filter(ts, ts->pids[i]);
+    av_freep(&ts->prg_discard);
 
     return 0;
 }
@@ -2330,8 +2446,10 @@ int ff_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
         if (len < TS_PACKET_SIZE)
             return -1;
         if (buf[0] != 0x47) {
-            buf++;
-            len--;
+            const uint8_t *p = memchr(buf, 0x47, len);
+            int skip = p ? p - buf : len;
+            buf += skip;
+            len -= skip;
         } else {
             handle_packet(ts, buf);
             buf += TS_PACKET_SIZE;
@@ -2349,6 +2467,7 @@ void ff_mpegts_parse_close(MpegTSContext *ts)
 
     for(i=0;i<NB_PID_MAX;i++)
         av_free(ts->pids[i]);
+    av_free(ts->prg_discard);
     av_free(ts);
 }
 
@@ -84,6 +84,10 @@ typedef struct MpegTSWrite {
 #define MPEGTS_FLAG_AAC_LATM        0x02
     int flags;
     int copyts;
+
+    uint8_t *batch;   ///< TS packets not yet passed to the AVIOContext
+    int batch_len;    ///< size of the data in batch in bytes
+    int batch_size;   ///< capacity of batch in TS packets
 } MpegTSWrite;
 
 /* a PES packet header is generated every DEFAULT_PES_HEADER_FREQ packets */
@@ -120,6 +124,8 @@ static const AVOption options[] = {
       offsetof(MpegTSWrite, reemit_pat_pmt), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
     { "mpegts_copyts", "dont offset dts/pts",
       offsetof(MpegTSWrite, copyts), AV_OPT_TYPE_INT, {.i64=-1}, -1, 1, AV_OPT_FLAG_ENCODING_PARAM},
+    { "mpegts_batch_packets", "Maximum number of TS packets assembled before they are written out",
+      offsetof(MpegTSWrite, batch_size), AV_OPT_TYPE_INT, {.i64 = 32}, 1, 4096, AV_OPT_FLAG_ENCODING_PARAM},
     { NULL },
 };
 
@@ -479,27 +485,51 @@ static MpegTSService *mpegts_add_service(MpegTSWrite *ts,
 
 static int64_t get_pcr(const MpegTSWrite *ts, AVIOContext *pb)
 {
-    return av_rescale(avio_tell(pb) + 11, 8 * PCR_TIME_BASE, ts->mux_rate) +
+    return av_rescale(avio_tell(pb) + ts->batch_len + 11,
+                      8 * PCR_TIME_BASE, ts->mux_rate) +
            ts->first_pcr;
 }
 
-static void mpegts_prefix_m2ts_header(AVFormatContext *s)
+/* Pass the assembled TS packets to the AVIOContext in a single write. */
+static void flush_ts_packets(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+
+    if (ts->batch_len) {
+        avio_write(s->pb, ts->batch, ts->batch_len);
+        ts->batch_len = 0;
+    }
+}
+
+/* Return the space for the next TS packet in the batch. The packet is
+ * built there and added to the output by commit_ts_packet(). */
+static uint8_t *get_ts_packet(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+    int size = TS_PACKET_SIZE + 4 * !!ts->m2ts_mode;
+
+    if (ts->batch_len + size > ts->batch_size * size)
+        flush_ts_packets(s);
+    return ts->batch + ts->batch_len + size - TS_PACKET_SIZE;
+}
+
+static void commit_ts_packet(AVFormatContext *s)
 {
     MpegTSWrite *ts = s->priv_data;
+
     if (ts->m2ts_mode) {
-        int64_t pcr = get_pcr(s->priv_data, s->pb);
-        uint32_t tp_extra_header = pcr % 0x3fffffff;
-        tp_extra_header = AV_RB32(&tp_extra_header);
-        avio_write(s->pb, (unsigned char *) &tp_extra_header,
-                sizeof(tp_extra_header));
+        int64_t pcr = get_pcr(ts, s->pb);
+        AV_WB32(ts->batch + ts->batch_len, pcr % 0x3fffffff);
+        ts->batch_len += 4;
     }
+    ts->batch_len += TS_PACKET_SIZE;
 }
 
 static void section_write_packet(MpegTSSection *s, const uint8_t *packet)
 {
     AVFormatContext *ctx = s->opaque;
-    mpegts_prefix_m2ts_header(ctx);
-    avio_write(ctx->pb, packet, TS_PACKET_SIZE);
+    memcpy(get_ts_packet(ctx), packet, TS_PACKET_SIZE);
+    commit_ts_packet(ctx);
 }
 
 static int mpegts_write_header(AVFormatContext *s)
@@ -545,9 +575,15 @@ static int mpegts_write_header(AVFormatContext *s)
     ts->sdt.write_packet = section_write_packet;
     ts->sdt.opaque = s;
 
+    ts->batch = av_malloc(ts->batch_size * (TS_PACKET_SIZE + 4));
+    if (!ts->batch)
+        return AVERROR(ENOMEM);
+
     pids = av_malloc(s->nb_streams * sizeof(*pids));
-    if (!pids)
+    if (!pids) {
+        av_freep(&ts->batch);
         return AVERROR(ENOMEM);
+    }
 
     /* assign pids to each stream */
     for(i = 0;i < s->nb_streams; i++) {
@@ -691,6 +727,7 @@ static int mpegts_write_header(AVFormatContext *s)
 
  fail:
     av_free(pids);
+    av_freep(&ts->batch);
     for(i = 0;i < s->nb_streams; i++) {
         MpegTSWriteStream *ts_st;
         st = s->streams[i];
@@ -744,7 +781,7 @@ static int write_pcr_bits(uint8_t *buf, int64_t pcr)
 static void mpegts_insert_null_packet(AVFormatContext *s)
 {
     uint8_t *q;
-    uint8_t buf[TS_PACKET_SIZE];
+    uint8_t *buf = get_ts_packet(s);
 
     q = buf;
     *q++ = 0x47;
@@ -752,8 +789,7 @@ static void mpegts_insert_null_packet(AVFormatContext *s)
     *q++ = 0xff;
     *q++ = 0x10;
     memset(q, 0x0FF, TS_PACKET_SIZE - (q - buf));
-    mpegts_prefix_m2ts_header(s);
-    avio_write(s->pb, buf, TS_PACKET_SIZE);
+    commit_ts_packet(s);
 }
 
 /* Write a single transport stream packet with a PCR and no payload */
@@ -762,7 +798,7 @@ static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st)
     MpegTSWrite *ts = s->priv_data;
     MpegTSWriteStream *ts_st = st->priv_data;
     uint8_t *q;
-    uint8_t buf[TS_PACKET_SIZE];
+    uint8_t *buf = get_ts_packet(s);
 
     q = buf;
     *q++ = 0x47;
@@ -778,8 +814,7 @@ static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st)
 
     /* stuffing bytes */
     memset(q, 0xFF, TS_PACKET_SIZE - (q - buf));
-    mpegts_prefix_m2ts_header(s);
-    avio_write(s->pb, buf, TS_PACKET_SIZE);
+    commit_ts_packet(s);
 }
 
 static void write_pts(uint8_t *q, int fourbits, int64_t pts)
@@ -840,7 +875,7 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
 {
     MpegTSWriteStream *ts_st = st->priv_data;
     MpegTSWrite *ts = s->priv_data;
-    uint8_t buf[TS_PACKET_SIZE];
+    uint8_t *buf;
     uint8_t *q;
     int val, is_start, len, header_len, write_pcr, private_code, flags;
     int afc_len, stuffing_len;
@@ -875,6 +910,7 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         }
 
         /* prepare packet header */
+        buf = get_ts_packet(s);
         q = buf;
         *q++ = 0x47;
         val = (ts_st->pid >> 8);
@@ -1043,9 +1079,9 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         memcpy(buf + TS_PACKET_SIZE - len, payload, len);
         payload += len;
         payload_size -= len;
-        mpegts_prefix_m2ts_header(s);
-        avio_write(s->pb, buf, TS_PACKET_SIZE);
+        commit_ts_packet(s);
     }
+    flush_ts_packets(s);
     avio_flush(s->pb);
     ts_st->prev_payload_key = key;
 }
@@ -1207,6 +1243,7 @@ static void mpegts_write_flush(AVFormatContext *s)
             ts_st->payload_size = 0;
         }
     }
+    flush_ts_packets(s);
     avio_flush(s->pb);
 }
 
@@ -1245,6 +1282,7 @@ static int mpegts_write_end(AVFormatContext *s)
         av_free(service);
     }
     av_free(ts->services);
+    av_freep(&ts->batch);
 
     return 0;
 }
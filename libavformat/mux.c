@@ -537,9 +537,14 @@ int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
     AVStream *st   = s->streams[pkt->stream_index];
     int chunked    = s->max_chunk_size || s->max_chunk_duration;
 
-    this_pktl      = av_mallocz(sizeof(AVPacketList));
-    if (!this_pktl)
-        return AVERROR(ENOMEM);
+    if (s->packet_pool) {
+        this_pktl      = s->packet_pool;
+        s->packet_pool = this_pktl->next;
+    } else {
+        this_pktl = av_mallocz(sizeof(AVPacketList));
+        if (!this_pktl)
+            return AVERROR(ENOMEM);
+    }
     this_pktl->pkt = *pkt;
     pkt->destruct  = NULL;           // do not free original but only the copy
     av_dup_packet(&this_pktl->pkt);  // duplicate the packet if it uses non-allocated memory
@@ -548,6 +553,7 @@ int ff_interleave_add_packet(AVFormatContext *s, AVPacket *pkt,
         next_point = &(st->last_in_packet_buffer->next);
     } else {
         next_point = &s->packet_buffer;
+        s->nb_buffered_streams++;
     }
 
     if (*next_point) {
@@ -624,19 +630,16 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
             return ret;
     }
 
-    for (i = 0; i < s->nb_streams; i++) {
-        if (s->streams[i]->last_in_packet_buffer) {
-            ++stream_count;
-        } else if (s->streams[i]->codec->codec_type == AVMEDIA_TYPE_SUBTITLE) {
-            ++noninterleaved_count;
-        }
-    }
+    stream_count = s->nb_buffered_streams;
 
     if (s->nb_streams == stream_count) {
         flush = 1;
     } else if (!flush) {
         for (i=0; i < s->nb_streams; i++) {
-            if (s->streams[i]->last_in_packet_buffer) {
+            if (!s->streams[i]->last_in_packet_buffer) {
+                if (s->streams[i]->codec->codec_type == AVMEDIA_TYPE_SUBTITLE)
+                    ++noninterleaved_count;
+            } else {
                 int64_t delta_dts =
                     av_rescale_q(s->streams[i]->last_in_packet_buffer->pkt.dts,
                                 s->streams[i]->time_base,
@@ -663,9 +666,12 @@ int ff_interleave_packet_per_dts(AVFormatContext *s, AVPacket *out,
         if (!s->packet_buffer)
             s->packet_buffer_end = NULL;
 
-        if (st->last_in_packet_buffer == pktl)
+        if (st->last_in_packet_buffer == pktl) {
             st->last_in_packet_buffer = NULL;
-        av_freep(&pktl);
+            s->nb_buffered_streams--;
+        }
+        pktl->next     = s->packet_pool;
+        s->packet_pool = pktl;
 
         if (s->avoid_negative_ts > 0) {
             if (out->dts != AV_NOPTS_VALUE) {
@@ -200,6 +200,11 @@ typedef struct {
     int nb_segments;
     MXFIndexTableSegment **segments;    /* sorted by IndexStartPosition */
     AVIndexEntry *fake_index;   /* used for calling ff_index_search_timestamp() */
+    uint64_t *segment_ends;     /* EditUnit after the last one covered by segments[0..i] */
+    int64_t *segment_offsets;   /* essence container offset of segments[i] if CBR */
+    int nb_partitions;
+    MXFPartition **partitions;  /* partitions with essence of BodySID, sorted by offset */
+    int64_t *partition_ends;    /* essence container offset after partitions[0..i] */
 } MXFIndexTable;
 
 typedef struct {
@@ -950,11 +955,27 @@ static const MXFCodecUL mxf_sound_essence_container_uls[] = {
     { { 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00 },  0,      AV_CODEC_ID_NONE },
 };
 
+static int mxf_compare_segments(const void *a, const void *b)
+{
+    const MXFIndexTableSegment *s1 = *(const MXFIndexTableSegment **)a;
+    const MXFIndexTableSegment *s2 = *(const MXFIndexTableSegment **)b;
+
+    if (s1->body_sid != s2->body_sid)
+        return s1->body_sid < s2->body_sid ? -1 : 1;
+    if (s1->index_sid != s2->index_sid)
+        return s1->index_sid < s2->index_sid ? -1 : 1;
+    if (s1->index_start_position != s2->index_start_position)
+        return s1->index_start_position < s2->index_start_position ? -1 : 1;
+    /* put the longest of the duplicates first, it is the one we keep */
+    if (s1->index_duration != s2->index_duration)
+        return s1->index_duration > s2->index_duration ? -1 : 1;
+    return 0;
+}
+
 static int mxf_get_sorted_table_segments(MXFContext *mxf, int *nb_sorted_segments, MXFIndexTableSegment ***sorted_segments)
 {
     int i, j, nb_segments = 0;
     MXFIndexTableSegment **unsorted_segments;
-    int last_body_sid = -1, last_index_sid = -1, last_index_start = -1;
 
     /* count number of segments, allocate arrays and copy unsorted segments */
     for (i = 0; i < mxf->metadata_sets_count; i++)
@@ -975,39 +996,23 @@ static int mxf_get_sorted_table_segments(MXFContext *mxf, int *nb_sorted_segment
         if (mxf->metadata_sets[i]->type == IndexTableSegment)
             unsorted_segments[j++] = (MXFIndexTableSegment*)mxf->metadata_sets[i];
 
-    *nb_sorted_segments = 0;
+    /* sort segments by {BodySID, IndexSID, IndexStartPosition}, large files
+     * have one segment per body partition so this must not be quadratic */
+    qsort(unsorted_segments, nb_segments, sizeof(*unsorted_segments), mxf_compare_segments);
 
-    /* sort segments by {BodySID, IndexSID, IndexStartPosition}, remove duplicates while we're at it */
+    /* remove duplicates, keeping the one with the largest IndexDuration */
+    *nb_sorted_segments = 0;
     for (i = 0; i < nb_segments; i++) {
-        int best = -1, best_body_sid = -1, best_index_sid = -1, best_index_start = -1;
-        uint64_t best_index_duration = 0;
+        MXFIndexTableSegment *s = unsorted_segments[i];
 
-        for (j = 0; j < nb_segments; j++) {
-            MXFIndexTableSegment *s = unsorted_segments[j];
-
-            /* Require larger BosySID, IndexSID or IndexStartPosition then the previous entry. This removes duplicates.
-             * We want the smallest values for the keys than what we currently have, unless this is the first such entry this time around.
-             * If we come across an entry with the same IndexStartPosition but larger IndexDuration, then we'll prefer it over the one we currently have.
-             */
-            if ((i == 0     || s->body_sid > last_body_sid || s->index_sid > last_index_sid || s->index_start_position > last_index_start) &&
-                (best == -1 || s->body_sid < best_body_sid || s->index_sid < best_index_sid || s->index_start_position < best_index_start ||
-                (s->index_start_position == best_index_start && s->index_duration > best_index_duration))) {
-                best             = j;
-                best_body_sid    = s->body_sid;
-                best_index_sid   = s->index_sid;
-                best_index_start = s->index_start_position;
-                best_index_duration = s->index_duration;
-            }
+        if (i > 0) {
+            MXFIndexTableSegment *prev = unsorted_segments[i-1];
+            if (s->body_sid             == prev->body_sid  &&
+                s->index_sid            == prev->index_sid &&
+                s->index_start_position == prev->index_start_position)
+                continue;
         }
-
-        /* no suitable entry found -> we're done */
-        if (best == -1)
-            break;
-
-        (*sorted_segments)[(*nb_sorted_segments)++] = unsorted_segments[best];
-        last_body_sid    = best_body_sid;
-        last_index_sid   = best_index_sid;
-        last_index_start = best_index_start;
+        (*sorted_segments)[(*nb_sorted_segments)++] = s;
     }
 
     av_free(unsorted_segments);
@@ -1018,28 +1023,28 @@ static int mxf_get_sorted_table_segments(MXFContext *mxf, int *nb_sorted_segment
 /**
  * Computes the absolute file offset of the given essence container offset
  */
-static int mxf_absolute_bodysid_offset(MXFContext *mxf, int body_sid, int64_t offset, int64_t *offset_out)
+static int mxf_absolute_bodysid_offset(MXFContext *mxf, MXFIndexTable *t, int64_t offset, int64_t *offset_out)
 {
-    int x;
-    int64_t offset_in = offset;     /* for logging */
-
-    for (x = 0; x < mxf->partitions_count; x++) {
-        MXFPartition *p = &mxf->partitions[x];
-
-        if (p->body_sid != body_sid)
-            continue;
+    int lo = 0, hi = t->nb_partitions;
 
-        if (offset < p->essence_length || !p->essence_length) {
-            *offset_out = p->essence_offset + offset;
-            return 0;
-        }
+    /* find the first partition that ends after offset */
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (t->partition_ends[mid] > offset)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
 
-        offset -= p->essence_length;
+    if (lo < t->nb_partitions) {
+        MXFPartition *p = t->partitions[lo];
+        *offset_out = p->essence_offset + offset - (lo ? t->partition_ends[lo-1] : 0);
+        return 0;
     }
 
     av_log(mxf->fc, AV_LOG_ERROR,
            "failed to find absolute offset of %"PRIX64" in BodySID %i - partial file?\n",
-           offset_in, body_sid);
+           offset, t->body_sid);
 
     return AVERROR_INVALIDDATA;
 }
@@ -1070,44 +1075,48 @@ static int64_t mxf_essence_container_end(MXFContext *mxf, int body_sid)
 /* EditUnit -> absolute offset */
 static int mxf_edit_unit_absolute_offset(MXFContext *mxf, MXFIndexTable *index_table, int64_t edit_unit, int64_t *edit_unit_out, int64_t *offset_out, int nag)
 {
-    int i;
-    int64_t offset_temp = 0;
+    int lo = 0, hi = index_table->nb_segments;
+
+    /* find the first segment that ends after edit_unit */
+    edit_unit = FFMAX(edit_unit, 0);
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (index_table->segment_ends[mid] > edit_unit)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
 
-    for (i = 0; i < index_table->nb_segments; i++) {
-        MXFIndexTableSegment *s = index_table->segments[i];
+    if (lo < index_table->nb_segments) {
+        MXFIndexTableSegment *s = index_table->segments[lo];
+        int64_t index, offset_temp = index_table->segment_offsets[lo];
 
         edit_unit = FFMAX(edit_unit, s->index_start_position);  /* clamp if trying to seek before start */
+        index     = edit_unit - s->index_start_position;
 
-        if (edit_unit < s->index_start_position + s->index_duration) {
-            int64_t index = edit_unit - s->index_start_position;
+        if (s->edit_unit_byte_count)
+            offset_temp += s->edit_unit_byte_count * index;
+        else if (s->nb_index_entries) {
+            if (s->nb_index_entries == 2 * s->index_duration + 1)
+                index *= 2;     /* Avid index */
 
-            if (s->edit_unit_byte_count)
-                offset_temp += s->edit_unit_byte_count * index;
-            else if (s->nb_index_entries) {
-                if (s->nb_index_entries == 2 * s->index_duration + 1)
-                    index *= 2;     /* Avid index */
-
-                if (index < 0 || index >= s->nb_index_entries) {
-                    av_log(mxf->fc, AV_LOG_ERROR, "IndexSID %i segment at %"PRId64" IndexEntryArray too small\n",
-                           index_table->index_sid, s->index_start_position);
-                    return AVERROR_INVALIDDATA;
-                }
-
-                offset_temp = s->stream_offset_entries[index];
-            } else {
-                av_log(mxf->fc, AV_LOG_ERROR, "IndexSID %i segment at %"PRId64" missing EditUnitByteCount and IndexEntryArray\n",
+            if (index < 0 || index >= s->nb_index_entries) {
+                av_log(mxf->fc, AV_LOG_ERROR, "IndexSID %i segment at %"PRId64" IndexEntryArray too small\n",
                        index_table->index_sid, s->index_start_position);
                 return AVERROR_INVALIDDATA;
             }
 
-            if (edit_unit_out)
-                *edit_unit_out = edit_unit;
-
-            return mxf_absolute_bodysid_offset(mxf, index_table->body_sid, offset_temp, offset_out);
+            offset_temp = s->stream_offset_entries[index];
         } else {
-            /* EditUnitByteCount == 0 for VBR indexes, which is fine since they use explicit StreamOffsets */
-            offset_temp += s->edit_unit_byte_count * s->index_duration;
+            av_log(mxf->fc, AV_LOG_ERROR, "IndexSID %i segment at %"PRId64" missing EditUnitByteCount and IndexEntryArray\n",
+                   index_table->index_sid, s->index_start_position);
+            return AVERROR_INVALIDDATA;
         }
+
+        if (edit_unit_out)
+            *edit_unit_out = edit_unit;
+
+        return mxf_absolute_bodysid_offset(mxf, index_table, offset_temp, offset_out);
     }
 
     if (nag)
@@ -1116,6 +1125,55 @@ static int mxf_edit_unit_absolute_offset(MXFContext *mxf, MXFIndexTable *index_t
     return AVERROR_INVALIDDATA;
 }
 
+/**
+ * Flattens the segments and the partitions of an index table into sorted
+ * arrays, so mxf_edit_unit_absolute_offset() can binary search them.
+ */
+static int mxf_compute_index_lookup(MXFContext *mxf, MXFIndexTable *t)
+{
+    int i;
+    uint64_t end = 0;
+    int64_t offset = 0;
+
+    if (!(t->segment_ends    = av_calloc(t->nb_segments, sizeof(*t->segment_ends)))    ||
+        !(t->segment_offsets = av_calloc(t->nb_segments, sizeof(*t->segment_offsets))) ||
+        !(t->partitions      = av_calloc(mxf->partitions_count, sizeof(*t->partitions)))  ||
+        !(t->partition_ends  = av_calloc(mxf->partitions_count, sizeof(*t->partition_ends))))
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < t->nb_segments; i++) {
+        MXFIndexTableSegment *s = t->segments[i];
+
+        /* segments with zero IndexDuration never match an EditUnit,
+         * keeping the maximum makes the ends sorted even if they overlap */
+        if (s->index_duration)
+            end = FFMAX(end, s->index_start_position + s->index_duration);
+        t->segment_ends[i]    = end;
+        /* EditUnitByteCount == 0 for VBR indexes, which is fine since they use explicit StreamOffsets */
+        t->segment_offsets[i] = offset;
+        offset += s->edit_unit_byte_count * s->index_duration;
+    }
+
+    offset = 0;
+    for (i = 0; i < mxf->partitions_count; i++) {
+        MXFPartition *p = &mxf->partitions[i];
+
+        if (p->body_sid != t->body_sid)
+            continue;
+
+        t->partitions[t->nb_partitions] = p;
+        if (!p->essence_length) {
+            /* unknown length, everything from here on is in this partition */
+            t->partition_ends[t->nb_partitions++] = INT64_MAX;
+            break;
+        }
+        offset += p->essence_length;
+        t->partition_ends[t->nb_partitions++] = offset;
+    }
+
+    return 0;
+}
+
 static int mxf_compute_ptses_fake_index(MXFContext *mxf, MXFIndexTable *index_table)
 {
     int i, j, x;
@@ -1299,6 +1357,9 @@ static int mxf_compute_index_tables(MXFContext *mxf)
             t->segments[k]->index_duration = mxf->fc->streams[0]->duration;
             break;
         }
+
+        if ((ret = mxf_compute_index_lookup(mxf, t)) < 0)
+            goto finish_decoding_index;
     }
 
     ret = 0;
@@ -2273,6 +2334,10 @@ static int mxf_read_close(AVFormatContext *s)
             av_freep(&mxf->index_tables[i].segments);
             av_freep(&mxf->index_tables[i].ptses);
             av_freep(&mxf->index_tables[i].fake_index);
+            av_freep(&mxf->index_tables[i].segment_ends);
+            av_freep(&mxf->index_tables[i].segment_offsets);
+            av_freep(&mxf->index_tables[i].partitions);
+            av_freep(&mxf->index_tables[i].partition_ends);
         }
     }
     av_freep(&mxf->index_tables);
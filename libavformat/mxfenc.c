@@ -2076,10 +2076,7 @@ static int mxf_write_footer(AVFormatContext *s)
 
 static int mxf_interleave_get_packet(AVFormatContext *s, AVPacket *out, AVPacket *pkt, int flush)
 {
-    int i, stream_count = 0;
-
-    for (i = 0; i < s->nb_streams; i++)
-        stream_count += !!s->streams[i]->last_in_packet_buffer;
+    int stream_count = s->nb_buffered_streams;
 
     if (stream_count && (s->nb_streams == stream_count || flush)) {
         AVPacketList *pktl = s->packet_buffer;
@@ -2097,8 +2094,10 @@ static int mxf_interleave_get_packet(AVFormatContext *s, AVPacket *out, AVPacket
             while (pktl) {
                 AVPacketList *next = pktl->next;
 
-                if(s->streams[pktl->pkt.stream_index]->last_in_packet_buffer == pktl)
+                if(s->streams[pktl->pkt.stream_index]->last_in_packet_buffer == pktl) {
                     s->streams[pktl->pkt.stream_index]->last_in_packet_buffer= NULL;
+                    s->nb_buffered_streams--;
+                }
                 av_free_packet(&pktl->pkt);
                 av_freep(&pktl);
                 pktl = next;
@@ -2116,8 +2115,10 @@ static int mxf_interleave_get_packet(AVFormatContext *s, AVPacket *out, AVPacket
         *out = pktl->pkt;
         av_dlog(s, "out st:%d dts:%"PRId64"\n", (*out).stream_index, (*out).dts);
         s->packet_buffer = pktl->next;
-        if(s->streams[pktl->pkt.stream_index]->last_in_packet_buffer == pktl)
+        if(s->streams[pktl->pkt.stream_index]->last_in_packet_buffer == pktl) {
             s->streams[pktl->pkt.stream_index]->last_in_packet_buffer= NULL;
+            s->nb_buffered_streams--;
+        }
         if(!s->packet_buffer)
             s->packet_buffer_end= NULL;
         av_freep(&pktl);
@@ -168,6 +168,212 @@ int ff_network_wait_fd_timeout(int fd, int write, int64_t timeout, AVIOInterrupt
     }
 }
 
+/**
+ * Reorder an address list so that consecutive entries alternate between
+ * the family of the first address and the other ones.
+ */
+static struct addrinfo *interleave_addrinfo(struct addrinfo *ai)
+{
+    struct addrinfo *head = NULL, **tail = &head;
+    struct addrinfo *first = NULL, **first_tail = &first;
+    struct addrinfo *other = NULL, **other_tail = &other;
+    int family = ai ? ai->ai_family : 0;
+
+    while (ai) {
+        struct addrinfo *next = ai->ai_next;
+        if (ai->ai_family == family) {
+            *first_tail = ai;
+            first_tail  = &ai->ai_next;
+        } else {
+            *other_tail = ai;
+            other_tail  = &ai->ai_next;
+        }
+        ai = next;
+    }
+    *first_tail = *other_tail = NULL;
+
+    while (first || other) {
+        if (first) {
+            *tail = first;
+            tail  = &first->ai_next;
+            first = first->ai_next;
+        }
+        if (other) {
+            *tail = other;
+            tail  = &other->ai_next;
+            other = other->ai_next;
+        }
+    }
+    *tail = NULL;
+    return head;
+}
+
+static void log_connect_error(void *log_ctx, struct addrinfo *ai, int err)
+{
+    char host[INET6_ADDRSTRLEN + 1] = "unknown", port[16] = "";
+    char errbuf[100];
+
+    getnameinfo(ai->ai_addr, ai->ai_addrlen, host, sizeof(host),
+                port, sizeof(port), NI_NUMERICHOST | NI_NUMERICSERV);
+    av_strerror(err, errbuf, sizeof(errbuf));
+    av_log(log_ctx, AV_LOG_VERBOSE, "Connection attempt to %s port %s failed: %s\n",
+           host, port, errbuf);
+}
+
+#define MAX_CONNECT_ATTEMPTS 4
+#define NEXT_ATTEMPT_DELAY   200000
+
+typedef struct ConnectAttempt {
+    int fd;
+    int64_t deadline;
+    struct addrinfo *addr;
+} ConnectAttempt;
+
+/**
+ * Start a non-blocking connect.
+ * @return 0 if connected right away, 1 if in progress, <0 on error
+ */
+static int start_connect_attempt(ConnectAttempt *a, struct addrinfo *ai,
+                                 int64_t timeout, AVIOInterruptCB *int_cb,
+                                 void (*customize_fd)(void *ctx, int fd),
+                                 void *customize_ctx)
+{
+    int ret;
+
+    a->addr = ai;
+    a->fd   = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (a->fd < 0)
+        return ff_neterrno();
+    if (customize_fd)
+        customize_fd(customize_ctx, a->fd);
+    ff_socket_nonblock(a->fd, 1);
+
+    while (connect(a->fd, ai->ai_addr, ai->ai_addrlen)) {
+        ret = ff_neterrno();
+        if (ret == AVERROR(EINTR)) {
+            if (ff_check_interrupt(int_cb)) {
+                ret = AVERROR_EXIT;
+                goto fail;
+            }
+            continue;
+        }
+        if (ret == AVERROR(EINPROGRESS) || ret == AVERROR(EAGAIN)) {
+            a->deadline = timeout ? av_gettime() + timeout : 0;
+            return 1;
+        }
+        goto fail;
+    }
+    return 0;
+
+fail:
+    closesocket(a->fd);
+    a->fd = -1;
+    return ret;
+}
+
+int ff_connect_parallel(struct addrinfo **addrs, int64_t timeout, int parallel,
+                        void *log_ctx, AVIOInterruptCB *int_cb, int *fd,
+                        void (*customize_fd)(void *ctx, int fd),
+                        void *customize_ctx)
+{
+    ConnectAttempt attempts[MAX_CONNECT_ATTEMPTS];
+    struct pollfd pfd[MAX_CONNECT_ATTEMPTS];
+    int nb_attempts = 0, i, ret, last_err = AVERROR(EIO);
+    int64_t now, wait, next_attempt = 0;
+    struct addrinfo *ai;
+
+    parallel = av_clip(parallel, 1, MAX_CONNECT_ATTEMPTS);
+    *addrs   = interleave_addrinfo(*addrs);
+    ai       = *addrs;
+    *fd      = -1;
+
+    while (ai || nb_attempts) {
+        now = av_gettime();
+        if (ai && nb_attempts < parallel && (!nb_attempts || now >= next_attempt)) {
+            ConnectAttempt *a = &attempts[nb_attempts];
+            ret = start_connect_attempt(a, ai, timeout, int_cb,
+                                        customize_fd, customize_ctx);
+            ai = ai->ai_next;
+            if (!ret) {
+                i = nb_attempts;
+                goto connected;
+            }
+            if (ret == AVERROR_EXIT) {
+                last_err = ret;
+                break;
+            }
+            if (ret < 0) {
+                log_connect_error(log_ctx, a->addr, ret);
+                last_err = ret;
+                continue;
+            }
+            pfd[nb_attempts].fd      = a->fd;
+            pfd[nb_attempts].events  = POLLOUT;
+            pfd[nb_attempts].revents = 0;
+            nb_attempts++;
+            next_attempt = now + NEXT_ATTEMPT_DELAY;
+            continue;
+        }
+
+        if (ff_check_interrupt(int_cb)) {
+            last_err = AVERROR_EXIT;
+            break;
+        }
+
+        /* wake up for the interrupt check, the next attempt or a timeout */
+        wait = 100000;
+        if (ai && nb_attempts < parallel)
+            wait = FFMIN(wait, next_attempt - now);
+        for (i = 0; i < nb_attempts; i++)
+            if (attempts[i].deadline)
+                wait = FFMIN(wait, attempts[i].deadline - now);
+        ret = poll(pfd, nb_attempts, FFMAX(wait, 0) / 1000);
+        if (ret < 0) {
+            ret = ff_neterrno();
+            if (ret == AVERROR(EINTR))
+                continue;
+            last_err = ret;
+            break;
+        }
+
+        now = av_gettime();
+        for (i = 0; i < nb_attempts;) {
+            int err = 0;
+            if (pfd[i].revents) {
+                socklen_t optlen = sizeof(err);
+                if (getsockopt(attempts[i].fd, SOL_SOCKET, SO_ERROR, &err, &optlen))
+                    err = AVUNERROR(ff_neterrno());
+                if (!err)
+                    goto connected;
+                err = AVERROR(err);
+            } else if (attempts[i].deadline && now >= attempts[i].deadline) {
+                err = AVERROR(ETIMEDOUT);
+            }
+            if (!err) {
+                i++;
+                continue;
+            }
+            log_connect_error(log_ctx, attempts[i].addr, err);
+            closesocket(attempts[i].fd);
+            last_err = err;
+            nb_attempts--;
+            attempts[i] = attempts[nb_attempts];
+            pfd[i]      = pfd[nb_attempts];
+        }
+    }
+
+    for (i = 0; i < nb_attempts; i++)
+        closesocket(attempts[i].fd);
+    return last_err;
+
+connected:
+    *fd = attempts[i].fd;
+    while (nb_attempts--)
+        if (nb_attempts != i)
+            closesocket(attempts[nb_attempts].fd);
+    return 0;
+}
+
 void ff_network_close(void)
 {
 #if HAVE_WINSOCK2_H
@@ -58,6 +58,7 @@ int ff_neterrno(void);
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 
 #define ff_neterrno() AVERROR(errno)
@@ -94,6 +95,31 @@ int ff_network_wait_fd(int fd, int write);
  */
 int ff_network_wait_fd_timeout(int fd, int write, int64_t timeout, AVIOInterruptCB *int_cb);
 
+/**
+ * Connect to one of the addresses in a list, trying several of them at once.
+ *
+ * A new attempt is started every 200 ms while the earlier ones are still
+ * in progress, with at most 'parallel' attempts pending at any time, and
+ * the first socket that gets connected wins. Addresses of different
+ * families are alternated so that a broken IPv6 route does not delay
+ * IPv4 connections ("happy eyeballs").
+ *
+ * @param addrs     list of addresses to connect to, reordered in place
+ * @param timeout   time after which a single attempt is given up, in
+ *                  microseconds, 0 for no timeout
+ * @param parallel  maximum number of attempts in progress at once
+ * @param log_ctx   context used for logging
+ * @param int_cb    interrupt callback, checked while waiting
+ * @param fd        the connected socket, left in non-blocking mode
+ * @param customize_fd  if not NULL, called on each socket before connect()
+ * @param customize_ctx opaque passed to customize_fd
+ * @return 0 on success, a negative error code otherwise
+ */
+int ff_connect_parallel(struct addrinfo **addrs, int64_t timeout, int parallel,
+                        void *log_ctx, AVIOInterruptCB *int_cb, int *fd,
+                        void (*customize_fd)(void *ctx, int fd),
+                        void *customize_ctx);
+
 int ff_inet_aton (const char * str, struct in_addr * add);
 
 #if !HAVE_STRUCT_SOCKADDR_STORAGE
@@ -136,13 +136,23 @@ static int get_packetheader(NUTContext *nut, AVIOContext *bc,
 static uint64_t find_any_startcode(AVIOContext *bc, int64_t pos)
 {
     uint64_t state = 0;
+    int since_n = 7; /* bytes read since the last 'N' */
 
     if (pos >= 0)
         /* Note, this may fail if the stream is not seekable, but that should
          * not matter, as in this case we simply start where we currently are */
         avio_seek(bc, pos, SEEK_SET);
     while (!url_feof(bc)) {
+        if (since_n >= 7 && bc->buf_ptr < bc->buf_end) {
+            /* All startcodes begin with 'N' and none is in progress, so the
+             * buffered bytes up to the next 'N' can be skipped at once. */
+            uint8_t *p = memchr(bc->buf_ptr, 'N', bc->buf_end - bc->buf_ptr);
+            bc->buf_ptr = p ? p : bc->buf_end;
+            if (!p)
+                continue;
+        }
         state = (state << 8) | avio_r8(bc);
+        since_n = (state & 0xFF) == 'N' ? 0 : since_n + 1;
         if ((state >> 56) != 'N')
             continue;
         switch (state) {
@@ -753,6 +753,15 @@ static int64_t ogg_read_timestamp(AVFormatContext *s, int stream_index,
             struct ogg_stream *os = ogg->streams + stream_index;
             pts = ogg_calc_pts(s, i, NULL);
             ogg_validate_keyframe(s, i, pstart, psize);
+            if (pts != AV_NOPTS_VALUE &&
+                (os->pflags & AV_PKT_FLAG_KEY ||
+                 s->streams[i]->codec->codec_type != AVMEDIA_TYPE_VIDEO)) {
+                /* keep the position, so later seeks start their search
+                 * from it rather than from the ends of the file */
+                ff_reduce_index(s, i);
+                av_add_index_entry(s->streams[i], *pos_arg, pts, 0, 0,
+                                   AVINDEX_KEYFRAME);
+            }
             if (os->pflags & AV_PKT_FLAG_KEY) {
                 keypos = *pos_arg;
             } else if (os->keyframe_seek) {
@@ -74,6 +74,7 @@ static const AVOption options[]={
 {"avoid_negative_ts", "shift timestamps to make them positive. 1 enables, 0 disables, default of -1 enables when required by target format.", OFFSET(avoid_negative_ts), AV_OPT_TYPE_INT, {.i64 = -1}, -1, 1, E},
 {"skip_initial_bytes", "skip initial bytes", OFFSET(skip_initial_bytes), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX-1, D},
 {"correct_ts_overflow", "correct single timestamp overflows", OFFSET(correct_ts_overflow), AV_OPT_TYPE_INT, {.i64 = 1}, 0, 1, D},
+{"info_threads", "number of threads decoding streams in avformat_find_stream_info(), 0 for automatic", OFFSET(info_threads), AV_OPT_TYPE_INT, {.i64 = 1}, 0, INT_MAX, D},
 {NULL},
 };
 
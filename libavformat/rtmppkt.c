@@ -218,10 +218,13 @@ int ff_rtmp_packet_read_internal(URLContext *h, RTMPPacket *p, int chunk_size,
     return size;
 }
 
+/** size of the buffer used to gather chunks before sending them */
+#define RTMP_WRITE_BUFFER_SIZE 8192
+
 int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
                          int chunk_size, RTMPPacket *prev_pkt)
 {
-    uint8_t pkt_hdr[16], *p = pkt_hdr;
+    uint8_t buf[RTMP_WRITE_BUFFER_SIZE], *p = buf;
     int mode = RTMP_PS_TWELVEBYTES;
     int off = 0;
     int size = 0;
@@ -277,21 +280,31 @@ int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
     }
     prev_pkt[pkt->channel_id].extra      = pkt->extra;
 
-    if ((ret = ffurl_write(h, pkt_hdr, p - pkt_hdr)) < 0)
-        return ret;
-    size = p - pkt_hdr + pkt->data_size;
+    /* Gather the header, the chunks and their markers and send them with
+     * as few writes as possible, chunks are only 128 bytes by default. */
+    size = p - buf + pkt->data_size;
     while (off < pkt->data_size) {
         int towrite = FFMIN(chunk_size, pkt->data_size - off);
-        if ((ret = ffurl_write(h, pkt->data + off, towrite)) < 0)
-            return ret;
+        if (p - buf + towrite + 1 > sizeof(buf)) {
+            if (p > buf && (ret = ffurl_write(h, buf, p - buf)) < 0)
+                return ret;
+            p = buf;
+        }
+        if (towrite + 1 > sizeof(buf)) {
+            if ((ret = ffurl_write(h, pkt->data + off, towrite)) < 0)
+                return ret;
+        } else {
+            memcpy(p, pkt->data + off, towrite);
+            p += towrite;
+        }
         off += towrite;
         if (off < pkt->data_size) {
-            uint8_t marker = 0xC0 | pkt->channel_id;
-            if ((ret = ffurl_write(h, &marker, 1)) < 0)
-                return ret;
+            *p++ = 0xC0 | pkt->channel_id;
             size++;
         }
     }
+    if (p > buf && (ret = ffurl_write(h, buf, p - buf)) < 0)
+        return ret;
     return size;
 }
 
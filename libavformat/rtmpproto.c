@@ -89,6 +89,7 @@ typedef struct RTMPContext {
     int           flv_off;                    ///< number of bytes read from current buffer
     int           flv_nb_packets;             ///< number of flv packets published
     RTMPPacket    out_pkt;                    ///< rtmp packet, created from flv a/v or metadata (for output)
+    unsigned int  out_pkt_buf_size;           ///< allocated size of out_pkt.data, reused across packets
     uint32_t      client_report_size;         ///< number of bytes after which client should report to server
     uint32_t      bytes_read;                 ///< number of bytes read from server
     uint32_t      last_bytes_read;            ///< number of bytes read last reported to server
@@ -2031,8 +2032,7 @@ static int rtmp_close(URLContext *h)
 
     if (!rt->is_input) {
         rt->flv_data = NULL;
-        if (rt->out_pkt.data_size)
-            ff_rtmp_packet_destroy(&rt->out_pkt);
+        ff_rtmp_packet_destroy(&rt->out_pkt);
         if (rt->state > STATE_FCPUBLISH)
             ret = gen_fcunpublish_stream(h, rt);
     }
@@ -2331,8 +2331,12 @@ static int rtmp_write(URLContext *s, const uint8_t *buf, int size)
 
             //this can be a big packet, it's better to send it right here
             if ((ret = ff_rtmp_packet_create(&rt->out_pkt, RTMP_SOURCE_CHANNEL,
-                                             pkttype, ts, pktsize)) < 0)
+                                             pkttype, ts, 0)) < 0)
                 return ret;
+            av_fast_malloc(&rt->out_pkt.data, &rt->out_pkt_buf_size, pktsize);
+            if (!rt->out_pkt.data)
+                return AVERROR(ENOMEM);
+            rt->out_pkt.data_size = pktsize;
 
             rt->out_pkt.extra = rt->main_channel_id;
             rt->flv_data = rt->out_pkt.data;
@@ -2354,7 +2358,9 @@ static int rtmp_write(URLContext *s, const uint8_t *buf, int size)
         if (rt->flv_off == rt->flv_size) {
             rt->skip_bytes = 4;
 
-            if ((ret = rtmp_send_packet(rt, &rt->out_pkt, 0)) < 0)
+            if ((ret = ff_rtmp_packet_write(rt->stream, &rt->out_pkt,
+                                            rt->out_chunk_size,
+                                            rt->prev_pkt[1])) < 0)
                 return ret;
             rt->flv_size = 0;
             rt->flv_off = 0;
@@ -381,10 +381,22 @@ RTPDemuxContext *ff_rtp_parse_open(AVFormatContext *s1, AVStream *st,
     s->ic                  = s1;
     s->st                  = st;
     s->queue_size          = queue_size;
+    if (queue_size > 1) {
+        int i;
+        s->queue_pool = av_mallocz(queue_size * sizeof(*s->queue_pool));
+        if (!s->queue_pool) {
+            av_free(s);
+            return NULL;
+        }
+        for (i = 0; i < queue_size - 1; i++)
+            s->queue_pool[i].next = &s->queue_pool[i + 1];
+        s->queue_free = s->queue_pool;
+    }
     rtp_init_statistics(&s->statistics, 0); // do we know the initial sequence from sdp?
     if (!strcmp(ff_rtp_enc_name(payload_type), "MP2T")) {
         s->ts = ff_mpegts_parse_open(s->ic);
         if (s->ts == NULL) {
+            av_free(s->queue_pool);
             av_free(s);
             return NULL;
         }
@@ -591,14 +603,21 @@ static int rtp_parse_packet_internal(RTPDemuxContext *s, AVPacket *pkt,
     return rv;
 }
 
+static void release_packet(RTPDemuxContext *s, RTPPacket *packet)
+{
+    av_freep(&packet->buf);
+    packet->next  = s->queue_free;
+    s->queue_free = packet;
+}
+
 void ff_rtp_reset_packet_queue(RTPDemuxContext *s)
 {
     while (s->queue) {
         RTPPacket *next = s->queue->next;
-        av_free(s->queue->buf);
-        av_free(s->queue);
+        release_packet(s, s->queue);
         s->queue = next;
     }
+    s->queue_end = NULL;
     s->seq       = 0;
     s->queue_len = 0;
     s->prev_ret  = 0;
@@ -609,7 +628,12 @@ static void enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
     uint16_t seq   = AV_RB16(buf + 2);
     RTPPacket *cur = s->queue, *prev = NULL, *packet;
 
-    /* Find the correct place in the queue to insert the packet */
+    /* Find the correct place in the queue to insert the packet. Packets
+     * following a gap usually arrive in order, so check the end first. */
+    if (s->queue_end && (int16_t)(seq - s->queue_end->seq) >= 0) {
+        prev = s->queue_end;
+        cur  = NULL;
+    }
     while (cur) {
         int16_t diff = seq - cur->seq;
         if (diff < 0)
@@ -618,9 +642,14 @@ static void enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
         cur  = cur->next;
     }
 
-    packet = av_mallocz(sizeof(*packet));
-    if (!packet)
+    /* The queue never holds more than queue_size packets, so the pool
+     * cannot run dry; drop the packet rather than overrun it. */
+    packet = s->queue_free;
+    if (!packet) {
+        av_free(buf);
         return;
+    }
+    s->queue_free    = packet->next;
     packet->recvtime = av_gettime();
     packet->seq      = seq;
     packet->len      = len;
@@ -630,6 +659,8 @@ static void enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
         prev->next = packet;
     else
         s->queue = packet;
+    if (!cur)
+        s->queue_end = packet;
     s->queue_len++;
 }
 
@@ -658,9 +689,10 @@ static int rtp_parse_queued_packet(RTPDemuxContext *s, AVPacket *pkt)
     /* Parse the first packet in the queue, and dequeue it */
     rv   = rtp_parse_packet_internal(s, pkt, s->queue->buf, s->queue->len);
     next = s->queue->next;
-    av_free(s->queue->buf);
-    av_free(s->queue);
+    release_packet(s, s->queue);
     s->queue = next;
+    if (!next)
+        s->queue_end = NULL;
     s->queue_len--;
     return rv;
 }
@@ -767,6 +799,7 @@ void ff_rtp_parse_close(RTPDemuxContext *s)
     if (!strcmp(ff_rtp_enc_name(s->payload_type), "MP2T")) {
         ff_mpegts_parse_close(s->ts);
     }
+    av_free(s->queue_pool);
     av_free(s);
 }
 
@@ -167,6 +167,9 @@ struct RTPDemuxContext {
     /** Fields for packet reordering @{ */
     int prev_ret;     ///< The return value of the actual parsing of the previous packet
     RTPPacket* queue; ///< A sorted queue of buffered packets not yet returned
+    RTPPacket* queue_end;  ///< The last packet in queue
+    RTPPacket* queue_pool; ///< queue_size preallocated queue entries
+    RTPPacket* queue_free; ///< Unused entries of queue_pool
     int queue_len;    ///< The number of packets in queue
     int queue_size;   ///< The size of queue, or 0 if reordering is disabled
     /*@}*/
@@ -294,10 +294,16 @@ static void rtcp_send_sr(AVFormatContext *s1, int64_t ntp_time)
 /* send an rtp packet. sequence number is incremented, but the caller
    must update the timestamp itself */
 void ff_rtp_send_data(AVFormatContext *s1, const uint8_t *buf1, int len, int m)
+{
+    ff_rtp_send_fragment(s1, NULL, 0, buf1, len, m);
+}
+
+void ff_rtp_send_fragment(AVFormatContext *s1, const uint8_t *hdr, int hdr_len,
+                          const uint8_t *buf1, int len, int m)
 {
     RTPMuxContext *s = s1->priv_data;
 
-    av_dlog(s1, "rtp_send_data size=%d\n", len);
+    av_dlog(s1, "rtp_send_data size=%d\n", hdr_len + len);
 
     /* build the RTP header */
     avio_w8(s1->pb, (RTP_VERSION << 6));
@@ -306,11 +312,13 @@ void ff_rtp_send_data(AVFormatContext *s1, const uint8_t *buf1, int len, int m)
     avio_wb32(s1->pb, s->timestamp);
     avio_wb32(s1->pb, s->ssrc);
 
+    if (hdr_len)
+        avio_write(s1->pb, hdr, hdr_len);
     avio_write(s1->pb, buf1, len);
     avio_flush(s1->pb);
 
     s->seq++;
-    s->octet_count += len;
+    s->octet_count += hdr_len + len;
     s->packet_count++;
 }
 
@@ -79,6 +79,12 @@ typedef struct RTPMuxContext RTPMuxContext;
     { "h264_mode0", "Use mode 0 for H264 in RTP", 0, AV_OPT_TYPE_CONST, {.i64 = FF_RTP_FLAG_H264_MODE0}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "rtpflags" } \
 
 void ff_rtp_send_data(AVFormatContext *s1, const uint8_t *buf1, int len, int m);
+/**
+ * Send one RTP packet whose payload is hdr followed by buf1, without
+ * copying them into an intermediate buffer first.
+ */
+void ff_rtp_send_fragment(AVFormatContext *s1, const uint8_t *hdr, int hdr_len,
+                          const uint8_t *buf1, int len, int m);
 
 void ff_rtp_send_h264(AVFormatContext *s1, const uint8_t *buf1, int size);
 void ff_rtp_send_h263(AVFormatContext *s1, const uint8_t *buf1, int size);
@@ -58,6 +58,7 @@
 #define MAX_TIMEOUTS READ_PACKET_TIMEOUT_S * 1000 / POLL_TIMEOUT_MS
 #define SDP_MAX_SIZE 16384
 #define RECVBUF_SIZE 10 * RTP_MAX_PACKET_LENGTH
+#define TCP_BUF_SIZE 65536
 #define DEFAULT_REORDERING_DELAY 100000
 
 #define OFFSET(x) offsetof(RTSPState, x)
@@ -922,6 +923,39 @@ void ff_rtsp_parse_line(RTSPMessageHeader *reply, const char *buf,
     }
 }
 
+int ff_rtsp_read_buffered(AVFormatContext *s, uint8_t *buf, int size)
+{
+    RTSPState *rt = s->priv_data;
+    int len, done = 0;
+
+    if (!rt->tcp_buf && !(rt->tcp_buf = av_malloc(TCP_BUF_SIZE)))
+        return AVERROR(ENOMEM);
+
+    while (done < size) {
+        if (rt->tcp_buf_pos == rt->tcp_buf_len) {
+            /* large reads go straight to the caller's buffer */
+            if (size - done >= TCP_BUF_SIZE) {
+                len = ffurl_read_complete(rt->rtsp_hd, buf + done, size - done);
+                if (len < 0)
+                    return done ? done : len;
+                return done + len;
+            }
+            len = ffurl_read(rt->rtsp_hd, rt->tcp_buf, TCP_BUF_SIZE);
+            if (len < 0)
+                return done ? done : len;
+            if (!len)
+                break;
+            rt->tcp_buf_pos = 0;
+            rt->tcp_buf_len = len;
+        }
+        len = FFMIN(size - done, rt->tcp_buf_len - rt->tcp_buf_pos);
+        memcpy(buf + done, rt->tcp_buf + rt->tcp_buf_pos, len);
+        rt->tcp_buf_pos += len;
+        done            += len;
+    }
+    return done;
+}
+
 /* skip a RTP/TCP interleaved packet */
 void ff_rtsp_skip_packet(AVFormatContext *s)
 {
@@ -929,7 +963,7 @@ void ff_rtsp_skip_packet(AVFormatContext *s)
     int ret, len, len1;
     uint8_t buf[1024];
 
-    ret = ffurl_read_complete(rt->rtsp_hd, buf, 3);
+    ret = ff_rtsp_read_buffered(s, buf, 3);
     if (ret != 3)
         return;
     len = AV_RB16(buf + 1);
@@ -941,7 +975,7 @@ void ff_rtsp_skip_packet(AVFormatContext *s)
         len1 = len;
         if (len1 > sizeof(buf))
             len1 = sizeof(buf);
-        ret = ffurl_read_complete(rt->rtsp_hd, buf, len1);
+        ret = ff_rtsp_read_buffered(s, buf, len1);
         if (ret != len1)
             return;
         len -= len1;
@@ -970,7 +1004,7 @@ start:
     for (;;) {
         q = buf;
         for (;;) {
-            ret = ffurl_read_complete(rt->rtsp_hd, &ch, 1);
+            ret = ff_rtsp_read_buffered(s, &ch, 1);
             av_dlog(s, "ret=%d c=%02x [%c]\n", ret, ch, ch);
             if (ret != 1)
                 return AVERROR_EOF;
@@ -1022,7 +1056,7 @@ start:
     if (content_length > 0) {
         /* leave some room for a trailing '\0' (useful for simple parsing) */
         content = av_malloc(content_length + 1);
-        ffurl_read_complete(rt->rtsp_hd, content, content_length);
+        ff_rtsp_read_buffered(s, content, content_length);
         content[content_length] = '\0';
     }
     if (content_ptr)
@@ -1457,6 +1491,8 @@ void ff_rtsp_close_connections(AVFormatContext *s)
     if (rt->rtsp_hd_out != rt->rtsp_hd) ffurl_close(rt->rtsp_hd_out);
     ffurl_close(rt->rtsp_hd);
     rt->rtsp_hd = rt->rtsp_hd_out = NULL;
+    av_freep(&rt->tcp_buf);
+    rt->tcp_buf_pos = rt->tcp_buf_len = 0;
 }
 
 int ff_rtsp_connect(AVFormatContext *s)
@@ -1739,7 +1775,14 @@ static int udp_read_packet(AVFormatContext *s, RTSPStream **prtsp_st,
                 av_free(fds);
             }
         }
-        n = poll(p, max_p, POLL_TIMEOUT_MS);
+        if (tcp_fd != -1 && rt->tcp_buf_pos < rt->tcp_buf_len) {
+            /* poll() does not see data already in the receive buffer */
+            for (i = 0; i < max_p; i++)
+                p[i].revents = 0;
+            p[0].revents = POLLIN;
+            n = 1;
+        } else
+            n = poll(p, max_p, POLL_TIMEOUT_MS);
         if (n > 0) {
             int j = 1 - (tcp_fd == -1);
             timeout_cnt = 0;
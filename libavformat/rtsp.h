@@ -333,6 +333,14 @@ typedef struct RTSPState {
     /** Reusable buffer for receiving packets */
     uint8_t* recvbuf;
 
+    /** Receive buffer of the RTSP control connection, filled by
+     * ff_rtsp_read_buffered() */
+    //@{
+    uint8_t *tcp_buf;
+    int tcp_buf_pos;
+    int tcp_buf_len;
+    //@}
+
     /**
      * A mask with all requested transport methods
      */
@@ -510,6 +518,18 @@ int ff_rtsp_read_reply(AVFormatContext *s, RTSPMessageHeader *reply,
  */
 void ff_rtsp_skip_packet(AVFormatContext *s);
 
+/**
+ * Read exactly size bytes from the RTSP control connection.
+ *
+ * The data is read through a receive buffer, so that the many small reads
+ * done while parsing replies and interleaved packets do not each cost a
+ * system call.
+ *
+ * @return the number of bytes read, which is smaller than size only at
+ *         the end of the stream, or a negative error code
+ */
+int ff_rtsp_read_buffered(AVFormatContext *s, uint8_t *buf, int size);
+
 /**
  * Connect to the RTSP server and set up the individual media streams.
  * This can be used for both muxers and demuxers.
@@ -75,7 +75,7 @@ static inline int read_line(AVFormatContext *s, char *rbuf, const int rbufsize,
     *rbuflen      = 0;
 
     do {
-        ret = ffurl_read_complete(rt->rtsp_hd, rbuf + idx, 1);
+        ret = ff_rtsp_read_buffered(s, rbuf + idx, 1);
         if (ret <= 0)
             return ret ? ret : AVERROR_EOF;
         if (rbuf[idx] == '\r') {
@@ -185,7 +185,7 @@ static int rtsp_read_announce(AVFormatContext *s)
     }
     if (request.content_length && request.content_length < sizeof(sdp) - 1) {
         /* Read SDP */
-        if (ffurl_read_complete(rt->rtsp_hd, sdp, request.content_length)
+        if (ff_rtsp_read_buffered(s, sdp, request.content_length)
             < request.content_length) {
             av_log(s, AV_LOG_ERROR,
                    "Unable to get complete SDP Description in ANNOUNCE\n");
@@ -731,7 +731,7 @@ redo:
         if (rt->state != RTSP_STATE_STREAMING)
             return 0;
     }
-    ret = ffurl_read_complete(rt->rtsp_hd, buf, 3);
+    ret = ff_rtsp_read_buffered(s, buf, 3);
     if (ret != 3)
         return -1;
     id  = buf[0];
@@ -740,7 +740,7 @@ redo:
     if (len > buf_size || len < 8)
         goto redo;
     /* get the data */
-    ret = ffurl_read_complete(rt->rtsp_hd, buf, len);
+    ret = ff_rtsp_read_buffered(s, buf, len);
     if (ret != len)
         return -1;
     if (rt->transport == RTSP_TRANSPORT_RDT &&
@@ -185,9 +185,14 @@ static int rtsp_write_packet(AVFormatContext *s, AVPacket *pkt)
     int ret;
 
     while (1) {
-        n = poll(&p, 1, 0);
-        if (n <= 0)
-            break;
+        if (rt->tcp_buf_pos < rt->tcp_buf_len) {
+            /* poll() does not see data already in the receive buffer */
+            p.revents = POLLIN;
+        } else {
+            n = poll(&p, 1, 0);
+            if (n <= 0)
+                break;
+        }
         if (p.revents & POLLIN) {
             RTSPMessageHeader reply;
 
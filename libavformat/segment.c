@@ -27,6 +27,9 @@
 /* #define DEBUG */
 
 #include <float.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 #include "avformat.h"
 #include "internal.h"
@@ -88,6 +91,10 @@ typedef struct {
     double start_time, end_time;
     int64_t start_pts, start_dts;
     int is_first_pkt;      ///< tells if it is the first packet in the segment
+
+    int preopen;           ///< open the next segment file in advance
+    AVIOContext *next_pb;  ///< already opened file for the next segment
+    char next_filename[1024]; ///< filename next_pb was opened with
 } SegmentContext;
 
 static void print_csv_escaped_str(AVIOContext *ctx, const char *str)
@@ -156,6 +163,35 @@ static int set_segment_filename(AVFormatContext *s)
     return 0;
 }
 
+static int segment_preopen_next(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    int idx = seg->segment_idx + 1;
+
+    if (seg->segment_idx_wrap)
+        idx %= seg->segment_idx_wrap;
+    if (av_get_frame_filename(seg->next_filename, sizeof(seg->next_filename),
+                              s->filename, idx) < 0)
+        return AVERROR(EINVAL);
+    return avio_open2(&seg->next_pb, seg->next_filename, AVIO_FLAG_WRITE,
+                      &s->interrupt_callback, NULL);
+}
+
+static void segment_close_next(AVFormatContext *s)
+{
+    SegmentContext *seg = s->priv_data;
+    const char *filename = seg->next_filename;
+
+    if (!seg->next_pb)
+        return;
+    avio_close(seg->next_pb);
+    seg->next_pb = NULL;
+    /* remove the empty file opened for a segment which never started */
+    av_strstart(filename, "file:", &filename);
+    if (!strstr(filename, "://"))
+        unlink(filename);
+}
+
 static int segment_start(AVFormatContext *s, int write_header)
 {
     SegmentContext *seg = s->priv_data;
@@ -175,9 +211,15 @@ static int segment_start(AVFormatContext *s, int write_header)
         return err;
     seg->segment_count++;
 
-    if ((err = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
-                          &s->interrupt_callback, NULL)) < 0)
-        return err;
+    if (seg->next_pb && !strcmp(seg->next_filename, oc->filename)) {
+        oc->pb       = seg->next_pb;
+        seg->next_pb = NULL;
+    } else {
+        segment_close_next(s);
+        if ((err = avio_open2(&oc->pb, oc->filename, AVIO_FLAG_WRITE,
+                              &s->interrupt_callback, NULL)) < 0)
+            return err;
+    }
 
     if (oc->oformat->priv_class && oc->priv_data)
         av_opt_set(oc->priv_data, "resend_headers", "1", 0); /* mpegts specific */
@@ -188,6 +230,9 @@ static int segment_start(AVFormatContext *s, int write_header)
     }
 
     seg->is_first_pkt = 1;
+
+    if (seg->preopen)
+        return segment_preopen_next(s);
     return 0;
 }
 
@@ -569,6 +614,9 @@ static int seg_write_header(AVFormatContext *s)
             goto fail;
     }
 
+    if (seg->preopen)
+        ret = segment_preopen_next(s);
+
 fail:
     if (ret) {
         if (seg->list)
@@ -659,6 +707,7 @@ fail:
     if (ret < 0) {
         if (seg->list)
             avio_close(seg->list_pb);
+        segment_close_next(s);
         avformat_free_context(oc);
     }
 
@@ -682,6 +731,7 @@ static int seg_write_trailer(struct AVFormatContext *s)
 fail:
     if (seg->list)
         segment_list_close(s);
+    segment_close_next(s);
 
     av_opt_free(seg);
     av_freep(&seg->times);
@@ -720,6 +770,7 @@ static const AVOption options[] = {
 
     { "individual_header_trailer", "write header/trailer to each segment", OFFSET(individual_header_trailer), AV_OPT_TYPE_INT, {.i64 = 1}, 0, 1, E },
     { "write_header_trailer", "write a header to the first segment and a trailer to the last one", OFFSET(write_header_trailer), AV_OPT_TYPE_INT, {.i64 = 1}, 0, 1, E },
+    { "segment_preopen",   "open the next segment file before the current one ends", OFFSET(preopen), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E },
     { "reset_timestamps", "reset timestamps at the begin of each segment", OFFSET(reset_timestamps), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, E },
     { NULL },
 };
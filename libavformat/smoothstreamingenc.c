@@ -58,6 +58,7 @@ typedef struct {
     const char *stream_type_tag;
     int nb_fragments, fragments_size, fragment_index;
     Fragment **fragments;
+    int nb_cuts;      ///< number of fragments finished, including removed ones
 
     const char *fourcc;
     char *private_str;
@@ -74,7 +75,7 @@ typedef struct {
     int remove_at_exit;
     OutputStream *streams;
     int has_video, has_audio;
-    int nb_fragments;
+    int nb_fragments; ///< number of fragments finished by all streams
 } SmoothStreamingContext;
 
 static int ism_write(void *opaque, uint8_t *buf, int buf_size)
@@ -500,23 +501,20 @@ static int copy_moof(AVFormatContext *s, const char* infile, const char *outfile
     return ret;
 }
 
-static int ism_flush(AVFormatContext *s, int final)
+static int ism_flush_stream(AVFormatContext *s, OutputStream *os, int final)
 {
     SmoothStreamingContext *c = s->priv_data;
-    int i, ret = 0;
+    int ret = 0;
 
-    for (i = 0; i < s->nb_streams; i++) {
-        OutputStream *os = &c->streams[i];
+    if (os->packets_written) {
         char filename[1024], target_filename[1024], header_filename[1024];
         int64_t start_pos = os->tail_pos, size;
         int64_t start_ts, duration, moof_size;
-        if (!os->packets_written)
-            continue;
 
         snprintf(filename, sizeof(filename), "%s/temp", os->dirname);
         ret = ffurl_open(&os->out, filename, AVIO_FLAG_WRITE, &s->interrupt_callback, NULL);
         if (ret < 0)
-            break;
+            return ret;
         os->cur_start_pos = os->tail_pos;
         av_write_frame(os->ctx, NULL);
         avio_flush(os->ctx->pb);
@@ -528,34 +526,43 @@ static int ism_flush(AVFormatContext *s, int final)
         os->out = NULL;
         size = os->tail_pos - start_pos;
         if ((ret = parse_fragment(s, filename, &start_ts, &duration, &moof_size, size)) < 0)
-            break;
+            return ret;
         snprintf(header_filename, sizeof(header_filename), "%s/FragmentInfo(%s=%"PRIu64")", os->dirname, os->stream_type_tag, start_ts);
         snprintf(target_filename, sizeof(target_filename), "%s/Fragments(%s=%"PRIu64")", os->dirname, os->stream_type_tag, start_ts);
         copy_moof(s, filename, header_filename, moof_size);
         rename(filename, target_filename);
         add_fragment(os, target_filename, header_filename, start_ts, duration, start_pos, size);
+        os->nb_cuts++;
     }
 
     if (c->window_size || (final && c->remove_at_exit)) {
-        for (i = 0; i < s->nb_streams; i++) {
-            OutputStream *os = &c->streams[i];
-            int j;
-            int remove = os->nb_fragments - c->window_size - c->extra_window_size - c->lookahead_count;
-            if (final && c->remove_at_exit)
-                remove = os->nb_fragments;
-            if (remove > 0) {
-                for (j = 0; j < remove; j++) {
-                    unlink(os->fragments[j]->file);
-                    unlink(os->fragments[j]->infofile);
-                    av_free(os->fragments[j]);
-                }
-                os->nb_fragments -= remove;
-                memmove(os->fragments, os->fragments + remove, os->nb_fragments * sizeof(*os->fragments));
+        int j;
+        int remove = os->nb_fragments - c->window_size - c->extra_window_size - c->lookahead_count;
+        if (final && c->remove_at_exit)
+            remove = os->nb_fragments;
+        if (remove > 0) {
+            for (j = 0; j < remove; j++) {
+                unlink(os->fragments[j]->file);
+                unlink(os->fragments[j]->infofile);
+                av_free(os->fragments[j]);
             }
-            if (final && c->remove_at_exit)
-                rmdir(os->dirname);
+            os->nb_fragments -= remove;
+            memmove(os->fragments, os->fragments + remove, os->nb_fragments * sizeof(*os->fragments));
         }
+        if (final && c->remove_at_exit)
+            rmdir(os->dirname);
     }
+    return ret;
+}
+
+static int ism_flush(AVFormatContext *s, int final)
+{
+    SmoothStreamingContext *c = s->priv_data;
+    int i, ret = 0;
+
+    for (i = 0; i < s->nb_streams; i++)
+        if ((ret = ism_flush_stream(s, &c->streams[i], final)) < 0)
+            break;
 
     if (ret >= 0)
         ret = write_manifest(s, final);
@@ -567,20 +574,32 @@ static int ism_write_packet(AVFormatContext *s, AVPacket *pkt)
     SmoothStreamingContext *c = s->priv_data;
     AVStream *st = s->streams[pkt->stream_index];
     OutputStream *os = &c->streams[pkt->stream_index];
-    int64_t end_dts = (c->nb_fragments + 1LL) * c->min_frag_duration;
+    int64_t end_dts = (os->nb_cuts + 1LL) * c->min_frag_duration;
     int ret;
 
     if (st->first_dts == AV_NOPTS_VALUE)
         st->first_dts = pkt->dts;
 
-    if ((!c->has_video || st->codec->codec_type == AVMEDIA_TYPE_VIDEO) &&
-        av_compare_ts(pkt->dts - st->first_dts, st->time_base,
+    /* Every stream is cut on its own key frames, so that all video quality
+     * levels of an aligned-GOP encode get the same fragment boundaries,
+     * as required by the shared chunk list in the manifest. */
+    if (av_compare_ts(pkt->dts - st->first_dts, st->time_base,
                       end_dts, AV_TIME_BASE_Q) >= 0 &&
         pkt->flags & AV_PKT_FLAG_KEY && os->packets_written) {
+        int i, nb_fragments = INT_MAX;
 
-        if ((ret = ism_flush(s, 0)) < 0)
+        if ((ret = ism_flush_stream(s, os, 0)) < 0)
             return ret;
-        c->nb_fragments++;
+
+        /* Rewrite the manifest once all streams have finished the fragment */
+        for (i = 0; i < s->nb_streams; i++)
+            if (c->streams[i].nb_cuts || c->streams[i].packets_written)
+                nb_fragments = FFMIN(nb_fragments, c->streams[i].nb_cuts);
+        if (nb_fragments > c->nb_fragments) {
+            c->nb_fragments = nb_fragments;
+            if ((ret = write_manifest(s, 0)) < 0)
+                return ret;
+        }
     }
 
     os->packets_written++;
@@ -35,6 +35,9 @@ typedef struct TCPContext {
     int listen;
     int rw_timeout;
     int listen_timeout;
+    int recv_buffer_size;
+    int send_buffer_size;
+    int tcp_nodelay;
 } TCPContext;
 
 #define OFFSET(x) offsetof(TCPContext, x)
@@ -44,6 +47,9 @@ static const AVOption options[] = {
 {"listen", "listen on port instead of connecting", OFFSET(listen), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, D|E },
 {"timeout", "timeout of socket i/o operations", OFFSET(rw_timeout), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, D|E },
 {"listen_timeout", "connection awaiting timeout", OFFSET(listen_timeout), AV_OPT_TYPE_INT, {.i64 = -1}, -1, INT_MAX, D|E },
+{"send_buffer_size", "socket send buffer size (in bytes)", OFFSET(send_buffer_size), AV_OPT_TYPE_INT, {.i64 = -1}, -1, INT_MAX, D|E },
+{"recv_buffer_size", "socket receive buffer size (in bytes)", OFFSET(recv_buffer_size), AV_OPT_TYPE_INT, {.i64 = -1}, -1, INT_MAX, D|E },
+{"tcp_nodelay", "disable Nagle's algorithm", OFFSET(tcp_nodelay), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, D|E },
 {NULL}
 };
 
@@ -54,6 +60,20 @@ static const AVClass tcp_context_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+static void customize_fd(void *ctx, int fd)
+{
+    TCPContext *s = ctx;
+
+    /* the buffer sizes must be set before connect() or listen() for the
+     * TCP window scale to be negotiated accordingly */
+    if (s->recv_buffer_size > 0)
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &s->recv_buffer_size, sizeof(s->recv_buffer_size));
+    if (s->send_buffer_size > 0)
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &s->send_buffer_size, sizeof(s->send_buffer_size));
+    if (s->tcp_nodelay > 0)
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &s->tcp_nodelay, sizeof(s->tcp_nodelay));
+}
+
 /* return non zero if error */
 static int tcp_open(URLContext *h, const char *uri, int flags)
 {
@@ -63,7 +83,6 @@ static int tcp_open(URLContext *h, const char *uri, int flags)
     const char *p;
     char buf[256];
     int ret;
-    socklen_t optlen;
     char hostname[1024],proto[1024],path[1024];
     char portstr[10];
     h->rw_timeout = 5000000;
@@ -86,6 +105,12 @@ static int tcp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "listen_timeout", p)) {
             s->listen_timeout = strtol(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "send_buffer_size", p))
+            s->send_buffer_size = strtol(buf, NULL, 10);
+        if (av_find_info_tag(buf, sizeof(buf), "recv_buffer_size", p))
+            s->recv_buffer_size = strtol(buf, NULL, 10);
+        if (av_find_info_tag(buf, sizeof(buf), "tcp_nodelay", p))
+            s->tcp_nodelay = strtol(buf, NULL, 10);
     }
     h->rw_timeout = s->rw_timeout;
     hints.ai_family = AF_UNSPEC;
@@ -104,6 +129,22 @@ static int tcp_open(URLContext *h, const char *uri, int flags)
         return AVERROR(EIO);
     }
 
+    if (!s->listen) {
+        ret = ff_connect_parallel(&ai, h->rw_timeout, 3, h, &h->interrupt_callback,
+                                  &fd, customize_fd, s);
+        if (ret < 0) {
+            if (ret != AVERROR_EXIT) {
+                char errbuf[100];
+                av_strerror(ret, errbuf, sizeof(errbuf));
+                av_log(h, AV_LOG_ERROR,
+                       "TCP connection to %s:%d failed: %s\n",
+                       hostname, port, errbuf);
+            }
+            goto fail1;
+        }
+        goto done;
+    }
+
     cur_ai = ai;
 
  restart:
@@ -112,11 +153,12 @@ static int tcp_open(URLContext *h, const char *uri, int flags)
     if (fd < 0)
         goto fail;
 
-    if (s->listen) {
+    {
         int fd1;
         int reuse = 1;
         struct pollfd lp = { fd, POLLIN, 0 };
         setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        customize_fd(s, fd);
         ret = bind(fd, cur_ai->ai_addr, cur_ai->ai_addrlen);
         if (ret) {
             ret = ff_neterrno();
@@ -139,57 +181,11 @@ static int tcp_open(URLContext *h, const char *uri, int flags)
         }
         closesocket(fd);
         fd = fd1;
+        customize_fd(s, fd);
         ff_socket_nonblock(fd, 1);
-    } else {
- redo:
-        ff_socket_nonblock(fd, 1);
-        ret = connect(fd, cur_ai->ai_addr, cur_ai->ai_addrlen);
     }
 
-    if (ret < 0) {
-        struct pollfd p = {fd, POLLOUT, 0};
-        int64_t wait_started;
-        ret = ff_neterrno();
-        if (ret == AVERROR(EINTR)) {
-            if (ff_check_interrupt(&h->interrupt_callback)) {
-                ret = AVERROR_EXIT;
-                goto fail1;
-            }
-            goto redo;
-        }
-        if (ret != AVERROR(EINPROGRESS) &&
-            ret != AVERROR(EAGAIN))
-            goto fail;
-
-        /* wait until we are connected or until abort */
-        wait_started = av_gettime();
-        do {
-            if (ff_check_interrupt(&h->interrupt_callback)) {
-                ret = AVERROR_EXIT;
-                goto fail1;
-            }
-            ret = poll(&p, 1, 100);
-            if (ret > 0)
-                break;
-        } while (!h->rw_timeout || (av_gettime() - wait_started < h->rw_timeout));
-        if (ret <= 0) {
-            ret = AVERROR(ETIMEDOUT);
-            goto fail;
-        }
-        /* test error */
-        optlen = sizeof(ret);
-        if (getsockopt (fd, SOL_SOCKET, SO_ERROR, &ret, &optlen))
-            ret = AVUNERROR(ff_neterrno());
-        if (ret != 0) {
-            char errbuf[100];
-            ret = AVERROR(ret);
-            av_strerror(ret, errbuf, sizeof(errbuf));
-            av_log(h, AV_LOG_ERROR,
-                   "TCP connection to %s:%d failed: %s\n",
-                   hostname, port, errbuf);
-            goto fail;
-        }
-    }
+ done:
     h->is_streamed = 1;
     s->fd = fd;
     freeaddrinfo(ai);
@@ -0,0 +1,452 @@
+/*
+ * Tee pseudo-muxer
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Tee pseudo-muxer: write the same packets to several outputs.
+ *
+ * The filename is a list of slave outputs separated by '|', each one
+ * optionally preceded by a list of options in square brackets:
+ * [f=flv:onfail=ignore]rtmp://host/app/stream|[f=mp4]out.mp4
+ */
+
+#include "libavutil/avstring.h"
+#include "libavutil/opt.h"
+#include "avformat.h"
+#include "internal.h"
+
+#define MAX_SLAVES 16
+
+typedef struct {
+    AVFormatContext *avf;
+    AVBitStreamFilterContext **bsfs; ///< bitstream filter chain of each stream
+    int ignore_failure;              ///< drop this slave instead of failing on errors
+} TeeSlave;
+
+typedef struct TeeContext {
+    const AVClass *class;
+    unsigned nb_slaves;
+    unsigned nb_alive;
+    TeeSlave slaves[MAX_SLAVES];
+} TeeContext;
+
+static const char *const slave_delim     = "|";
+static const char *const slave_opt_delim = ":]";
+
+static const AVClass tee_muxer_class = {
+    .class_name = "Tee muxer",
+    .item_name  = av_default_item_name,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+/**
+ * Split a slave specification into its options and its filename.
+ * The syntax of the options is [key=value:key=value...].
+ */
+static int parse_slave_options(void *log, char *slave,
+                               AVDictionary **options, char **filename)
+{
+    const char *p = slave;
+    char *key, *val;
+    int ret;
+
+    if (*p != '[') {
+        *filename = slave;
+        return 0;
+    }
+    p++;
+    while (*p && *p != ']') {
+        if (!(key = av_get_token(&p, "=:]")))
+            return AVERROR(ENOMEM);
+        if (*p != '=') {
+            av_log(log, AV_LOG_ERROR, "No value for option '%s' in slave '%s'\n",
+                   key, slave);
+            av_free(key);
+            return AVERROR(EINVAL);
+        }
+        p++;
+        if (!(val = av_get_token(&p, slave_opt_delim))) {
+            av_free(key);
+            return AVERROR(ENOMEM);
+        }
+        ret = av_dict_set(options, key, val,
+                          AV_DICT_DONT_STRDUP_KEY | AV_DICT_DONT_STRDUP_VAL);
+        if (ret < 0)
+            return ret;
+        if (*p == ':')
+            p++;
+    }
+    if (*p != ']') {
+        av_log(log, AV_LOG_ERROR, "Unterminated options in slave '%s'\n", slave);
+        return AVERROR(EINVAL);
+    }
+    *filename = (char *)p + 1;
+    return 0;
+}
+
+/**
+ * Build a chain of bitstream filters from a ','-separated list of names.
+ */
+static int parse_bsfs(void *log, const char *bsfs_spec,
+                      AVBitStreamFilterContext **bsfs)
+{
+    char *bsf_name, *buf, *dup, *saveptr = NULL;
+    int ret = 0;
+
+    while (*bsfs)
+        bsfs = &(*bsfs)->next;
+
+    if (!(dup = buf = av_strdup(bsfs_spec)))
+        return AVERROR(ENOMEM);
+
+    while ((bsf_name = av_strtok(buf, ",", &saveptr))) {
+        AVBitStreamFilterContext *bsf = av_bitstream_filter_init(bsf_name);
+
+        if (!bsf) {
+            av_log(log, AV_LOG_ERROR, "Cannot initialize bitstream filter '%s'\n",
+                   bsf_name);
+            ret = AVERROR(EINVAL);
+            break;
+        }
+        *bsfs = bsf;
+        bsfs  = &bsf->next;
+        buf   = NULL;
+    }
+
+    av_free(dup);
+    return ret;
+}
+
+static void close_slave(TeeSlave *tee_slave)
+{
+    AVFormatContext *avf = tee_slave->avf;
+    unsigned i;
+
+    if (!avf)
+        return;
+
+    if (tee_slave->bsfs) {
+        for (i = 0; i < avf->nb_streams; i++) {
+            AVBitStreamFilterContext *bsf = tee_slave->bsfs[i], *next;
+
+            while (bsf) {
+                next = bsf->next;
+                av_bitstream_filter_close(bsf);
+                bsf = next;
+            }
+        }
+        av_freep(&tee_slave->bsfs);
+    }
+    if (!(avf->oformat->flags & AVFMT_NOFILE))
+        avio_close(avf->pb);
+    avf->pb = NULL;
+    avformat_free_context(avf);
+    tee_slave->avf = NULL;
+}
+
+static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
+{
+    AVDictionary *options = NULL;
+    AVDictionaryEntry *entry;
+    AVFormatContext *avf2 = NULL;
+    char *filename, *format = NULL, *onfail = NULL;
+    unsigned i;
+    int ret;
+
+    if ((ret = parse_slave_options(avf, slave, &options, &filename)) < 0)
+        goto end;
+
+#define STEAL_OPTION(option, field) do {                                \
+        if ((entry = av_dict_get(options, option, NULL, 0))) {          \
+            field = entry->value;                                       \
+            entry->value = NULL; /* prevent it from being freed */      \
+            av_dict_set(&options, option, NULL, 0);                     \
+        }                                                               \
+    } while (0)
+
+    STEAL_OPTION("f", format);
+    STEAL_OPTION("onfail", onfail);
+
+    if (onfail) {
+        if (!strcmp(onfail, "ignore")) {
+            tee_slave->ignore_failure = 1;
+        } else if (strcmp(onfail, "abort")) {
+            av_log(avf, AV_LOG_ERROR, "Invalid onfail value '%s', "
+                   "expected 'abort' or 'ignore'\n", onfail);
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+    }
+
+    ret = avformat_alloc_output_context2(&avf2, NULL, format, filename);
+    if (ret < 0)
+        goto end;
+    tee_slave->avf = avf2;
+    av_dict_copy(&avf2->metadata, avf->metadata, 0);
+    avf2->interrupt_callback = avf->interrupt_callback;
+
+    for (i = 0; i < avf->nb_streams; i++) {
+        AVStream *st = avf->streams[i], *st2;
+        AVCodecContext *icodec = st->codec, *ocodec;
+
+        if (!(st2 = avformat_new_stream(avf2, NULL))) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ocodec = st2->codec;
+        st2->id                  = st->id;
+        st2->r_frame_rate        = st->r_frame_rate;
+        st2->time_base           = st->time_base;
+        st2->start_time          = st->start_time;
+        st2->duration            = st->duration;
+        st2->nb_frames           = st->nb_frames;
+        st2->disposition         = st->disposition;
+        st2->sample_aspect_ratio = st->sample_aspect_ratio;
+        st2->avg_frame_rate      = st->avg_frame_rate;
+        av_dict_copy(&st2->metadata, st->metadata, 0);
+        if ((ret = avcodec_copy_context(ocodec, icodec)) < 0)
+            goto end;
+        if (!avf2->oformat->codec_tag ||
+            av_codec_get_id (avf2->oformat->codec_tag, icodec->codec_tag) == ocodec->codec_id ||
+            av_codec_get_tag(avf2->oformat->codec_tag, icodec->codec_id) <= 0) {
+            ocodec->codec_tag = icodec->codec_tag;
+        } else {
+            ocodec->codec_tag = 0;
+        }
+    }
+
+    if (!(avf2->oformat->flags & AVFMT_NOFILE)) {
+        if ((ret = avio_open2(&avf2->pb, filename, AVIO_FLAG_WRITE,
+                              &avf->interrupt_callback, NULL)) < 0) {
+            av_log(avf, AV_LOG_ERROR, "Slave '%s': error opening: %s\n",
+                   slave, av_err2str(ret));
+            goto end;
+        }
+    }
+
+    /* bsfs=name,name applies to all the streams, bsfs/spec=... only to the
+     * streams matching the stream specifier spec */
+    tee_slave->bsfs = av_mallocz(avf2->nb_streams * sizeof(*tee_slave->bsfs));
+    if (!tee_slave->bsfs) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    while ((entry = av_dict_get(options, "bsfs", NULL, AV_DICT_IGNORE_SUFFIX))) {
+        const char *spec = entry->key + strlen("bsfs");
+
+        if (*spec) {
+            if (*spec != '/') {
+                av_log(avf, AV_LOG_ERROR, "Invalid option '%s' in slave '%s'\n",
+                       entry->key, slave);
+                ret = AVERROR(EINVAL);
+                goto end;
+            }
+            spec++;
+        }
+        for (i = 0; i < avf2->nb_streams; i++) {
+            ret = avformat_match_stream_specifier(avf2, avf2->streams[i], spec);
+            if (ret < 0) {
+                av_log(avf, AV_LOG_ERROR, "Invalid stream specifier '%s' in slave '%s'\n",
+                       spec, slave);
+                goto end;
+            }
+            if (ret && (ret = parse_bsfs(avf, entry->value, &tee_slave->bsfs[i])) < 0)
+                goto end;
+        }
+        av_dict_set(&options, entry->key, NULL, 0);
+    }
+
+    if ((ret = avformat_write_header(avf2, &options)) < 0) {
+        av_log(avf, AV_LOG_ERROR, "Slave '%s': error writing header: %s\n",
+               slave, av_err2str(ret));
+        goto end;
+    }
+
+    if ((entry = av_dict_get(options, "", NULL, AV_DICT_IGNORE_SUFFIX))) {
+        av_log(avf, AV_LOG_ERROR, "Unknown option '%s' in slave '%s'\n",
+               entry->key, slave);
+        ret = AVERROR_OPTION_NOT_FOUND;
+        goto end;
+    }
+
+end:
+    av_free(format);
+    av_free(onfail);
+    av_dict_free(&options);
+    return ret;
+}
+
+/**
+ * Drop a slave after an error if it was opened with onfail=ignore.
+ * @return 0 if muxing can go on, err otherwise
+ */
+static int slave_failed(AVFormatContext *avf, unsigned idx, int err)
+{
+    TeeContext *tee = avf->priv_data;
+    TeeSlave *tee_slave = &tee->slaves[idx];
+
+    if (!tee_slave->ignore_failure)
+        return err;
+
+    av_log(avf, AV_LOG_WARNING, "Slave %u failed, dropping it: %s\n",
+           idx, av_err2str(err));
+    close_slave(tee_slave);
+    tee->nb_alive--;
+    return tee->nb_alive ? 0 : err;
+}
+
+static int tee_write_header(AVFormatContext *avf)
+{
+    TeeContext *tee = avf->priv_data;
+    unsigned nb_slaves = 0, i;
+    const char *filename = avf->filename;
+    char *slaves[MAX_SLAVES];
+    int ret;
+
+    while (*filename) {
+        if (nb_slaves == MAX_SLAVES) {
+            av_log(avf, AV_LOG_ERROR, "Maximum %d slave muxers reached.\n",
+                   MAX_SLAVES);
+            ret = AVERROR_PATCHWELCOME;
+            goto fail;
+        }
+        if (!(slaves[nb_slaves++] = av_get_token(&filename, slave_delim))) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        if (*filename)
+            filename++;
+    }
+
+    tee->nb_slaves = nb_slaves;
+    for (i = 0; i < nb_slaves; i++) {
+        if ((ret = open_slave(avf, slaves[i], &tee->slaves[i])) < 0) {
+            if (!tee->slaves[i].ignore_failure)
+                goto fail;
+            av_log(avf, AV_LOG_WARNING, "Slave '%s' could not be opened, "
+                   "ignoring it\n", slaves[i]);
+            close_slave(&tee->slaves[i]);
+        } else {
+            tee->nb_alive++;
+        }
+        av_freep(&slaves[i]);
+    }
+    if (!tee->nb_alive) {
+        av_log(avf, AV_LOG_ERROR, "No slave could be opened\n");
+        return AVERROR(EINVAL);
+    }
+    return 0;
+
+fail:
+    for (i = 0; i < nb_slaves; i++) {
+        av_freep(&slaves[i]);
+        close_slave(&tee->slaves[i]);
+    }
+    tee->nb_alive = 0;
+    return ret;
+}
+
+static int write_slave_packet(AVFormatContext *avf, TeeSlave *tee_slave,
+                              AVPacket *pkt)
+{
+    AVFormatContext *avf2 = tee_slave->avf;
+    AVCodecContext *codec = avf2->streams[pkt->stream_index]->codec;
+    AVBitStreamFilterContext *bsf = tee_slave->bsfs[pkt->stream_index];
+    AVPacket pkt2 = *pkt;
+    uint8_t *buf = NULL;
+    int ret;
+
+    for (; bsf; bsf = bsf->next) {
+        uint8_t *data;
+        int size;
+
+        ret = av_bitstream_filter_filter(bsf, codec, NULL, &data, &size,
+                                         pkt2.data, pkt2.size,
+                                         pkt2.flags & AV_PKT_FLAG_KEY);
+        if (ret < 0) {
+            av_log(avf, AV_LOG_ERROR, "Bitstream filter %s failed for stream %d\n",
+                   bsf->filter->name, pkt->stream_index);
+            av_free(buf);
+            return ret;
+        }
+        /* a positive return means data is a new buffer we have to free */
+        if (ret > 0) {
+            av_free(buf);
+            buf = data;
+        }
+        pkt2.data = data;
+        pkt2.size = size;
+    }
+
+    ret = ff_write_chained(avf2, pkt->stream_index, &pkt2, avf);
+    av_free(buf);
+    return ret;
+}
+
+static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
+{
+    TeeContext *tee = avf->priv_data;
+    unsigned i;
+    int ret;
+
+    for (i = 0; i < tee->nb_slaves; i++) {
+        if (!tee->slaves[i].avf)
+            continue;
+        if ((ret = write_slave_packet(avf, &tee->slaves[i], pkt)) < 0 &&
+            (ret = slave_failed(avf, i, ret)) < 0)
+            return ret;
+    }
+    return 0;
+}
+
+static int tee_write_trailer(AVFormatContext *avf)
+{
+    TeeContext *tee = avf->priv_data;
+    unsigned i;
+    int ret, ret_all = 0;
+
+    for (i = 0; i < tee->nb_slaves; i++) {
+        TeeSlave *tee_slave = &tee->slaves[i];
+
+        if (!tee_slave->avf)
+            continue;
+        if ((ret = av_write_trailer(tee_slave->avf)) < 0) {
+            if (tee_slave->ignore_failure)
+                av_log(avf, AV_LOG_WARNING, "Slave %u: error writing trailer: %s\n",
+                       i, av_err2str(ret));
+            else if (!ret_all)
+                ret_all = ret;
+        }
+        close_slave(tee_slave);
+    }
+    tee->nb_alive = 0;
+    return ret_all;
+}
+
+AVOutputFormat ff_tee_muxer = {
+    .name              = "tee",
+    .long_name         = NULL_IF_CONFIG_SMALL("Multiple muxer tee"),
+    .priv_data_size    = sizeof(TeeContext),
+    .write_header      = tee_write_header,
+    .write_packet      = tee_write_packet,
+    .write_trailer     = tee_write_trailer,
+    .priv_class        = &tee_muxer_class,
+    .flags             = AVFMT_NOFILE,
+};
@@ -25,6 +25,7 @@
  */
 
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() */
 
 #include "avformat.h"
 #include "avio_internal.h"
@@ -34,6 +35,7 @@
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
 #include "libavutil/log.h"
+#include "libavutil/time.h"
 #include "internal.h"
 #include "network.h"
 #include "os_support.h"
@@ -47,6 +49,11 @@
 #define HAVE_PTHREAD_CANCEL 0
 #endif
 
+#if !HAVE_PTHREAD_CANCEL
+#undef HAVE_RECVMMSG
+#define HAVE_RECVMMSG 0
+#endif
+
 #ifndef IPV6_ADD_MEMBERSHIP
 #define IPV6_ADD_MEMBERSHIP IPV6_JOIN_GROUP
 #define IPV6_DROP_MEMBERSHIP IPV6_LEAVE_GROUP
@@ -78,6 +85,16 @@ typedef struct {
     pthread_cond_t cond;
     int thread_started;
 #endif
+#if HAVE_RECVMMSG
+    struct mmsghdr *mmsg;
+    struct iovec *iov;
+    uint8_t *mmsg_buf;
+#endif
+    int recv_batch;
+    int64_t bitrate;
+    int64_t burst_bits;
+    int64_t pace_start;     /* time the bits in pace_bits started to be sent */
+    int64_t pace_bits;
     uint8_t tmp[UDP_MAX_PKT_SIZE+4];
     int remaining_in_dg;
     char *local_addr;
@@ -100,6 +117,9 @@ static const AVOption options[] = {
 {"fifo_size", "Set the UDP receiving circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D },
 {"overrun_nonfatal", "Survive in case of UDP receiving circular buffer overrun", OFFSET(overrun_nonfatal), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 1, D },
 {"timeout", "In read mode: if no data arrived in more than this time interval, raise error", OFFSET(timeout), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, D },
+{"bitrate", "Bits to send per second, 0 for no pacing", OFFSET(bitrate), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, E },
+{"burst_bits", "Maximum number of bits sent ahead of the bitrate", OFFSET(burst_bits), AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, E },
+{"recv_batch", "Maximum number of datagrams received with a single system call", OFFSET(recv_batch), AV_OPT_TYPE_INT, {.i64 = 16}, 1, 1024, D },
 {NULL}
 };
 
@@ -434,6 +454,33 @@ static int udp_get_file_handle(URLContext *h)
     return s->udp_fd;
 }
 
+#if HAVE_RECVMMSG
+static int alloc_recv_batch(UDPContext *s)
+{
+    int i;
+
+    s->mmsg     = av_mallocz(s->recv_batch * sizeof(*s->mmsg));
+    s->iov      = av_mallocz(s->recv_batch * sizeof(*s->iov));
+    s->mmsg_buf = av_malloc(s->recv_batch * UDP_MAX_PKT_SIZE);
+    if (!s->mmsg || !s->iov || !s->mmsg_buf)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < s->recv_batch; i++) {
+        s->iov[i].iov_base             = s->mmsg_buf + i * UDP_MAX_PKT_SIZE;
+        s->iov[i].iov_len              = UDP_MAX_PKT_SIZE;
+        s->mmsg[i].msg_hdr.msg_iov    = &s->iov[i];
+        s->mmsg[i].msg_hdr.msg_iovlen = 1;
+    }
+    return 0;
+}
+
+static void free_recv_batch(UDPContext *s)
+{
+    av_freep(&s->mmsg);
+    av_freep(&s->iov);
+    av_freep(&s->mmsg_buf);
+}
+#endif
+
 #if HAVE_PTHREAD_CANCEL
 static void *circular_buffer_task( void *_URLContext)
 {
@@ -449,13 +496,20 @@ static void *circular_buffer_task( void *_URLContext)
         goto end;
     }
     while(1) {
-        int len;
+        int len, i, n = 1;
 
         pthread_mutex_unlock(&s->mutex);
         /* Blocking operations are always cancellation points;
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
+#if HAVE_RECVMMSG
+        /* wait for one datagram, then take everything already queued
+           in the socket buffer with the same call */
+        if (s->mmsg)
+            len = n = recvmmsg(s->udp_fd, s->mmsg, s->recv_batch, MSG_WAITFORONE, NULL);
+        else
+#endif
         len = recv(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
         pthread_mutex_lock(&s->mutex);
@@ -466,23 +520,33 @@ static void *circular_buffer_task( void *_URLContext)
             }
             continue;
         }
-        AV_WL32(s->tmp, len);
 
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
-                continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
+        for (i = 0; i < n; i++) {
+            uint8_t *data = s->tmp + 4;
+#if HAVE_RECVMMSG
+            if (s->mmsg) {
+                len  = s->mmsg[i].msg_len;
+                data = s->iov[i].iov_base;
             }
+#endif
+            if(av_fifo_space(s->fifo) < len + 4) {
+                /* No Space left */
+                if (s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    s->circular_buffer_error = AVERROR(EIO);
+                    goto end;
+                }
+            }
+            AV_WL32(s->tmp, len);
+            av_fifo_generic_write(s->fifo, s->tmp, 4, NULL);
+            av_fifo_generic_write(s->fifo, data, len, NULL);
         }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
         pthread_cond_signal(&s->cond);
     }
 
@@ -558,6 +622,15 @@ static int udp_open(URLContext *h, const char *uri, int flags)
                        "'circular_buffer_size' option was set but it is not supported "
                        "on this build (pthread support is required)\n");
         }
+        if (av_find_info_tag(buf, sizeof(buf), "bitrate", p)) {
+            s->bitrate = strtoll(buf, NULL, 10);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "burst_bits", p)) {
+            s->burst_bits = strtoll(buf, NULL, 10);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "recv_batch", p)) {
+            s->recv_batch = av_clip(strtol(buf, NULL, 10), 1, 1024);
+        }
         if (av_find_info_tag(buf, sizeof(buf), "localaddr", p)) {
             av_strlcpy(localaddr, buf, sizeof(localaddr));
         }
@@ -696,6 +769,13 @@ static int udp_open(URLContext *h, const char *uri, int flags)
 
         /* start the task going */
         s->fifo = av_fifo_alloc(s->circular_buffer_size);
+#if HAVE_RECVMMSG
+        if (s->recv_batch > 1 && alloc_recv_batch(s) < 0) {
+            av_log(h, AV_LOG_WARNING, "Cannot allocate the receive batch, "
+                   "falling back to one datagram per call\n");
+            free_recv_batch(s);
+        }
+#endif
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -726,6 +806,9 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_free(s->fifo);
+#if HAVE_RECVMMSG
+    free_recv_batch(s);
+#endif
     for (i = 0; i < num_sources; i++)
         av_freep(&sources[i]);
     return AVERROR(EIO);
@@ -790,11 +873,35 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     return ret < 0 ? ff_neterrno() : ret;
 }
 
+/* wait until size bytes may be sent without exceeding the bitrate */
+static int udp_pace(URLContext *h, int size)
+{
+    UDPContext *s = h->priv_data;
+    int64_t now   = av_gettime();
+    int64_t burst = av_rescale(s->burst_bits, 1000000, s->bitrate);
+    int64_t ideal = s->pace_start + av_rescale(s->pace_bits, 1000000, s->bitrate);
+
+    if (!s->pace_start || ideal < now - burst) {
+        /* first packet, or late by more than a burst: do not catch up */
+        s->pace_start = now;
+        s->pace_bits  = 0;
+    } else if (ideal - burst > now) {
+        if (h->flags & AVIO_FLAG_NONBLOCK)
+            return AVERROR(EAGAIN);
+        av_usleep(ideal - burst - now);
+    }
+    s->pace_bits += size * 8;
+    return 0;
+}
+
 static int udp_write(URLContext *h, const uint8_t *buf, int size)
 {
     UDPContext *s = h->priv_data;
     int ret;
 
+    if (s->bitrate && (ret = udp_pace(h, size)) < 0)
+        return ret;
+
     if (!(h->flags & AVIO_FLAG_NONBLOCK)) {
         ret = ff_network_wait_fd(s->udp_fd, 1);
         if (ret < 0)
@@ -828,6 +935,9 @@ static int udp_close(URLContext *h)
         pthread_mutex_destroy(&s->mutex);
         pthread_cond_destroy(&s->cond);
     }
+#endif
+#if HAVE_RECVMMSG
+    free_recv_batch(s);
 #endif
     av_fifo_free(s->fifo);
     return 0;
@@ -28,6 +28,7 @@
 #include "avio.h"
 #include "libavformat/version.h"
 
+#include "libavutil/buffer.h"
 #include "libavutil/dict.h"
 #include "libavutil/log.h"
 
@@ -49,6 +50,7 @@ typedef struct URLContext {
     int is_connected;
     AVIOInterruptCB interrupt_callback;
     int64_t rw_timeout;         /**< maximum time to wait for (network) read/write operation completion, in mcs */
+    int io_buffer_size;         /**< if non zero and not packetized, size of the buffer of AVIOContexts using this URLContext */
 } URLContext;
 
 typedef struct URLProtocol {
@@ -89,6 +91,13 @@ typedef struct URLProtocol {
     const AVClass *priv_data_class;
     int flags;
     int (*url_check)(URLContext *h, int mask);
+    /**
+     * Get the size bytes at offset pos of the resource without copying
+     * them, if the protocol has them in memory. At least
+     * FF_INPUT_BUFFER_PADDING_SIZE readable bytes must follow the data.
+     */
+    int (*url_get_mapped)(URLContext *h, int64_t pos, int size,
+                          AVBufferRef **buf, uint8_t **data);
 } URLProtocol;
 
 /**
@@ -212,6 +221,17 @@ int ffurl_get_file_handle(URLContext *h);
  */
 int ffurl_get_multi_file_handle(URLContext *h, int **handles, int *numhandles);
 
+/**
+ * Get a reference to size bytes at offset pos of the resource, for
+ * protocols that keep it mapped in memory.
+ *
+ * @param buf  set to a new reference to the memory containing the data
+ * @param data set to the first byte of the data
+ * @return 0 on success, a negative value if the data cannot be mapped
+ */
+int ffurl_get_mapped(URLContext *h, int64_t pos, int size,
+                     AVBufferRef **buf, uint8_t **data);
+
 /**
  * Signal the URLContext that we are done reading or writing the stream.
  *
@@ -35,6 +35,7 @@
 #include "id3v2.h"
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/time.h"
@@ -46,6 +47,10 @@
 #if CONFIG_NETWORK
 #include "network.h"
 #endif
+#if HAVE_PTHREADS
+#include <pthread.h>
+#include "libavutil/cpu.h"
+#endif
 
 #undef NDEBUG
 #include <assert.h>
@@ -103,6 +108,9 @@ static int64_t wrap_timestamp(AVStream *st, int64_t timestamp)
 static AVInputFormat *first_iformat = NULL;
 /** head of registered output format linked list */
 static AVOutputFormat *first_oformat = NULL;
+/** tails of the above lists, so that registering is O(1) */
+static AVInputFormat  **last_iformat = &first_iformat;
+static AVOutputFormat **last_oformat = &first_oformat;
 
 AVInputFormat  *av_iformat_next(AVInputFormat  *f)
 {
@@ -118,20 +126,16 @@ AVOutputFormat *av_oformat_next(AVOutputFormat *f)
 
 void av_register_input_format(AVInputFormat *format)
 {
-    AVInputFormat **p;
-    p = &first_iformat;
-    while (*p != NULL) p = &(*p)->next;
-    *p = format;
-    format->next = NULL;
+    *last_iformat = format;
+    last_iformat  = &format->next;
+    format->next  = NULL;
 }
 
 void av_register_output_format(AVOutputFormat *format)
 {
-    AVOutputFormat **p;
-    p = &first_oformat;
-    while (*p != NULL) p = &(*p)->next;
-    *p = format;
-    format->next = NULL;
+    *last_oformat = format;
+    last_oformat  = &format->next;
+    format->next  = NULL;
 }
 
 int av_match_ext(const char *filename, const char *extensions)
@@ -271,6 +275,12 @@ int av_get_packet(AVIOContext *s, AVPacket *pkt, int size)
     int orig_size = size;
     size= ffio_limit(s, size);
 
+    if (ffio_read_mapped(s, pkt, size) >= 0) {
+        if (size < orig_size)
+            pkt->flags |= AV_PKT_FLAG_CORRUPT;
+        return size;
+    }
+
     ret= av_new_packet(pkt, size);
 
     if(ret<0)
@@ -901,6 +911,8 @@ static int has_decode_delay_been_guessed(AVStream *st)
     if(st->codec->codec_id != AV_CODEC_ID_H264) return 1;
     if(!st->info) // if we have left find_stream_info then nb_decoded_frames wont increase anymore for stream copy
         return 1;
+    if (st->info->params_loaded)
+        return 1;
 #if CONFIG_H264_DECODER
     if(st->codec->has_b_frames &&
        avpriv_h264_has_num_reorder_frames(st->codec) == st->codec->has_b_frames)
@@ -1324,6 +1336,7 @@ static int parse_packet(AVFormatContext *s, AVPacket *pkt, int stream_index)
 
         if (out_pkt.data == pkt->data && out_pkt.size == pkt->size) {
             out_pkt.destruct = pkt->destruct;
+            out_pkt.priv     = pkt->priv;
             pkt->destruct = NULL;
         }
         if ((ret = av_dup_packet(&out_pkt)) < 0)
@@ -1468,6 +1481,17 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
     return ret;
 }
 
+/**
+ * Return 1 if packets of the stream can be arbitrarily far apart, so that
+ * waiting for the next one may mean buffering the whole of the other streams.
+ */
+static int is_sparse_stream(AVStream *st)
+{
+    return st->codec->codec_type == AVMEDIA_TYPE_SUBTITLE ||
+           st->codec->codec_type == AVMEDIA_TYPE_DATA     ||
+           st->codec->codec_type == AVMEDIA_TYPE_ATTACHMENT;
+}
+
 int av_read_frame(AVFormatContext *s, AVPacket *pkt)
 {
     const int genpts = s->flags & AVFMT_FLAG_GENPTS;
@@ -1490,6 +1514,12 @@ int av_read_frame(AVFormatContext *s, AVPacket *pkt)
         if (pktl) {
             AVPacket *next_pkt = &pktl->pkt;
 
+            /* sparse streams are not reordered, and their next packet may be
+             * minutes away, so do not buffer everything until it arrives */
+            if (next_pkt->pts == AV_NOPTS_VALUE &&
+                is_sparse_stream(s->streams[next_pkt->stream_index]))
+                next_pkt->pts = next_pkt->dts;
+
             if (next_pkt->dts != AV_NOPTS_VALUE) {
                 int wrap_bits = s->streams[next_pkt->stream_index]->pts_wrap_bits;
                 // last dts seen for this stream. if any of packets following
@@ -1759,7 +1789,10 @@ int av_index_search_timestamp(AVStream *st, int64_t wanted_timestamp,
 static int64_t ff_read_timestamp(AVFormatContext *s, int stream_index, int64_t *ppos, int64_t pos_limit,
                                  int64_t (*read_timestamp)(struct AVFormatContext *, int , int64_t *, int64_t ))
 {
-    return wrap_timestamp(s->streams[stream_index], read_timestamp(s, stream_index, ppos, pos_limit));
+    int64_t ts = read_timestamp(s, stream_index, ppos, pos_limit);
+    if (stream_index >= 0)
+        ts = wrap_timestamp(s->streams[stream_index], ts);
+    return ts;
 }
 
 int ff_seek_frame_binary(AVFormatContext *s, int stream_index, int64_t target_ts, int flags)
@@ -2470,28 +2503,25 @@ static int has_codec_parameters(AVStream *st, const char **errmsg_ptr)
     return 1;
 }
 
-/* returns 1 or 0 if or if not decoded data was returned, or a negative error */
-static int try_decode_frame(AVStream *st, AVPacket *avpkt, AVDictionary **options)
+/**
+ * Open the decoder of st for avformat_find_stream_info(), if not done yet.
+ *
+ * @return 1 if the decoder is open, -1 if no decoder could be opened
+ */
+static int open_info_decoder(AVStream *st, AVDictionary **options)
 {
     const AVCodec *codec;
-    int got_picture = 1, ret = 0;
-    AVFrame *frame = avcodec_alloc_frame();
-    AVSubtitle subtitle;
-    AVPacket pkt = *avpkt;
-
-    if (!frame)
-        return AVERROR(ENOMEM);
 
     if (!avcodec_is_open(st->codec) && !st->info->found_decoder) {
         AVDictionary *thread_opt = NULL;
+        int ret;
 
         codec = st->codec->codec ? st->codec->codec :
                                    avcodec_find_decoder(st->codec->codec_id);
 
         if (!codec) {
             st->info->found_decoder = -1;
-            ret = -1;
-            goto fail;
+            return -1;
         }
 
         /* force thread count to 1 since the h264 decoder will not extract SPS
@@ -2502,12 +2532,34 @@ static int try_decode_frame(AVStream *st, AVPacket *avpkt, AVDictionary **option
             av_dict_free(&thread_opt);
         if (ret < 0) {
             st->info->found_decoder = -1;
-            goto fail;
+            return -1;
         }
         st->info->found_decoder = 1;
     } else if (!st->info->found_decoder)
         st->info->found_decoder = 1;
 
+    return st->info->found_decoder;
+}
+
+/**
+ * Decode avpkt until the codec parameters of st are known.
+ *
+ * @param nb_frames number of frames of the stream analyzed before avpkt
+ * @return 1 or 0 if or if not decoded data was returned, or a negative error
+ */
+static int try_decode_frame(AVStream *st, AVPacket *avpkt, AVDictionary **options,
+                            int nb_frames)
+{
+    int got_picture = 1, ret = 0;
+    AVFrame *frame = avcodec_alloc_frame();
+    AVSubtitle subtitle;
+    AVPacket pkt = *avpkt;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+
+    open_info_decoder(st, options);
+
     if (st->info->found_decoder < 0) {
         ret = -1;
         goto fail;
@@ -2517,7 +2569,7 @@ static int try_decode_frame(AVStream *st, AVPacket *avpkt, AVDictionary **option
            ret >= 0 &&
            (!has_codec_parameters(st, NULL)   ||
            !has_decode_delay_been_guessed(st) ||
-           (!st->codec_info_nb_frames && st->codec->codec->capabilities & CODEC_CAP_CHANNEL_CONF))) {
+           (!nb_frames && st->codec->codec->capabilities & CODEC_CAP_CHANNEL_CONF))) {
         got_picture = 0;
         avcodec_get_frame_defaults(frame);
         switch(st->codec->codec_type) {
@@ -2682,6 +2734,391 @@ int av_find_stream_info(AVFormatContext *ic)
 }
 #endif
 
+enum StreamInfoType {
+    STREAM_INFO_INT,
+    STREAM_INFO_INT64,
+    STREAM_INFO_RATIONAL,
+};
+
+typedef struct StreamInfoField {
+    const char *name;
+    enum StreamInfoType type;
+    int in_codec; ///< 1 for AVCodecContext fields, 0 for AVStream fields
+    size_t offset;
+} StreamInfoField;
+
+#define CODEC_FIELD(name, type, field)  { name, STREAM_INFO_ ## type, 1, offsetof(AVCodecContext, field) }
+#define STREAM_FIELD(name, type, field) { name, STREAM_INFO_ ## type, 0, offsetof(AVStream, field) }
+
+/* parameters saved by avformat_save_stream_info(), the codec type and id
+ * have to come first */
+static const StreamInfoField stream_info_fields[] = {
+    CODEC_FIELD("codec_type",            INT,      codec_type),
+    CODEC_FIELD("codec_id",              INT,      codec_id),
+    CODEC_FIELD("codec_tag",             INT,      codec_tag),
+    CODEC_FIELD("bit_rate",              INT,      bit_rate),
+    CODEC_FIELD("profile",               INT,      profile),
+    CODEC_FIELD("level",                 INT,      level),
+    CODEC_FIELD("time_base",             RATIONAL, time_base),
+    CODEC_FIELD("ticks_per_frame",       INT,      ticks_per_frame),
+    CODEC_FIELD("width",                 INT,      width),
+    CODEC_FIELD("height",                INT,      height),
+    CODEC_FIELD("pix_fmt",               INT,      pix_fmt),
+    CODEC_FIELD("has_b_frames",          INT,      has_b_frames),
+    CODEC_FIELD("sample_aspect_ratio",   RATIONAL, sample_aspect_ratio),
+    CODEC_FIELD("sample_rate",           INT,      sample_rate),
+    CODEC_FIELD("channels",              INT,      channels),
+    CODEC_FIELD("channel_layout",        INT64,    channel_layout),
+    CODEC_FIELD("sample_fmt",            INT,      sample_fmt),
+    CODEC_FIELD("frame_size",            INT,      frame_size),
+    CODEC_FIELD("block_align",           INT,      block_align),
+    CODEC_FIELD("bits_per_coded_sample", INT,      bits_per_coded_sample),
+#if FF_API_R_FRAME_RATE
+    STREAM_FIELD("r_frame_rate",         RATIONAL, r_frame_rate),
+#endif
+    STREAM_FIELD("avg_frame_rate",       RATIONAL, avg_frame_rate),
+    STREAM_FIELD("stream_sar",           RATIONAL, sample_aspect_ratio),
+};
+
+int avformat_save_stream_info(AVFormatContext *ic, char **info)
+{
+    AVBPrint bp;
+    int i, j;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    for (i = 0; i < ic->nb_streams; i++) {
+        AVStream *st = ic->streams[i];
+
+        av_bprintf(&bp, "index=%d:id=%d", st->index, st->id);
+        for (j = 0; j < FF_ARRAY_ELEMS(stream_info_fields); j++) {
+            const StreamInfoField *f = &stream_info_fields[j];
+            uint8_t *ptr = (uint8_t *)(f->in_codec ? (void *)st->codec : (void *)st) + f->offset;
+
+            switch (f->type) {
+            case STREAM_INFO_INT:
+                av_bprintf(&bp, ":%s=%d", f->name, *(int *)ptr);
+                break;
+            case STREAM_INFO_INT64:
+                av_bprintf(&bp, ":%s=%"PRId64, f->name, *(int64_t *)ptr);
+                break;
+            case STREAM_INFO_RATIONAL:
+                av_bprintf(&bp, ":%s=%d/%d", f->name,
+                           ((AVRational *)ptr)->num, ((AVRational *)ptr)->den);
+                break;
+            }
+        }
+        if (st->codec->extradata_size) {
+            char hex[65];
+
+            av_bprintf(&bp, ":extradata=");
+            for (j = 0; j < st->codec->extradata_size; j += 32) {
+                int len = FFMIN(32, st->codec->extradata_size - j);
+                ff_data_to_hex(hex, st->codec->extradata + j, len, 1);
+                hex[2 * len] = 0;
+                av_bprintf(&bp, "%s", hex);
+            }
+        }
+        av_bprintf(&bp, "\n");
+    }
+
+    if (!av_bprint_is_complete(&bp)) {
+        av_bprint_finalize(&bp, NULL);
+        return AVERROR(ENOMEM);
+    }
+    return av_bprint_finalize(&bp, info);
+}
+
+static void free_stream_info(AVFormatContext *ic)
+{
+    int i;
+
+    for (i = 0; i < ic->nb_stream_info; i++)
+        av_free(ic->stream_info[i]);
+    av_freep(&ic->stream_info);
+    ic->nb_stream_info = 0;
+}
+
+/* returns the value of key in a saved stream description, or NULL */
+static const char *get_stream_info_value(const char *line, const char *key)
+{
+    int len = strlen(key);
+
+    while ((line = strchr(line, ':'))) {
+        line++;
+        if (!strncmp(line, key, len) && line[len] == '=')
+            return line + len + 1;
+    }
+    return NULL;
+}
+
+static int set_stream_info(AVStream *st, const char *line)
+{
+    AVCodecContext *avctx = st->codec;
+    const char *val;
+    int i, type, id;
+
+    if (!(val = get_stream_info_value(line, "codec_type")) ||
+        sscanf(val, "%d", &type) != 1 ||
+        !(val = get_stream_info_value(line, "codec_id")) ||
+        sscanf(val, "%d", &id) != 1)
+        return AVERROR_INVALIDDATA;
+    /* the source changed since the parameters were saved */
+    if ((avctx->codec_type != AVMEDIA_TYPE_UNKNOWN && avctx->codec_type != type) ||
+        (avctx->codec_id   != AV_CODEC_ID_NONE     && avctx->codec_id   != id))
+        return AVERROR_INVALIDDATA;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(stream_info_fields); i++) {
+        const StreamInfoField *f = &stream_info_fields[i];
+        uint8_t *ptr = (uint8_t *)(f->in_codec ? (void *)avctx : (void *)st) + f->offset;
+
+        if (!(val = get_stream_info_value(line, f->name)))
+            continue;
+        switch (f->type) {
+        case STREAM_INFO_INT:
+            *(int *)ptr = strtol(val, NULL, 10);
+            break;
+        case STREAM_INFO_INT64:
+            *(int64_t *)ptr = strtoll(val, NULL, 10);
+            break;
+        case STREAM_INFO_RATIONAL:
+            sscanf(val, "%d/%d", &((AVRational *)ptr)->num, &((AVRational *)ptr)->den);
+            break;
+        }
+    }
+
+    if (!avctx->extradata && (val = get_stream_info_value(line, "extradata"))) {
+        int size = ff_hex_to_data(NULL, val);
+        avctx->extradata = av_mallocz(size + FF_INPUT_BUFFER_PADDING_SIZE);
+        if (!avctx->extradata)
+            return AVERROR(ENOMEM);
+        avctx->extradata_size = ff_hex_to_data(avctx->extradata, val);
+    }
+
+    st->request_probe         = 0;
+    st->info->params_loaded   = 1;
+    return 0;
+}
+
+/* applies the saved parameters matching st, if any */
+static void apply_stream_info(AVFormatContext *ic, AVStream *st)
+{
+    int i;
+
+    if (!st->info || st->info->params_loaded)
+        return;
+
+    for (i = 0; i < ic->nb_stream_info; i++) {
+        int index, id;
+
+        if (!ic->stream_info[i] ||
+            sscanf(ic->stream_info[i], "index=%d:id=%d", &index, &id) != 2 ||
+            index != st->index || id != st->id)
+            continue;
+        if (set_stream_info(st, ic->stream_info[i]) < 0)
+            av_log(ic, AV_LOG_VERBOSE, "Ignoring saved parameters of stream %d\n",
+                   st->index);
+        av_freep(&ic->stream_info[i]);
+        return;
+    }
+}
+
+/* returns 1 if all saved streams have been found */
+static int stream_info_complete(AVFormatContext *ic)
+{
+    int i;
+
+    for (i = 0; i < ic->nb_stream_info; i++)
+        if (ic->stream_info[i])
+            return 0;
+    return ic->nb_stream_info > 0;
+}
+
+int avformat_load_stream_info(AVFormatContext *ic, const char *info)
+{
+    char *buf, *line, *saveptr = NULL;
+    int i, ret = 0;
+
+    free_stream_info(ic);
+    if (!(buf = av_strdup(info)))
+        return AVERROR(ENOMEM);
+
+    for (line = av_strtok(buf, "\n", &saveptr); line;
+         line = av_strtok(NULL, "\n", &saveptr)) {
+        char *copy = av_strdup(line);
+        if (!copy) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+        dynarray_add(&ic->stream_info, &ic->nb_stream_info, copy);
+    }
+    av_free(buf);
+    if (ret < 0) {
+        free_stream_info(ic);
+        return ret;
+    }
+
+    for (i = 0; i < ic->nb_streams; i++)
+        apply_stream_info(ic, ic->streams[i]);
+    return 0;
+}
+
+#if HAVE_PTHREADS
+typedef struct InfoDecodeJob {
+    AVStream *st;
+    AVPacket *pkt;
+    AVDictionary **options;
+    int nb_frames;
+} InfoDecodeJob;
+
+/**
+ * Threads decoding the packets read by avformat_find_stream_info().
+ *
+ * Packets are queued in batches. While a batch is decoded, the calling
+ * thread waits, so that the codec contexts are never accessed by both the
+ * demuxing code and a decoding thread. Inside a batch, the packets of one
+ * stream are decoded in order by a single thread.
+ */
+typedef struct InfoDecodeThreads {
+    pthread_t *threads;
+    int nb_threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    InfoDecodeJob *jobs;
+    unsigned int jobs_size;
+    int nb_jobs;
+    int max_jobs;
+    int nb_streams;  ///< number of streams in the current batch
+    int next_stream; ///< index of the next stream to be claimed by a thread
+    int nb_done;     ///< number of streams of the current batch decoded
+    int quit;
+} InfoDecodeThreads;
+
+static void *info_decode_thread(void *arg)
+{
+    InfoDecodeThreads *t = arg;
+
+    pthread_mutex_lock(&t->mutex);
+    for (;;) {
+        int i, index;
+
+        while (!t->quit && t->next_stream >= t->nb_streams)
+            pthread_cond_wait(&t->work_cond, &t->mutex);
+        if (t->quit)
+            break;
+        index = t->next_stream++;
+        pthread_mutex_unlock(&t->mutex);
+
+        for (i = 0; i < t->nb_jobs; i++) {
+            InfoDecodeJob *job = &t->jobs[i];
+            if (job->st->index == index)
+                try_decode_frame(job->st, job->pkt, job->options, job->nb_frames);
+        }
+
+        pthread_mutex_lock(&t->mutex);
+        if (++t->nb_done == t->nb_streams)
+            pthread_cond_signal(&t->done_cond);
+    }
+    pthread_mutex_unlock(&t->mutex);
+
+    return NULL;
+}
+
+static void info_decode_uninit(InfoDecodeThreads *t)
+{
+    int i;
+
+    if (!t->nb_threads)
+        return;
+
+    pthread_mutex_lock(&t->mutex);
+    t->quit = 1;
+    pthread_cond_broadcast(&t->work_cond);
+    pthread_mutex_unlock(&t->mutex);
+    for (i = 0; i < t->nb_threads; i++)
+        pthread_join(t->threads[i], NULL);
+
+    pthread_cond_destroy(&t->done_cond);
+    pthread_cond_destroy(&t->work_cond);
+    pthread_mutex_destroy(&t->mutex);
+    av_freep(&t->threads);
+    av_freep(&t->jobs);
+    t->nb_threads = 0;
+}
+
+/* starts the threads, on failure the packets are decoded by the caller */
+static void info_decode_init(AVFormatContext *ic, InfoDecodeThreads *t)
+{
+    int nb_threads = ic->info_threads ? ic->info_threads
+                                      : FFMIN(av_cpu_count(), 16);
+
+    memset(t, 0, sizeof(*t));
+    if (nb_threads <= 1 || ic->flags & AVFMT_FLAG_NOBUFFER)
+        return;
+
+    t->threads = av_mallocz(nb_threads * sizeof(*t->threads));
+    if (!t->threads)
+        return;
+    t->max_jobs = 16 * nb_threads;
+
+    pthread_mutex_init(&t->mutex, NULL);
+    pthread_cond_init(&t->work_cond, NULL);
+    pthread_cond_init(&t->done_cond, NULL);
+    for (t->nb_threads = 0; t->nb_threads < nb_threads; t->nb_threads++) {
+        if (pthread_create(&t->threads[t->nb_threads], NULL,
+                           info_decode_thread, t))
+            break;
+    }
+    if (!t->nb_threads) {
+        pthread_cond_destroy(&t->done_cond);
+        pthread_cond_destroy(&t->work_cond);
+        pthread_mutex_destroy(&t->mutex);
+        av_freep(&t->threads);
+    }
+}
+
+/* decodes the queued packets of up to nb_streams streams */
+static void info_decode_flush(InfoDecodeThreads *t, int nb_streams)
+{
+    if (!t->nb_jobs)
+        return;
+
+    pthread_mutex_lock(&t->mutex);
+    t->nb_streams  = nb_streams;
+    t->next_stream = 0;
+    t->nb_done     = 0;
+    pthread_cond_broadcast(&t->work_cond);
+    while (t->nb_done < t->nb_streams)
+        pthread_cond_wait(&t->done_cond, &t->mutex);
+    t->nb_jobs = 0;
+    pthread_mutex_unlock(&t->mutex);
+}
+
+static int info_decode_add(AVFormatContext *ic, InfoDecodeThreads *t,
+                           AVStream *st, AVPacket *pkt, AVDictionary **options)
+{
+    InfoDecodeJob *jobs;
+
+    /* decoders are opened here, as avcodec_open2() may not be called
+     * concurrently without a lock manager */
+    if (open_info_decoder(st, options) < 0)
+        return 0;
+
+    jobs = av_fast_realloc(t->jobs, &t->jobs_size,
+                           (t->nb_jobs + 1) * sizeof(*t->jobs));
+    if (!jobs)
+        return AVERROR(ENOMEM);
+    t->jobs = jobs;
+    t->jobs[t->nb_jobs].st        = st;
+    t->jobs[t->nb_jobs].pkt       = pkt;
+    t->jobs[t->nb_jobs].options   = options;
+    t->jobs[t->nb_jobs].nb_frames = st->codec_info_nb_frames;
+    if (++t->nb_jobs >= t->max_jobs)
+        info_decode_flush(t, ic->nb_streams);
+    return 0;
+}
+#endif
+
 int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 {
     int i, count, ret, read_size, j;
@@ -2690,6 +3127,9 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     int64_t old_offset = avio_tell(ic->pb);
     int orig_nb_streams = ic->nb_streams;        // new streams might appear, no options for those
     int flush_codecs = ic->probesize > 0;
+#if HAVE_PTHREADS
+    InfoDecodeThreads threads;
+#endif
 
     if(ic->pb)
         av_log(ic, AV_LOG_DEBUG, "File position before avformat_find_stream_info() is %"PRId64"\n", avio_tell(ic->pb));
@@ -2752,6 +3192,10 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         ic->streams[i]->info->fps_last_dts  = AV_NOPTS_VALUE;
     }
 
+#if HAVE_PTHREADS
+    info_decode_init(ic, &threads);
+#endif
+
     count = 0;
     read_size = 0;
     for(;;) {
@@ -2791,7 +3235,7 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
             /* NOTE: if the format has no header, then we need to read
                some packets to get most of the streams, so we cannot
                stop here */
-            if (!(ic->ctx_flags & AVFMTCTX_NOHEADER)) {
+            if (!(ic->ctx_flags & AVFMTCTX_NOHEADER) || stream_info_complete(ic)) {
                 /* if we found the info for all the codecs, we can stop */
                 ret = count;
                 av_log(ic, AV_LOG_DEBUG, "All info found\n");
@@ -2835,6 +3279,8 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
         read_size += pkt->size;
 
         st = ic->streams[pkt->stream_index];
+        if (ic->nb_stream_info)
+            apply_stream_info(ic, st);
         if (pkt->dts != AV_NOPTS_VALUE && st->codec_info_nb_frames > 1) {
             /* check for non-increasing dts */
             if (st->info->fps_last_dts != AV_NOPTS_VALUE &&
@@ -2917,8 +3363,10 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
             if (i > 0 && i < FF_MAX_EXTRADATA_SIZE) {
                 st->codec->extradata_size= i;
                 st->codec->extradata= av_malloc(st->codec->extradata_size + FF_INPUT_BUFFER_PADDING_SIZE);
-                if (!st->codec->extradata)
-                    return AVERROR(ENOMEM);
+                if (!st->codec->extradata) {
+                    ret = AVERROR(ENOMEM);
+                    goto find_stream_info_err;
+                }
                 memcpy(st->codec->extradata, pkt->data, st->codec->extradata_size);
                 memset(st->codec->extradata + i, 0, FF_INPUT_BUFFER_PADDING_SIZE);
             }
@@ -2933,12 +3381,29 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
            least one frame of codec data, this makes sure the codec initializes
            the channel configuration and does not only trust the values from the container.
         */
-        try_decode_frame(st, pkt, (options && i < orig_nb_streams ) ? &options[i] : NULL);
+        /* saved parameters make decoding unnecessary */
+        if (!st->info->params_loaded || !has_codec_parameters(st, NULL)) {
+#if HAVE_PTHREADS
+            if (threads.nb_threads) {
+                ret = info_decode_add(ic, &threads, st, pkt,
+                                      (options && i < orig_nb_streams) ? &options[i] : NULL);
+                if (ret < 0)
+                    goto find_stream_info_err;
+            } else
+#endif
+            try_decode_frame(st, pkt, (options && i < orig_nb_streams ) ? &options[i] : NULL,
+                             st->codec_info_nb_frames);
+        }
 
         st->codec_info_nb_frames++;
         count++;
     }
 
+#if HAVE_PTHREADS
+    info_decode_flush(&threads, ic->nb_streams);
+    info_decode_uninit(&threads);
+#endif
+
     if (flush_codecs) {
         AVPacket empty_pkt = { 0 };
         int err = 0;
@@ -2955,7 +3420,8 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
                 do {
                     err = try_decode_frame(st, &empty_pkt,
                                             (options && i < orig_nb_streams) ?
-                                            &options[i] : NULL);
+                                            &options[i] : NULL,
+                                            st->codec_info_nb_frames);
                 } while (err > 0 && !has_codec_parameters(st, NULL));
 
                 if (err < 0) {
@@ -3086,6 +3552,10 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     compute_chapters_end(ic);
 
  find_stream_info_err:
+#if HAVE_PTHREADS
+    info_decode_uninit(&threads);
+#endif
+    free_stream_info(ic);
     for (i=0; i < ic->nb_streams; i++) {
         if (ic->streams[i]->codec)
             ic->streams[i]->codec->thread_count = 0;
@@ -3239,6 +3709,12 @@ void avformat_free_context(AVFormatContext *s)
         av_freep(&s->chapters[s->nb_chapters]);
     }
     av_freep(&s->chapters);
+    free_stream_info(s);
+    while (s->packet_pool) {
+        AVPacketList *pktl = s->packet_pool;
+        s->packet_pool = pktl->next;
+        av_free(pktl);
+    }
     av_dict_free(&s->metadata);
     av_freep(&s->streams);
     av_free(s);
@@ -35,6 +35,11 @@ pb_shuf_unpack_odd:       db -1, -1,  4,  5, -1, -1,  6,  7, -1, -1, 12, 13, -1,
 pb_interleave_words: SHUFFLE_MASK_W  0,  4,  1,  5,  2,  6,  3,  7
 pb_deinterleave_words: SHUFFLE_MASK_W  0,  2,  4,  6,  1,  3,  5,  7
 pw_zero_even:     times 4 dw 0x0000, 0xffff
+pd_s32_inv_scale: times 2 dq 0x3e00000000000000
+pd_s32_scale:     times 2 dq 0x41e0000000000000
+pd_s32_clip:      times 2 dq 0x41dfffffffc00000
+pd_s16_inv_scale: times 2 dq 0x3f00000000000000
+pd_s16_scale:     times 2 dq 0x40e0000000000000
 
 SECTION_TEXT
 
@@ -232,6 +237,173 @@ CONV_FLT_TO_S32
 INIT_YMM avx
 CONV_FLT_TO_S32
 %endif
+;------------------------------------------------------------------------------
+; void ff_conv_s16_to_dbl(double *dst, const int16_t *src, int len);
+;------------------------------------------------------------------------------
+
+INIT_XMM sse2
+cglobal conv_s16_to_dbl, 3,3,6, dst, src, len
+    lea      lenq, [2*lend]
+    add      srcq, lenq
+    lea      dstq, [dstq+4*lenq]
+    neg      lenq
+    mova       m5, [pd_s16_inv_scale]
+.loop:
+    mova       m0, [srcq+lenq]
+    S16_TO_S32_SX 0, 1
+    cvtdq2pd   m2, m0
+    cvtdq2pd   m3, m1
+    movhlps    m0, m0
+    movhlps    m1, m1
+    cvtdq2pd   m0, m0
+    cvtdq2pd   m1, m1
+    mulpd      m2, m5
+    mulpd      m0, m5
+    mulpd      m3, m5
+    mulpd      m1, m5
+    mova  [dstq+4*lenq         ], m2
+    mova  [dstq+4*lenq+1*mmsize], m0
+    mova  [dstq+4*lenq+2*mmsize], m3
+    mova  [dstq+4*lenq+3*mmsize], m1
+    add      lenq, mmsize
+    jl .loop
+    REP_RET
+
+;------------------------------------------------------------------------------
+; void ff_conv_s32_to_dbl(double *dst, const int32_t *src, int len);
+;------------------------------------------------------------------------------
+
+INIT_XMM sse2
+cglobal conv_s32_to_dbl, 3,3,5, dst, src, len
+    lea     lenq, [4*lend]
+    add     srcq, lenq
+    lea     dstq, [dstq+2*lenq]
+    neg     lenq
+    mova      m4, [pd_s32_inv_scale]
+.loop:
+    cvtdq2pd  m0, [srcq+lenq   ]
+    cvtdq2pd  m1, [srcq+lenq+ 8]
+    cvtdq2pd  m2, [srcq+lenq+16]
+    cvtdq2pd  m3, [srcq+lenq+24]
+    mulpd     m0, m4
+    mulpd     m1, m4
+    mulpd     m2, m4
+    mulpd     m3, m4
+    mova  [dstq+2*lenq         ], m0
+    mova  [dstq+2*lenq+1*mmsize], m1
+    mova  [dstq+2*lenq+2*mmsize], m2
+    mova  [dstq+2*lenq+3*mmsize], m3
+    add     lenq, mmsize*2
+    jl .loop
+    REP_RET
+
+;------------------------------------------------------------------------------
+; void ff_conv_flt_to_dbl(double *dst, const float *src, int len);
+;------------------------------------------------------------------------------
+
+INIT_XMM sse2
+cglobal conv_flt_to_dbl, 3,3,4, dst, src, len
+    lea     lenq, [4*lend]
+    add     srcq, lenq
+    lea     dstq, [dstq+2*lenq]
+    neg     lenq
+.loop:
+    cvtps2pd  m0, [srcq+lenq   ]
+    cvtps2pd  m1, [srcq+lenq+ 8]
+    cvtps2pd  m2, [srcq+lenq+16]
+    cvtps2pd  m3, [srcq+lenq+24]
+    mova  [dstq+2*lenq         ], m0
+    mova  [dstq+2*lenq+1*mmsize], m1
+    mova  [dstq+2*lenq+2*mmsize], m2
+    mova  [dstq+2*lenq+3*mmsize], m3
+    add     lenq, mmsize*2
+    jl .loop
+    REP_RET
+
+;------------------------------------------------------------------------------
+; void ff_conv_dbl_to_s16(int16_t *dst, const double *src, int len);
+;------------------------------------------------------------------------------
+
+INIT_XMM sse2
+cglobal conv_dbl_to_s16, 3,3,5, dst, src, len
+    lea     lenq, [2*lend]
+    lea     srcq, [srcq+4*lenq]
+    add     dstq, lenq
+    neg     lenq
+    mova      m4, [pd_s16_scale]
+.loop:
+    mulpd     m0, m4, [srcq+4*lenq         ]
+    mulpd     m1, m4, [srcq+4*lenq+1*mmsize]
+    mulpd     m2, m4, [srcq+4*lenq+2*mmsize]
+    mulpd     m3, m4, [srcq+4*lenq+3*mmsize]
+    cvtpd2dq  m0, m0
+    cvtpd2dq  m1, m1
+    cvtpd2dq  m2, m2
+    cvtpd2dq  m3, m3
+    punpcklqdq m0, m1
+    punpcklqdq m2, m3
+    packssdw  m0, m2
+    mova  [dstq+lenq], m0
+    add     lenq, mmsize
+    jl .loop
+    REP_RET
+
+;------------------------------------------------------------------------------
+; void ff_conv_dbl_to_s32(int32_t *dst, const double *src, int len);
+;------------------------------------------------------------------------------
+
+INIT_XMM sse2
+cglobal conv_dbl_to_s32, 3,3,6, dst, src, len
+    lea     lenq, [4*lend]
+    lea     srcq, [srcq+2*lenq]
+    add     dstq, lenq
+    neg     lenq
+    mova      m4, [pd_s32_scale]
+    mova      m5, [pd_s32_clip]
+.loop:
+    mulpd     m0, m4, [srcq+2*lenq         ]
+    mulpd     m1, m4, [srcq+2*lenq+1*mmsize]
+    mulpd     m2, m4, [srcq+2*lenq+2*mmsize]
+    mulpd     m3, m4, [srcq+2*lenq+3*mmsize]
+    minpd     m0, m5
+    minpd     m1, m5
+    minpd     m2, m5
+    minpd     m3, m5
+    cvtpd2dq  m0, m0
+    cvtpd2dq  m1, m1
+    cvtpd2dq  m2, m2
+    cvtpd2dq  m3, m3
+    punpcklqdq m0, m1
+    punpcklqdq m2, m3
+    mova  [dstq+lenq       ], m0
+    mova  [dstq+lenq+mmsize], m2
+    add     lenq, mmsize*2
+    jl .loop
+    REP_RET
+
+;------------------------------------------------------------------------------
+; void ff_conv_dbl_to_flt(float *dst, const double *src, int len);
+;------------------------------------------------------------------------------
+
+INIT_XMM sse2
+cglobal conv_dbl_to_flt, 3,3,4, dst, src, len
+    lea     lenq, [4*lend]
+    lea     srcq, [srcq+2*lenq]
+    add     dstq, lenq
+    neg     lenq
+.loop:
+    cvtpd2ps  m0, [srcq+2*lenq         ]
+    cvtpd2ps  m1, [srcq+2*lenq+1*mmsize]
+    cvtpd2ps  m2, [srcq+2*lenq+2*mmsize]
+    cvtpd2ps  m3, [srcq+2*lenq+3*mmsize]
+    movlhps   m0, m1
+    movlhps   m2, m3
+    mova  [dstq+lenq       ], m0
+    mova  [dstq+lenq+mmsize], m2
+    add     lenq, mmsize*2
+    jl .loop
+    REP_RET
+
 
 ;------------------------------------------------------------------------------
 ; void ff_conv_s16p_to_s16_2ch(int16_t *dst, int16_t *const *src, int len,
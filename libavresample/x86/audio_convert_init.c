@@ -41,6 +41,18 @@ extern void ff_conv_flt_to_s16_sse2(int16_t *dst, const float *src, int len);
 extern void ff_conv_flt_to_s32_sse2(int32_t *dst, const float *src, int len);
 extern void ff_conv_flt_to_s32_avx (int32_t *dst, const float *src, int len);
 
+extern void ff_conv_s16_to_dbl_sse2(double *dst, const int16_t *src, int len);
+
+extern void ff_conv_s32_to_dbl_sse2(double *dst, const int32_t *src, int len);
+
+extern void ff_conv_flt_to_dbl_sse2(double *dst, const float *src, int len);
+
+extern void ff_conv_dbl_to_s16_sse2(int16_t *dst, const double *src, int len);
+
+extern void ff_conv_dbl_to_s32_sse2(int32_t *dst, const double *src, int len);
+
+extern void ff_conv_dbl_to_flt_sse2(float *dst, const double *src, int len);
+
 /* interleave conversions */
 
 extern void ff_conv_s16p_to_s16_2ch_sse2(int16_t *dst, int16_t *const *src,
@@ -147,11 +159,16 @@ av_cold void ff_audio_convert_init_x86(AudioConvert *ac)
 {
     int mm_flags = av_get_cpu_flags();
 
+    /* The flt <-> fltp (de)interleave functions only move 32-bit words
+     * around, so they are used for s32 <-> s32p as well. */
+
     if (EXTERNAL_MMX(mm_flags)) {
         ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S32,
                                   0, 1, 8, "MMX", ff_conv_s32_to_s16_mmx);
         ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_FLTP,
                                   6, 1, 4, "MMX", ff_conv_fltp_to_flt_6ch_mmx);
+        ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P,
+                                  6, 1, 4, "MMX", ff_conv_fltp_to_flt_6ch_mmx);
     }
     if (EXTERNAL_SSE(mm_flags)) {
         ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_FLTP,
@@ -160,6 +177,10 @@ av_cold void ff_audio_convert_init_x86(AudioConvert *ac)
                                   2, 16, 8, "SSE", ff_conv_fltp_to_flt_2ch_sse);
         ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_FLT,
                                   2, 16, 4, "SSE", ff_conv_flt_to_fltp_2ch_sse);
+        ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P,
+                                  2, 16, 8, "SSE", ff_conv_fltp_to_flt_2ch_sse);
+        ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_S32P, AV_SAMPLE_FMT_S32,
+                                  2, 16, 4, "SSE", ff_conv_flt_to_fltp_2ch_sse);
     }
     if (EXTERNAL_SSE2(mm_flags)) {
         if (!(mm_flags & AV_CPU_FLAG_SSE2SLOW)) {
@@ -205,6 +226,20 @@ av_cold void ff_audio_convert_init_x86(AudioConvert *ac)
                                   6, 16, 4, "SSE2", ff_conv_flt_to_s16p_6ch_sse2);
         ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_FLT,
                                   6, 16, 4, "SSE2", ff_conv_flt_to_fltp_6ch_sse2);
+        ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_S32P, AV_SAMPLE_FMT_S32,
+                                  6, 16, 4, "SSE2", ff_conv_flt_to_fltp_6ch_sse2);
+        ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_DBL, AV_SAMPLE_FMT_S16,
+                                  0, 16, 8, "SSE2", ff_conv_s16_to_dbl_sse2);
+        ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_DBL, AV_SAMPLE_FMT_S32,
+                                  0, 16, 8, "SSE2", ff_conv_s32_to_dbl_sse2);
+        ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_DBL, AV_SAMPLE_FMT_FLT,
+                                  0, 16, 8, "SSE2", ff_conv_flt_to_dbl_sse2);
+        ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_DBL,
+                                  0, 16, 8, "SSE2", ff_conv_dbl_to_s16_sse2);
+        ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_DBL,
+                                  0, 16, 8, "SSE2", ff_conv_dbl_to_s32_sse2);
+        ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_DBL,
+                                  0, 16, 8, "SSE2", ff_conv_dbl_to_flt_sse2);
     }
     if (EXTERNAL_SSSE3(mm_flags)) {
         ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_S16P,
@@ -225,6 +260,8 @@ av_cold void ff_audio_convert_init_x86(AudioConvert *ac)
                                   0, 16, 8, "SSE4", ff_conv_s16_to_flt_sse4);
         ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_FLTP,
                                   6, 16, 4, "SSE4", ff_conv_fltp_to_flt_6ch_sse4);
+        ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P,
+                                  6, 16, 4, "SSE4", ff_conv_fltp_to_flt_6ch_sse4);
     }
     if (EXTERNAL_AVX(mm_flags)) {
         ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_FLT, AV_SAMPLE_FMT_S32,
@@ -257,7 +294,13 @@ av_cold void ff_audio_convert_init_x86(AudioConvert *ac)
                                   6, 16, 4, "AVX", ff_conv_flt_to_s16p_6ch_avx);
         ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_FLT,
                                   2, 16, 4, "AVX", ff_conv_flt_to_fltp_2ch_avx);
+        ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_S32P, AV_SAMPLE_FMT_S32,
+                                  2, 16, 4, "AVX", ff_conv_flt_to_fltp_2ch_avx);
         ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_FLT,
                                   6, 16, 4, "AVX", ff_conv_flt_to_fltp_6ch_avx);
+        ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_S32, AV_SAMPLE_FMT_S32P,
+                                  6, 16, 4, "AVX", ff_conv_fltp_to_flt_6ch_avx);
+        ff_audio_convert_set_func(ac, AV_SAMPLE_FMT_S32P, AV_SAMPLE_FMT_S32,
+                                  6, 16, 4, "AVX", ff_conv_flt_to_fltp_6ch_avx);
     }
 }
@@ -156,6 +156,25 @@ int av_audio_fifo_read(AVAudioFifo *af, void **data, int nb_samples)
     return nb_samples;
 }
 
+int av_audio_fifo_peek_ptr(AVAudioFifo *af, void **data, int nb_samples)
+{
+    int i, size;
+
+    if (nb_samples < 0)
+        return AVERROR(EINVAL);
+    nb_samples = FFMIN(nb_samples, af->nb_samples);
+    if (!nb_samples)
+        return 0;
+
+    size = nb_samples * af->sample_size;
+    for (i = 0; i < af->nb_buffers; i++) {
+        if (!(data[i] = av_fifo_peek_contiguous(af->buf[i], size)))
+            return AVERROR(ENOMEM);
+    }
+
+    return nb_samples;
+}
+
 int av_audio_fifo_drain(AVAudioFifo *af, int nb_samples)
 {
     int i, size;
@@ -103,6 +103,25 @@ int av_audio_fifo_write(AVAudioFifo *af, void **data, int nb_samples);
  */
 int av_audio_fifo_read(AVAudioFifo *af, void **data, int nb_samples);
 
+/**
+ * Get pointers to the data at the start of an AVAudioFifo without copying
+ * it out.
+ *
+ * The samples stay in the FIFO and must be consumed with
+ * av_audio_fifo_drain() once the caller is done with them. The pointers
+ * are invalidated by any other operation on the FIFO.
+ *
+ * @see enum AVSampleFormat
+ * The documentation for AVSampleFormat describes the data layout.
+ *
+ * @param af          AVAudioFifo to read from
+ * @param data        set to the audio data plane pointers
+ * @param nb_samples  number of samples to peek at
+ * @return            number of samples available at data, or negative AVERROR
+ *                    code on failure.
+ */
+int av_audio_fifo_peek_ptr(AVAudioFifo *af, void **data, int nb_samples);
+
 /**
  * Drain data from an AVAudioFifo.
  *
@@ -18,7 +18,6 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
-#include <ctype.h>
 #include <string.h>
 
 #include "avstring.h"
@@ -28,9 +27,19 @@
 
 struct AVDictionary {
     int count;
+    int size;               ///< number of allocated elems
     AVDictionaryEntry *elems;
+    unsigned *hashes;       ///< case-folded hash of each key in elems
 };
 
+static unsigned hash_key(const char *key)
+{
+    unsigned h = 0;
+    while (*key)
+        h = h * 31 + av_toupper(*(const unsigned char *)key++);
+    return h;
+}
+
 int av_dict_count(const AVDictionary *m)
 {
     return m ? m->count : 0;
@@ -39,7 +48,7 @@ int av_dict_count(const AVDictionary *m)
 AVDictionaryEntry *
 av_dict_get(AVDictionary *m, const char *key, const AVDictionaryEntry *prev, int flags)
 {
-    unsigned int i, j;
+    unsigned int i, j, h = 0;
 
     if(!m)
         return NULL;
@@ -47,10 +56,16 @@ av_dict_get(AVDictionary *m, const char *key, const AVDictionaryEntry *prev, int
     if(prev) i= prev - m->elems + 1;
     else     i= 0;
 
+    /* Whole keys are compared by hash first; prefix matches cannot be. */
+    if (!(flags & AV_DICT_IGNORE_SUFFIX))
+        h = hash_key(key);
+
     for(; i<m->count; i++){
         const char *s= m->elems[i].key;
+        if (!(flags & AV_DICT_IGNORE_SUFFIX) && m->hashes[i] != h)
+            continue;
         if(flags & AV_DICT_MATCH_CASE) for(j=0;         s[j]  ==         key[j]  && key[j]; j++);
-        else                               for(j=0; toupper(s[j]) == toupper(key[j]) && key[j]; j++);
+        else                               for(j=0; av_toupper(s[j]) == av_toupper(key[j]) && key[j]; j++);
         if(key[j])
             continue;
         if(s[j] && !(flags & AV_DICT_IGNORE_SUFFIX))
@@ -77,15 +92,24 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value, int flags
         else
             av_free(tag->value);
         av_free(tag->key);
-        *tag = m->elems[--m->count];
-    } else {
-        AVDictionaryEntry *tmp = av_realloc(m->elems, (m->count+1) * sizeof(*m->elems));
+        m->hashes[tag - m->elems] = m->hashes[--m->count];
+        *tag = m->elems[m->count];
+    } else if (m->count >= m->size) {
+        int size = FFMAX(2 * m->size, 4);
+        AVDictionaryEntry *tmp = av_realloc(m->elems, size * sizeof(*m->elems));
+        unsigned *hashes;
         if(tmp) {
             m->elems = tmp;
         } else
             return AVERROR(ENOMEM);
+        hashes = av_realloc(m->hashes, size * sizeof(*m->hashes));
+        if (!hashes)
+            return AVERROR(ENOMEM);
+        m->hashes = hashes;
+        m->size   = size;
     }
     if (value) {
+        m->hashes[m->count] = hash_key(key);
         if (flags & AV_DICT_DONT_STRDUP_KEY) {
             m->elems[m->count].key   = (char*)(intptr_t)key;
         } else
@@ -104,6 +128,7 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value, int flags
     }
     if (!m->count) {
         av_free(m->elems);
+        av_free(m->hashes);
         av_freep(pm);
     }
 
@@ -120,6 +145,7 @@ void av_dict_free(AVDictionary **pm)
             av_free(m->elems[m->count].value);
         }
         av_free(m->elems);
+        av_free(m->hashes);
     }
     av_freep(pm);
 }
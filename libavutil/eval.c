@@ -135,6 +135,13 @@ static int strmatch(const char *s, const char *prefix)
     return !IS_IDENTIFIER_CHAR(s[i]);
 }
 
+typedef union ExprArg {
+    int const_index;
+    double (*func0)(double);
+    double (*func1)(void *, double);
+    double (*func2)(void *, double, double);
+} ExprArg;
+
 struct AVExpr {
     enum {
         e_value, e_const, e_func0, e_func1, e_func2,
@@ -144,18 +151,29 @@ struct AVExpr {
         e_last, e_st, e_while, e_taylor, e_root, e_floor, e_ceil, e_trunc,
         e_sqrt, e_not, e_random, e_hypot, e_gcd,
         e_if, e_ifnot,
+        e_jz, e_jnz, e_jmp, e_scale, // only used in compiled programs
     } type;
     double value; // is sign in other types
-    union {
-        int const_index;
-        double (*func0)(double);
-        double (*func1)(void *, double);
-        double (*func2)(void *, double, double);
-    } a;
+    ExprArg a;
     struct AVExpr *param[3];
     double *var;
+    struct ExprOp *prog;    ///< flattened postfix form of the tree, may be NULL
+    int nb_ops;
 };
 
+/**
+ * One instruction of a compiled expression. Operands are taken from and
+ * results pushed to a small value stack, jumps are used for if()/ifnot().
+ */
+typedef struct ExprOp {
+    int type;
+    double value;
+    ExprArg a;
+    int target;             ///< jump destination for e_jz, e_jnz and e_jmp
+} ExprOp;
+
+#define EXPR_STACK 64
+
 static double eval_expr(Parser *p, AVExpr *e)
 {
     switch (e->type) {
@@ -282,6 +300,7 @@ void av_expr_free(AVExpr *e)
     av_expr_free(e->param[1]);
     av_expr_free(e->param[2]);
     av_freep(&e->var);
+    av_freep(&e->prog);
     av_freep(&e);
 }
 
@@ -599,6 +618,182 @@ static int verify_expr(AVExpr *e)
     }
 }
 
+/**
+ * Replace subtrees which only depend on numeric literals by their value.
+ * Functions taking the opaque pointer, the variable accessors and the
+ * iterating constructs are never folded.
+ */
+static void optimize_expr(AVExpr *e)
+{
+    Parser p = { 0 };
+    int i;
+
+    if (!e)
+        return;
+    for (i = 0; i < 3; i++)
+        optimize_expr(e->param[i]);
+
+    switch (e->type) {
+    case e_value: case e_const:  case e_func1:  case e_func2:
+    case e_ld:    case e_st:     case e_random: case e_while:
+    case e_taylor: case e_root:
+        return;
+    }
+    for (i = 0; i < 3; i++)
+        if (e->param[i] && e->param[i]->type != e_value)
+            return;
+
+    e->value = eval_expr(&p, e);
+    e->type  = e_value;
+    for (i = 0; i < 3; i++) {
+        av_expr_free(e->param[i]);
+        e->param[i] = NULL;
+    }
+}
+
+static int count_nodes(const AVExpr *e)
+{
+    if (!e)
+        return 0;
+    return 1 + count_nodes(e->param[0]) + count_nodes(e->param[1]) + count_nodes(e->param[2]);
+}
+
+static ExprOp *emit_op(AVExpr *root, int type, double value)
+{
+    ExprOp *op = &root->prog[root->nb_ops++];
+    op->type  = type;
+    op->value = value;
+    return op;
+}
+
+/**
+ * Append the postfix form of e to root->prog.
+ * @param depth number of values on the stack before e is evaluated
+ * @return the stack depth after e is evaluated, or a negative value if
+ *         the expression cannot be compiled
+ */
+static int compile_expr(AVExpr *root, const AVExpr *e, int depth)
+{
+    ExprOp *jump, *op;
+
+    switch (e->type) {
+    case e_value:
+    case e_const:
+        if (depth >= EXPR_STACK)
+            return -1;
+        op = emit_op(root, e->type, e->value);
+        op->a = e->a;
+        return depth + 1;
+    case e_if:
+    case e_ifnot:
+        if ((depth = compile_expr(root, e->param[0], depth)) < 0)
+            return depth;
+        jump  = emit_op(root, e->type == e_if ? e_jz : e_jnz, 0);
+        if ((depth = compile_expr(root, e->param[1], depth - 1)) < 0)
+            return depth;
+        op    = emit_op(root, e_jmp, 0);
+        jump->target = root->nb_ops;
+        emit_op(root, e_value, 0);
+        op->target   = root->nb_ops;
+        if (e->value != 1)
+            emit_op(root, e_scale, e->value);
+        return depth;
+    case e_while:
+    case e_taylor:
+    case e_root:
+        return -1;
+    }
+
+    if ((depth = compile_expr(root, e->param[0], depth)) < 0)
+        return depth;
+    if (e->param[1] && (depth = compile_expr(root, e->param[1], depth) - 1) < 0)
+        return depth;
+    op = emit_op(root, e->type, e->value);
+    op->a = e->a;
+    return depth;
+}
+
+static double eval_prog(Parser *p, const AVExpr *e)
+{
+    double stack[EXPR_STACK];
+    double *sp = stack;
+    int pc = 0;
+
+    while (pc < e->nb_ops) {
+        const ExprOp *op = &e->prog[pc++];
+        double d;
+
+        switch (op->type) {
+        case e_value:  *sp++ = op->value; break;
+        case e_const:  *sp++ = op->value * p->const_values[op->a.const_index]; break;
+        case e_func0:  sp[-1] = op->value * op->a.func0(sp[-1]); break;
+        case e_func1:  sp[-1] = op->value * op->a.func1(p->opaque, sp[-1]); break;
+        case e_squish: sp[-1] = 1/(1+exp(4*sp[-1])); break;
+        case e_gauss:  sp[-1] = exp(-sp[-1]*sp[-1]/2)/sqrt(2*M_PI); break;
+        case e_ld:     sp[-1] = op->value * p->var[av_clip(sp[-1], 0, VARS-1)]; break;
+        case e_isnan:  sp[-1] = op->value * !!isnan(sp[-1]); break;
+        case e_isinf:  sp[-1] = op->value * !!isinf(sp[-1]); break;
+        case e_floor:  sp[-1] = op->value * floor(sp[-1]); break;
+        case e_ceil:   sp[-1] = op->value * ceil (sp[-1]); break;
+        case e_trunc:  sp[-1] = op->value * trunc(sp[-1]); break;
+        case e_sqrt:   sp[-1] = op->value * sqrt (sp[-1]); break;
+        case e_not:    sp[-1] = op->value * (sp[-1] == 0); break;
+        case e_random: {
+            int idx= av_clip(sp[-1], 0, VARS-1);
+            uint64_t r= isnan(p->var[idx]) ? 0 : p->var[idx];
+            r= r*1664525+1013904223;
+            p->var[idx]= r;
+            sp[-1] = op->value * (r * (1.0/UINT64_MAX));
+            break;
+        }
+        case e_jz:     if (!*--sp) pc = op->target; break;
+        case e_jnz:    if ( *--sp) pc = op->target; break;
+        case e_jmp:    pc = op->target; break;
+        case e_scale:  sp[-1] *= op->value; break;
+        default: {
+            double d2 = *--sp;
+            d = sp[-1];
+            switch (op->type) {
+                case e_func2: d = op->value * op->a.func2(p->opaque, d, d2); break;
+                case e_mod: d = op->value * (d - floor(d/d2)*d2); break;
+                case e_gcd: d = op->value * av_gcd(d,d2); break;
+                case e_max: d = op->value * (d >  d2 ?   d : d2); break;
+                case e_min: d = op->value * (d <  d2 ?   d : d2); break;
+                case e_eq:  d = op->value * (d == d2 ? 1.0 : 0.0); break;
+                case e_gt:  d = op->value * (d >  d2 ? 1.0 : 0.0); break;
+                case e_gte: d = op->value * (d >= d2 ? 1.0 : 0.0); break;
+                case e_pow: d = op->value * pow(d, d2); break;
+                case e_mul: d = op->value * (d * d2); break;
+                case e_div: d = op->value * ((!CONFIG_FTRAPV || d2 ) ? (d / d2) : d * INFINITY); break;
+                case e_add: d = op->value * (d + d2); break;
+                case e_last:d = op->value * d2; break;
+                case e_st : d = op->value * (p->var[av_clip(d, 0, VARS-1)]= d2); break;
+                case e_hypot:d = op->value * (sqrt(d*d + d2*d2)); break;
+                default:    d = NAN;
+            }
+            sp[-1] = d;
+        }
+        }
+    }
+    return sp[-1];
+}
+
+/**
+ * Flatten the tree into e->prog. Expressions which cannot be compiled are
+ * left without a program and evaluated recursively.
+ */
+static int compile_prog(AVExpr *e)
+{
+    e->prog = av_malloc(5 * count_nodes(e) * sizeof(*e->prog));
+    if (!e->prog)
+        return AVERROR(ENOMEM);
+    if (compile_expr(e, e, 0) != 1) {
+        av_freep(&e->prog);
+        e->nb_ops = 0;
+    }
+    return 0;
+}
+
 int av_expr_parse(AVExpr **expr, const char *s,
                   const char * const *const_names,
                   const char * const *func1_names, double (* const *funcs1)(void *, double),
@@ -643,7 +838,13 @@ int av_expr_parse(AVExpr **expr, const char *s,
         ret = AVERROR(EINVAL);
         goto end;
     }
+    optimize_expr(e);
     e->var= av_mallocz(sizeof(double) *VARS);
+    if (!e->var || (ret = compile_prog(e)) < 0) {
+        av_expr_free(e);
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
     *expr = e;
 end:
     av_free(w);
@@ -657,6 +858,8 @@ double av_expr_eval(AVExpr *e, const double *const_values, void *opaque)
 
     p.const_values = const_values;
     p.opaque     = opaque;
+    if (e->prog)
+        return eval_prog(&p, e);
     return eval_expr(&p, e);
 }
 
@@ -19,6 +19,7 @@
  * License along with FFmpeg; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
+#include "atomic.h"
 #include "common.h"
 #include "fifo.h"
 
@@ -51,7 +52,9 @@ void av_fifo_reset(AVFifoBuffer *f)
 
 int av_fifo_size(AVFifoBuffer *f)
 {
-    return (uint32_t)(f->wndx - f->rndx);
+    uint32_t wndx = avpriv_atomic_int_get((volatile int *)&f->wndx);
+    uint32_t rndx = avpriv_atomic_int_get((volatile int *)&f->rndx);
+    return (uint32_t)(wndx - rndx);
 }
 
 int av_fifo_space(AVFifoBuffer *f)
@@ -59,23 +62,34 @@ int av_fifo_space(AVFifoBuffer *f)
     return f->end - f->buffer - av_fifo_size(f);
 }
 
+/**
+ * Move the contents of the FIFO into a new buffer of the given size,
+ * starting at its beginning.
+ */
+static int fifo_rebuffer(AVFifoBuffer *f, unsigned int new_size)
+{
+    int len = av_fifo_size(f);
+    AVFifoBuffer *f2 = av_fifo_alloc(new_size);
+
+    if (!f2)
+        return AVERROR(ENOMEM);
+    av_fifo_generic_read(f, f2->buffer, len, NULL);
+    f2->wptr += len;
+    if (f2->wptr >= f2->end)
+        f2->wptr = f2->buffer;
+    f2->wndx += len;
+    av_free(f->buffer);
+    *f = *f2;
+    av_free(f2);
+    return 0;
+}
+
 int av_fifo_realloc2(AVFifoBuffer *f, unsigned int new_size)
 {
     unsigned int old_size = f->end - f->buffer;
 
-    if (old_size < new_size) {
-        int len = av_fifo_size(f);
-        AVFifoBuffer *f2 = av_fifo_alloc(new_size);
-
-        if (!f2)
-            return AVERROR(ENOMEM);
-        av_fifo_generic_read(f, f2->buffer, len, NULL);
-        f2->wptr += len;
-        f2->wndx += len;
-        av_free(f->buffer);
-        *f = *f2;
-        av_free(f2);
-    }
+    if (old_size < new_size)
+        return fifo_rebuffer(f, new_size);
     return 0;
 }
 
@@ -108,22 +122,21 @@ int av_fifo_generic_write(AVFifoBuffer *f, void *src, int size, int (*func)(void
             memcpy(wptr, src, len);
             src = (uint8_t*)src + len;
         }
-// Write memory barrier needed for SMP here in theory
         wptr += len;
         if (wptr >= f->end)
             wptr = f->buffer;
         wndx += len;
         size -= len;
     } while (size > 0);
-    f->wndx= wndx;
     f->wptr= wptr;
+    /* publish the new data to the reader only once it is written */
+    avpriv_atomic_int_set((volatile int *)&f->wndx, wndx);
     return total - size;
 }
 
 
 int av_fifo_generic_read(AVFifoBuffer *f, void *dest, int buf_size, void (*func)(void*, void*, int))
 {
-// Read memory barrier needed for SMP here in theory
     do {
         int len = FFMIN(f->end - f->rptr, buf_size);
         if(func) func(dest, f->rptr, len);
@@ -131,7 +144,6 @@ int av_fifo_generic_read(AVFifoBuffer *f, void *dest, int buf_size, void (*func)
             memcpy(dest, f->rptr, len);
             dest = (uint8_t*)dest + len;
         }
-// memory barrier needed for SMP here in theory
         av_fifo_drain(f, len);
         buf_size -= len;
     } while (buf_size > 0);
@@ -144,7 +156,18 @@ void av_fifo_drain(AVFifoBuffer *f, int size)
     f->rptr += size;
     if (f->rptr >= f->end)
         f->rptr -= f->end - f->buffer;
-    f->rndx += size;
+    /* hand the space back to the writer only once the data is consumed */
+    avpriv_atomic_int_set((volatile int *)&f->rndx, f->rndx + size);
+}
+
+uint8_t *av_fifo_peek_contiguous(AVFifoBuffer *f, int size)
+{
+    if (size < 0 || size > av_fifo_size(f))
+        return NULL;
+    if (f->end - f->rptr < size &&
+        fifo_rebuffer(f, f->end - f->buffer) < 0)
+        return NULL;
+    return f->rptr;
 }
 
 #ifdef TEST
@@ -19,6 +19,10 @@
 /**
  * @file
  * a very simple circular buffer FIFO implementation
+ *
+ * One thread may write to a FIFO while another one reads from it without
+ * any locking, as long as neither of them resizes or resets it, or calls
+ * av_fifo_peek_contiguous() on it.
  */
 
 #ifndef AVUTIL_FIFO_H
@@ -121,6 +125,23 @@ int av_fifo_grow(AVFifoBuffer *f, unsigned int additional_space);
  */
 void av_fifo_drain(AVFifoBuffer *f, int size);
 
+/**
+ * Return a pointer to the next size bytes of an AVFifoBuffer, so that they
+ * can be used in place instead of being copied out with
+ * av_fifo_generic_read(). The data stays in the FIFO until it is consumed
+ * with av_fifo_drain().
+ *
+ * If the requested data wraps around the end of the buffer, the FIFO
+ * contents are first moved to the start of a new buffer, so the returned
+ * pointer is invalidated by any further operation on the FIFO.
+ *
+ * @param f    AVFifoBuffer to read from
+ * @param size number of bytes needed, at most av_fifo_size()
+ * @return pointer to size contiguous bytes, or NULL if not enough data is
+ *         available or on memory allocation failure
+ */
+uint8_t *av_fifo_peek_contiguous(AVFifoBuffer *f, int size);
+
 /**
  * Return a pointer to the data stored in a FIFO buffer at a certain offset.
  * The FIFO buffer is not modified.
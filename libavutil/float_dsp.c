@@ -21,6 +21,7 @@
 
 #include "config.h"
 
+#include "common.h"
 #include "float_dsp.h"
 
 static void vector_fmul_c(float *dst, const float *src0, const float *src1,
@@ -47,6 +48,23 @@ static void vector_fmul_scalar_c(float *dst, const float *src, float mul,
         dst[i] = src[i] * mul;
 }
 
+static void vector_fmul_scalar_sum_c(float *dst, const float **src,
+                                     const float *mul, int nb_src, int len)
+{
+    int i, j, k;
+
+    /* work on blocks small enough for dst to stay in the cache */
+    for (i = 0; i < len; i += 256) {
+        int block = FFMIN(len - i, 256);
+
+        for (j = 0; j < block; j++)
+            dst[i + j] = src[0][i + j] * mul[0];
+        for (k = 1; k < nb_src; k++)
+            for (j = 0; j < block; j++)
+                dst[i + j] += src[k][i + j] * mul[k];
+    }
+}
+
 static void vector_dmul_scalar_c(double *dst, const double *src, double mul,
                                  int len)
 {
@@ -55,12 +73,134 @@ static void vector_dmul_scalar_c(double *dst, const double *src, double mul,
         dst[i] = src[i] * mul;
 }
 
+static void vector_fmul_window_c(float *dst, const float *src0,
+                                 const float *src1, const float *win, int len)
+{
+    int i, j;
+
+    dst  += len;
+    win  += len;
+    src0 += len;
+
+    for (i = -len, j = len - 1; i < 0; i++, j--) {
+        float s0 = src0[i];
+        float s1 = src1[j];
+        float wi = win[i];
+        float wj = win[j];
+        dst[i] = s0 * wj - s1 * wi;
+        dst[j] = s0 * wi + s1 * wj;
+    }
+}
+
+static void vector_fmul_add_c(float *dst, const float *src0, const float *src1,
+                              const float *src2, int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++)
+        dst[i] = src0[i] * src1[i] + src2[i];
+}
+
+static void vector_fmul_reverse_c(float *dst, const float *src0,
+                                  const float *src1, int len)
+{
+    int i;
+
+    src1 += len - 1;
+    for (i = 0; i < len; i++)
+        dst[i] = src0[i] * src1[-i];
+}
+
+static inline uint32_t clipf_c_one(uint32_t a, uint32_t mini,
+                                   uint32_t maxi, uint32_t maxisign)
+{
+    if (a > mini)
+        return mini;
+    else if ((a ^ (1U << 31)) > maxisign)
+        return maxi;
+    else
+        return a;
+}
+
+static void vector_clipf_c_opposite_sign(float *dst, const float *src,
+                                         float *min, float *max, int len)
+{
+    int i;
+    uint32_t mini        = *(uint32_t *)min;
+    uint32_t maxi        = *(uint32_t *)max;
+    uint32_t maxisign    = maxi ^ (1U << 31);
+    uint32_t *dsti       = (uint32_t *)dst;
+    const uint32_t *srci = (const uint32_t *)src;
+
+    for (i = 0; i < len; i += 8) {
+        dsti[i + 0] = clipf_c_one(srci[i + 0], mini, maxi, maxisign);
+        dsti[i + 1] = clipf_c_one(srci[i + 1], mini, maxi, maxisign);
+        dsti[i + 2] = clipf_c_one(srci[i + 2], mini, maxi, maxisign);
+        dsti[i + 3] = clipf_c_one(srci[i + 3], mini, maxi, maxisign);
+        dsti[i + 4] = clipf_c_one(srci[i + 4], mini, maxi, maxisign);
+        dsti[i + 5] = clipf_c_one(srci[i + 5], mini, maxi, maxisign);
+        dsti[i + 6] = clipf_c_one(srci[i + 6], mini, maxi, maxisign);
+        dsti[i + 7] = clipf_c_one(srci[i + 7], mini, maxi, maxisign);
+    }
+}
+
+static void vector_clipf_c(float *dst, const float *src, float min, float max,
+                           int len)
+{
+    int i;
+
+    if (min < 0 && max > 0) {
+        vector_clipf_c_opposite_sign(dst, src, &min, &max, len);
+    } else {
+        for (i = 0; i < len; i += 8) {
+            dst[i    ] = av_clipf(src[i    ], min, max);
+            dst[i + 1] = av_clipf(src[i + 1], min, max);
+            dst[i + 2] = av_clipf(src[i + 2], min, max);
+            dst[i + 3] = av_clipf(src[i + 3], min, max);
+            dst[i + 4] = av_clipf(src[i + 4], min, max);
+            dst[i + 5] = av_clipf(src[i + 5], min, max);
+            dst[i + 6] = av_clipf(src[i + 6], min, max);
+            dst[i + 7] = av_clipf(src[i + 7], min, max);
+        }
+    }
+}
+
+static void butterflies_float_c(float *av_restrict v1, float *av_restrict v2,
+                                int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        float t = v1[i] - v2[i];
+        v1[i] += v2[i];
+        v2[i] = t;
+    }
+}
+
+static float scalarproduct_float_c(const float *v1, const float *v2, int len)
+{
+    float p = 0.0;
+    int i;
+
+    for (i = 0; i < len; i++)
+        p += v1[i] * v2[i];
+
+    return p;
+}
+
 void avpriv_float_dsp_init(AVFloatDSPContext *fdsp, int bit_exact)
 {
     fdsp->vector_fmul = vector_fmul_c;
     fdsp->vector_fmac_scalar = vector_fmac_scalar_c;
     fdsp->vector_fmul_scalar = vector_fmul_scalar_c;
     fdsp->vector_dmul_scalar = vector_dmul_scalar_c;
+    fdsp->vector_fmul_window = vector_fmul_window_c;
+    fdsp->vector_fmul_add = vector_fmul_add_c;
+    fdsp->vector_fmul_reverse = vector_fmul_reverse_c;
+    fdsp->vector_clipf = vector_clipf_c;
+    fdsp->butterflies_float = butterflies_float_c;
+    fdsp->scalarproduct_float = scalarproduct_float_c;
+    fdsp->vector_fmul_scalar_sum = vector_fmul_scalar_sum_c;
 
 #if ARCH_ARM
     ff_float_dsp_init_arm(fdsp);
@@ -72,3 +212,149 @@ void avpriv_float_dsp_init(AVFloatDSPContext *fdsp, int bit_exact)
     ff_float_dsp_init_mips(fdsp);
 #endif
 }
+
+#ifdef TEST
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "lfg.h"
+#include "mem.h"
+#include "timer.h"
+
+#define LEN 256
+
+static int bench;
+
+static void fill_float_array(AVLFG *lfg, float *a, int len)
+{
+    int i;
+    for (i = 0; i < len; i++)
+        a[i] = (av_lfg_get(lfg) / (double)UINT32_MAX - 0.5) * 16.0;
+}
+
+static int compare_floats(const char *name, const float *a, const float *b,
+                          int len, float max_diff)
+{
+    int i;
+    for (i = 0; i < len; i++) {
+        if (fabsf(a[i] - b[i]) > max_diff * FFMAX(1.0f, fabsf(a[i]))) {
+            printf("%s: mismatch at %d: %f != %f\n", name, i, a[i], b[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+#ifdef AV_READ_TIME
+#define BENCH(name, call) do {                                          \
+        if (bench) {                                                    \
+            uint64_t t0 = AV_READ_TIME();                               \
+            int n;                                                      \
+            for (n = 0; n < 1000; n++)                                  \
+                call;                                                   \
+            fprintf(stderr, "%-24s %8"PRIu64" cycles/call\n", name,     \
+                    (AV_READ_TIME() - t0) / 1000);                      \
+        }                                                               \
+    } while (0)
+#else
+#define BENCH(name, call) do { } while (0)
+#endif
+
+int main(int argc, char **argv)
+{
+    DECLARE_ALIGNED(32, float, src0)[LEN];
+    DECLARE_ALIGNED(32, float, src1)[LEN];
+    DECLARE_ALIGNED(32, float, src2)[LEN];
+    DECLARE_ALIGNED(32, float, win)[2 * LEN];
+    DECLARE_ALIGNED(32, float, ref)[2 * LEN];
+    DECLARE_ALIGNED(32, float, dst)[2 * LEN];
+    DECLARE_ALIGNED(32, double, dsrc)[LEN];
+    DECLARE_ALIGNED(32, double, dref)[LEN];
+    DECLARE_ALIGNED(32, double, ddst)[LEN];
+    AVFloatDSPContext fdsp;
+    AVLFG lfg;
+    float fref, fdst;
+    int i, ret = 0;
+
+    bench = argc > 1 && !strcmp(argv[1], "-bench");
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+    fill_float_array(&lfg, src0, LEN);
+    fill_float_array(&lfg, src1, LEN);
+    fill_float_array(&lfg, src2, LEN);
+    fill_float_array(&lfg, win, 2 * LEN);
+    for (i = 0; i < LEN; i++)
+        dsrc[i] = src0[i];
+
+    avpriv_float_dsp_init(&fdsp, 1);
+    if (bench)
+        fprintf(stderr, "cpu flags: 0x%08x\n", av_get_cpu_flags());
+
+    vector_fmul_c(ref, src0, src1, LEN);
+    fdsp.vector_fmul(dst, src0, src1, LEN);
+    ret |= compare_floats("vector_fmul", ref, dst, LEN, 1e-6);
+    BENCH("vector_fmul", fdsp.vector_fmul(dst, src0, src1, LEN));
+
+    memcpy(ref, src2, LEN * sizeof(*ref));
+    memcpy(dst, src2, LEN * sizeof(*dst));
+    vector_fmac_scalar_c(ref, src0, src1[0], LEN);
+    fdsp.vector_fmac_scalar(dst, src0, src1[0], LEN);
+    ret |= compare_floats("vector_fmac_scalar", ref, dst, LEN, 1e-5);
+    BENCH("vector_fmac_scalar", fdsp.vector_fmac_scalar(dst, src0, 0.0f, LEN));
+
+    vector_fmul_scalar_c(ref, src0, src1[0], LEN);
+    fdsp.vector_fmul_scalar(dst, src0, src1[0], LEN);
+    ret |= compare_floats("vector_fmul_scalar", ref, dst, LEN, 1e-6);
+    BENCH("vector_fmul_scalar", fdsp.vector_fmul_scalar(dst, src0, src1[0], LEN));
+
+    vector_dmul_scalar_c(dref, dsrc, src1[0], LEN);
+    fdsp.vector_dmul_scalar(ddst, dsrc, src1[0], LEN);
+    for (i = 0; i < LEN; i++)
+        if (fabs(dref[i] - ddst[i]) > 1e-12 * FFMAX(1.0, fabs(dref[i]))) {
+            printf("vector_dmul_scalar: mismatch at %d: %f != %f\n",
+                   i, dref[i], ddst[i]);
+            ret = -1;
+            break;
+        }
+    BENCH("vector_dmul_scalar", fdsp.vector_dmul_scalar(ddst, dsrc, src1[0], LEN));
+
+    vector_fmul_window_c(ref, src0, src1, win, LEN / 2);
+    fdsp.vector_fmul_window(dst, src0, src1, win, LEN / 2);
+    ret |= compare_floats("vector_fmul_window", ref, dst, LEN, 1e-5);
+    BENCH("vector_fmul_window", fdsp.vector_fmul_window(dst, src0, src1, win, LEN / 2));
+
+    vector_fmul_add_c(ref, src0, src1, src2, LEN);
+    fdsp.vector_fmul_add(dst, src0, src1, src2, LEN);
+    ret |= compare_floats("vector_fmul_add", ref, dst, LEN, 1e-5);
+    BENCH("vector_fmul_add", fdsp.vector_fmul_add(dst, src0, src1, src2, LEN));
+
+    vector_fmul_reverse_c(ref, src0, src1, LEN);
+    fdsp.vector_fmul_reverse(dst, src0, src1, LEN);
+    ret |= compare_floats("vector_fmul_reverse", ref, dst, LEN, 1e-6);
+    BENCH("vector_fmul_reverse", fdsp.vector_fmul_reverse(dst, src0, src1, LEN));
+
+    vector_clipf_c(ref, src0, -4.0f, 4.0f, LEN);
+    fdsp.vector_clipf(dst, src0, -4.0f, 4.0f, LEN);
+    ret |= compare_floats("vector_clipf", ref, dst, LEN, 0);
+    BENCH("vector_clipf", fdsp.vector_clipf(dst, src0, -4.0f, 4.0f, LEN));
+
+    memcpy(ref,       src0, LEN * sizeof(*ref));
+    memcpy(ref + LEN, src1, LEN * sizeof(*ref));
+    memcpy(dst,       src0, LEN * sizeof(*dst));
+    memcpy(dst + LEN, src1, LEN * sizeof(*dst));
+    butterflies_float_c(ref, ref + LEN, LEN);
+    fdsp.butterflies_float(dst, dst + LEN, LEN);
+    ret |= compare_floats("butterflies_float", ref, dst, 2 * LEN, 1e-6);
+    BENCH("butterflies_float", fdsp.butterflies_float(dst, dst + LEN, LEN));
+
+    fref = scalarproduct_float_c(src0, src1, LEN);
+    fdst = fdsp.scalarproduct_float(src0, src1, LEN);
+    ret |= compare_floats("scalarproduct_float", &fref, &fdst, 1, 1e-3);
+    BENCH("scalarproduct_float", fdsp.scalarproduct_float(src0, src1, LEN));
+
+    return ret ? 1 : 0;
+}
+#endif
@@ -247,6 +247,11 @@ void av_image_copy_plane(uint8_t       *dst, int dst_linesize,
         return;
     av_assert0(abs(src_linesize) >= bytewidth);
     av_assert0(abs(dst_linesize) >= bytewidth);
+    /* contiguous planes, copy them at once */
+    if (dst_linesize == bytewidth && src_linesize == bytewidth && height > 0) {
+        memcpy(dst, src, (size_t)bytewidth * height);
+        return;
+    }
     for (;height > 0; height--) {
         memcpy(dst, src, bytewidth);
         dst += dst_linesize;
@@ -33,12 +33,25 @@
 #include <io.h>
 #endif
 #include <stdlib.h>
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 #include "avutil.h"
 #include "common.h"
 #include "log.h"
 
 #define LINE_SZ 1024
 
+#if HAVE_PTHREADS
+/* protects the repeated-message state and keeps lines from interleaving */
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK()   pthread_mutex_lock(&mutex)
+#define UNLOCK() pthread_mutex_unlock(&mutex)
+#else
+#define LOCK()   do {} while (0)
+#define UNLOCK() do {} while (0)
+#endif
+
 static int av_log_level = AV_LOG_INFO;
 static int flags;
 
@@ -211,6 +224,7 @@ void av_log_default_callback(void* ptr, int level, const char* fmt, va_list vl)
 
     if (level > av_log_level)
         return;
+    LOCK();
     format_line(ptr, level, fmt, vl, part, sizeof(part[0]), &print_prefix, type);
     snprintf(line, sizeof(line), "%s%s%s", part[0], part[1], part[2]);
 
@@ -223,7 +237,7 @@ void av_log_default_callback(void* ptr, int level, const char* fmt, va_list vl)
         count++;
         if (is_atty == 1)
             fprintf(stderr, "    Last message repeated %d times\r", count);
-        return;
+        goto end;
     }
     if (count > 0) {
         fprintf(stderr, "    Last message repeated %d times\n", count);
@@ -236,6 +250,8 @@ void av_log_default_callback(void* ptr, int level, const char* fmt, va_list vl)
     colored_fputs(type[1], part[1]);
     sanitize(part[2]);
     colored_fputs(av_clip(level >> 3, 0, 6), part[2]);
+end:
+    UNLOCK();
 }
 
 static void (*av_log_callback)(void*, int, const char*, va_list) =
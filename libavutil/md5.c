@@ -31,6 +31,7 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 #include "bswap.h"
 #include "intreadwrite.h"
 #include "md5.h"
@@ -146,6 +147,7 @@ void av_md5_update(AVMD5 *ctx, const uint8_t *src, const int len)
     j = ctx->len & 63;
     ctx->len += len;
 
+#if CONFIG_SMALL
     for (i = 0; i < len; i++) {
         ctx->block[j++] = src[i];
         if (j == 64) {
@@ -153,6 +155,21 @@ void av_md5_update(AVMD5 *ctx, const uint8_t *src, const int len)
             j = 0;
         }
     }
+#else
+    if (j + len > 63) {
+        memcpy(&ctx->block[j], src, (i = 64 - j));
+        body(ctx->ABCD, (uint32_t *) ctx->block);
+        /* body() byteswaps its input in place on big-endian and needs it
+         * aligned, so whole blocks still go through ctx->block. */
+        for (; i + 63 < len; i += 64) {
+            memcpy(ctx->block, &src[i], 64);
+            body(ctx->ABCD, (uint32_t *) ctx->block);
+        }
+        j = 0;
+    } else
+        i = 0;
+    memcpy(&ctx->block[j], &src[i], len - i);
+#endif
 }
 
 void av_md5_final(AVMD5 *ctx, uint8_t *dst)
@@ -1171,8 +1171,12 @@ const AVOption *av_opt_find2(void *obj, const char *name, const char *unit,
         }
     }
 
-    while (o = av_opt_next(obj, o)) {
-        if (!strcmp(o->name, name) && (o->flags & opt_flags) == opt_flags &&
+    /* Walk the option table directly and compare the first character
+     * before calling strcmp(), as this is called for every option set. */
+    for (o = c->option; o && o->name; o++) {
+        if (o->name[0] != name[0] || (o->flags & opt_flags) != opt_flags)
+            continue;
+        if (!strcmp(o->name, name) &&
             ((!unit && o->type != AV_OPT_TYPE_CONST) ||
              (unit  && o->type == AV_OPT_TYPE_CONST && o->unit && !strcmp(o->unit, unit)))) {
             if (target_obj) {
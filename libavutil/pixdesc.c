@@ -28,6 +28,24 @@
 
 #include "intreadwrite.h"
 
+/* The constant steps of the callers below let the compiler vectorize
+ * these loops. */
+static av_always_inline void read_bytes(uint16_t *dst, const uint8_t *p,
+                                        int w, int step)
+{
+    int i;
+    for (i = 0; i < w; i++)
+        dst[i] = p[i * step];
+}
+
+static av_always_inline void write_bytes(uint8_t *p, const uint16_t *src,
+                                         int w, int step)
+{
+    int i;
+    for (i = 0; i < w; i++)
+        p[i * step] |= src[i];
+}
+
 void av_read_image_line(uint16_t *dst,
                         const uint8_t *data[4], const int linesize[4],
                         const AVPixFmtDescriptor *desc,
@@ -64,6 +82,17 @@ void av_read_image_line(uint16_t *dst,
         if (is_8bit)
             p += !!(flags & PIX_FMT_BE);
 
+        /* whole bytes, as in rgb24, bgra, nv12 or yuyv422 */
+        if (depth == 8 && !shift && !read_pal_component) {
+            switch (step) {
+            case 1: read_bytes(dst, p, w, 1);    return;
+            case 2: read_bytes(dst, p, w, 2);    return;
+            case 3: read_bytes(dst, p, w, 3);    return;
+            case 4: read_bytes(dst, p, w, 4);    return;
+            default: read_bytes(dst, p, w, step); return;
+            }
+        }
+
         while (w--) {
             int val = is_8bit ? *p :
                 flags & PIX_FMT_BE ? AV_RB16(p) : AV_RL16(p);
@@ -105,6 +134,15 @@ void av_write_image_line(const uint16_t *src,
 
         if (shift + depth <= 8) {
             p += !!(flags & PIX_FMT_BE);
+            if (depth == 8 && !shift) {
+                switch (step) {
+                case 1: write_bytes(p, src, w, 1);    return;
+                case 2: write_bytes(p, src, w, 2);    return;
+                case 3: write_bytes(p, src, w, 3);    return;
+                case 4: write_bytes(p, src, w, 4);    return;
+                default: write_bytes(p, src, w, step); return;
+                }
+            }
             while (w--) {
                 *p |= (*src++ << shift);
                 p += step;
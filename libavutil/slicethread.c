@@ -0,0 +1,441 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "avassert.h"
+#include "common.h"
+#include "cpu.h"
+#include "error.h"
+#include "mem.h"
+#include "slicethread.h"
+
+#if HAVE_PTHREADS
+#include <pthread.h>
+#elif HAVE_W32THREADS
+#include "libavcodec/w32pthreads.h"
+#elif HAVE_OS2THREADS
+#include "libavcodec/os2threads.h"
+#endif
+
+#if HAVE_THREADS
+
+struct AVSliceThread {
+    pthread_t *workers;
+    int nb_threads;
+
+    void *priv;
+    void (*worker_func)(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads);
+
+    int nb_jobs;
+    int current_job;
+    unsigned int current_execute;
+    int done;
+
+    pthread_cond_t  last_job_cond;
+    pthread_cond_t  current_job_cond;
+    pthread_mutex_t current_job_lock;
+
+    /* contexts running on the shared pool, all protected by shared_lock */
+    int shared;
+    int nb_jobs_done;
+    int nb_slots;               ///< threads which joined the current execute call
+    int queued;                 ///< the context is in the list of shared_tasks
+    struct AVSliceThread *next; ///< next context in the list of shared_tasks
+};
+
+static void *attribute_align_arg worker(void *v)
+{
+    AVSliceThread *c = v;
+    int our_job      = c->nb_jobs;
+    int nb_threads   = c->nb_threads;
+    unsigned int last_execute = 0;
+    int self_id;
+
+    pthread_mutex_lock(&c->current_job_lock);
+    self_id = c->current_job++;
+    for (;;) {
+        while (our_job >= c->nb_jobs) {
+            if (c->current_job == nb_threads + c->nb_jobs)
+                pthread_cond_signal(&c->last_job_cond);
+
+            while (last_execute == c->current_execute && !c->done)
+                pthread_cond_wait(&c->current_job_cond, &c->current_job_lock);
+            last_execute = c->current_execute;
+            our_job      = self_id;
+
+            if (c->done) {
+                pthread_mutex_unlock(&c->current_job_lock);
+                return NULL;
+            }
+        }
+        pthread_mutex_unlock(&c->current_job_lock);
+
+        c->worker_func(c->priv, our_job, self_id, c->nb_jobs, nb_threads);
+
+        pthread_mutex_lock(&c->current_job_lock);
+        our_job = c->current_job++;
+    }
+}
+
+static void park_workers(AVSliceThread *c)
+{
+    while (c->current_job != c->nb_threads + c->nb_jobs)
+        pthread_cond_wait(&c->last_job_cond, &c->current_job_lock);
+    pthread_mutex_unlock(&c->current_job_lock);
+}
+
+#if HAVE_PTHREADS
+/* The shared pool: one set of threads for the whole process, taking jobs
+ * from the execute calls of all contexts created with
+ * avpriv_slicethread_create_shared(). */
+static pthread_mutex_t shared_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  shared_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t      *shared_workers;
+static int             shared_nb_workers;
+static int             shared_refcount;
+static unsigned int    shared_generation; ///< incremented to stop the threads
+static AVSliceThread  *shared_tasks;      ///< contexts with jobs left to claim
+static AVSliceThread **shared_tasks_tail;
+
+static void shared_dequeue(AVSliceThread *c)
+{
+    AVSliceThread **p;
+
+    if (!c->queued)
+        return;
+    for (p = &shared_tasks; *p != c; p = &(*p)->next)
+        ;
+    *p = c->next;
+    if (!*p)
+        shared_tasks_tail = p;
+    c->queued = 0;
+}
+
+/* claims and runs the jobs of c from slot threadnr, called with
+ * shared_lock held */
+static void shared_run_jobs(AVSliceThread *c, int threadnr)
+{
+    while (c->current_job < c->nb_jobs) {
+        int jobnr = c->current_job++;
+
+        if (c->current_job == c->nb_jobs)
+            shared_dequeue(c);
+        pthread_mutex_unlock(&shared_lock);
+
+        c->worker_func(c->priv, jobnr, threadnr, c->nb_jobs, c->nb_threads);
+
+        pthread_mutex_lock(&shared_lock);
+        if (++c->nb_jobs_done == c->nb_jobs)
+            pthread_cond_signal(&c->last_job_cond);
+    }
+}
+
+static void *attribute_align_arg shared_worker(void *v)
+{
+    unsigned int generation = (intptr_t)v;
+
+    pthread_mutex_lock(&shared_lock);
+    for (;;) {
+        AVSliceThread *c;
+        int threadnr;
+
+        while (generation == shared_generation && !shared_tasks)
+            pthread_cond_wait(&shared_cond, &shared_lock);
+        if (generation != shared_generation)
+            break;
+
+        /* round robin between the contexts */
+        c = shared_tasks;
+        shared_dequeue(c);
+        threadnr = c->nb_slots++;
+        if (c->nb_slots < c->nb_threads && c->current_job < c->nb_jobs) {
+            c->queued = 1;
+            c->next   = NULL;
+            *shared_tasks_tail = c;
+            shared_tasks_tail  = &c->next;
+        }
+
+        shared_run_jobs(c, threadnr);
+    }
+    pthread_mutex_unlock(&shared_lock);
+
+    return NULL;
+}
+
+static void shared_pool_unref(void)
+{
+    pthread_t *workers;
+    int i, nb_workers;
+
+    pthread_mutex_lock(&shared_lock);
+    if (--shared_refcount) {
+        pthread_mutex_unlock(&shared_lock);
+        return;
+    }
+    /* a new pool may be started while these threads are joined */
+    shared_generation++;
+    workers           = shared_workers;
+    nb_workers        = shared_nb_workers;
+    shared_workers    = NULL;
+    shared_nb_workers = 0;
+    pthread_cond_broadcast(&shared_cond);
+    pthread_mutex_unlock(&shared_lock);
+
+    for (i = 0; i < nb_workers; i++)
+        pthread_join(workers[i], NULL);
+    av_free(workers);
+}
+
+static int shared_pool_ref(void)
+{
+    int i, ret = 0, nb_workers = av_cpu_count();
+
+    pthread_mutex_lock(&shared_lock);
+    if (shared_refcount++) {
+        pthread_mutex_unlock(&shared_lock);
+        return shared_nb_workers;
+    }
+
+    shared_tasks      = NULL;
+    shared_tasks_tail = &shared_tasks;
+    shared_workers    = av_mallocz(sizeof(*shared_workers) * nb_workers);
+    if (!shared_workers) {
+        shared_refcount = 0;
+        pthread_mutex_unlock(&shared_lock);
+        return AVERROR(ENOMEM);
+    }
+    for (i = 0; i < nb_workers; i++) {
+        if ((ret = pthread_create(&shared_workers[i], NULL, shared_worker,
+                                  (void *)(intptr_t)shared_generation)))
+            break;
+        shared_nb_workers++;
+    }
+    pthread_mutex_unlock(&shared_lock);
+
+    if (!shared_nb_workers) {
+        shared_pool_unref();
+        return AVERROR(ret);
+    }
+    return shared_nb_workers;
+}
+
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr,
+                                                         int nb_jobs, int nb_threads),
+                                     int nb_threads)
+{
+    AVSliceThread *c;
+    int ret;
+
+    *pctx = NULL;
+
+    if ((ret = shared_pool_ref()) < 0)
+        return ret;
+    /* the caller runs jobs too */
+    if (!nb_threads)
+        nb_threads = ret + 1;
+    if (nb_threads <= 1) {
+        shared_pool_unref();
+        return AVERROR(ENOSYS);
+    }
+
+    c = av_mallocz(sizeof(*c));
+    if (!c) {
+        shared_pool_unref();
+        return AVERROR(ENOMEM);
+    }
+    c->shared      = 1;
+    c->priv        = priv;
+    c->worker_func = worker_func;
+    c->nb_threads  = nb_threads;
+    pthread_cond_init(&c->last_job_cond, NULL);
+
+    *pctx = c;
+    return nb_threads;
+}
+
+static void shared_execute(AVSliceThread *c, int nb_jobs)
+{
+    int i;
+
+    pthread_mutex_lock(&shared_lock);
+    c->nb_jobs      = nb_jobs;
+    c->current_job  = 0;
+    c->nb_jobs_done = 0;
+    c->nb_slots     = 1;
+    if (nb_jobs > 1) {
+        c->queued = 1;
+        c->next   = NULL;
+        *shared_tasks_tail = c;
+        shared_tasks_tail  = &c->next;
+        for (i = 1; i < FFMIN(nb_jobs, c->nb_threads); i++)
+            pthread_cond_signal(&shared_cond);
+    }
+
+    shared_run_jobs(c, 0);
+    shared_dequeue(c);
+    while (c->nb_jobs_done < c->nb_jobs)
+        pthread_cond_wait(&c->last_job_cond, &shared_lock);
+    pthread_mutex_unlock(&shared_lock);
+}
+#else
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr,
+                                                         int nb_jobs, int nb_threads),
+                                     int nb_threads)
+{
+    *pctx = NULL;
+    return AVERROR(ENOSYS);
+}
+#endif
+
+int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
+                              void (*worker_func)(void *priv, int jobnr, int threadnr,
+                                                  int nb_jobs, int nb_threads),
+                              int nb_threads)
+{
+    AVSliceThread *c;
+    int i, ret;
+
+    *pctx = NULL;
+
+    if (!nb_threads) {
+        int nb_cpus = av_cpu_count();
+        // use number of cores + 1 as thread count if there is more than one
+        nb_threads = nb_cpus > 1 ? nb_cpus + 1 : 1;
+    }
+    if (nb_threads <= 1)
+        return AVERROR(ENOSYS);
+
+    c = av_mallocz(sizeof(*c));
+    if (!c)
+        return AVERROR(ENOMEM);
+    c->workers = av_mallocz(sizeof(*c->workers) * nb_threads);
+    if (!c->workers) {
+        av_free(c);
+        return AVERROR(ENOMEM);
+    }
+
+    c->priv        = priv;
+    c->worker_func = worker_func;
+    c->nb_threads  = nb_threads;
+
+    pthread_cond_init(&c->current_job_cond, NULL);
+    pthread_cond_init(&c->last_job_cond,    NULL);
+    pthread_mutex_init(&c->current_job_lock, NULL);
+
+    pthread_mutex_lock(&c->current_job_lock);
+    for (i = 0; i < nb_threads; i++) {
+        ret = pthread_create(&c->workers[i], NULL, worker, c);
+        if (ret) {
+            pthread_mutex_unlock(&c->current_job_lock);
+            c->nb_threads = i;
+            avpriv_slicethread_free(&c);
+            return AVERROR(ret);
+        }
+    }
+    park_workers(c);
+
+    *pctx = c;
+    return nb_threads;
+}
+
+void avpriv_slicethread_execute(AVSliceThread *c, int nb_jobs)
+{
+    if (nb_jobs <= 0)
+        return;
+
+#if HAVE_PTHREADS
+    if (c->shared) {
+        shared_execute(c, nb_jobs);
+        return;
+    }
+#endif
+
+    pthread_mutex_lock(&c->current_job_lock);
+    c->current_job = c->nb_threads;
+    c->nb_jobs     = nb_jobs;
+    c->current_execute++;
+    pthread_cond_broadcast(&c->current_job_cond);
+    park_workers(c);
+}
+
+void avpriv_slicethread_free(AVSliceThread **pctx)
+{
+    AVSliceThread *c = *pctx;
+    int i;
+
+    if (!c)
+        return;
+
+#if HAVE_PTHREADS
+    if (c->shared) {
+        pthread_cond_destroy(&c->last_job_cond);
+        av_freep(pctx);
+        shared_pool_unref();
+        return;
+    }
+#endif
+
+    pthread_mutex_lock(&c->current_job_lock);
+    c->done = 1;
+    pthread_cond_broadcast(&c->current_job_cond);
+    pthread_mutex_unlock(&c->current_job_lock);
+
+    for (i = 0; i < c->nb_threads; i++)
+        pthread_join(c->workers[i], NULL);
+
+    pthread_mutex_destroy(&c->current_job_lock);
+    pthread_cond_destroy(&c->current_job_cond);
+    pthread_cond_destroy(&c->last_job_cond);
+
+    av_freep(&c->workers);
+    av_freep(pctx);
+}
+
+#else /* HAVE_THREADS */
+
+int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
+                              void (*worker_func)(void *priv, int jobnr, int threadnr,
+                                                  int nb_jobs, int nb_threads),
+                              int nb_threads)
+{
+    *pctx = NULL;
+    return AVERROR(ENOSYS);
+}
+
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr,
+                                                         int nb_jobs, int nb_threads),
+                                     int nb_threads)
+{
+    *pctx = NULL;
+    return AVERROR(ENOSYS);
+}
+
+void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs)
+{
+    av_assert0(0);
+}
+
+void avpriv_slicethread_free(AVSliceThread **pctx)
+{
+}
+
+#endif /* HAVE_THREADS */
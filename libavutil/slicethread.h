@@ -0,0 +1,79 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_SLICETHREAD_H
+#define AVUTIL_SLICETHREAD_H
+
+/**
+ * @file
+ * Internal pool of worker threads executing numbered jobs, shared by the
+ * libraries which cannot use the libavcodec execute() callbacks.
+ */
+
+typedef struct AVSliceThread AVSliceThread;
+
+/**
+ * Create a pool of worker threads.
+ *
+ * @param pctx        the pool is returned here
+ * @param priv        opaque pointer passed to worker_func
+ * @param worker_func function called once for each job
+ * @param nb_threads  number of threads, 0 to pick one per logical CPU core
+ *
+ * @return the number of threads started (at least 2) on success,
+ *         a negative AVERROR code on failure, in particular AVERROR(ENOSYS)
+ *         if threading is not available or no more than one thread would
+ *         be used. The caller should then run its jobs sequentially.
+ */
+int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
+                              void (*worker_func)(void *priv, int jobnr, int threadnr,
+                                                  int nb_jobs, int nb_threads),
+                              int nb_threads);
+
+/**
+ * Create a context running its jobs on a pool of threads shared by the
+ * whole process, instead of starting threads of its own.
+ *
+ * The threads of the shared pool take jobs from the execute calls of all
+ * shared contexts, the thread calling avpriv_slicethread_execute() runs
+ * jobs as well. Jobs of one execute call are started in increasing order.
+ *
+ * @param nb_threads maximum number of threads running jobs of this context
+ *                   at the same time, including the caller; threadnr is
+ *                   always lower than this value. 0 to allow all threads
+ *                   of the pool.
+ *
+ * @return the maximum number of threads (at least 2) on success, a negative
+ *         AVERROR code on failure, like avpriv_slicethread_create()
+ */
+int avpriv_slicethread_create_shared(AVSliceThread **pctx, void *priv,
+                                     void (*worker_func)(void *priv, int jobnr, int threadnr,
+                                                         int nb_jobs, int nb_threads),
+                                     int nb_threads);
+
+/**
+ * Run nb_jobs jobs on the pool and wait for all of them to finish.
+ */
+void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs);
+
+/**
+ * Stop and join the worker threads, free the pool and set *pctx to NULL.
+ */
+void avpriv_slicethread_free(AVSliceThread **pctx);
+
+#endif /* AVUTIL_SLICETHREAD_H */
@@ -0,0 +1,107 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "atomic.h"
+#include "common.h"
+#include "error.h"
+#include "mem.h"
+#include "spscqueue.h"
+
+struct AVSPSCQueue {
+    uint8_t *buffer;
+    unsigned int mask;
+    unsigned int elem_size;
+    /* Both indexes only ever increase (modulo 2^32), the number of
+     * elements in the queue is their difference. Each one is only written
+     * by one side, with a full barrier after the element was copied. */
+    volatile int windex;
+    volatile int rindex;
+};
+
+AVSPSCQueue *av_spsc_queue_alloc(unsigned int nb_elems, unsigned int elem_size)
+{
+    AVSPSCQueue *q;
+    unsigned int size = 1;
+
+    if (!nb_elems || !elem_size || nb_elems > INT_MAX / 2)
+        return NULL;
+    while (size < nb_elems)
+        size <<= 1;
+    if (size > INT_MAX / elem_size)
+        return NULL;
+
+    q = av_mallocz(sizeof(*q));
+    if (!q)
+        return NULL;
+    q->buffer = av_malloc(size * elem_size);
+    if (!q->buffer) {
+        av_free(q);
+        return NULL;
+    }
+    q->mask      = size - 1;
+    q->elem_size = elem_size;
+    return q;
+}
+
+void av_spsc_queue_free(AVSPSCQueue **q)
+{
+    if (!*q)
+        return;
+    av_free((*q)->buffer);
+    av_freep(q);
+}
+
+/* load the index written by the other side, with barriers on both sides */
+static unsigned int load_index(volatile int *index)
+{
+    return avpriv_atomic_int_add_and_fetch(index, 0);
+}
+
+int av_spsc_queue_write(AVSPSCQueue *q, const void *elem)
+{
+    unsigned int w = q->windex;
+
+    if (w - load_index(&q->rindex) > q->mask)
+        return AVERROR(EAGAIN);
+    memcpy(q->buffer + (w & q->mask) * q->elem_size, elem, q->elem_size);
+    avpriv_atomic_int_add_and_fetch(&q->windex, 1);
+    return 0;
+}
+
+int av_spsc_queue_read(AVSPSCQueue *q, void *elem)
+{
+    unsigned int r = q->rindex;
+
+    if (load_index(&q->windex) == r)
+        return AVERROR(EAGAIN);
+    memcpy(elem, q->buffer + (r & q->mask) * q->elem_size, q->elem_size);
+    avpriv_atomic_int_add_and_fetch(&q->rindex, 1);
+    return 0;
+}
+
+unsigned int av_spsc_queue_size(AVSPSCQueue *q)
+{
+    return load_index(&q->windex) - load_index(&q->rindex);
+}
+
+unsigned int av_spsc_queue_space(AVSPSCQueue *q)
+{
+    return q->mask + 1 - av_spsc_queue_size(q);
+}
@@ -0,0 +1,80 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Lock-free single producer, single consumer queue of fixed size elements.
+ */
+
+#ifndef AVUTIL_SPSCQUEUE_H
+#define AVUTIL_SPSCQUEUE_H
+
+/**
+ * A queue which can be written by one thread and read by another thread
+ * at the same time, without locking.
+ *
+ * Only one thread may write to the queue and only one thread may read
+ * from it. The queue never blocks: waiting for data or for space, and the
+ * wakeups that go with it, are left to the caller.
+ */
+typedef struct AVSPSCQueue AVSPSCQueue;
+
+/**
+ * Allocate a queue.
+ *
+ * @param nb_elems  maximum number of elements in the queue, rounded up to
+ *                  a power of 2
+ * @param elem_size size of an element in bytes
+ * @return the queue or NULL in case of memory allocation failure
+ */
+AVSPSCQueue *av_spsc_queue_alloc(unsigned int nb_elems, unsigned int elem_size);
+
+/**
+ * Free a queue and set *q to NULL. The elements still in the queue are
+ * not freed.
+ */
+void av_spsc_queue_free(AVSPSCQueue **q);
+
+/**
+ * Add an element to the queue. Must only be called by the producer.
+ *
+ * @param elem element of elem_size bytes to copy into the queue
+ * @return 0 on success, AVERROR(EAGAIN) if the queue is full
+ */
+int av_spsc_queue_write(AVSPSCQueue *q, const void *elem);
+
+/**
+ * Remove the oldest element from the queue. Must only be called by the
+ * consumer.
+ *
+ * @param elem buffer of elem_size bytes the element is copied to
+ * @return 0 on success, AVERROR(EAGAIN) if the queue is empty
+ */
+int av_spsc_queue_read(AVSPSCQueue *q, void *elem);
+
+/**
+ * @return the number of elements in the queue
+ */
+unsigned int av_spsc_queue_size(AVSPSCQueue *q);
+
+/**
+ * @return the number of elements that can be added to the queue
+ */
+unsigned int av_spsc_queue_space(AVSPSCQueue *q);
+
+#endif /* AVUTIL_SPSCQUEUE_H */
@@ -20,6 +20,7 @@
 
 #include "config.h"
 
+#include <limits.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <time.h>
@@ -34,6 +35,7 @@
 #endif
 
 #include "libavutil/time.h"
+#include "common.h"
 #include "error.h"
 
 int64_t av_gettime(void)
@@ -53,6 +55,30 @@ int64_t av_gettime(void)
 #endif
 }
 
+int64_t av_gettime_relative(void)
+{
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    if (!clock_gettime(CLOCK_MONOTONIC, &ts))
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+    return av_gettime();
+}
+
+int av_usleep_until(int64_t t)
+{
+    int64_t now;
+#if HAVE_CLOCK_GETTIME && HAVE_CLOCK_NANOSLEEP && defined(CLOCK_MONOTONIC)
+    struct timespec ts = { t / 1000000, t % 1000000 * 1000 };
+    int ret;
+    while ((ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) == EINTR);
+    if (!ret)
+        return 0;
+#endif
+    now = av_gettime_relative();
+    return t > now ? av_usleep(FFMIN(t - now, UINT_MAX)) : 0;
+}
+
 int av_usleep(unsigned usec)
 {
 #if HAVE_NANOSLEEP
@@ -28,6 +28,25 @@
  */
 int64_t av_gettime(void);
 
+/**
+ * Get the current time in microseconds since some unspecified starting
+ * point. On platforms that support it, the time comes from a monotonic
+ * clock, which makes it suitable for measuring intervals and scheduling
+ * deadlines, as it is not affected by changes of the wall clock time.
+ */
+int64_t av_gettime_relative(void);
+
+/**
+ * Sleep until an absolute point in time, given on the av_gettime_relative()
+ * clock. Unlike successive av_usleep() calls, repeatedly sleeping until
+ * deadlines derived from a common start does not accumulate the wakeup
+ * latency of each sleep.
+ *
+ * @param  t Time in microseconds, as returned by av_gettime_relative().
+ * @return zero on success or (negative) error code.
+ */
+int av_usleep_until(int64_t t);
+
 /**
  * Sleep for a period of time.  Although the duration is expressed in
  * microseconds, the actual delay may be rounded to the precision of the
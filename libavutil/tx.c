@@ -0,0 +1,505 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * FFT and MDCT of length m * 2^k.
+ *
+ * The power of two part is a split-radix FFT, the same as the one of
+ * libavcodec. Lengths with an odd factor m = 3, 5 or 15 use the prime
+ * factor algorithm: as m and 2^k are coprime, the FFT is a 2D transform
+ * of m FFTs of length 2^k followed by 2^k transforms of length m, without
+ * twiddle factors in between. The index mappings, including the split-radix
+ * permutation and the reversal of the input for the inverse transform,
+ * are precomputed in the plan. The MDCT uses an FFT of a quarter of its
+ * input length with pre- and post-rotation.
+ */
+
+#include <math.h>
+
+#include "common.h"
+#include "error.h"
+#include "mathematics.h"
+#include "mem.h"
+#include "tx.h"
+
+#define MAX_LOG2_LEN 24
+
+struct AVTXContext {
+    int n;                          ///< power of two factor of the FFT length
+    int nbits;                      ///< log2(n)
+    int m;                          ///< odd factor of the FFT length, 1, 3, 5 or 15
+    int *in_map;                    ///< input index of each element of the permuted FFT input
+    int *out_map;                   ///< output index of each output of the length m transforms
+    AVComplexFloat *tmp;            ///< scratch buffer of the prime factor algorithm
+    float *cos_tabs[MAX_LOG2_LEN];  ///< cos(2 * M_PI * i / (1 << b)) for i = 0..(1 << b) / 4, b >= 5
+
+    int mdct_len;                   ///< number of MDCT coefficients
+    float *tcos, *tsin;             ///< MDCT pre- and post-rotation factors
+    AVComplexFloat *mdct_in;        ///< FFT input of the MDCT
+    AVComplexFloat *mdct_out;       ///< FFT output of the MDCT
+};
+
+#define BF(x, y, a, b) do {                     \
+        x = a - b;                              \
+        y = a + b;                              \
+    } while (0)
+
+#define CMUL(dre, dim, are, aim, bre, bim) do { \
+        (dre) = (are) * (bre) - (aim) * (bim);  \
+        (dim) = (are) * (bim) + (aim) * (bre);  \
+    } while (0)
+
+#define BUTTERFLIES(a0, a1, a2, a3) {           \
+        BF(t3, t5, t5, t1);                     \
+        BF(a2.re, a0.re, a0.re, t5);            \
+        BF(a3.im, a1.im, a1.im, t3);            \
+        BF(t4, t6, t2, t6);                     \
+        BF(a3.re, a1.re, a1.re, t4);            \
+        BF(a2.im, a0.im, a0.im, t6);            \
+    }
+
+#define TRANSFORM(a0, a1, a2, a3, wre, wim) {   \
+        CMUL(t1, t2, a2.re, a2.im, wre, -wim);  \
+        CMUL(t5, t6, a3.re, a3.im, wre,  wim);  \
+        BUTTERFLIES(a0, a1, a2, a3)             \
+    }
+
+#define TRANSFORM_ZERO(a0, a1, a2, a3) {        \
+        t1 = a2.re;                             \
+        t2 = a2.im;                             \
+        t5 = a3.re;                             \
+        t6 = a3.im;                             \
+        BUTTERFLIES(a0, a1, a2, a3)             \
+    }
+
+/* z[0...8n-1], w[1...2n-1] */
+static void pass(AVComplexFloat *z, const float *wre, unsigned int n)
+{
+    float t1, t2, t3, t4, t5, t6;
+    int o1 = 2 * n;
+    int o2 = 4 * n;
+    int o3 = 6 * n;
+    const float *wim = wre + o1;
+    n--;
+
+    TRANSFORM_ZERO(z[0], z[o1], z[o2], z[o3]);
+    TRANSFORM(z[1], z[o1+1], z[o2+1], z[o3+1], wre[1], wim[-1]);
+    do {
+        z   += 2;
+        wre += 2;
+        wim -= 2;
+        TRANSFORM(z[0], z[o1],   z[o2],   z[o3],   wre[0], wim[ 0]);
+        TRANSFORM(z[1], z[o1+1], z[o2+1], z[o3+1], wre[1], wim[-1]);
+    } while (--n);
+}
+
+static void fft2(AVComplexFloat *z)
+{
+    AVComplexFloat t = z[1];
+
+    BF(z[1].re, z[0].re, z[0].re, t.re);
+    BF(z[1].im, z[0].im, z[0].im, t.im);
+}
+
+static void fft4(AVComplexFloat *z)
+{
+    float t1, t2, t3, t4, t5, t6, t7, t8;
+
+    BF(t3, t1, z[0].re, z[1].re);
+    BF(t8, t6, z[3].re, z[2].re);
+    BF(z[2].re, z[0].re, t1, t6);
+    BF(t4, t2, z[0].im, z[1].im);
+    BF(t7, t5, z[2].im, z[3].im);
+    BF(z[3].im, z[1].im, t4, t8);
+    BF(z[3].re, z[1].re, t3, t7);
+    BF(z[2].im, z[0].im, t2, t5);
+}
+
+static void fft8(AVComplexFloat *z)
+{
+    float t1, t2, t3, t4, t5, t6;
+
+    fft4(z);
+
+    BF(t1, z[5].re, z[4].re, -z[5].re);
+    BF(t2, z[5].im, z[4].im, -z[5].im);
+    BF(t5, z[7].re, z[6].re, -z[7].re);
+    BF(t6, z[7].im, z[6].im, -z[7].im);
+
+    BUTTERFLIES(z[0], z[2], z[4], z[6]);
+    TRANSFORM(z[1], z[3], z[5], z[7], M_SQRT1_2, M_SQRT1_2);
+}
+
+static void fft16(AVComplexFloat *z)
+{
+    float t1, t2, t3, t4, t5, t6;
+    const float cos_16_1 = 0.92387953251128675613;
+    const float cos_16_3 = 0.38268343236508977173;
+
+    fft8(z);
+    fft4(z + 8);
+    fft4(z + 12);
+
+    TRANSFORM_ZERO(z[0], z[4], z[8],  z[12]);
+    TRANSFORM(z[2], z[6], z[10], z[14], M_SQRT1_2, M_SQRT1_2);
+    TRANSFORM(z[1], z[5], z[9],  z[13], cos_16_1,  cos_16_3);
+    TRANSFORM(z[3], z[7], z[11], z[15], cos_16_3,  cos_16_1);
+}
+
+/* in place split-radix FFT of 1 << nbits elements in permuted order */
+static void fft_sr(float *const *cos_tabs, AVComplexFloat *z, int nbits)
+{
+    int n4;
+
+    switch (nbits) {
+    case 0:                return;
+    case 1: fft2(z);       return;
+    case 2: fft4(z);       return;
+    case 3: fft8(z);       return;
+    case 4: fft16(z);      return;
+    }
+
+    n4 = 1 << (nbits - 2);
+    fft_sr(cos_tabs, z,          nbits - 1);
+    fft_sr(cos_tabs, z + n4 * 2, nbits - 2);
+    fft_sr(cos_tabs, z + n4 * 3, nbits - 2);
+    pass(z, cos_tabs[nbits], n4 / 2);
+}
+
+static void fft3(AVComplexFloat *z)
+{
+    const float s3 = 0.86602540378443864676; // sin(2 * M_PI / 3)
+    float tre, tim, dre, dim;
+
+    BF(dre, tre, z[1].re, z[2].re);
+    BF(dim, tim, z[1].im, z[2].im);
+    z[1].re = z[0].re - 0.5f * tre;
+    z[1].im = z[0].im - 0.5f * tim;
+    z[0].re += tre;
+    z[0].im += tim;
+    z[2].re = z[1].re - s3 * dim;
+    z[2].im = z[1].im + s3 * dre;
+    z[1].re += s3 * dim;
+    z[1].im -= s3 * dre;
+}
+
+static void fft5(AVComplexFloat *z)
+{
+    const float c1 =  0.30901699437494742410; // cos(2 * M_PI / 5)
+    const float c2 = -0.80901699437494742410; // cos(4 * M_PI / 5)
+    const float s1 =  0.95105651629515357212; // sin(2 * M_PI / 5)
+    const float s2 =  0.58778525229247312917; // sin(4 * M_PI / 5)
+    AVComplexFloat t1, t2, t3, t4, a, b, c, d;
+
+    BF(t3.re, t1.re, z[1].re, z[4].re);
+    BF(t3.im, t1.im, z[1].im, z[4].im);
+    BF(t4.re, t2.re, z[2].re, z[3].re);
+    BF(t4.im, t2.im, z[2].im, z[3].im);
+
+    a.re = z[0].re + c1 * t1.re + c2 * t2.re;
+    a.im = z[0].im + c1 * t1.im + c2 * t2.im;
+    b.re = s1 * t3.re + s2 * t4.re;
+    b.im = s1 * t3.im + s2 * t4.im;
+    c.re = z[0].re + c2 * t1.re + c1 * t2.re;
+    c.im = z[0].im + c2 * t1.im + c1 * t2.im;
+    d.re = s2 * t3.re - s1 * t4.re;
+    d.im = s2 * t3.im - s1 * t4.im;
+
+    z[0].re += t1.re + t2.re;
+    z[0].im += t1.im + t2.im;
+    z[1].re = a.re + b.im;
+    z[1].im = a.im - b.re;
+    z[4].re = a.re - b.im;
+    z[4].im = a.im + b.re;
+    z[2].re = c.re + d.im;
+    z[2].im = c.im - d.re;
+    z[3].re = c.re - d.im;
+    z[3].im = c.im + d.re;
+}
+
+/* prime factor algorithm with 3 and 5, same as for the full FFT */
+static void fft15(AVComplexFloat *z)
+{
+    static const uint8_t in_map[15]  = { 0,  3,  6, 9, 12, 5, 8, 11, 14, 2, 10, 13, 1, 4,  7 };
+    static const uint8_t out_map[15] = { 0, 10,  5, 6,  1, 11, 12, 7, 2, 3, 13,  8, 9, 4, 14 };
+    AVComplexFloat t[15];
+    int i, j;
+
+    for (i = 0; i < 15; i++)
+        t[i] = z[in_map[i]];
+    for (i = 0; i < 3; i++)
+        fft5(t + 5 * i);
+    for (j = 0; j < 5; j++) {
+        AVComplexFloat c[3] = { t[j], t[5 + j], t[10 + j] };
+        fft3(c);
+        for (i = 0; i < 3; i++)
+            z[out_map[3 * j + i]] = c[i];
+    }
+}
+
+static void fft(AVTXContext *s, AVComplexFloat *out, const AVComplexFloat *in)
+{
+    int i, j, n = s->n, m = s->m;
+
+    if (m == 1) {
+        for (i = 0; i < n; i++)
+            out[i] = in[s->in_map[i]];
+        fft_sr(s->cos_tabs, out, s->nbits);
+        return;
+    }
+
+    for (i = 0; i < m * n; i++)
+        s->tmp[i] = in[s->in_map[i]];
+    for (i = 0; i < m; i++)
+        fft_sr(s->cos_tabs, s->tmp + i * n, s->nbits);
+    for (i = 0; i < n; i++) {
+        AVComplexFloat z[15];
+        const int *out_map = s->out_map + i * m;
+
+        for (j = 0; j < m; j++)
+            z[j] = s->tmp[j * n + i];
+        switch (m) {
+        case 3:  fft3(z);  break;
+        case 5:  fft5(z);  break;
+        case 15: fft15(z); break;
+        }
+        for (j = 0; j < m; j++)
+            out[out_map[j]] = z[j];
+    }
+}
+
+static void fft_float(AVTXContext *s, void *out, void *in, ptrdiff_t stride)
+{
+    fft(s, out, in);
+}
+
+static void mdct_float(AVTXContext *s, void *_out, void *_in, ptrdiff_t stride)
+{
+    const float *in = _in;
+    float *out      = _out;
+    AVComplexFloat *x = s->mdct_in, *z = s->mdct_out;
+    const float *tcos = s->tcos, *tsin = s->tsin;
+    int i, n2 = s->mdct_len, n = 2 * n2, n4 = n2 / 2, n8 = n2 / 4, n3 = 3 * n4;
+
+    stride /= sizeof(*out);
+
+    /* pre rotation */
+    for (i = 0; i < n8; i++) {
+        float re, im;
+
+        re = -in[2*i+n3] - in[n3-1-2*i];
+        im = -in[n4+2*i] + in[n4-1-2*i];
+        CMUL(x[i].re, x[i].im, re, im, -tcos[i], tsin[i]);
+
+        re =  in[2*i]    - in[n2-1-2*i];
+        im = -in[n2+2*i] - in[n-1-2*i];
+        CMUL(x[n8+i].re, x[n8+i].im, re, im, -tcos[n8+i], tsin[n8+i]);
+    }
+
+    fft(s, z, x);
+
+    /* post rotation */
+    for (i = 0; i < n8; i++) {
+        float r0, i0, r1, i1;
+
+        CMUL(i1, r0, z[n8-i-1].re, z[n8-i-1].im, -tsin[n8-i-1], -tcos[n8-i-1]);
+        CMUL(i0, r1, z[n8+i  ].re, z[n8+i  ].im, -tsin[n8+i  ], -tcos[n8+i  ]);
+        out[(2 * (n8-i-1)    ) * stride] = r0;
+        out[(2 * (n8-i-1) + 1) * stride] = i0;
+        out[(2 * (n8+i)      ) * stride] = r1;
+        out[(2 * (n8+i)   + 1) * stride] = i1;
+    }
+}
+
+static void imdct_float(AVTXContext *s, void *_out, void *_in, ptrdiff_t stride)
+{
+    const float *in = _in;
+    AVComplexFloat *out = _out;
+    AVComplexFloat *x = s->mdct_in, *z = s->mdct_out;
+    const float *tcos = s->tcos, *tsin = s->tsin;
+    int k, n2 = s->mdct_len, n4 = n2 / 2, n8 = n2 / 4;
+
+    stride /= sizeof(*in);
+
+    /* pre rotation */
+    for (k = 0; k < n4; k++)
+        CMUL(x[k].re, x[k].im, in[(n2 - 1 - 2 * k) * stride], in[2 * k * stride],
+             tcos[k], tsin[k]);
+
+    fft(s, z, x);
+
+    /* post rotation and reordering */
+    for (k = 0; k < n8; k++) {
+        float r0, i0, r1, i1;
+
+        CMUL(r0, i1, z[n8-k-1].im, z[n8-k-1].re, tsin[n8-k-1], tcos[n8-k-1]);
+        CMUL(r1, i0, z[n8+k  ].im, z[n8+k  ].re, tsin[n8+k  ], tcos[n8+k  ]);
+        out[n8-k-1].re = r0;
+        out[n8-k-1].im = i0;
+        out[n8+k  ].re = r1;
+        out[n8+k  ].im = i1;
+    }
+}
+
+static int split_radix_permutation(int i, int n)
+{
+    int m;
+
+    if (n <= 2)
+        return i & 1;
+    m = n >> 1;
+    if (!(i & m))
+        return split_radix_permutation(i, m) * 2;
+    m >>= 1;
+    if (i & m)
+        return split_radix_permutation(i, m) * 4 + 1;
+    else
+        return split_radix_permutation(i, m) * 4 - 1;
+}
+
+static int fft_init(AVTXContext *s, int len, int inv)
+{
+    int i, j, b;
+
+    for (s->m = 15; s->m > 1; s->m = s->m == 15 ? 5 : s->m - 2)
+        if (!(len % s->m))
+            break;
+    len /= s->m;
+    if (len & (len - 1))
+        return AVERROR(EINVAL);
+    s->n     = len;
+    s->nbits = av_log2(len);
+    if (s->nbits >= MAX_LOG2_LEN)
+        return AVERROR(EINVAL);
+    len *= s->m;
+
+    for (b = 5; b <= s->nbits; b++) {
+        int size = 1 << b;
+        if (!(s->cos_tabs[b] = av_malloc((size / 4 + 1) * sizeof(float))))
+            return AVERROR(ENOMEM);
+        for (i = 0; i <= size / 4; i++)
+            s->cos_tabs[b][i] = cos(2 * M_PI * i / size);
+    }
+
+    /* The inverse transform is the forward transform of the input in
+     * reverse order, in[(len - i) % len]. */
+    if (!(s->in_map = av_malloc(len * sizeof(*s->in_map))))
+        return AVERROR(ENOMEM);
+    for (j = 0; j < s->m; j++) {
+        for (i = 0; i < s->n; i++) {
+            int k = -split_radix_permutation(i, s->n) & (s->n - 1);
+            k = (s->n * j + s->m * k) % len;
+            s->in_map[j * s->n + i] = inv ? (len - k) % len : k;
+        }
+    }
+
+    if (s->m > 1) {
+        s->out_map = av_malloc(len * sizeof(*s->out_map));
+        s->tmp     = av_malloc(len * sizeof(*s->tmp));
+        if (!s->out_map || !s->tmp)
+            return AVERROR(ENOMEM);
+        for (i = 0; i < len; i++)
+            s->out_map[(i % s->n) * s->m + i % s->m] = i;
+    }
+    return 0;
+}
+
+static int mdct_init(AVTXContext *s, int len, int inv, float scale)
+{
+    int i, ret, n = 2 * len, n4 = len / 2;
+    double theta;
+
+    if (len % 4)
+        return AVERROR(EINVAL);
+    if ((ret = fft_init(s, n4, inv)) < 0)
+        return ret;
+    s->mdct_len = len;
+
+    s->tcos     = av_malloc(n4 * sizeof(*s->tcos));
+    s->tsin     = av_malloc(n4 * sizeof(*s->tsin));
+    s->mdct_in  = av_malloc(n4 * sizeof(*s->mdct_in));
+    s->mdct_out = av_malloc(n4 * sizeof(*s->mdct_out));
+    if (!s->tcos || !s->tsin || !s->mdct_in || !s->mdct_out)
+        return AVERROR(ENOMEM);
+
+    /* The rotations are applied twice, rotating them by a quarter turn
+     * negates the output. The inverse transform needs it for a positive
+     * scale already. */
+    theta = 1.0 / 8.0 + ((scale < 0) != inv ? n4 : 0);
+    scale = sqrt(fabs(scale));
+    for (i = 0; i < n4; i++) {
+        double alpha = 2 * M_PI * (i + theta) / n;
+        s->tcos[i] = -cos(alpha) * scale;
+        s->tsin[i] = -sin(alpha) * scale;
+    }
+    return 0;
+}
+
+int av_tx_init(AVTXContext **ctx, av_tx_fn *tx, enum AVTXType type,
+               int inv, int len, const void *scale, uint64_t flags)
+{
+    AVTXContext *s;
+    int ret;
+
+    if (len <= 0 || flags)
+        return AVERROR(EINVAL);
+
+    s = av_mallocz(sizeof(*s));
+    if (!s)
+        return AVERROR(ENOMEM);
+
+    switch (type) {
+    case AV_TX_FLOAT_FFT:
+        ret = fft_init(s, len, inv);
+        *tx = fft_float;
+        break;
+    case AV_TX_FLOAT_MDCT:
+        ret = mdct_init(s, len, inv, *(const float *)scale);
+        *tx = inv ? imdct_float : mdct_float;
+        break;
+    default:
+        ret = AVERROR(EINVAL);
+    }
+
+    if (ret < 0) {
+        av_tx_uninit(&s);
+        return ret;
+    }
+    *ctx = s;
+    return 0;
+}
+
+void av_tx_uninit(AVTXContext **ctx)
+{
+    AVTXContext *s = *ctx;
+    int i;
+
+    if (!s)
+        return;
+    for (i = 0; i < MAX_LOG2_LEN; i++)
+        av_free(s->cos_tabs[i]);
+    av_free(s->in_map);
+    av_free(s->out_map);
+    av_free(s->tmp);
+    av_free(s->tcos);
+    av_free(s->tsin);
+    av_free(s->mdct_in);
+    av_free(s->mdct_out);
+    av_freep(ctx);
+}
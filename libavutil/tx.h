@@ -0,0 +1,95 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * FFT and MDCT of any length of the form m * 2^k, with m = 1, 3, 5 or 15.
+ */
+
+#ifndef AVUTIL_TX_H
+#define AVUTIL_TX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A transform plan. Everything that only depends on the type and length
+ * of the transform is computed once by av_tx_init(), so a plan can be
+ * reused for any number of transforms.
+ */
+typedef struct AVTXContext AVTXContext;
+
+typedef struct AVComplexFloat {
+    float re, im;
+} AVComplexFloat;
+
+enum AVTXType {
+    /**
+     * Complex to complex FFT of len AVComplexFloat.
+     * The forward transform computes
+     * out[k] = sum(in[n] * exp(-2 * M_PI * I * n * k / len)), the inverse
+     * uses exp(+2 * M_PI * I * n * k / len). Neither is normalized.
+     * scale is unused, stride is ignored.
+     */
+    AV_TX_FLOAT_FFT = 0,
+    /**
+     * MDCT with len output coefficients, len must be a multiple of 4.
+     * The forward transform takes 2 * len input samples and computes
+     * out[k] = scale * sum(in[n] * cos(M_PI / len * (n + 0.5 + len / 2) * (k + 0.5))).
+     * The inverse transform takes len coefficients and outputs the len
+     * samples from len / 2 to 3 * len / 2 - 1 of the same sum taken over
+     * k, the other samples follow from the symmetries of the transform.
+     * scale is a pointer to a float. stride is the distance in bytes
+     * between two coefficients, in the output of the forward transform
+     * and in the input of the inverse transform.
+     */
+    AV_TX_FLOAT_MDCT = 1,
+};
+
+/**
+ * Function pointer to a transform.
+ *
+ * @param s      the plan
+ * @param out    output, must not overlap with in
+ * @param in     input
+ * @param stride see the transform type
+ */
+typedef void (*av_tx_fn)(AVTXContext *s, void *out, void *in, ptrdiff_t stride);
+
+/**
+ * Create a transform plan.
+ *
+ * @param ctx   set to the new plan
+ * @param tx    set to the function running the transform
+ * @param type  type of the transform
+ * @param inv   0 for the forward transform, 1 for the inverse
+ * @param len   length of the transform, see the transform type
+ * @param scale type specific scale factor, see the transform type
+ * @param flags currently unused, must be 0
+ * @return 0 on success, AVERROR(EINVAL) if the length or type is not
+ *         supported, AVERROR(ENOMEM) on allocation failure
+ */
+int av_tx_init(AVTXContext **ctx, av_tx_fn *tx, enum AVTXType type,
+               int inv, int len, const void *scale, uint64_t flags);
+
+/**
+ * Free a transform plan and set *ctx to NULL.
+ */
+void av_tx_uninit(AVTXContext **ctx);
+
+#endif /* AVUTIL_TX_H */
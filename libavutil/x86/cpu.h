@@ -39,6 +39,7 @@
 #define EXTERNAL_SSE4(flags)        CPUEXT(flags, _EXTERNAL, SSE4)
 #define EXTERNAL_SSE42(flags)       CPUEXT(flags, _EXTERNAL, SSE42)
 #define EXTERNAL_AVX(flags)         CPUEXT(flags, _EXTERNAL, AVX)
+#define EXTERNAL_AVX2(flags)        CPUEXT(flags, _EXTERNAL, AVX2)
 #define EXTERNAL_FMA4(flags)        CPUEXT(flags, _EXTERNAL, FMA4)
 
 #define INLINE_AMD3DNOW(flags)      CPUEXT(flags, _INLINE, AMD3DNOW)
@@ -52,6 +53,7 @@
 #define INLINE_SSE4(flags)          CPUEXT(flags, _INLINE, SSE4)
 #define INLINE_SSE42(flags)         CPUEXT(flags, _INLINE, SSE42)
 #define INLINE_AVX(flags)           CPUEXT(flags, _INLINE, AVX)
+#define INLINE_AVX2(flags)          CPUEXT(flags, _INLINE, AVX2)
 #define INLINE_FMA4(flags)          CPUEXT(flags, _INLINE, FMA4)
 
 void ff_cpu_cpuid(int index, int *eax, int *ebx, int *ecx, int *edx);
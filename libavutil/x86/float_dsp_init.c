@@ -20,6 +20,7 @@
 
 #include "libavutil/cpu.h"
 #include "libavutil/float_dsp.h"
+#include "asm.h"
 #include "cpu.h"
 
 extern void ff_vector_fmul_sse(float *dst, const float *src0, const float *src1,
@@ -40,14 +41,276 @@ extern void ff_vector_dmul_scalar_sse2(double *dst, const double *src,
 extern void ff_vector_dmul_scalar_avx(double *dst, const double *src,
                                       double mul, int len);
 
+extern void ff_vector_fmul_add_sse(float *dst, const float *src0,
+                                   const float *src1, const float *src2,
+                                   int len);
+extern void ff_vector_fmul_add_avx(float *dst, const float *src0,
+                                   const float *src1, const float *src2,
+                                   int len);
+
+extern void ff_vector_fmul_reverse_sse(float *dst, const float *src0,
+                                       const float *src1, int len);
+extern void ff_vector_fmul_reverse_avx(float *dst, const float *src0,
+                                       const float *src1, int len);
+
+extern float ff_scalarproduct_float_sse(const float *v1, const float *v2,
+                                        int order);
+
+#if HAVE_INLINE_ASM
+#if HAVE_6REGS
+static void vector_fmul_window_3dnowext(float *dst, const float *src0,
+                                        const float *src1, const float *win,
+                                        int len)
+{
+    x86_reg i = -len * 4;
+    x86_reg j =  len * 4 - 8;
+    __asm__ volatile (
+        "1:                             \n"
+        "pswapd (%5, %1), %%mm1         \n"
+        "movq   (%5, %0), %%mm0         \n"
+        "pswapd (%4, %1), %%mm5         \n"
+        "movq   (%3, %0), %%mm4         \n"
+        "movq      %%mm0, %%mm2         \n"
+        "movq      %%mm1, %%mm3         \n"
+        "pfmul     %%mm4, %%mm2         \n" // src0[len + i] * win[len + i]
+        "pfmul     %%mm5, %%mm3         \n" // src1[j]       * win[len + j]
+        "pfmul     %%mm4, %%mm1         \n" // src0[len + i] * win[len + j]
+        "pfmul     %%mm5, %%mm0         \n" // src1[j]       * win[len + i]
+        "pfadd     %%mm3, %%mm2         \n"
+        "pfsub     %%mm0, %%mm1         \n"
+        "pswapd    %%mm2, %%mm2         \n"
+        "movq      %%mm1, (%2, %0)      \n"
+        "movq      %%mm2, (%2, %1)      \n"
+        "sub          $8, %1            \n"
+        "add          $8, %0            \n"
+        "jl           1b                \n"
+        "femms                          \n"
+        : "+r"(i), "+r"(j)
+        : "r"(dst + len), "r"(src0 + len), "r"(src1), "r"(win + len)
+    );
+}
+
+static void vector_fmul_window_sse(float *dst, const float *src0,
+                                   const float *src1, const float *win, int len)
+{
+    x86_reg i = -len * 4;
+    x86_reg j =  len * 4 - 16;
+    __asm__ volatile (
+        "1:                             \n"
+        "movaps      (%5, %1), %%xmm1   \n"
+        "movaps      (%5, %0), %%xmm0   \n"
+        "movaps      (%4, %1), %%xmm5   \n"
+        "movaps      (%3, %0), %%xmm4   \n"
+        "shufps $0x1b, %%xmm1, %%xmm1   \n"
+        "shufps $0x1b, %%xmm5, %%xmm5   \n"
+        "movaps        %%xmm0, %%xmm2   \n"
+        "movaps        %%xmm1, %%xmm3   \n"
+        "mulps         %%xmm4, %%xmm2   \n" // src0[len + i] * win[len + i]
+        "mulps         %%xmm5, %%xmm3   \n" // src1[j]       * win[len + j]
+        "mulps         %%xmm4, %%xmm1   \n" // src0[len + i] * win[len + j]
+        "mulps         %%xmm5, %%xmm0   \n" // src1[j]       * win[len + i]
+        "addps         %%xmm3, %%xmm2   \n"
+        "subps         %%xmm0, %%xmm1   \n"
+        "shufps $0x1b, %%xmm2, %%xmm2   \n"
+        "movaps        %%xmm1, (%2, %0) \n"
+        "movaps        %%xmm2, (%2, %1) \n"
+        "sub              $16, %1       \n"
+        "add              $16, %0       \n"
+        "jl                1b           \n"
+        : "+r"(i), "+r"(j)
+        : "r"(dst + len), "r"(src0 + len), "r"(src1), "r"(win + len)
+    );
+}
+#endif /* HAVE_6REGS */
+
+static void vector_clipf_sse(float *dst, const float *src,
+                             float min, float max, int len)
+{
+    x86_reg i = (len - 16) * 4;
+    __asm__ volatile (
+        "movss          %3, %%xmm4      \n\t"
+        "movss          %4, %%xmm5      \n\t"
+        "shufps $0, %%xmm4, %%xmm4      \n\t"
+        "shufps $0, %%xmm5, %%xmm5      \n\t"
+        "1:                             \n\t"
+        "movaps   (%2, %0), %%xmm0      \n\t" // 3/1 on intel
+        "movaps 16(%2, %0), %%xmm1      \n\t"
+        "movaps 32(%2, %0), %%xmm2      \n\t"
+        "movaps 48(%2, %0), %%xmm3      \n\t"
+        "maxps      %%xmm4, %%xmm0      \n\t"
+        "maxps      %%xmm4, %%xmm1      \n\t"
+        "maxps      %%xmm4, %%xmm2      \n\t"
+        "maxps      %%xmm4, %%xmm3      \n\t"
+        "minps      %%xmm5, %%xmm0      \n\t"
+        "minps      %%xmm5, %%xmm1      \n\t"
+        "minps      %%xmm5, %%xmm2      \n\t"
+        "minps      %%xmm5, %%xmm3      \n\t"
+        "movaps     %%xmm0,   (%1, %0)  \n\t"
+        "movaps     %%xmm1, 16(%1, %0)  \n\t"
+        "movaps     %%xmm2, 32(%1, %0)  \n\t"
+        "movaps     %%xmm3, 48(%1, %0)  \n\t"
+        "sub           $64, %0          \n\t"
+        "jge            1b              \n\t"
+        : "+&r"(i)
+        : "r"(dst), "r"(src), "m"(min), "m"(max)
+        : "memory"
+    );
+}
+
+static void butterflies_float_sse(float *av_restrict v1, float *av_restrict v2,
+                                  int len)
+{
+    x86_reg i = -4 * len;
+    __asm__ volatile (
+        "test       %0, %0              \n\t"
+        "jz         2f                  \n\t"
+        "1:                             \n\t"
+        "movaps    (%1, %0), %%xmm0     \n\t"
+        "movaps    (%2, %0), %%xmm1     \n\t"
+        "movaps     %%xmm0,  %%xmm2     \n\t"
+        "addps      %%xmm1,  %%xmm0     \n\t"
+        "subps      %%xmm1,  %%xmm2     \n\t"
+        "movaps     %%xmm0, (%1, %0)    \n\t"
+        "movaps     %%xmm2, (%2, %0)    \n\t"
+        "add          $16,   %0         \n\t"
+        "jl         1b                  \n\t"
+        "2:                             \n\t"
+        : "+&r"(i)
+        : "r"(v1 + len), "r"(v2 + len)
+        : XMM_CLOBBERS("xmm0", "xmm1", "xmm2",)
+          "memory"
+    );
+}
+
+#if HAVE_AVX_INLINE
+/* The AVX versions only need the 16-byte alignment and multiple of 4 length
+ * of the SSE ones: they do an odd group of 4 elements with xmm registers
+ * first and use unaligned ymm loads for the rest. */
+static void vector_clipf_avx(float *dst, const float *src,
+                             float min, float max, int len)
+{
+    x86_reg i = (len - 16) * 4;
+    __asm__ volatile (
+        "vbroadcastss   %3, %%ymm4              \n\t"
+        "vbroadcastss   %4, %%ymm5              \n\t"
+        "1:                                     \n\t"
+        "vmovups   (%2, %0), %%ymm0             \n\t"
+        "vmovups 32(%2, %0), %%ymm1             \n\t"
+        "vmaxps     %%ymm4, %%ymm0, %%ymm0      \n\t"
+        "vmaxps     %%ymm4, %%ymm1, %%ymm1      \n\t"
+        "vminps     %%ymm5, %%ymm0, %%ymm0      \n\t"
+        "vminps     %%ymm5, %%ymm1, %%ymm1      \n\t"
+        "vmovups    %%ymm0,   (%1, %0)          \n\t"
+        "vmovups    %%ymm1, 32(%1, %0)          \n\t"
+        "sub           $64, %0                  \n\t"
+        "jge            1b                      \n\t"
+        "vzeroupper                             \n\t"
+        : "+&r"(i)
+        : "r"(dst), "r"(src), "m"(min), "m"(max)
+        : XMM_CLOBBERS("xmm0", "xmm1", "xmm4", "xmm5",)
+          "memory"
+    );
+}
+
+static void butterflies_float_avx(float *av_restrict v1, float *av_restrict v2,
+                                  int len)
+{
+    x86_reg i = -4 * len;
+    __asm__ volatile (
+        "test       $16, %0                     \n\t"
+        "jz         1f                          \n\t"
+        "vmovaps   (%1, %0), %%xmm0             \n\t"
+        "vmovaps   (%2, %0), %%xmm1             \n\t"
+        "vaddps     %%xmm1, %%xmm0, %%xmm2      \n\t"
+        "vsubps     %%xmm1, %%xmm0, %%xmm0      \n\t"
+        "vmovaps    %%xmm2, (%1, %0)            \n\t"
+        "vmovaps    %%xmm0, (%2, %0)            \n\t"
+        "add        $16, %0                     \n\t"
+        "1:                                     \n\t"
+        "test       %0, %0                      \n\t"
+        "jz         3f                          \n\t"
+        "2:                                     \n\t"
+        "vmovups   (%1, %0), %%ymm0             \n\t"
+        "vmovups   (%2, %0), %%ymm1             \n\t"
+        "vaddps     %%ymm1, %%ymm0, %%ymm2      \n\t"
+        "vsubps     %%ymm1, %%ymm0, %%ymm0      \n\t"
+        "vmovups    %%ymm2, (%1, %0)            \n\t"
+        "vmovups    %%ymm0, (%2, %0)            \n\t"
+        "add        $32, %0                     \n\t"
+        "jl         2b                          \n\t"
+        "vzeroupper                             \n\t"
+        "3:                                     \n\t"
+        : "+&r"(i)
+        : "r"(v1 + len), "r"(v2 + len)
+        : XMM_CLOBBERS("xmm0", "xmm1", "xmm2",)
+          "memory"
+    );
+}
+
+static float scalarproduct_float_avx(const float *v1, const float *v2, int len)
+{
+    x86_reg i = -4 * len;
+    float p;
+    __asm__ volatile (
+        "vxorps     %%ymm0, %%ymm0, %%ymm0      \n\t"
+        "test       $16, %0                     \n\t"
+        "jz         1f                          \n\t"
+        "vmovaps   (%2, %0), %%xmm0             \n\t"
+        "vmulps    (%3, %0), %%xmm0, %%xmm0     \n\t"
+        "add        $16, %0                     \n\t"
+        "1:                                     \n\t"
+        "test       %0, %0                      \n\t"
+        "jz         3f                          \n\t"
+        "2:                                     \n\t"
+        "vmovups   (%2, %0), %%ymm1             \n\t"
+        "vmulps    (%3, %0), %%ymm1, %%ymm1     \n\t"
+        "vaddps     %%ymm1, %%ymm0, %%ymm0      \n\t"
+        "add        $32, %0                     \n\t"
+        "jl         2b                          \n\t"
+        "vextractf128 $1, %%ymm0, %%xmm1        \n\t"
+        "vaddps     %%xmm1, %%xmm0, %%xmm0      \n\t"
+        "3:                                     \n\t"
+        "vmovhlps   %%xmm0, %%xmm0, %%xmm1      \n\t"
+        "vaddps     %%xmm1, %%xmm0, %%xmm0      \n\t"
+        "vmovshdup  %%xmm0, %%xmm1              \n\t"
+        "vaddss     %%xmm1, %%xmm0, %%xmm0      \n\t"
+        "vmovss     %%xmm0, %1                  \n\t"
+        "vzeroupper                             \n\t"
+        : "+&r"(i), "=m"(p)
+        : "r"(v1 + len), "r"(v2 + len)
+        : XMM_CLOBBERS("xmm0", "xmm1",)
+          "memory"
+    );
+    return p;
+}
+#endif /* HAVE_AVX_INLINE */
+#endif /* HAVE_INLINE_ASM */
+
 void ff_float_dsp_init_x86(AVFloatDSPContext *fdsp)
 {
     int mm_flags = av_get_cpu_flags();
 
+#if HAVE_INLINE_ASM
+#if HAVE_6REGS
+    if (INLINE_AMD3DNOWEXT(mm_flags)) {
+        fdsp->vector_fmul_window = vector_fmul_window_3dnowext;
+    }
+    if (INLINE_SSE(mm_flags)) {
+        fdsp->vector_fmul_window = vector_fmul_window_sse;
+    }
+#endif
+    if (INLINE_SSE(mm_flags)) {
+        fdsp->vector_clipf = vector_clipf_sse;
+        fdsp->butterflies_float = butterflies_float_sse;
+    }
+#endif /* HAVE_INLINE_ASM */
     if (EXTERNAL_SSE(mm_flags)) {
         fdsp->vector_fmul = ff_vector_fmul_sse;
         fdsp->vector_fmac_scalar = ff_vector_fmac_scalar_sse;
         fdsp->vector_fmul_scalar = ff_vector_fmul_scalar_sse;
+        fdsp->vector_fmul_add = ff_vector_fmul_add_sse;
+        fdsp->vector_fmul_reverse = ff_vector_fmul_reverse_sse;
+        fdsp->scalarproduct_float = ff_scalarproduct_float_sse;
     }
     if (EXTERNAL_SSE2(mm_flags)) {
         fdsp->vector_dmul_scalar = ff_vector_dmul_scalar_sse2;
@@ -56,5 +319,14 @@ void ff_float_dsp_init_x86(AVFloatDSPContext *fdsp)
         fdsp->vector_fmul = ff_vector_fmul_avx;
         fdsp->vector_fmac_scalar = ff_vector_fmac_scalar_avx;
         fdsp->vector_dmul_scalar = ff_vector_dmul_scalar_avx;
+        fdsp->vector_fmul_add = ff_vector_fmul_add_avx;
+        fdsp->vector_fmul_reverse = ff_vector_fmul_reverse_avx;
+    }
+#if HAVE_INLINE_ASM && HAVE_AVX_INLINE
+    if (INLINE_AVX(mm_flags)) {
+        fdsp->vector_clipf = vector_clipf_avx;
+        fdsp->butterflies_float = butterflies_float_avx;
+        fdsp->scalarproduct_float = scalarproduct_float_avx;
     }
+#endif
 }
@@ -0,0 +1,73 @@
+/*
+ * This file is part of libswresample.
+ *
+ * libswresample is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libswresample is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libswresample; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "config.h"
+#include "libavutil/arm/cpu.h"
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libswresample/swresample_internal.h"
+
+mix_1_1_func_type ff_mix_1_1_float_neon;
+mix_2_1_func_type ff_mix_2_1_float_neon;
+mix_1_1_func_type ff_mix_1_1_int16_neon;
+mix_2_1_func_type ff_mix_2_1_int16_neon;
+
+av_cold void swri_rematrix_init_arm(struct SwrContext *s)
+{
+    int cpu_flags = av_get_cpu_flags();
+    int nb_in  = av_get_channel_layout_nb_channels(s->in_ch_layout);
+    int nb_out = av_get_channel_layout_nb_channels(s->out_ch_layout);
+    int num    = nb_in * nb_out;
+    int i, j;
+
+    s->mix_1_1_simd = NULL;
+    s->mix_2_1_simd = NULL;
+
+    if (!have_neon(cpu_flags))
+        return;
+
+    if (s->midbuf.fmt == AV_SAMPLE_FMT_S16P) {
+        /* same (coefficient, shift) layout as the x86 version */
+        s->native_simd_matrix = av_mallocz(2 * num * sizeof(int16_t));
+        if (!s->native_simd_matrix)
+            return;
+        for (i = 0; i < nb_out; i++) {
+            int sh = 0;
+            for (j = 0; j < nb_in; j++)
+                sh = FFMAX(sh, FFABS(((int*)s->native_matrix)[i * nb_in + j]));
+            sh = FFMAX(av_log2(sh) - 14, 0);
+            for (j = 0; j < nb_in; j++) {
+                ((int16_t*)s->native_simd_matrix)[2*(i * nb_in + j)+1] = 15 - sh;
+                ((int16_t*)s->native_simd_matrix)[2*(i * nb_in + j)] =
+                    ((((int*)s->native_matrix)[i * nb_in + j]) + (1<<sh>>1)) >> sh;
+            }
+        }
+        s->mix_1_1_simd = ff_mix_1_1_int16_neon;
+        s->mix_2_1_simd = ff_mix_2_1_int16_neon;
+    } else if (s->midbuf.fmt == AV_SAMPLE_FMT_FLTP) {
+        s->native_simd_matrix = av_mallocz((num + 1) * sizeof(float));
+        if (!s->native_simd_matrix)
+            return;
+        memcpy(s->native_simd_matrix, s->native_matrix, (num + 1) * sizeof(float));
+        s->mix_1_1_simd = ff_mix_1_1_float_neon;
+        s->mix_2_1_simd = ff_mix_2_1_float_neon;
+    }
+}
@@ -0,0 +1,79 @@
+/*
+ * This file is part of libswresample.
+ *
+ * libswresample is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libswresample is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libswresample; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef SWRESAMPLE_ARM_RESAMPLE_NEON_H
+#define SWRESAMPLE_ARM_RESAMPLE_NEON_H
+
+#include <stdint.h>
+
+#include "libswresample/swresample_internal.h"
+
+int swri_resample_int16_neon(struct ResampleContext *c, int16_t *dst, const int16_t *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_float_neon(struct ResampleContext *c, float   *dst, const float   *src, int *consumed, int src_size, int dst_size, int update_ctx);
+
+void ff_resample_common_float_neon(float *val, const float *src,
+                                   const float *filter, int len);
+void ff_resample_linear_float_neon(float val[2], const float *src,
+                                   const float *filter,
+                                   const float *filter2, int len);
+int  ff_resample_common_int16_neon(const int16_t *src, const int16_t *filter,
+                                   int len);
+void ff_resample_linear_int16_neon(int32_t val[2], const int16_t *src,
+                                   const int16_t *filter,
+                                   const int16_t *filter2, int len);
+
+#define COMMON_CORE_INT16_NEON \
+    int tail= c->filter_length & ~7;\
+    FELEM2 val= ff_resample_common_int16_neon(src + sample_index, filter, tail);\
+    for(i=tail; i<c->filter_length; i++)\
+        val += src[sample_index + i] * (FELEM2)filter[i];\
+    OUT(dst[dst_index], val);
+
+#define LINEAR_CORE_INT16_NEON \
+    int tail= c->filter_length & ~7;\
+    int32_t vals[2];\
+    ff_resample_linear_int16_neon(vals, src + sample_index, filter,\
+                                  filter + c->filter_alloc, tail);\
+    val= vals[0];\
+    v2 = vals[1];\
+    for(i=tail; i<c->filter_length; i++){\
+        val += src[sample_index + i] * (FELEM2)filter[i];\
+        v2  += src[sample_index + i] * (FELEM2)filter[i + c->filter_alloc];\
+    }
+
+#define COMMON_CORE_FLT_NEON \
+    int tail= c->filter_length & ~3;\
+    float val;\
+    ff_resample_common_float_neon(&val, src + sample_index, filter, tail);\
+    for(i=tail; i<c->filter_length; i++)\
+        val += src[sample_index + i] * filter[i];\
+    dst[dst_index] = val;
+
+#define LINEAR_CORE_FLT_NEON \
+    int tail= c->filter_length & ~3;\
+    float vals[2];\
+    ff_resample_linear_float_neon(vals, src + sample_index, filter,\
+                                  filter + c->filter_alloc, tail);\
+    val= vals[0];\
+    v2 = vals[1];\
+    for(i=tail; i<c->filter_length; i++){\
+        val += src[sample_index + i] * filter[i];\
+        v2  += src[sample_index + i] * filter[i + c->filter_alloc];\
+    }
+
+#endif /* SWRESAMPLE_ARM_RESAMPLE_NEON_H */
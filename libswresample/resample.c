@@ -25,6 +25,10 @@
  * @author Michael Niedermayer <michaelni@gmx.at>
  */
 
+#include "config.h"
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 #include "libavutil/log.h"
 #include "libavutil/avassert.h"
 #include "swresample_internal.h"
@@ -52,6 +56,28 @@ typedef struct ResampleContext {
     int filter_shift;
 } ResampleContext;
 
+#if HAVE_PTHREADS
+/**
+ * A filter bank shared by all resamplers built with the same parameters.
+ * The filter bank is never written after it is built, so only the list
+ * and the reference counts need the lock.
+ */
+typedef struct FilterBankEntry {
+    struct FilterBankEntry *next;
+    uint8_t *filter_bank;
+    int refcount;
+    enum AVSampleFormat format;
+    double factor;
+    int filter_length;
+    int phase_shift;
+    enum SwrFilterType filter_type;
+    int kaiser_beta;
+} FilterBankEntry;
+
+static pthread_mutex_t filter_bank_lock = PTHREAD_MUTEX_INITIALIZER;
+static FilterBankEntry *filter_banks;
+#endif
+
 /**
  * 0th order modified bessel function of the first kind.
  */
@@ -195,6 +221,105 @@ static int build_filter(ResampleContext *c, void *filter, double factor, int tap
     return 0;
 }
 
+static int alloc_filter_bank(ResampleContext *c)
+{
+    int phase_count = 1 << c->phase_shift;
+    int ret;
+
+    c->filter_bank = av_mallocz(c->filter_alloc*(phase_count+1)*c->felem_size);
+    if (!c->filter_bank)
+        return AVERROR(ENOMEM);
+    ret = build_filter(c, (void*)c->filter_bank, c->factor, c->filter_length, c->filter_alloc, phase_count, 1<<c->filter_shift, c->filter_type, c->kaiser_beta);
+    if (ret < 0) {
+        av_freep(&c->filter_bank);
+        return ret;
+    }
+    memcpy(c->filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, c->filter_bank, (c->filter_alloc-1)*c->felem_size);
+    memcpy(c->filter_bank + (c->filter_alloc*phase_count  )*c->felem_size, c->filter_bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
+    return 0;
+}
+
+/**
+ * Set c->filter_bank to the filter bank for the parameters of c, reusing
+ * the one of another resampler with the same parameters if there is one.
+ */
+static int get_filter_bank(ResampleContext *c)
+{
+#if HAVE_PTHREADS
+    FilterBankEntry *e;
+    int ret = 0;
+
+    pthread_mutex_lock(&filter_bank_lock);
+    for (e = filter_banks; e; e = e->next)
+        if (e->format        == c->format        &&
+            e->factor        == c->factor        &&
+            e->filter_length == c->filter_length &&
+            e->phase_shift   == c->phase_shift   &&
+            e->filter_type   == c->filter_type   &&
+            e->kaiser_beta   == c->kaiser_beta)
+            break;
+    if (!e) {
+        e = av_mallocz(sizeof(*e));
+        if (!e) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        if ((ret = alloc_filter_bank(c)) < 0) {
+            av_free(e);
+            goto end;
+        }
+        e->filter_bank   = c->filter_bank;
+        e->format        = c->format;
+        e->factor        = c->factor;
+        e->filter_length = c->filter_length;
+        e->phase_shift   = c->phase_shift;
+        e->filter_type   = c->filter_type;
+        e->kaiser_beta   = c->kaiser_beta;
+        e->next          = filter_banks;
+        filter_banks     = e;
+    }
+    e->refcount++;
+    c->filter_bank = e->filter_bank;
+end:
+    pthread_mutex_unlock(&filter_bank_lock);
+    return ret;
+#else
+    return alloc_filter_bank(c);
+#endif
+}
+
+static void release_filter_bank(ResampleContext *c)
+{
+#if HAVE_PTHREADS
+    FilterBankEntry **p, *e;
+
+    if (!c->filter_bank)
+        return;
+    pthread_mutex_lock(&filter_bank_lock);
+    for (p = &filter_banks; (e = *p); p = &e->next) {
+        if (e->filter_bank == c->filter_bank) {
+            if (!--e->refcount) {
+                *p = e->next;
+                av_free(e->filter_bank);
+                av_free(e);
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&filter_bank_lock);
+    c->filter_bank = NULL;
+#else
+    av_freep(&c->filter_bank);
+#endif
+}
+
+static void resample_free(ResampleContext **c){
+    if(!*c)
+        return;
+    release_filter_bank(*c);
+    av_freep(c);
+}
+
 static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
                                     double cutoff0, enum AVSampleFormat format, enum SwrFilterType filter_type, int kaiser_beta,
                                     double precision, int cheby){
@@ -205,6 +330,7 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
     if (!c || c->phase_shift != phase_shift || c->linear!=linear || c->factor != factor
            || c->filter_length != FFMAX((int)ceil(filter_size/factor), 1) || c->format != format
            || c->filter_type != filter_type || c->kaiser_beta != kaiser_beta) {
+        resample_free(&c);
         c = av_mallocz(sizeof(*c));
         if (!c)
             return NULL;
@@ -235,15 +361,10 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
         c->factor        = factor;
         c->filter_length = FFMAX((int)ceil(filter_size/factor), 1);
         c->filter_alloc  = FFALIGN(c->filter_length, 8);
-        c->filter_bank   = av_mallocz(c->filter_alloc*(phase_count+1)*c->felem_size);
         c->filter_type   = filter_type;
         c->kaiser_beta   = kaiser_beta;
-        if (!c->filter_bank)
-            goto error;
-        if (build_filter(c, (void*)c->filter_bank, factor, c->filter_length, c->filter_alloc, phase_count, 1<<c->filter_shift, filter_type, kaiser_beta))
+        if (get_filter_bank(c) < 0)
             goto error;
-        memcpy(c->filter_bank + (c->filter_alloc*phase_count+1)*c->felem_size, c->filter_bank, (c->filter_alloc-1)*c->felem_size);
-        memcpy(c->filter_bank + (c->filter_alloc*phase_count  )*c->felem_size, c->filter_bank + (c->filter_alloc - 1)*c->felem_size, c->felem_size);
     }
 
     c->compensation_distance= 0;
@@ -256,18 +377,11 @@ static ResampleContext *resample_init(ResampleContext *c, int out_rate, int in_r
 
     return c;
 error:
-    av_free(c->filter_bank);
+    release_filter_bank(c);
     av_free(c);
     return NULL;
 }
 
-static void resample_free(ResampleContext **c){
-    if(!*c)
-        return;
-    av_freep(&(*c)->filter_bank);
-    av_freep(c);
-}
-
 static int set_compensation(ResampleContext *c, int sample_delta, int compensation_distance){
     c->compensation_distance= compensation_distance;
     if (compensation_distance)
@@ -294,9 +408,11 @@ static int set_compensation(ResampleContext *c, int sample_delta, int compensati
 #undef TEMPLATE_RESAMPLE_DBL
 
 // XXX FIXME the whole C loop should be written in asm so this x86 specific code here isnt needed
-#if HAVE_MMXEXT_INLINE
-
+#if HAVE_MMXEXT_INLINE || HAVE_SSE_INLINE
 #include "x86/resample_mmx.h"
+#endif
+
+#if HAVE_MMXEXT_INLINE
 
 #define TEMPLATE_RESAMPLE_S16_MMX2
 #include "resample_template.c"
@@ -310,6 +426,40 @@ static int set_compensation(ResampleContext *c, int sample_delta, int compensati
 
 #endif // HAVE_MMXEXT_INLINE
 
+#if HAVE_SSE_INLINE
+#define TEMPLATE_RESAMPLE_FLT_SSE
+#include "resample_template.c"
+#undef TEMPLATE_RESAMPLE_FLT_SSE
+#endif
+
+#if HAVE_SSE2_INLINE
+#define TEMPLATE_RESAMPLE_DBL_SSE2
+#include "resample_template.c"
+#undef TEMPLATE_RESAMPLE_DBL_SSE2
+#endif
+
+#if HAVE_AVX_INLINE
+#define TEMPLATE_RESAMPLE_FLT_AVX
+#include "resample_template.c"
+#undef TEMPLATE_RESAMPLE_FLT_AVX
+
+#define TEMPLATE_RESAMPLE_DBL_AVX
+#include "resample_template.c"
+#undef TEMPLATE_RESAMPLE_DBL_AVX
+#endif
+
+#if HAVE_NEON
+#include "arm/resample_neon.h"
+
+#define TEMPLATE_RESAMPLE_S16_NEON
+#include "resample_template.c"
+#undef TEMPLATE_RESAMPLE_S16_NEON
+
+#define TEMPLATE_RESAMPLE_FLT_NEON
+#include "resample_template.c"
+#undef TEMPLATE_RESAMPLE_FLT_NEON
+#endif
+
 static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
     int i, ret= -1;
     int av_unused mm_flags = av_get_cpu_flags();
@@ -325,6 +475,24 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
                  ret= swri_resample_int16_mmx2 (c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
                  need_emms= 1;
              } else
+#endif
+#if HAVE_AVX_INLINE
+             if(c->format == AV_SAMPLE_FMT_FLTP && (mm_flags&AV_CPU_FLAG_AVX )) ret= swri_resample_float_avx  (c, (float  *)dst->ch[i], (const float  *)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
+        else if(c->format == AV_SAMPLE_FMT_DBLP && (mm_flags&AV_CPU_FLAG_AVX )) ret= swri_resample_double_avx (c, (double *)dst->ch[i], (const double *)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
+        else
+#endif
+#if HAVE_SSE_INLINE
+             if(c->format == AV_SAMPLE_FMT_FLTP && (mm_flags&AV_CPU_FLAG_SSE )) ret= swri_resample_float_sse  (c, (float  *)dst->ch[i], (const float  *)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
+        else
+#endif
+#if HAVE_SSE2_INLINE
+             if(c->format == AV_SAMPLE_FMT_DBLP && (mm_flags&AV_CPU_FLAG_SSE2)) ret= swri_resample_double_sse2(c, (double *)dst->ch[i], (const double *)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
+        else
+#endif
+#if HAVE_NEON
+             if(c->format == AV_SAMPLE_FMT_S16P && (mm_flags&AV_CPU_FLAG_NEON)) ret= swri_resample_int16_neon(c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
+        else if(c->format == AV_SAMPLE_FMT_FLTP && (mm_flags&AV_CPU_FLAG_NEON)) ret= swri_resample_float_neon(c, (float  *)dst->ch[i], (const float  *)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
+        else
 #endif
              if(c->format == AV_SAMPLE_FMT_S16P) ret= swri_resample_int16(c, (int16_t*)dst->ch[i], (const int16_t*)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
         else if(c->format == AV_SAMPLE_FMT_S32P) ret= swri_resample_int32(c, (int32_t*)dst->ch[i], (const int32_t*)src->ch[i], consumed, src_size, dst_size, i+1==dst->ch_count);
@@ -25,8 +25,10 @@
  * @author Michael Niedermayer <michaelni@gmx.at>
  */
 
-#if defined(TEMPLATE_RESAMPLE_DBL)
-#    define RENAME(N) N ## _double
+#if    defined(TEMPLATE_RESAMPLE_DBL)      \
+    || defined(TEMPLATE_RESAMPLE_DBL_SSE2) \
+    || defined(TEMPLATE_RESAMPLE_DBL_AVX)
+
 #    define FILTER_SHIFT 0
 #    define DELEM  double
 #    define FELEM  double
@@ -34,8 +36,23 @@
 #    define FELEML double
 #    define OUT(d, v) d = v
 
-#elif defined(TEMPLATE_RESAMPLE_FLT)
-#    define RENAME(N) N ## _float
+#    if defined(TEMPLATE_RESAMPLE_DBL)
+#        define RENAME(N) N ## _double
+#    elif defined(TEMPLATE_RESAMPLE_DBL_SSE2)
+#        define COMMON_CORE COMMON_CORE_DBL_SSE2
+#        define LINEAR_CORE LINEAR_CORE_DBL_SSE2
+#        define RENAME(N) N ## _double_sse2
+#    elif defined(TEMPLATE_RESAMPLE_DBL_AVX)
+#        define COMMON_CORE COMMON_CORE_DBL_AVX
+#        define LINEAR_CORE LINEAR_CORE_DBL_AVX
+#        define RENAME(N) N ## _double_avx
+#    endif
+
+#elif    defined(TEMPLATE_RESAMPLE_FLT)      \
+      || defined(TEMPLATE_RESAMPLE_FLT_SSE)  \
+      || defined(TEMPLATE_RESAMPLE_FLT_AVX)  \
+      || defined(TEMPLATE_RESAMPLE_FLT_NEON)
+
 #    define FILTER_SHIFT 0
 #    define DELEM  float
 #    define FELEM  float
@@ -43,6 +60,22 @@
 #    define FELEML float
 #    define OUT(d, v) d = v
 
+#    if defined(TEMPLATE_RESAMPLE_FLT)
+#        define RENAME(N) N ## _float
+#    elif defined(TEMPLATE_RESAMPLE_FLT_SSE)
+#        define COMMON_CORE COMMON_CORE_FLT_SSE
+#        define LINEAR_CORE LINEAR_CORE_FLT_SSE
+#        define RENAME(N) N ## _float_sse
+#    elif defined(TEMPLATE_RESAMPLE_FLT_AVX)
+#        define COMMON_CORE COMMON_CORE_FLT_AVX
+#        define LINEAR_CORE LINEAR_CORE_FLT_AVX
+#        define RENAME(N) N ## _float_avx
+#    elif defined(TEMPLATE_RESAMPLE_FLT_NEON)
+#        define COMMON_CORE COMMON_CORE_FLT_NEON
+#        define LINEAR_CORE LINEAR_CORE_FLT_NEON
+#        define RENAME(N) N ## _float_neon
+#    endif
+
 #elif defined(TEMPLATE_RESAMPLE_S32)
 #    define RENAME(N) N ## _int32
 #    define FILTER_SHIFT 30
@@ -57,7 +90,8 @@
 
 #elif    defined(TEMPLATE_RESAMPLE_S16)      \
       || defined(TEMPLATE_RESAMPLE_S16_MMX2) \
-      || defined(TEMPLATE_RESAMPLE_S16_SSSE3)
+      || defined(TEMPLATE_RESAMPLE_S16_SSSE3) \
+      || defined(TEMPLATE_RESAMPLE_S16_NEON)
 
 #    define FILTER_SHIFT 15
 #    define DELEM  int16_t
@@ -77,6 +111,10 @@
 #    elif defined(TEMPLATE_RESAMPLE_S16_SSSE3)
 #        define COMMON_CORE COMMON_CORE_INT16_SSSE3
 #        define RENAME(N) N ## _int16_ssse3
+#    elif defined(TEMPLATE_RESAMPLE_S16_NEON)
+#        define COMMON_CORE COMMON_CORE_INT16_NEON
+#        define LINEAR_CORE LINEAR_CORE_INT16_NEON
+#        define RENAME(N) N ## _int16_neon
 #    endif
 
 #endif
@@ -154,10 +192,14 @@ int RENAME(swri_resample)(ResampleContext *c, DELEM *dst, const DELEM *src, int
                     val += src[FFABS(sample_index + i)] * filter[i];
             }else if(c->linear){
                 FELEM2 v2=0;
+#ifdef LINEAR_CORE
+                LINEAR_CORE
+#else
                 for(i=0; i<c->filter_length; i++){
                     val += src[sample_index + i] * (FELEM2)filter[i];
                     v2  += src[sample_index + i] * (FELEM2)filter[i + c->filter_alloc];
                 }
+#endif
                 val+=(v2-val)*(FELEML)frac / c->src_incr;
             }else{
                 for(i=0; i<c->filter_length; i++){
@@ -200,6 +242,7 @@ int RENAME(swri_resample)(ResampleContext *c, DELEM *dst, const DELEM *src, int
 }
 
 #undef COMMON_CORE
+#undef LINEAR_CORE
 #undef RENAME
 #undef FILTER_SHIFT
 #undef DELEM
@@ -25,6 +25,9 @@ align 32
 flt2pm31: times 8 dd 4.6566129e-10
 flt2p31 : times 8 dd 2147483648.0
 flt2p15 : times 8 dd 32768.0
+dbl2pm31: times 2 dq 4.656612873077393e-10
+dbl2p31 : times 2 dq 2147483648.0
+dbl2p31m1: times 2 dq 2147483647.0
 
 word_unpack_shuf : db  0, 1, 4, 5, 8, 9,12,13, 2, 3, 6, 7,10,11,14,15
 
@@ -364,6 +367,63 @@ pack_6ch_%2_to_%1_u_int %+ SUFFIX
     packssdw  m1, m3
 %endmacro
 
+%macro FLOAT_TO_DOUBLE_N 6
+    movhlps   m3, m1
+    cvtps2pd  m2, m1
+    movhlps   m1, m0
+    cvtps2pd  m0, m0
+    cvtps2pd  m1, m1
+    cvtps2pd  m3, m3
+%endmacro
+
+%macro DOUBLE_TO_FLOAT_N 6
+    cvtpd2ps  m0, m0
+    cvtpd2ps  m1, m1
+    cvtpd2ps  m2, m2
+    cvtpd2ps  m3, m3
+    movlhps   m0, m1
+    movlhps   m2, m3
+    SWAP 1,2
+%endmacro
+
+%macro INT32_TO_DOUBLE_INIT 6
+    mova      %5, [dbl2pm31]
+%endmacro
+%macro INT32_TO_DOUBLE_N 6
+    pshufd    m3, m1, q3232
+    cvtdq2pd  m2, m1
+    pshufd    m1, m0, q3232
+    cvtdq2pd  m0, m0
+    cvtdq2pd  m1, m1
+    cvtdq2pd  m3, m3
+    mulpd     m0, %5
+    mulpd     m1, %5
+    mulpd     m2, %5
+    mulpd     m3, %5
+%endmacro
+
+%macro DOUBLE_TO_INT32_INIT 6
+    mova      %5, [dbl2p31]
+    mova      %6, [dbl2p31m1]
+%endmacro
+%macro DOUBLE_TO_INT32_N 6
+    mulpd     m0, %5
+    mulpd     m1, %5
+    mulpd     m2, %5
+    mulpd     m3, %5
+    minpd     m0, %6
+    minpd     m1, %6
+    minpd     m2, %6
+    minpd     m3, %6
+    cvtpd2dq  m0, m0
+    cvtpd2dq  m1, m1
+    cvtpd2dq  m2, m2
+    cvtpd2dq  m3, m3
+    punpcklqdq m0, m1
+    punpcklqdq m2, m3
+    SWAP 1,2
+%endmacro
+
 %macro NOP_N 0-6
 %endmacro
 
@@ -409,6 +469,15 @@ CONV float, int16, a, 2, 1, INT16_TO_FLOAT_N, INT16_TO_FLOAT_INIT
 CONV int16, float, u, 1, 2, FLOAT_TO_INT16_N, FLOAT_TO_INT16_INIT
 CONV int16, float, a, 1, 2, FLOAT_TO_INT16_N, FLOAT_TO_INT16_INIT
 
+CONV double, float, u, 3, 2, FLOAT_TO_DOUBLE_N, NOP_N
+CONV double, float, a, 3, 2, FLOAT_TO_DOUBLE_N, NOP_N
+CONV float, double, u, 2, 3, DOUBLE_TO_FLOAT_N, NOP_N
+CONV float, double, a, 2, 3, DOUBLE_TO_FLOAT_N, NOP_N
+CONV double, int32, u, 3, 2, INT32_TO_DOUBLE_N, INT32_TO_DOUBLE_INIT
+CONV double, int32, a, 3, 2, INT32_TO_DOUBLE_N, INT32_TO_DOUBLE_INIT
+CONV int32, double, u, 2, 3, DOUBLE_TO_INT32_N, DOUBLE_TO_INT32_INIT
+CONV int32, double, a, 2, 3, DOUBLE_TO_INT32_N, DOUBLE_TO_INT32_INIT
+
 PACK_2CH float, int32, u, 2, 2, INT32_TO_FLOAT_N, INT32_TO_FLOAT_INIT
 PACK_2CH float, int32, a, 2, 2, INT32_TO_FLOAT_N, INT32_TO_FLOAT_INIT
 PACK_2CH int32, float, u, 2, 2, FLOAT_TO_INT32_N, FLOAT_TO_INT32_INIT
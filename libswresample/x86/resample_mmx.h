@@ -24,6 +24,10 @@
 
 int swri_resample_int16_mmx2 (struct ResampleContext *c, int16_t *dst, const int16_t *src, int *consumed, int src_size, int dst_size, int update_ctx);
 int swri_resample_int16_ssse3(struct ResampleContext *c, int16_t *dst, const int16_t *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_float_sse  (struct ResampleContext *c, float   *dst, const float   *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_float_avx  (struct ResampleContext *c, float   *dst, const float   *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_double_sse2(struct ResampleContext *c, double  *dst, const double  *src, int *consumed, int src_size, int dst_size, int update_ctx);
+int swri_resample_double_avx (struct ResampleContext *c, double  *dst, const double  *src, int *consumed, int src_size, int dst_size, int update_ctx);
 
 DECLARE_ALIGNED(16, const uint64_t, ff_resample_int16_rounder)[2]    = { 0x0000000000004000ULL, 0x0000000000000000ULL};
 
@@ -68,3 +72,270 @@ __asm__ volatile(\
       "r" (((uint8_t*)filter)-len),\
       "r" (dst+dst_index)\
 );
+
+/* The float and double cores run the asm loop over the largest multiple
+ * of the vector length in the filter and add the remaining taps in C, so
+ * no samples past the end of the filter are read. */
+
+#define HSUM_FLT_SSE(a, t)             \
+    "movhlps  %%"a", %%"t"        \n\t"\
+    "addps    %%"t", %%"a"        \n\t"\
+    "movss    %%"a", %%"t"        \n\t"\
+    "shufps $1, %%"a", %%"a"      \n\t"\
+    "addps    %%"t", %%"a"        \n\t"
+
+#define HSUM_DBL_SSE2(a, t)            \
+    "movhlps  %%"a", %%"t"        \n\t"\
+    "addsd    %%"t", %%"a"        \n\t"
+
+#define HSUM_FLT_AVX(a, t)                       \
+    "vextractf128 $1, %%y"a", %%x"t"        \n\t"\
+    "vaddps   %%x"t", %%x"a", %%x"a"        \n\t"\
+    "vmovhlps %%x"a", %%x"a", %%x"t"        \n\t"\
+    "vaddps   %%x"t", %%x"a", %%x"a"        \n\t"\
+    "vshufps $1, %%x"a", %%x"a", %%x"t"     \n\t"\
+    "vaddss   %%x"t", %%x"a", %%x"a"        \n\t"
+
+#define HSUM_DBL_AVX(a, t)                       \
+    "vextractf128 $1, %%y"a", %%x"t"        \n\t"\
+    "vaddpd   %%x"t", %%x"a", %%x"a"        \n\t"\
+    "vmovhlps %%x"a", %%x"a", %%x"t"        \n\t"\
+    "vaddsd   %%x"t", %%x"a", %%x"a"        \n\t"
+
+#define COMMON_CORE_FLT_SSE \
+    int tail= c->filter_length & ~3;\
+    x86_reg len= -4*tail;\
+    float val;\
+__asm__ volatile(\
+    "xorps     %%xmm0, %%xmm0     \n\t"\
+    "test         %0, %0          \n\t"\
+    "jz           2f              \n\t"\
+    "1:                           \n\t"\
+    "movups  (%2, %0), %%xmm1     \n\t"\
+    "mulps   (%3, %0), %%xmm1     \n\t"\
+    "addps     %%xmm1, %%xmm0     \n\t"\
+    "add         $16, %0          \n\t"\
+    " js 1b                       \n\t"\
+    "2:                           \n\t"\
+    HSUM_FLT_SSE("xmm0", "xmm1")\
+    "movss     %%xmm0, %1         \n\t"\
+    : "+r" (len), "=m" (val)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1")\
+);\
+    for(i=tail; i<c->filter_length; i++)\
+        val += src[sample_index + i] * filter[i];\
+    dst[dst_index] = val;
+
+#define LINEAR_CORE_FLT_SSE \
+    int tail= c->filter_length & ~3;\
+    x86_reg len= -4*tail;\
+__asm__ volatile(\
+    "xorps     %%xmm0, %%xmm0     \n\t"\
+    "xorps     %%xmm2, %%xmm2     \n\t"\
+    "test         %0, %0          \n\t"\
+    "jz           2f              \n\t"\
+    "1:                           \n\t"\
+    "movups  (%3, %0), %%xmm1     \n\t"\
+    "movaps    %%xmm1, %%xmm3     \n\t"\
+    "mulps   (%4, %0), %%xmm1     \n\t"\
+    "mulps   (%5, %0), %%xmm3     \n\t"\
+    "addps     %%xmm1, %%xmm0     \n\t"\
+    "addps     %%xmm3, %%xmm2     \n\t"\
+    "add         $16, %0          \n\t"\
+    " js 1b                       \n\t"\
+    "2:                           \n\t"\
+    HSUM_FLT_SSE("xmm0", "xmm1")\
+    HSUM_FLT_SSE("xmm2", "xmm3")\
+    "movss     %%xmm0, %1         \n\t"\
+    "movss     %%xmm2, %2         \n\t"\
+    : "+r" (len), "=m" (val), "=m" (v2)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len),\
+      "r" (((uint8_t*)(filter+c->filter_alloc))-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1", "%xmm2", "%xmm3")\
+);\
+    for(i=tail; i<c->filter_length; i++){\
+        val += src[sample_index + i] * filter[i];\
+        v2  += src[sample_index + i] * filter[i + c->filter_alloc];\
+    }
+
+#define COMMON_CORE_DBL_SSE2 \
+    int tail= c->filter_length & ~1;\
+    x86_reg len= -8*tail;\
+    double val;\
+__asm__ volatile(\
+    "xorpd     %%xmm0, %%xmm0     \n\t"\
+    "test         %0, %0          \n\t"\
+    "jz           2f              \n\t"\
+    "1:                           \n\t"\
+    "movupd  (%2, %0), %%xmm1     \n\t"\
+    "mulpd   (%3, %0), %%xmm1     \n\t"\
+    "addpd     %%xmm1, %%xmm0     \n\t"\
+    "add         $16, %0          \n\t"\
+    " js 1b                       \n\t"\
+    "2:                           \n\t"\
+    HSUM_DBL_SSE2("xmm0", "xmm1")\
+    "movsd     %%xmm0, %1         \n\t"\
+    : "+r" (len), "=m" (val)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1")\
+);\
+    for(i=tail; i<c->filter_length; i++)\
+        val += src[sample_index + i] * filter[i];\
+    dst[dst_index] = val;
+
+#define LINEAR_CORE_DBL_SSE2 \
+    int tail= c->filter_length & ~1;\
+    x86_reg len= -8*tail;\
+__asm__ volatile(\
+    "xorpd     %%xmm0, %%xmm0     \n\t"\
+    "xorpd     %%xmm2, %%xmm2     \n\t"\
+    "test         %0, %0          \n\t"\
+    "jz           2f              \n\t"\
+    "1:                           \n\t"\
+    "movupd  (%3, %0), %%xmm1     \n\t"\
+    "movapd    %%xmm1, %%xmm3     \n\t"\
+    "mulpd   (%4, %0), %%xmm1     \n\t"\
+    "mulpd   (%5, %0), %%xmm3     \n\t"\
+    "addpd     %%xmm1, %%xmm0     \n\t"\
+    "addpd     %%xmm3, %%xmm2     \n\t"\
+    "add         $16, %0          \n\t"\
+    " js 1b                       \n\t"\
+    "2:                           \n\t"\
+    HSUM_DBL_SSE2("xmm0", "xmm1")\
+    HSUM_DBL_SSE2("xmm2", "xmm3")\
+    "movsd     %%xmm0, %1         \n\t"\
+    "movsd     %%xmm2, %2         \n\t"\
+    : "+r" (len), "=m" (val), "=m" (v2)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len),\
+      "r" (((uint8_t*)(filter+c->filter_alloc))-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1", "%xmm2", "%xmm3")\
+);\
+    for(i=tail; i<c->filter_length; i++){\
+        val += src[sample_index + i] * filter[i];\
+        v2  += src[sample_index + i] * filter[i + c->filter_alloc];\
+    }
+
+#define COMMON_CORE_FLT_AVX \
+    int tail= c->filter_length & ~7;\
+    x86_reg len= -4*tail;\
+    float val;\
+__asm__ volatile(\
+    "vxorps    %%ymm0, %%ymm0, %%ymm0     \n\t"\
+    "test         %0, %0                  \n\t"\
+    "jz           2f                      \n\t"\
+    "1:                                   \n\t"\
+    "vmovups (%2, %0), %%ymm1             \n\t"\
+    "vmulps  (%3, %0), %%ymm1, %%ymm1     \n\t"\
+    "vaddps    %%ymm1, %%ymm0, %%ymm0     \n\t"\
+    "add         $32, %0                  \n\t"\
+    " js 1b                               \n\t"\
+    "2:                                   \n\t"\
+    HSUM_FLT_AVX("mm0", "mm1")\
+    "vmovss    %%xmm0, %1                 \n\t"\
+    "vzeroupper                           \n\t"\
+    : "+r" (len), "=m" (val)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1")\
+);\
+    for(i=tail; i<c->filter_length; i++)\
+        val += src[sample_index + i] * filter[i];\
+    dst[dst_index] = val;
+
+#define LINEAR_CORE_FLT_AVX \
+    int tail= c->filter_length & ~7;\
+    x86_reg len= -4*tail;\
+__asm__ volatile(\
+    "vxorps    %%ymm0, %%ymm0, %%ymm0     \n\t"\
+    "vxorps    %%ymm2, %%ymm2, %%ymm2     \n\t"\
+    "test         %0, %0                  \n\t"\
+    "jz           2f                      \n\t"\
+    "1:                                   \n\t"\
+    "vmovups (%3, %0), %%ymm1             \n\t"\
+    "vmulps  (%5, %0), %%ymm1, %%ymm3     \n\t"\
+    "vmulps  (%4, %0), %%ymm1, %%ymm1     \n\t"\
+    "vaddps    %%ymm1, %%ymm0, %%ymm0     \n\t"\
+    "vaddps    %%ymm3, %%ymm2, %%ymm2     \n\t"\
+    "add         $32, %0                  \n\t"\
+    " js 1b                               \n\t"\
+    "2:                                   \n\t"\
+    HSUM_FLT_AVX("mm0", "mm1")\
+    HSUM_FLT_AVX("mm2", "mm3")\
+    "vmovss    %%xmm0, %1                 \n\t"\
+    "vmovss    %%xmm2, %2                 \n\t"\
+    "vzeroupper                           \n\t"\
+    : "+r" (len), "=m" (val), "=m" (v2)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len),\
+      "r" (((uint8_t*)(filter+c->filter_alloc))-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1", "%xmm2", "%xmm3")\
+);\
+    for(i=tail; i<c->filter_length; i++){\
+        val += src[sample_index + i] * filter[i];\
+        v2  += src[sample_index + i] * filter[i + c->filter_alloc];\
+    }
+
+#define COMMON_CORE_DBL_AVX \
+    int tail= c->filter_length & ~3;\
+    x86_reg len= -8*tail;\
+    double val;\
+__asm__ volatile(\
+    "vxorpd    %%ymm0, %%ymm0, %%ymm0     \n\t"\
+    "test         %0, %0                  \n\t"\
+    "jz           2f                      \n\t"\
+    "1:                                   \n\t"\
+    "vmovupd (%2, %0), %%ymm1             \n\t"\
+    "vmulpd  (%3, %0), %%ymm1, %%ymm1     \n\t"\
+    "vaddpd    %%ymm1, %%ymm0, %%ymm0     \n\t"\
+    "add         $32, %0                  \n\t"\
+    " js 1b                               \n\t"\
+    "2:                                   \n\t"\
+    HSUM_DBL_AVX("mm0", "mm1")\
+    "vmovsd    %%xmm0, %1                 \n\t"\
+    "vzeroupper                           \n\t"\
+    : "+r" (len), "=m" (val)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1")\
+);\
+    for(i=tail; i<c->filter_length; i++)\
+        val += src[sample_index + i] * filter[i];\
+    dst[dst_index] = val;
+
+#define LINEAR_CORE_DBL_AVX \
+    int tail= c->filter_length & ~3;\
+    x86_reg len= -8*tail;\
+__asm__ volatile(\
+    "vxorpd    %%ymm0, %%ymm0, %%ymm0     \n\t"\
+    "vxorpd    %%ymm2, %%ymm2, %%ymm2     \n\t"\
+    "test         %0, %0                  \n\t"\
+    "jz           2f                      \n\t"\
+    "1:                                   \n\t"\
+    "vmovupd (%3, %0), %%ymm1             \n\t"\
+    "vmulpd  (%5, %0), %%ymm1, %%ymm3     \n\t"\
+    "vmulpd  (%4, %0), %%ymm1, %%ymm1     \n\t"\
+    "vaddpd    %%ymm1, %%ymm0, %%ymm0     \n\t"\
+    "vaddpd    %%ymm3, %%ymm2, %%ymm2     \n\t"\
+    "add         $32, %0                  \n\t"\
+    " js 1b                               \n\t"\
+    "2:                                   \n\t"\
+    HSUM_DBL_AVX("mm0", "mm1")\
+    HSUM_DBL_AVX("mm2", "mm3")\
+    "vmovsd    %%xmm0, %1                 \n\t"\
+    "vmovsd    %%xmm2, %2                 \n\t"\
+    "vzeroupper                           \n\t"\
+    : "+r" (len), "=m" (val), "=m" (v2)\
+    : "r" (((uint8_t*)(src+sample_index))-len),\
+      "r" (((uint8_t*)filter)-len),\
+      "r" (((uint8_t*)(filter+c->filter_alloc))-len)\
+    XMM_CLOBBERS_ONLY("%xmm0", "%xmm1", "%xmm2", "%xmm3")\
+);\
+    for(i=tail; i<c->filter_length; i++){\
+        val += src[sample_index + i] * filter[i];\
+        v2  += src[sample_index + i] * filter[i + c->filter_alloc];\
+    }
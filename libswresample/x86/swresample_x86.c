@@ -29,6 +29,10 @@ PROTO4()
 PROTO4(_pack_2ch)
 PROTO4(_pack_6ch)
 PROTO4(_unpack_2ch)
+PROTO(, float, double, sse2)
+PROTO(, double, float, sse2)
+PROTO(, int32, double, sse2)
+PROTO(, double, int32, sse2)
 
 av_cold void swri_audio_convert_init_x86(struct AudioConvert *ac,
                                  enum AVSampleFormat out_fmt,
@@ -67,6 +71,14 @@ MULTI_CAPS_FUNC(AV_CPU_FLAG_SSE2, sse2)
             ac->simd_f =  ff_float_to_int32_a_sse2;
         if(   out_fmt == AV_SAMPLE_FMT_S16  && in_fmt == AV_SAMPLE_FMT_FLT || out_fmt == AV_SAMPLE_FMT_S16P && in_fmt == AV_SAMPLE_FMT_FLTP)
             ac->simd_f =  ff_float_to_int16_a_sse2;
+        if(   out_fmt == AV_SAMPLE_FMT_DBL  && in_fmt == AV_SAMPLE_FMT_FLT || out_fmt == AV_SAMPLE_FMT_DBLP && in_fmt == AV_SAMPLE_FMT_FLTP)
+            ac->simd_f =  ff_float_to_double_a_sse2;
+        if(   out_fmt == AV_SAMPLE_FMT_FLT  && in_fmt == AV_SAMPLE_FMT_DBL || out_fmt == AV_SAMPLE_FMT_FLTP && in_fmt == AV_SAMPLE_FMT_DBLP)
+            ac->simd_f =  ff_double_to_float_a_sse2;
+        if(   out_fmt == AV_SAMPLE_FMT_DBL  && in_fmt == AV_SAMPLE_FMT_S32 || out_fmt == AV_SAMPLE_FMT_DBLP && in_fmt == AV_SAMPLE_FMT_S32P)
+            ac->simd_f =  ff_int32_to_double_a_sse2;
+        if(   out_fmt == AV_SAMPLE_FMT_S32  && in_fmt == AV_SAMPLE_FMT_DBL || out_fmt == AV_SAMPLE_FMT_S32P && in_fmt == AV_SAMPLE_FMT_DBLP)
+            ac->simd_f =  ff_double_to_int32_a_sse2;
 
         if(channels == 2) {
             if(   out_fmt == AV_SAMPLE_FMT_FLT  && in_fmt == AV_SAMPLE_FMT_FLTP || out_fmt == AV_SAMPLE_FMT_S32 && in_fmt == AV_SAMPLE_FMT_S32P)
@@ -189,7 +201,7 @@ av_cold void swri_rematrix_init_x86(struct SwrContext *s){
             s->mix_1_1_simd = ff_mix_1_1_a_float_avx;
             s->mix_2_1_simd = ff_mix_2_1_a_float_avx;
         }
-        s->native_simd_matrix = av_mallocz(num * sizeof(float));
-        memcpy(s->native_simd_matrix, s->native_matrix, num * sizeof(float));
+        s->native_simd_matrix = av_mallocz((num + 1) * sizeof(float));
+        memcpy(s->native_simd_matrix, s->native_matrix, (num + 1) * sizeof(float));
     }
 }
@@ -0,0 +1,80 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/arm/cpu.h"
+#include "libswscale/rgb2rgb.h"
+
+void ff_interleave_bytes_neon(const uint8_t *src1, const uint8_t *src2,
+                              uint8_t *dst, int width);
+void ff_deinterleave_bytes_neon(const uint8_t *src, uint8_t *dst1,
+                                uint8_t *dst2, int width);
+
+static void interleave_bytes_neon(const uint8_t *src1, const uint8_t *src2,
+                                  uint8_t *dest, int width, int height,
+                                  int src1Stride, int src2Stride, int dstStride)
+{
+    int w16 = width & ~15;
+    int h;
+
+    for (h = 0; h < height; h++) {
+        int w;
+        if (w16)
+            ff_interleave_bytes_neon(src1, src2, dest, w16);
+        for (w = w16; w < width; w++) {
+            dest[2 * w + 0] = src1[w];
+            dest[2 * w + 1] = src2[w];
+        }
+        dest += dstStride;
+        src1 += src1Stride;
+        src2 += src2Stride;
+    }
+}
+
+static void deinterleave_bytes_neon(const uint8_t *src, uint8_t *dst1,
+                                    uint8_t *dst2, int width, int height,
+                                    int srcStride, int dst1Stride, int dst2Stride)
+{
+    int w16 = width & ~15;
+    int h;
+
+    for (h = 0; h < height; h++) {
+        int w;
+        if (w16)
+            ff_deinterleave_bytes_neon(src, dst1, dst2, w16);
+        for (w = w16; w < width; w++) {
+            dst1[w] = src[2 * w + 0];
+            dst2[w] = src[2 * w + 1];
+        }
+        src  += srcStride;
+        dst1 += dst1Stride;
+        dst2 += dst2Stride;
+    }
+}
+
+av_cold void rgb2rgb_init_arm(void)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (have_neon(cpu_flags)) {
+        interleaveBytes   = interleave_bytes_neon;
+        deinterleaveBytes = deinterleave_bytes_neon;
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/arm/cpu.h"
+#include "libavutil/common.h"
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+
+void ff_hscale_8_to_15_neon(SwsContext *c, int16_t *dst, int dstW,
+                            const uint8_t *src, const int16_t *filter,
+                            const int32_t *filterPos, int filterSize);
+void ff_yuv2planeX_8_neon(const int16_t *filter, int filterSize,
+                          const int16_t **src, uint8_t *dest, int dstW,
+                          const uint8_t dither[8]);
+
+static void hscale_8_to_15_neon(SwsContext *c, int16_t *dst, int dstW,
+                                const uint8_t *src, const int16_t *filter,
+                                const int32_t *filterPos, int filterSize)
+{
+    int i, w4 = dstW & ~3;
+
+    if (w4)
+        ff_hscale_8_to_15_neon(c, dst, w4, src, filter, filterPos, filterSize);
+
+    for (i = w4; i < dstW; i++) {
+        int j;
+        int srcPos = filterPos[i];
+        int val    = 0;
+        for (j = 0; j < filterSize; j++)
+            val += src[srcPos + j] * filter[filterSize * i + j];
+        dst[i] = FFMIN(val >> 7, (1 << 15) - 1);
+    }
+}
+
+static void yuv2planeX_8_neon(const int16_t *filter, int filterSize,
+                              const int16_t **src, uint8_t *dest, int dstW,
+                              const uint8_t *dither, int offset)
+{
+    uint8_t d[8];
+    int i, w8 = dstW & ~7;
+
+    for (i = 0; i < 8; i++)
+        d[i] = dither[(i + offset) & 7];
+
+    if (w8)
+        ff_yuv2planeX_8_neon(filter, filterSize, src, dest, w8, d);
+
+    for (i = w8; i < dstW; i++) {
+        int val = d[i & 7] << 12;
+        int j;
+        for (j = 0; j < filterSize; j++)
+            val += src[j][i] * filter[j];
+        dest[i] = av_clip_uint8(val >> 19);
+    }
+}
+
+av_cold void ff_sws_init_swScale_arm(SwsContext *c)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (have_neon(cpu_flags)) {
+        /* the horizontal filters are only padded to a multiple of 8 taps
+         * if NEON was enabled in the flags sws_init_context() used */
+        if (c->srcBpc == 8 && c->dstBpc <= 14 &&
+            !(c->hLumFilterSize & 7) && !(c->hChrFilterSize & 7))
+            c->hyScale = c->hcScale = hscale_8_to_15_neon;
+        if (c->dstBpc == 8)
+            c->yuv2planeX = yuv2planeX_8_neon;
+    }
+}
@@ -0,0 +1,141 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/arm/cpu.h"
+#include "libavutil/common.h"
+#include "libswscale/swscale.h"
+#include "libswscale/swscale_internal.h"
+
+typedef void (*yuv2rgb_row_fn)(uint8_t *dst, const uint8_t *y,
+                               const uint8_t *u, const uint8_t *v,
+                               int width, const int16_t coeffs[8]);
+
+#define YUV2RGB_ROW(name)                                                   \
+void ff_yuv2 ## name ## _row_neon(uint8_t *dst, const uint8_t *y,          \
+                                  const uint8_t *u, const uint8_t *v,       \
+                                  int width, const int16_t coeffs[8]);
+
+YUV2RGB_ROW(rgba)
+YUV2RGB_ROW(bgra)
+YUV2RGB_ROW(argb)
+YUV2RGB_ROW(abgr)
+YUV2RGB_ROW(rgb24)
+YUV2RGB_ROW(bgr24)
+
+static av_always_inline int mulhi(int a, int b)
+{
+    return (a * b) >> 16;
+}
+
+/**
+ * Convert the pixels the row functions leave over, with the same
+ * arithmetic as the NEON code.
+ */
+static av_always_inline void yuv2rgb_tail(uint8_t *dst, const uint8_t *py,
+                                          const uint8_t *pu, const uint8_t *pv,
+                                          int start, int end,
+                                          const int16_t *coeffs, int bpp,
+                                          int roff, int goff, int boff, int aoff)
+{
+    int x;
+
+    for (x = start; x < end; x++) {
+        int Y = mulhi((int16_t)((py[x] << 3) - coeffs[0]), coeffs[1]);
+        int U = av_clip_int16((pu[x >> 1] << 3) - coeffs[6]);
+        int V = av_clip_int16((pv[x >> 1] << 3) - coeffs[6]);
+        int G = av_clip_int16(mulhi(U, coeffs[3]) + mulhi(V, coeffs[4]));
+        uint8_t *out = dst + x * bpp;
+
+        out[roff] = av_clip_uint8(av_clip_int16(Y + mulhi(V, coeffs[5])));
+        out[goff] = av_clip_uint8(av_clip_int16(Y + G));
+        out[boff] = av_clip_uint8(av_clip_int16(Y + mulhi(U, coeffs[2])));
+        if (bpp == 4)
+            out[aoff] = 255;
+    }
+}
+
+static av_always_inline int yuv2rgb_neon(SwsContext *c, const uint8_t *src[],
+                                         int srcStride[], int srcSliceY,
+                                         int srcSliceH, uint8_t *dst[],
+                                         int dstStride[], yuv2rgb_row_fn row,
+                                         int bpp, int roff, int goff,
+                                         int boff, int aoff)
+{
+    const int16_t coeffs[8] = {
+        c->yOffset, c->yCoeff,  c->ubCoeff, c->ugCoeff,
+        c->vgCoeff, c->vrCoeff, c->uOffset, 0
+    };
+    int vshift = c->srcFormat != AV_PIX_FMT_YUV422P;
+    int w8     = c->dstW & ~7;
+    int y;
+
+    for (y = 0; y < srcSliceH; y++) {
+        uint8_t *out      = dst[0] + (y + srcSliceY) * dstStride[0];
+        const uint8_t *py = src[0] +  y            * srcStride[0];
+        const uint8_t *pu = src[1] + (y >> vshift) * srcStride[1];
+        const uint8_t *pv = src[2] + (y >> vshift) * srcStride[2];
+
+        if (w8)
+            row(out, py, pu, pv, w8, coeffs);
+        yuv2rgb_tail(out, py, pu, pv, w8, c->dstW, coeffs,
+                     bpp, roff, goff, boff, aoff);
+    }
+    return srcSliceH;
+}
+
+#define YUV2RGB_FUNC(name, bpp, roff, goff, boff, aoff)                     \
+static int yuv2 ## name ## _neon(SwsContext *c, const uint8_t *src[],       \
+                                 int srcStride[], int srcSliceY,            \
+                                 int srcSliceH, uint8_t *dst[],             \
+                                 int dstStride[])                           \
+{                                                                           \
+    return yuv2rgb_neon(c, src, srcStride, srcSliceY, srcSliceH,            \
+                        dst, dstStride, ff_yuv2 ## name ## _row_neon,       \
+                        bpp, roff, goff, boff, aoff);                       \
+}
+
+YUV2RGB_FUNC(rgba,  4, 0, 1, 2, 3)
+YUV2RGB_FUNC(bgra,  4, 2, 1, 0, 3)
+YUV2RGB_FUNC(argb,  4, 1, 2, 3, 0)
+YUV2RGB_FUNC(abgr,  4, 3, 2, 1, 0)
+YUV2RGB_FUNC(rgb24, 3, 0, 1, 2, 0)
+YUV2RGB_FUNC(bgr24, 3, 2, 1, 0, 0)
+
+av_cold SwsFunc ff_yuv2rgb_init_arm(SwsContext *c)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (!have_neon(cpu_flags) ||
+        (c->srcFormat != AV_PIX_FMT_YUV420P &&
+         c->srcFormat != AV_PIX_FMT_YUV422P))
+        return NULL;
+
+    switch (c->dstFormat) {
+    case AV_PIX_FMT_RGBA:  return yuv2rgba_neon;
+    case AV_PIX_FMT_BGRA:  return yuv2bgra_neon;
+    case AV_PIX_FMT_ARGB:  return yuv2argb_neon;
+    case AV_PIX_FMT_ABGR:  return yuv2abgr_neon;
+    case AV_PIX_FMT_RGB24: return yuv2rgb24_neon;
+    case AV_PIX_FMT_BGR24: return yuv2bgr24_neon;
+    }
+
+    return NULL;
+}
@@ -62,6 +62,7 @@ static const AVOption options[] = {
     { "dst_range",       "destination range",             OFFSET(dstRange),  AV_OPT_TYPE_INT,    { .i64 = DEFAULT            }, 0,       1,              VE },
     { "param0",          "scaler param 0",                OFFSET(param[0]),  AV_OPT_TYPE_DOUBLE, { .dbl = SWS_PARAM_DEFAULT  }, INT_MIN, INT_MAX,        VE },
     { "param1",          "scaler param 1",                OFFSET(param[1]),  AV_OPT_TYPE_DOUBLE, { .dbl = SWS_PARAM_DEFAULT  }, INT_MIN, INT_MAX,        VE },
+    { "threads",         "number of threads (0 = auto)",  OFFSET(nb_threads), AV_OPT_TYPE_INT,   { .i64 = 1                  }, 0,       INT_MAX,        VE },
 
     { NULL }
 };
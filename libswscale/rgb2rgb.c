@@ -82,6 +82,9 @@ void (*planar2x)(const uint8_t *src, uint8_t *dst, int width, int height,
 void (*interleaveBytes)(const uint8_t *src1, const uint8_t *src2, uint8_t *dst,
                         int width, int height, int src1Stride,
                         int src2Stride, int dstStride);
+void (*deinterleaveBytes)(const uint8_t *src, uint8_t *dst1, uint8_t *dst2,
+                          int width, int height, int srcStride,
+                          int dst1Stride, int dst2Stride);
 void (*vu9_to_vu12)(const uint8_t *src1, const uint8_t *src2,
                     uint8_t *dst1, uint8_t *dst2,
                     int width, int height,
@@ -131,6 +134,8 @@ av_cold void sws_rgb2rgb_init(void)
     rgb2rgb_init_c();
     if (HAVE_MMX)
         rgb2rgb_init_x86();
+    if (ARCH_ARM)
+        rgb2rgb_init_arm();
 }
 
 void rgb32to24(const uint8_t *src, uint8_t *dst, int src_size)
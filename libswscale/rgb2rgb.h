@@ -134,6 +134,10 @@ extern void (*interleaveBytes)(const uint8_t *src1, const uint8_t *src2, uint8_t
                                int width, int height, int src1Stride,
                                int src2Stride, int dstStride);
 
+extern void (*deinterleaveBytes)(const uint8_t *src, uint8_t *dst1, uint8_t *dst2,
+                                 int width, int height, int srcStride,
+                                 int dst1Stride, int dst2Stride);
+
 extern void (*vu9_to_vu12)(const uint8_t *src1, const uint8_t *src2,
                            uint8_t *dst1, uint8_t *dst2,
                            int width, int height,
@@ -162,5 +166,6 @@ extern void (*yuyvtoyuv422)(uint8_t *ydst, uint8_t *udst, uint8_t *vdst, const u
 void sws_rgb2rgb_init(void);
 
 void rgb2rgb_init_x86(void);
+void rgb2rgb_init_arm(void);
 
 #endif /* SWSCALE_RGB2RGB_H */
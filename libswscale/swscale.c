@@ -31,6 +31,7 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/slicethread.h"
 #include "config.h"
 #include "rgb2rgb.h"
 #include "swscale_internal.h"
@@ -434,7 +435,7 @@ static int swScale(SwsContext *c, const uint8_t *src[],
     if (srcSliceY == 0) {
         lumBufIndex  = -1;
         chrBufIndex  = -1;
-        dstY         = 0;
+        dstY         = c->dst_slice_start;
         lastInLumBuf = -1;
         lastInChrBuf = -1;
     }
@@ -444,7 +445,7 @@ static int swScale(SwsContext *c, const uint8_t *src[],
     }
     lastDstY = dstY;
 
-    for (; dstY < dstH; dstY++) {
+    for (; dstY < c->dst_slice_end; dstY++) {
         const int chrDstY = dstY >> c->chrDstVSubSample;
         uint8_t *dest[4]  = {
             dst[0] + dstStride[0] * dstY,
@@ -747,10 +748,65 @@ SwsFunc ff_getSwsFunc(SwsContext *c)
         ff_sws_init_swScale_mmx(c);
     if (HAVE_ALTIVEC)
         ff_sws_init_swScale_altivec(c);
+    if (ARCH_ARM)
+        ff_sws_init_swScale_arm(c);
 
     return swScale;
 }
 
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads)
+{
+    SwsContext *c     = priv;
+    SwsContext *slice = c->slice_ctx[jobnr];
+    const uint8_t *src[4];
+    uint8_t *dst[4];
+    int srcStride[4], dstStride[4];
+
+    // swScale() modifies the pointer and stride arrays it is given
+    memcpy(src,       c->slice_src,        sizeof(src));
+    memcpy(dst,       c->slice_dst,        sizeof(dst));
+    memcpy(srcStride, c->slice_src_stride, sizeof(srcStride));
+    memcpy(dstStride, c->slice_dst_stride, sizeof(dstStride));
+
+    c->slice_ret[jobnr] = swScale(slice, src, srcStride, 0, c->srcH,
+                                  dst, dstStride);
+}
+
+/**
+ * Scale one input slice, spreading the work over the slice contexts when
+ * a complete frame is passed in a single call.
+ */
+static int scale_internal(SwsContext *c, const uint8_t *src[],
+                          int srcStride[], int srcSliceY, int srcSliceH,
+                          uint8_t *dst[], int dstStride[])
+{
+    int i, ret = 0;
+
+    if (!c->slicethread || srcSliceY || srcSliceH != c->srcH)
+        return c->swScale(c, src, srcStride, srcSliceY, srcSliceH,
+                          dst, dstStride);
+
+    memcpy(c->slice_src,        src,       sizeof(c->slice_src));
+    memcpy(c->slice_dst,        dst,       sizeof(c->slice_dst));
+    memcpy(c->slice_src_stride, srcStride, sizeof(c->slice_src_stride));
+    memcpy(c->slice_dst_stride, dstStride, sizeof(c->slice_dst_stride));
+
+    if (usePal(c->srcFormat)) {
+        for (i = 0; i < c->nb_slice_ctx; i++) {
+            memcpy(c->slice_ctx[i]->pal_yuv, c->pal_yuv, sizeof(c->pal_yuv));
+            memcpy(c->slice_ctx[i]->pal_rgb, c->pal_rgb, sizeof(c->pal_rgb));
+        }
+    }
+
+    avpriv_slicethread_execute(c->slicethread, c->nb_slice_ctx);
+
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        ret += c->slice_ret[i];
+
+    return ret;
+}
+
 static void reset_ptr(const uint8_t *src[], int format)
 {
     if (!isALPHA(format))
@@ -924,8 +980,8 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
         if (srcSliceY + srcSliceH == c->srcH)
             c->sliceDir = 0;
 
-        ret = c->swScale(c, src2, srcStride2, srcSliceY, srcSliceH, dst2,
-                          dstStride2);
+        ret = scale_internal(c, src2, srcStride2, srcSliceY, srcSliceH, dst2,
+                             dstStride2);
     } else {
         // slices go from bottom to top => we flip the image internally
         int srcStride2[4] = { -srcStride[0], -srcStride[1], -srcStride[2],
@@ -950,8 +1006,8 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
         if (!srcSliceY)
             c->sliceDir = 0;
 
-        ret = c->swScale(c, src2, srcStride2, c->srcH-srcSliceY-srcSliceH,
-                          srcSliceH, dst2, dstStride2);
+        ret = scale_internal(c, src2, srcStride2, c->srcH-srcSliceY-srcSliceH,
+                             srcSliceH, dst2, dstStride2);
     }
 
     av_free(rgb0_tmp);
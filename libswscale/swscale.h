@@ -303,8 +303,11 @@ void sws_freeFilter(SwsFilter *filter);
  * If context is NULL, just calls sws_getContext() to get a new
  * context. Otherwise, checks if the parameters are the ones already
  * saved in context. If that is the case, returns the current
- * context. Otherwise, frees context and gets a new context with
- * the new parameters.
+ * context. Otherwise, returns a context for the new parameters, either
+ * one that context replaced in a recent call or a newly allocated one.
+ * Replaced contexts are kept in a small cache owned by the returned
+ * context, so the caller must not use context again and only needs to
+ * free the returned one.
  *
  * Be warned that srcFilter and dstFilter are not checked, they
  * are assumed to remain the same.
@@ -224,6 +224,8 @@ typedef void (*yuv2packedX_fn)(struct SwsContext *c, const int16_t *lumFilter,
                                int dstW, int y);
 
 /* This struct should be aligned on at least a 32-byte boundary. */
+#define SWS_MAX_CACHED 7
+
 typedef struct SwsContext {
     /**
      * info on struct for av_log
@@ -530,10 +532,45 @@ typedef struct SwsContext {
     void (*chrConvertRange)(int16_t *dst1, int16_t *dst2, int width);
 
     int needs_hcscale; ///< Set if there are chroma planes to be converted.
+
+    int nb_threads;               ///< Number of threads requested by the user (0 = auto).
+    int dst_slice_start;          ///< First destination line output by this context.
+    int dst_slice_end;            ///< Destination line after the last one output by this context.
+
+    /**
+     * Slice threading: each worker owns a full context for a horizontal band
+     * of the destination image, so the vertical filter ring buffers are
+     * never shared between threads.
+     */
+    /** @{ */
+    struct AVSliceThread *slicethread;
+    struct SwsContext  **slice_ctx;
+    int                 *slice_ret;
+    int                  nb_slice_ctx;
+    const uint8_t       *slice_src[4];
+    int                  slice_src_stride[4];
+    uint8_t             *slice_dst[4];
+    int                  slice_dst_stride[4];
+    /** @} */
+
+    /**
+     * Contexts for other parameters recently replaced by this one in
+     * sws_getCachedContext(), most recently used first. They are owned by
+     * this context and freed with it.
+     */
+    struct SwsContext   *cached[SWS_MAX_CACHED];
+    int                  nb_cached;
 } SwsContext;
 //FIXME check init (where 0)
 
 SwsFunc ff_yuv2rgb_get_func_ptr(SwsContext *c);
+
+/**
+ * Slice thread worker: run the jobnr-th slice context over the frame
+ * stored in the slice_src/slice_dst fields of the context passed as priv.
+ */
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads);
 int ff_yuv2rgb_c_init_tables(SwsContext *c, const int inv_table[4],
                              int fullRange, int brightness,
                              int contrast, int saturation);
@@ -547,6 +584,7 @@ SwsFunc ff_yuv2rgb_init_mmx(SwsContext *c);
 SwsFunc ff_yuv2rgb_init_vis(SwsContext *c);
 SwsFunc ff_yuv2rgb_init_altivec(SwsContext *c);
 SwsFunc ff_yuv2rgb_get_func_ptr_bfin(SwsContext *c);
+SwsFunc ff_yuv2rgb_init_arm(SwsContext *c);
 void ff_bfin_get_unscaled_swscale(SwsContext *c);
 
 #if FF_API_SWS_FORMAT_NAME
@@ -769,6 +807,7 @@ void ff_sws_init_output_funcs(SwsContext *c,
                               yuv2packedX_fn *yuv2packedX);
 void ff_sws_init_swScale_altivec(SwsContext *c);
 void ff_sws_init_swScale_mmx(SwsContext *c);
+void ff_sws_init_swScale_arm(SwsContext *c);
 
 static inline void fillPlane16(uint8_t *plane, int stride, int width, int height, int y,
                                int alpha, int bits, const int big_endian)
@@ -46,6 +46,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/x86/asm.h"
 #include "libavutil/x86/cpu.h"
 #include "rgb2rgb.h"
@@ -805,6 +806,8 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
 {
     const AVPixFmtDescriptor *desc_dst = av_pix_fmt_desc_get(c->dstFormat);
     const AVPixFmtDescriptor *desc_src = av_pix_fmt_desc_get(c->srcFormat);
+    int i;
+
     memcpy(c->srcColorspaceTable, inv_table, sizeof(int) * 4);
     memcpy(c->dstColorspaceTable, table, sizeof(int) * 4);
 
@@ -819,6 +822,10 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
     c->srcRange   = srcRange;
     c->dstRange   = dstRange;
 
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_setColorspaceDetails(c->slice_ctx[i], inv_table, srcRange, table,
+                                 dstRange, brightness, contrast, saturation);
+
     if (isYUV(c->dstFormat) || isGray(c->dstFormat))
         return -1;
 
@@ -894,6 +901,78 @@ SwsContext *sws_alloc_context(void)
     return c;
 }
 
+static av_cold int init_slice_contexts(SwsContext *c, SwsFilter *srcFilter,
+                                       SwsFilter *dstFilter)
+{
+    const int align = 1 << c->chrDstVSubSample;
+    int i, nb_threads, nb_slices;
+
+    nb_threads = avpriv_slicethread_create(&c->slicethread, c,
+                                           ff_sws_slice_worker, c->nb_threads);
+    if (nb_threads == AVERROR(ENOSYS))
+        return 0;
+    if (nb_threads < 0)
+        return nb_threads;
+
+    // keep every band at least a few chroma lines high
+    nb_slices = FFMIN(nb_threads, c->dstH / (8 * align));
+    if (nb_slices <= 1) {
+        avpriv_slicethread_free(&c->slicethread);
+        return 0;
+    }
+
+    c->slice_ctx = av_mallocz(nb_slices * sizeof(*c->slice_ctx));
+    c->slice_ret = av_mallocz(nb_slices * sizeof(*c->slice_ret));
+    if (!c->slice_ctx || !c->slice_ret)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < nb_slices; i++) {
+        SwsContext *slice = sws_alloc_context();
+        if (!slice)
+            return AVERROR(ENOMEM);
+        c->slice_ctx[i] = slice;
+        c->nb_slice_ctx++;
+
+        slice->srcW       = c->srcW;
+        slice->srcH       = c->srcH;
+        slice->dstW       = c->dstW;
+        slice->dstH       = c->dstH;
+        slice->srcFormat  = c->srcFormat;
+        slice->dstFormat  = c->dstFormat;
+        slice->srcRange   = c->srcRange;
+        slice->dstRange   = c->dstRange;
+        slice->flags      = c->flags & ~SWS_PRINT_INFO;
+        slice->param[0]   = c->param[0];
+        slice->param[1]   = c->param[1];
+        slice->nb_threads = 1;
+
+        if (sws_init_context(slice, srcFilter, dstFilter) < 0)
+            return AVERROR(EINVAL);
+
+        sws_setColorspaceDetails(slice, c->srcColorspaceTable, c->srcRange,
+                                 c->dstColorspaceTable, c->dstRange,
+                                 c->brightness, c->contrast, c->saturation);
+
+        slice->dst_slice_start = FFALIGN(c->dstH *  i      / nb_slices, align);
+        slice->dst_slice_end   = i == nb_slices - 1 ? c->dstH :
+                                 FFALIGN(c->dstH * (i + 1) / nb_slices, align);
+    }
+
+    return 0;
+}
+
+static av_cold void free_slice_contexts(SwsContext *c)
+{
+    int i;
+
+    avpriv_slicethread_free(&c->slicethread);
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_freeContext(c->slice_ctx[i]);
+    av_freep(&c->slice_ctx);
+    av_freep(&c->slice_ret);
+    c->nb_slice_ctx = 0;
+}
+
 av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
                              SwsFilter *dstFilter)
 {
@@ -920,10 +999,10 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
 
     unscaled = (srcW == dstW && srcH == dstH);
 
-    handle_jpeg(&srcFormat);
-    handle_jpeg(&dstFormat);
-    handle_0alpha(&srcFormat);
-    handle_0alpha(&dstFormat);
+    c->srcRange  |= handle_jpeg(&srcFormat);
+    c->dstRange  |= handle_jpeg(&dstFormat);
+    c->src0Alpha |= handle_0alpha(&srcFormat);
+    c->dst0Alpha |= handle_0alpha(&dstFormat);
 
     if(srcFormat!=c->srcFormat || dstFormat!=c->dstFormat){
         av_log(c, AV_LOG_WARNING, "deprecated pixel format used, make sure you did set range correctly\n");
@@ -931,6 +1010,12 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
         c->dstFormat= dstFormat;
     }
 
+    /* the context was set up through AVOptions only */
+    if (!c->contrast && !c->saturation && !c->dstFormatBpp)
+        sws_setColorspaceDetails(c, ff_yuv2rgb_coeffs[SWS_CS_DEFAULT], c->srcRange,
+                                 ff_yuv2rgb_coeffs[SWS_CS_DEFAULT],
+                                 c->dstRange, 0, 1 << 16, 1 << 16);
+
     if (!sws_isSupportedInput(srcFormat)) {
         av_log(c, AV_LOG_ERROR, "%s is not supported as input pixel format\n",
                av_get_pix_fmt_name(srcFormat));
@@ -1166,6 +1251,7 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
             const int filterAlign =
                 (HAVE_MMX && cpu_flags & AV_CPU_FLAG_MMX) ? 4 :
                 (HAVE_ALTIVEC && cpu_flags & AV_CPU_FLAG_ALTIVEC) ? 8 :
+                (HAVE_NEON    && cpu_flags & AV_CPU_FLAG_NEON)    ? 8 :
                 1;
 
             if (initFilter(&c->hLumFilter, &c->hLumFilterPos,
@@ -1335,6 +1421,8 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
             av_log(c, AV_LOG_INFO, "using MMX\n");
         else if (HAVE_ALTIVEC && cpu_flags & AV_CPU_FLAG_ALTIVEC)
             av_log(c, AV_LOG_INFO, "using AltiVec\n");
+        else if (HAVE_NEON && cpu_flags & AV_CPU_FLAG_NEON)
+            av_log(c, AV_LOG_INFO, "using NEON\n");
         else
             av_log(c, AV_LOG_INFO, "using C\n");
 
@@ -1349,6 +1437,14 @@ av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
     }
 
     c->swScale = ff_getSwsFunc(c);
+
+    c->dst_slice_start = 0;
+    c->dst_slice_end   = dstH;
+    if (c->nb_threads != 1 && init_slice_contexts(c, srcFilter, dstFilter) < 0) {
+        av_log(c, AV_LOG_ERROR, "Failed to initialize slice threading\n");
+        free_slice_contexts(c);
+        return -1;
+    }
     return 0;
 fail: // FIXME replace things by appropriate error codes
     return -1;
@@ -1719,6 +1815,11 @@ void sws_freeContext(SwsContext *c)
     if (!c)
         return;
 
+    free_slice_contexts(c);
+
+    for (i = 0; i < c->nb_cached; i++)
+        sws_freeContext(c->cached[i]);
+
     if (c->lumPixBuf) {
         for (i = 0; i < c->vLumBufSize; i++)
             av_freep(&c->lumPixBuf[i]);
@@ -1777,6 +1878,37 @@ void sws_freeContext(SwsContext *c)
     av_free(c);
 }
 
+/**
+ * Check whether c was set up for the given parameters. The J and 0-alpha
+ * formats are stored as their plain counterparts with the range or alpha
+ * flag set, so only require the flag for them: the caller may have changed
+ * the range with sws_setColorspaceDetails() for a plain format.
+ */
+static int context_matches(SwsContext *c, int srcW, int srcH,
+                           enum AVPixelFormat srcFormat, int dstW, int dstH,
+                           enum AVPixelFormat dstFormat, int flags,
+                           const double *param)
+{
+    int srcRange  = handle_jpeg(&srcFormat);
+    int src0Alpha = handle_0alpha(&srcFormat);
+    int dstRange  = handle_jpeg(&dstFormat);
+    int dst0Alpha = handle_0alpha(&dstFormat);
+
+    return c->srcW      == srcW      &&
+           c->srcH      == srcH      &&
+           c->srcFormat == srcFormat &&
+           c->dstW      == dstW      &&
+           c->dstH      == dstH      &&
+           c->dstFormat == dstFormat &&
+           c->flags     == flags     &&
+           c->param[0]  == param[0]  &&
+           c->param[1]  == param[1]  &&
+           (!srcRange  || c->srcRange)  &&
+           (!src0Alpha || c->src0Alpha) &&
+           (!dstRange  || c->dstRange)  &&
+           (!dst0Alpha || c->dst0Alpha);
+}
+
 struct SwsContext *sws_getCachedContext(struct SwsContext *context, int srcW,
                                         int srcH, enum AVPixelFormat srcFormat,
                                         int dstW, int dstH,
@@ -1787,48 +1919,67 @@ struct SwsContext *sws_getCachedContext(struct SwsContext *context, int srcW,
 {
     static const double default_param[2] = { SWS_PARAM_DEFAULT,
                                              SWS_PARAM_DEFAULT };
+    SwsContext *next = NULL;
+    int i;
 
     if (!param)
         param = default_param;
 
-    if (context &&
-        (context->srcW      != srcW      ||
-         context->srcH      != srcH      ||
-         context->srcFormat != srcFormat ||
-         context->dstW      != dstW      ||
-         context->dstH      != dstH      ||
-         context->dstFormat != dstFormat ||
-         context->flags     != flags     ||
-         context->param[0]  != param[0]  ||
-         context->param[1]  != param[1])) {
-        sws_freeContext(context);
-        context = NULL;
+    if (context && context_matches(context, srcW, srcH, srcFormat,
+                                   dstW, dstH, dstFormat, flags, param))
+        return context;
+
+    if (context) {
+        for (i = 0; i < context->nb_cached; i++) {
+            if (context_matches(context->cached[i], srcW, srcH, srcFormat,
+                                dstW, dstH, dstFormat, flags, param)) {
+                next = context->cached[i];
+                memmove(&context->cached[i], &context->cached[i + 1],
+                        (--context->nb_cached - i) * sizeof(*context->cached));
+                break;
+            }
+        }
     }
 
-    if (!context) {
-        if (!(context = sws_alloc_context()))
+    if (!next) {
+        if (!(next = sws_alloc_context())) {
+            sws_freeContext(context);
             return NULL;
-        context->srcW      = srcW;
-        context->srcH      = srcH;
-        context->srcRange  = handle_jpeg(&srcFormat);
-        context->src0Alpha = handle_0alpha(&srcFormat);
-        context->srcFormat = srcFormat;
-        context->dstW      = dstW;
-        context->dstH      = dstH;
-        context->dstRange  = handle_jpeg(&dstFormat);
-        context->dst0Alpha = handle_0alpha(&dstFormat);
-        context->dstFormat = dstFormat;
-        context->flags     = flags;
-        context->param[0]  = param[0];
-        context->param[1]  = param[1];
-        sws_setColorspaceDetails(context, ff_yuv2rgb_coeffs[SWS_CS_DEFAULT],
-                                 context->srcRange,
+        }
+        next->srcW      = srcW;
+        next->srcH      = srcH;
+        next->srcRange  = handle_jpeg(&srcFormat);
+        next->src0Alpha = handle_0alpha(&srcFormat);
+        next->srcFormat = srcFormat;
+        next->dstW      = dstW;
+        next->dstH      = dstH;
+        next->dstRange  = handle_jpeg(&dstFormat);
+        next->dst0Alpha = handle_0alpha(&dstFormat);
+        next->dstFormat = dstFormat;
+        next->flags     = flags;
+        next->param[0]  = param[0];
+        next->param[1]  = param[1];
+        sws_setColorspaceDetails(next, ff_yuv2rgb_coeffs[SWS_CS_DEFAULT],
+                                 next->srcRange,
                                  ff_yuv2rgb_coeffs[SWS_CS_DEFAULT] /* FIXME*/,
-                                 context->dstRange, 0, 1 << 16, 1 << 16);
-        if (sws_init_context(context, srcFilter, dstFilter) < 0) {
+                                 next->dstRange, 0, 1 << 16, 1 << 16);
+        if (sws_init_context(next, srcFilter, dstFilter) < 0) {
+            sws_freeContext(next);
             sws_freeContext(context);
             return NULL;
         }
     }
-    return context;
+
+    /* the new context takes over the old one and its cache, dropping the
+     * least recently used entry when full */
+    if (context) {
+        if (context->nb_cached == SWS_MAX_CACHED)
+            sws_freeContext(context->cached[--context->nb_cached]);
+        next->cached[0] = context;
+        memcpy(&next->cached[1], context->cached,
+               context->nb_cached * sizeof(*context->cached));
+        next->nb_cached    = context->nb_cached + 1;
+        context->nb_cached = 0;
+    }
+    return next;
 }
@@ -26,16 +26,24 @@ SECTION_RODATA
 
 minshort:      times 8 dw 0x8000
 yuv2yuvX_16_start:  times 4 dd 0x4000 - 0x40000000
+yuv2yuvX_14_start:  times 4 dd 0x1000
+yuv2yuvX_12_start:  times 4 dd 0x4000
 yuv2yuvX_10_start:  times 4 dd 0x10000
 yuv2yuvX_9_start:   times 4 dd 0x20000
+yuv2yuvX_14_upper:  times 8 dw 0x3fff
+yuv2yuvX_12_upper:  times 8 dw 0xfff
 yuv2yuvX_10_upper:  times 8 dw 0x3ff
 yuv2yuvX_9_upper:   times 8 dw 0x1ff
 pd_4:          times 4 dd 4
 pd_4min0x40000:times 4 dd 4 - (0x40000)
+pw_1:          times 8 dw 1
+pw_4:          times 8 dw 4
 pw_16:         times 8 dw 16
 pw_32:         times 8 dw 32
 pw_512:        times 8 dw 512
 pw_1024:       times 8 dw 1024
+pw_4096:       times 8 dw 4096
+pw_16384:      times 8 dw 16384
 
 SECTION .text
 
@@ -66,9 +74,9 @@ SECTION .text
 %endif
 
 cglobal yuv2planeX_%1, %3, 8, %2, filter, fltsize, src, dst, w, dither, offset
-%if %1 == 8 || %1 == 9 || %1 == 10
+%if %1 != 16
     pxor            m6,  m6
-%endif ; %1 == 8/9/10
+%endif ; %1 != 16
 
 %if %1 == 8
 %if ARCH_X86_32
@@ -145,7 +153,7 @@ cglobal yuv2planeX_%1, %3, 8, %2, filter, fltsize, src, dst, w, dither, offset
     mova            m2,  m8
     mova            m1,  m_dith
 %endif ; x86-32/64
-%else ; %1 == 9/10/16
+%else ; %1 == 9-16
     mova            m1, [yuv2yuvX_%1_start]
     mova            m2,  m1
 %endif ; %1 == 8/9/10/16
@@ -215,7 +223,7 @@ cglobal yuv2planeX_%1, %3, 8, %2, filter, fltsize, src, dst, w, dither, offset
 %if %1 == 16
     packssdw        m2,  m1
     paddw           m2, [minshort]
-%else ; %1 == 9/10
+%else ; %1 == 9-14
 %if cpuflag(sse4)
     packusdw        m2,  m1
 %else ; mmxext/sse2
@@ -251,17 +259,23 @@ INIT_MMX mmxext
 yuv2planeX_fn  8,  0, 7
 yuv2planeX_fn  9,  0, 5
 yuv2planeX_fn 10,  0, 5
+yuv2planeX_fn 12,  0, 5
+yuv2planeX_fn 14,  0, 5
 %endif
 
 INIT_XMM sse2
 yuv2planeX_fn  8, 10, 7
 yuv2planeX_fn  9,  7, 5
 yuv2planeX_fn 10,  7, 5
+yuv2planeX_fn 12,  7, 5
+yuv2planeX_fn 14,  7, 5
 
 INIT_XMM sse4
 yuv2planeX_fn  8, 10, 7
 yuv2planeX_fn  9,  7, 5
 yuv2planeX_fn 10,  7, 5
+yuv2planeX_fn 12,  7, 5
+yuv2planeX_fn 14,  7, 5
 yuv2planeX_fn 16,  8, 5
 
 %if HAVE_AVX_EXTERNAL
@@ -269,6 +283,8 @@ INIT_XMM avx
 yuv2planeX_fn  8, 10, 7
 yuv2planeX_fn  9,  7, 5
 yuv2planeX_fn 10,  7, 5
+yuv2planeX_fn 12,  7, 5
+yuv2planeX_fn 14,  7, 5
 %endif
 
 ; %1=outout-bpc, %2=alignment (u/a)
@@ -301,7 +317,7 @@ yuv2planeX_fn 10,  7, 5
 %endif ; mmx/sse2/sse4/avx
     mov%2    [dstq+wq*2+mmsize*0], m0
     mov%2    [dstq+wq*2+mmsize*1], m2
-%else ; %1 == 9/10
+%else ; %1 == 9/10/12/14
     paddsw          m0, m2, [srcq+wq*2+mmsize*0]
     paddsw          m1, m2, [srcq+wq*2+mmsize*1]
     psraw           m0, 15 - %1
@@ -362,6 +378,14 @@ cglobal yuv2plane1_%1, %3, %3, %2, src, dst, w, dither, offset
     pxor            m4, m4
     mova            m3, [pw_1024]
     mova            m2, [pw_16]
+%elif %1 == 12
+    pxor            m4, m4
+    mova            m3, [pw_4096]
+    mova            m2, [pw_4]
+%elif %1 == 14
+    pxor            m4, m4
+    mova            m3, [pw_16384]
+    mova            m2, [pw_1]
 %else ; %1 == 16
 %if cpuflag(sse4) ; sse4/avx
     mova            m4, [pd_4]
@@ -393,12 +417,16 @@ yuv2plane1_fn 16, 0, 3
 INIT_MMX mmxext
 yuv2plane1_fn  9, 0, 3
 yuv2plane1_fn 10, 0, 3
+yuv2plane1_fn 12, 0, 3
+yuv2plane1_fn 14, 0, 3
 %endif
 
 INIT_XMM sse2
 yuv2plane1_fn  8, 5, 5
 yuv2plane1_fn  9, 5, 3
 yuv2plane1_fn 10, 5, 3
+yuv2plane1_fn 12, 5, 3
+yuv2plane1_fn 14, 5, 3
 yuv2plane1_fn 16, 6, 3
 
 INIT_XMM sse4
@@ -409,5 +437,7 @@ INIT_XMM avx
 yuv2plane1_fn  8, 5, 5
 yuv2plane1_fn  9, 5, 3
 yuv2plane1_fn 10, 5, 3
+yuv2plane1_fn 12, 5, 3
+yuv2plane1_fn 14, 5, 3
 yuv2plane1_fn 16, 5, 3
 %endif
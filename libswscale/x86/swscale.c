@@ -314,7 +314,9 @@ extern void ff_yuv2planeX_ ## size ## _ ## opt(const int16_t *filter, int filter
 #define VSCALEX_FUNCS(opt) \
     VSCALEX_FUNC(8,  opt); \
     VSCALEX_FUNC(9,  opt); \
-    VSCALEX_FUNC(10, opt)
+    VSCALEX_FUNC(10, opt); \
+    VSCALEX_FUNC(12, opt); \
+    VSCALEX_FUNC(14, opt)
 
 #if ARCH_X86_32
 VSCALEX_FUNCS(mmxext);
@@ -331,6 +333,8 @@ extern void ff_yuv2plane1_ ## size ## _ ## opt(const int16_t *src, uint8_t *dst,
     VSCALE_FUNC(8,  opt1); \
     VSCALE_FUNC(9,  opt2); \
     VSCALE_FUNC(10, opt2); \
+    VSCALE_FUNC(12, opt2); \
+    VSCALE_FUNC(14, opt2); \
     VSCALE_FUNC(16, opt1)
 
 #if ARCH_X86_32
@@ -420,6 +424,8 @@ av_cold void ff_sws_init_swScale_mmx(SwsContext *c)
 #define ASSIGN_VSCALEX_FUNC(vscalefn, opt, do_16_case, condition_8bit) \
 switch(c->dstBpc){ \
     case 16:                          do_16_case;                          break; \
+    case 14: if (!isBE(c->dstFormat)) vscalefn = ff_yuv2planeX_14_ ## opt; break; \
+    case 12: if (!isBE(c->dstFormat)) vscalefn = ff_yuv2planeX_12_ ## opt; break; \
     case 10: if (!isBE(c->dstFormat)) vscalefn = ff_yuv2planeX_10_ ## opt; break; \
     case 9:  if (!isBE(c->dstFormat)) vscalefn = ff_yuv2planeX_9_  ## opt; break; \
     default: if (condition_8bit)    /*vscalefn = ff_yuv2planeX_8_  ## opt;*/ break; \
@@ -427,6 +433,8 @@ switch(c->dstBpc){ \
 #define ASSIGN_VSCALE_FUNC(vscalefn, opt1, opt2, opt2chk) \
     switch(c->dstBpc){ \
     case 16: if (!isBE(c->dstFormat))            vscalefn = ff_yuv2plane1_16_ ## opt1; break; \
+    case 14: if (!isBE(c->dstFormat) && opt2chk) vscalefn = ff_yuv2plane1_14_ ## opt2; break; \
+    case 12: if (!isBE(c->dstFormat) && opt2chk) vscalefn = ff_yuv2plane1_12_ ## opt2; break; \
     case 10: if (!isBE(c->dstFormat) && opt2chk) vscalefn = ff_yuv2plane1_10_ ## opt2; break; \
     case 9:  if (!isBE(c->dstFormat) && opt2chk) vscalefn = ff_yuv2plane1_9_  ## opt2;  break; \
     case 8:                                      vscalefn = ff_yuv2plane1_8_  ## opt1;  break; \
@@ -28,6 +28,7 @@
 #include <stdlib.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <string.h>
 
 #include "config.h"
 #include "libswscale/rgb2rgb.h"
@@ -35,6 +36,7 @@
 #include "libswscale/swscale_internal.h"
 #include "libavutil/attributes.h"
 #include "libavutil/x86/asm.h"
+#include "libavutil/common.h"
 #include "libavutil/cpu.h"
 
 #if HAVE_INLINE_ASM
@@ -67,12 +69,147 @@ DECLARE_ASM_CONST(8, uint64_t, pb_07) = 0x0707070707070707ULL;
 #include "yuv2rgb_template.c"
 #endif /* HAVE_MMXEXT_INLINE */
 
+#if HAVE_SSSE3_INLINE || HAVE_AVX2_INLINE
+/* offsets into the table built by init_vec_tab() */
+#define VEC_Y_OFFSET  "0*32"
+#define VEC_U_OFFSET  "1*32"
+#define VEC_V_OFFSET  "2*32"
+#define VEC_Y_COEFF   "3*32"
+#define VEC_UB_COEFF  "4*32"
+#define VEC_UG_COEFF  "5*32"
+#define VEC_VG_COEFF  "6*32"
+#define VEC_VR_COEFF  "7*32"
+#define VEC_00FFW     "8*32"
+#define VEC_SHUF24(n) "9*32+" #n "*32"
+#define VEC_TAB_SIZE  18
+
+/**
+ * Fill tab with the conversion coefficients of c broadcast to 32 bytes,
+ * followed by the pshufb masks for packing three planar registers of
+ * 16 pixels into 48 bytes of 24-bit pixels.
+ */
+static void init_vec_tab(const SwsContext *c, uint8_t (*tab)[32])
+{
+    const uint64_t *coeffs[8] = {
+        &c->yOffset, &c->uOffset,  &c->vOffset,  &c->yCoeff,
+        &c->ubCoeff, &c->ugCoeff, &c->vgCoeff, &c->vrCoeff,
+    };
+    int i, j;
+
+    for (i = 0; i < 8; i++)
+        for (j = 0; j < 32; j += 8)
+            memcpy(tab[i] + j, coeffs[i], 8);
+    for (j = 0; j < 32; j += 2) {
+        tab[8][j]     = 0xff;
+        tab[8][j + 1] = 0;
+    }
+    /* mask 3 * k + pos selects the pixel component at position pos of
+     * output bytes 16 * k .. 16 * k + 15 */
+    for (i = 0; i < 9; i++) {
+        for (j = 0; j < 16; j++) {
+            int pos = 16 * (i / 3) + j;
+            tab[9 + i][j] = tab[9 + i][j + 16] =
+                pos % 3 == i % 3 ? pos / 3 : 0x80;
+        }
+    }
+}
+
+/**
+ * Convert the pixels from x to w of a line in C, with the same arithmetic
+ * as the SIMD code.
+ */
+static void yuv2rgb_line_tail(const SwsContext *c, uint8_t *dst,
+                              const uint8_t *py, const uint8_t *pu,
+                              const uint8_t *pv, int x, int w,
+                              int depth, int red_first)
+{
+    int y_offset = (int16_t)c->yOffset, y_coeff  = (int16_t)c->yCoeff;
+    int u_offset = (int16_t)c->uOffset, v_offset = (int16_t)c->vOffset;
+    int ub_coeff = (int16_t)c->ubCoeff, ug_coeff = (int16_t)c->ugCoeff;
+    int vg_coeff = (int16_t)c->vgCoeff, vr_coeff = (int16_t)c->vrCoeff;
+
+    for (; x < w; x++) {
+        int u  = av_clip_int16(pu[x >> 1] * 8 - u_offset);
+        int v  = av_clip_int16(pv[x >> 1] * 8 - v_offset);
+        int yy = (int16_t)(py[x] * 8 - y_offset) * y_coeff >> 16;
+        int cg = av_clip_int16((u * ug_coeff >> 16) + (v * vg_coeff >> 16));
+        int r  = av_clip_uint8(yy + (v * vr_coeff >> 16));
+        int g  = av_clip_uint8(yy + cg);
+        int b  = av_clip_uint8(yy + (u * ub_coeff >> 16));
+        uint8_t *p = dst + x * depth;
+
+        p[0] = red_first ? r : b;
+        p[1] = g;
+        p[2] = red_first ? b : r;
+        if (depth == 4)
+            p[3] = 0xff;
+    }
+}
+#endif /* HAVE_SSSE3_INLINE || HAVE_AVX2_INLINE */
+
+// SSSE3 versions
+#if HAVE_SSSE3_INLINE
+#undef RENAME
+#undef COMPILE_TEMPLATE_AVX2
+#define COMPILE_TEMPLATE_AVX2 0
+#define RENAME(a) a ## _SSSE3
+#include "yuv2rgb_sse_template.c"
+#endif /* HAVE_SSSE3_INLINE */
+
+// AVX2 versions
+#if HAVE_AVX2_INLINE
+#undef RENAME
+#undef COMPILE_TEMPLATE_AVX2
+#define COMPILE_TEMPLATE_AVX2 1
+#define RENAME(a) a ## _AVX2
+#include "yuv2rgb_sse_template.c"
+#endif /* HAVE_AVX2_INLINE */
+
 #endif /* HAVE_INLINE_ASM */
 
 av_cold SwsFunc ff_yuv2rgb_init_mmx(SwsContext *c)
 {
 #if HAVE_INLINE_ASM
     int cpu_flags = av_get_cpu_flags();
+    int alpha     = c->srcFormat == AV_PIX_FMT_YUVA420P;
+
+#if HAVE_AVX2_INLINE
+    if (cpu_flags & AV_CPU_FLAG_AVX2) {
+        switch (c->dstFormat) {
+        case AV_PIX_FMT_RGB32:
+            if (!alpha)
+                return yuv420_rgb32_AVX2;
+            break;
+        case AV_PIX_FMT_BGR32:
+            if (!alpha)
+                return yuv420_bgr32_AVX2;
+            break;
+        case AV_PIX_FMT_RGB24:
+            return yuv420_rgb24_AVX2;
+        case AV_PIX_FMT_BGR24:
+            return yuv420_bgr24_AVX2;
+        }
+    }
+#endif
+
+#if HAVE_SSSE3_INLINE
+    if (cpu_flags & AV_CPU_FLAG_SSSE3) {
+        switch (c->dstFormat) {
+        case AV_PIX_FMT_RGB32:
+            if (!alpha)
+                return yuv420_rgb32_SSSE3;
+            break;
+        case AV_PIX_FMT_BGR32:
+            if (!alpha)
+                return yuv420_bgr32_SSSE3;
+            break;
+        case AV_PIX_FMT_RGB24:
+            return yuv420_rgb24_SSSE3;
+        case AV_PIX_FMT_BGR24:
+            return yuv420_bgr24_SSSE3;
+        }
+    }
+#endif
 
 #if HAVE_MMXEXT_INLINE
     if (cpu_flags & AV_CPU_FLAG_MMXEXT) {
@@ -0,0 +1,197 @@
+/*
+ * software YUV to RGB converter, SSSE3 and AVX2 versions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* The arithmetic is the same as in yuv2rgb_template.c, on 16 (SSSE3) or
+ * 32 (AVX2) pixels per iteration. The AVX2 version works on two 128-bit
+ * lanes of 16 pixels each, so the stores write out the low lanes first and
+ * then the high lanes. */
+
+#undef VREG
+#undef OP
+#undef MOVA
+#undef ZERO_REG
+#undef LOAD_YUV
+#undef STORE
+#undef VZEROUPPER
+#undef STEP
+
+#define REG_BLUE  "0"
+#define REG_RED   "1"
+#define REG_GREEN "2"
+
+#if COMPILE_TEMPLATE_AVX2
+#define VREG(n)          "%%ymm" n
+#define OP(op, src, dst) "v" op " " src ", " dst ", " dst "\n\t"
+#define MOVA(src, dst)   "vmovdqa " src ", " dst "\n\t"
+#define ZERO_REG
+#define LOAD_YUV                              \
+    "vmovdqu   (%5, %0, 2), %%ymm6\n\t"       \
+    "vpmovzxbw (%2, %0),    %%ymm0\n\t"       \
+    "vpmovzxbw (%3, %0),    %%ymm1\n\t"
+#define STORE(reg, lo, hi)                    \
+    "vmovdqu      %%xmm"reg", "lo"(%1)\n\t"   \
+    "vextracti128 $1, %%ymm"reg", "hi"(%1)\n\t"
+#define VZEROUPPER "vzeroupper\n\t"
+#define STEP 32
+#else
+#define VREG(n)          "%%xmm" n
+#define OP(op, src, dst) op " " src ", " dst "\n\t"
+#define MOVA(src, dst)   "movdqa " src ", " dst "\n\t"
+#define ZERO_REG "pxor %%xmm4, %%xmm4\n\t"
+#define LOAD_YUV                              \
+    "movdqu    (%5, %0, 2), %%xmm6\n\t"       \
+    "movq      (%2, %0),    %%xmm0\n\t"       \
+    "movq      (%3, %0),    %%xmm1\n\t"       \
+    "punpcklbw %%xmm4,      %%xmm0\n\t"       \
+    "punpcklbw %%xmm4,      %%xmm1\n\t"
+#define STORE(reg, lo, hi)                    \
+    "movdqu    %%xmm"reg", "lo"(%1)\n\t"
+#define VZEROUPPER
+#define STEP 16
+#endif
+
+/* Input: 0 - U, 1 - V, 6 - Y. Output: 1 - R, 2 - G, 0 - B, one byte per
+ * pixel. Uses all 8 registers except the zero register 4. */
+#define YUV2RGB_VEC                                  \
+    MOVA(VREG("6"), VREG("7"))                       \
+    OP("pand",   VEC_00FFW"(%4)",    VREG("6"))      \
+    OP("psrlw",  "$8",               VREG("7"))      \
+    OP("psllw",  "$3",               VREG("0"))      \
+    OP("psllw",  "$3",               VREG("1"))      \
+    OP("psllw",  "$3",               VREG("6"))      \
+    OP("psllw",  "$3",               VREG("7"))      \
+    OP("psubsw", VEC_U_OFFSET"(%4)", VREG("0"))      \
+    OP("psubsw", VEC_V_OFFSET"(%4)", VREG("1"))      \
+    OP("psubw",  VEC_Y_OFFSET"(%4)", VREG("6"))      \
+    OP("psubw",  VEC_Y_OFFSET"(%4)", VREG("7"))      \
+    MOVA(VREG("0"), VREG("2"))                       \
+    MOVA(VREG("1"), VREG("3"))                       \
+    OP("pmulhw", VEC_UG_COEFF"(%4)", VREG("2"))      \
+    OP("pmulhw", VEC_VG_COEFF"(%4)", VREG("3"))      \
+    OP("pmulhw", VEC_Y_COEFF"(%4)",  VREG("6"))      \
+    OP("pmulhw", VEC_Y_COEFF"(%4)",  VREG("7"))      \
+    OP("pmulhw", VEC_UB_COEFF"(%4)", VREG("0"))      \
+    OP("pmulhw", VEC_VR_COEFF"(%4)", VREG("1"))      \
+    OP("paddsw", VREG("3"),          VREG("2"))      \
+    MOVA(VREG("7"), VREG("3"))                       \
+    MOVA(VREG("7"), VREG("5"))                       \
+    OP("paddsw", VREG("0"),          VREG("3"))      \
+    OP("paddsw", VREG("1"),          VREG("5"))      \
+    OP("paddsw", VREG("2"),          VREG("7"))      \
+    OP("paddsw", VREG("6"),          VREG("0"))      \
+    OP("paddsw", VREG("6"),          VREG("1"))      \
+    OP("paddsw", VREG("6"),          VREG("2"))      \
+    /* pack and interleave even/odd pixels */        \
+    OP("packuswb",  VREG("1"),       VREG("0"))      \
+    OP("packuswb",  VREG("5"),       VREG("3"))      \
+    OP("packuswb",  VREG("2"),       VREG("2"))      \
+    MOVA(VREG("0"), VREG("1"))                       \
+    OP("packuswb",  VREG("7"),       VREG("7"))      \
+    OP("punpcklbw", VREG("3"),       VREG("0"))      \
+    OP("punpckhbw", VREG("3"),       VREG("1"))      \
+    OP("punpcklbw", VREG("7"),       VREG("2"))
+
+#define RGB_PACK32_VEC(red, green, blue)             \
+    OP("pcmpeqd",   VREG("3"),    VREG("3"))         \
+    MOVA(VREG(blue), VREG("5"))                      \
+    MOVA(VREG(red),  VREG("6"))                      \
+    OP("punpckhbw", VREG(green),  VREG("5"))         \
+    OP("punpcklbw", VREG(green),  VREG(blue))        \
+    OP("punpckhbw", VREG("3"),    VREG("6"))         \
+    OP("punpcklbw", VREG("3"),    VREG(red))         \
+    MOVA(VREG(blue), VREG(green))                    \
+    MOVA(VREG("5"),  VREG("3"))                      \
+    OP("punpcklwd", VREG(red),    VREG(blue))        \
+    OP("punpckhwd", VREG(red),    VREG(green))       \
+    OP("punpcklwd", VREG("6"),    VREG("5"))         \
+    OP("punpckhwd", VREG("6"),    VREG("3"))         \
+    STORE(blue,  "0",  "64")                         \
+    STORE(green, "16", "80")                         \
+    STORE("5",   "32", "96")                         \
+    STORE("3",   "48", "112")
+
+/* Gather 16 bytes of packed output from the three planar registers. */
+#define RGB_SHUF24_VEC(first, third, n0, n1, n2, lo, hi) \
+    MOVA(VREG(first),     VREG("3"))                 \
+    MOVA(VREG(REG_GREEN), VREG("6"))                 \
+    MOVA(VREG(third),     VREG("7"))                 \
+    OP("pshufb", VEC_SHUF24(n0)"(%4)", VREG("3"))    \
+    OP("pshufb", VEC_SHUF24(n1)"(%4)", VREG("6"))    \
+    OP("pshufb", VEC_SHUF24(n2)"(%4)", VREG("7"))    \
+    OP("por",    VREG("6"),            VREG("3"))    \
+    OP("por",    VREG("7"),            VREG("3"))    \
+    STORE("3", lo, hi)
+
+#define RGB_PACK24_VEC(first, third)                             \
+    RGB_SHUF24_VEC(first, third, 0, 1, 2, "0",  "48")            \
+    RGB_SHUF24_VEC(first, third, 3, 4, 5, "16", "64")            \
+    RGB_SHUF24_VEC(first, third, 6, 7, 8, "32", "80")
+
+#define YUV2RGB_VEC_FUNC(name, depth, red_first, PACK)                       \
+static int RENAME(name)(SwsContext *c, const uint8_t *src[],                 \
+                        int srcStride[], int srcSliceY, int srcSliceH,       \
+                        uint8_t *dst[], int dstStride[])                     \
+{                                                                            \
+    DECLARE_ALIGNED(32, uint8_t, tab)[VEC_TAB_SIZE][32];                     \
+    int y, h_size, vshift;                                                   \
+                                                                             \
+    init_vec_tab(c, tab);                                                    \
+    h_size = (c->dstW + STEP - 1) & ~(STEP - 1);                             \
+    if (h_size * depth > FFABS(dstStride[0]))                                \
+        h_size -= STEP;                                                      \
+                                                                             \
+    vshift = c->srcFormat != AV_PIX_FMT_YUV422P;                             \
+                                                                             \
+    for (y = 0; y < srcSliceH; y++) {                                        \
+        uint8_t *image    = dst[0] + (y + srcSliceY) * dstStride[0];         \
+        const uint8_t *py = src[0] +               y * srcStride[0];         \
+        const uint8_t *pu = src[1] +   (y >> vshift) * srcStride[1];         \
+        const uint8_t *pv = src[2] +   (y >> vshift) * srcStride[2];         \
+        x86_reg index = -h_size / 2;                                         \
+                                                                             \
+        if (index)                                                           \
+            __asm__ volatile (                                               \
+                ZERO_REG                                                     \
+                "1:                                 \n\t"                    \
+                LOAD_YUV                                                     \
+                YUV2RGB_VEC                                                  \
+                PACK                                                         \
+                "add $"AV_STRINGIFY(STEP * depth)", %1\n\t"                  \
+                "add $"AV_STRINGIFY(STEP / 2)",     %0\n\t"                  \
+                "js   1b                            \n\t"                    \
+                VZEROUPPER                                                   \
+                : "+r" (index), "+r" (image)                                 \
+                : "r" (pu - index), "r" (pv - index), "r" (tab),             \
+                  "r" (py - 2 * index)                                       \
+                : XMM_CLOBBERS("xmm0", "xmm1", "xmm2", "xmm3",               \
+                               "xmm4", "xmm5", "xmm6", "xmm7",)              \
+                  "memory"                                                   \
+            );                                                               \
+        if (h_size < c->dstW)                                                \
+            yuv2rgb_line_tail(c, dst[0] + (y + srcSliceY) * dstStride[0],   \
+                              py, pu, pv, h_size, c->dstW, depth, red_first); \
+    }                                                                        \
+    return srcSliceH;                                                        \
+}
+
+YUV2RGB_VEC_FUNC(yuv420_rgb32, 4, 0, RGB_PACK32_VEC(REG_RED, REG_GREEN, REG_BLUE))
+YUV2RGB_VEC_FUNC(yuv420_bgr32, 4, 1, RGB_PACK32_VEC(REG_BLUE, REG_GREEN, REG_RED))
+YUV2RGB_VEC_FUNC(yuv420_rgb24, 3, 1, RGB_PACK24_VEC(REG_RED, REG_BLUE))
+YUV2RGB_VEC_FUNC(yuv420_bgr24, 3, 0, RGB_PACK24_VEC(REG_BLUE, REG_RED))
@@ -616,6 +616,8 @@ SwsFunc ff_yuv2rgb_get_func_ptr(SwsContext *c)
         t = ff_yuv2rgb_init_altivec(c);
     else if (ARCH_BFIN)
         t = ff_yuv2rgb_get_func_ptr_bfin(c);
+    else if (ARCH_ARM)
+        t = ff_yuv2rgb_init_arm(c);
 
     if (t)
         return t;
@@ -145,6 +145,37 @@ enc_dec(){
     tests/tiny_psnr $srcfile $decfile $cmp_unit $cmp_shift
 }
 
+bench(){
+    benchfile="${outdir}/${test}.bench"
+    ffmpeg -benchmark "$@" -f null - >$benchfile || return
+    awk -v test=$test '
+        /^bench: encode 0\.0 / { sub(/.*frames=/, ""); frames = $1 }
+        /^bench: utime=/       { sub(/.*utime=/, ""); utime = $1 + 0
+                                 sub(/.*maxrss=/, ""); maxrss = $1 + 0 }
+        END {
+            line = test " utime=" utime "s maxrss=" maxrss "kB"
+            if (frames != "")
+                line = line " frames=" frames " fps=" (utime > 0 ? sprintf("%.1f", frames / utime) : "inf")
+            print line
+        }' $benchfile | tee -a "${outdir}/bench.log" >&3
+    rm -f $benchfile
+}
+
+bench_dec(){
+    encfile="${outdir}/${test}.$1"
+    cleanfiles="$cleanfiles $encfile"
+    tencfile=$(target_path $encfile)
+    shift
+    enc_args=
+    while test $# -gt 0 && test "$1" != --; do
+        enc_args="$enc_args $1"
+        shift
+    done
+    test $# -gt 0 && shift
+    ffmpeg $enc_args -y $tencfile || return
+    bench -i $tencfile "$@"
+}
+
 regtest(){
     t="${test#$2-}"
     ref=${base}/ref/$2/$t
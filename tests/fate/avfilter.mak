@@ -12,6 +12,7 @@ FATE_LAVFI = fate-lavfi-alphaextract_rgb                                \
              fate-lavfi-field                                           \
              fate-lavfi-idet                                            \
              fate-lavfi-life                                            \
+             fate-lavfi-lut_threads                                     \
              fate-lavfi-null                                            \
              fate-lavfi-overlay                                         \
              fate-lavfi-pad                                             \
@@ -25,6 +26,7 @@ FATE_LAVFI = fate-lavfi-alphaextract_rgb                                \
              fate-lavfi-pixfmts_vflip                                   \
              fate-lavfi-scale200                                        \
              fate-lavfi-scale500                                        \
+             fate-lavfi-scale500_threads                                \
              fate-lavfi-scalenorm                                       \
              fate-lavfi-select                                          \
              fate-lavfi-setdar                                          \
@@ -0,0 +1,57 @@
+# Throughput benchmarks. These are not part of "make fate"; run them with
+# "make fate-bench" and read the results from tests/data/fate/bench.log.
+
+BENCH_VIDEO = -f lavfi -i testsrc=size=1280x720:rate=25:duration=20
+BENCH_AUDIO = -f lavfi -i "aevalsrc=sin(440*2*PI*t):sin(660*2*PI*t)::s=48000:d=300"
+# a clip this short is dominated by decoder startup, compare builds with and
+# without --enable-hardcoded-tables
+BENCH_AUDIO_SHORT = -f lavfi -i "aevalsrc=sin(440*2*PI*t)::s=48000:d=0.1"
+
+FATE_BENCH-$(call ENCDEC, MPEG4, AVI) += fate-bench-enc-mpeg4
+fate-bench-enc-mpeg4: CMD = bench $(BENCH_VIDEO) -c:v mpeg4 -q:v 4
+
+FATE_BENCH-$(call ENCDEC, MPEG2VIDEO, MPEG2VIDEO) += fate-bench-enc-mpeg2video
+fate-bench-enc-mpeg2video: CMD = bench $(BENCH_VIDEO) -c:v mpeg2video -q:v 4 -bf 2
+
+FATE_BENCH-$(call ENCDEC, AC3, AC3) += fate-bench-enc-ac3
+fate-bench-enc-ac3: CMD = bench $(BENCH_AUDIO) -c:a ac3 -b:a 384k
+
+FATE_BENCH-$(call ENCDEC, MPEG4, AVI) += fate-bench-dec-mpeg4
+fate-bench-dec-mpeg4: CMD = bench_dec avi $(BENCH_VIDEO) -c:v mpeg4 -q:v 4
+
+FATE_BENCH-$(call ENCDEC, MPEG2VIDEO, MPEG2VIDEO) += fate-bench-dec-mpeg2video
+fate-bench-dec-mpeg2video: CMD = bench_dec m2v $(BENCH_VIDEO) -c:v mpeg2video -q:v 4 -bf 2
+
+FATE_BENCH-$(call ENCDEC, AC3, AC3) += fate-bench-dec-ac3
+fate-bench-dec-ac3: CMD = bench_dec ac3 $(BENCH_AUDIO) -c:a ac3 -b:a 384k
+
+FATE_BENCH-$(call ALLYES, AAC_ENCODER ADTS_MUXER AAC_DEMUXER AAC_DECODER LAVFI_INDEV AEVALSRC_FILTER) += fate-bench-startup-aac
+fate-bench-startup-aac: CMD = bench_dec adts $(BENCH_AUDIO_SHORT) -strict -2 -c:a aac
+
+FATE_BENCH-$(call ENCDEC, UTVIDEO, AVI) += fate-bench-dec-utvideo
+fate-bench-dec-utvideo: CMD = bench_dec avi $(BENCH_VIDEO) -c:v utvideo -pred median
+
+FATE_BENCH-$(call ENCDEC, FFV1, NUT) += fate-bench-enc-ffv1
+fate-bench-enc-ffv1: CMD = bench $(BENCH_VIDEO) -c:v ffv1 -coder 1 -context 1
+
+FATE_BENCH-$(call ENCDEC, FFV1, NUT) += fate-bench-dec-ffv1
+fate-bench-dec-ffv1: CMD = bench_dec nut $(BENCH_VIDEO) -c:v ffv1 -coder 1 -context 1
+
+FATE_BENCH-$(call ENCDEC, SNOW, NUT) += fate-bench-enc-snow
+fate-bench-enc-snow: CMD = bench $(BENCH_VIDEO) -c:v snow -q:v 2
+
+FATE_BENCH-$(call ENCDEC, SNOW, NUT) += fate-bench-dec-snow
+fate-bench-dec-snow: CMD = bench_dec nut $(BENCH_VIDEO) -c:v snow -q:v 2
+
+FATE_BENCH-$(call ALLYES, LAVFI_INDEV TESTSRC_FILTER SCALE_FILTER) += fate-bench-filter-scale
+fate-bench-filter-scale: CMD = bench $(BENCH_VIDEO) -vf scale=1920:1080 -c:v rawvideo
+
+FATE_BENCH-$(call ENCDEC, MPEG4, AVI) += fate-bench-remux-avi
+fate-bench-remux-avi: CMD = bench_dec avi $(BENCH_VIDEO) -c:v mpeg4 -q:v 4 -- -c copy
+
+FATE_BENCH += $(FATE_BENCH-yes)
+$(FATE_BENCH): ffmpeg$(EXESUF)
+$(FATE_BENCH): CMP = null
+$(FATE_BENCH): REF = /dev/null
+
+fate-bench: $(FATE_BENCH)
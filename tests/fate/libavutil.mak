@@ -41,6 +41,11 @@ FATE_LIBAVUTIL += fate-fifo
 fate-fifo: libavutil/fifo-test$(EXESUF)
 fate-fifo: CMD = run libavutil/fifo-test
 
+FATE_LIBAVUTIL += fate-float_dsp
+fate-float_dsp: libavutil/float_dsp-test$(EXESUF)
+fate-float_dsp: CMD = run libavutil/float_dsp-test
+fate-float_dsp: REF = /dev/null
+
 FATE_LIBAVUTIL += fate-md5
 fate-md5: libavutil/md5-test$(EXESUF)
 fate-md5: CMD = run libavutil/md5-test
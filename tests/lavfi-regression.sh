@@ -22,14 +22,16 @@ do_video_filter() {
 
 do_lavfi_plain() {
     vfilters="$2"
+    label=$1
+    shift 2
 
-    if [ $test = $1 ] ; then
-        do_video_filter $test "$2"
+    if [ $test = $label ] ; then
+        do_video_filter $test "$vfilters" "$@"
     fi
 }
 
 do_lavfi() {
-    do_lavfi_plain $1 "$2"
+    do_lavfi_plain "$@"
 }
 
 do_lavfi_colormatrix() {
@@ -46,6 +48,7 @@ do_lavfi "edgedetect"         "edgedetect"
 do_lavfi "fade"               "fade=in:5:15,fade=out:30:15"
 do_lavfi "hue"                "hue=s=sin(2*PI*t)+1"
 do_lavfi "idet"               "idet"
+do_lavfi "lut_threads"        "lutyuv=y=negval:u=val/2,negate" -filter_threads 3
 do_lavfi "null"               "null"
 do_lavfi "overlay"            "split[m],scale=88:72,pad=96:80:4:4[o2];[m]fifo[o1],[o1][o2]overlay=240:16"
 do_lavfi "pad"                "pad=iw*1.5:ih*1.5:iw*0.3:ih*0.2"
@@ -57,6 +60,7 @@ do_lavfi "pp5"                "pp=md"
 do_lavfi "pp6"                "pp=be/fd"
 do_lavfi "scale200"           "scale=200:200"
 do_lavfi "scale500"           "scale=500:500"
+do_lavfi "scale500_threads"   "scale=500:500:threads=3"
 do_lavfi "select"             "select=not(eq(mod(n\,2)\,0)+eq(mod(n\,3)\,0))"
 do_lavfi "setdar"             "setdar=16/9"
 do_lavfi "setsar"             "setsar=16/11"
@@ -0,0 +1,152 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Write a frame index of a video stream, with picture types, without
+ * decoding anything. The packets returned by the demuxer are passed
+ * through the codec parser only, so this runs at demuxing speed.
+ *
+ * Every line of the index describes one video packet:
+ *   <dts> <pts> <byte position> <size> <picture type> <K if key frame>
+ * with timestamps in the stream time base, which is written in the
+ * first line.
+ *
+ * To build:
+ *   make tools/gopindex
+ *
+ * Usage:
+ *   tools/gopindex [-s stream] [-k] [-o index.txt] input.ts
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavformat/avformat.h"
+#include "libavcodec/avcodec.h"
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [-s stream] [-k] [-o outfile] infile\n", argv0);
+    fprintf(stderr, "-s\tindex the given stream instead of the first video stream\n");
+    fprintf(stderr, "-k\tonly write key frames\n");
+    fprintf(stderr, "-o\twrite the index to outfile instead of stdout\n");
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    const char *infile = NULL, *outfile = NULL;
+    AVFormatContext *ic = NULL;
+    AVCodecParserContext *parser = NULL;
+    AVStream *st;
+    AVPacket pkt;
+    FILE *out = stdout;
+    int64_t nb_frames = 0, nb_keyframes = 0;
+    int stream_index = -1, keyframes_only = 0;
+    int i, ret;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            stream_index = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-k")) {
+            keyframes_only = 1;
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            outfile = argv[++i];
+        } else if (argv[i][0] == '-') {
+            return usage(argv[0], 1);
+        } else {
+            infile = argv[i];
+        }
+    }
+    if (!infile)
+        return usage(argv[0], 1);
+
+    av_register_all();
+
+    if ((ret = avformat_open_input(&ic, infile, NULL, NULL)) < 0) {
+        fprintf(stderr, "Unable to open %s: %d\n", infile, ret);
+        return 1;
+    }
+    if ((ret = avformat_find_stream_info(ic, NULL)) < 0) {
+        fprintf(stderr, "Unable to identify %s\n", infile);
+        goto fail;
+    }
+
+    if (stream_index < 0)
+        stream_index = av_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (stream_index < 0 || stream_index >= ic->nb_streams) {
+        fprintf(stderr, "No video stream to index in %s\n", infile);
+        ret = AVERROR(EINVAL);
+        goto fail;
+    }
+    for (i = 0; i < ic->nb_streams; i++)
+        if (i != stream_index)
+            ic->streams[i]->discard = AVDISCARD_ALL;
+    st = ic->streams[stream_index];
+
+    parser = av_parser_init(st->codec->codec_id);
+    if (parser)
+        parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+    else
+        fprintf(stderr, "No parser for this codec, picture types are unknown\n");
+
+    if (outfile && !(out = fopen(outfile, "w"))) {
+        fprintf(stderr, "Unable to create %s\n", outfile);
+        ret = AVERROR(errno);
+        goto fail;
+    }
+    fprintf(out, "timebase %d/%d\n", st->time_base.num, st->time_base.den);
+
+    av_init_packet(&pkt);
+    while (av_read_frame(ic, &pkt) >= 0) {
+        if (pkt.stream_index == stream_index) {
+            int key = pkt.flags & AV_PKT_FLAG_KEY;
+            char pict_type = '?';
+
+            if (parser) {
+                uint8_t *data;
+                int size;
+                av_parser_parse2(parser, st->codec, &data, &size,
+                                 pkt.data, pkt.size, pkt.pts, pkt.dts, pkt.pos);
+                pict_type = av_get_picture_type_char(parser->pict_type);
+                if (parser->key_frame == 1)
+                    key = 1;
+            }
+            if (key || !keyframes_only)
+                fprintf(out, "%"PRId64" %"PRId64" %"PRId64" %d %c%s\n",
+                        pkt.dts, pkt.pts, pkt.pos, pkt.size, pict_type,
+                        key ? " K" : "");
+            nb_frames++;
+            nb_keyframes += !!key;
+        }
+        av_free_packet(&pkt);
+    }
+    fprintf(stderr, "%"PRId64" frames, %"PRId64" key frames\n",
+            nb_frames, nb_keyframes);
+    ret = 0;
+
+fail:
+    if (out && out != stdout)
+        fclose(out);
+    if (parser)
+        av_parser_close(parser);
+    avformat_close_input(&ic);
+    return ret ? 1 : 0;
+}